@@ -0,0 +1,419 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   Fineline_Hash.cpp
+
+   Title : FineLine Computer Forensics Timeline Constructor
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: MD5 (RFC 1321), SHA-1 and SHA-256 (FIPS 180-4). The three
+            algorithms share the 64 byte block size and padding scheme,
+            only the byte order of the words and the message length differs.
+
+*/
+
+#include <string.h>
+
+#include "Fineline_Hash.h"
+
+using namespace std;
+
+#define FL_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define FL_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const uint32_t md5_sines[64] =
+{
+   0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+   0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+   0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+   0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+   0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+   0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+   0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+   0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const int md5_shifts[64] =
+{
+   7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+   5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+   4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+   6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static const uint32_t sha256_constants[64] =
+{
+   0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+   0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+   0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+   0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+   0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+   0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+   0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+   0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t load_le32(const unsigned char *p)
+{
+   return((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+static inline uint32_t load_be32(const unsigned char *p)
+{
+   return(((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3]);
+}
+
+static inline void store_le32(unsigned char *p, uint32_t v)
+{
+   p[0] = (unsigned char)v;
+   p[1] = (unsigned char)(v >> 8);
+   p[2] = (unsigned char)(v >> 16);
+   p[3] = (unsigned char)(v >> 24);
+}
+
+static inline void store_be32(unsigned char *p, uint32_t v)
+{
+   p[0] = (unsigned char)(v >> 24);
+   p[1] = (unsigned char)(v >> 16);
+   p[2] = (unsigned char)(v >> 8);
+   p[3] = (unsigned char)v;
+}
+
+Fineline_Hash::Fineline_Hash()
+{
+   reset();
+}
+
+Fineline_Hash::~Fineline_Hash()
+{
+   //dtor
+}
+
+/*
+   Function: reset
+   Purpose : Starts a new set of digests.
+   Input   : None.
+   Output  : None.
+*/
+void Fineline_Hash::reset()
+{
+   md5_state[0] = 0x67452301;
+   md5_state[1] = 0xefcdab89;
+   md5_state[2] = 0x98badcfe;
+   md5_state[3] = 0x10325476;
+
+   sha1_state[0] = 0x67452301;
+   sha1_state[1] = 0xefcdab89;
+   sha1_state[2] = 0x98badcfe;
+   sha1_state[3] = 0x10325476;
+   sha1_state[4] = 0xc3d2e1f0;
+
+   sha256_state[0] = 0x6a09e667;
+   sha256_state[1] = 0xbb67ae85;
+   sha256_state[2] = 0x3c6ef372;
+   sha256_state[3] = 0xa54ff53a;
+   sha256_state[4] = 0x510e527f;
+   sha256_state[5] = 0x9b05688c;
+   sha256_state[6] = 0x1f83d9ab;
+   sha256_state[7] = 0x5be0cd19;
+
+   buffer_length = 0;
+   total_length = 0;
+}
+
+void Fineline_Hash::md5_block(const unsigned char *block)
+{
+   uint32_t w[16];
+   uint32_t a = md5_state[0], b = md5_state[1], c = md5_state[2], d = md5_state[3];
+   uint32_t f, t;
+   int i, g;
+
+   for (i = 0; i < 16; i++)
+      w[i] = load_le32(block + i * 4);
+
+   for (i = 0; i < 64; i++)
+   {
+      if (i < 16)
+      {
+         f = (b & c) | (~b & d);
+         g = i;
+      }
+      else if (i < 32)
+      {
+         f = (d & b) | (~d & c);
+         g = (5 * i + 1) & 15;
+      }
+      else if (i < 48)
+      {
+         f = b ^ c ^ d;
+         g = (3 * i + 5) & 15;
+      }
+      else
+      {
+         f = c ^ (b | ~d);
+         g = (7 * i) & 15;
+      }
+      t = d;
+      d = c;
+      c = b;
+      b = b + FL_ROTL(a + f + md5_sines[i] + w[g], md5_shifts[i]);
+      a = t;
+   }
+
+   md5_state[0] += a;
+   md5_state[1] += b;
+   md5_state[2] += c;
+   md5_state[3] += d;
+}
+
+void Fineline_Hash::sha1_block(const unsigned char *block)
+{
+   uint32_t w[80];
+   uint32_t a = sha1_state[0], b = sha1_state[1], c = sha1_state[2], d = sha1_state[3], e = sha1_state[4];
+   uint32_t f, k, t;
+   int i;
+
+   for (i = 0; i < 16; i++)
+      w[i] = load_be32(block + i * 4);
+   for (i = 16; i < 80; i++)
+      w[i] = FL_ROTL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+   for (i = 0; i < 80; i++)
+   {
+      if (i < 20)
+      {
+         f = (b & c) | (~b & d);
+         k = 0x5a827999;
+      }
+      else if (i < 40)
+      {
+         f = b ^ c ^ d;
+         k = 0x6ed9eba1;
+      }
+      else if (i < 60)
+      {
+         f = (b & c) | (b & d) | (c & d);
+         k = 0x8f1bbcdc;
+      }
+      else
+      {
+         f = b ^ c ^ d;
+         k = 0xca62c1d6;
+      }
+      t = FL_ROTL(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = FL_ROTL(b, 30);
+      b = a;
+      a = t;
+   }
+
+   sha1_state[0] += a;
+   sha1_state[1] += b;
+   sha1_state[2] += c;
+   sha1_state[3] += d;
+   sha1_state[4] += e;
+}
+
+void Fineline_Hash::sha256_block(const unsigned char *block)
+{
+   uint32_t w[64];
+   uint32_t s[8];
+   uint32_t s0, s1, t1, t2;
+   int i;
+
+   for (i = 0; i < 16; i++)
+      w[i] = load_be32(block + i * 4);
+   for (i = 16; i < 64; i++)
+   {
+      s0 = FL_ROTR(w[i - 15], 7) ^ FL_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      s1 = FL_ROTR(w[i - 2], 17) ^ FL_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+   }
+
+   memcpy(s, sha256_state, sizeof(s));
+
+   for (i = 0; i < 64; i++)
+   {
+      s1 = FL_ROTR(s[4], 6) ^ FL_ROTR(s[4], 11) ^ FL_ROTR(s[4], 25);
+      t1 = s[7] + s1 + ((s[4] & s[5]) ^ (~s[4] & s[6])) + sha256_constants[i] + w[i];
+      s0 = FL_ROTR(s[0], 2) ^ FL_ROTR(s[0], 13) ^ FL_ROTR(s[0], 22);
+      t2 = s0 + ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+      s[7] = s[6];
+      s[6] = s[5];
+      s[5] = s[4];
+      s[4] = s[3] + t1;
+      s[3] = s[2];
+      s[2] = s[1];
+      s[1] = s[0];
+      s[0] = t1 + t2;
+   }
+
+   for (i = 0; i < 8; i++)
+      sha256_state[i] += s[i];
+}
+
+void Fineline_Hash::process_block(const unsigned char *block)
+{
+   md5_block(block);
+   sha1_block(block);
+   sha256_block(block);
+}
+
+/*
+   Function: update
+   Purpose : Adds data to the digests, whole blocks are hashed straight from
+             the caller's buffer.
+   Input   : Data and data length.
+   Output  : None.
+*/
+void Fineline_Hash::update(const void *data, size_t length)
+{
+   const unsigned char *p = (const unsigned char *)data;
+   size_t n;
+
+   total_length += length;
+
+   if (buffer_length > 0)
+   {
+      n = 64 - buffer_length;
+      if (n > length)
+         n = length;
+      memcpy(buffer + buffer_length, p, n);
+      buffer_length += n;
+      p += n;
+      length -= n;
+      if (buffer_length < 64)
+         return;
+      process_block(buffer);
+      buffer_length = 0;
+   }
+
+   while (length >= 64)
+   {
+      process_block(p);
+      p += 64;
+      length -= 64;
+   }
+
+   if (length > 0)
+   {
+      memcpy(buffer, p, length);
+      buffer_length = length;
+   }
+}
+
+/*
+   Function: final
+   Purpose : Pads the message and writes out the digests, the object must be
+             reset before it is used again.
+   Input   : Output buffers of FL_MD5_LENGTH, FL_SHA1_LENGTH and
+             FL_SHA256_LENGTH bytes, any of them can be NULL.
+   Output  : None.
+*/
+void Fineline_Hash::final(unsigned char *md5, unsigned char *sha1, unsigned char *sha256)
+{
+   unsigned char pad[128];
+   uint64_t bits = total_length * 8;
+   size_t pad_length = (buffer_length < 56) ? 64 : 128;
+   int i;
+
+   memset(pad, 0, sizeof(pad));
+   memcpy(pad, buffer, buffer_length);
+   pad[buffer_length] = 0x80;
+
+   if (pad_length == 128)
+      process_block(pad);
+
+   // The last block differs only in the byte order of the message length.
+   for (i = 0; i < 8; i++)
+      pad[pad_length - 8 + i] = (unsigned char)(bits >> (8 * i));
+   md5_block(pad + pad_length - 64);
+
+   for (i = 0; i < 8; i++)
+      pad[pad_length - 1 - i] = (unsigned char)(bits >> (8 * i));
+   sha1_block(pad + pad_length - 64);
+   sha256_block(pad + pad_length - 64);
+
+   for (i = 0; (md5 != NULL) && (i < 4); i++)
+      store_le32(md5 + i * 4, md5_state[i]);
+   for (i = 0; (sha1 != NULL) && (i < 5); i++)
+      store_be32(sha1 + i * 4, sha1_state[i]);
+   for (i = 0; (sha256 != NULL) && (i < 8); i++)
+      store_be32(sha256 + i * 4, sha256_state[i]);
+}
+
+/*
+   Function: to_hex
+   Purpose : Converts a digest to lower case hex text.
+   Input   : Digest and digest length in bytes.
+   Output  : Hex string.
+*/
+string Fineline_Hash::to_hex(const unsigned char *digest, size_t length)
+{
+   static const char hex_digits[] = "0123456789abcdef";
+   string hex;
+   size_t i;
+
+   hex.reserve(length * 2);
+   for (i = 0; i < length; i++)
+   {
+      hex += hex_digits[digest[i] >> 4];
+      hex += hex_digits[digest[i] & 0x0F];
+   }
+
+   return(hex);
+}
+
+/*
+   Function: from_hex
+   Purpose : Converts hex text in either case to a digest.
+   Input   : Hex text, text length and the digest buffer of hex_length / 2 bytes.
+   Output  : Returns the digest length, -1 if the text is not an even number
+             of hex digits.
+*/
+int Fineline_Hash::from_hex(const char *hex, size_t hex_length, unsigned char *digest)
+{
+   size_t i;
+   int c, v, high = 0;
+
+   if ((hex_length == 0) || (hex_length & 1))
+      return(-1);
+
+   for (i = 0; i < hex_length; i++)
+   {
+      c = (unsigned char)hex[i];
+      if ((c >= '0') && (c <= '9'))
+         v = c - '0';
+      else if ((c >= 'a') && (c <= 'f'))
+         v = c - 'a' + 10;
+      else if ((c >= 'A') && (c <= 'F'))
+         v = c - 'A' + 10;
+      else
+         return(-1);
+
+      if (i & 1)
+         digest[i / 2] = (unsigned char)((high << 4) | v);
+      else
+         high = v;
+   }
+
+   return((int)(hex_length / 2));
+}
@@ -0,0 +1,75 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   Fineline_Hash.h
+
+   Title : FineLine Computer Forensics Timeline Constructor
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: MD5, SHA-1 and SHA-256 message digests. All three digests are
+            computed together in one pass over the data so a file only has
+            to be read once.
+
+*/
+
+#ifndef FINELINE_HASH_H
+#define FINELINE_HASH_H
+
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace std;
+
+#define FL_MD5_LENGTH     16
+#define FL_SHA1_LENGTH    20
+#define FL_SHA256_LENGTH  32
+
+class Fineline_Hash
+{
+   public:
+      Fineline_Hash();
+      virtual ~Fineline_Hash();
+
+      void reset();
+      void update(const void *data, size_t length);
+      void final(unsigned char *md5, unsigned char *sha1, unsigned char *sha256);
+
+      static string to_hex(const unsigned char *digest, size_t length);
+      static int from_hex(const char *hex, size_t hex_length, unsigned char *digest);
+
+   protected:
+   private:
+
+      void md5_block(const unsigned char *block);
+      void sha1_block(const unsigned char *block);
+      void sha256_block(const unsigned char *block);
+      void process_block(const unsigned char *block);
+
+      uint32_t md5_state[4];
+      uint32_t sha1_state[5];
+      uint32_t sha256_state[8];
+      unsigned char buffer[64];   /* partial block, all three digests use 64 byte blocks */
+      size_t buffer_length;
+      uint64_t total_length;
+};
+
+#endif // FINELINE_HASH_H
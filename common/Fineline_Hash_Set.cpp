@@ -0,0 +1,481 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   Fineline_Hash_Set.cpp
+
+   Title : FineLine Computer Forensics Timeline Constructor
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Sorted known file hash set with a Bloom filter prefilter.
+
+            Binary hash set file format, integers are little endian:
+
+            magic "FLHSET01"   8 bytes
+            digest length      uint32
+            reserved           uint32
+            digest count       uint64
+            digests            digest count * digest length bytes, sorted
+
+*/
+
+#include <fstream>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef LINUX_BUILD
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+#include "Fineline_Hash_Set.h"
+
+using namespace std;
+
+/* Orders digest numbers by the digest bytes. */
+struct fl_digest_order
+{
+   const unsigned char *digests;
+   size_t length;
+
+   bool operator()(uint32_t a, uint32_t b) const
+   {
+      return(memcmp(digests + (size_t)a * length, digests + (size_t)b * length, length) < 0);
+   }
+};
+
+static uint64_t load_le64(const unsigned char *p)
+{
+   uint64_t v = 0;
+   int i;
+
+   for (i = 7; i >= 0; i--)
+      v = (v << 8) | p[i];
+
+   return(v);
+}
+
+static void store_le64(unsigned char *p, uint64_t v)
+{
+   int i;
+
+   for (i = 0; i < 8; i++)
+      p[i] = (unsigned char)(v >> (8 * i));
+}
+
+Fineline_Hash_Set::Fineline_Hash_Set()
+{
+   digest_length = 0;
+   digest_count = 0;
+   digest_data = NULL;
+   bloom_mask = 0;
+   file_data = NULL;
+   file_size = 0;
+#ifdef LINUX_BUILD
+   file_descriptor = -1;
+#else
+   file_handle = INVALID_HANDLE_VALUE;
+   mapping_handle = NULL;
+#endif
+}
+
+Fineline_Hash_Set::~Fineline_Hash_Set()
+{
+   close_hash_set();
+}
+
+/*
+   Function: read_text_hash_set
+   Purpose : Reads the hex digests from a text hash set. Lines are split into
+             fields on commas, quotes, white space, '|', ';' and '*'. The first
+             field of 32, 40 or 64 hex digits on the first line with one sets
+             the digest type, after that the first field of that length is
+             used. Lines without a digest, such as CSV headers, are skipped.
+   Input   : Text file name.
+   Output  : Sets the digest length and appends the unsorted digests, returns
+             the digest count or -1 if the file could not be read.
+*/
+long Fineline_Hash_Set::read_text_hash_set(const char *filename, size_t *digest_length, vector<unsigned char> &digests)
+{
+   ifstream text_file(filename);
+   unsigned char digest[FL_SHA256_LENGTH];
+   string line;
+   size_t start, end, field_length;
+   long count = 0;
+
+   if (!text_file.is_open())
+   {
+      printf("read_text_hash_set() <ERROR> Could not open hash set file: %s\n", filename);
+      return(-1);
+   }
+
+   *digest_length = 0;
+   while (getline(text_file, line))
+   {
+      for (start = 0; start < line.size(); start = end + 1)
+      {
+         end = line.find_first_of(", \t\r\"|;*", start);
+         if (end == string::npos)
+            end = line.size();
+         field_length = end - start;
+
+         if ((field_length != FL_MD5_LENGTH * 2) && (field_length != FL_SHA1_LENGTH * 2) && (field_length != FL_SHA256_LENGTH * 2))
+            continue;
+         if ((*digest_length != 0) && (field_length != *digest_length * 2))
+            continue;
+         if (Fineline_Hash::from_hex(line.c_str() + start, field_length, digest) < 0)
+            continue;
+
+         *digest_length = field_length / 2;
+         digests.insert(digests.end(), digest, digest + *digest_length);
+         count++;
+         break;
+      }
+   }
+
+   return(count);
+}
+
+/*
+   Function: compile_hash_set
+   Purpose : Converts a text hash set to a sorted binary hash set file with
+             the duplicate digests removed.
+   Input   : Text hash set file name and the binary file name.
+   Output  : Returns the number of digests written, -1 on error.
+*/
+long Fineline_Hash_Set::compile_hash_set(const char *text_filename, const char *binary_filename)
+{
+   vector<unsigned char> digests;
+   vector<uint32_t> order;
+   unsigned char header[FL_HASH_SET_HEADER_SIZE];
+   fl_digest_order digest_order;
+   size_t length, count, i, unique_count;
+   FILE *fp;
+
+   if (read_text_hash_set(text_filename, &length, digests) < 0)
+      return(-1);
+
+   count = (length > 0) ? digests.size() / length : 0;
+   order.resize(count);
+   for (i = 0; i < count; i++)
+      order[i] = (uint32_t)i;
+
+   digest_order.digests = digests.data();
+   digest_order.length = length;
+   sort(order.begin(), order.end(), digest_order);
+
+   fp = fopen(binary_filename, "wb");
+   if (fp == NULL)
+   {
+      printf("compile_hash_set() <ERROR> Could not create hash set file: %s\n", binary_filename);
+      return(-1);
+   }
+
+   // Write a header with a zero count first, the count is rewritten when
+   // the duplicates have been dropped.
+   memset(header, 0, sizeof(header));
+   memcpy(header, FL_HASH_SET_MAGIC, 8);
+   header[8] = (unsigned char)length;
+   fwrite(header, 1, sizeof(header), fp);
+
+   unique_count = 0;
+   for (i = 0; i < count; i++)
+   {
+      if ((i > 0) && (memcmp(&digests[(size_t)order[i] * length], &digests[(size_t)order[i - 1] * length], length) == 0))
+         continue;
+      fwrite(&digests[(size_t)order[i] * length], 1, length, fp);
+      unique_count++;
+   }
+
+   store_le64(header + 16, (uint64_t)unique_count);
+   fseek(fp, 0, SEEK_SET);
+   fwrite(header, 1, sizeof(header), fp);
+
+   if (fclose(fp) != 0)
+   {
+      printf("compile_hash_set() <ERROR> Could not write hash set file: %s\n", binary_filename);
+      return(-1);
+   }
+
+   return((long)unique_count);
+}
+
+/*
+   Function: map_hash_set
+   Purpose : Maps a binary hash set file read only.
+   Input   : Binary hash set file name.
+   Output  : 0 on success, -1 on error.
+*/
+int Fineline_Hash_Set::map_hash_set(const char *filename)
+{
+#ifdef LINUX_BUILD
+   struct stat st;
+
+   file_descriptor = open(filename, O_RDONLY);
+   if (file_descriptor < 0)
+      return(-1);
+   if ((fstat(file_descriptor, &st) < 0) || (st.st_size < FL_HASH_SET_HEADER_SIZE))
+      return(-1);
+   file_size = (size_t)st.st_size;
+
+   void *p = mmap(NULL, file_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+   if (p == MAP_FAILED)
+   {
+      file_size = 0;
+      return(-1);
+   }
+   madvise(p, file_size, MADV_RANDOM);
+   file_data = (const char *)p;
+#else
+   LARGE_INTEGER size;
+
+   file_handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+   if (file_handle == INVALID_HANDLE_VALUE)
+      return(-1);
+   if (!GetFileSizeEx(file_handle, &size) || (size.QuadPart < FL_HASH_SET_HEADER_SIZE))
+      return(-1);
+   file_size = (size_t)size.QuadPart;
+
+   mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+   if (mapping_handle != NULL)
+      file_data = (const char *)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+   if (file_data == NULL)
+   {
+      file_size = 0;
+      return(-1);
+   }
+#endif
+
+   return(0);
+}
+
+/*
+   Function: open_hash_set
+   Purpose : Opens a binary hash set file by mapping it, or reads and sorts a
+             text hash set, then builds the Bloom filter.
+   Input   : Hash set file name.
+   Output  : Returns the number of digests in the set, -1 on error.
+*/
+long Fineline_Hash_Set::open_hash_set(const char *filename)
+{
+   const unsigned char *header;
+   vector<unsigned char> digests;
+   vector<uint32_t> order;
+   fl_digest_order digest_order;
+   size_t i, n;
+   char magic[8];
+   FILE *fp;
+
+   close_hash_set();
+   hash_set_file = filename;
+
+   fp = fopen(filename, "rb");
+   if (fp == NULL)
+   {
+      printf("open_hash_set() <ERROR> Could not open hash set file: %s\n", filename);
+      return(-1);
+   }
+   n = fread(magic, 1, sizeof(magic), fp);
+   fclose(fp);
+
+   if ((n == sizeof(magic)) && (memcmp(magic, FL_HASH_SET_MAGIC, 8) == 0))
+   {
+      if (map_hash_set(filename) < 0)
+      {
+         printf("open_hash_set() <ERROR> Could not map hash set file: %s\n", filename);
+         close_hash_set();
+         return(-1);
+      }
+      header = (const unsigned char *)file_data;
+      digest_length = header[8];
+      digest_count = (size_t)load_le64(header + 16);
+      if (((digest_length != FL_MD5_LENGTH) && (digest_length != FL_SHA1_LENGTH) && (digest_length != FL_SHA256_LENGTH)) ||
+          (digest_count > (file_size - FL_HASH_SET_HEADER_SIZE) / digest_length))
+      {
+         printf("open_hash_set() <ERROR> Corrupt hash set file: %s\n", filename);
+         close_hash_set();
+         return(-1);
+      }
+      digest_data = header + FL_HASH_SET_HEADER_SIZE;
+   }
+   else
+   {
+      if (read_text_hash_set(filename, &digest_length, digests) < 0)
+      {
+         close_hash_set();
+         return(-1);
+      }
+      n = (digest_length > 0) ? digests.size() / digest_length : 0;
+      order.resize(n);
+      for (i = 0; i < n; i++)
+         order[i] = (uint32_t)i;
+      digest_order.digests = digests.data();
+      digest_order.length = digest_length;
+      sort(order.begin(), order.end(), digest_order);
+
+      digest_buffer.reserve(digests.size());
+      for (i = 0; i < n; i++)
+      {
+         if ((i > 0) && (memcmp(&digests[(size_t)order[i] * digest_length], &digests[(size_t)order[i - 1] * digest_length], digest_length) == 0))
+            continue;
+         digest_buffer.insert(digest_buffer.end(), &digests[(size_t)order[i] * digest_length], &digests[(size_t)order[i] * digest_length] + digest_length);
+      }
+      digest_count = (digest_length > 0) ? digest_buffer.size() / digest_length : 0;
+      digest_data = digest_buffer.data();
+   }
+
+   build_bloom_filter();
+
+   return((long)digest_count);
+}
+
+int Fineline_Hash_Set::close_hash_set()
+{
+#ifdef LINUX_BUILD
+   if (file_data != NULL)
+      munmap((void *)file_data, file_size);
+   if (file_descriptor >= 0)
+      close(file_descriptor);
+   file_descriptor = -1;
+#else
+   if (file_data != NULL)
+      UnmapViewOfFile(file_data);
+   if (mapping_handle != NULL)
+      CloseHandle(mapping_handle);
+   if (file_handle != INVALID_HANDLE_VALUE)
+      CloseHandle(file_handle);
+   mapping_handle = NULL;
+   file_handle = INVALID_HANDLE_VALUE;
+#endif
+   file_data = NULL;
+   file_size = 0;
+
+   digest_buffer.clear();
+   bloom_bits.clear();
+   bloom_mask = 0;
+   digest_data = NULL;
+   digest_count = 0;
+   digest_length = 0;
+
+   return(0);
+}
+
+/*
+   Function: build_bloom_filter
+   Purpose : Sets FL_BLOOM_PROBES bits for every digest. Digest bytes are
+             already uniformly distributed so the probe positions are taken
+             straight from the first 16 bytes with double hashing.
+   Input   : None.
+   Output  : None.
+*/
+void Fineline_Hash_Set::build_bloom_filter()
+{
+   uint64_t bit_count = 64;
+   uint64_t h1, h2, bit;
+   size_t i;
+   int k;
+
+   while (bit_count < (uint64_t)digest_count * FL_BLOOM_BITS_PER_DIGEST)
+      bit_count <<= 1;
+
+   bloom_bits.assign((size_t)(bit_count / 64), 0);
+   bloom_mask = bit_count - 1;
+
+   for (i = 0; i < digest_count; i++)
+   {
+      h1 = load_le64(digest_data + i * digest_length);
+      h2 = load_le64(digest_data + i * digest_length + 8) | 1;
+      for (k = 0; k < FL_BLOOM_PROBES; k++)
+      {
+         bit = (h1 + k * h2) & bloom_mask;
+         bloom_bits[bit >> 6] |= (uint64_t)1 << (bit & 63);
+      }
+   }
+}
+
+int Fineline_Hash_Set::bloom_test(const unsigned char *digest) const
+{
+   uint64_t h1 = load_le64(digest);
+   uint64_t h2 = load_le64(digest + 8) | 1;
+   uint64_t bit;
+   int k;
+
+   for (k = 0; k < FL_BLOOM_PROBES; k++)
+   {
+      bit = (h1 + k * h2) & bloom_mask;
+      if ((bloom_bits[bit >> 6] & ((uint64_t)1 << (bit & 63))) == 0)
+         return(0);
+   }
+
+   return(1);
+}
+
+/*
+   Function: contains
+   Purpose : Looks up a digest, the Bloom filter is tested first and only
+             possible matches are binary searched.
+   Input   : Digest and digest length.
+   Output  : Returns 1 if the digest is in the set, 0 if not or if the
+             digest is not the type held in the set.
+*/
+int Fineline_Hash_Set::contains(const unsigned char *digest, size_t length) const
+{
+   size_t low = 0, high = digest_count, mid;
+   int cmp;
+
+   if ((length != digest_length) || (digest_count == 0))
+      return(0);
+   if (!bloom_test(digest))
+      return(0);
+
+   while (low < high)
+   {
+      mid = low + (high - low) / 2;
+      cmp = memcmp(digest_data + mid * digest_length, digest, digest_length);
+      if (cmp == 0)
+         return(1);
+      if (cmp < 0)
+         low = mid + 1;
+      else
+         high = mid;
+   }
+
+   return(0);
+}
+
+size_t Fineline_Hash_Set::get_digest_length() const
+{
+   return(digest_length);
+}
+
+size_t Fineline_Hash_Set::get_digest_count() const
+{
+   return(digest_count);
+}
+
+const string &Fineline_Hash_Set::get_file_name() const
+{
+   return(hash_set_file);
+}
@@ -0,0 +1,103 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   Fineline_Hash_Set.h
+
+   Title : FineLine Computer Forensics Timeline Constructor
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Known file hash set such as the NSRL reference data set. A hash
+            set holds digests of one type, MD5, SHA-1 or SHA-256, sorted so a
+            digest is found with a binary search. A Bloom filter built when
+            the set is opened rejects most unknown digests without touching
+            the sorted list.
+
+            Hash sets can be read from text files with one hex digest per
+            line or NSRL style CSV lines, the first field of hex digits that
+            is a digest length is used. compile_hash_set() writes the sorted
+            digests to a binary file which is memory mapped when opened, so
+            large sets are not parsed or loaded into memory every time.
+
+            An open hash set is read only and can be shared by any number
+            of threads.
+
+*/
+
+#ifndef FINELINE_HASH_SET_H
+#define FINELINE_HASH_SET_H
+
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Fineline_Hash.h"
+
+using namespace std;
+
+#define FL_HASH_SET_MAGIC        "FLHSET01"
+#define FL_HASH_SET_HEADER_SIZE  24     /* magic, digest length, reserved, digest count */
+#define FL_BLOOM_BITS_PER_DIGEST 16     /* about 0.2% false positives with 4 probes */
+#define FL_BLOOM_PROBES          4
+
+class Fineline_Hash_Set
+{
+   public:
+      Fineline_Hash_Set();
+      virtual ~Fineline_Hash_Set();
+
+      long open_hash_set(const char *filename);
+      int close_hash_set();
+      int contains(const unsigned char *digest, size_t length) const;
+
+      size_t get_digest_length() const;
+      size_t get_digest_count() const;
+      const string &get_file_name() const;
+
+      static long compile_hash_set(const char *text_filename, const char *binary_filename);
+
+   protected:
+   private:
+
+      static long read_text_hash_set(const char *filename, size_t *digest_length, vector<unsigned char> &digests);
+      int map_hash_set(const char *filename);
+      void build_bloom_filter();
+      int bloom_test(const unsigned char *digest) const;
+
+      string hash_set_file;
+      size_t digest_length;        /* FL_MD5_LENGTH, FL_SHA1_LENGTH or FL_SHA256_LENGTH */
+      size_t digest_count;
+      const unsigned char *digest_data;   /* sorted digests, mapped or in digest_buffer */
+      vector<unsigned char> digest_buffer;
+      vector<uint64_t> bloom_bits;
+      uint64_t bloom_mask;         /* bit count - 1, the bit count is a power of 2 */
+
+      const char *file_data;
+      size_t file_size;
+#ifdef LINUX_BUILD
+      int file_descriptor;
+#else
+      void *file_handle;
+      void *mapping_handle;
+#endif
+};
+
+#endif // FINELINE_HASH_SET_H
@@ -0,0 +1,340 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   Fineline_Keyword_Matcher.cpp
+
+   Title : FineLine Computer Forensics Timeline Constructor
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Aho-Corasick multiple keyword matcher. The keywords are added to a
+            trie, compile() then computes the failure states breadth first and
+            fills in every missing transition so scanning never follows a
+            failure link.
+
+*/
+
+#include <ctype.h>
+#include <string.h>
+
+#include "Fineline_Keyword_Matcher.h"
+
+using namespace std;
+
+Fineline_Keyword_Matcher::Fineline_Keyword_Matcher(int ignore_case)
+{
+   int i;
+
+   case_fold = ignore_case;
+   for (i = 0; i < 256; i++)
+   {
+      fold_table[i] = (unsigned char)(case_fold ? tolower(i) : i);
+   }
+   clear();
+}
+
+Fineline_Keyword_Matcher::~Fineline_Keyword_Matcher()
+{
+   //dtor
+}
+
+int Fineline_Keyword_Matcher::new_state()
+{
+   int state = (int)state_keyword.size();
+
+   transitions.resize(transitions.size() + 256, -1);
+   fail_state.push_back(FL_MATCHER_START_STATE);
+   state_keyword.push_back(-1);
+   output_link.push_back(-1);
+
+   return(state);
+}
+
+void Fineline_Keyword_Matcher::clear()
+{
+   transitions.clear();
+   fail_state.clear();
+   state_keyword.clear();
+   output_link.clear();
+   keywords.clear();
+   compiled = 0;
+   memset(start_bytes, 0, sizeof(start_bytes));
+   start_byte_count = 0;
+   start_byte = 0;
+   new_state();
+}
+
+/*
+   Function: add_keyword
+   Purpose : Adds a keyword to the trie, the matcher must be compiled again
+             before it is used.
+   Input   : Keyword bytes and length.
+   Output  : Returns the keyword number, the existing number if the keyword
+             was already added, or -1 if the keyword is empty.
+*/
+int Fineline_Keyword_Matcher::add_keyword(const char *keyword, size_t length)
+{
+   int state = FL_MATCHER_START_STATE;
+   int next;
+   size_t i;
+
+   if (length == 0)
+      return(-1);
+
+   if (compiled)
+   {
+      // The compiled table has no missing transitions, so the trie
+      // edges can not be told apart. Rebuild from the keyword list.
+      vector<string> keyword_list = keywords;
+      clear();
+      add_keywords(keyword_list);
+   }
+
+   for (i = 0; i < length; i++)
+   {
+      unsigned char c = fold_table[(unsigned char)keyword[i]];
+      next = transitions[state * 256 + c];
+      if (next < 0)
+      {
+         next = new_state();
+         transitions[state * 256 + c] = next;
+      }
+      state = next;
+   }
+
+   if (state_keyword[state] < 0)
+   {
+      state_keyword[state] = (int)keywords.size();
+      keywords.push_back(string(keyword, length));
+   }
+
+   return(state_keyword[state]);
+}
+
+int Fineline_Keyword_Matcher::add_keyword(const string &keyword)
+{
+   return(add_keyword(keyword.c_str(), keyword.size()));
+}
+
+int Fineline_Keyword_Matcher::add_keywords(const vector<string> &keyword_list)
+{
+   size_t i;
+
+   for (i = 0; i < keyword_list.size(); i++)
+      add_keyword(keyword_list[i]);
+
+   return((int)keywords.size());
+}
+
+/*
+   Function: compile
+   Purpose : Computes the failure and output links breadth first and turns
+             the trie into a complete state machine.
+   Input   : None.
+   Output  : Returns the number of states.
+*/
+int Fineline_Keyword_Matcher::compile()
+{
+   vector<int32_t> queue;
+   size_t head = 0;
+   int state, next, fail, c;
+
+   if (compiled)
+      return((int)state_keyword.size());
+
+   queue.reserve(state_keyword.size());
+
+   for (c = 0; c < 256; c++)
+   {
+      next = transitions[c];
+      if (next < 0)
+      {
+         transitions[c] = FL_MATCHER_START_STATE;
+      }
+      else
+      {
+         fail_state[next] = FL_MATCHER_START_STATE;
+         queue.push_back(next);
+      }
+   }
+
+   while (head < queue.size())
+   {
+      state = queue[head++];
+      for (c = 0; c < 256; c++)
+      {
+         next = transitions[state * 256 + c];
+         if (next < 0)
+         {
+            // Missing edge, take the transition of the failure state which
+            // is already complete since it is closer to the start state.
+            transitions[state * 256 + c] = transitions[fail_state[state] * 256 + c];
+         }
+         else
+         {
+            fail = transitions[fail_state[state] * 256 + c];
+            fail_state[next] = fail;
+            output_link[next] = (state_keyword[fail] >= 0) ? fail : output_link[fail];
+            queue.push_back(next);
+         }
+      }
+   }
+
+   // Raw bytes that begin a keyword, used to skip text in the start state.
+
+   for (c = 0; c < 256; c++)
+   {
+      start_bytes[c] = (transitions[fold_table[c]] != FL_MATCHER_START_STATE);
+      if (start_bytes[c])
+      {
+         start_byte_count++;
+         start_byte = (unsigned char)c;
+      }
+   }
+
+   compiled = 1;
+
+   return((int)state_keyword.size());
+}
+
+/*
+   Function: skip_to_start_byte
+   Purpose : Finds the next byte that can begin a keyword.
+   Input   : Text, position to start from and text length.
+   Output  : Position of the byte, the length if there is none.
+*/
+size_t Fineline_Keyword_Matcher::skip_to_start_byte(const unsigned char *text, size_t position, size_t length) const
+{
+   const unsigned char *next;
+
+   if (start_byte_count == 1)
+   {
+      next = (const unsigned char *)memchr(text + position, start_byte, length - position);
+      return((next != NULL) ? (size_t)(next - text) : length);
+   }
+
+   while ((position < length) && (!start_bytes[text[position]]))
+      position++;
+
+   return(position);
+}
+
+int Fineline_Keyword_Matcher::is_compiled() const
+{
+   return(compiled);
+}
+
+size_t Fineline_Keyword_Matcher::get_keyword_count() const
+{
+   return(keywords.size());
+}
+
+size_t Fineline_Keyword_Matcher::get_state_count() const
+{
+   return(state_keyword.size());
+}
+
+const string &Fineline_Keyword_Matcher::get_keyword(int keyword_id) const
+{
+   return(keywords[keyword_id]);
+}
+
+/*
+   Function: match_any
+   Purpose : Checks if any keyword occurs in the text.
+   Input   : Text and text length.
+   Output  : Returns the number of the first keyword found, -1 if none or
+             the matcher is not compiled.
+*/
+int Fineline_Keyword_Matcher::match_any(const char *text, size_t length) const
+{
+   const int32_t *table = transitions.data();
+   const int32_t *state_out = state_keyword.data();
+   const int32_t *links = output_link.data();
+   const unsigned char *p = (const unsigned char *)text;
+   size_t i = 0;
+   int state = FL_MATCHER_START_STATE;
+
+   if ((!compiled) || (keywords.size() == 0))
+      return(-1);
+
+   while (i < length)
+   {
+      if (state == FL_MATCHER_START_STATE)
+      {
+         i = skip_to_start_byte(p, i, length);
+         if (i == length)
+            break;
+      }
+      state = table[state * 256 + fold_table[p[i++]]];
+      if (state_out[state] >= 0)
+         return(state_out[state]);
+      if (links[state] >= 0)
+         return(state_out[links[state]]);
+   }
+
+   return(-1);
+}
+
+/*
+   Function: scan
+   Purpose : Reports every keyword occurrence in the text. The state is kept
+             between calls so a buffer can be scanned in pieces.
+   Input   : Text, text length, scan state (FL_MATCHER_START_STATE for a new
+             text), match callback and callback user data.
+   Output  : Returns the number of matches reported, -1 if the matcher is not
+             compiled. The state is updated for the next piece of text.
+*/
+long Fineline_Keyword_Matcher::scan(const char *text, size_t length, int *state, fl_keyword_match_fn callback, void *user) const
+{
+   const unsigned char *p = (const unsigned char *)text;
+   size_t i;
+   long match_count = 0;
+   int s = *state;
+   int out;
+
+   if (!compiled)
+      return(-1);
+
+   for (i = 0; i < length; i++)
+   {
+      if (s == FL_MATCHER_START_STATE)
+      {
+         i = skip_to_start_byte(p, i, length);
+         if (i == length)
+            break;
+      }
+      s = transitions[s * 256 + fold_table[p[i]]];
+      out = (state_keyword[s] >= 0) ? s : output_link[s];
+      while (out >= 0)
+      {
+         match_count++;
+         if ((callback != NULL) && (callback(state_keyword[out], i + 1, user) != 0))
+         {
+            *state = s;
+            return(match_count);
+         }
+         out = output_link[out];
+      }
+   }
+
+   *state = s;
+
+   return(match_count);
+}
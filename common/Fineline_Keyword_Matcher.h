@@ -0,0 +1,97 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   Fineline_Keyword_Matcher.h
+
+   Title : FineLine Computer Forensics Timeline Constructor
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Multiple keyword matcher. The keyword list is compiled into one
+            Aho-Corasick automaton with a full 256 entry transition table per
+            state, so every keyword is searched for in a single pass over the
+            text with one table lookup per byte.
+
+            While the scan is in the start state the bytes that can not begin
+            a keyword are skipped without table lookups, with memchr() when
+            only one byte value can begin a keyword.
+
+            A compiled matcher is read only and can be shared by any number
+            of threads. The scan state can be carried between calls to match
+            keywords that span buffer boundaries.
+
+*/
+
+#ifndef FINELINE_KEYWORD_MATCHER_H
+#define FINELINE_KEYWORD_MATCHER_H
+
+#include <vector>
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace std;
+
+#define FL_MATCHER_START_STATE 0
+
+/* match callback: keyword number and the text offset one past the end of the match,
+   return non-zero to stop the scan */
+typedef int (*fl_keyword_match_fn)(int keyword_id, size_t end_offset, void *user);
+
+class Fineline_Keyword_Matcher
+{
+   public:
+      Fineline_Keyword_Matcher(int ignore_case = 0);
+      virtual ~Fineline_Keyword_Matcher();
+
+      int add_keyword(const char *keyword, size_t length);
+      int add_keyword(const string &keyword);
+      int add_keywords(const vector<string> &keyword_list);
+      int compile();
+      void clear();
+
+      int is_compiled() const;
+      size_t get_keyword_count() const;
+      size_t get_state_count() const;
+      const string &get_keyword(int keyword_id) const;
+
+      int match_any(const char *text, size_t length) const;
+      long scan(const char *text, size_t length, int *state, fl_keyword_match_fn callback, void *user) const;
+
+   protected:
+   private:
+
+      int new_state();
+      size_t skip_to_start_byte(const unsigned char *text, size_t position, size_t length) const;
+
+      int case_fold;
+      int compiled;
+      unsigned char fold_table[256];
+      unsigned char start_bytes[256];   /* bytes that leave the start state */
+      int start_byte_count;
+      unsigned char start_byte;         /* the only start byte if start_byte_count is 1 */
+      vector<int32_t> transitions;      /* state * 256 + byte -> next state, -1 in the trie before compiling */
+      vector<int32_t> fail_state;
+      vector<int32_t> state_keyword;    /* keyword ending at this state, -1 if none */
+      vector<int32_t> output_link;      /* nearest fail state with a keyword, -1 if none */
+      vector<string> keywords;
+};
+
+#endif // FINELINE_KEYWORD_MATCHER_H
@@ -0,0 +1,996 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   flbfile.c
+
+   Title : FineLine Computer Forensics Utilities
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Reader and writer for the FineLine binary timeline file (.flb).
+            The writer collects events into column arrays, the type, summary
+            and source strings are dictionary encoded with a uthash map.
+            When a block is full it is encoded little endian and written
+            with a single fwrite(), the dictionaries, the block index and
+            the trailer are written when the writer is closed.
+
+            The reader loads the trailer, dictionaries and block index at
+            open time, blocks are only read when a query needs them.
+
+   Notes: See flbfile.h for the file layout.
+
+*/
+
+#if defined(LINUX_BUILD) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+#ifdef LINUX_BUILD
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/types.h>
+
+#include "flcommon.h"
+#include "flbfile.h"
+#include "uthash.h"
+
+#ifdef LINUX_BUILD
+#define flb_fseek(f, o, w) fseeko(f, (off_t)(o), w)
+#define flb_ftell(f) ((int64_t)ftello(f))
+#else
+#define flb_fseek(f, o, w) _fseeki64(f, (__int64)(o), w)
+#define flb_ftell(f) ((int64_t)_ftelli64(f))
+#endif
+
+#define FLB_NO_CODE 0xFFFFFFFF   /* no dictionary code, the dictionary is full */
+
+struct flb_dict_entry
+{
+   char *str;
+   uint32_t code;
+   UT_hash_handle hh;
+};
+
+struct flb_dictionary
+{
+   uint32_t count;
+   uint32_t capacity;
+   char **strings;
+   struct flb_dict_entry *map;   /* writer only */
+};
+
+struct flb_writer
+{
+   FILE *file;
+   char *source_name;
+   uint64_t offset;
+   uint64_t total_events;
+
+   /* current block columns */
+   uint32_t event_count;
+   int64_t min_time;
+   int64_t max_time;
+   int64_t *times;
+   uint64_t *event_ids;
+   uint16_t *types;
+   uint32_t *summaries;
+   uint32_t *sources;
+   uint32_t *data_offsets;
+   char *data;
+   size_t data_length;
+   size_t data_capacity;
+
+   unsigned char *encode_buffer;
+   size_t encode_capacity;
+   char *line_buffer;
+   size_t line_capacity;
+
+   struct flb_dictionary dicts[FLB_DICT_COUNT];
+
+   flb_block_index_t *index;
+   uint32_t block_count;
+   uint32_t index_capacity;
+};
+
+struct flb_reader
+{
+   FILE *file;
+   uint32_t block_count;
+   uint64_t total_events;
+   flb_block_index_t *index;
+   uint64_t dict_offset;       /* the blocks end where the dictionaries start */
+   struct flb_dictionary dicts[FLB_DICT_COUNT];
+   flb_block_t block;
+   int64_t block_number;       /* block currently decoded, -1 = none */
+   unsigned char *read_buffer;
+   size_t read_capacity;
+};
+
+
+/*
+   Little endian encode/decode helpers.
+*/
+
+static void put_u16(unsigned char *p, uint16_t v)
+{
+   p[0] = (unsigned char)(v & 0xff);
+   p[1] = (unsigned char)((v >> 8) & 0xff);
+}
+
+static void put_u32(unsigned char *p, uint32_t v)
+{
+   int i;
+   for (i = 0; i < 4; i++)
+      p[i] = (unsigned char)((v >> (8 * i)) & 0xff);
+}
+
+static void put_u64(unsigned char *p, uint64_t v)
+{
+   int i;
+   for (i = 0; i < 8; i++)
+      p[i] = (unsigned char)((v >> (8 * i)) & 0xff);
+}
+
+static uint16_t get_u16(unsigned char *p)
+{
+   return((uint16_t)(p[0] | (p[1] << 8)));
+}
+
+static uint32_t get_u32(unsigned char *p)
+{
+   return((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+static uint64_t get_u64(unsigned char *p)
+{
+   int i;
+   uint64_t v = 0;
+   for (i = 7; i >= 0; i--)
+      v = (v << 8) | p[i];
+   return(v);
+}
+
+
+/*
+   Dictionaries
+*/
+
+/*
+   Function: lookup_dictionary_code()
+   Purpose : finds the code of a string, adding the string if it is new.
+   Input   : dictionary, string (NULL = ""), most strings the dictionary may hold.
+   Output  : the code, FLB_NO_CODE if the string is new and the dictionary is full.
+*/
+static uint32_t lookup_dictionary_code(struct flb_dictionary *dict, char *str, uint32_t max_count)
+{
+   struct flb_dict_entry *entry;
+   size_t len;
+
+   if (str == NULL)
+      str = "";
+   len = strlen(str);
+
+   HASH_FIND(hh, dict->map, str, len, entry);
+   if (entry != NULL)
+      return(entry->code);
+   if (dict->count >= max_count)
+      return(FLB_NO_CODE);
+
+   if (dict->count == dict->capacity)
+   {
+      dict->capacity = (dict->capacity == 0) ? 256 : dict->capacity * 2;
+      dict->strings = (char **)xrealloc(dict->strings, dict->capacity * sizeof(char *));
+   }
+
+   entry = (struct flb_dict_entry *)xcalloc(sizeof(struct flb_dict_entry));
+   entry->str = (char *)xmalloc(len + 1);
+   memcpy(entry->str, str, len + 1);
+   entry->code = dict->count;
+   HASH_ADD_KEYPTR(hh, dict->map, entry->str, len, entry);
+
+   dict->strings[dict->count] = entry->str;
+   dict->count++;
+
+   return(entry->code);
+}
+
+static void free_dictionary(struct flb_dictionary *dict)
+{
+   struct flb_dict_entry *entry, *tmp;
+   uint32_t i;
+
+   if (dict->map != NULL)
+   {
+      HASH_ITER(hh, dict->map, entry, tmp)
+      {
+         HASH_DEL(dict->map, entry);
+         free(entry);
+      }
+   }
+   for (i = 0; i < dict->count; i++)
+      free(dict->strings[i]);
+   free(dict->strings);
+   memset(dict, 0, sizeof(struct flb_dictionary));
+}
+
+
+/*
+   Writer
+*/
+
+static int write_flb_bytes(flb_writer_t *writer, unsigned char *buf, size_t len)
+{
+   if (fwrite(buf, 1, len, writer->file) != len)
+   {
+      print_log_entry("write_flb_bytes() <ERROR> Short write to FLB file.\n");
+      return(-1);
+   }
+   writer->offset += len;
+   return(0);
+}
+
+static unsigned char *get_encode_buffer(flb_writer_t *writer, size_t len)
+{
+   if (len > writer->encode_capacity)
+   {
+      writer->encode_capacity = len;
+      writer->encode_buffer = (unsigned char *)xrealloc(writer->encode_buffer, len);
+   }
+   return(writer->encode_buffer);
+}
+
+/*
+   Function: open_flb_writer()
+   Purpose : creates a .flb file and writes the file header.
+   Input   : file name, source name recorded for events without a source.
+   Output  : writer or NULL on error.
+*/
+flb_writer_t *open_flb_writer(char *file_name, char *source_name)
+{
+   flb_writer_t *writer;
+   unsigned char hdr[FLB_FILE_HEADER_SIZE];
+   FILE *flb_file;
+
+   flb_file = fopen(file_name, "wb");
+   if (flb_file == NULL)
+   {
+      print_log_entry("open_flb_writer() <ERROR> Could not open FLB file.\n");
+      return(NULL);
+   }
+
+   writer = (flb_writer_t *)xcalloc(sizeof(flb_writer_t));
+   writer->file = flb_file;
+   if (source_name == NULL)
+      source_name = "";
+   writer->source_name = (char *)xmalloc(strlen(source_name) + 1);
+   strcpy(writer->source_name, source_name);
+
+   writer->times = (int64_t *)xmalloc(FLB_BLOCK_EVENTS * sizeof(int64_t));
+   writer->event_ids = (uint64_t *)xmalloc(FLB_BLOCK_EVENTS * sizeof(uint64_t));
+   writer->types = (uint16_t *)xmalloc(FLB_BLOCK_EVENTS * sizeof(uint16_t));
+   writer->summaries = (uint32_t *)xmalloc(FLB_BLOCK_EVENTS * sizeof(uint32_t));
+   writer->sources = (uint32_t *)xmalloc(FLB_BLOCK_EVENTS * sizeof(uint32_t));
+   writer->data_offsets = (uint32_t *)xmalloc((FLB_BLOCK_EVENTS + 1) * sizeof(uint32_t));
+   writer->data_capacity = 1048576;
+   writer->data = (char *)xmalloc(writer->data_capacity);
+
+   memcpy(hdr, FLB_FILE_MAGIC, 4);
+   put_u32(hdr + 4, FLB_VERSION);
+   put_u32(hdr + 8, FLB_BLOCK_EVENTS);
+   put_u32(hdr + 12, 0);
+
+   if (write_flb_bytes(writer, hdr, FLB_FILE_HEADER_SIZE) < 0)
+   {
+      fclose(flb_file);
+      writer->file = NULL;
+      close_flb_writer(writer);
+      return(NULL);
+   }
+
+   return(writer);
+}
+
+/*
+   Function: flush_flb_block()
+   Purpose : encodes the current block columns and writes the block.
+   Input   : writer.
+   Output  : 0 on success, -1 on error.
+*/
+static int flush_flb_block(flb_writer_t *writer)
+{
+   uint32_t n = writer->event_count;
+   size_t block_length;
+   unsigned char *buf, *p;
+   uint32_t i;
+   flb_block_index_t *entry;
+
+   if (n == 0)
+      return(0);
+
+   writer->data_offsets[n] = (uint32_t)writer->data_length;
+   block_length = (size_t)n * (8 + 8 + 2 + 4 + 4 + 4) + 4 + writer->data_length;
+   buf = get_encode_buffer(writer, FLB_BLOCK_HEADER_SIZE + block_length);
+
+   put_u32(buf, n);
+   put_u32(buf + 4, (uint32_t)writer->data_length);
+   put_u64(buf + 8, (uint64_t)writer->min_time);
+   put_u64(buf + 16, (uint64_t)writer->max_time);
+   put_u64(buf + 24, (uint64_t)block_length);
+
+   p = buf + FLB_BLOCK_HEADER_SIZE;
+   for (i = 0; i < n; i++, p += 8)
+      put_u64(p, (uint64_t)writer->times[i]);
+   for (i = 0; i < n; i++, p += 8)
+      put_u64(p, writer->event_ids[i]);
+   for (i = 0; i < n; i++, p += 2)
+      put_u16(p, writer->types[i]);
+   for (i = 0; i < n; i++, p += 4)
+      put_u32(p, writer->summaries[i]);
+   for (i = 0; i < n; i++, p += 4)
+      put_u32(p, writer->sources[i]);
+   for (i = 0; i <= n; i++, p += 4)
+      put_u32(p, writer->data_offsets[i]);
+   memcpy(p, writer->data, writer->data_length);
+
+   if (writer->block_count == writer->index_capacity)
+   {
+      writer->index_capacity = (writer->index_capacity == 0) ? 64 : writer->index_capacity * 2;
+      writer->index = (flb_block_index_t *)xrealloc(writer->index, writer->index_capacity * sizeof(flb_block_index_t));
+   }
+   entry = &writer->index[writer->block_count];
+   entry->offset = writer->offset;
+   entry->min_time = writer->min_time;
+   entry->max_time = writer->max_time;
+   entry->event_count = n;
+   writer->block_count++;
+
+   writer->event_count = 0;
+   writer->data_length = 0;
+
+   return(write_flb_bytes(writer, buf, FLB_BLOCK_HEADER_SIZE + block_length));
+}
+
+/*
+   Function: write_flb_event()
+   Purpose : appends one event to the current block.
+   Input   : writer, event time, event id, type, summary, source (NULL =
+             writer source), event data and length.
+   Output  : 0 on success, -1 on error.
+*/
+int write_flb_event(flb_writer_t *writer, int64_t event_time, uint64_t event_id, char *type, char *summary, char *source, char *data, size_t data_length)
+{
+   uint32_t n;
+   uint32_t type_code;
+
+   /* an unknown type must not share the code of another type, so fail before the event is added */
+   type_code = lookup_dictionary_code(&writer->dicts[FLB_TYPE_DICT], type, FLB_MAX_TYPES);
+   if (type_code == FLB_NO_CODE)
+   {
+      print_log_entry("write_flb_event() <ERROR> Too many event types.\n");
+      return(-1);
+   }
+
+   if ((writer->event_count == FLB_BLOCK_EVENTS) || (writer->data_length + data_length + 1 > FLB_BLOCK_DATA_MAX))
+   {
+      if (flush_flb_block(writer) < 0)
+         return(-1);
+   }
+
+   n = writer->event_count;
+   if (n == 0)
+   {
+      writer->min_time = FLB_INVALID_TIME;
+      writer->max_time = FLB_INVALID_TIME;
+   }
+   /* events without a valid time do not widen the block time range */
+   if (event_time != FLB_INVALID_TIME)
+   {
+      if ((writer->min_time == FLB_INVALID_TIME) || (event_time < writer->min_time))
+         writer->min_time = event_time;
+      if ((writer->max_time == FLB_INVALID_TIME) || (event_time > writer->max_time))
+         writer->max_time = event_time;
+   }
+
+   writer->times[n] = event_time;
+   writer->event_ids[n] = event_id;
+   writer->types[n] = (uint16_t)type_code;
+   writer->summaries[n] = lookup_dictionary_code(&writer->dicts[FLB_SUMMARY_DICT], summary, FLB_NO_CODE);
+   writer->sources[n] = lookup_dictionary_code(&writer->dicts[FLB_SOURCE_DICT], source != NULL ? source : writer->source_name, FLB_NO_CODE);
+
+   /* data strings are stored null terminated so readers can use them in place */
+   while (writer->data_length + data_length + 1 > writer->data_capacity)
+   {
+      writer->data_capacity *= 2;
+      writer->data = (char *)xrealloc(writer->data, writer->data_capacity);
+   }
+   writer->data_offsets[n] = (uint32_t)writer->data_length;
+   if (data_length > 0)
+      memcpy(writer->data + writer->data_length, data, data_length);
+   writer->data[writer->data_length + data_length] = '\0';
+   writer->data_length += data_length + 1;
+
+   writer->event_count++;
+   writer->total_events++;
+
+   return(0);
+}
+
+/*
+   Finds the next tag value after the cursor and terminates it in place,
+   the cursor moves past the closing tag so the tags must be requested in
+   record order.
+*/
+static char *get_tag_value(char **cursor, char *open_tag, char *close_tag)
+{
+   char *start, *end;
+
+   start = strstr(*cursor, open_tag);
+   if (start == NULL)
+      return(NULL);
+   start += strlen(open_tag);
+   end = strstr(start, close_tag);
+   if (end == NULL)
+      return(NULL);
+   *end = '\0';
+   *cursor = end + strlen(close_tag);
+
+   return(start);
+}
+
+/*
+   Function: write_flb_record_string()
+   Purpose : parses one serialised .fle event record and appends it, lines
+             that are not event records (the project header) are skipped.
+   Input   : writer, record, record length.
+   Output  : 0 on success, 1 if skipped, -1 on error.
+*/
+int write_flb_record_string(flb_writer_t *writer, char *record, size_t record_length)
+{
+   char *line, *cursor, *id_str, *time_str, *type_str, *summary_str, *data_str, *p;
+   uint64_t event_id = 0;
+   int64_t event_time;
+
+   if ((record_length < 7) || (strncmp(record, "<event>", 7) != 0))
+      return(1);
+
+   if (record_length + 1 > writer->line_capacity)
+   {
+      writer->line_capacity = record_length + 1;
+      writer->line_buffer = (char *)xrealloc(writer->line_buffer, writer->line_capacity);
+   }
+   line = writer->line_buffer;
+   memcpy(line, record, record_length);
+   line[record_length] = '\0';
+
+   cursor = line;
+   id_str = get_tag_value(&cursor, "<id>", "</id>");
+   time_str = get_tag_value(&cursor, "<time>", "</time>");
+   type_str = get_tag_value(&cursor, "<type>", "</type>");
+   summary_str = get_tag_value(&cursor, "<summary>", "</summary>");
+   data_str = get_tag_value(&cursor, "<data>", "</data>");
+
+   if (time_str == NULL)
+   {
+      print_log_entry("write_flb_record_string() <ERROR> Event record has no time.\n");
+      return(-1);
+   }
+   event_time = parse_fle_time(time_str);
+
+   if (id_str != NULL)
+   {
+      for (p = id_str; isdigit((unsigned char)*p); p++)
+         event_id = event_id * 10 + (uint64_t)(*p - '0');
+   }
+
+   return(write_flb_event(writer, event_time, event_id, type_str, summary_str, NULL, data_str, (data_str != NULL) ? strlen(data_str) : 0));
+}
+
+/*
+   Function: set_flb_writer_source()
+   Purpose : changes the source recorded for the following events that
+             do not have their own source.
+   Input   : writer, source name.
+   Output  : 0 on success.
+*/
+int set_flb_writer_source(flb_writer_t *writer, char *source_name)
+{
+   if (source_name == NULL)
+      source_name = "";
+   free(writer->source_name);
+   writer->source_name = (char *)xmalloc(strlen(source_name) + 1);
+   strcpy(writer->source_name, source_name);
+
+   return(0);
+}
+
+uint64_t get_flb_writer_event_count(flb_writer_t *writer)
+{
+   return(writer->total_events);
+}
+
+static int write_flb_dictionary(flb_writer_t *writer, struct flb_dictionary *dict)
+{
+   unsigned char buf[4];
+   uint32_t i, len;
+
+   put_u32(buf, dict->count);
+   if (write_flb_bytes(writer, buf, 4) < 0)
+      return(-1);
+
+   for (i = 0; i < dict->count; i++)
+   {
+      len = (uint32_t)strlen(dict->strings[i]);
+      put_u32(buf, len);
+      if ((write_flb_bytes(writer, buf, 4) < 0) || (write_flb_bytes(writer, (unsigned char *)dict->strings[i], len) < 0))
+         return(-1);
+   }
+
+   return(0);
+}
+
+/*
+   Function: close_flb_writer()
+   Purpose : writes the last block, the dictionaries, the block index and
+             the trailer, then closes the file and frees the writer.
+   Input   : writer.
+   Output  : 0 on success, -1 on error.
+*/
+int close_flb_writer(flb_writer_t *writer)
+{
+   int result = 0;
+   int d;
+   uint32_t i;
+   uint64_t dict_offset, index_offset;
+   unsigned char *buf;
+   unsigned char trailer[FLB_TRAILER_SIZE];
+
+   if (writer->file != NULL)
+   {
+      if (flush_flb_block(writer) < 0)
+         result = -1;
+
+      dict_offset = writer->offset;
+      for (d = 0; d < FLB_DICT_COUNT; d++)
+      {
+         if (write_flb_dictionary(writer, &writer->dicts[d]) < 0)
+            result = -1;
+      }
+
+      index_offset = writer->offset;
+      buf = get_encode_buffer(writer, (size_t)writer->block_count * FLB_INDEX_ENTRY_SIZE + 1);
+      for (i = 0; i < writer->block_count; i++)
+      {
+         unsigned char *p = buf + (size_t)i * FLB_INDEX_ENTRY_SIZE;
+         put_u64(p, writer->index[i].offset);
+         put_u64(p + 8, (uint64_t)writer->index[i].min_time);
+         put_u64(p + 16, (uint64_t)writer->index[i].max_time);
+         put_u32(p + 24, writer->index[i].event_count);
+         put_u32(p + 28, 0);
+      }
+      if (write_flb_bytes(writer, buf, (size_t)writer->block_count * FLB_INDEX_ENTRY_SIZE) < 0)
+         result = -1;
+
+      put_u64(trailer, dict_offset);
+      put_u64(trailer + 8, index_offset);
+      put_u64(trailer + 16, writer->total_events);
+      put_u32(trailer + 24, writer->block_count);
+      put_u32(trailer + 28, 0);
+      memcpy(trailer + 32, FLB_TRAILER_MAGIC, 4);
+      put_u32(trailer + 36, FLB_VERSION);
+      if (write_flb_bytes(writer, trailer, FLB_TRAILER_SIZE) < 0)
+         result = -1;
+
+      if (fclose(writer->file) != 0)
+         result = -1;
+   }
+
+   for (d = 0; d < FLB_DICT_COUNT; d++)
+      free_dictionary(&writer->dicts[d]);
+   free(writer->source_name);
+   free(writer->times);
+   free(writer->event_ids);
+   free(writer->types);
+   free(writer->summaries);
+   free(writer->sources);
+   free(writer->data_offsets);
+   free(writer->data);
+   free(writer->encode_buffer);
+   free(writer->line_buffer);
+   free(writer->index);
+   free(writer);
+
+   return(result);
+}
+
+
+/*
+   Reader
+*/
+
+static int read_flb_bytes(flb_reader_t *reader, unsigned char *buf, size_t len)
+{
+   if (fread(buf, 1, len, reader->file) != len)
+   {
+      print_log_entry("read_flb_bytes() <ERROR> Short read from FLB file.\n");
+      return(-1);
+   }
+   return(0);
+}
+
+/*
+   Function: read_flb_dictionary()
+   Purpose : reads one dictionary, the stored counts and lengths are checked
+             before anything is allocated so a corrupt file cannot index past
+             the string table.
+   Input   : reader, dictionary, most strings the dictionary may hold and the
+             bytes between the dictionaries and the block index.
+   Output  : 0 on success, -1 on error.
+*/
+static int read_flb_dictionary(flb_reader_t *reader, struct flb_dictionary *dict, uint32_t max_count, uint64_t max_bytes)
+{
+   unsigned char buf[4];
+   uint32_t i, len;
+
+   if (read_flb_bytes(reader, buf, 4) < 0)
+      return(-1);
+   dict->count = 0;
+   dict->capacity = get_u32(buf);
+   if ((dict->capacity > max_count) || ((uint64_t)dict->capacity * 4 > max_bytes))
+   {
+      print_log_entry("read_flb_dictionary() <ERROR> FLB dictionary size is corrupt.\n");
+      dict->capacity = 0;
+      return(-1);
+   }
+   dict->strings = (char **)xcalloc(((size_t)dict->capacity + 1) * sizeof(char *));
+
+   for (i = 0; i < dict->capacity; i++)
+   {
+      if (read_flb_bytes(reader, buf, 4) < 0)
+         return(-1);
+      len = get_u32(buf);
+      if (len > max_bytes)
+      {
+         print_log_entry("read_flb_dictionary() <ERROR> FLB dictionary string length is corrupt.\n");
+         return(-1);
+      }
+      dict->strings[i] = (char *)xmalloc((size_t)len + 1);
+      dict->count++;
+      if (read_flb_bytes(reader, (unsigned char *)dict->strings[i], len) < 0)
+         return(-1);
+      dict->strings[i][len] = '\0';
+   }
+
+   return(0);
+}
+
+/*
+   Function: open_flb_reader()
+   Purpose : opens a .flb file and loads the trailer, dictionaries and the
+             block index, no event blocks are read. The trailer offsets and
+             block count and the block offsets are checked against the file
+             size before they are used.
+   Input   : file name.
+   Output  : reader or NULL on error.
+*/
+flb_reader_t *open_flb_reader(char *file_name)
+{
+   flb_reader_t *reader;
+   unsigned char hdr[FLB_FILE_HEADER_SIZE];
+   unsigned char trailer[FLB_TRAILER_SIZE];
+   unsigned char *buf;
+   uint64_t dict_offset, index_offset, dict_bytes;
+   int64_t file_size;
+   uint32_t i;
+   int d;
+   FILE *flb_file;
+
+   flb_file = fopen(file_name, "rb");
+   if (flb_file == NULL)
+   {
+      print_log_entry("open_flb_reader() <ERROR> Could not open FLB file.\n");
+      return(NULL);
+   }
+
+   reader = (flb_reader_t *)xcalloc(sizeof(flb_reader_t));
+   reader->file = flb_file;
+   reader->block_number = -1;
+
+   if ((read_flb_bytes(reader, hdr, FLB_FILE_HEADER_SIZE) < 0) || (memcmp(hdr, FLB_FILE_MAGIC, 4) != 0) || (get_u32(hdr + 4) != FLB_VERSION))
+   {
+      print_log_entry("open_flb_reader() <ERROR> Not a FLB file.\n");
+      close_flb_reader(reader);
+      return(NULL);
+   }
+
+   if ((flb_fseek(flb_file, 0, SEEK_END) != 0) || ((file_size = flb_ftell(flb_file)) < FLB_FILE_HEADER_SIZE + FLB_TRAILER_SIZE) ||
+       (flb_fseek(flb_file, -FLB_TRAILER_SIZE, SEEK_END) != 0) || (read_flb_bytes(reader, trailer, FLB_TRAILER_SIZE) < 0) ||
+       (memcmp(trailer + 32, FLB_TRAILER_MAGIC, 4) != 0))
+   {
+      print_log_entry("open_flb_reader() <ERROR> FLB trailer is missing or corrupt.\n");
+      close_flb_reader(reader);
+      return(NULL);
+   }
+   dict_offset = get_u64(trailer);
+   index_offset = get_u64(trailer + 8);
+   reader->total_events = get_u64(trailer + 16);
+   reader->block_count = get_u32(trailer + 24);
+
+   /* the block index sits between the dictionaries and the trailer */
+   if ((dict_offset < FLB_FILE_HEADER_SIZE) || (index_offset < dict_offset) || (index_offset > (uint64_t)file_size - FLB_TRAILER_SIZE) ||
+       ((uint64_t)reader->block_count * FLB_INDEX_ENTRY_SIZE != (uint64_t)file_size - FLB_TRAILER_SIZE - index_offset))
+   {
+      print_log_entry("open_flb_reader() <ERROR> FLB trailer is corrupt.\n");
+      reader->block_count = 0;
+      close_flb_reader(reader);
+      return(NULL);
+   }
+   reader->dict_offset = dict_offset;
+
+   if (flb_fseek(flb_file, dict_offset, SEEK_SET) != 0)
+   {
+      close_flb_reader(reader);
+      return(NULL);
+   }
+   dict_bytes = (index_offset > dict_offset) ? index_offset - dict_offset : 0;
+   for (d = 0; d < FLB_DICT_COUNT; d++)
+   {
+      if (read_flb_dictionary(reader, &reader->dicts[d], (d == FLB_TYPE_DICT) ? FLB_MAX_TYPES : FLB_NO_CODE, dict_bytes) < 0)
+      {
+         print_log_entry("open_flb_reader() <ERROR> Could not read FLB dictionaries.\n");
+         close_flb_reader(reader);
+         return(NULL);
+      }
+   }
+
+   reader->index = (flb_block_index_t *)xcalloc((reader->block_count + 1) * sizeof(flb_block_index_t));
+   buf = (unsigned char *)xmalloc((size_t)reader->block_count * FLB_INDEX_ENTRY_SIZE + 1);
+   if ((flb_fseek(flb_file, index_offset, SEEK_SET) != 0) || (read_flb_bytes(reader, buf, (size_t)reader->block_count * FLB_INDEX_ENTRY_SIZE) < 0))
+   {
+      print_log_entry("open_flb_reader() <ERROR> Could not read FLB block index.\n");
+      free(buf);
+      close_flb_reader(reader);
+      return(NULL);
+   }
+   for (i = 0; i < reader->block_count; i++)
+   {
+      unsigned char *p = buf + (size_t)i * FLB_INDEX_ENTRY_SIZE;
+      reader->index[i].offset = get_u64(p);
+      reader->index[i].min_time = (int64_t)get_u64(p + 8);
+      reader->index[i].max_time = (int64_t)get_u64(p + 16);
+      reader->index[i].event_count = get_u32(p + 24);
+      if ((reader->index[i].offset < FLB_FILE_HEADER_SIZE) || (reader->index[i].offset > dict_offset) ||
+          (dict_offset - reader->index[i].offset < FLB_BLOCK_HEADER_SIZE) || (reader->index[i].event_count > FLB_BLOCK_EVENTS))
+      {
+         print_log_entry("open_flb_reader() <ERROR> FLB block index is corrupt.\n");
+         free(buf);
+         close_flb_reader(reader);
+         return(NULL);
+      }
+   }
+   free(buf);
+
+   return(reader);
+}
+
+uint32_t get_flb_block_count(flb_reader_t *reader)
+{
+   return(reader->block_count);
+}
+
+uint64_t get_flb_event_count(flb_reader_t *reader)
+{
+   return(reader->total_events);
+}
+
+flb_block_index_t *get_flb_block_index(flb_reader_t *reader, uint32_t block_number)
+{
+   if (block_number >= reader->block_count)
+      return(NULL);
+   return(&reader->index[block_number]);
+}
+
+char *get_flb_string(flb_reader_t *reader, int dictionary, uint32_t code)
+{
+   if ((dictionary < 0) || (dictionary >= FLB_DICT_COUNT) || (code >= reader->dicts[dictionary].count))
+      return("");
+   return(reader->dicts[dictionary].strings[code]);
+}
+
+/*
+   Function: read_flb_block()
+   Purpose : reads and decodes one block, the block stays valid until the
+             next call or until the reader is closed. The block must end
+             before the dictionaries and every data offset must be inside
+             the data column with the data null terminated.
+   Input   : reader, block number.
+   Output  : decoded block or NULL on error.
+*/
+flb_block_t *read_flb_block(flb_reader_t *reader, uint32_t block_number)
+{
+   unsigned char hdr[FLB_BLOCK_HEADER_SIZE];
+   unsigned char *p;
+   flb_block_t *blk = &reader->block;
+   uint32_t n, i, data_length;
+   uint64_t block_length;
+
+   if (block_number >= reader->block_count)
+      return(NULL);
+   if (reader->block_number == (int64_t)block_number)
+      return(blk);
+   reader->block_number = -1;   /* the read buffer is reused, the old block is not valid past here */
+
+   if ((flb_fseek(reader->file, reader->index[block_number].offset, SEEK_SET) != 0) || (read_flb_bytes(reader, hdr, FLB_BLOCK_HEADER_SIZE) < 0))
+      return(NULL);
+
+   n = get_u32(hdr);
+   data_length = get_u32(hdr + 4);
+   block_length = get_u64(hdr + 24);
+   if ((n > FLB_BLOCK_EVENTS) || (block_length != (uint64_t)n * 30 + 4 + data_length) ||
+       (block_length > reader->dict_offset - FLB_BLOCK_HEADER_SIZE - reader->index[block_number].offset))
+   {
+      print_log_entry("read_flb_block() <ERROR> Corrupt FLB block header.\n");
+      return(NULL);
+   }
+
+   if (block_length > reader->read_capacity)
+   {
+      reader->read_capacity = (size_t)block_length;
+      reader->read_buffer = (unsigned char *)xrealloc(reader->read_buffer, reader->read_capacity);
+   }
+   if (read_flb_bytes(reader, reader->read_buffer, (size_t)block_length) < 0)
+      return(NULL);
+
+   if (n > blk->capacity)
+   {
+      blk->capacity = n;
+      blk->times = (int64_t *)xrealloc(blk->times, n * sizeof(int64_t));
+      blk->event_ids = (uint64_t *)xrealloc(blk->event_ids, n * sizeof(uint64_t));
+      blk->types = (uint16_t *)xrealloc(blk->types, n * sizeof(uint16_t));
+      blk->summaries = (uint32_t *)xrealloc(blk->summaries, n * sizeof(uint32_t));
+      blk->sources = (uint32_t *)xrealloc(blk->sources, n * sizeof(uint32_t));
+      blk->data_offsets = (uint32_t *)xrealloc(blk->data_offsets, (n + 1) * sizeof(uint32_t));
+   }
+
+   p = reader->read_buffer;
+   for (i = 0; i < n; i++, p += 8)
+      blk->times[i] = (int64_t)get_u64(p);
+   for (i = 0; i < n; i++, p += 8)
+      blk->event_ids[i] = get_u64(p);
+   for (i = 0; i < n; i++, p += 2)
+      blk->types[i] = get_u16(p);
+   for (i = 0; i < n; i++, p += 4)
+      blk->summaries[i] = get_u32(p);
+   for (i = 0; i < n; i++, p += 4)
+      blk->sources[i] = get_u32(p);
+   for (i = 0; i <= n; i++, p += 4)
+      blk->data_offsets[i] = get_u32(p);
+   blk->data = (char *)p;   /* data column is used in place from the read buffer */
+
+   /* each data string is at least its terminator, so the offsets must increase */
+   for (i = 0; i < n; i++)
+   {
+      if ((blk->data_offsets[i] >= blk->data_offsets[i + 1]) || (blk->data_offsets[i + 1] > data_length) ||
+          (blk->data[blk->data_offsets[i + 1] - 1] != '\0'))
+      {
+         print_log_entry("read_flb_block() <ERROR> Corrupt FLB data offsets.\n");
+         return(NULL);
+      }
+   }
+
+   blk->event_count = n;
+   blk->min_time = (int64_t)get_u64(hdr + 8);
+   blk->max_time = (int64_t)get_u64(hdr + 16);
+   reader->block_number = block_number;
+
+   return(blk);
+}
+
+/*
+   Function: get_flb_event()
+   Purpose : fills an event row from a decoded block.
+   Input   : reader, block, row number, event.
+   Output  : 0 on success, -1 if the row is out of range.
+*/
+int get_flb_event(flb_reader_t *reader, flb_block_t *block, uint32_t row, flb_event_t *event)
+{
+   if (row >= block->event_count)
+      return(-1);
+
+   event->event_time = block->times[row];
+   event->event_id = block->event_ids[row];
+   event->type = get_flb_string(reader, FLB_TYPE_DICT, block->types[row]);
+   event->summary = get_flb_string(reader, FLB_SUMMARY_DICT, block->summaries[row]);
+   event->source = get_flb_string(reader, FLB_SOURCE_DICT, block->sources[row]);
+   event->data = block->data + block->data_offsets[row];
+   event->data_length = block->data_offsets[row + 1] - block->data_offsets[row] - 1;
+
+   return(0);
+}
+
+/*
+   Function: query_flb_time_range()
+   Purpose : calls the callback for every event in [start_time, end_time],
+             blocks whose min/max time does not overlap the range are
+             skipped using the block index without being read.
+   Input   : reader, start and end time, callback, callback data.
+   Output  : number of matching events, -1 on error.
+*/
+int64_t query_flb_time_range(flb_reader_t *reader, int64_t start_time, int64_t end_time, flb_event_callback callback, void *user_data)
+{
+   uint32_t b, row;
+   int64_t matched = 0;
+   flb_block_t *blk;
+   flb_event_t event;
+
+   for (b = 0; b < reader->block_count; b++)
+   {
+      if ((reader->index[b].max_time < start_time) || (reader->index[b].min_time > end_time))
+         continue;
+
+      blk = read_flb_block(reader, b);
+      if (blk == NULL)
+         return(-1);
+
+      for (row = 0; row < blk->event_count; row++)
+      {
+         if ((blk->times[row] < start_time) || (blk->times[row] > end_time))
+            continue;
+         matched++;
+         if (callback != NULL)
+         {
+            get_flb_event(reader, blk, row, &event);
+            if (callback(&event, user_data) != 0)
+               return(matched);
+         }
+      }
+   }
+
+   return(matched);
+}
+
+/*
+   Function: close_flb_reader()
+   Purpose : closes the file and frees the reader.
+   Input   : reader.
+   Output  : 0 on success.
+*/
+int close_flb_reader(flb_reader_t *reader)
+{
+   int d;
+
+   if (reader->file != NULL)
+      fclose(reader->file);
+   for (d = 0; d < FLB_DICT_COUNT; d++)
+      free_dictionary(&reader->dicts[d]);
+   free(reader->index);
+   free(reader->read_buffer);
+   free(reader->block.times);
+   free(reader->block.event_ids);
+   free(reader->block.types);
+   free(reader->block.summaries);
+   free(reader->block.sources);
+   free(reader->block.data_offsets);
+   free(reader);
+
+   return(0);
+}
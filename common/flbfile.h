@@ -0,0 +1,147 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   flbfile.h
+
+   Title : FineLine Computer Forensics Utilities
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: FineLine binary timeline file (.flb) definitions.
+
+            The .flb file is a columnar store of event records:
+
+            [file header]
+            [block 0] ... [block n]
+            [dictionaries: type, summary, source]
+            [block index]
+            [trailer]
+
+            Each block holds up to FLB_BLOCK_EVENTS events as columns of
+            int64 times, uint64 event ids, uint16 type codes, uint32
+            summary and source dictionary codes and a variable length data
+            column. The block header and the block index carry the min/max
+            event time of each block so a time range query only reads the
+            blocks that overlap the range. All integers are little endian.
+
+   Notes: Event times are seconds since 01/01/1970 UTC.
+
+*/
+
+#ifndef FINELINE_FLB_FILE_H
+#define FINELINE_FLB_FILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fltime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLB_FILE_EXT            ".flb"
+#define FLB_FILE_MAGIC          "FLB1"
+#define FLB_TRAILER_MAGIC       "FLBI"
+#define FLB_VERSION             1
+#define FLB_BLOCK_EVENTS        65536
+#define FLB_BLOCK_DATA_MAX      8388608   /* flush a block early if the data column reaches 8MB */
+#define FLB_MAX_TYPES           65535     /* type codes 0 to 65534, more event types than this are an error */
+#define FLB_FILE_HEADER_SIZE    16
+#define FLB_BLOCK_HEADER_SIZE   32
+#define FLB_INDEX_ENTRY_SIZE    32
+#define FLB_TRAILER_SIZE        40
+#define FLB_INVALID_TIME        FLE_INVALID_TIME
+
+enum FLB_DICTIONARIES { FLB_TYPE_DICT, FLB_SUMMARY_DICT, FLB_SOURCE_DICT, FLB_DICT_COUNT };
+
+/* one entry of the footer block index */
+struct flb_block_index
+{
+   uint64_t offset;
+   int64_t min_time;
+   int64_t max_time;
+   uint32_t event_count;
+};
+typedef struct flb_block_index flb_block_index_t;
+
+/* a decoded block, the column arrays are owned by the reader */
+struct flb_block
+{
+   uint32_t event_count;
+   int64_t min_time;
+   int64_t max_time;
+   int64_t *times;
+   uint64_t *event_ids;
+   uint16_t *types;
+   uint32_t *summaries;
+   uint32_t *sources;
+   uint32_t *data_offsets;   /* event_count + 1 offsets into data */
+   char *data;
+   uint32_t capacity;
+   uint32_t data_capacity;
+};
+typedef struct flb_block flb_block_t;
+
+/* a single event row handed to query callbacks */
+struct flb_event
+{
+   int64_t event_time;
+   uint64_t event_id;
+   char *type;
+   char *summary;
+   char *source;
+   char *data;
+   uint32_t data_length;
+};
+typedef struct flb_event flb_event_t;
+
+typedef struct flb_writer flb_writer_t;
+typedef struct flb_reader flb_reader_t;
+
+/* return non-zero from the callback to stop the query */
+typedef int (*flb_event_callback)(flb_event_t *event, void *user_data);
+
+
+/* flbfile.c */
+
+flb_writer_t *open_flb_writer(char *file_name, char *source_name);
+int write_flb_event(flb_writer_t *writer, int64_t event_time, uint64_t event_id, char *type, char *summary, char *source, char *data, size_t data_length);
+int write_flb_record_string(flb_writer_t *writer, char *record, size_t record_length);
+int set_flb_writer_source(flb_writer_t *writer, char *source_name);
+uint64_t get_flb_writer_event_count(flb_writer_t *writer);
+int close_flb_writer(flb_writer_t *writer);
+
+flb_reader_t *open_flb_reader(char *file_name);
+uint32_t get_flb_block_count(flb_reader_t *reader);
+uint64_t get_flb_event_count(flb_reader_t *reader);
+flb_block_index_t *get_flb_block_index(flb_reader_t *reader, uint32_t block_number);
+char *get_flb_string(flb_reader_t *reader, int dictionary, uint32_t code);
+flb_block_t *read_flb_block(flb_reader_t *reader, uint32_t block_number);
+int get_flb_event(flb_reader_t *reader, flb_block_t *block, uint32_t row, flb_event_t *event);
+int64_t query_flb_time_range(flb_reader_t *reader, int64_t start_time, int64_t end_time, flb_event_callback callback, void *user_data);
+int close_flb_reader(flb_reader_t *reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -55,6 +55,7 @@
 #define FL_FILTER_ON      0x10
 #define FL_UNIFIED2_INPUT 0x20
 #define FL_CAPTURE_INPUT  0x40
+#define FL_FLB_OUT        0x80
 
 #define FL_FILE_ACCESS_TIME   0x01
 #define FL_FILE_CREATION_TIME 0x02
@@ -133,6 +134,7 @@ char *trim(char *s);
 
 int init_socket(char *gui_ip_address);
 int send_event(char *event_string);
+int send_event_block(char *event_block, int block_len);
 char *get_response();
 int close_socket();
 
@@ -0,0 +1,399 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   flsink.c
+
+   Title : FineLine Computer Forensics Utilities
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: FineLine output sinks. Event records are serialised once by
+            the hashmap traversal and fanned out to every registered sink.
+            The file and socket sinks buffer records in a 1MB page aligned
+            block and write whole blocks, the binary timeline sink hands
+            each record to the .flb writer.
+
+   Notes: The .flb sink needs flbfile.c.
+
+*/
+
+#if defined(LINUX_BUILD) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef LINUX_BUILD
+#include <malloc.h>
+#endif
+
+#include "flcommon.h"
+#include "flsink.h"
+#include "flbfile.h"
+
+
+/*
+   Function: alloc_sink_buffer()
+   Purpose : allocates a page aligned block buffer for a sink.
+   Input   : buffer size.
+   Output  : pointer to the buffer, NULL on failure.
+*/
+static char *alloc_sink_buffer(size_t buffer_size)
+{
+   void *buf = NULL;
+
+#ifdef LINUX_BUILD
+   if (posix_memalign(&buf, FL_SINK_BUFFER_ALIGN, buffer_size) != 0)
+      buf = NULL;
+#else
+   buf = _aligned_malloc(buffer_size, FL_SINK_BUFFER_ALIGN);
+#endif
+
+   return((char *)buf);
+}
+
+static void free_sink_buffer(char *buf)
+{
+   if (buf == NULL)
+      return;
+#ifdef LINUX_BUILD
+   free(buf);
+#else
+   _aligned_free(buf);
+#endif
+}
+
+/*
+   Function: new_sink()
+   Purpose : allocates a sink and its block buffer and adds it to the list.
+   Input   : sink list, sink type, buffer size (0 = default).
+   Output  : pointer to the new sink, NULL on failure.
+*/
+static fl_sink_t *new_sink(fl_sink_list_t *sink_list, int sink_type, size_t buffer_size)
+{
+   fl_sink_t *sink;
+
+   if (sink_list->sink_count >= FL_MAX_SINKS)
+   {
+      print_log_entry("new_sink() <ERROR> Too many output sinks.\n");
+      return(NULL);
+   }
+
+   if (buffer_size == 0)
+      buffer_size = FL_SINK_BUFFER_SIZE;
+
+   sink = (fl_sink_t *)xcalloc(sizeof(fl_sink_t));
+   sink->buffer = alloc_sink_buffer(buffer_size);
+   if (sink->buffer == NULL)
+   {
+      print_log_entry("new_sink() <ERROR> Could not allocate sink buffer.\n");
+      xfree((char *)sink, sizeof(fl_sink_t));
+      return(NULL);
+   }
+   sink->sink_type = sink_type;
+   sink->buffer_size = buffer_size;
+
+   sink_list->sinks[sink_list->sink_count] = sink;
+   sink_list->sink_count++;
+
+   return(sink);
+}
+
+
+/*
+   File Sink
+*/
+
+static int file_write_block(fl_sink_t *sink, char *block, size_t block_len)
+{
+   if (fwrite(block, 1, block_len, (FILE *)sink->handle) != block_len)
+   {
+      print_log_entry("file_write_block() <ERROR> Short write to event file.\n");
+      return(-1);
+   }
+   return(0);
+}
+
+static int file_close_sink(fl_sink_t *sink)
+{
+   fflush((FILE *)sink->handle);
+   return(0);
+}
+
+/*
+   Function: add_file_sink()
+   Purpose : adds a block buffered sink for an open event file.
+   Input   : sink list, open event file, buffer size (0 = default).
+   Output  : 0 on success, -1 on error.
+*/
+int add_file_sink(fl_sink_list_t *sink_list, FILE *out_file, size_t buffer_size)
+{
+   fl_sink_t *sink;
+
+   if (out_file == NULL)
+      return(-1);
+
+   sink = new_sink(sink_list, FL_SINK_FILE, buffer_size);
+   if (sink == NULL)
+      return(-1);
+
+   sink->handle = out_file;
+   sink->write_block = file_write_block;
+   sink->close_sink = file_close_sink;
+
+   return(0);
+}
+
+
+/*
+   Socket Sink
+*/
+
+static int socket_write_block(fl_sink_t *sink, char *block, size_t block_len)
+{
+   if (send_event_block(block, (int)block_len) < 0)
+      return(-1);
+   return(0);
+}
+
+/*
+   Function: add_socket_sink()
+   Purpose : adds a block buffered sink for the GUI socket, the socket
+             must already be connected with init_socket().
+   Input   : sink list, buffer size (0 = default).
+   Output  : 0 on success, -1 on error.
+*/
+int add_socket_sink(fl_sink_list_t *sink_list, size_t buffer_size)
+{
+   fl_sink_t *sink;
+
+   sink = new_sink(sink_list, FL_SINK_SOCKET, buffer_size);
+   if (sink == NULL)
+      return(-1);
+
+   sink->write_block = socket_write_block;
+   sink->close_sink = NULL;
+
+   return(0);
+}
+
+
+/*
+   Binary Timeline Sink
+*/
+
+/*
+   Function: flb_write_record()
+   Purpose : hands one event record to the .flb writer, the record is not
+             buffered so event data containing newlines stays in one event.
+   Input   : sink, record, record length.
+   Output  : 0 on success, -1 on error.
+*/
+static int flb_write_record(fl_sink_t *sink, char *record, size_t record_len)
+{
+   while ((record_len > 0) && ((record[record_len - 1] == '\n') || (record[record_len - 1] == '\r')))
+      record_len--;
+
+   if (write_flb_record_string((flb_writer_t *)sink->handle, record, record_len) < 0)
+      return(-1);
+
+   return(0);
+}
+
+static int flb_close_sink(fl_sink_t *sink)
+{
+   return(close_flb_writer((flb_writer_t *)sink->handle));
+}
+
+/*
+   Function: add_flb_sink()
+   Purpose : creates a binary timeline file (.flb) and adds a sink that
+             converts the event records into its columnar format. The
+             writer keeps its own blocks so records are passed straight
+             through to it.
+   Input   : sink list, .flb file name, name of the evidence source.
+   Output  : 0 on success, -1 on error.
+*/
+int add_flb_sink(fl_sink_list_t *sink_list, char *file_name, char *source_name)
+{
+   fl_sink_t *sink;
+   flb_writer_t *writer;
+
+   writer = open_flb_writer(file_name, source_name);
+   if (writer == NULL)
+      return(-1);
+
+   sink = new_sink(sink_list, FL_SINK_FLB, FL_SINK_BUFFER_ALIGN);
+   if (sink == NULL)
+   {
+      close_flb_writer(writer);
+      return(-1);
+   }
+
+   sink->handle = writer;
+   sink->write_block = NULL;
+   sink->write_record = flb_write_record;
+   sink->close_sink = flb_close_sink;
+
+   return(0);
+}
+
+
+/*
+   Sink List
+*/
+
+/*
+   Function: init_sink_list()
+   Purpose : clears a sink list before sinks are added.
+   Input   : sink list.
+   Output  : 0 on success.
+*/
+int init_sink_list(fl_sink_list_t *sink_list)
+{
+   memset(sink_list, 0, sizeof(fl_sink_list_t));
+   return(0);
+}
+
+static int flush_sink(fl_sink_t *sink)
+{
+   int result = 0;
+
+   if (sink->buffer_used > 0)
+   {
+      result = sink->write_block(sink, sink->buffer, sink->buffer_used);
+      sink->bytes_written += sink->buffer_used;
+      sink->buffer_used = 0;
+   }
+
+   return(result);
+}
+
+/*
+   Function: write_sink_record()
+   Purpose : copies one serialised event record into every sink, a sink
+             writes its block when the next record would overflow it.
+             Records larger than the block are written through directly,
+             record sinks get every record as it is written.
+   Input   : sink list, record, record length.
+   Output  : 0 on success, -1 if any sink failed.
+*/
+int write_sink_record(fl_sink_list_t *sink_list, char *record, size_t record_len)
+{
+   int i;
+   int result = 0;
+   fl_sink_t *sink;
+
+   for (i = 0; i < sink_list->sink_count; i++)
+   {
+      sink = sink_list->sinks[i];
+
+      if (sink->write_record != NULL)
+      {
+         if (sink->write_record(sink, record, record_len) < 0)
+            result = -1;
+         sink->bytes_written += record_len;
+         sink->record_count++;
+         continue;
+      }
+
+      if (sink->buffer_used + record_len > sink->buffer_size)
+      {
+         if (flush_sink(sink) < 0)
+            result = -1;
+      }
+
+      if (record_len > sink->buffer_size)
+      {
+         if (sink->write_block(sink, record, record_len) < 0)
+            result = -1;
+         sink->bytes_written += record_len;
+      }
+      else
+      {
+         memcpy(sink->buffer + sink->buffer_used, record, record_len);
+         sink->buffer_used += record_len;
+      }
+
+      sink->record_count++;
+   }
+
+   return(result);
+}
+
+/*
+   Function: write_sink_string()
+   Purpose : writes a null terminated event record to every sink.
+   Input   : sink list, record string.
+   Output  : 0 on success, -1 if any sink failed.
+*/
+int write_sink_string(fl_sink_list_t *sink_list, char *record)
+{
+   return(write_sink_record(sink_list, record, strlen(record)));
+}
+
+/*
+   Function: flush_sinks()
+   Purpose : writes out the partially filled block of every sink.
+   Input   : sink list.
+   Output  : 0 on success, -1 if any sink failed.
+*/
+int flush_sinks(fl_sink_list_t *sink_list)
+{
+   int i;
+   int result = 0;
+
+   for (i = 0; i < sink_list->sink_count; i++)
+   {
+      if (flush_sink(sink_list->sinks[i]) < 0)
+         result = -1;
+   }
+
+   return(result);
+}
+
+/*
+   Function: close_sinks()
+   Purpose : flushes and releases every sink in the list.
+   Input   : sink list.
+   Output  : 0 on success, -1 if any sink failed.
+*/
+int close_sinks(fl_sink_list_t *sink_list)
+{
+   int i;
+   int result;
+   fl_sink_t *sink;
+
+   result = flush_sinks(sink_list);
+
+   for (i = 0; i < sink_list->sink_count; i++)
+   {
+      sink = sink_list->sinks[i];
+      if (sink->close_sink != NULL)
+         sink->close_sink(sink);
+      free_sink_buffer(sink->buffer);
+      xfree((char *)sink, sizeof(fl_sink_t));
+      sink_list->sinks[i] = NULL;
+   }
+   sink_list->sink_count = 0;
+
+   return(result);
+}
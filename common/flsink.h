@@ -0,0 +1,86 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   flsink.h
+
+   Title : FineLine Computer Forensics Utilities
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: FineLine output sink definitions. The parsers serialise each
+            event record once and hand it to a sink list, every sink in
+            the list copies the record into its own large aligned buffer
+            and writes whole blocks to the file, socket or binary timeline
+            (.flb) file.
+
+   Notes: The file and socket sinks do not own their handles, the caller
+          still opens and closes the event file and the GUI socket.
+
+*/
+
+#ifndef FINELINE_SINK_H
+#define FINELINE_SINK_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+
+#define FL_MAX_SINKS           8
+#define FL_SINK_BUFFER_SIZE    1048576    /* 1MB block buffer per sink. */
+#define FL_SINK_BUFFER_ALIGN   4096
+
+enum FL_SINK_TYPES { FL_SINK_FILE = 1, FL_SINK_SOCKET, FL_SINK_FLB };
+
+struct fl_sink
+{
+   int sink_type;
+   char *buffer;
+   size_t buffer_size;
+   size_t buffer_used;
+   void *handle;
+   size_t handle_size;
+   unsigned long record_count;
+   unsigned long bytes_written;
+   int (*write_block)(struct fl_sink *sink, char *block, size_t block_len);
+   int (*write_record)(struct fl_sink *sink, char *record, size_t record_len);  /* NULL for block buffered sinks */
+   int (*close_sink)(struct fl_sink *sink);
+};
+typedef struct fl_sink fl_sink_t;
+
+struct fl_sink_list
+{
+   int sink_count;
+   fl_sink_t *sinks[FL_MAX_SINKS];
+};
+typedef struct fl_sink_list fl_sink_list_t;
+
+
+/* flsink.c */
+
+int init_sink_list(fl_sink_list_t *sink_list);
+int add_file_sink(fl_sink_list_t *sink_list, FILE *out_file, size_t buffer_size);
+int add_socket_sink(fl_sink_list_t *sink_list, size_t buffer_size);
+int add_flb_sink(fl_sink_list_t *sink_list, char *file_name, char *source_name);
+int write_sink_record(fl_sink_list_t *sink_list, char *record, size_t record_len);
+int write_sink_string(fl_sink_list_t *sink_list, char *record);
+int flush_sinks(fl_sink_list_t *sink_list);
+int close_sinks(fl_sink_list_t *sink_list);
+
+#endif
@@ -0,0 +1,139 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   fltime.c
+
+   Title : FineLine Computer Forensics Utilities
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Event time conversion without the C library time functions,
+            which differ between Linux and Windows and are not thread safe.
+
+   Notes:
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "fltime.h"
+
+/*
+   Function: days_from_civil()
+   Purpose : converts a date to days since 01/01/1970 with the proleptic
+             Gregorian calendar algorithm, no timegm() on Windows.
+   Input   : year, month 1-12, day of the month.
+   Output  : days since 1970, negative for earlier dates.
+*/
+int64_t days_from_civil(int64_t y, int m, int d)
+{
+   int64_t era, yoe, doy, doe;
+
+   y -= (m <= 2);
+   era = (y >= 0 ? y : y - 399) / 400;
+   yoe = y - era * 400;
+   doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+   doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+   return(era * 146097 + doe - 719468);
+}
+
+/*
+   Function: civil_from_days()
+   Purpose : converts days since 01/01/1970 to a date, the inverse of
+             days_from_civil().
+   Input   : days since 1970, year, month and day to fill in.
+   Output  : None.
+*/
+void civil_from_days(int64_t z, int *year, int *month, int *day)
+{
+   int64_t era, doe, yoe, y, doy, mp;
+
+   z += 719468;
+   era = (z >= 0 ? z : z - 146096) / 146097;
+   doe = z - era * 146097;
+   yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+   y = yoe + era * 400;
+   doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+   mp = (5 * doy + 2) / 153;
+   *day = (int)(doy - (153 * mp + 2) / 5 + 1);
+   *month = (int)(mp < 10 ? mp + 3 : mp - 9);
+   *year = (int)(y + (*month <= 2));
+}
+
+/*
+   Function: parse_fle_time()
+   Purpose : converts a .fle event time string to seconds since 1970,
+             accepts "DD/MM/YYYY HH:MM:SS" and the asctime() format
+             written by the sensor.
+   Input   : time string.
+   Output  : event time or FLE_INVALID_TIME.
+*/
+int64_t parse_fle_time(char *time_string)
+{
+   static const char *months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+   int day, month, year, hour, minute, second;
+   char wday_str[4];
+   char month_str[4];
+   char *p;
+
+   if (sscanf(time_string, "%d/%d/%d %d:%d:%d", &day, &month, &year, &hour, &minute, &second) != 6)
+   {
+      if (sscanf(time_string, "%3s %3s %d %d:%d:%d %d", wday_str, month_str, &day, &hour, &minute, &second, &year) != 7)
+         return(FLE_INVALID_TIME);
+      p = strstr(months, month_str);
+      if ((p == NULL) || (strlen(month_str) != 3))
+         return(FLE_INVALID_TIME);
+      month = (int)((p - months) / 3) + 1;
+   }
+
+   if ((month < 1) || (month > 12) || (day < 1) || (day > 31) || (hour < 0) || (hour > 23) ||
+       (minute < 0) || (minute > 59) || (second < 0) || (second > 60))
+      return(FLE_INVALID_TIME);
+
+   return(days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second);
+}
+
+/*
+   Function: format_fle_time()
+   Purpose : formats an event time as a .fle time string.
+   Input   : event time, output buffer, buffer length (>= 20).
+   Output  : 0 on success, -1 on error.
+*/
+int format_fle_time(int64_t event_time, char *time_string, int slen)
+{
+   int year, month, day;
+   int64_t days, secs;
+
+   if ((slen < 20) || (event_time == FLE_INVALID_TIME))
+      return(-1);
+
+   days = event_time / 86400;
+   secs = event_time % 86400;
+   if (secs < 0)
+   {
+      secs += 86400;
+      days--;
+   }
+   civil_from_days(days, &year, &month, &day);
+   sprintf(time_string, "%02d/%02d/%04d %02d:%02d:%02d", day, month, year, (int)(secs / 3600), (int)((secs % 3600) / 60), (int)(secs % 60));
+
+   return(0);
+}
@@ -0,0 +1,55 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   fltime.h
+
+   Title : FineLine Computer Forensics Utilities
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Event time conversion shared by the C tools and the C++ event
+            file loader. Event file times are "DD/MM/YYYY HH:MM:SS" UTC or
+            the asctime() format written by the sensor.
+
+   Notes: Event times are seconds since 01/01/1970 UTC.
+
+*/
+
+#ifndef FINELINE_TIME_H
+#define FINELINE_TIME_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLE_INVALID_TIME        INT64_MIN
+
+int64_t days_from_civil(int64_t y, int m, int d);
+void civil_from_days(int64_t z, int *year, int *month, int *day);
+int64_t parse_fle_time(char *time_string);
+int format_fle_time(int64_t event_time, char *time_string, int slen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
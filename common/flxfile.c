@@ -0,0 +1,726 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   flxfile.c
+
+   Title : FineLine Computer Forensics Utilities
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Builds, updates and queries the sidecar time index (.flx) of a
+            FineLine event file. The event file is read in large blocks,
+            records are split on '\n' with memchr() and only the <time>
+            tag of each event record is extracted and parsed.
+
+            An update loads the existing sidecar, checks the event file
+            still starts with the same bytes and has not been truncated,
+            then scans from the last indexed offset. The new sidecar is
+            written to a temporary file and renamed over the old one.
+
+   Notes: See flxfile.h for the file layout. A last line without a
+          newline is indexed as a record, the next update carries on from
+          the end of the file.
+
+*/
+
+#if defined(LINUX_BUILD) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+#ifdef LINUX_BUILD
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "flcommon.h"
+#include "flbfile.h"
+#include "flxfile.h"
+#include "uthash.h"
+
+#ifdef LINUX_BUILD
+#define flx_fseek(f, o, w) fseeko(f, (off_t)(o), w)
+#define flx_ftell(f) ((int64_t)ftello(f))
+#else
+#define flx_fseek(f, o, w) _fseeki64(f, (__int64)(o), w)
+#define flx_ftell(f) ((int64_t)_ftelli64(f))
+#endif
+
+struct flx_index
+{
+   uint32_t bucket_seconds;
+   uint64_t indexed_length;
+   uint64_t record_count;
+   uint64_t prefix_hash;
+   uint32_t prefix_length;
+   flx_chunk_t *chunks;
+   uint32_t chunk_count;
+   uint32_t chunk_capacity;
+   flx_bucket_t *buckets;
+   uint32_t bucket_count;
+};
+
+/* bucket map used while scanning */
+struct flx_bucket_entry
+{
+   int64_t bucket_time;
+   flx_bucket_t bucket;
+   UT_hash_handle hh;
+};
+
+
+/*
+   Little endian encode/decode helpers.
+*/
+
+static void put_u32(unsigned char *p, uint32_t v)
+{
+   p[0] = (unsigned char)v;
+   p[1] = (unsigned char)(v >> 8);
+   p[2] = (unsigned char)(v >> 16);
+   p[3] = (unsigned char)(v >> 24);
+}
+
+static void put_u64(unsigned char *p, uint64_t v)
+{
+   put_u32(p, (uint32_t)v);
+   put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint32_t get_u32(unsigned char *p)
+{
+   return((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+static uint64_t get_u64(unsigned char *p)
+{
+   return((uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32));
+}
+
+/*
+   FNV-1a hash of the first prefix_length bytes of the event file.
+*/
+static int hash_file_prefix(FILE *fle_file, uint32_t prefix_length, uint64_t *hash)
+{
+   unsigned char buf[FLX_PREFIX_LENGTH];
+   uint64_t h = 14695981039346656037ULL;
+   uint32_t i;
+
+   if (prefix_length > FLX_PREFIX_LENGTH)
+      prefix_length = FLX_PREFIX_LENGTH;
+   if ((flx_fseek(fle_file, 0, SEEK_SET) != 0) || (fread(buf, 1, prefix_length, fle_file) != prefix_length))
+      return(-1);
+   for (i = 0; i < prefix_length; i++)
+   {
+      h ^= buf[i];
+      h *= 1099511628211ULL;
+   }
+   *hash = h;
+
+   return(0);
+}
+
+static int64_t get_bucket_time(int64_t event_time, uint32_t bucket_seconds)
+{
+   int64_t b = event_time / (int64_t)bucket_seconds;
+
+   if ((event_time % (int64_t)bucket_seconds) < 0)
+      b--;
+   return(b * (int64_t)bucket_seconds);
+}
+
+/*
+   Finds the <time> tag in an event record without scanning past the end
+   of the line, the line is not NUL terminated.
+*/
+static int64_t get_record_time(char *line, size_t line_length)
+{
+   char time_str[64];
+   char *p, *end, *tag;
+   size_t len;
+
+   p = line;
+   end = line + line_length;
+   tag = NULL;
+   while ((p = (char *)memchr(p, '<', end - p)) != NULL)
+   {
+      if (((size_t)(end - p) >= 6) && (memcmp(p, "<time>", 6) == 0))
+      {
+         tag = p + 6;
+         break;
+      }
+      p++;
+   }
+   if (tag == NULL)
+      return(FLB_INVALID_TIME);
+   p = (char *)memchr(tag, '<', end - tag);
+   if (p == NULL)
+      return(FLB_INVALID_TIME);
+   len = p - tag;
+   if (len >= sizeof(time_str))
+      return(FLB_INVALID_TIME);
+   memcpy(time_str, tag, len);
+   time_str[len] = '\0';
+
+   return(parse_fle_time(time_str));
+}
+
+/*
+   Adds one event record at the given byte offset to the chunk table and
+   the bucket map.
+*/
+static void add_flx_record(flx_index_t *index, struct flx_bucket_entry **bucket_map, uint64_t offset, int64_t event_time)
+{
+   struct flx_bucket_entry *entry;
+   flx_chunk_t *chunk;
+   uint32_t chunk_number;
+
+   if ((index->record_count % FLX_CHUNK_RECORDS) == 0)
+   {
+      if (index->chunk_count == index->chunk_capacity)
+      {
+         index->chunk_capacity = (index->chunk_capacity == 0) ? 1024 : index->chunk_capacity * 2;
+         index->chunks = (flx_chunk_t *)xrealloc(index->chunks, index->chunk_capacity * sizeof(flx_chunk_t));
+      }
+      chunk = &index->chunks[index->chunk_count++];
+      chunk->offset = offset;
+      chunk->min_time = FLB_INVALID_TIME;
+      chunk->max_time = FLB_INVALID_TIME;
+      chunk->record_count = 0;
+   }
+   chunk_number = index->chunk_count - 1;
+   chunk = &index->chunks[chunk_number];
+   chunk->record_count++;
+   index->record_count++;
+
+   if (event_time == FLB_INVALID_TIME)
+      return;
+
+   if ((chunk->min_time == FLB_INVALID_TIME) || (event_time < chunk->min_time))
+      chunk->min_time = event_time;
+   if ((chunk->max_time == FLB_INVALID_TIME) || (event_time > chunk->max_time))
+      chunk->max_time = event_time;
+
+   event_time = get_bucket_time(event_time, index->bucket_seconds);
+   HASH_FIND(hh, *bucket_map, &event_time, sizeof(int64_t), entry);
+   if (entry == NULL)
+   {
+      entry = (struct flx_bucket_entry *)xcalloc(sizeof(struct flx_bucket_entry));
+      entry->bucket_time = event_time;
+      entry->bucket.bucket_time = event_time;
+      entry->bucket.first_chunk = chunk_number;
+      HASH_ADD(hh, *bucket_map, bucket_time, sizeof(int64_t), entry);
+   }
+   entry->bucket.last_chunk = chunk_number;
+   entry->bucket.record_count++;
+}
+
+static int bucket_sort(struct flx_bucket_entry *a, struct flx_bucket_entry *b)
+{
+   if (a->bucket_time < b->bucket_time)
+      return(-1);
+   return(a->bucket_time > b->bucket_time);
+}
+
+/*
+   Scans the event file from the last indexed offset to the end of the file
+   and adds every event record to the index, including a last record that has
+   no trailing newline.
+*/
+static int scan_fle_file(flx_index_t *index, FILE *fle_file, struct flx_bucket_entry **bucket_map)
+{
+   char *buf, *nl;
+   size_t capacity = FLX_SCAN_BUFFER_SIZE;
+   size_t have = 0;
+   size_t pos, n;
+   uint64_t base = index->indexed_length;
+
+   if (flx_fseek(fle_file, base, SEEK_SET) != 0)
+   {
+      print_log_entry("scan_fle_file() <ERROR> Could not seek in event file.\n");
+      return(-1);
+   }
+   buf = (char *)xmalloc(capacity);
+
+   for (;;)
+   {
+      n = fread(buf + have, 1, capacity - have, fle_file);
+      have += n;
+      pos = 0;
+      while ((nl = (char *)memchr(buf + pos, '\n', have - pos)) != NULL)
+      {
+         size_t line_length = nl - (buf + pos);
+
+         if ((line_length >= 7) && (memcmp(buf + pos, "<event>", 7) == 0))
+            add_flx_record(index, bucket_map, base + pos, get_record_time(buf + pos, line_length));
+         pos += line_length + 1;
+      }
+      base += pos;
+      if (n == 0)
+      {
+         if ((have > pos) && (have - pos >= 7) && (memcmp(buf + pos, "<event>", 7) == 0))
+            add_flx_record(index, bucket_map, base, get_record_time(buf + pos, have - pos));
+         base += have - pos;
+         break;
+      }
+      memmove(buf, buf + pos, have - pos);
+      have -= pos;
+      if (have == capacity) /* a single line longer than the buffer */
+      {
+         capacity *= 2;
+         buf = (char *)xrealloc(buf, capacity);
+      }
+   }
+   index->indexed_length = base;
+   free(buf);
+
+   return(0);
+}
+
+static int write_flx_file(flx_index_t *index, char *flx_file_name)
+{
+   unsigned char hdr[FLX_HEADER_SIZE];
+   unsigned char entry[FLX_CHUNK_ENTRY_SIZE];
+   char *tmp_file_name;
+   FILE *flx_file;
+   uint32_t i;
+   int ret = 0;
+
+   tmp_file_name = (char *)xmalloc(strlen(flx_file_name) + 5);
+   strcpy(tmp_file_name, flx_file_name);
+   strcat(tmp_file_name, ".tmp");
+
+   flx_file = fopen(tmp_file_name, "wb");
+   if (flx_file == NULL)
+   {
+      print_log_entry("write_flx_file() <ERROR> Could not open index file.\n");
+      free(tmp_file_name);
+      return(-1);
+   }
+
+   memset(hdr, 0, FLX_HEADER_SIZE);
+   memcpy(hdr, FLX_FILE_MAGIC, 4);
+   put_u32(hdr + 4, FLX_VERSION);
+   put_u32(hdr + 8, index->bucket_seconds);
+   put_u32(hdr + 12, FLX_CHUNK_RECORDS);
+   put_u64(hdr + 16, index->indexed_length);
+   put_u64(hdr + 24, index->record_count);
+   put_u32(hdr + 32, index->chunk_count);
+   put_u32(hdr + 36, index->bucket_count);
+   put_u64(hdr + 40, index->prefix_hash);
+   put_u32(hdr + 48, index->prefix_length);
+   if (fwrite(hdr, 1, FLX_HEADER_SIZE, flx_file) != FLX_HEADER_SIZE)
+      ret = -1;
+
+   for (i = 0; (ret == 0) && (i < index->chunk_count); i++)
+   {
+      memset(entry, 0, FLX_CHUNK_ENTRY_SIZE);
+      put_u64(entry, index->chunks[i].offset);
+      put_u64(entry + 8, (uint64_t)index->chunks[i].min_time);
+      put_u64(entry + 16, (uint64_t)index->chunks[i].max_time);
+      put_u32(entry + 24, index->chunks[i].record_count);
+      if (fwrite(entry, 1, FLX_CHUNK_ENTRY_SIZE, flx_file) != FLX_CHUNK_ENTRY_SIZE)
+         ret = -1;
+   }
+   for (i = 0; (ret == 0) && (i < index->bucket_count); i++)
+   {
+      memset(entry, 0, FLX_BUCKET_ENTRY_SIZE);
+      put_u64(entry, (uint64_t)index->buckets[i].bucket_time);
+      put_u32(entry + 8, index->buckets[i].first_chunk);
+      put_u32(entry + 12, index->buckets[i].last_chunk);
+      put_u32(entry + 16, index->buckets[i].record_count);
+      if (fwrite(entry, 1, FLX_BUCKET_ENTRY_SIZE, flx_file) != FLX_BUCKET_ENTRY_SIZE)
+         ret = -1;
+   }
+
+   if ((fclose(flx_file) != 0) || (ret < 0))
+   {
+      print_log_entry("write_flx_file() <ERROR> Short write to index file.\n");
+      remove(tmp_file_name);
+      free(tmp_file_name);
+      return(-1);
+   }
+
+#ifndef LINUX_BUILD
+   remove(flx_file_name); /* rename() does not replace an existing file on Windows */
+#endif
+   if (rename(tmp_file_name, flx_file_name) != 0)
+   {
+      print_log_entry("write_flx_file() <ERROR> Could not rename index file.\n");
+      ret = -1;
+   }
+   free(tmp_file_name);
+
+   return(ret);
+}
+
+static flx_index_t *load_flx_index(char *flx_file_name, int quiet)
+{
+   unsigned char hdr[FLX_HEADER_SIZE];
+   unsigned char entry[FLX_CHUNK_ENTRY_SIZE];
+   flx_index_t *index;
+   FILE *flx_file;
+   uint32_t i;
+
+   flx_file = fopen(flx_file_name, "rb");
+   if (flx_file == NULL)
+   {
+      if (!quiet)
+         print_log_entry("open_flx_index() <ERROR> Could not open index file.\n");
+      return(NULL);
+   }
+   if ((fread(hdr, 1, FLX_HEADER_SIZE, flx_file) != FLX_HEADER_SIZE) || (memcmp(hdr, FLX_FILE_MAGIC, 4) != 0) ||
+       (get_u32(hdr + 4) != FLX_VERSION) || (get_u32(hdr + 12) != FLX_CHUNK_RECORDS) || (get_u32(hdr + 8) == 0))
+   {
+      print_log_entry("open_flx_index() <ERROR> Invalid index file header.\n");
+      fclose(flx_file);
+      return(NULL);
+   }
+
+   index = (flx_index_t *)xcalloc(sizeof(flx_index_t));
+   index->bucket_seconds = get_u32(hdr + 8);
+   index->indexed_length = get_u64(hdr + 16);
+   index->record_count = get_u64(hdr + 24);
+   index->chunk_count = get_u32(hdr + 32);
+   index->bucket_count = get_u32(hdr + 36);
+   index->prefix_hash = get_u64(hdr + 40);
+   index->prefix_length = get_u32(hdr + 48);
+
+   if ((uint64_t)index->chunk_count != (index->record_count + FLX_CHUNK_RECORDS - 1) / FLX_CHUNK_RECORDS)
+   {
+      print_log_entry("open_flx_index() <ERROR> Index file chunk count mismatch.\n");
+      fclose(flx_file);
+      close_flx_index(index);
+      return(NULL);
+   }
+
+   index->chunk_capacity = index->chunk_count;
+   if (index->chunk_count > 0)
+      index->chunks = (flx_chunk_t *)xmalloc(index->chunk_count * sizeof(flx_chunk_t));
+   if (index->bucket_count > 0)
+      index->buckets = (flx_bucket_t *)xmalloc(index->bucket_count * sizeof(flx_bucket_t));
+
+   for (i = 0; i < index->chunk_count; i++)
+   {
+      if (fread(entry, 1, FLX_CHUNK_ENTRY_SIZE, flx_file) != FLX_CHUNK_ENTRY_SIZE)
+         break;
+      index->chunks[i].offset = get_u64(entry);
+      index->chunks[i].min_time = (int64_t)get_u64(entry + 8);
+      index->chunks[i].max_time = (int64_t)get_u64(entry + 16);
+      index->chunks[i].record_count = get_u32(entry + 24);
+   }
+   if (i == index->chunk_count)
+   {
+      for (i = 0; i < index->bucket_count; i++)
+      {
+         if (fread(entry, 1, FLX_BUCKET_ENTRY_SIZE, flx_file) != FLX_BUCKET_ENTRY_SIZE)
+            break;
+         index->buckets[i].bucket_time = (int64_t)get_u64(entry);
+         index->buckets[i].first_chunk = get_u32(entry + 8);
+         index->buckets[i].last_chunk = get_u32(entry + 12);
+         index->buckets[i].record_count = get_u32(entry + 16);
+         if (index->buckets[i].last_chunk >= index->chunk_count)
+            break;
+      }
+      if (i == index->bucket_count)
+      {
+         fclose(flx_file);
+         return(index);
+      }
+   }
+
+   print_log_entry("open_flx_index() <ERROR> Index file is truncated.\n");
+   fclose(flx_file);
+   close_flx_index(index);
+
+   return(NULL);
+}
+
+/*
+   Function: make_flx_file_name()
+   Purpose : builds the sidecar index file name, events.fle -> events.fle.flx
+   Input   : event file name, output buffer and buffer length.
+   Output  : 0 on success, -1 if the name does not fit.
+*/
+int make_flx_file_name(char *fle_file_name, char *flx_file_name, int slen)
+{
+   if ((int)(strlen(fle_file_name) + strlen(FLX_FILE_EXT)) >= slen)
+      return(-1);
+   strcpy(flx_file_name, fle_file_name);
+   strcat(flx_file_name, FLX_FILE_EXT);
+
+   return(0);
+}
+
+/*
+   Function: update_flx_index()
+   Purpose : creates the sidecar index of an event file or brings an
+             existing index up to date with records appended since the
+             last update. The index is rebuilt if the event file was
+             replaced or truncated or the bucket size changed.
+   Input   : event file name, index file name, bucket size in seconds
+             (0 keeps the existing size or uses FLX_BUCKET_SECONDS).
+   Output  : number of records added to the index, -1 on error.
+*/
+int64_t update_flx_index(char *fle_file_name, char *flx_file_name, uint32_t bucket_seconds)
+{
+   struct flx_bucket_entry *bucket_map = NULL;
+   struct flx_bucket_entry *entry, *tmp;
+   flx_index_t *index;
+   FILE *fle_file;
+   int64_t fle_size;
+   uint64_t hash, old_count;
+   uint32_t i;
+
+   fle_file = fopen(fle_file_name, "rb");
+   if (fle_file == NULL)
+   {
+      print_log_entry("update_flx_index() <ERROR> Could not open event file.\n");
+      return(-1);
+   }
+   if ((flx_fseek(fle_file, 0, SEEK_END) != 0) || ((fle_size = flx_ftell(fle_file)) < 0))
+   {
+      print_log_entry("update_flx_index() <ERROR> Could not get event file size.\n");
+      fclose(fle_file);
+      return(-1);
+   }
+
+   index = load_flx_index(flx_file_name, 1);
+   if (index != NULL)
+   {
+      if (((bucket_seconds != 0) && (bucket_seconds != index->bucket_seconds)) ||
+          ((uint64_t)fle_size < index->indexed_length) ||
+          (hash_file_prefix(fle_file, index->prefix_length, &hash) < 0) || (hash != index->prefix_hash))
+      {
+         print_log_entry("update_flx_index() <INFO> Event file changed, rebuilding index.\n");
+         close_flx_index(index);
+         index = NULL;
+      }
+      else if ((uint64_t)fle_size == index->indexed_length)
+      {
+         close_flx_index(index);
+         fclose(fle_file);
+         return(0);
+      }
+   }
+   if (index == NULL)
+   {
+      index = (flx_index_t *)xcalloc(sizeof(flx_index_t));
+      index->bucket_seconds = (bucket_seconds != 0) ? bucket_seconds : FLX_BUCKET_SECONDS;
+   }
+   old_count = index->record_count;
+
+   for (i = 0; i < index->bucket_count; i++)
+   {
+      entry = (struct flx_bucket_entry *)xcalloc(sizeof(struct flx_bucket_entry));
+      entry->bucket_time = index->buckets[i].bucket_time;
+      entry->bucket = index->buckets[i];
+      HASH_ADD(hh, bucket_map, bucket_time, sizeof(int64_t), entry);
+   }
+
+   if (scan_fle_file(index, fle_file, &bucket_map) < 0)
+   {
+      HASH_ITER(hh, bucket_map, entry, tmp)
+      {
+         HASH_DEL(bucket_map, entry);
+         free(entry);
+      }
+      close_flx_index(index);
+      fclose(fle_file);
+      return(-1);
+   }
+
+   index->prefix_length = (index->indexed_length < FLX_PREFIX_LENGTH) ? (uint32_t)index->indexed_length : FLX_PREFIX_LENGTH;
+   hash_file_prefix(fle_file, index->prefix_length, &index->prefix_hash);
+   fclose(fle_file);
+
+   HASH_SORT(bucket_map, bucket_sort);
+   index->bucket_count = HASH_COUNT(bucket_map);
+   index->buckets = (flx_bucket_t *)xrealloc(index->buckets, (index->bucket_count + 1) * sizeof(flx_bucket_t));
+   i = 0;
+   HASH_ITER(hh, bucket_map, entry, tmp)
+   {
+      index->buckets[i++] = entry->bucket;
+      HASH_DEL(bucket_map, entry);
+      free(entry);
+   }
+
+   if (write_flx_file(index, flx_file_name) < 0)
+   {
+      close_flx_index(index);
+      return(-1);
+   }
+   old_count = index->record_count - old_count;
+   close_flx_index(index);
+
+   return((int64_t)old_count);
+}
+
+/*
+   Function: open_flx_index()
+   Purpose : loads the chunk and bucket tables of a sidecar index.
+   Input   : index file name.
+   Output  : index or NULL on error.
+*/
+flx_index_t *open_flx_index(char *flx_file_name)
+{
+   return(load_flx_index(flx_file_name, 0));
+}
+
+uint64_t get_flx_record_count(flx_index_t *index)
+{
+   return(index->record_count);
+}
+
+uint64_t get_flx_indexed_length(flx_index_t *index)
+{
+   return(index->indexed_length);
+}
+
+uint32_t get_flx_chunk_count(flx_index_t *index)
+{
+   return(index->chunk_count);
+}
+
+uint32_t get_flx_bucket_count(flx_index_t *index)
+{
+   return(index->bucket_count);
+}
+
+flx_chunk_t *get_flx_chunk(flx_index_t *index, uint32_t chunk_number)
+{
+   if (chunk_number >= index->chunk_count)
+      return(NULL);
+   return(&index->chunks[chunk_number]);
+}
+
+flx_bucket_t *get_flx_bucket(flx_index_t *index, uint32_t bucket_number)
+{
+   if (bucket_number >= index->bucket_count)
+      return(NULL);
+   return(&index->buckets[bucket_number]);
+}
+
+/*
+   Function: get_flx_record_offset()
+   Purpose : finds the byte offset to seek to for an event record ordinal.
+   Input   : index, record ordinal, returns the number of event records
+             to skip after the seek.
+   Output  : byte offset or -1 if the ordinal is not indexed.
+*/
+int64_t get_flx_record_offset(flx_index_t *index, uint64_t ordinal, uint32_t *skip_records)
+{
+   if (ordinal >= index->record_count)
+      return(-1);
+   if (skip_records != NULL)
+      *skip_records = (uint32_t)(ordinal % FLX_CHUNK_RECORDS);
+
+   return((int64_t)index->chunks[ordinal / FLX_CHUNK_RECORDS].offset);
+}
+
+/*
+   Function: query_flx_time_range()
+   Purpose : finds the parts of the event file that hold events between
+             start_time and end_time inclusive. Adjacent chunks are merged
+             into a single range. The ranges may still contain events
+             outside the window, the caller filters on the record time.
+   Input   : index, time window, range callback and user data.
+   Output  : number of ranges, -1 on error.
+*/
+int64_t query_flx_time_range(flx_index_t *index, int64_t start_time, int64_t end_time, flx_range_callback callback, void *user_data)
+{
+   int64_t start_bucket, end_bucket, ranges = 0;
+   uint32_t lo, hi, mid, first, last, run_start, i;
+   int found = 0;
+   flx_chunk_t *chunk;
+
+   if ((index == NULL) || (callback == NULL) || (start_time > end_time))
+      return(-1);
+
+   start_bucket = get_bucket_time(start_time, index->bucket_seconds);
+   end_bucket = get_bucket_time(end_time, index->bucket_seconds);
+
+   /* first bucket at or after the start of the window */
+   lo = 0;
+   hi = index->bucket_count;
+   while (lo < hi)
+   {
+      mid = lo + (hi - lo) / 2;
+      if (index->buckets[mid].bucket_time < start_bucket)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   first = 0;
+   last = 0;
+   for (i = lo; (i < index->bucket_count) && (index->buckets[i].bucket_time <= end_bucket); i++)
+   {
+      if (!found || (index->buckets[i].first_chunk < first))
+         first = index->buckets[i].first_chunk;
+      if (!found || (index->buckets[i].last_chunk > last))
+         last = index->buckets[i].last_chunk;
+      found = 1;
+   }
+   if (!found)
+      return(0);
+
+   run_start = last + 1;
+   for (i = first; i <= last + 1; i++)
+   {
+      int overlap = 0;
+
+      if (i <= last)
+      {
+         chunk = &index->chunks[i];
+         overlap = (chunk->min_time != FLB_INVALID_TIME) && (chunk->min_time <= end_time) && (chunk->max_time >= start_time);
+      }
+      if (overlap && (run_start > last))
+      {
+         run_start = i;
+      }
+      else if (!overlap && (run_start <= last))
+      {
+         uint64_t offset = index->chunks[run_start].offset;
+         uint64_t end = (i < index->chunk_count) ? index->chunks[i].offset : index->indexed_length;
+         uint64_t first_ordinal = (uint64_t)run_start * FLX_CHUNK_RECORDS;
+         uint64_t count = ((i < index->chunk_count) ? (uint64_t)i * FLX_CHUNK_RECORDS : index->record_count) - first_ordinal;
+
+         ranges++;
+         if (callback(offset, end - offset, first_ordinal, count, user_data) != 0)
+            break;
+         run_start = last + 1;
+      }
+   }
+
+   return(ranges);
+}
+
+int close_flx_index(flx_index_t *index)
+{
+   if (index == NULL)
+      return(0);
+   free(index->chunks);
+   free(index->buckets);
+   free(index);
+
+   return(0);
+}
@@ -0,0 +1,123 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   flxfile.h
+
+   Title : FineLine Computer Forensics Utilities
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: FineLine event file sidecar time index (.flx) definitions.
+
+            The sidecar sits next to an existing .fle file (events.fle ->
+            events.fle.flx) and maps record ordinals and time buckets to
+            byte offsets in the event file:
+
+            [header]
+            [chunk table]  one entry per FLX_CHUNK_RECORDS event records,
+                           byte offset and min/max event time.
+            [bucket table] one entry per occupied time bucket, sorted by
+                           time, the first and last chunk holding events
+                           that fall in the bucket.
+
+            Ordinal n is in chunk n / FLX_CHUNK_RECORDS, so seeking to a
+            record is a table lookup plus a short line skip. A time window
+            query binary searches the bucket table and only returns the
+            chunks whose min/max times overlap the window.
+
+            The header records how many bytes of the .fle were indexed and
+            a hash of the start of the file, when events are appended to
+            the .fle the update only scans the new bytes.
+
+   Notes: All integers are little endian, times are seconds since 1970 as
+          returned by parse_fle_time().
+
+*/
+
+#ifndef FINELINE_FLX_FILE_H
+#define FINELINE_FLX_FILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLX_FILE_EXT            ".flx"
+#define FLX_FILE_MAGIC          "FLX1"
+#define FLX_VERSION             1
+#define FLX_CHUNK_RECORDS       256
+#define FLX_BUCKET_SECONDS      3600      /* default one hour time buckets */
+#define FLX_PREFIX_LENGTH       4096      /* bytes hashed to detect a replaced .fle file */
+#define FLX_SCAN_BUFFER_SIZE    1048576
+#define FLX_HEADER_SIZE         64
+#define FLX_CHUNK_ENTRY_SIZE    32
+#define FLX_BUCKET_ENTRY_SIZE   24
+
+struct flx_chunk
+{
+   uint64_t offset;
+   int64_t min_time;
+   int64_t max_time;
+   uint32_t record_count;
+};
+typedef struct flx_chunk flx_chunk_t;
+
+struct flx_bucket
+{
+   int64_t bucket_time;
+   uint32_t first_chunk;
+   uint32_t last_chunk;
+   uint32_t record_count;
+};
+typedef struct flx_bucket flx_bucket_t;
+
+typedef struct flx_index flx_index_t;
+
+/*
+   Called once for each run of adjacent chunks that overlap a time window,
+   the run starts on a record boundary. Return non-zero to stop the query.
+*/
+typedef int (*flx_range_callback)(uint64_t offset, uint64_t length, uint64_t first_ordinal, uint64_t record_count, void *user_data);
+
+
+/* flxfile.c */
+
+int make_flx_file_name(char *fle_file_name, char *flx_file_name, int slen);
+int64_t update_flx_index(char *fle_file_name, char *flx_file_name, uint32_t bucket_seconds);
+
+flx_index_t *open_flx_index(char *flx_file_name);
+uint64_t get_flx_record_count(flx_index_t *index);
+uint64_t get_flx_indexed_length(flx_index_t *index);
+uint32_t get_flx_chunk_count(flx_index_t *index);
+uint32_t get_flx_bucket_count(flx_index_t *index);
+flx_chunk_t *get_flx_chunk(flx_index_t *index, uint32_t chunk_number);
+flx_bucket_t *get_flx_bucket(flx_index_t *index, uint32_t bucket_number);
+int64_t get_flx_record_offset(flx_index_t *index, uint64_t ordinal, uint32_t *skip_records);
+int64_t query_flx_time_range(flx_index_t *index, int64_t start_time, int64_t end_time, flx_range_callback callback, void *user_data);
+int close_flx_index(flx_index_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
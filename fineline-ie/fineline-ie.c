@@ -177,6 +177,27 @@ int parse_command_line_args(int argc, char *argv[], char *fl_filename, char *in_
                return(-1);
             }
          }
+         else if (strncmp(argv[i], "-F", 2) == 0)
+         {
+            /* Output file format, fle (default) or flb */
+            if ((i+1) < argc)
+            {
+               if (strncmp(argv[i+1], "flb", 3) == 0)
+               {
+                  retval = retval | FL_FILE_OUT | FL_FLB_OUT; /* Create FineLine binary timeline file */
+               }
+               else if (strncmp(argv[i+1], "fle", 3) != 0)
+               {
+                  print_log_entry("parse_command_line_args() <ERROR> Unknown output file format.\n");
+                  return(-1);
+               }
+            }
+            else
+            {
+               print_log_entry("parse_command_line_args() <ERROR> Missing output file format.\n");
+               return(-1);
+            }
+         }
          else if (strncmp(argv[i], "-f", 2) == 0)
          {
             /* Windows event file name to use for input */
@@ -202,6 +223,16 @@ int parse_command_line_args(int argc, char *argv[], char *fl_filename, char *in_
       retval = retval | FL_CACHE_IN;      
    }
 
+   /* binary timeline output replaces the .fle extension of the output file */
+   if (retval & FL_FLB_OUT)
+   {
+      size_t flen = strlen(fl_filename);
+      if ((flen > 4) && (strcmp(fl_filename + flen - 4, EVENT_FILE_EXT) == 0))
+      {
+         strcpy(fl_filename + flen - 4, FLB_FILE_EXT);
+      }
+   }
+
    print_log_entry("parse_command_line_args() <INFO> Finished processing command line arguments.\n");
 
    return(retval);
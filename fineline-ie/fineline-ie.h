@@ -58,6 +58,8 @@
 
 
 #include "uthash.h"
+#include "flsink.h"
+#include "flbfile.h"
 
 /*
    Constant Definitions
@@ -78,6 +80,7 @@
 #define FL_INDEX_IN  0x04  /* This is the IE1-9 index.dat */
 #define FL_CACHE_IN  0x08  /* This is the IE10+ WebCacheV01.dat */
 #define FL_FILTER_ON 0x10
+#define FL_FLB_OUT   0x80  /* Binary timeline (.flb) output */
 
 #define DATABASE_FILE_EXT ".txt"
 #define EVENT_FILE_EXT ".fle"
@@ -224,10 +227,8 @@ int match_url_filter(char *url_string);
 
 void add_url_record(uint64_t url_id, struct fl_url_record *flurl);
 struct fl_url_record *find_url(uint64_t url_id);
-void write_url_map(FILE *outfile);
-void write_url_map_in_time_sequence(FILE *outfile, uint64_t lowest);
-void send_url_map();
-void send_url_map_in_time_sequence(uint64_t lowest);
+void output_url_map(fl_sink_list_t *sinks);
+void output_url_map_in_time_sequence(fl_sink_list_t *sinks, uint64_t lowest);
 int time_sort(struct fl_url_record *a, struct fl_url_record *b);
 void sort_by_time();
 void sort_by_record_number();
@@ -241,6 +242,7 @@ uint64_t get_first_record_number();
 
 int init_socket(char *gui_ip_address);
 int send_event(char *event_string);
+int send_event_block(char *event_block, int block_len);
 char *get_response();
 int close_socket();
 
@@ -96,6 +96,32 @@ int send_event(char *event_string)
    return(k);
 }
 
+/*
+   Function: send_event_block
+   Purpose : sends a block of buffered event records to the GUI, loops
+             until the whole block has been written to the socket.
+   Input   : event record block, block length.
+   Return  : number of bytes sent, -1 = fail.
+*/
+int send_event_block(char *event_block, int block_len)
+{
+   int k;
+   int sent = 0;
+
+   while (sent < block_len)
+   {
+      k = send(sockfd, event_block + sent, block_len - sent, 0);
+      if (k == -1)
+      {
+         print_log_entry("send_event_block() <ERROR> Cannot write to server!\n");
+         return(-1);
+      }
+      sent += k;
+   }
+
+   return(sent);
+}
+
 /* TODO: protocol not fully specified yet */
 char *get_response()
 {
@@ -210,6 +236,34 @@ int send_event(char *event_string)
 	return(0);
 }
 
+/*
+   Function: send_event_block
+   Purpose : sends a block of buffered event records to the GUI, loops
+             until the whole block has been written to the socket.
+   Input   : event record block, block length.
+   Return  : number of bytes sent, -1 = fail.
+*/
+int send_event_block(char *event_block, int block_len)
+{
+   int result;
+   int sent = 0;
+
+   while (sent < block_len)
+   {
+      result = send(connect_socket, event_block + sent, block_len - sent, 0);
+      if (result == SOCKET_ERROR)
+      {
+         print_log_entry("send_event_block() <ERROR> Send failed with error.\n");
+         closesocket(connect_socket);
+         WSACleanup();
+         return(-1);
+      }
+      sent += result;
+   }
+
+   return(sent);
+}
+
 /* TODO: acknowledge from server */
 char *get_response()
 {
@@ -42,6 +42,30 @@
 #include <libfdatetime_posix_time.h>
 #include <libfdatetime_types.h>
 
+/*
+   Function: close_event_outputs
+   Purpose : Flushes and closes the output sinks, then closes the FineLine event
+             file and the GUI socket. Every exit after the sinks are set up goes
+             through here so partial output is written and nothing is leaked.
+   Input   : sink list, event file or NULL, 1 if the GUI socket is open.
+   Output  : None.
+*/
+static void close_event_outputs(fl_sink_list_t *sinks, FILE *fl_evt_file, int gui_socket)
+{
+   close_sinks(sinks);
+
+   /* close the event output file */
+   if (fl_evt_file != NULL)
+   {
+      fclose(fl_evt_file);
+   }
+   /* close the socket to the GUI */
+   if (gui_socket)
+   {
+      close_socket();
+   }
+}
+
 int parse_ie_index_file(char *iecfile, char *fl_event_filename, int mode, char *gui_ip_addr, char *filter_filename)
 {
    libcerror_error_t *error     = NULL;
@@ -50,6 +74,8 @@ int parse_ie_index_file(char *iecfile, char *fl_event_filename, int mode, char *
    int item_iterator      = 0;
    int number_of_items    = 0;
    FILE *fl_evt_file = NULL;
+   int gui_socket = 0;
+   fl_sink_list_t sinks;
 
    if(libmsiecf_file_initialize(&input_file, &error) != 1)
    {
@@ -72,14 +98,28 @@ int parse_ie_index_file(char *iecfile, char *fl_event_filename, int mode, char *
    }
    printf("parse_ie_cache_file() <INFO> Number of items: %d.\n", number_of_items );
 
+   init_sink_list(&sinks);
+
    /* if -w mode then open the fineline event file for output */
-   if (mode & FL_FILE_OUT)
+   if ((mode & FL_FILE_OUT) && !(mode & FL_FLB_OUT))
    {
       fl_evt_file = open_fineline_event_file(fl_event_filename);
 
       if (fl_evt_file == NULL)
       {
          print_log_entry("parse_ie_cache_file() <ERROR> Failed to open FineLine event file.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
+         return(-1);
+      }
+      add_file_sink(&sinks, fl_evt_file, 0);
+   }
+   /* if -F flb mode then write a binary timeline file instead */
+   if (mode & FL_FLB_OUT)
+   {
+      if (add_flb_sink(&sinks, fl_event_filename, iecfile) < 0)
+      {
+         print_log_entry("parse_ie_index_file() <ERROR> Failed to open FineLine binary timeline file.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
    }
@@ -89,8 +129,11 @@ int parse_ie_index_file(char *iecfile, char *fl_event_filename, int mode, char *
       if (init_socket(gui_ip_addr))
       {
          print_log_entry("parse_ie_cache_file() <ERROR> Could not open socket to GUI.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
+      gui_socket = 1;
+      add_socket_sink(&sinks, 0);
    }
    /* if -f mode then open the filter file */
    if (mode & FL_FILTER_ON)
@@ -98,6 +141,7 @@ int parse_ie_index_file(char *iecfile, char *fl_event_filename, int mode, char *
       if (load_url_filters(filter_filename) < 0)
       {
          print_log_entry("parse_ie_cache_file() <ERROR> Could not load URL filter file.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
    }
@@ -108,6 +152,7 @@ int parse_ie_index_file(char *iecfile, char *fl_event_filename, int mode, char *
       if(libmsiecf_file_get_item(input_file, item_iterator, &url_item, &error) != 1)
       {
          print_log_entry("parse_ie_cache_file() <ERROR> Could not get URL item.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
 
@@ -119,6 +164,7 @@ int parse_ie_index_file(char *iecfile, char *fl_event_filename, int mode, char *
       if(libmsiecf_item_free(&url_item, &error) != 1)
       {
          print_log_entry("parse_ie_cache_file() <ERROR> Could not free URL item.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return( -1 );
       }
 	
@@ -127,12 +173,14 @@ int parse_ie_index_file(char *iecfile, char *fl_event_filename, int mode, char *
    if(libmsiecf_file_close(input_file, &error) != 0 )
    {
       print_log_entry("parse_ie_cache_file() <ERROR> Could not close input file.\n");      
+      close_event_outputs(&sinks, fl_evt_file, gui_socket);
       return(-1);
    }
 
    if(libmsiecf_file_free(&input_file, &error) != 1)
    {
       print_log_entry("parse_ie_cache_file() <ERROR> Could not free input file.\n");
+      close_event_outputs(&sinks, fl_evt_file, gui_socket);
       return(-1);      
    }
    
@@ -141,26 +189,9 @@ int parse_ie_index_file(char *iecfile, char *fl_event_filename, int mode, char *
 
    sort_by_primary_time();
 
-   if (mode & FL_FILE_OUT)
-   {
-      write_url_map(fl_evt_file);
-   }
-  
-   if (mode & FL_GUI_OUT)
-   {
-      send_url_map();
-   }
+   output_url_map(&sinks);
 
-   /* close the event output file */
-   if (mode & FL_FILE_OUT)
-   {
-      fclose(fl_evt_file);
-   }
-   /* close the socket to the GUI */
-   if (mode & FL_GUI_OUT)
-   {
-      close_socket();
-   }
+   close_event_outputs(&sinks, fl_evt_file, gui_socket);
 
    printf("parse_ie_cache_file() <INFO> Processed %d URL items\n", number_of_items);
 
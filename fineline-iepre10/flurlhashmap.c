@@ -89,33 +89,40 @@ void delete_all()
   }
 }
 
-void write_url_map(FILE *outfile) 
+/*
+   Function: output_url_map()
+   Purpose : single pass over the url map, each record is handed to
+             every output sink (file, GUI socket etc).
+   Input   : sink list.
+   Output  : none.
+*/
+void output_url_map(fl_sink_list_t *sinks)
 {
     struct fl_url_record *s;
 
-    for(s=url_map; s != NULL; s=(struct fl_url_record *)(s->hh.next)) 
+    for(s=url_map; s != NULL; s=(struct fl_url_record *)(s->hh.next))
     {
-        fputs(s->url_record_string, outfile);
+        write_sink_string(sinks, s->url_record_string);
     }
 }
 
-void write_url_map_in_time_sequence(FILE *outfile, uint64_t lowest)
+void output_url_map_in_time_sequence(fl_sink_list_t *sinks, uint64_t lowest)
 {
     struct fl_url_record *s;
-    struct fl_url_record *m;    
-    HASH_FIND(hh, url_map, &lowest, sizeof(uint64_t), m);  /* get the first rul record then start iterating over the map */
-    if (m != NULL) 
+    struct fl_url_record *m;
+    HASH_FIND(hh, url_map, &lowest, sizeof(uint64_t), m);  /* get the first record then start iterating over the map */
+    if (m != NULL)
     {
-       for(s=m; s != NULL; s=(struct fl_url_record *)(s->hh.next)) 
+       for(s=m; s != NULL; s=(struct fl_url_record *)(s->hh.next))
        {
-           fputs(s->url_record_string, outfile);
+           write_sink_string(sinks, s->url_record_string);
        }
     }
     /* now finish of the rest of the event list from the start of the map */
-    for(s=url_map; s != NULL; s=(struct fl_url_record *)(s->hh.next)) 
+    for(s=url_map; s != NULL; s=(struct fl_url_record *)(s->hh.next))
     {
         if (s->id > lowest)
-           fputs(s->url_record_string, outfile);
+           write_sink_string(sinks, s->url_record_string);
         else
            break;
     }
@@ -133,38 +140,6 @@ uint64_t get_first_record_number()
     return(lowest);
 }
 
-void send_url_map() 
-{
-    struct fl_url_record *s;
-
-    for(s=url_map; s != NULL; s=(struct fl_url_record *)(s->hh.next)) 
-    {
-        send_event(s->url_record_string);
-    }
-}
-
-void send_url_map_in_time_sequence(uint64_t lowest)
-{
-    struct fl_url_record *s;
-    struct fl_url_record *m;    
-    HASH_FIND(hh, url_map, &lowest, sizeof(uint64_t), m);  /* get the first event record then start iterating over the map */
-    if (m != NULL) 
-    {
-       for(s=m; s != NULL; s=(struct fl_url_record *)(s->hh.next)) 
-       {
-           send_event(s->url_record_string);
-       }
-    }
-    /* now finish of the rest of the event list from the start of the map */
-    for(s=url_map; s != NULL; s=(struct fl_url_record *)(s->hh.next)) 
-    {
-        if (s->id > lowest)
-           send_event(s->url_record_string);
-        else
-           break;
-    }
-}
-
 void print_url_map() 
 {
     struct fl_url_record *s;
@@ -0,0 +1,363 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   fineline-index.c
+
+   Title : FineLine Computer Forensics Utilities
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: FineLine event file indexer. Builds or updates the sidecar time
+            index (.flx) of one or more .fle files, lists the index time
+            buckets and prints the event records in a time window by
+            seeking straight to the indexed ranges.
+
+*/
+
+#if defined(LINUX_BUILD) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+#ifdef LINUX_BUILD
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "flcommon.h"
+#include "fineline-index.h"
+
+#ifdef LINUX_BUILD
+#define fl_fseek(f, o, w) fseeko(f, (off_t)(o), w)
+#else
+#define fl_fseek(f, o, w) _fseeki64(f, (__int64)(o), w)
+#endif
+
+struct fl_index_query
+{
+   FILE *fle_file;
+   int64_t start_time;
+   int64_t end_time;
+   char *line;
+   size_t line_capacity;
+   uint64_t match_count;
+};
+
+
+int main(int argc, char *argv[])
+{
+   fl_index_options_t options;
+   int i, ret = 0;
+   int res = open_log_file(argv[0]);
+
+   if (res < 0)
+   {
+      printf("fineline-index.c main() <ERROR> Could not open log file.\n");
+      exit(FILE_ERROR);
+   }
+   print_log_entry("fineline-index.c main() <INFO> Starting FineLine Indexer 1.0\n");
+
+   if (parse_command_line_args(argc, argv, &options) < 0)
+   {
+      print_log_entry("fineline-index.c main() <ERROR> Invalid command line options!\n");
+      show_index_help();
+      close_log_file();
+      exit(SYSTEM_ERROR);
+   }
+
+   for (i = 0; i < options.file_count; i++)
+   {
+      if (index_event_file(options.fle_files[i], &options) < 0)
+      {
+         ret = FILE_ERROR;
+         continue;
+      }
+      if (options.mode & FL_INDEX_LIST)
+         list_event_file_index(options.fle_files[i]);
+      if (options.mode & FL_INDEX_QUERY)
+         query_event_file(options.fle_files[i], &options);
+   }
+
+   close_log_file();
+
+   exit(ret);
+}
+
+/*
+   Function: parse_command_line_args
+   Purpose : Validates command line arguments, every argument that is not
+             an option is an event file to index.
+   Input   : argc, argv, options.
+   Return  : returns -1 on error.
+*/
+int parse_command_line_args(int argc, char *argv[], fl_index_options_t *options)
+{
+   int i;
+
+   memset(options, 0, sizeof(fl_index_options_t));
+   options->mode = FL_INDEX_UPDATE;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (strncmp(argv[i], "-r", 2) == 0)
+      {
+         options->mode = options->mode | FL_INDEX_REBUILD; /* Discard any existing index */
+      }
+      else if (strncmp(argv[i], "-l", 2) == 0)
+      {
+         options->mode = options->mode | FL_INDEX_LIST; /* Print the time buckets */
+      }
+      else if (strncmp(argv[i], "-b", 2) == 0)
+      {
+         /* Time bucket size in seconds */
+         if (((i+1) < argc) && (atol(argv[i+1]) > 0))
+         {
+            options->bucket_seconds = (uint32_t)atol(argv[i+1]);
+            i++;
+         }
+         else
+         {
+            print_log_entry("parse_command_line_args() <ERROR> Missing or invalid bucket size.\n");
+            return(-1);
+         }
+      }
+      else if (strncmp(argv[i], "-q", 2) == 0)
+      {
+         /* Time window, "DD/MM/YYYY HH:MM:SS" "DD/MM/YYYY HH:MM:SS" */
+         if ((i+2) < argc)
+         {
+            options->start_time = parse_fle_time(argv[i+1]);
+            options->end_time = parse_fle_time(argv[i+2]);
+            if ((options->start_time == FLB_INVALID_TIME) || (options->end_time == FLB_INVALID_TIME))
+            {
+               print_log_entry("parse_command_line_args() <ERROR> Invalid query time.\n");
+               return(-1);
+            }
+            options->mode = options->mode | FL_INDEX_QUERY;
+            i += 2;
+         }
+         else
+         {
+            print_log_entry("parse_command_line_args() <ERROR> Missing query start and end time.\n");
+            return(-1);
+         }
+      }
+      else if (argv[i][0] == '-')
+      {
+         sprint_log_entry("parse_command_line_args() <ERROR> Unknown option: ", argv[i]);
+         return(-1);
+      }
+      else if (options->file_count < FL_INDEX_MAX_FILES)
+      {
+         options->fle_files[options->file_count++] = argv[i];
+      }
+      else
+      {
+         print_log_entry("parse_command_line_args() <ERROR> Too many event files.\n");
+         return(-1);
+      }
+   }
+
+   if (options->file_count == 0)
+   {
+      print_log_entry("parse_command_line_args() <ERROR> No event files.\n");
+      return(-1);
+   }
+
+   print_log_entry("parse_command_line_args() <INFO> Finished processing command line arguments.\n");
+
+   return(0);
+}
+
+/*
+   Function: index_event_file
+   Purpose : Creates or incrementally updates the sidecar index of an
+             event file.
+   Input   : event file name, options.
+   Return  : returns -1 on error.
+*/
+int index_event_file(char *fle_file_name, fl_index_options_t *options)
+{
+   char flx_file_name[FL_PATH_MAX_LENGTH];
+   int64_t added;
+
+   if (make_flx_file_name(fle_file_name, flx_file_name, FL_PATH_MAX_LENGTH) < 0)
+   {
+      print_log_entry("index_event_file() <ERROR> Event file name too long.\n");
+      return(-1);
+   }
+   if (options->mode & FL_INDEX_REBUILD)
+      remove(flx_file_name);
+
+   added = update_flx_index(fle_file_name, flx_file_name, options->bucket_seconds);
+   if (added < 0)
+   {
+      sprint_log_entry("index_event_file() <ERROR> Could not index event file: ", fle_file_name);
+      return(-1);
+   }
+   printf("%s: %ld new records indexed.\n", fle_file_name, (long)added);
+
+   return(0);
+}
+
+/*
+   Prints the records of one indexed range that fall inside the query
+   window, the range starts on a record boundary.
+*/
+static int print_query_range(uint64_t offset, uint64_t length, uint64_t first_ordinal, uint64_t record_count, void *user_data)
+{
+   struct fl_index_query *query = (struct fl_index_query *)user_data;
+   uint64_t consumed = 0;
+   size_t len;
+   char *time_str, *end;
+   int64_t event_time;
+
+   if (fl_fseek(query->fle_file, offset, SEEK_SET) != 0)
+   {
+      print_log_entry("print_query_range() <ERROR> Could not seek in event file.\n");
+      return(1);
+   }
+
+   while (consumed < length)
+   {
+      /* read one whole line, growing the buffer for long records */
+      len = 0;
+      query->line[0] = '\0';
+      while (fgets(query->line + len, (int)(query->line_capacity - len), query->fle_file) != NULL)
+      {
+         len += strlen(query->line + len);
+         if ((len > 0) && (query->line[len - 1] == '\n'))
+            break;
+         query->line_capacity *= 2;
+         query->line = (char *)xrealloc(query->line, query->line_capacity);
+      }
+      if (len == 0)
+         break;
+      consumed += len;
+
+      if (strncmp(query->line, "<event>", 7) != 0)
+         continue;
+      time_str = strstr(query->line, "<time>");
+      if (time_str == NULL)
+         continue;
+      time_str += 6;
+      end = strchr(time_str, '<');
+      if (end == NULL)
+         continue;
+      *end = '\0';
+      event_time = parse_fle_time(time_str);
+      *end = '<';
+      if ((event_time >= query->start_time) && (event_time <= query->end_time))
+      {
+         fputs(query->line, stdout);
+         query->match_count++;
+      }
+   }
+
+   return(0);
+}
+
+/*
+   Function: query_event_file
+   Purpose : Prints the event records in the query time window.
+   Input   : event file name, options.
+   Return  : returns -1 on error.
+*/
+int query_event_file(char *fle_file_name, fl_index_options_t *options)
+{
+   char flx_file_name[FL_PATH_MAX_LENGTH];
+   struct fl_index_query query;
+   flx_index_t *index;
+   int64_t ranges;
+
+   make_flx_file_name(fle_file_name, flx_file_name, FL_PATH_MAX_LENGTH);
+   index = open_flx_index(flx_file_name);
+   if (index == NULL)
+      return(-1);
+
+   memset(&query, 0, sizeof(query));
+   query.fle_file = fopen(fle_file_name, "rb");
+   if (query.fle_file == NULL)
+   {
+      print_log_entry("query_event_file() <ERROR> Could not open event file.\n");
+      close_flx_index(index);
+      return(-1);
+   }
+   query.start_time = options->start_time;
+   query.end_time = options->end_time;
+   query.line_capacity = FL_MAX_INPUT_STR;
+   query.line = (char *)xmalloc(query.line_capacity);
+
+   ranges = query_flx_time_range(index, options->start_time, options->end_time, print_query_range, &query);
+   printf("%s: %ld records in %ld ranges.\n", fle_file_name, (long)query.match_count, (long)ranges);
+
+   free(query.line);
+   fclose(query.fle_file);
+   close_flx_index(index);
+
+   return(0);
+}
+
+/*
+   Function: list_event_file_index
+   Purpose : Prints the time buckets of an event file index.
+   Input   : event file name.
+   Return  : returns -1 on error.
+*/
+int list_event_file_index(char *fle_file_name)
+{
+   char flx_file_name[FL_PATH_MAX_LENGTH];
+   char time_str[32];
+   flx_index_t *index;
+   flx_bucket_t *bucket;
+   uint32_t i;
+
+   make_flx_file_name(fle_file_name, flx_file_name, FL_PATH_MAX_LENGTH);
+   index = open_flx_index(flx_file_name);
+   if (index == NULL)
+      return(-1);
+
+   printf("%s: %lu records, %lu bytes indexed, %u chunks, %u buckets.\n", fle_file_name,
+          (unsigned long)get_flx_record_count(index), (unsigned long)get_flx_indexed_length(index),
+          get_flx_chunk_count(index), get_flx_bucket_count(index));
+   for (i = 0; i < get_flx_bucket_count(index); i++)
+   {
+      bucket = get_flx_bucket(index, i);
+      format_fle_time(bucket->bucket_time, time_str, 32);
+      printf("%s  %8u records  chunks %u - %u\n", time_str, bucket->record_count, bucket->first_chunk, bucket->last_chunk);
+   }
+   close_flx_index(index);
+
+   return(0);
+}
+
+/* help */
+int show_index_help()
+{
+   printf("\nFineLine Indexer 1.0\n\n");
+   printf("Command: fineline-index <options> FILE.fle [FILE.fle ...]\n\n");
+   printf("Rebuild the index instead of updating it          : -r\n");
+   printf("List the index time buckets                       : -l\n");
+   printf("Specify the time bucket size in seconds           : -b SECONDS\n");
+   printf("Print the events in a time window                 : -q START END\n");
+   printf("\n");
+   printf("Creates or updates the sidecar index FILE.fle.flx of each event\n");
+   printf("file, only records appended since the last run are scanned.\n");
+   printf("Query times are in event file format, for example:\n\n");
+   printf("fineline-index -q \"01/03/2014 09:00:00\" \"01/03/2014 17:00:00\" events.fle\n\n");
+
+   return(0);
+}
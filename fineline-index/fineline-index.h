@@ -0,0 +1,69 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   fineline-index.h
+
+   Title : FineLine Computer Forensics Utilities
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: FineLine event file indexer definitions.
+
+*/
+
+#ifndef FINELINE_INDEX_H
+#define FINELINE_INDEX_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "flbfile.h"
+#include "flxfile.h"
+
+#define FL_INDEX_MAX_FILES    256
+
+#define FL_INDEX_UPDATE   0x01
+#define FL_INDEX_REBUILD  0x02
+#define FL_INDEX_QUERY    0x04
+#define FL_INDEX_LIST     0x08
+
+struct fl_index_options
+{
+   int mode;
+   uint32_t bucket_seconds;
+   int64_t start_time;
+   int64_t end_time;
+   int file_count;
+   char *fle_files[FL_INDEX_MAX_FILES];
+};
+typedef struct fl_index_options fl_index_options_t;
+
+
+/* fineline-index.c */
+
+int parse_command_line_args(int argc, char *argv[], fl_index_options_t *options);
+int index_event_file(char *fle_file_name, fl_index_options_t *options);
+int query_event_file(char *fle_file_name, fl_index_options_t *options);
+int list_event_file_index(char *fle_file_name);
+int show_index_help();
+
+#endif
@@ -0,0 +1,608 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   fineline-merge.c
+
+   Title : FineLine Computer Forensics Utilities
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: FineLine event file merge. Combines the time sorted event files
+            written by fineline, fineline-ie, fineline-iepre10, fineline-ws
+            and fineline-sensor into a single super-timeline.
+
+            Only the current record of each input is held in memory, the
+            inputs are kept in a binary min heap ordered by event time and
+            input number and the heap top is written and replaced with the
+            next record from the same input.
+
+            Duplicate events, the same record in overlapping copies of a
+            log, are dropped by hashing the id, time, type, summary and
+            data of each record. The evidence number and the GUI state
+            tags are not part of the identity.
+
+   Notes: An input that is not sorted is still merged but the output is
+          only sorted as far as the inputs are, a warning is logged.
+
+*/
+
+#include <time.h>
+
+#include "flcommon.h"
+#include "fineline-merge.h"
+
+
+int main(int argc, char *argv[])
+{
+   fl_merge_options_t options;
+   int ret = 0;
+   int res = open_log_file(argv[0]);
+
+   if (res < 0)
+   {
+      printf("fineline-merge.c main() <ERROR> Could not open log file.\n");
+      exit(FILE_ERROR);
+   }
+   print_log_entry("fineline-merge.c main() <INFO> Starting FineLine Merge 1.0\n");
+
+   if (parse_command_line_args(argc, argv, &options) < 0)
+   {
+      print_log_entry("fineline-merge.c main() <ERROR> Invalid command line options!\n");
+      show_merge_help();
+      close_log_file();
+      exit(SYSTEM_ERROR);
+   }
+
+   if (merge_event_files(&options) < 0)
+      ret = FILE_ERROR;
+
+   close_log_file();
+
+   exit(ret);
+}
+
+/*
+   Function: parse_command_line_args
+   Purpose : Validates command line arguments, every argument that is not
+             an option is an input event file.
+   Input   : argc, argv, options.
+   Return  : returns -1 on error.
+*/
+int parse_command_line_args(int argc, char *argv[], fl_merge_options_t *options)
+{
+   char timestr[100];
+   int tlen, i;
+
+   memset(options, 0, sizeof(fl_merge_options_t));
+   options->mode = FL_FILE_OUT;
+
+   /* Build the default output filename, fineline-merged-YYYYMMDD-HHMMSS.fle */
+   strcpy(options->output_file, FL_MERGE_FILE);
+   tlen = get_time_string(timestr, 99);
+   if (tlen > 0)
+   {
+      strncat(options->output_file, timestr, tlen);
+   }
+   strcat(options->output_file, EVENT_FILE_EXT);
+
+   for (i = 1; i < argc; i++)
+   {
+      if (strncmp(argv[i], "-n", 2) == 0)
+      {
+         options->mode = options->mode | FL_MERGE_NO_DEDUP; /* Keep duplicate events */
+      }
+      else if (strncmp(argv[i], "-o", 2) == 0)
+      {
+         /* Output file name */
+         if (((i+1) < argc) && (strlen(argv[i+1]) < FL_PATH_MAX_LENGTH))
+         {
+            strcpy(options->output_file, argv[i+1]);
+            i++;
+         }
+         else
+         {
+            print_log_entry("parse_command_line_args() <ERROR> Missing output file name.\n");
+            return(-1);
+         }
+      }
+      else if (strncmp(argv[i], "-F", 2) == 0)
+      {
+         /* Output file format, fle (default) or flb */
+         if ((i+1) < argc)
+         {
+            if (strncmp(argv[i+1], "flb", 3) == 0)
+            {
+               options->mode = options->mode | FL_FLB_OUT;
+            }
+            else if (strncmp(argv[i+1], "fle", 3) != 0)
+            {
+               print_log_entry("parse_command_line_args() <ERROR> Unknown output file format.\n");
+               return(-1);
+            }
+            i++;
+         }
+         else
+         {
+            print_log_entry("parse_command_line_args() <ERROR> Missing output file format.\n");
+            return(-1);
+         }
+      }
+      else if (argv[i][0] == '-')
+      {
+         sprint_log_entry("parse_command_line_args() <ERROR> Unknown option: ", argv[i]);
+         return(-1);
+      }
+      else if (options->file_count < FL_MERGE_MAX_FILES)
+      {
+         options->input_files[options->file_count++] = argv[i];
+      }
+      else
+      {
+         print_log_entry("parse_command_line_args() <ERROR> Too many input event files.\n");
+         return(-1);
+      }
+   }
+
+   if (options->file_count == 0)
+   {
+      print_log_entry("parse_command_line_args() <ERROR> No input event files.\n");
+      return(-1);
+   }
+
+   /* binary timeline output replaces the .fle extension of the output file */
+   if (options->mode & FL_FLB_OUT)
+   {
+      size_t flen = strlen(options->output_file);
+      if ((flen > 4) && (strcmp(options->output_file + flen - 4, EVENT_FILE_EXT) == 0))
+      {
+         strcpy(options->output_file + flen - 4, FLB_FILE_EXT);
+      }
+   }
+
+   print_log_entry("parse_command_line_args() <INFO> Finished processing command line arguments.\n");
+
+   return(0);
+}
+
+/*
+   Function: read_next_event
+   Purpose : Reads the next event record of an input, the project header
+             and any other non-event lines are skipped.
+   Input   : merge input.
+   Return  : returns 1 if a record was read, 0 at end of file.
+*/
+int read_next_event(fl_merge_input_t *input)
+{
+   char *time_str, *end;
+   size_t len;
+
+   for (;;)
+   {
+      len = 0;
+      while (fgets(input->line + len, (int)(input->line_capacity - len), input->file) != NULL)
+      {
+         len += strlen(input->line + len);
+         if ((len > 0) && (input->line[len - 1] == '\n'))
+            break;
+         input->line_capacity *= 2;
+         input->line = (char *)xrealloc(input->line, input->line_capacity);
+      }
+      if (len == 0)
+         return(0);
+      if (strncmp(input->line, "<event>", 7) == 0)
+         break;
+   }
+
+   /* the last record in a file may not have a newline */
+   if (input->line[len - 1] != '\n')
+   {
+      if (len + 2 > input->line_capacity)
+      {
+         input->line_capacity = len + 2;
+         input->line = (char *)xrealloc(input->line, input->line_capacity);
+      }
+      input->line[len++] = '\n';
+      input->line[len] = '\0';
+   }
+   input->line_length = len;
+   input->record_count++;
+
+   input->event_time = FLB_INVALID_TIME;
+   time_str = strstr(input->line, "<time>");
+   if (time_str != NULL)
+   {
+      time_str += 6;
+      end = strchr(time_str, '<');
+      if (end != NULL)
+      {
+         *end = '\0';
+         input->event_time = parse_fle_time(time_str);
+         *end = '<';
+      }
+   }
+
+   return(1);
+}
+
+static void append_bytes(char **buffer, size_t *length, size_t *capacity, char *bytes, size_t count)
+{
+   if (*length + count > *capacity)
+   {
+      while (*length + count > *capacity)
+         *capacity = (*capacity > 0) ? *capacity * 2 : FL_MAX_INPUT_STR;
+      *buffer = (char *)xrealloc(*buffer, *capacity);
+   }
+   memcpy(*buffer + *length, bytes, count);
+   *length += count;
+
+   return;
+}
+
+static uint64_t hash_tag_value(char *record, char *open_tag, char *close_tag, uint64_t h, fl_merge_dedup_t *dedup)
+{
+   char *start, *end;
+   char separator = (char)0xff;
+
+   start = strstr(record, open_tag);
+   if (start != NULL)
+   {
+      start += strlen(open_tag);
+      end = strstr(start, close_tag);
+      if (end == NULL)
+         end = start + strlen(start);
+      append_bytes(&dedup->record, &dedup->record_length, &dedup->record_capacity, start, end - start);
+      while (start < end)
+      {
+         h ^= (unsigned char)*start++;
+         h *= 1099511628211ULL;
+      }
+   }
+   append_bytes(&dedup->record, &dedup->record_length, &dedup->record_capacity, &separator, 1);
+   h ^= 0xff; /* field separator */
+   h *= 1099511628211ULL;
+
+   return(h);
+}
+
+/*
+   Function: get_record_identity
+   Purpose : FNV-1a hash of the fields that identify an event record, the
+             fields are also copied to the dedup record buffer so a hash
+             match can be checked.
+   Input   : event record string and the duplicate window.
+   Return  : identity hash.
+*/
+uint64_t get_record_identity(char *record, fl_merge_dedup_t *dedup)
+{
+   uint64_t h = 14695981039346656037ULL;
+
+   dedup->record_length = 0;
+   h = hash_tag_value(record, "<id>", "</id>", h, dedup);
+   h = hash_tag_value(record, "<time>", "</time>", h, dedup);
+   h = hash_tag_value(record, "<type>", "</type>", h, dedup);
+   h = hash_tag_value(record, "<summary>", "</summary>", h, dedup);
+   h = hash_tag_value(record, "<data>", "</data>", h, dedup);
+
+   return(h);
+}
+
+/*
+   Returns 1 if a record with the same identity fields is already in the
+   window, otherwise adds the record in the dedup record buffer.
+*/
+static int check_duplicate(fl_merge_dedup_t *dedup, int64_t event_time, uint64_t identity)
+{
+   uint32_t slot, i, old_capacity;
+   uint64_t *old_keys;
+   uint32_t *old_generations;
+   size_t *old_offsets, *old_lengths;
+
+   if (event_time != dedup->window_time)
+   {
+      dedup->window_time = event_time;
+      dedup->generation++;
+      dedup->count = 0;
+      dedup->fields_length = 0;
+   }
+
+   if ((dedup->count + 1) * 2 > dedup->capacity)
+   {
+      /* grow the window and rehash the current generation */
+      old_keys = dedup->keys;
+      old_generations = dedup->generations;
+      old_offsets = dedup->field_offsets;
+      old_lengths = dedup->field_lengths;
+      old_capacity = dedup->capacity;
+      dedup->capacity = old_capacity * 2;
+      dedup->keys = (uint64_t *)xcalloc(dedup->capacity * sizeof(uint64_t));
+      dedup->generations = (uint32_t *)xcalloc(dedup->capacity * sizeof(uint32_t));
+      dedup->field_offsets = (size_t *)xcalloc(dedup->capacity * sizeof(size_t));
+      dedup->field_lengths = (size_t *)xcalloc(dedup->capacity * sizeof(size_t));
+      for (i = 0; i < old_capacity; i++)
+      {
+         if (old_generations[i] != dedup->generation)
+            continue;
+         slot = (uint32_t)old_keys[i] & (dedup->capacity - 1);
+         while (dedup->generations[slot] == dedup->generation)
+            slot = (slot + 1) & (dedup->capacity - 1);
+         dedup->keys[slot] = old_keys[i];
+         dedup->generations[slot] = dedup->generation;
+         dedup->field_offsets[slot] = old_offsets[i];
+         dedup->field_lengths[slot] = old_lengths[i];
+      }
+      free(old_keys);
+      free(old_generations);
+      free(old_offsets);
+      free(old_lengths);
+   }
+
+   slot = (uint32_t)identity & (dedup->capacity - 1);
+   while (dedup->generations[slot] == dedup->generation)
+   {
+      /* the hash only picks the candidates, the fields decide */
+      if ((dedup->keys[slot] == identity) && (dedup->field_lengths[slot] == dedup->record_length) &&
+          (memcmp(dedup->fields + dedup->field_offsets[slot], dedup->record, dedup->record_length) == 0))
+         return(1);
+      slot = (slot + 1) & (dedup->capacity - 1);
+   }
+   dedup->keys[slot] = identity;
+   dedup->generations[slot] = dedup->generation;
+   dedup->field_offsets[slot] = dedup->fields_length;
+   dedup->field_lengths[slot] = dedup->record_length;
+   append_bytes(&dedup->fields, &dedup->fields_length, &dedup->fields_capacity, dedup->record, dedup->record_length);
+   dedup->count++;
+
+   return(0);
+}
+
+static int input_less(fl_merge_input_t *a, fl_merge_input_t *b)
+{
+   if (a->event_time != b->event_time)
+      return(a->event_time < b->event_time);
+   return(a->input_number < b->input_number);
+}
+
+static void heap_sift_down(fl_merge_input_t **heap, int heap_size, int i)
+{
+   fl_merge_input_t *tmp;
+   int child;
+
+   for (;;)
+   {
+      child = i * 2 + 1;
+      if (child >= heap_size)
+         break;
+      if ((child + 1 < heap_size) && input_less(heap[child + 1], heap[child]))
+         child++;
+      if (!input_less(heap[child], heap[i]))
+         break;
+      tmp = heap[i];
+      heap[i] = heap[child];
+      heap[child] = tmp;
+      i = child;
+   }
+}
+
+static int write_merge_header(FILE *out_file, fl_merge_input_t *first, int file_count)
+{
+   char start_date_time_string[32];
+   char description[64];
+   char hdr[FL_MAX_INPUT_STR];
+   time_t curtime;
+   char *time_str;
+
+   strcpy(start_date_time_string, "NONE");
+   if ((first != NULL) && (first->event_time != FLB_INVALID_TIME))
+      format_fle_time(first->event_time, start_date_time_string, 32);
+
+   curtime = time(NULL);
+   time_str = asctime(localtime(&curtime));
+   sprintf(description, "Merged timeline of %d event files", file_count);
+
+   strcpy(hdr, "<project><name>FineLine Project ");
+   strncat(hdr, time_str, strlen(time_str) - 1);
+   strcat(hdr, "</name><investigator>NONE</investigator><summary>NONE</summary><startdate>");
+   strcat(hdr, start_date_time_string);
+   strcat(hdr, "</startdate><enddate>NONE</enddate><description>");
+   strcat(hdr, description);
+   strcat(hdr, "</description></project>\n");
+   fputs(hdr, out_file);
+
+   return(0);
+}
+
+/*
+   Function: merge_event_files
+   Purpose : Streams the inputs through the heap into the output file.
+   Input   : options.
+   Return  : returns -1 on error.
+*/
+int merge_event_files(fl_merge_options_t *options)
+{
+   fl_merge_input_t *inputs;
+   fl_merge_input_t **heap;
+   fl_merge_input_t *top;
+   fl_merge_dedup_t dedup;
+   fl_sink_list_t sinks;
+   flb_writer_t *flb_writer = NULL;
+   fl_merge_input_t *last_source = NULL;
+   FILE *out_file = NULL;
+   unsigned long written = 0, duplicates = 0, read_total = 0;
+   char msg[256];
+   int heap_size = 0;
+   int i, ret = 0;
+
+   init_sink_list(&sinks);
+   inputs = (fl_merge_input_t *)xcalloc(options->file_count * sizeof(fl_merge_input_t));
+   heap = (fl_merge_input_t **)xcalloc(options->file_count * sizeof(fl_merge_input_t *));
+
+   for (i = 0; i < options->file_count; i++)
+   {
+      inputs[i].file_name = options->input_files[i];
+      inputs[i].input_number = i;
+      inputs[i].file = fopen(inputs[i].file_name, "r");
+      if (inputs[i].file == NULL)
+      {
+         sprint_log_entry("merge_event_files() <ERROR> Could not open event file: ", inputs[i].file_name);
+         ret = -1;
+         break;
+      }
+      inputs[i].line_capacity = FL_MAX_INPUT_STR;
+      inputs[i].line = (char *)xmalloc(inputs[i].line_capacity);
+      if (read_next_event(&inputs[i]) == 1)
+      {
+         inputs[i].last_time = inputs[i].event_time;
+         heap[heap_size++] = &inputs[i];
+      }
+   }
+
+   if (ret == 0)
+   {
+      for (i = heap_size / 2 - 1; i >= 0; i--)
+         heap_sift_down(heap, heap_size, i);
+
+      if (options->mode & FL_FLB_OUT)
+      {
+         flb_writer = open_flb_writer(options->output_file, NULL);
+         if (flb_writer == NULL)
+            ret = -1;
+      }
+      else
+      {
+         out_file = fopen(options->output_file, "w");
+         if (out_file == NULL)
+         {
+            ret = -1;
+         }
+         else
+         {
+            write_merge_header(out_file, (heap_size > 0) ? heap[0] : NULL, options->file_count);
+            add_file_sink(&sinks, out_file, 0);
+         }
+      }
+      if (ret < 0)
+         sprint_log_entry("merge_event_files() <ERROR> Could not open output file: ", options->output_file);
+   }
+
+   if (ret == 0)
+   {
+      memset(&dedup, 0, sizeof(dedup));
+      dedup.capacity = FL_MERGE_DEDUP_SLOTS;
+      dedup.keys = (uint64_t *)xcalloc(dedup.capacity * sizeof(uint64_t));
+      dedup.generations = (uint32_t *)xcalloc(dedup.capacity * sizeof(uint32_t));
+      dedup.field_offsets = (size_t *)xcalloc(dedup.capacity * sizeof(size_t));
+      dedup.field_lengths = (size_t *)xcalloc(dedup.capacity * sizeof(size_t));
+      dedup.generation = 1;
+      dedup.window_time = FLB_INVALID_TIME;
+
+      while (heap_size > 0)
+      {
+         top = heap[0];
+         read_total++;
+
+         if ((options->mode & FL_MERGE_NO_DEDUP) || !check_duplicate(&dedup, top->event_time, get_record_identity(top->line, &dedup)))
+         {
+            if (flb_writer != NULL)
+            {
+               /* the events keep the name of the file they came from as their source */
+               if (top != last_source)
+               {
+                  set_flb_writer_source(flb_writer, top->file_name);
+                  last_source = top;
+               }
+               if (write_flb_record_string(flb_writer, top->line, top->line_length - 1) < 0)
+                  ret = -1;
+            }
+            else if (write_sink_record(&sinks, top->line, top->line_length) < 0)
+            {
+               ret = -1;
+            }
+            written++;
+         }
+         else
+         {
+            duplicates++;
+         }
+
+         if (read_next_event(top) == 1)
+         {
+            if (top->event_time < top->last_time)
+            {
+               if (top->out_of_order == 0)
+                  sprint_log_entry("merge_event_files() <WARNING> Event file is not sorted by time: ", top->file_name);
+               top->out_of_order++;
+            }
+            else
+            {
+               top->last_time = top->event_time;
+            }
+         }
+         else
+         {
+            heap[0] = heap[--heap_size];
+         }
+         heap_sift_down(heap, heap_size, 0);
+      }
+
+      free(dedup.keys);
+      free(dedup.generations);
+      free(dedup.field_offsets);
+      free(dedup.field_lengths);
+      free(dedup.fields);
+      free(dedup.record);
+   }
+
+   close_sinks(&sinks);
+   if (out_file != NULL)
+      fclose(out_file);
+   if ((flb_writer != NULL) && (close_flb_writer(flb_writer) < 0))
+      ret = -1;
+
+   for (i = 0; i < options->file_count; i++)
+   {
+      if (inputs[i].file != NULL)
+         fclose(inputs[i].file);
+      free(inputs[i].line);
+   }
+   free(inputs);
+   free(heap);
+
+   sprintf(msg, "merge_event_files() <INFO> Read %lu events, wrote %lu, dropped %lu duplicates.\n", read_total, written, duplicates);
+   print_log_entry(msg);
+   if (ret == 0)
+      printf("%s: %lu events from %d files, %lu duplicates dropped.\n", options->output_file, written, options->file_count, duplicates);
+
+   return(ret);
+}
+
+/* help */
+int show_merge_help()
+{
+   printf("\nFineLine Merge 1.0\n\n");
+   printf("Command: fineline-merge <options> FILE.fle [FILE.fle ...]\n\n");
+   printf("Specify fineline output filename                  : -o FILENAME\n");
+   printf("Specify output file format (fle or flb)           : -F FORMAT\n");
+   printf("Keep duplicate events                             : -n\n");
+   printf("\n");
+   printf("Merges time sorted event files from any of the FineLine tools into\n");
+   printf("a single timeline, duplicate events are dropped. The default output\n");
+   printf("file is fineline-merged-YYYYMMDD-HHMMSS.fle\n\n");
+
+   return(0);
+}
@@ -0,0 +1,108 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   fineline-merge.h
+
+   Title : FineLine Computer Forensics Utilities
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: FineLine event file merge definitions.
+
+*/
+
+#ifndef FINELINE_MERGE_H
+#define FINELINE_MERGE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "flsink.h"
+#include "flbfile.h"
+
+#define FL_MERGE_MAX_FILES     1024
+#define FL_MERGE_FILE          "fineline-merged"
+#define FL_MERGE_DEDUP_SLOTS   1024      /* initial size of the duplicate window, a power of 2 */
+
+#define FL_MERGE_NO_DEDUP  0x100
+
+/* one input event file and its current event record */
+struct fl_merge_input
+{
+   char *file_name;
+   FILE *file;
+   char *line;
+   size_t line_capacity;
+   size_t line_length;
+   int64_t event_time;
+   int64_t last_time;
+   unsigned long record_count;
+   unsigned long out_of_order;
+   int input_number;
+};
+typedef struct fl_merge_input fl_merge_input_t;
+
+/*
+   Identity hashes of the records already written for the current event
+   time. The inputs are sorted so a duplicate always has the same time as
+   the record it duplicates, moving to a new time clears the window by
+   bumping the generation. The identity fields of each record are kept in
+   the window too, a hash match is only a duplicate if the fields match.
+*/
+struct fl_merge_dedup
+{
+   uint64_t *keys;
+   uint32_t *generations;
+   size_t *field_offsets;    /* start of each record's identity fields in the field buffer */
+   size_t *field_lengths;
+   uint32_t capacity;
+   uint32_t count;
+   uint32_t generation;
+   int64_t window_time;
+   char *fields;             /* identity fields of the records in the window */
+   size_t fields_length;
+   size_t fields_capacity;
+   char *record;             /* identity fields of the record being checked */
+   size_t record_length;
+   size_t record_capacity;
+};
+typedef struct fl_merge_dedup fl_merge_dedup_t;
+
+struct fl_merge_options
+{
+   int mode;
+   int file_count;
+   char *input_files[FL_MERGE_MAX_FILES];
+   char output_file[FL_PATH_MAX_LENGTH];
+};
+typedef struct fl_merge_options fl_merge_options_t;
+
+
+/* fineline-merge.c */
+
+int parse_command_line_args(int argc, char *argv[], fl_merge_options_t *options);
+int merge_event_files(fl_merge_options_t *options);
+int read_next_event(fl_merge_input_t *input);
+uint64_t get_record_identity(char *record, fl_merge_dedup_t *dedup);
+int show_merge_help();
+
+#endif
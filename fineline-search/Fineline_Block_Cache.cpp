@@ -0,0 +1,378 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Block_Cache.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Sharded LRU page cache with sequential readahead for forensic
+            image reads. Reads of FL_CACHE_BYPASS_SIZE or more, e.g. a file
+            export copying whole runs, are not cached so they do not push the
+            file system metadata out of the cache.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Fineline_Block_Cache.h"
+#include "../common/Fineline_Util.h"
+
+#define FL_CACHE_PAGE_BITS 44   /* page number bits in a cache key, the image id is above them */
+
+Fineline_Block_Cache::Fineline_Block_Cache(size_t cache_size)
+{
+   page_count = 0;
+   set_cache_size(cache_size);
+   reset_statistics();
+}
+
+Fineline_Block_Cache::~Fineline_Block_Cache()
+{
+   clear();
+}
+
+/*
+   Function: get_shard
+   Purpose : Picks the LRU list for a page, neighbouring pages go to different lists.
+   Input   : Cache key.
+   Output  : The shard.
+*/
+fl_cache_shard_t *Fineline_Block_Cache::get_shard(uint64_t key)
+{
+   uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+
+   return(&shards[(h >> 32) % FL_CACHE_SHARDS]);
+}
+
+/*
+   Function: copy_page
+   Purpose : Copies part of a cached page and moves the page to the front of its list.
+   Input   : Cache key, offset in the page, destination buffer and length.
+   Output  : Returns the bytes copied, fewer at the end of the image, -1 if the page is not cached.
+*/
+ssize_t Fineline_Block_Cache::copy_page(uint64_t key, size_t page_offset, char *buffer, size_t length)
+{
+   fl_cache_shard_t *shard = get_shard(key);
+   unordered_map< uint64_t, list<fl_cache_page_t>::iterator >::iterator p;
+
+   lock_guard<mutex> guard(shard->shard_lock);
+
+   p = shard->pages.find(key);
+   if (p == shard->pages.end())
+      return(-1);
+
+   shard->lru.splice(shard->lru.begin(), shard->lru, p->second);
+
+   if (page_offset >= p->second->length)
+      return(0);
+   if (length > p->second->length - page_offset)
+      length = p->second->length - page_offset;
+   memcpy(buffer, p->second->data + page_offset, length);
+
+   return((ssize_t)length);
+}
+
+/*
+   Function: trim_shard
+   Purpose : Drops the least recently used pages of a list until it fits the
+             capacity. Caller must hold the shard lock.
+   Input   : The shard.
+   Output  : None.
+*/
+void Fineline_Block_Cache::trim_shard(fl_cache_shard_t *shard)
+{
+   size_t capacity = shard_capacity.load();
+
+   while (shard->lru.size() > capacity)
+   {
+      fl_cache_page_t &page = shard->lru.back();
+      shard->pages.erase(page.key);
+      Fineline_Util::xfree(page.data, FL_CACHE_PAGE_SIZE);
+      shard->lru.pop_back();
+      page_count--;
+      evictions++;
+   }
+
+   return;
+}
+
+/*
+   Function: insert_page
+   Purpose : Adds a page to the front of its list, reusing the buffer of the
+             least recently used page when the list is full.
+   Input   : Cache key, page data and length.
+   Output  : None.
+*/
+void Fineline_Block_Cache::insert_page(uint64_t key, const char *data, size_t length)
+{
+   fl_cache_shard_t *shard = get_shard(key);
+   unordered_map< uint64_t, list<fl_cache_page_t>::iterator >::iterator p;
+   fl_cache_page_t page;
+
+   lock_guard<mutex> guard(shard->shard_lock);
+
+   if (shard_capacity.load() == 0)
+      return;
+
+   p = shard->pages.find(key);
+   if (p != shard->pages.end()) // another thread read it first
+   {
+      shard->lru.splice(shard->lru.begin(), shard->lru, p->second);
+      return;
+   }
+
+   if (shard->lru.size() >= shard_capacity.load())
+   {
+      page = shard->lru.back();
+      shard->pages.erase(page.key);
+      shard->lru.pop_back();
+      evictions++;
+   }
+   else
+   {
+      page.data = (char *)Fineline_Util::xmalloc(FL_CACHE_PAGE_SIZE);
+      page_count++;
+   }
+
+   page.key = key;
+   page.length = length;
+   memcpy(page.data, data, length);
+   shard->lru.push_front(page);
+   shard->pages[key] = shard->lru.begin();
+
+   return;
+}
+
+/*
+   Function: fill_pages
+   Purpose : Reads one or more pages from the image in a single read, caches
+             them and copies the requested part of the first page.
+   Input   : Image id, image reader and its context, first page, number of
+             pages, offset in the first page, destination buffer and length.
+   Output  : Returns the bytes copied, 0 at the end of the image, -1 on a read error.
+*/
+ssize_t Fineline_Block_Cache::fill_pages(int image_id, fl_cache_read_func reader, void *context, uint64_t page, int read_count, size_t page_offset, char *buffer, size_t length)
+{
+   size_t read_size = (size_t)read_count * FL_CACHE_PAGE_SIZE;
+   char *data = (char *)Fineline_Util::xmalloc(read_size);
+   ssize_t n = reader(context, (int64_t)(page * FL_CACHE_PAGE_SIZE), data, read_size);
+   size_t done = 0;
+   size_t page_length;
+   uint64_t i;
+
+   if (n < 0)
+   {
+      Fineline_Util::xfree(data, read_size);
+      return(-1);
+   }
+
+   for (i = 0; done < (size_t)n; i++)
+   {
+      page_length = (size_t)n - done;
+      if (page_length > FL_CACHE_PAGE_SIZE)
+         page_length = FL_CACHE_PAGE_SIZE;
+      insert_page(((uint64_t)image_id << FL_CACHE_PAGE_BITS) | (page + i), data + done, page_length);
+      done += page_length;
+   }
+   if (i > 1)
+      readahead_pages += (i - 1);
+
+   if (page_offset >= (size_t)n)
+      length = 0;
+   else if (length > (size_t)n - page_offset)
+      length = (size_t)n - page_offset;
+   memcpy(buffer, data + page_offset, length);
+
+   Fineline_Util::xfree(data, read_size);
+
+   return((ssize_t)length);
+}
+
+/*
+   Function: read
+   Purpose : Reads image data through the cache. Each page missed is read from
+             the image, with more pages read ahead while the handle keeps
+             missing on the next page.
+   Input   : Image id, handle readahead state or NULL, image reader and its
+             context, image offset, destination buffer and length.
+   Output  : Returns the bytes read, fewer at the end of the image, -1 on error.
+*/
+ssize_t Fineline_Block_Cache::read(int image_id, fl_cache_stream_t *stream, fl_cache_read_func reader, void *context, int64_t offset, char *buffer, size_t length)
+{
+   size_t done = 0;
+   size_t page_offset, want;
+   uint64_t page;
+   ssize_t n;
+   int read_count;
+
+   if ((length >= FL_CACHE_BYPASS_SIZE) || (shard_capacity.load() == 0))
+   {
+      bypass_reads++;
+      return(reader(context, offset, buffer, length));
+   }
+
+   while (done < length)
+   {
+      page = (uint64_t)(offset + done) / FL_CACHE_PAGE_SIZE;
+      page_offset = (size_t)((uint64_t)(offset + done) % FL_CACHE_PAGE_SIZE);
+      want = FL_CACHE_PAGE_SIZE - page_offset;
+      if (want > length - done)
+         want = length - done;
+
+      n = copy_page(((uint64_t)image_id << FL_CACHE_PAGE_BITS) | page, page_offset, buffer + done, want);
+      if (n >= 0)
+      {
+         hits++;
+      }
+      else
+      {
+         misses++;
+         read_count = 1;
+         if (stream != NULL)
+         {
+            if (page == stream->next_page)
+            {
+               if (stream->run_length < 16)
+                  stream->run_length++;
+               read_count = 1 << stream->run_length;
+               if (read_count > FL_CACHE_READAHEAD_MAX)
+                  read_count = FL_CACHE_READAHEAD_MAX;
+            }
+            else
+            {
+               stream->run_length = 0;
+            }
+            stream->next_page = page + read_count;
+         }
+
+         n = fill_pages(image_id, reader, context, page, read_count, page_offset, buffer + done, want);
+         if (n < 0)
+            return((done > 0) ? (ssize_t)done : -1);
+      }
+
+      done += (size_t)n;
+      if ((size_t)n < want) // end of the image
+         break;
+   }
+
+   return((ssize_t)done);
+}
+
+/*
+   Function: set_cache_size
+   Purpose : Sets the cache size, 0 turns the cache off. Pages over the new
+             size are dropped straight away.
+   Input   : Cache size in bytes.
+   Output  : None.
+*/
+void Fineline_Block_Cache::set_cache_size(size_t cache_size)
+{
+   int i;
+
+   shard_capacity = (cache_size / FL_CACHE_PAGE_SIZE) / FL_CACHE_SHARDS;
+   if ((cache_size > 0) && (shard_capacity.load() == 0))
+      shard_capacity = 1;
+
+   for (i = 0; i < FL_CACHE_SHARDS; i++)
+   {
+      lock_guard<mutex> guard(shards[i].shard_lock);
+      trim_shard(&shards[i]);
+   }
+
+   return;
+}
+
+size_t Fineline_Block_Cache::get_cache_size()
+{
+   return(shard_capacity.load() * FL_CACHE_SHARDS * FL_CACHE_PAGE_SIZE);
+}
+
+/*
+   Function: clear
+   Purpose : Drops every cached page, e.g. when a new image is opened.
+   Input   : None.
+   Output  : None.
+*/
+void Fineline_Block_Cache::clear()
+{
+   list<fl_cache_page_t>::iterator p;
+   int i;
+
+   for (i = 0; i < FL_CACHE_SHARDS; i++)
+   {
+      lock_guard<mutex> guard(shards[i].shard_lock);
+      for (p = shards[i].lru.begin(); p != shards[i].lru.end(); p++)
+         Fineline_Util::xfree(p->data, FL_CACHE_PAGE_SIZE);
+      page_count -= shards[i].lru.size();
+      shards[i].lru.clear();
+      shards[i].pages.clear();
+   }
+
+   return;
+}
+
+fl_cache_statistics_t Fineline_Block_Cache::get_statistics()
+{
+   fl_cache_statistics_t stats;
+
+   stats.hits = hits.load();
+   stats.misses = misses.load();
+   stats.readahead_pages = readahead_pages.load();
+   stats.evictions = evictions.load();
+   stats.bypass_reads = bypass_reads.load();
+   stats.page_count = page_count.load();
+   stats.page_capacity = shard_capacity.load() * FL_CACHE_SHARDS;
+
+   return(stats);
+}
+
+/*
+   Function: get_statistics_string
+   Purpose : Formats the cache statistics for the progress dialog and the log.
+   Input   : None.
+   Output  : The statistics line.
+*/
+string Fineline_Block_Cache::get_statistics_string()
+{
+   fl_cache_statistics_t stats = get_statistics();
+   uint64_t total = stats.hits + stats.misses;
+   char line[512];
+
+   sprintf(line, "Image cache: %llu hits, %llu misses (%.1f%% hit rate), %llu pages read ahead, %llu evictions, %llu uncached reads, %lu of %lu pages used.",
+           (unsigned long long)stats.hits, (unsigned long long)stats.misses, (total > 0) ? (100.0 * stats.hits) / total : 0.0,
+           (unsigned long long)stats.readahead_pages, (unsigned long long)stats.evictions, (unsigned long long)stats.bypass_reads,
+           (unsigned long)stats.page_count, (unsigned long)stats.page_capacity);
+
+   return(string(line));
+}
+
+void Fineline_Block_Cache::reset_statistics()
+{
+   hits = 0;
+   misses = 0;
+   readahead_pages = 0;
+   evictions = 0;
+   bypass_reads = 0;
+}
@@ -0,0 +1,132 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Block_Cache.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Shared read cache for forensic image data. The image is cached in
+            large pages held in a number of LRU lists, each with its own lock,
+            so the threads reading the same image through their own handles
+            share the pages without waiting on each other. A reader that misses
+            on the page after its last miss is reading sequentially, each such
+            miss doubles the number of pages read ahead in one image read. This
+            matters most for compressed E01 images, where every chunk read has
+            to be decompressed again.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#ifndef FINELINE_BLOCK_CACHE_H
+#define FINELINE_BLOCK_CACHE_H
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define FL_CACHE_PAGE_SIZE      65536       /* bytes per cache page */
+#define FL_CACHE_SHARDS         16          /* LRU lists, each with its own lock */
+#define FL_CACHE_DEFAULT_SIZE   268435456   /* 256 MB */
+#define FL_CACHE_READAHEAD_MAX  32          /* pages read in one go on a sequential run */
+#define FL_CACHE_BYPASS_SIZE    1048576     /* larger reads go straight to the image */
+
+using namespace std;
+
+/* Reads image data for the cache, returns the bytes read, 0 at the end of the image or -1 on error. */
+typedef ssize_t (*fl_cache_read_func)(void *context, int64_t offset, char *buffer, size_t length);
+
+struct fl_cache_page
+{
+   uint64_t key;                    /* image id and page number */
+   char *data;
+   size_t length;                   /* less than a page at the end of the image */
+};
+typedef struct fl_cache_page fl_cache_page_t;
+
+struct fl_cache_shard
+{
+   mutex shard_lock;
+   list<fl_cache_page_t> lru;       /* most recently used first */
+   unordered_map< uint64_t, list<fl_cache_page_t>::iterator > pages;
+};
+typedef struct fl_cache_shard fl_cache_shard_t;
+
+/* Readahead state of one image handle, only used by the thread reading through the handle. */
+struct fl_cache_stream
+{
+   uint64_t next_page;              /* page after the last page read from the image */
+   int run_length;                  /* sequential misses in a row */
+};
+typedef struct fl_cache_stream fl_cache_stream_t;
+
+struct fl_cache_statistics
+{
+   uint64_t hits;
+   uint64_t misses;
+   uint64_t readahead_pages;        /* pages read before they were asked for */
+   uint64_t evictions;
+   uint64_t bypass_reads;
+   size_t page_count;
+   size_t page_capacity;
+};
+typedef struct fl_cache_statistics fl_cache_statistics_t;
+
+class Fineline_Block_Cache
+{
+   public:
+      Fineline_Block_Cache(size_t cache_size = FL_CACHE_DEFAULT_SIZE);
+      virtual ~Fineline_Block_Cache();
+
+      ssize_t read(int image_id, fl_cache_stream_t *stream, fl_cache_read_func reader, void *context, int64_t offset, char *buffer, size_t length);
+      void set_cache_size(size_t cache_size);
+      size_t get_cache_size();
+      void clear();
+      fl_cache_statistics_t get_statistics();
+      string get_statistics_string();
+      void reset_statistics();
+
+   protected:
+   private:
+
+      fl_cache_shard_t *get_shard(uint64_t key);
+      ssize_t copy_page(uint64_t key, size_t page_offset, char *buffer, size_t length);
+      void insert_page(uint64_t key, const char *data, size_t length);
+      ssize_t fill_pages(int image_id, fl_cache_read_func reader, void *context, uint64_t page, int read_count, size_t page_offset, char *buffer, size_t length);
+      void trim_shard(fl_cache_shard_t *shard);
+
+      fl_cache_shard_t shards[FL_CACHE_SHARDS];
+      atomic<size_t> shard_capacity;          /* pages per shard */
+      atomic<size_t> page_count;
+      atomic<uint64_t> hits;
+      atomic<uint64_t> misses;
+      atomic<uint64_t> readahead_pages;
+      atomic<uint64_t> evictions;
+      atomic<uint64_t> bypass_reads;
+};
+
+#endif // FINELINE_BLOCK_CACHE_H
@@ -0,0 +1,547 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Case_Snapshot.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Saves and maps the binary case snapshot. The file is written in
+            host byte order to a temporary file that replaces the old
+            snapshot only when it is complete.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unordered_map>
+
+#ifdef LINUX_BUILD
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+#include "Fineline_Case_Snapshot.h"
+#include "Fineline_Log.h"
+
+Fineline_Case_Snapshot::Fineline_Case_Snapshot()
+{
+   header = NULL;
+   file_data = NULL;
+   file_size = 0;
+#ifdef LINUX_BUILD
+   file_descriptor = -1;
+#else
+   file_handle = INVALID_HANDLE_VALUE;
+   mapping_handle = NULL;
+#endif
+   close_snapshot();
+}
+
+Fineline_Case_Snapshot::~Fineline_Case_Snapshot()
+{
+   close_snapshot();
+}
+
+/*
+   Function: add_string
+   Purpose : Appends a NUL terminated string to the snapshot string table.
+   Input   : String table and the string, may be NULL.
+   Output  : The string offset, FL_SNAPSHOT_NONE for NULL.
+*/
+static uint64_t add_string(vector<char> &string_data, const char *str, size_t length)
+{
+   uint64_t offset;
+
+   if (str == NULL)
+      return(FL_SNAPSHOT_NONE);
+
+   offset = string_data.size();
+   string_data.insert(string_data.end(), str, str + length);
+   string_data.push_back(0);
+
+   return(offset);
+}
+
+/*
+   Function: save_snapshot
+   Purpose : Writes the file records of a file index snapshot to a case
+             snapshot file. Parent directories that are not in the index are
+             saved as well so every path can be rebuilt. Interned file names
+             are only stored once.
+   Input   : Snapshot file name, sorted file index snapshot, forensic image
+             path and the file system offsets.
+   Output  : Returns 0 on success, -1 on error.
+*/
+int Fineline_Case_Snapshot::save_snapshot(const char *filename, Fineline_File_Map fmap, const string &image_name, const vector<int64_t> &offsets)
+{
+   unordered_map< const fl_file_record_t*, uint32_t > record_numbers;
+   unordered_map< const char*, uint64_t > name_offsets;
+   unordered_map< const char*, uint64_t >::iterator q;
+   vector< const fl_file_record_t* > record_list;
+   vector< fl_snapshot_record_t > out_records;
+   vector< fl_snapshot_path_t > out_paths;
+   vector< fl_file_digests_t > out_digests;
+   vector< char > string_data;
+   fl_snapshot_header_t hdr;
+   fl_snapshot_record_t r;
+   fl_snapshot_path_t sp;
+   const fl_file_record_t *flrec;
+   string temp_name = filename;
+   size_t i;
+   FILE *fp;
+   int result = 0;
+
+   if (!fmap)
+      return(-1);
+
+   // Number the index records first, then the parent directories missing from the index.
+   for (i = 0; i < fmap->size(); i++)
+   {
+      flrec = fmap->get_record(i);
+      if (record_numbers.insert(make_pair(flrec, (uint32_t)record_list.size())).second)
+         record_list.push_back(flrec);
+   }
+   for (i = 0; i < record_list.size(); i++)
+   {
+      flrec = record_list[i]->parent;
+      if ((flrec != NULL) && record_numbers.insert(make_pair(flrec, (uint32_t)record_list.size())).second)
+         record_list.push_back(flrec);
+   }
+
+   memset(&hdr, 0, sizeof(hdr));
+   hdr.image_name = add_string(string_data, image_name.c_str(), image_name.size());
+
+   out_records.reserve(record_list.size());
+   for (i = 0; i < record_list.size(); i++)
+   {
+      flrec = record_list[i];
+      memset(&r, 0, sizeof(r));
+      r.file_size = flrec->file_size;
+      r.creation_time = flrec->creation_time;
+      r.access_time = flrec->access_time;
+      r.modification_time = flrec->modification_time;
+      r.change_time = flrec->change_time;
+      r.meta_address = flrec->meta_address;
+      r.id = flrec->id;
+      r.marked = flrec->marked;
+      r.hidden = flrec->hidden;
+      r.deleted = flrec->deleted;
+      r.file_type = flrec->file_type;
+      r.file_system_id = flrec->file_system_id;
+      r.hash_set = flrec->hash_set;
+      r.attribute_type = flrec->attribute_type;
+      r.attribute_id = flrec->attribute_id;
+      r.parent = (flrec->parent != NULL) ? record_numbers[flrec->parent] : FL_SNAPSHOT_NO_RECORD;
+
+      q = name_offsets.find(flrec->file_name);
+      if (q != name_offsets.end())
+      {
+         r.file_name = q->second;
+      }
+      else
+      {
+         r.file_name = add_string(string_data, flrec->file_name, (flrec->file_name != NULL) ? strlen(flrec->file_name) : 0);
+         name_offsets[flrec->file_name] = r.file_name;
+      }
+      r.file_path = add_string(string_data, flrec->file_path, (flrec->file_path != NULL) ? strlen(flrec->file_path) : 0);
+      r.comment = add_string(string_data, flrec->comment, (flrec->comment != NULL) ? strlen(flrec->comment) : 0);
+
+      r.digests = FL_SNAPSHOT_NO_RECORD;
+      if (flrec->digests != NULL)
+      {
+         r.digests = (uint32_t)out_digests.size();
+         out_digests.push_back(*flrec->digests);
+      }
+      out_records.push_back(r);
+   }
+
+   out_paths.reserve(fmap->size());
+   for (i = 0; i < fmap->size(); i++)
+   {
+      sp.path = add_string(string_data, fmap->get_path(i), fmap->get_path_length(i));
+      sp.path_length = (uint32_t)fmap->get_path_length(i);
+      sp.record = record_numbers[fmap->get_record(i)];
+      out_paths.push_back(sp);
+   }
+
+   memcpy(hdr.magic, FL_SNAPSHOT_MAGIC, 8);
+   hdr.version = FL_SNAPSHOT_VERSION;
+   hdr.record_size = sizeof(fl_snapshot_record_t);
+   hdr.image_size = (uint64_t)get_image_size(image_name);
+   hdr.file_system_count = offsets.size();
+   hdr.record_count = out_records.size();
+   hdr.path_count = out_paths.size();
+   hdr.digest_count = out_digests.size();
+   hdr.string_size = string_data.size();
+   hdr.file_size = sizeof(hdr) + (offsets.size() * sizeof(int64_t)) + (out_records.size() * sizeof(fl_snapshot_record_t)) +
+                   (out_paths.size() * sizeof(fl_snapshot_path_t)) + (out_digests.size() * sizeof(fl_file_digests_t)) + string_data.size();
+
+   temp_name.append(".tmp");
+   fp = fopen(temp_name.c_str(), "wb");
+   if (fp == NULL)
+   {
+      string msg = "save_snapshot() <ERROR> Could not create snapshot file: ";
+      msg.append(temp_name);
+      Fineline_Log::print_log_entry(msg.c_str());
+      return(-1);
+   }
+
+   if ((fwrite(&hdr, sizeof(hdr), 1, fp) != 1) ||
+       (fwrite(offsets.data(), sizeof(int64_t), offsets.size(), fp) != offsets.size()) ||
+       (fwrite(out_records.data(), sizeof(fl_snapshot_record_t), out_records.size(), fp) != out_records.size()) ||
+       (fwrite(out_paths.data(), sizeof(fl_snapshot_path_t), out_paths.size(), fp) != out_paths.size()) ||
+       (fwrite(out_digests.data(), sizeof(fl_file_digests_t), out_digests.size(), fp) != out_digests.size()) ||
+       (fwrite(string_data.data(), 1, string_data.size(), fp) != string_data.size()))
+   {
+      result = -1;
+   }
+   if (fclose(fp) != 0)
+      result = -1;
+
+   // A mapped snapshot keeps the old file open, it is replaced rather than overwritten.
+   if (result == 0)
+   {
+      remove(filename);
+      if (rename(temp_name.c_str(), filename) != 0)
+         result = -1;
+   }
+   if (result < 0)
+   {
+      string msg = "save_snapshot() <ERROR> Could not write snapshot file: ";
+      msg.append(filename);
+      Fineline_Log::print_log_entry(msg.c_str());
+      remove(temp_name.c_str());
+   }
+
+   return(result);
+}
+
+/*
+   Function: map_snapshot
+   Purpose : Maps a snapshot file read only.
+   Input   : Snapshot file name.
+   Output  : Returns 0 on success, -1 on error.
+*/
+int Fineline_Case_Snapshot::map_snapshot(const char *filename)
+{
+#ifdef LINUX_BUILD
+   struct stat st;
+
+   file_descriptor = open(filename, O_RDONLY);
+   if (file_descriptor < 0)
+      return(-1);
+   if ((fstat(file_descriptor, &st) < 0) || (st.st_size < (off_t)sizeof(fl_snapshot_header_t)))
+      return(-1);
+   file_size = (size_t)st.st_size;
+
+   void *p = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+   if (p == MAP_FAILED)
+   {
+      file_size = 0;
+      return(-1);
+   }
+   madvise(p, file_size, MADV_SEQUENTIAL);
+   file_data = (const char *)p;
+#else
+   LARGE_INTEGER size;
+
+   file_handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+   if (file_handle == INVALID_HANDLE_VALUE)
+      return(-1);
+   if (!GetFileSizeEx(file_handle, &size) || (size.QuadPart < (LONGLONG)sizeof(fl_snapshot_header_t)))
+      return(-1);
+   file_size = (size_t)size.QuadPart;
+
+   mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+   if (mapping_handle != NULL)
+      file_data = (const char *)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+   if (file_data == NULL)
+   {
+      file_size = 0;
+      return(-1);
+   }
+#endif
+
+   return(0);
+}
+
+/*
+   Function: open_snapshot
+   Purpose : Maps a snapshot file and checks it is complete and consistent.
+             The snapshot is rejected if the forensic image it was taken
+             from has changed size.
+   Input   : Snapshot file name.
+   Output  : Returns the number of records, -1 if the file is missing, invalid or stale.
+*/
+int Fineline_Case_Snapshot::open_snapshot(const char *filename)
+{
+   const fl_snapshot_header_t *h;
+   uint64_t sections;
+   int64_t image_size;
+   size_t i;
+   int valid = 0;
+
+   close_snapshot();
+
+   if (map_snapshot(filename) < 0)
+   {
+      close_snapshot();
+      return(-1);
+   }
+
+   h = (const fl_snapshot_header_t *)file_data;
+   if ((memcmp(h->magic, FL_SNAPSHOT_MAGIC, 8) == 0) && (h->version == FL_SNAPSHOT_VERSION) &&
+       (h->record_size == sizeof(fl_snapshot_record_t)) && (h->file_size == file_size) &&
+       (h->file_system_count < file_size) && (h->record_count < file_size) && (h->path_count < file_size) &&
+       (h->digest_count < file_size) && (h->string_size > 0) && (h->string_size <= file_size) &&
+       (h->record_count < FL_SNAPSHOT_NO_RECORD) && (h->image_name < h->string_size))
+   {
+      sections = sizeof(fl_snapshot_header_t) + (h->file_system_count * sizeof(int64_t)) + (h->record_count * sizeof(fl_snapshot_record_t)) +
+                 (h->path_count * sizeof(fl_snapshot_path_t)) + (h->digest_count * sizeof(fl_file_digests_t)) + h->string_size;
+      valid = (sections == file_size);
+   }
+
+   if (valid)
+   {
+      header = h;
+      file_system_offsets = (const int64_t *)(file_data + sizeof(fl_snapshot_header_t));
+      records = (const fl_snapshot_record_t *)(file_system_offsets + h->file_system_count);
+      paths = (const fl_snapshot_path_t *)(records + h->record_count);
+      digests = (const fl_file_digests_t *)(paths + h->path_count);
+      strings = (const char *)(digests + h->digest_count);
+
+      // Every string must end inside the string table, every number must be in range.
+      valid = (strings[h->string_size - 1] == 0);
+      for (i = 0; valid && (i < h->record_count); i++)
+      {
+         if (((records[i].parent != FL_SNAPSHOT_NO_RECORD) && (records[i].parent >= h->record_count)) ||
+             ((records[i].digests != FL_SNAPSHOT_NO_RECORD) && (records[i].digests >= h->digest_count)) ||
+             ((records[i].file_name != FL_SNAPSHOT_NONE) && (records[i].file_name >= h->string_size)) ||
+             ((records[i].file_path != FL_SNAPSHOT_NONE) && (records[i].file_path >= h->string_size)) ||
+             ((records[i].comment != FL_SNAPSHOT_NONE) && (records[i].comment >= h->string_size)))
+            valid = 0;
+      }
+      for (i = 0; valid && (i < h->path_count); i++)
+      {
+         if ((paths[i].record >= h->record_count) || (paths[i].path + paths[i].path_length >= h->string_size))
+            valid = 0;
+      }
+   }
+
+   if (!valid)
+   {
+      string msg = "open_snapshot() <ERROR> Invalid snapshot file: ";
+      msg.append(filename);
+      Fineline_Log::print_log_entry(msg.c_str());
+      close_snapshot();
+      return(-1);
+   }
+
+   image_size = get_image_size(get_image_name());
+   if ((image_size >= 0) && ((uint64_t)image_size != header->image_size))
+   {
+      string msg = "open_snapshot() <ERROR> The forensic image has changed since the snapshot was saved: ";
+      msg.append(get_image_name());
+      Fineline_Log::print_log_entry(msg.c_str());
+      close_snapshot();
+      return(-1);
+   }
+
+   return((int)header->record_count);
+}
+
+/*
+   Function: load_string
+   Purpose : Copies a snapshot string into the arena, so the records do not
+             point into the mapped file.
+   Input   : File record arena, the string, may be NULL, and 1 to intern it.
+   Output  : The arena string, NULL for NULL.
+*/
+static const char *load_string(Fineline_File_Arena *arena, const char *str, int intern)
+{
+   if (str == NULL)
+      return(NULL);
+   if (intern)
+      return(arena->intern_string(str, strlen(str)));
+
+   return(arena->copy_string(str, strlen(str)));
+}
+
+/*
+   Function: load_records
+   Purpose : Creates the file records of the snapshot in the arena and builds
+             the file index. The records are not copied again when the index
+             is shared with the file system tree. The names, comments and
+             digests are copied into the arena, the snapshot can be closed
+             once the records are loaded.
+   Input   : File record arena.
+   Output  : The sorted file index snapshot, NULL if no snapshot is open.
+*/
+Fineline_File_Map Fineline_Case_Snapshot::load_records(Fineline_File_Arena *arena)
+{
+   shared_ptr< Fineline_File_Index > findex;
+   vector< fl_file_record_t* > record_list;
+   const fl_snapshot_record_t *r;
+   fl_file_record_t *flrec;
+   fl_file_digests_t *file_digests;
+   size_t i;
+
+   if (header == NULL)
+      return(Fineline_File_Map());
+
+   record_list.resize(header->record_count);
+   for (i = 0; i < record_list.size(); i++)
+      record_list[i] = arena->new_record();
+
+   for (i = 0; i < record_list.size(); i++)
+   {
+      r = &records[i];
+      flrec = record_list[i];
+      flrec->id = r->id;
+      flrec->marked = r->marked;
+      flrec->hidden = r->hidden;
+      flrec->deleted = r->deleted;
+      flrec->file_type = r->file_type;
+      flrec->file_system_id = r->file_system_id;
+      flrec->hash_set = r->hash_set;
+      flrec->attribute_type = r->attribute_type;
+      flrec->attribute_id = r->attribute_id;
+      flrec->meta_address = r->meta_address;
+      flrec->file_size = r->file_size;
+      flrec->creation_time = r->creation_time;
+      flrec->access_time = r->access_time;
+      flrec->modification_time = r->modification_time;
+      flrec->change_time = r->change_time;
+      flrec->parent = (r->parent != FL_SNAPSHOT_NO_RECORD) ? record_list[r->parent] : NULL;
+      flrec->file_name = load_string(arena, get_string(r->file_name), 1);
+      flrec->file_path = load_string(arena, get_string(r->file_path), 1);
+      flrec->comment = load_string(arena, get_string(r->comment), 0);
+      flrec->digests = NULL;
+      if (r->digests != FL_SNAPSHOT_NO_RECORD)
+      {
+         file_digests = arena->new_digests();
+         *file_digests = digests[r->digests];
+         flrec->digests = file_digests;
+      }
+   }
+
+   findex = make_shared< Fineline_File_Index >();
+   findex->reserve(header->path_count, header->string_size);
+   for (i = 0; i < header->path_count; i++)
+      findex->add_file(string(strings + paths[i].path, paths[i].path_length), record_list[paths[i].record]);
+   findex->sort_index();
+
+   return(findex);
+}
+
+void Fineline_Case_Snapshot::close_snapshot()
+{
+#ifdef LINUX_BUILD
+   if (file_data != NULL)
+      munmap((void *)file_data, file_size);
+   if (file_descriptor >= 0)
+      close(file_descriptor);
+   file_descriptor = -1;
+#else
+   if (file_data != NULL)
+      UnmapViewOfFile(file_data);
+   if (mapping_handle != NULL)
+      CloseHandle(mapping_handle);
+   if (file_handle != INVALID_HANDLE_VALUE)
+      CloseHandle(file_handle);
+   mapping_handle = NULL;
+   file_handle = INVALID_HANDLE_VALUE;
+#endif
+   file_data = NULL;
+   file_size = 0;
+
+   header = NULL;
+   file_system_offsets = NULL;
+   records = NULL;
+   paths = NULL;
+   digests = NULL;
+   strings = NULL;
+}
+
+const char *Fineline_Case_Snapshot::get_string(uint64_t offset)
+{
+   if (offset == FL_SNAPSHOT_NONE)
+      return(NULL);
+
+   return(strings + offset);
+}
+
+string Fineline_Case_Snapshot::get_image_name()
+{
+   if (header == NULL)
+      return(string());
+
+   return(string(strings + header->image_name));
+}
+
+vector<int64_t> Fineline_Case_Snapshot::get_file_system_offsets()
+{
+   vector<int64_t> offsets;
+
+   if (header != NULL)
+      offsets.assign(file_system_offsets, file_system_offsets + header->file_system_count);
+
+   return(offsets);
+}
+
+size_t Fineline_Case_Snapshot::get_record_count()
+{
+   return((header != NULL) ? (size_t)header->record_count : 0);
+}
+
+/*
+   Function: get_image_size
+   Purpose : Gets the size of the forensic image file, used to check the
+             snapshot was taken from the same image.
+   Input   : Image file path.
+   Output  : The file size, -1 if the image cannot be found.
+*/
+int64_t Fineline_Case_Snapshot::get_image_size(const string &image_name)
+{
+#ifdef LINUX_BUILD
+   struct stat st;
+
+   if (stat(image_name.c_str(), &st) < 0)
+      return(-1);
+
+   return((int64_t)st.st_size);
+#else
+   WIN32_FILE_ATTRIBUTE_DATA fad;
+
+   if (!GetFileAttributesExA(image_name.c_str(), GetFileExInfoStandard, &fad))
+      return(-1);
+
+   return(((int64_t)fad.nFileSizeHigh << 32) | fad.nFileSizeLow);
+#endif
+}
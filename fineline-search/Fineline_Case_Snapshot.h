@@ -0,0 +1,152 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Case_Snapshot.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Binary snapshot of the file records of a processed forensic image,
+            saved with the project so a case can be reopened without walking
+            the image again. The file holds the image name and file system
+            offsets, fixed size records with the parent directories as record
+            numbers, the file index paths in sorted order, the file digests
+            and one string table. Opening a snapshot maps the file read only,
+            the names, comments and digests are copied into the arena when
+            the records are loaded so the snapshot can then be closed.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#ifndef FINELINE_CASE_SNAPSHOT_H
+#define FINELINE_CASE_SNAPSHOT_H
+
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fineline-search.h"
+#include "Fineline_File_Arena.h"
+#include "Fineline_File_Index.h"
+
+#define FL_SNAPSHOT_MAGIC     "FLSNP001"
+#define FL_SNAPSHOT_VERSION   1
+#define FL_SNAPSHOT_NONE      0xFFFFFFFFFFFFFFFFULL  /* no string */
+#define FL_SNAPSHOT_NO_RECORD 0xFFFFFFFF             /* no parent directory or digests */
+
+using namespace std;
+
+struct fl_snapshot_header
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t record_size;            /* sizeof(fl_snapshot_record_t), rejects files from other builds */
+   uint64_t file_size;              /* detects a truncated file */
+   uint64_t image_size;             /* size of the forensic image when the snapshot was taken */
+   uint64_t image_name;             /* string offset of the forensic image path */
+   uint64_t file_system_count;
+   uint64_t record_count;
+   uint64_t path_count;
+   uint64_t digest_count;
+   uint64_t string_size;
+};
+typedef struct fl_snapshot_header fl_snapshot_header_t;
+
+/* File record with the pointers replaced by record numbers and string offsets. */
+struct fl_snapshot_record
+{
+   int64_t file_size;
+   int64_t creation_time;
+   int64_t access_time;
+   int64_t modification_time;
+   int64_t change_time;
+   uint64_t meta_address;
+   uint64_t file_name;
+   uint64_t file_path;
+   uint64_t comment;
+   uint32_t parent;
+   uint32_t digests;
+   int32_t id;
+   int32_t marked;
+   int32_t hidden;
+   int32_t deleted;
+   int32_t file_type;
+   int32_t file_system_id;
+   int32_t hash_set;
+   uint16_t attribute_type;
+   uint16_t attribute_id;
+};
+typedef struct fl_snapshot_record fl_snapshot_record_t;
+
+/* File index entry, the path and the record number. */
+struct fl_snapshot_path
+{
+   uint64_t path;
+   uint32_t record;
+   uint32_t path_length;
+};
+typedef struct fl_snapshot_path fl_snapshot_path_t;
+
+class Fineline_Case_Snapshot
+{
+   public:
+      Fineline_Case_Snapshot();
+      virtual ~Fineline_Case_Snapshot();
+
+      static int save_snapshot(const char *filename, Fineline_File_Map fmap, const string &image_name, const vector<int64_t> &offsets);
+
+      int open_snapshot(const char *filename);
+      Fineline_File_Map load_records(Fineline_File_Arena *arena);
+      void close_snapshot();
+
+      string get_image_name();
+      vector<int64_t> get_file_system_offsets();
+      size_t get_record_count();
+
+      static int64_t get_image_size(const string &image_name);
+
+   protected:
+   private:
+
+      int map_snapshot(const char *filename);
+      const char *get_string(uint64_t offset);
+
+      const fl_snapshot_header_t *header;
+      const int64_t *file_system_offsets;
+      const fl_snapshot_record_t *records;
+      const fl_snapshot_path_t *paths;
+      const fl_file_digests_t *digests;
+      const char *strings;
+
+      const char *file_data;
+      size_t file_size;
+#ifdef LINUX_BUILD
+      int file_descriptor;
+#else
+      void *file_handle;
+      void *mapping_handle;
+#endif
+};
+
+#endif // FINELINE_CASE_SNAPSHOT_H
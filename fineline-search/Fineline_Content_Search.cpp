@@ -0,0 +1,456 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Content_Search.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Parallel keyword search of file content. TSK handles are not
+            thread safe, so every worker opens the image and the file systems
+            itself. Files are opened by metadata address and visited in
+            address order to keep the reads close together on the disk.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+#include "Fineline_Content_Search.h"
+#include "Fineline_File_System.h"
+#include "Fineline_Log.h"
+#include "../common/Fineline_Util.h"
+
+/* Matcher callback state for one buffer. */
+struct fl_scan_context
+{
+   fl_file_record_t *record;
+   int64_t file_offset;
+   const vector<int> *variant_keyword;
+   const vector<int> *variant_encoding;
+   const vector<size_t> *variant_length;
+   vector<fl_content_hit_t> *hits;
+   size_t hit_limit;
+};
+
+/* Orders files by file system and metadata address. */
+struct fl_file_address_order
+{
+   bool operator()(const fl_file_record_t *a, const fl_file_record_t *b) const
+   {
+      if (a->file_system_id != b->file_system_id)
+         return(a->file_system_id < b->file_system_id);
+      return(a->meta_address < b->meta_address);
+   }
+};
+
+/* Orders hits by file then offset. */
+struct fl_content_hit_order
+{
+   bool operator()(const fl_content_hit_t &a, const fl_content_hit_t &b) const
+   {
+      if (a.record->id != b.record->id)
+         return(a.record->id < b.record->id);
+      if (a.offset != b.offset)
+         return(a.offset < b.offset);
+      return(a.keyword_id < b.keyword_id);
+   }
+};
+
+static int content_hit_callback(int keyword_id, size_t end_offset, void *user)
+{
+   fl_scan_context *ctx = (fl_scan_context *)user;
+   fl_content_hit_t hit;
+
+   hit.record = ctx->record;
+   hit.keyword_id = (*ctx->variant_keyword)[keyword_id];
+   hit.encoding = (*ctx->variant_encoding)[keyword_id];
+   hit.offset = ctx->file_offset + (int64_t)end_offset - (int64_t)(*ctx->variant_length)[keyword_id];
+   ctx->hits->push_back(hit);
+
+   return(ctx->hits->size() >= ctx->hit_limit);
+}
+
+/*
+   Function: utf16le_string
+   Purpose : Converts a UTF-8 keyword to UTF-16LE bytes, invalid UTF-8 bytes
+             are converted as Latin-1 characters.
+   Input   : UTF-8 string.
+   Output  : UTF-16LE byte string.
+*/
+static string utf16le_string(const string &str)
+{
+   const unsigned char *p = (const unsigned char *)str.c_str();
+   size_t i = 0, length = str.size();
+   unsigned int c;
+   string wide;
+
+   while (i < length)
+   {
+      c = p[i];
+      if ((c >= 0xC0) && (c < 0xE0) && (i + 1 < length) && ((p[i + 1] & 0xC0) == 0x80))
+      {
+         c = ((c & 0x1F) << 6) | (p[i + 1] & 0x3F);
+         i += 2;
+      }
+      else if ((c >= 0xE0) && (c < 0xF0) && (i + 2 < length) && ((p[i + 1] & 0xC0) == 0x80) && ((p[i + 2] & 0xC0) == 0x80))
+      {
+         c = ((c & 0x0F) << 12) | ((p[i + 1] & 0x3F) << 6) | (p[i + 2] & 0x3F);
+         i += 3;
+      }
+      else
+      {
+         i++;
+      }
+      wide += (char)(c & 0xFF);
+      wide += (char)((c >> 8) & 0xFF);
+   }
+
+   return(wide);
+}
+
+Fineline_Content_Search::Fineline_Content_Search(string image, vector<TSK_OFF_T> fs_offsets, const vector<string> &keywords, int ignore_case) : keyword_matcher(ignore_case)
+{
+   unsigned int i;
+   int encoding, id;
+   string variant;
+
+   image_path = image;
+   file_system_offsets = fs_offsets;
+   next_file = 0;
+   bytes_searched = 0;
+   running = 0;
+
+   // Add the ASCII/UTF-8 and UTF-16LE form of each keyword to the one matcher,
+   // the variant tables map the matcher keyword back to the keyword list.
+
+   for (i = 0; i < keywords.size(); i++)
+   {
+      if (keywords[i].size() == 0)
+         continue;
+      keyword_list.push_back(keywords[i]);
+      for (encoding = FL_ENCODING_ASCII; encoding <= FL_ENCODING_UTF16LE; encoding++)
+      {
+         variant = (encoding == FL_ENCODING_ASCII) ? keywords[i] : utf16le_string(keywords[i]);
+         id = keyword_matcher.add_keyword(variant);
+         if (id == (int)variant_keyword.size())
+         {
+            variant_keyword.push_back(keyword_list.size() - 1);
+            variant_encoding.push_back(encoding);
+            variant_length.push_back(variant.size());
+         }
+      }
+   }
+
+   keyword_matcher.compile();
+}
+
+Fineline_Content_Search::~Fineline_Content_Search()
+{
+   //dtor
+}
+
+int Fineline_Content_Search::add_file(fl_file_record_t *flrec)
+{
+   if ((flrec == NULL) || (flrec->file_type != TSK_FS_META_TYPE_REG) || (flrec->file_size <= 0))
+      return(-1);
+
+   file_list.push_back(flrec);
+
+   return(0);
+}
+
+/*
+   Function: add_files
+   Purpose : Adds every regular file with content in a file index snapshot.
+   Input   : File index snapshot.
+   Output  : Returns the number of files to search.
+*/
+int Fineline_Content_Search::add_files(Fineline_File_Map fmap)
+{
+   size_t n;
+
+   if (!fmap)
+      return(file_list.size());
+
+   for (n = 0; n < fmap->size(); n++)
+      add_file(fmap->get_record(n));
+
+   return(file_list.size());
+}
+
+/*
+   Function: scan_buffer
+   Purpose : Runs the keyword matcher over one block of a file. The matcher
+             state is carried between blocks so hits spanning blocks are found.
+   Input   : File record, data block, block length, file offset of the block
+             and the matcher state, FL_MATCHER_START_STATE for the first block.
+   Output  : Appends the hits, returns the number found, stops at
+             FL_CONTENT_MAX_FILE_HITS hits for the file.
+*/
+long Fineline_Content_Search::scan_buffer(fl_file_record_t *flrec, const char *buffer, size_t length, int64_t file_offset, int *state, vector<fl_content_hit_t> &hits) const
+{
+   fl_scan_context ctx;
+   size_t file_hits = 0;
+   size_t start = hits.size();
+
+   while ((file_hits < start) && (file_hits < FL_CONTENT_MAX_FILE_HITS) && (hits[start - file_hits - 1].record == flrec))
+      file_hits++;
+
+   if (file_hits >= FL_CONTENT_MAX_FILE_HITS)
+      return(0);
+
+   ctx.record = flrec;
+   ctx.file_offset = file_offset;
+   ctx.variant_keyword = &variant_keyword;
+   ctx.variant_encoding = &variant_encoding;
+   ctx.variant_length = &variant_length;
+   ctx.hits = &hits;
+   ctx.hit_limit = start + FL_CONTENT_MAX_FILE_HITS - file_hits;
+
+   keyword_matcher.scan(buffer, length, state, content_hit_callback, &ctx);
+
+   return((long)(hits.size() - start));
+}
+
+/*
+   Function: search_file
+   Purpose : Reads a file in blocks with the worker's own TSK handles and
+             scans each block. The file system is opened on first use.
+   Input   : Worker image handle, worker file system handles, file record,
+             worker read buffer and the worker hit list.
+   Output  : Returns 0 on success, -1 if the file could not be opened.
+*/
+int Fineline_Content_Search::search_file(TskImgInfo *img_info, vector<TskFsInfo *> &fs_list, fl_file_record_t *flrec, char *buffer, vector<fl_content_hit_t> &hits)
+{
+   TskFsFile *file_info;
+   TSK_OFF_T file_size, offset;
+   ssize_t cnt;
+   size_t len;
+   size_t first_hit = hits.size();
+   int fs_id = flrec->file_system_id - 1;
+   int state = FL_MATCHER_START_STATE;
+
+   if ((fs_id < 0) || (fs_id >= (int)fs_list.size()))
+      return(-1);
+
+   if (fs_list[fs_id] == NULL)
+   {
+      TskFsInfo *fs_info = new TskFsInfo();
+      if (fs_info->open(img_info, file_system_offsets[fs_id], TSK_FS_TYPE_DETECT))
+      {
+         delete fs_info;
+         return(-1);
+      }
+      fs_list[fs_id] = fs_info;
+   }
+
+   file_info = Fineline_File_System::open_file(fs_list[fs_id], flrec);
+   if (file_info == NULL)
+      return(-1);
+
+   file_size = file_info->getMeta()->getSize();
+   for (offset = 0; (offset < file_size) && running; offset += cnt)
+   {
+      len = (file_size - offset < FL_CONTENT_BLOCK_SIZE) ? (size_t)(file_size - offset) : FL_CONTENT_BLOCK_SIZE;
+      cnt = Fineline_File_System::read_file(file_info, flrec, offset, buffer, len);
+      if (cnt <= 0)
+         break;
+      bytes_searched += (uint64_t)cnt;
+      scan_buffer(flrec, buffer, (size_t)cnt, (int64_t)offset, &state, hits);
+      if (hits.size() - first_hit >= FL_CONTENT_MAX_FILE_HITS)
+         break;
+   }
+
+   delete file_info;
+
+   return(0);
+}
+
+/*
+   Function: search_task
+   Purpose : Worker thread, takes batches of files from the shared file list
+             until it is empty or the search is stopped.
+   Input   : Content search object and the worker hit list.
+   Output  : None.
+*/
+void Fineline_Content_Search::search_task(Fineline_Content_Search *fcs, vector<fl_content_hit_t> *hits)
+{
+   TskImgInfo *img_info = Fineline_File_System::open_image(fcs->image_path);
+   vector<TskFsInfo *> fs_list(fcs->file_system_offsets.size(), (TskFsInfo *)NULL);
+   char *buffer;
+   size_t start, end, n;
+   unsigned int i;
+
+   if (img_info == NULL)
+   {
+      Fineline_Log::print_log_entry("search_task() <ERROR> Could not open image file.\n");
+      return;
+   }
+
+   buffer = (char *)Fineline_Util::xmalloc(FL_CONTENT_BLOCK_SIZE);
+
+   while (fcs->running)
+   {
+      start = fcs->next_file.fetch_add(FL_CONTENT_FILE_BATCH);
+      if (start >= fcs->file_list.size())
+         break;
+      end = min(start + FL_CONTENT_FILE_BATCH, fcs->file_list.size());
+      for (n = start; n < end; n++)
+         fcs->search_file(img_info, fs_list, fcs->file_list[n], buffer, *hits);
+   }
+
+   for (i = 0; i < fs_list.size(); i++)
+   {
+      if (fs_list[i] != NULL)
+         delete fs_list[i];
+   }
+   Fineline_File_System::close_image(img_info);
+   free(buffer);
+}
+
+/*
+   Function: search_files
+   Purpose : Searches the content of every file added to the search.
+   Input   : Number of worker threads, 0 = one per CPU core.
+   Output  : Returns the number of hits, the hits are sorted by file and offset.
+*/
+long Fineline_Content_Search::search_files(int thread_count)
+{
+   vector< vector<fl_content_hit_t> > thread_hits;
+   vector<thread> workers;
+   int i;
+
+   hit_list.clear();
+   next_file = 0;
+   bytes_searched = 0;
+
+   if ((file_list.size() == 0) || (keyword_list.size() == 0))
+      return(0);
+
+   running = 1;
+
+   sort(file_list.begin(), file_list.end(), fl_file_address_order());
+
+   if (thread_count <= 0)
+      thread_count = (int)thread::hardware_concurrency();
+   if ((size_t)thread_count > (file_list.size() + FL_CONTENT_FILE_BATCH - 1) / FL_CONTENT_FILE_BATCH)
+      thread_count = (int)((file_list.size() + FL_CONTENT_FILE_BATCH - 1) / FL_CONTENT_FILE_BATCH);
+   if (thread_count < 1)
+      thread_count = 1;
+
+   thread_hits.resize(thread_count);
+   for (i = 1; i < thread_count; i++)
+   {
+      workers.push_back(thread(search_task, this, &thread_hits[i]));
+   }
+   search_task(this, &thread_hits[0]);
+   for (i = 0; i < (int)workers.size(); i++)
+   {
+      workers[i].join();
+   }
+
+   for (i = 0; i < thread_count; i++)
+   {
+      hit_list.insert(hit_list.end(), thread_hits[i].begin(), thread_hits[i].end());
+   }
+   sort(hit_list.begin(), hit_list.end(), fl_content_hit_order());
+
+   running = 0;
+
+   return((long)hit_list.size());
+}
+
+void Fineline_Content_Search::stop_search()
+{
+   running = 0;
+}
+
+int Fineline_Content_Search::get_running()
+{
+   return(running);
+}
+
+const vector<fl_content_hit_t> &Fineline_Content_Search::get_hits()
+{
+   return(hit_list);
+}
+
+/*
+   Function: get_file_hits
+   Purpose : Gets the hits for one file from the sorted hit list.
+   Input   : File record.
+   Output  : The hits in offset order.
+*/
+void Fineline_Content_Search::get_file_hits(fl_file_record_t *flrec, vector<fl_content_hit_t> &file_hits)
+{
+   fl_content_hit_t key;
+   vector<fl_content_hit_t>::iterator it;
+
+   file_hits.clear();
+   if ((flrec == NULL) || running)
+      return;
+
+   key.record = flrec;
+   key.offset = INT64_MIN;
+   key.keyword_id = -1;
+   key.encoding = FL_ENCODING_ASCII;
+
+   for (it = lower_bound(hit_list.begin(), hit_list.end(), key, fl_content_hit_order()); (it != hit_list.end()) && (it->record == flrec); it++)
+      file_hits.push_back(*it);
+}
+
+/*
+   Function: get_hit_string
+   Purpose : Formats a hit for the result and metadata views.
+   Input   : Content hit.
+   Output  : The keyword, encoding and offset, e.g. "password (UTF-16LE) @ 4096".
+*/
+string Fineline_Content_Search::get_hit_string(const fl_content_hit_t &hit)
+{
+   char offset_str[64];
+   string hit_str = keyword_list[hit.keyword_id];
+
+   hit_str.append((hit.encoding == FL_ENCODING_UTF16LE) ? " (UTF-16LE) @ " : " (ASCII) @ ");
+   sprintf(offset_str, "%lld", (long long)hit.offset);
+   hit_str.append(offset_str);
+
+   return(hit_str);
+}
+
+size_t Fineline_Content_Search::get_keyword_count()
+{
+   return(keyword_list.size());
+}
+
+size_t Fineline_Content_Search::get_file_count()
+{
+   return(file_list.size());
+}
+
+uint64_t Fineline_Content_Search::get_bytes_searched()
+{
+   return(bytes_searched);
+}
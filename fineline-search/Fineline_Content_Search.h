@@ -0,0 +1,110 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Content_Search.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Keyword search of the file content in a forensic image. The files
+            are shared out in small batches to a pool of worker threads, each
+            worker opens its own TSK image and file system handles, reads the
+            files in large blocks and runs one keyword matcher over the data.
+            Every keyword is searched for as ASCII/UTF-8 and as UTF-16LE.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#ifndef FINELINE_CONTENT_SEARCH_H
+#define FINELINE_CONTENT_SEARCH_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include <stdint.h>
+#include <tsk/libtsk.h>
+
+#include "fineline-search.h"
+#include "Fineline_File_Index.h"
+#include "../common/Fineline_Keyword_Matcher.h"
+
+#define FL_CONTENT_BLOCK_SIZE     1048576   /* bytes read from a file at a time */
+#define FL_CONTENT_FILE_BATCH     16        /* files taken by a worker at a time */
+#define FL_CONTENT_MAX_FILE_HITS  1000      /* hits reported per file */
+
+#define FL_ENCODING_ASCII   0
+#define FL_ENCODING_UTF16LE 1
+
+using namespace std;
+
+struct fl_content_hit
+{
+   fl_file_record_t *record;
+   int keyword_id;       /* keyword list number */
+   int encoding;         /* FL_ENCODING_ASCII or FL_ENCODING_UTF16LE */
+   int64_t offset;       /* byte offset of the hit in the file */
+};
+typedef struct fl_content_hit fl_content_hit_t;
+
+class Fineline_Content_Search
+{
+   public:
+      Fineline_Content_Search(string image_path, vector<TSK_OFF_T> fs_offsets, const vector<string> &keywords, int ignore_case);
+      virtual ~Fineline_Content_Search();
+
+      int add_file(fl_file_record_t *flrec);
+      int add_files(Fineline_File_Map fmap);
+      long search_files(int thread_count);
+      long scan_buffer(fl_file_record_t *flrec, const char *buffer, size_t length, int64_t file_offset, int *state, vector<fl_content_hit_t> &hits) const;
+      void stop_search();
+      int get_running();
+
+      const vector<fl_content_hit_t> &get_hits();
+      void get_file_hits(fl_file_record_t *flrec, vector<fl_content_hit_t> &file_hits);
+      string get_hit_string(const fl_content_hit_t &hit);
+      size_t get_keyword_count();
+      size_t get_file_count();
+      uint64_t get_bytes_searched();
+
+   protected:
+   private:
+
+      static void search_task(Fineline_Content_Search *fcs, vector<fl_content_hit_t> *hits);
+      int search_file(TskImgInfo *img_info, vector<TskFsInfo *> &fs_list, fl_file_record_t *flrec, char *buffer, vector<fl_content_hit_t> &hits);
+
+      string image_path;
+      vector<TSK_OFF_T> file_system_offsets;  /* file system id - 1 -> offset in the image */
+      vector<string> keyword_list;
+      Fineline_Keyword_Matcher keyword_matcher;
+      vector<int> variant_keyword;            /* matcher keyword -> keyword list number */
+      vector<int> variant_encoding;
+      vector<size_t> variant_length;
+
+      vector<fl_file_record_t *> file_list;
+      vector<fl_content_hit_t> hit_list;
+      atomic<size_t> next_file;
+      atomic<uint64_t> bytes_searched;
+      atomic<int> running;
+};
+
+#endif // FINELINE_CONTENT_SEARCH_H
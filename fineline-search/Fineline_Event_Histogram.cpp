@@ -0,0 +1,285 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Event_Histogram.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Event count pyramid for the timeline graph, the levels are
+            updated together as each event is counted.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <string.h>
+
+#include "Fineline_Event_Histogram.h"
+
+static const int64_t fl_bucket_seconds[FL_HISTOGRAM_LEVELS] = { 1, 60, 3600, 86400 };
+
+Fineline_Event_Histogram::Fineline_Event_Histogram()
+{
+   clear();
+}
+
+Fineline_Event_Histogram::~Fineline_Event_Histogram()
+{
+   //dtor
+}
+
+int64_t Fineline_Event_Histogram::get_bucket_seconds(int level)
+{
+   return(fl_bucket_seconds[level]);
+}
+
+/* Bucket number of a time, rounded down for times before 1970. */
+int64_t Fineline_Event_Histogram::get_bucket(int64_t event_time, int64_t bucket_seconds)
+{
+   if (event_time >= 0)
+      return(event_time / bucket_seconds);
+
+   return(((event_time + 1) / bucket_seconds) - 1);
+}
+
+/* Groups of 16 neighbouring buckets get neighbouring slots, so counting sorted events mostly stays in cache. */
+size_t Fineline_Event_Histogram::hash_bucket(int64_t bucket)
+{
+   uint64_t hash = ((uint64_t)bucket >> 4) * 0x9E3779B97F4A7C15ULL;
+
+   return((size_t)(((hash ^ (hash >> 29)) << 4) | ((uint64_t)bucket & 15)));
+}
+
+/*
+   Function: find_bucket
+   Purpose : Looks up a bucket of a level.
+   Input   : Level and bucket number.
+   Output  : The bucket, or the empty slot where it would be inserted.
+*/
+fl_histogram_bucket_t *Fineline_Event_Histogram::find_bucket(int level, int64_t bucket)
+{
+   vector< fl_histogram_bucket_t > &table = levels[level];
+   size_t mask = table.size() - 1;
+   size_t slot = hash_bucket(bucket) & mask;
+
+   while ((table[slot].counts[FL_HISTOGRAM_ALL] != 0) && (table[slot].bucket != bucket))
+      slot = (slot + 1) & mask;
+
+   return(&table[slot]);
+}
+
+void Fineline_Event_Histogram::grow_level(int level)
+{
+   vector< fl_histogram_bucket_t > old_table;
+   fl_histogram_bucket_t empty;
+   size_t i;
+
+   memset(&empty, 0, sizeof(empty));
+   old_table.swap(levels[level]);
+   levels[level].assign(old_table.size() * 2, empty);
+   for (i = 0; i < old_table.size(); i++)
+   {
+      if (old_table[i].counts[FL_HISTOGRAM_ALL] != 0)
+         *find_bucket(level, old_table[i].bucket) = old_table[i];
+   }
+}
+
+/*
+   Function: count_event
+   Purpose : Adds an event to every level, an event with several MAC flags
+             is counted once for each type and once in all events.
+   Input   : Event time and FL_MAC_ flags.
+   Output  : None.
+*/
+void Fineline_Event_Histogram::count_event(int64_t event_time, int flags)
+{
+   fl_histogram_bucket_t *bucket;
+   int64_t b;
+   int level;
+
+   for (level = 0; level < FL_HISTOGRAM_LEVELS; level++)
+   {
+      b = get_bucket(event_time, fl_bucket_seconds[level]);
+      bucket = find_bucket(level, b);
+      if (bucket->counts[FL_HISTOGRAM_ALL] == 0)
+      {
+         if ((bucket_counts[level] + 1) * 4 > levels[level].size() * 3)
+         {
+            grow_level(level);
+            bucket = find_bucket(level, b);
+         }
+         bucket->bucket = b;
+         bucket_counts[level]++;
+      }
+      if (flags & FL_MAC_MODIFIED)
+         bucket->counts[FL_HISTOGRAM_MODIFIED]++;
+      if (flags & FL_MAC_ACCESSED)
+         bucket->counts[FL_HISTOGRAM_ACCESSED]++;
+      if (flags & FL_MAC_CHANGED)
+         bucket->counts[FL_HISTOGRAM_CHANGED]++;
+      if (flags & FL_MAC_BORN)
+         bucket->counts[FL_HISTOGRAM_BORN]++;
+      bucket->counts[FL_HISTOGRAM_ALL]++;
+   }
+
+   if ((event_count == 0) || (event_time < first_time))
+      first_time = event_time;
+   if ((event_count == 0) || (event_time > last_time))
+      last_time = event_time;
+   event_count++;
+}
+
+void Fineline_Event_Histogram::add_event(int64_t event_time, int flags)
+{
+   lock_guard<mutex> lock(histogram_lock);
+
+   count_event(event_time, flags);
+}
+
+/*
+   Function: add_events
+   Purpose : Counts a block of events, called by the event loader as each
+             block is loaded so the graph can be drawn while loading.
+   Input   : Events and the number of events.
+   Output  : None.
+*/
+void Fineline_Event_Histogram::add_events(const fl_mac_event_t *events, size_t count)
+{
+   lock_guard<mutex> lock(histogram_lock);
+   size_t i;
+
+   for (i = 0; i < count; i++)
+      count_event(events[i].event_time, events[i].flags);
+}
+
+void Fineline_Event_Histogram::clear()
+{
+   lock_guard<mutex> lock(histogram_lock);
+   fl_histogram_bucket_t empty;
+   int level;
+
+   memset(&empty, 0, sizeof(empty));
+   for (level = 0; level < FL_HISTOGRAM_LEVELS; level++)
+   {
+      levels[level].assign(FL_HISTOGRAM_HASH_SIZE, empty);
+      bucket_counts[level] = 0;
+   }
+   event_count = 0;
+   first_time = 0;
+   last_time = 0;
+}
+
+/*
+   Function: select_level
+   Purpose : Picks the coarsest level with buckets no wider than a pixel
+             column, so the columns are as exact as the data allows and each
+             column sums at most one level step of buckets.
+   Input   : Seconds per pixel column of the graph.
+   Output  : The level.
+*/
+int Fineline_Event_Histogram::select_level(double seconds_per_pixel)
+{
+   int level = FL_LEVEL_SECOND;
+
+   while ((level + 1 < FL_HISTOGRAM_LEVELS) && ((double)fl_bucket_seconds[level + 1] <= seconds_per_pixel))
+      level++;
+
+   return(level);
+}
+
+/*
+   Function: count_range
+   Purpose : Sums the buckets of a level that start in a time range. The
+             ranges of neighbouring pixel columns share their bounds, so every
+             bucket is counted in exactly one column.
+   Input   : Level, start time, end time (exclusive) and an array of
+             FL_HISTOGRAM_TYPES counts to fill, or NULL.
+   Output  : Returns the number of events in the range.
+*/
+uint64_t Fineline_Event_Histogram::count_range(int level, int64_t start_time, int64_t end_time, uint64_t *counts)
+{
+   lock_guard<mutex> lock(histogram_lock);
+   vector< fl_histogram_bucket_t > &table = levels[level];
+   fl_histogram_bucket_t *bucket;
+   int64_t first = get_bucket(start_time - 1, fl_bucket_seconds[level]) + 1;
+   int64_t last = get_bucket(end_time - 1, fl_bucket_seconds[level]) + 1;
+   uint64_t sums[FL_HISTOGRAM_TYPES];
+   int64_t b;
+   size_t slot;
+   int i;
+
+   memset(sums, 0, sizeof(sums));
+
+   if ((uint64_t)(last - first) <= bucket_counts[level])
+   {
+      for (b = first; b < last; b++)
+      {
+         bucket = find_bucket(level, b);
+         for (i = 0; i < FL_HISTOGRAM_TYPES; i++)
+            sums[i] += bucket->counts[i];
+      }
+   }
+   else if (last > first)
+   {
+      // wider than the level has buckets, walking the table is cheaper
+      for (slot = 0; slot < table.size(); slot++)
+      {
+         if ((table[slot].counts[FL_HISTOGRAM_ALL] == 0) || (table[slot].bucket < first) || (table[slot].bucket >= last))
+            continue;
+         for (i = 0; i < FL_HISTOGRAM_TYPES; i++)
+            sums[i] += table[slot].counts[i];
+      }
+   }
+
+   if (counts != NULL)
+      memcpy(counts, sums, sizeof(sums));
+
+   return(sums[FL_HISTOGRAM_ALL]);
+}
+
+uint64_t Fineline_Event_Histogram::get_event_count()
+{
+   lock_guard<mutex> lock(histogram_lock);
+
+   return(event_count);
+}
+
+int64_t Fineline_Event_Histogram::get_first_time()
+{
+   lock_guard<mutex> lock(histogram_lock);
+
+   return(first_time);
+}
+
+int64_t Fineline_Event_Histogram::get_last_time()
+{
+   lock_guard<mutex> lock(histogram_lock);
+
+   return(last_time);
+}
+
+size_t Fineline_Event_Histogram::get_bucket_count(int level)
+{
+   lock_guard<mutex> lock(histogram_lock);
+
+   return(bucket_counts[level]);
+}
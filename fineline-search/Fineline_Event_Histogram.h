@@ -0,0 +1,104 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Event_Histogram.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Multi-resolution event counts for the timeline graph. Events are
+            counted per second, minute, hour and day and per MAC event type
+            as they are loaded, the buckets of each level are kept in an open
+            addressing hash table so only the seconds that have events use
+            memory. The graph
+            draws from the coarsest level with buckets no wider than a pixel
+            column, so a column sums at most 60 buckets up to the day level
+            and the cost of a redraw depends on the graph width, not on the
+            number of events.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#ifndef FINELINE_EVENT_HISTOGRAM_H
+#define FINELINE_EVENT_HISTOGRAM_H
+
+#include <vector>
+#include <mutex>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fineline-search.h"
+
+#define FL_HISTOGRAM_LEVELS     4           /* seconds, minutes, hours and days */
+#define FL_HISTOGRAM_TYPES      5           /* modified, accessed, changed, born and all events */
+#define FL_HISTOGRAM_HASH_SIZE  1024        /* initial hash table size of each level, a power of 2 */
+
+enum FL_HISTOGRAM_LEVEL { FL_LEVEL_SECOND, FL_LEVEL_MINUTE, FL_LEVEL_HOUR, FL_LEVEL_DAY };
+enum FL_HISTOGRAM_TYPE { FL_HISTOGRAM_MODIFIED, FL_HISTOGRAM_ACCESSED, FL_HISTOGRAM_CHANGED, FL_HISTOGRAM_BORN, FL_HISTOGRAM_ALL };
+
+using namespace std;
+
+struct fl_histogram_bucket
+{
+   int64_t bucket;                  /* event time / bucket seconds */
+   uint32_t counts[FL_HISTOGRAM_TYPES];  /* all events is 0 for an empty slot */
+};
+typedef struct fl_histogram_bucket fl_histogram_bucket_t;
+
+class Fineline_Event_Histogram
+{
+   public:
+      Fineline_Event_Histogram();
+      virtual ~Fineline_Event_Histogram();
+
+      void add_event(int64_t event_time, int flags);
+      void add_events(const fl_mac_event_t *events, size_t count);
+      void clear();
+
+      int select_level(double seconds_per_pixel);
+      uint64_t count_range(int level, int64_t start_time, int64_t end_time, uint64_t *counts);
+      uint64_t get_event_count();
+      int64_t get_first_time();
+      int64_t get_last_time();
+      size_t get_bucket_count(int level);
+
+      static int64_t get_bucket_seconds(int level);
+
+   protected:
+   private:
+
+      void count_event(int64_t event_time, int flags);
+      fl_histogram_bucket_t *find_bucket(int level, int64_t bucket);
+      void grow_level(int level);
+      static int64_t get_bucket(int64_t event_time, int64_t bucket_seconds);
+      static size_t hash_bucket(int64_t bucket);
+
+      vector< fl_histogram_bucket_t > levels[FL_HISTOGRAM_LEVELS];
+      size_t bucket_counts[FL_HISTOGRAM_LEVELS];
+      uint64_t event_count;
+      int64_t first_time;
+      int64_t last_time;
+      mutex histogram_lock;
+};
+
+#endif // FINELINE_EVENT_HISTOGRAM_H
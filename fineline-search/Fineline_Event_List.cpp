@@ -23,22 +23,72 @@
    Author: Derek Chadwick
    Date  : 25/04/2014
 
-   Purpose:  Stores a list of file names and metadata into an STL vector.
+   Purpose:  Stores a list of file names and metadata into an STL vector and
+             generates the MAC timeline of the files. Events are sorted in
+             bounded runs, full runs are spilled to temporary files and the
+             runs are merged when the timeline is written or sent.
 
 */
 
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+#include <tsk/libtsk.h>
+
 #include "Fineline_Event_List.h"
+#include "Fineline_File_Arena.h"
+#include "Fineline_Socket_BSD.h"
+#include "Fineline_Log.h"
 
 using namespace std;
 
+/* Orders events by time, the sorts are stable so files keep the order they were added in. */
+struct fl_event_time_order
+{
+   bool operator()(const fl_mac_event_t &a, const fl_mac_event_t &b) const
+   {
+      return(a.event_time < b.event_time);
+   }
+};
+
+/* Heap order of the merge runs, the run with the earliest next event, then the earliest run, is at the front. */
+struct fl_event_run_order
+{
+   const fl_event_run_t *runs;
+
+   bool operator()(size_t a, size_t b) const
+   {
+      int64_t ta = runs[a].events[runs[a].position].event_time;
+      int64_t tb = runs[b].events[runs[b].position].event_time;
+
+      if (ta != tb)
+         return(ta > tb);
+      return(a > b);
+   }
+};
+
+static void sort_chunk(fl_mac_event_t *first, fl_mac_event_t *last)
+{
+   stable_sort(first, last, fl_event_time_order());
+}
+
+static void merge_chunks(fl_mac_event_t *first, fl_mac_event_t *middle, fl_mac_event_t *last)
+{
+   inplace_merge(first, middle, last, fl_event_time_order());
+}
+
 Fineline_Event_List::Fineline_Event_List()
 {
-   //ctor
+   histogram = NULL;
+   total_events = 0;
+   run_size = FL_EVENT_RUN_SIZE;
+   thread_count = 0;
 }
 
 Fineline_Event_List::~Fineline_Event_List()
 {
-   //dtor
+   clear_runs();
 }
 
 int Fineline_Event_List::add_file_record(fl_file_record_t * flf)
@@ -48,6 +98,35 @@ int Fineline_Event_List::add_file_record(fl_file_record_t * flf)
    return(file_list.size());
 }
 
+/*
+   Function: add_file_map
+   Purpose : Adds every file in a file index snapshot to the timeline without
+             copying the record list.
+   Input   : File index snapshot.
+   Output  : Returns the number of file index snapshots added.
+*/
+int Fineline_Event_List::add_file_map(Fineline_File_Map fmap)
+{
+   if (fmap)
+      file_maps.push_back(fmap);
+
+   return(file_maps.size());
+}
+
+/*
+   Function: add_mac_events
+   Purpose : Adds events for times that are not kept in the file records, e.g.
+             the NTFS $FILE_NAME times from Fineline_File_System::get_mac_events().
+   Input   : Event list.
+   Output  : Returns the number of extra events.
+*/
+int Fineline_Event_List::add_mac_events(const vector< fl_mac_event_t > &events)
+{
+   mac_event_list.insert(mac_event_list.end(), events.begin(), events.end());
+
+   return(mac_event_list.size());
+}
+
 int Fineline_Event_List::delete_file_record(int record_index)
 {
 
@@ -59,21 +138,743 @@ int Fineline_Event_List::find_file_record(string filename)
    return(0);
 }
 
-int Fineline_Event_List::sort_records()
+/*
+   Function: add_event
+   Purpose : Adds an event to the current run, a full run is sorted and
+             spilled to a temporary file.
+   Input   : Event time, file record and FL_MAC_ flags.
+   Output  : Returns 0 on success, -1 if the run could not be spilled.
+*/
+int Fineline_Event_List::add_event(int64_t event_time, fl_file_record_t *flrec, int flags)
 {
+   fl_mac_event_t ev;
+
+   ev.event_time = event_time;
+   ev.record = flrec;
+   ev.flags = flags;
+   run_events.push_back(ev);
+   total_events++;
+
+   if (run_events.size() >= run_size)
+      return(spill_run());
+
    return(0);
 }
 
-int Fineline_Event_List::write_records()
+/*
+   Function: add_record_events
+   Purpose : Adds the modified, accessed, changed and born events of a file,
+             times that are equal are one event with the flags combined and
+             times that are not set are skipped.
+   Input   : File record.
+   Output  : Returns 0 on success, -1 if a run could not be spilled.
+*/
+int Fineline_Event_List::add_record_events(fl_file_record_t *flrec)
 {
+   int64_t times[4];
+   int flags[4];
+   int i, j;
+
+   times[0] = flrec->modification_time;
+   times[1] = flrec->access_time;
+   times[2] = flrec->change_time;
+   times[3] = flrec->creation_time;
+   flags[0] = FL_MAC_MODIFIED;
+   flags[1] = FL_MAC_ACCESSED;
+   flags[2] = FL_MAC_CHANGED;
+   flags[3] = FL_MAC_BORN;
+
+   for (i = 0; i < 4; i++)
+   {
+      if (times[i] <= 0)
+         continue;
+      for (j = i + 1; j < 4; j++)
+      {
+         if (times[j] == times[i])
+         {
+            flags[i] |= flags[j];
+            times[j] = 0;
+         }
+      }
+      if (add_event(times[i], flrec, flags[i]) < 0)
+         return(-1);
+   }
+
    return(0);
 }
 
-int Fineline_Event_List::send_records()
+/*
+   Function: sort_records
+   Purpose : Generates the MAC events of the files and extra events and sorts
+             them. At most run_size events are held in memory, every full run
+             is sorted and spilled to a temporary file and the last run is
+             kept in memory.
+   Input   : None.
+   Output  : Returns the number of events, -1 on error.
+*/
+int Fineline_Event_List::sort_records()
 {
+   size_t i, j, estimate;
+
+   clear_runs();
+
+   estimate = (file_list.size() * 4) + mac_event_list.size();
+   for (i = 0; i < file_maps.size(); i++)
+      estimate += file_maps[i]->size() * 4;
+   run_events.reserve(min(estimate, run_size));
+
+   for (i = 0; i < file_list.size(); i++)
+   {
+      if (add_record_events(file_list[i]) < 0)
+         return(-1);
+   }
+   for (i = 0; i < file_maps.size(); i++)
+   {
+      for (j = 0; j < file_maps[i]->size(); j++)
+      {
+         if (add_record_events(file_maps[i]->get_record(j)) < 0)
+            return(-1);
+      }
+   }
+   for (i = 0; i < mac_event_list.size(); i++)
+   {
+      if (mac_event_list[i].event_time <= 0)
+         continue;
+      if (add_event(mac_event_list[i].event_time, mac_event_list[i].record, mac_event_list[i].flags) < 0)
+         return(-1);
+   }
+
+   sort_run();
+   if (histogram != NULL)
+      histogram->add_events(run_events.data(), run_events.size());
+
+   return((int)total_events);
+}
+
+/*
+   Function: sort_run
+   Purpose : Sorts the current run, blocks of the run are sorted by separate
+             threads and merged in pairs until one block is left.
+   Input   : None.
+   Output  : None.
+*/
+void Fineline_Event_List::sort_run()
+{
+   vector< size_t > bounds;
+   vector< size_t > merged;
+   vector< thread > workers;
+   fl_mac_event_t *events = run_events.data();
+   size_t n = run_events.size();
+   size_t i, chunks;
+
+   chunks = (thread_count > 0) ? (size_t)thread_count : (size_t)thread::hardware_concurrency();
+   if (chunks > n / FL_EVENT_MIN_CHUNK)
+      chunks = n / FL_EVENT_MIN_CHUNK;
+   if (chunks <= 1)
+   {
+      sort_chunk(events, events + n);
+      return;
+   }
+
+   for (i = 0; i <= chunks; i++)
+      bounds.push_back((n * i) / chunks);
+
+   for (i = 0; i < chunks; i++)
+   {
+      workers.push_back(thread(sort_chunk, events + bounds[i], events + bounds[i + 1]));
+   }
+   for (i = 0; i < workers.size(); i++)
+   {
+      workers[i].join();
+   }
+
+   while (bounds.size() > 2)
+   {
+      workers.clear();
+      merged.clear();
+      for (i = 0; i + 2 < bounds.size(); i += 2)
+      {
+         workers.push_back(thread(merge_chunks, events + bounds[i], events + bounds[i + 1], events + bounds[i + 2]));
+         merged.push_back(bounds[i]);
+      }
+      if (i + 1 < bounds.size())
+         merged.push_back(bounds[i]);
+      merged.push_back(n);
+      for (i = 0; i < workers.size(); i++)
+      {
+         workers[i].join();
+      }
+      bounds.swap(merged);
+   }
+
+   return;
+}
+
+/*
+   Function: spill_run
+   Purpose : Sorts the current run and writes it to a temporary file, the
+             file is deleted when it is closed. The events hold record
+             pointers so the file is only valid in this process.
+   Input   : None.
+   Output  : Returns 0 on success, -1 on error.
+*/
+int Fineline_Event_List::spill_run()
+{
+   fl_event_run_t run;
+
+   sort_run();
+   if (histogram != NULL)
+      histogram->add_events(run_events.data(), run_events.size());
+
+   run.run_file = tmpfile();
+   if (run.run_file == NULL)
+   {
+      Fineline_Log::print_log_entry("Fineline_Event_List.spill_run() <ERROR> Could not create temporary file.\n");
+      return(-1);
+   }
+   if (fwrite(run_events.data(), sizeof(fl_mac_event_t), run_events.size(), run.run_file) != run_events.size())
+   {
+      Fineline_Log::print_log_entry("Fineline_Event_List.spill_run() <ERROR> Could not write temporary file.\n");
+      fclose(run.run_file);
+      return(-1);
+   }
+
+   run.run_length = run_events.size();
+   run.file_events = 0;
+   run.events = NULL;
+   run.count = 0;
+   run.position = 0;
+   merge_runs.push_back(run);
+
+   run_events.clear();
+
    return(0);
 }
 
+/*
+   Function: fill_run
+   Purpose : Reads the next block of events of a spilled run.
+   Input   : The run.
+   Output  : Returns the number of events read, 0 at the end of the run.
+*/
+int Fineline_Event_List::fill_run(fl_event_run_t *run)
+{
+   size_t n;
+
+   if ((run->run_file == NULL) || (run->file_events == 0))
+      return(0);
+
+   n = min(run->file_events, (size_t)FL_EVENT_READ_SIZE);
+   run->buffer.resize(n);
+   if (fread(run->buffer.data(), sizeof(fl_mac_event_t), n, run->run_file) != n)
+   {
+      Fineline_Log::print_log_entry("Fineline_Event_List.fill_run() <ERROR> Could not read temporary file.\n");
+      run->file_events = 0;
+      return(0);
+   }
+
+   run->file_events -= n;
+   run->events = run->buffer.data();
+   run->count = n;
+   run->position = 0;
+
+   return((int)n);
+}
+
+/*
+   Function: start_merge
+   Purpose : Starts reading the sorted events from the beginning, called by
+             the writers after sort_records().
+   Input   : None.
+   Output  : Returns the number of sorted runs.
+*/
+int Fineline_Event_List::start_merge()
+{
+   fl_event_run_order order;
+   fl_event_run_t run;
+   size_t i;
+
+   if ((!merge_runs.empty()) && (merge_runs.back().run_file == NULL))
+      merge_runs.pop_back();
+
+   run.run_file = NULL;
+   run.run_length = run_events.size();
+   run.file_events = 0;
+   run.events = run_events.data();
+   run.count = run_events.size();
+   run.position = 0;
+   merge_runs.push_back(run);
+
+   merge_heap.clear();
+   for (i = 0; i < merge_runs.size(); i++)
+   {
+      if (merge_runs[i].run_file != NULL)
+      {
+         rewind(merge_runs[i].run_file);
+         merge_runs[i].file_events = merge_runs[i].run_length;
+         merge_runs[i].count = 0;
+         fill_run(&merge_runs[i]);
+      }
+      else
+      {
+         merge_runs[i].position = 0;
+      }
+      if (merge_runs[i].position < merge_runs[i].count)
+         merge_heap.push_back(i);
+   }
+
+   order.runs = merge_runs.data();
+   make_heap(merge_heap.begin(), merge_heap.end(), order);
+
+   return(merge_runs.size());
+}
+
+/*
+   Function: next_event
+   Purpose : Gets the next event in time order from the merged runs.
+   Input   : Event to fill.
+   Output  : Returns 1 if an event was read, 0 at the end of the timeline.
+*/
+int Fineline_Event_List::next_event(fl_mac_event_t *event)
+{
+   fl_event_run_order order;
+   fl_event_run_t *run;
+   size_t r;
+
+   if (merge_heap.empty())
+      return(0);
+
+   order.runs = merge_runs.data();
+   r = merge_heap.front();
+   run = &merge_runs[r];
+   *event = run->events[run->position];
+
+   pop_heap(merge_heap.begin(), merge_heap.end(), order);
+   merge_heap.pop_back();
+
+   run->position++;
+   if ((run->position < run->count) || (fill_run(run) > 0))
+   {
+      merge_heap.push_back(r);
+      push_heap(merge_heap.begin(), merge_heap.end(), order);
+   }
+
+   return(1);
+}
+
+/*
+   Function: find_run_time
+   Purpose : Binary searches a spilled run for the first event at or after a
+             time.
+   Input   : The run and the time.
+   Output  : Returns the event number in the run.
+*/
+size_t Fineline_Event_List::find_run_time(fl_event_run_t *run, int64_t event_time)
+{
+   fl_mac_event_t ev;
+   size_t low = 0;
+   size_t high = run->run_length;
+   size_t middle;
+
+   while (low < high)
+   {
+      middle = low + ((high - low) / 2);
+      if ((fseek(run->run_file, (long)(middle * sizeof(fl_mac_event_t)), SEEK_SET) != 0) ||
+               (fread(&ev, sizeof(fl_mac_event_t), 1, run->run_file) != 1))
+      {
+         Fineline_Log::print_log_entry("Fineline_Event_List.find_run_time() <ERROR> Could not read temporary file.\n");
+         return(run->run_length);
+      }
+      if (ev.event_time < event_time)
+         low = middle + 1;
+      else
+         high = middle;
+   }
+
+   return(low);
+}
+
+/*
+   Function: get_window_events
+   Purpose : Gets the sorted events in a time range without merging the
+             whole timeline, each run is binary searched for the start of the
+             range. Used by the timeline graph to draw single events when it
+             is zoomed in, the read position of a merge is kept.
+   Input   : Start time, end time (exclusive), the list to fill and the most
+             events to get.
+   Output  : Returns the number of events, at most max_events.
+*/
+int Fineline_Event_List::get_window_events(int64_t start_time, int64_t end_time, vector< fl_mac_event_t > &events, size_t max_events)
+{
+   vector< fl_mac_event_t >::iterator it;
+   fl_event_run_t *run;
+   fl_mac_event_t ev;
+   size_t i, n, position;
+   long file_position;
+
+   events.clear();
+
+   for (i = 0; i < merge_runs.size(); i++)
+   {
+      run = &merge_runs[i];
+      if (run->run_file == NULL)
+         continue;
+      file_position = ftell(run->run_file);
+      position = find_run_time(run, start_time);
+      if (position < run->run_length)
+         fseek(run->run_file, (long)(position * sizeof(fl_mac_event_t)), SEEK_SET);
+      for (n = 0; (position < run->run_length) && (n < max_events); position++, n++)
+      {
+         if ((fread(&ev, sizeof(fl_mac_event_t), 1, run->run_file) != 1) || (ev.event_time >= end_time))
+            break;
+         events.push_back(ev);
+      }
+      fseek(run->run_file, file_position, SEEK_SET);
+   }
+
+   ev.event_time = start_time;
+   it = lower_bound(run_events.begin(), run_events.end(), ev, fl_event_time_order());
+   for (n = 0; (it != run_events.end()) && (n < max_events) && (it->event_time < end_time); ++it, n++)
+      events.push_back(*it);
+
+   // the runs are each sorted, the window of every run is merged here
+   stable_sort(events.begin(), events.end(), fl_event_time_order());
+   if (events.size() > max_events)
+      events.resize(max_events);
+
+   return(events.size());
+}
+
+void Fineline_Event_List::set_histogram(Fineline_Event_Histogram *event_histogram)
+{
+   histogram = event_histogram;
+}
+
+/*
+   Function: write_records
+   Purpose : Writes the sorted timeline to a FineLine event file.
+   Input   : Event file name.
+   Output  : Returns the number of events written, -1 on error.
+*/
+int Fineline_Event_List::write_records(const char *filename)
+{
+   fl_mac_event_t ev;
+   string event_string;
+   FILE *fp;
+   long n = 0;
+
+   fp = fopen(filename, "w");
+   if (fp == NULL)
+   {
+      Fineline_Log::print_log_entry("Fineline_Event_List.write_records() <ERROR> Could not open event file.\n");
+      return(-1);
+   }
+
+   start_merge();
+   while (next_event(&ev))
+   {
+      // events loaded from an event file are already in that file
+      if (ev.record == NULL)
+         continue;
+      n++;
+      format_event(&ev, n, event_string);
+      fwrite(event_string.data(), 1, event_string.size(), fp);
+   }
+
+   if (fclose(fp) != 0)
+   {
+      Fineline_Log::print_log_entry("Fineline_Event_List.write_records() <ERROR> Could not write event file.\n");
+      return(-1);
+   }
+
+   return((int)n);
+}
+
+/*
+   Function: send_records
+   Purpose : Sends the sorted timeline to the timeline GUI, event records are
+             sent in blocks of about FL_EVENT_BLOCK_SIZE bytes.
+   Input   : Open GUI socket.
+   Output  : Returns the number of events sent, -1 on error.
+*/
+int Fineline_Event_List::send_records(Fineline_Socket_BSD *socket)
+{
+   fl_mac_event_t ev;
+   string event_string;
+   string event_block;
+   long n = 0;
+
+   event_block.reserve(FL_EVENT_BLOCK_SIZE + FL_MAX_INPUT_STR);
+
+   start_merge();
+   while (next_event(&ev))
+   {
+      if (ev.record == NULL)
+         continue;
+      n++;
+      format_event(&ev, n, event_string);
+      event_block.append(event_string);
+      if (event_block.size() >= FL_EVENT_BLOCK_SIZE)
+      {
+         if (socket->send_event_block(event_block.data(), event_block.size()) < 0)
+            return(-1);
+         event_block.clear();
+      }
+   }
+
+   if ((event_block.size() > 0) && (socket->send_event_block(event_block.data(), event_block.size()) < 0))
+      return(-1);
+
+   return((int)n);
+}
+
+/*
+   Function: write_bodyfile
+   Purpose : Writes the files in the Sleuthkit body file format, one line per
+             file and one per extra event, for mactime. The lines are not
+             sorted so sort_records() is not needed.
+   Input   : Body file name.
+   Output  : Returns the number of lines written, -1 on error.
+*/
+int Fineline_Event_List::write_bodyfile(const char *filename)
+{
+   fl_file_record_t times;
+   fl_mac_event_t *ev;
+   string body_line;
+   FILE *fp;
+   size_t i, j;
+   long n = 0;
+
+   fp = fopen(filename, "w");
+   if (fp == NULL)
+   {
+      Fineline_Log::print_log_entry("Fineline_Event_List.write_bodyfile() <ERROR> Could not open body file.\n");
+      return(-1);
+   }
+
+   for (i = 0; i < file_list.size(); i++, n++)
+   {
+      format_bodyfile_line(file_list[i], 0, body_line);
+      fwrite(body_line.data(), 1, body_line.size(), fp);
+   }
+   for (i = 0; i < file_maps.size(); i++)
+   {
+      for (j = 0; j < file_maps[i]->size(); j++, n++)
+      {
+         format_bodyfile_line(file_maps[i]->get_record(j), 0, body_line);
+         fwrite(body_line.data(), 1, body_line.size(), fp);
+      }
+   }
+   for (i = 0; i < mac_event_list.size(); i++)
+   {
+      // mactime skips times that are 0, so only the times of the event are set
+      ev = &mac_event_list[i];
+      if (ev->record == NULL)
+         continue;
+      n++;
+      times = *ev->record;
+      times.modification_time = (ev->flags & FL_MAC_MODIFIED) ? ev->event_time : 0;
+      times.access_time = (ev->flags & FL_MAC_ACCESSED) ? ev->event_time : 0;
+      times.change_time = (ev->flags & FL_MAC_CHANGED) ? ev->event_time : 0;
+      times.creation_time = (ev->flags & FL_MAC_BORN) ? ev->event_time : 0;
+      format_bodyfile_line(&times, ev->flags, body_line);
+      fwrite(body_line.data(), 1, body_line.size(), fp);
+   }
+
+   if (fclose(fp) != 0)
+   {
+      Fineline_Log::print_log_entry("Fineline_Event_List.write_bodyfile() <ERROR> Could not write body file.\n");
+      return(-1);
+   }
+
+   return((int)n);
+}
+
+/*
+   Function: format_event_time
+   Purpose : Converts a UTC time to the event file format without the C
+             library time functions, which are slow and not thread safe.
+   Input   : Seconds since 1970 and a buffer of at least 20 characters.
+   Output  : Returns the string length, e.g. "25/04/2014 13:05:59".
+*/
+int Fineline_Event_List::format_event_time(int64_t event_time, char *time_string)
+{
+   int64_t days = event_time / 86400;
+   int64_t seconds = event_time % 86400;
+   int64_t era, day_of_era, year_of_era, day_of_year, mp, day, month, year;
+
+   if (seconds < 0)
+   {
+      seconds += 86400;
+      days--;
+   }
+
+   // civil date from days since 1970, proleptic Gregorian calendar
+   days += 719468;
+   era = ((days >= 0) ? days : days - 146096) / 146097;
+   day_of_era = days - (era * 146097);
+   year_of_era = (day_of_era - (day_of_era / 1460) + (day_of_era / 36524) - (day_of_era / 146096)) / 365;
+   day_of_year = day_of_era - ((365 * year_of_era) + (year_of_era / 4) - (year_of_era / 100));
+   mp = ((5 * day_of_year) + 2) / 153;
+   day = day_of_year - (((153 * mp) + 2) / 5) + 1;
+   month = (mp < 10) ? mp + 3 : mp - 9;
+   year = year_of_era + (era * 400) + ((month <= 2) ? 1 : 0);
+
+   return(sprintf(time_string, "%02d/%02d/%04d %02d:%02d:%02d", (int)day, (int)month, (int)year,
+                  (int)(seconds / 3600), (int)((seconds / 60) % 60), (int)(seconds % 60)));
+}
+
+/*
+   Function: format_event
+   Purpose : Creates the event file record of an event, the summary has the
+             mactime style macb flags and the file name, the data has the
+             full path of the file.
+   Input   : Event, event number and the string to fill.
+   Output  : Returns the record length.
+*/
+int Fineline_Event_List::format_event(const fl_mac_event_t *event, long event_id, string &event_string)
+{
+   char buffer[64];
+   char macb[6] = "....";
+   fl_file_record_t *flrec = event->record;
+
+   if (event->flags & FL_MAC_MODIFIED)
+      macb[0] = 'm';
+   if (event->flags & FL_MAC_ACCESSED)
+      macb[1] = 'a';
+   if (event->flags & FL_MAC_CHANGED)
+      macb[2] = 'c';
+   if (event->flags & FL_MAC_BORN)
+      macb[3] = 'b';
+   macb[4] = ' ';
+
+   event_string.assign("<event><id>");
+   sprintf(buffer, "%ld", event_id);
+   event_string.append(buffer);
+   event_string.append("</id><evidencenumber>NONE</evidencenumber><time>");
+   format_event_time(event->event_time, buffer);
+   event_string.append(buffer);
+   sprintf(buffer, "</time><type>%d</type><summary>", FL_MACTIME_EVENT);
+   event_string.append(buffer);
+   event_string.append(macb);
+   if (event->flags & FL_MAC_FILE_NAME)
+      event_string.append("($FILE_NAME) ");
+   if (flrec->file_name != NULL)
+      event_string.append(flrec->file_name);
+   event_string.append("</summary><data>");
+   event_string.append(Fineline_File_Arena::get_full_path(flrec));
+   if (flrec->deleted)
+      event_string.append(" (deleted)");
+   event_string.append("</data><hiddenevent>0</hiddenevent><hiddentext>0</hiddentext><marked>0</marked><pinned>0</pinned><ypos>0</ypos></event>\n");
+
+   return(event_string.size());
+}
+
+/*
+   Function: format_bodyfile_line
+   Purpose : Creates the body file line of a file,
+             MD5|name|inode|mode_as_string|UID|GID|size|atime|mtime|ctime|crtime
+             The owner and permissions are not kept in the file records.
+   Input   : File record, FL_MAC_ flags of the line and the string to fill.
+   Output  : Returns the line length.
+*/
+int Fineline_Event_List::format_bodyfile_line(fl_file_record_t *flrec, int flags, string &body_line)
+{
+   static const char hex_digits[] = "0123456789abcdef";
+   char buffer[256];
+   int i;
+
+   body_line.clear();
+   if (flrec->digests != NULL)
+   {
+      for (i = 0; i < 16; i++)
+      {
+         body_line.push_back(hex_digits[flrec->digests->md5[i] >> 4]);
+         body_line.push_back(hex_digits[flrec->digests->md5[i] & 0x0F]);
+      }
+   }
+   else
+   {
+      body_line.push_back('0');
+   }
+   body_line.push_back('|');
+   body_line.append(Fineline_File_Arena::get_full_path(flrec));
+   if (flags & FL_MAC_FILE_NAME)
+      body_line.append(" ($FILE_NAME)");
+   if (flrec->deleted)
+      body_line.append(" (deleted)");
+
+   if (flrec->attribute_type != 0)
+      sprintf(buffer, "|%llu-%u-%u", (unsigned long long)flrec->meta_address, flrec->attribute_type, flrec->attribute_id);
+   else
+      sprintf(buffer, "|%llu", (unsigned long long)flrec->meta_address);
+   body_line.append(buffer);
+
+   sprintf(buffer, "|%s|0|0|%lld|%lld|%lld|%lld|%lld\n", (flrec->file_type == TSK_FS_META_TYPE_DIR) ? "d/d---------" : "r/r---------",
+           (long long)flrec->file_size, (long long)flrec->access_time, (long long)flrec->modification_time,
+           (long long)flrec->change_time, (long long)flrec->creation_time);
+   body_line.append(buffer);
+
+   return(body_line.size());
+}
+
+size_t Fineline_Event_List::event_count()
+{
+   return(total_events);
+}
+
+/*
+   Function: spill_count
+   Purpose : Gets the number of runs spilled to temporary files by sort_records().
+   Input   : None.
+   Output  : Number of spilled runs.
+*/
+size_t Fineline_Event_List::spill_count()
+{
+   size_t i, n = 0;
+
+   for (i = 0; i < merge_runs.size(); i++)
+   {
+      if (merge_runs[i].run_file != NULL)
+         n++;
+   }
+
+   return(n);
+}
+
+void Fineline_Event_List::set_run_size(size_t events)
+{
+   run_size = (events > 0) ? events : 1;
+}
+
+void Fineline_Event_List::set_thread_count(int threads)
+{
+   thread_count = threads;
+}
+
+/*
+   Function: clear_runs
+   Purpose : Closes and deletes the spilled runs and frees the sorted events.
+   Input   : None.
+   Output  : None.
+*/
+void Fineline_Event_List::clear_runs()
+{
+   size_t i;
+
+   for (i = 0; i < merge_runs.size(); i++)
+   {
+      if (merge_runs[i].run_file != NULL)
+         fclose(merge_runs[i].run_file);
+   }
+   merge_runs.clear();
+   merge_heap.clear();
+   vector< fl_mac_event_t >().swap(run_events);
+   total_events = 0;
+
+   return;
+}
+
 int Fineline_Event_List::list_size()
 {
    return(file_list.size());
@@ -91,6 +892,9 @@ int Fineline_Event_List::clear_list()
    //}
 
    file_list.clear();
+   file_maps.clear();
+   mac_event_list.clear();
+   clear_runs();
 
    return(file_list.size());
 }
@@ -4,10 +4,47 @@
 #include <vector>
 #include <string>
 
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include "fineline-search.h"
+#include "Fineline_File_Index.h"
+#include "Fineline_Event_Histogram.h"
+
+#define FL_EVENT_RUN_SIZE     4194304     /* events sorted in memory before a run is spilled to disk */
+#define FL_EVENT_READ_SIZE    65536       /* events read at a time from each spilled run */
+#define FL_EVENT_BLOCK_SIZE   1048576     /* bytes of event records sent to the GUI at a time */
+#define FL_EVENT_MIN_CHUNK    65536       /* smallest block of a run sorted by its own thread */
+#define FL_MACTIME_EVENT      17          /* GUI event type of file system MAC time events */
 
 using namespace std;
 
+class Fineline_Socket_BSD;
+
+/*
+   A sorted run of events, either the last run still in memory or a run
+   spilled to a temporary file and read back in blocks during the merge.
+*/
+struct fl_event_run
+{
+   FILE *run_file;                   /* NULL for the run in memory */
+   size_t run_length;
+   size_t file_events;               /* events not yet read from the file */
+   vector< fl_mac_event_t > buffer;
+   const fl_mac_event_t *events;
+   size_t count;
+   size_t position;
+};
+typedef struct fl_event_run fl_event_run_t;
+
+/*
+   MAC timeline of a set of files. sort_records() generates the modified,
+   accessed, changed and born events of every file and sorts them in runs of
+   a bounded size, full runs are sorted by several threads and spilled to
+   temporary files. The writers merge the runs in time order and stream the
+   events out, so the timeline of an image never has to fit in memory.
+*/
 class Fineline_Event_List
 {
    public:
@@ -15,21 +52,52 @@ class Fineline_Event_List
       virtual ~Fineline_Event_List();
 
       int add_file_record(fl_file_record_t *flf);
+      int add_file_map(Fineline_File_Map fmap);
+      int add_mac_events(const vector< fl_mac_event_t > &events);
       int delete_file_record(int record_index);
       int find_file_record(string filename);
       int sort_records();
-      int write_records();
-      int send_records();
+      int write_records(const char *filename);
+      int write_bodyfile(const char *filename);
+      int send_records(Fineline_Socket_BSD *socket);
       int list_size();
       int clear_list();
 
+      int get_window_events(int64_t start_time, int64_t end_time, vector< fl_mac_event_t > &events, size_t max_events);
+      void set_histogram(Fineline_Event_Histogram *event_histogram);
+      int start_merge();
+      int next_event(fl_mac_event_t *event);
+      size_t event_count();
+      size_t spill_count();
+      void set_run_size(size_t events);
+      void set_thread_count(int threads);
+
+      static int format_event(const fl_mac_event_t *event, long event_id, string &event_string);
+      static int format_bodyfile_line(fl_file_record_t *flrec, int flags, string &body_line);
+      static int format_event_time(int64_t event_time, char *time_string);
 
    protected:
    private:
 
+      int add_record_events(fl_file_record_t *flrec);
+      int add_event(int64_t event_time, fl_file_record_t *flrec, int flags);
+      int spill_run();
+      void sort_run();
+      void clear_runs();
+      int fill_run(fl_event_run_t *run);
+      size_t find_run_time(fl_event_run_t *run, int64_t event_time);
+
    vector<fl_file_record_t *> file_list;
+   vector< Fineline_File_Map > file_maps;
+   vector< fl_mac_event_t > mac_event_list;
 
-   //TODO: Fineline_Event_File fl_event_file; NO put in write_records();
+   vector< fl_mac_event_t > run_events;   /* the run being filled, sorted by sort_records() */
+   vector< fl_event_run_t > merge_runs;
+   vector< size_t > merge_heap;           /* merge run numbers, the run with the earliest event first */
+   Fineline_Event_Histogram *histogram;   /* counts the events as each run is sorted, NULL if none */
+   size_t total_events;
+   size_t run_size;
+   int thread_count;
 
 };
 
@@ -0,0 +1,519 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   Fineline_Event_Loader.cpp
+
+   Title : FineLine Computer Forensics Timeline Constructor
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Memory mapped, multi-threaded FineLine event file loader.
+
+   Notes: The byte scanner is selected once at run time, AVX2 if the CPU
+          has it, otherwise SSE2, otherwise a plain loop on non-x86 builds.
+
+*/
+
+#include <iostream>
+#include <thread>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef LINUX_BUILD
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <windows.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define FL_LOADER_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#include "Fineline_Event_Loader.h"
+#include "Fineline_Log.h"
+#include "fltime.h"
+
+using namespace std;
+
+typedef const char *(*fl_find_byte_fn)(const char *start, const char *end, char c);
+
+static const char *find_byte_scalar(const char *start, const char *end, char c)
+{
+   const void *p = memchr(start, c, (size_t)(end - start));
+   return((const char *)p);
+}
+
+#ifdef FL_LOADER_X86_SIMD
+
+static const char *find_byte_sse2(const char *start, const char *end, char c)
+{
+   __m128i needle = _mm_set1_epi8(c);
+   unsigned int mask;
+
+   while (end - start >= 16)
+   {
+      mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)start), needle));
+      if (mask != 0)
+         return(start + __builtin_ctz(mask));
+      start += 16;
+   }
+   return(find_byte_scalar(start, end, c));
+}
+
+__attribute__((target("avx2")))
+static const char *find_byte_avx2(const char *start, const char *end, char c)
+{
+   __m256i needle = _mm256_set1_epi8(c);
+   unsigned int mask;
+
+   while (end - start >= 32)
+   {
+      mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)start), needle));
+      if (mask != 0)
+         return(start + __builtin_ctz(mask));
+      start += 32;
+   }
+   return(find_byte_sse2(start, end, c));
+}
+
+static fl_find_byte_fn select_find_byte()
+{
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx2"))
+      return(find_byte_avx2);
+   return(find_byte_sse2);
+}
+
+#else
+
+static fl_find_byte_fn select_find_byte()
+{
+   return(find_byte_scalar);
+}
+
+#endif
+
+bool fl_string_view::equals(const char *s) const
+{
+   size_t len = strlen(s);
+   return((len == length) && (memcmp(data, s, len) == 0));
+}
+
+Fineline_Event_Loader::Fineline_Event_Loader()
+{
+   file_data = NULL;
+   file_size = 0;
+   project_header.data = NULL;
+   project_header.length = 0;
+#ifdef LINUX_BUILD
+   file_descriptor = -1;
+#else
+   file_handle = INVALID_HANDLE_VALUE;
+   mapping_handle = NULL;
+#endif
+}
+
+Fineline_Event_Loader::~Fineline_Event_Loader()
+{
+   close_event_file();
+}
+
+/*
+   Function: find_byte
+   Purpose : finds the first c in [start, end) with the fastest scanner
+             the CPU supports.
+   Input   : range to scan and the byte to find.
+   Output  : pointer to the byte or NULL if it is not in the range.
+*/
+const char *Fineline_Event_Loader::find_byte(const char *start, const char *end, char c)
+{
+   static const fl_find_byte_fn scan = select_find_byte();
+
+   if (start >= end)
+      return(NULL);
+   return(scan(start, end, c));
+}
+
+static const char *find_tag(const char *p, const char *end, const char *tag, size_t tag_len)
+{
+   while ((p = Fineline_Event_Loader::find_byte(p, end, '<')) != NULL)
+   {
+      if (((size_t)(end - p) >= tag_len) && (memcmp(p, tag, tag_len) == 0))
+         return(p);
+      p++;
+   }
+   return(NULL);
+}
+
+/*
+   Sets the view to the value between the open and close tags, the cursor
+   moves past the close tag. Missing tags leave the view empty and the
+   cursor where it was.
+*/
+static void get_tag_view(const char **cursor, const char *end, const char *open_tag, const char *close_tag, fl_string_view_t *view)
+{
+   size_t open_len = strlen(open_tag);
+   const char *start, *stop;
+
+   view->data = NULL;
+   view->length = 0;
+
+   start = find_tag(*cursor, end, open_tag, open_len);
+   if (start == NULL)
+      return;
+   start += open_len;
+   stop = find_tag(start, end, close_tag, strlen(close_tag));
+   if (stop == NULL)
+      return;
+
+   view->data = start;
+   view->length = (size_t)(stop - start);
+   *cursor = stop + strlen(close_tag);
+}
+
+/*
+   Function: parse_event_time
+   Purpose : converts an event time to seconds since 1970, the fixed width
+             "DD/MM/YYYY HH:MM:SS" is decoded in place, other formats are
+             passed to parse_fle_time().
+   Input   : time string and length.
+   Output  : event time or FL_EVENT_INVALID_TIME.
+*/
+int64_t Fineline_Event_Loader::parse_event_time(const char *time_string, size_t length)
+{
+   int day, month, year, hour, minute, second, i;
+   char tstr[64];
+
+   if ((time_string == NULL) || (length == 0) || (length >= sizeof(tstr)))
+      return(FL_EVENT_INVALID_TIME);
+
+   /* fast path for the fixed width "DD/MM/YYYY HH:MM:SS" written by the parsers */
+   if ((length == 19) && (time_string[2] == '/') && (time_string[5] == '/') && (time_string[10] == ' ') &&
+       (time_string[13] == ':') && (time_string[16] == ':'))
+   {
+      static const int digit_pos[14] = { 0, 1, 3, 4, 6, 7, 8, 9, 11, 12, 14, 15, 17, 18 };
+      int v[14];
+
+      for (i = 0; i < 14; i++)
+      {
+         v[i] = time_string[digit_pos[i]] - '0';
+         if ((v[i] < 0) || (v[i] > 9))
+            break;
+      }
+      if (i == 14)
+      {
+         day = v[0] * 10 + v[1];
+         month = v[2] * 10 + v[3];
+         year = v[4] * 1000 + v[5] * 100 + v[6] * 10 + v[7];
+         hour = v[8] * 10 + v[9];
+         minute = v[10] * 10 + v[11];
+         second = v[12] * 10 + v[13];
+         if ((month < 1) || (month > 12) || (day < 1) || (day > 31) || (hour > 23) || (minute > 59) || (second > 60))
+            return(FL_EVENT_INVALID_TIME);
+         return(days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second);
+      }
+   }
+
+   memcpy(tstr, time_string, length);
+   tstr[length] = '\0';
+
+   return(parse_fle_time(tstr));
+}
+
+/*
+   Function: parse_event_record
+   Purpose : sets the field views of one event record line, the tags are
+             found in record order.
+   Input   : line without the newline, length and the event to fill in.
+   Output  : 0 on success, -1 if the line is not an event record.
+*/
+int Fineline_Event_Loader::parse_event_record(const char *line, size_t length, fl_event_view_t *event)
+{
+   const char *end = line + length;
+   const char *cursor = line + 7;
+
+   if ((length < 7) || (memcmp(line, "<event>", 7) != 0))
+      return(-1);
+
+   event->record.data = line;
+   event->record.length = length;
+   get_tag_view(&cursor, end, "<id>", "</id>", &event->id);
+   get_tag_view(&cursor, end, "<evidencenumber>", "</evidencenumber>", &event->evidence_number);
+   get_tag_view(&cursor, end, "<time>", "</time>", &event->time);
+   get_tag_view(&cursor, end, "<type>", "</type>", &event->type);
+   get_tag_view(&cursor, end, "<summary>", "</summary>", &event->summary);
+   get_tag_view(&cursor, end, "<data>", "</data>", &event->data);
+   event->event_time = parse_event_time(event->time.data, event->time.length);
+
+   return(0);
+}
+
+/*
+   Function: open_event_file
+   Purpose : maps the event file read only.
+   Input   : event file name.
+   Output  : 0 on success, -1 on error.
+*/
+int Fineline_Event_Loader::open_event_file(string filename)
+{
+   close_event_file();
+   event_filename = filename;
+
+#ifdef LINUX_BUILD
+   struct stat st;
+
+   file_descriptor = open(filename.c_str(), O_RDONLY);
+   if (file_descriptor < 0)
+   {
+      Fineline_Log::print_log_entry("Fineline_Event_Loader.open_event_file() <ERROR> Could not open event file:", filename);
+      return(-1);
+   }
+   if (fstat(file_descriptor, &st) < 0)
+   {
+      Fineline_Log::print_log_entry("Fineline_Event_Loader.open_event_file() <ERROR> Could not stat event file:", filename);
+      close_event_file();
+      return(-1);
+   }
+   file_size = (size_t)st.st_size;
+   if (file_size > 0)
+   {
+      void *p = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+      if (p == MAP_FAILED)
+      {
+         Fineline_Log::print_log_entry("Fineline_Event_Loader.open_event_file() <ERROR> Could not map event file:", filename);
+         file_size = 0;
+         close_event_file();
+         return(-1);
+      }
+      madvise(p, file_size, MADV_WILLNEED);
+      file_data = (const char *)p;
+   }
+#else
+   LARGE_INTEGER size;
+
+   file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+   if (file_handle == INVALID_HANDLE_VALUE)
+   {
+      Fineline_Log::print_log_entry("Fineline_Event_Loader.open_event_file() <ERROR> Could not open event file:", filename);
+      return(-1);
+   }
+   if (!GetFileSizeEx(file_handle, &size))
+   {
+      close_event_file();
+      return(-1);
+   }
+   file_size = (size_t)size.QuadPart;
+   if (file_size > 0)
+   {
+      mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (mapping_handle != NULL)
+         file_data = (const char *)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+      if (file_data == NULL)
+      {
+         Fineline_Log::print_log_entry("Fineline_Event_Loader.open_event_file() <ERROR> Could not map event file:", filename);
+         file_size = 0;
+         close_event_file();
+         return(-1);
+      }
+   }
+#endif
+
+   return(0);
+}
+
+/*
+   Parses the whole lines in [start, end), start is on a line boundary.
+*/
+size_t Fineline_Event_Loader::parse_range(size_t start, size_t end, vector<fl_event_view_t> &events)
+{
+   const char *p = file_data + start;
+   const char *limit = file_data + end;
+   const char *nl;
+   size_t len;
+   fl_event_view_t ev;
+
+   events.reserve((end - start) / 256);
+
+   while (p < limit)
+   {
+      nl = find_byte(p, limit, '\n');
+      if (nl == NULL)
+         nl = limit;
+      len = (size_t)(nl - p);
+      if ((len > 0) && (p[len - 1] == '\r'))
+         len--;
+      if (parse_event_record(p, len, &ev) == 0)
+      {
+         ev.offset = (uint64_t)(p - file_data);
+         events.push_back(ev);
+      }
+      p = nl + 1;
+   }
+
+   return(events.size());
+}
+
+void Fineline_Event_Loader::parse_range_task(Fineline_Event_Loader *loader, size_t start, size_t end, vector<fl_event_view_t> *events)
+{
+   loader->parse_range(start, end, *events);
+}
+
+/*
+   Function: load_events
+   Purpose : splits the mapped file into one range per thread at record
+             boundaries and parses the ranges in parallel, the records
+             are kept in file order.
+   Input   : number of threads, 0 = one per CPU core.
+   Output  : number of event records, -1 on error.
+*/
+long Fineline_Event_Loader::load_events(int thread_count)
+{
+   vector<size_t> split_points;
+   vector< vector<fl_event_view_t> > range_events;
+   vector<thread> workers;
+   const char *nl;
+   size_t total = 0;
+   int i;
+
+   event_list.clear();
+   project_header.data = NULL;
+   project_header.length = 0;
+
+   if ((file_data == NULL) || (file_size == 0))
+      return(0);
+
+   /* the project header is the first line of the file */
+   if ((file_size > 9) && (memcmp(file_data, "<project>", 9) == 0))
+   {
+      nl = find_byte(file_data, file_data + file_size, '\n');
+      project_header.data = file_data;
+      project_header.length = (nl != NULL) ? (size_t)(nl - file_data) : file_size;
+   }
+
+   if (thread_count <= 0)
+      thread_count = (int)thread::hardware_concurrency();
+   if (thread_count <= 0)
+      thread_count = 1;
+   if ((size_t)thread_count > file_size / FL_LOADER_MIN_RANGE)
+      thread_count = (int)(file_size / FL_LOADER_MIN_RANGE);
+   if (thread_count < 1)
+      thread_count = 1;
+
+   split_points.push_back(0);
+   for (i = 1; i < thread_count; i++)
+   {
+      size_t pos = (file_size / thread_count) * i;
+
+      if (pos < split_points.back())
+         pos = split_points.back();
+      nl = find_byte(file_data + pos, file_data + file_size, '\n');
+      pos = (nl != NULL) ? (size_t)(nl - file_data) + 1 : file_size;
+      split_points.push_back(pos);
+   }
+   split_points.push_back(file_size);
+
+   range_events.resize(thread_count);
+   for (i = 1; i < thread_count; i++)
+   {
+      workers.push_back(thread(parse_range_task, this, split_points[i], split_points[i + 1], &range_events[i]));
+   }
+   parse_range(split_points[0], split_points[1], range_events[0]);
+   for (i = 0; i < (int)workers.size(); i++)
+   {
+      workers[i].join();
+   }
+
+   for (i = 0; i < thread_count; i++)
+      total += range_events[i].size();
+   if (thread_count == 1)
+   {
+      event_list.swap(range_events[0]);
+   }
+   else
+   {
+      event_list.reserve(total);
+      for (i = 0; i < thread_count; i++)
+      {
+         event_list.insert(event_list.end(), range_events[i].begin(), range_events[i].end());
+         vector<fl_event_view_t>().swap(range_events[i]);
+      }
+   }
+
+   return((long)total);
+}
+
+int Fineline_Event_Loader::close_event_file()
+{
+   event_list.clear();
+   project_header.data = NULL;
+   project_header.length = 0;
+
+#ifdef LINUX_BUILD
+   if (file_data != NULL)
+      munmap((void *)file_data, file_size);
+   if (file_descriptor >= 0)
+      close(file_descriptor);
+   file_descriptor = -1;
+#else
+   if (file_data != NULL)
+      UnmapViewOfFile(file_data);
+   if (mapping_handle != NULL)
+      CloseHandle(mapping_handle);
+   if (file_handle != INVALID_HANDLE_VALUE)
+      CloseHandle(file_handle);
+   mapping_handle = NULL;
+   file_handle = INVALID_HANDLE_VALUE;
+#endif
+   file_data = NULL;
+   file_size = 0;
+
+   return(0);
+}
+
+size_t Fineline_Event_Loader::event_count()
+{
+   return(event_list.size());
+}
+
+fl_event_view_t *Fineline_Event_Loader::get_event(size_t event_index)
+{
+   if (event_index >= event_list.size())
+      return(NULL);
+   return(&event_list[event_index]);
+}
+
+vector<fl_event_view_t> &Fineline_Event_Loader::get_events()
+{
+   return(event_list);
+}
+
+fl_string_view_t Fineline_Event_Loader::get_project_header()
+{
+   return(project_header);
+}
+
+size_t Fineline_Event_Loader::get_file_size()
+{
+   return(file_size);
+}
@@ -0,0 +1,119 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   Fineline_Event_Loader.h
+
+   Title : FineLine Computer Forensics Timeline Constructor
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Fast loader for FineLine event files (.fle). The event file is
+            memory mapped and split into ranges at record boundaries, each
+            range is parsed by its own thread. Records and their fields are
+            views into the mapping, nothing is copied or allocated per
+            field, so the event file must stay open while the records are
+            in use.
+
+            Line and tag boundaries are found with SSE2/AVX2 byte scans,
+            AVX2 is used when the CPU supports it.
+
+*/
+
+#ifndef FINELINE_EVENT_LOADER_H
+#define FINELINE_EVENT_LOADER_H
+
+#include <vector>
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fltime.h"
+
+using namespace std;
+
+#define FL_EVENT_INVALID_TIME FLE_INVALID_TIME
+#define FL_LOADER_MIN_RANGE   4194304    /* do not split files smaller than 4MB per thread */
+
+/* a view of part of the mapped event file, not NUL terminated */
+struct fl_string_view
+{
+   const char *data;
+   size_t length;
+
+   string str() const { return(string(data != NULL ? data : "", length)); }
+   bool empty() const { return(length == 0); }
+   bool equals(const char *s) const;
+};
+typedef struct fl_string_view fl_string_view_t;
+
+struct fl_event_view
+{
+   uint64_t offset;          /* byte offset of the record in the event file */
+   int64_t event_time;       /* seconds since 1970, FL_EVENT_INVALID_TIME if not parsed */
+   fl_string_view_t record;  /* the whole line without the newline */
+   fl_string_view_t id;
+   fl_string_view_t evidence_number;
+   fl_string_view_t time;
+   fl_string_view_t type;
+   fl_string_view_t summary;
+   fl_string_view_t data;
+};
+typedef struct fl_event_view fl_event_view_t;
+
+class Fineline_Event_Loader
+{
+   public:
+      Fineline_Event_Loader();
+      virtual ~Fineline_Event_Loader();
+
+      int open_event_file(string filename);
+      long load_events(int thread_count = 0);
+      int close_event_file();
+
+      size_t event_count();
+      fl_event_view_t *get_event(size_t event_index);
+      vector<fl_event_view_t> &get_events();
+      fl_string_view_t get_project_header();
+      size_t get_file_size();
+
+      static const char *find_byte(const char *start, const char *end, char c);
+      static int64_t parse_event_time(const char *time_string, size_t length);
+      static int parse_event_record(const char *line, size_t length, fl_event_view_t *event);
+
+   protected:
+   private:
+
+      size_t parse_range(size_t start, size_t end, vector<fl_event_view_t> &events);
+      static void parse_range_task(Fineline_Event_Loader *loader, size_t start, size_t end, vector<fl_event_view_t> *events);
+
+      const char *file_data;
+      size_t file_size;
+      vector<fl_event_view_t> event_list;
+      fl_string_view_t project_header;
+      string event_filename;
+#ifdef LINUX_BUILD
+      int file_descriptor;
+#else
+      void *file_handle;
+      void *mapping_handle;
+#endif
+};
+
+#endif // FINELINE_EVENT_LOADER_H
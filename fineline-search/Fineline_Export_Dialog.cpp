@@ -34,14 +34,21 @@
 */
 
 #include <FL/filename.H>
+#include <FL/fl_ask.H>
 
 #include "Fineline_Log.h"
 #include "Fineline_Util.h"
 #include "Fineline_Export_Dialog.h"
+#include "Fineline_File_Arena.h"
+#include "../common/threads.h"
 
 
 Fineline_Export_Dialog::Fineline_Export_Dialog(int x, int y, int w, int h) : Fl_Double_Window(x, y, w, h, "Fineline Export Dialog")
 {
+   file_system = NULL;
+   file_exporter = NULL;
+   export_task_running = 0;
+
    begin();
 
    Fl_Group* browser_group = new Fl_Group(10, 10, w - 10, h - 10);
@@ -87,7 +94,6 @@ void Fineline_Export_Dialog::button_callback(Fl_Button *b, void *p)
 void Fineline_Export_Dialog::add_marked_files(vector< fl_file_record_t* > flist, Fineline_File_System *ffs)
 {
    unsigned int i;
-   char full_path[FL_PATH_MAX];
    marked_file_list = flist;
    file_system = ffs;
    string msg;
@@ -101,13 +107,12 @@ void Fineline_Export_Dialog::add_marked_files(vector< fl_file_record_t* > flist,
 
    for (i = 0; i < marked_file_list.size(); i++)
    {
-      memset((void*)full_path, 0, FL_PATH_MAX);
       fl_file_record_t *flec = marked_file_list[i];
       if (flec->file_type == TSK_FS_META_TYPE_REG)   // Regular file, not a directory.
       {
-         strncpy(full_path, flec->file_path, strlen(flec->file_path)); //Do not use the full path as it has the
-         strncat(full_path, flec->file_name, strlen(flec->file_name)); //the file system label at the start.
-         file_browser->add(full_path);
+         string file_path = Fineline_File_Arena::get_file_path(flec); //Do not use the full path as it has the
+         file_path.append(flec->file_name);                          //the file system label at the start.
+         file_browser->add(file_path.c_str());
          if (DEBUG)
             Fineline_Log::print_log_entry("Fineline_Export_Dialog::add_marked_files() <INFO> added marked file.");
 
@@ -124,32 +129,134 @@ void Fineline_Export_Dialog::add_marked_files(vector< fl_file_record_t* > flist,
    return;
 }
 
+/*
+   Function: export_files_task
+   Purpose : Worker function for the posix/win32 thread, must be a C function.
+   Input   : Pointer to the export dialog.
+   Output  : Returns NULL.
+*/
+void *export_files_task(void *p)
+{
+   Fineline_Export_Dialog *fed = (Fineline_Export_Dialog *)p;
+
+   fed->run_export();
+
+   return(NULL);
+}
+
+/*
+   Name   : export_files()
+   Purpose: Starts a thread to export the marked files to the evidence directory.
+   Input  : None.
+   Output : None.
+*/
 void Fineline_Export_Dialog::export_files()
 {
    string evidence_directory;
-   unsigned int i;
-   string msg;
+   char msg[FL_MAX_INPUT_STR];
+   Fl_Thread thread_id;
+
+   if (file_system == NULL)
+   {
+      fl_alert("<ERROR> Open a forensic image before exporting files!");
+      return;
+   }
+   if ((file_exporter != NULL) && file_exporter->get_running())
+   {
+      fl_alert("<ERROR> An export is already running!");
+      return;
+   }
+
+   if (file_exporter != NULL)
+      delete file_exporter;
 
    evidence_directory = evidence_directory_field->value();
+   file_exporter = new Fineline_File_Exporter(file_system->get_image_name(), file_system->get_file_system_offsets(), evidence_directory);
+   file_exporter->add_files(marked_file_list);
 
-   for (i = 0; i < marked_file_list.size(); i++)
+   snprintf(msg, FL_MAX_INPUT_STR, "Exporting %lu files to %s...", (unsigned long)file_exporter->get_file_count(), evidence_directory.c_str());
+   file_browser->add(msg);
+
+   export_task_running = 1;
+   fl_create_thread(thread_id, export_files_task, (void *)this);
+
+   return;
+}
+
+/*
+   Name   : run_export()
+   Purpose: Exports the files on all cores, called from the export thread.
+            The results are shown when the export finishes.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Export_Dialog::run_export()
+{
+   Fineline_Log::print_log_entry("run_export() <INFO> Started file export thread.");
+
+   file_exporter->export_files(0);
+
+   Fl::lock();
+   show_export_results();
+   export_task_running = 0;
+   Fl::unlock();
+
+   Fl::awake();
+
+   Fineline_Log::print_log_entry("run_export() <INFO> Finished file export thread.");
+}
+
+/*
+   Name   : clear_files()
+   Purpose: Stops a running export and removes the marked files, called
+            before the file system that owns the file records is deleted.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Export_Dialog::clear_files()
+{
+   if (file_exporter != NULL)
+      file_exporter->stop_export();
+   // the export thread shows the results with the FLTK lock held, Fl::wait() releases it
+   while (export_task_running)
+      Fl::wait(0.1);
+   if (file_exporter != NULL)
    {
-      fl_file_record_t *flec = marked_file_list[i];
-      if (file_system->export_file(flec, evidence_directory) == 0)
-      {
-         msg = "Exported file: ";
-         msg.append(flec->full_path);
-         file_browser->add(msg.c_str());
-      }
-      else
-      {
-         msg = "Error exporting file: ";
-         msg.append(flec->full_path);
-         file_browser->add(msg.c_str());
-      }
-      //if (DEBUG)
-      //   Fineline_Log::print_log_entry("Fineline_Export_Dialog::export_files() <INFO> export marked file.");
+      delete file_exporter;
+      file_exporter = NULL;
    }
 
+   marked_file_list.clear();
+   file_system = NULL;
+   file_browser->clear();
+
+   return;
+}
+
+/*
+   Name   : show_export_results()
+   Purpose: Lists the export status and SHA-256 of every file.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Export_Dialog::show_export_results()
+{
+   const vector< fl_export_result_t > &results = file_exporter->get_results();
+   char msg[FL_MAX_INPUT_STR];
+   unsigned int i;
+   long exported = 0;
+
+   for (i = 0; i < results.size(); i++)
+   {
+      file_browser->add(file_exporter->get_status_string(results[i]).c_str());
+      if (results[i].status == FL_EXPORT_OK)
+         exported++;
+   }
+
+   snprintf(msg, FL_MAX_INPUT_STR, "Exported %ld of %lu files, %llu MB, digests written to %s.", exported,
+            (unsigned long)results.size(), (unsigned long long)(file_exporter->get_bytes_copied() / 1048576), FL_EXPORT_MANIFEST);
+   file_browser->add(msg);
+   file_browser->bottomline(file_browser->size());
+
    return;
 }
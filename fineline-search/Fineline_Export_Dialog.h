@@ -48,6 +48,7 @@
 
 #include "fineline-search.h"
 #include "Fineline_File_System.h"
+#include "Fineline_File_Exporter.h"
 
 using namespace std;
 
@@ -58,18 +59,23 @@ class Fineline_Export_Dialog : public Fl_Double_Window
       virtual ~Fineline_Export_Dialog();
 
       void add_marked_files(vector< fl_file_record_t* > flist, Fineline_File_System *ffs);
+      void run_export();
+      void clear_files();
 
    protected:
    private:
 
       vector< fl_file_record_t* > marked_file_list;
       Fineline_File_System *file_system;
+      Fineline_File_Exporter *file_exporter;
+      int export_task_running;
       Fl_Browser *file_browser;
       Fl_File_Input *evidence_directory_field;
       Fl_Button* export_button;
       Fl_Button* close_button;
 
       void export_files();
+      void show_export_results();
       static void button_callback(Fl_Button *b, void *p);
 };
 
@@ -0,0 +1,403 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_File_Arena.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Block allocator for file metadata records and their strings.
+            Memory is taken from the system in large blocks and handed out
+            sequentially, nothing is freed until the whole arena is cleared.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Fineline_File_Arena.h"
+#include "../common/Fineline_Util.h"
+
+#define FL_ARENA_ALIGN(x) (((x) + 7) & ~((size_t)7))
+#define FL_ARENA_MAX_DEPTH 1024   /* deepest directory nesting followed when rebuilding a path */
+
+Fineline_File_Arena::Fineline_File_Arena()
+{
+   int i;
+
+   shared_cursor.block_next = NULL;
+   shared_cursor.block_remaining = 0;
+   memory_used = 0;
+   record_count = 0;
+   for (i = 0; i < FL_ARENA_INTERN_SHARDS; i++)
+   {
+      intern_shards[i].cursor.block_next = NULL;
+      intern_shards[i].cursor.block_remaining = 0;
+      intern_shards[i].capacity = FL_ARENA_INTERN_SIZE;
+      intern_shards[i].count = 0;
+      intern_shards[i].table = (const char **)Fineline_Util::xcalloc(FL_ARENA_INTERN_SIZE * sizeof(const char *));
+      intern_shards[i].hashes = (uint32_t *)Fineline_Util::xcalloc(FL_ARENA_INTERN_SIZE * sizeof(uint32_t));
+   }
+}
+
+Fineline_File_Arena::~Fineline_File_Arena()
+{
+   int i;
+
+   clear();
+   for (i = 0; i < FL_ARENA_INTERN_SHARDS; i++)
+   {
+      free(intern_shards[i].table);
+      free(intern_shards[i].hashes);
+   }
+}
+
+/*
+   Function: allocate
+   Purpose : Takes the next 8 byte aligned chunk from the cursor's block, the
+             arena lock is only taken to start a new block when the current
+             one is full. Caller must own the cursor.
+   Input   : Cursor and size in bytes.
+   Output  : Pointer to the uninitialised memory, exits on allocation failure.
+*/
+void *Fineline_File_Arena::allocate(fl_arena_cursor_t *cursor, size_t size)
+{
+   char *chunk;
+   size_t block_size = FL_ARENA_BLOCK_SIZE;
+
+   size = FL_ARENA_ALIGN(size);
+   if (size > cursor->block_remaining)
+   {
+      if (size > block_size)
+         block_size = size;
+      chunk = (char *)Fineline_Util::xmalloc(block_size);
+      {
+         lock_guard<mutex> guard(arena_lock);
+         block_list.push_back(chunk);
+         memory_used += block_size;
+      }
+      cursor->block_next = chunk;
+      cursor->block_remaining = block_size;
+   }
+
+   chunk = cursor->block_next;
+   cursor->block_next += size;
+   cursor->block_remaining -= size;
+
+   return(chunk);
+}
+
+/*
+   Function: new_record
+   Purpose : Allocates a zeroed file metadata record.
+   Input   : None.
+   Output  : Pointer to the record, the id is set to the record number in the arena.
+*/
+fl_file_record_t *Fineline_File_Arena::new_record()
+{
+   lock_guard<mutex> guard(shared_lock);
+
+   return(new_record(&shared_cursor));
+}
+
+/*
+   Function: new_record
+   Purpose : Allocates a zeroed file metadata record from a block owned by the
+             calling thread, e.g. a directory walker.
+   Input   : The thread's cursor, zeroed before its first use.
+   Output  : Pointer to the record, the id is set to the record number in the arena.
+*/
+fl_file_record_t *Fineline_File_Arena::new_record(fl_arena_cursor_t *cursor)
+{
+   fl_file_record_t *flrec = (fl_file_record_t *)allocate(cursor, sizeof(fl_file_record_t));
+
+   memset(flrec, 0, sizeof(fl_file_record_t));
+   flrec->id = (int)record_count++;
+
+   return(flrec);
+}
+
+/*
+   Function: new_digests
+   Purpose : Allocates a zeroed set of file content digests.
+   Input   : None.
+   Output  : Pointer to the digests.
+*/
+fl_file_digests_t *Fineline_File_Arena::new_digests()
+{
+   lock_guard<mutex> guard(shared_lock);
+   fl_file_digests_t *digests = (fl_file_digests_t *)allocate(&shared_cursor, sizeof(fl_file_digests_t));
+
+   memset(digests, 0, sizeof(fl_file_digests_t));
+
+   return(digests);
+}
+
+/*
+   Function: grow_intern_table
+   Purpose : Doubles an intern table shard and reinserts its strings. Caller
+             must hold the shard lock.
+   Input   : Intern table shard.
+   Output  : Returns 0.
+*/
+int Fineline_File_Arena::grow_intern_table(fl_intern_shard_t *shard)
+{
+   size_t new_capacity = shard->capacity * 2;
+   const char **new_table = (const char **)Fineline_Util::xcalloc(new_capacity * sizeof(const char *));
+   uint32_t *new_hashes = (uint32_t *)Fineline_Util::xcalloc(new_capacity * sizeof(uint32_t));
+   size_t i, slot;
+
+   for (i = 0; i < shard->capacity; i++)
+   {
+      if (shard->table[i] != NULL)
+      {
+         slot = shard->hashes[i] & (new_capacity - 1);
+         while (new_table[slot] != NULL)
+            slot = (slot + 1) & (new_capacity - 1);
+         new_table[slot] = shard->table[i];
+         new_hashes[slot] = shard->hashes[i];
+      }
+   }
+
+   free(shard->table);
+   free(shard->hashes);
+   shard->table = new_table;
+   shard->hashes = new_hashes;
+   shard->capacity = new_capacity;
+
+   return(0);
+}
+
+/*
+   Function: intern_string
+   Purpose : Returns the single arena copy of a string, the string is copied
+             into the arena the first time it is seen.
+   Input   : String and string length.
+   Output  : Pointer to the NUL terminated arena copy.
+*/
+const char *Fineline_File_Arena::intern_string(const char *str, size_t length)
+{
+   uint32_t hash = 2166136261u;
+   fl_intern_shard_t *shard;
+   size_t i, slot;
+   char *copy;
+
+   for (i = 0; i < length; i++)
+   {
+      hash ^= (unsigned char)str[i];
+      hash *= 16777619u;
+   }
+
+   // the high bits pick the shard, the low bits the slot in the shard
+   shard = &intern_shards[(hash >> 24) % FL_ARENA_INTERN_SHARDS];
+   lock_guard<mutex> guard(shard->shard_lock);
+
+   slot = hash & (shard->capacity - 1);
+   while (shard->table[slot] != NULL)
+   {
+      if ((shard->hashes[slot] == hash) && (strncmp(shard->table[slot], str, length) == 0) && (shard->table[slot][length] == 0))
+         return(shard->table[slot]);
+      slot = (slot + 1) & (shard->capacity - 1);
+   }
+
+   copy = (char *)allocate(&shard->cursor, length + 1);
+   memcpy(copy, str, length);
+   copy[length] = 0;
+
+   shard->table[slot] = copy;
+   shard->hashes[slot] = hash;
+   shard->count++;
+
+   if (shard->count * 2 > shard->capacity)
+      grow_intern_table(shard);
+
+   return(copy);
+}
+
+/*
+   Function: copy_string
+   Purpose : Copies a string into the arena without interning, used for
+             unique strings such as user comments.
+   Input   : String and string length.
+   Output  : Pointer to the NUL terminated arena copy.
+*/
+const char *Fineline_File_Arena::copy_string(const char *str, size_t length)
+{
+   lock_guard<mutex> guard(shared_lock);
+   char *copy = (char *)allocate(&shared_cursor, length + 1);
+
+   memcpy(copy, str, length);
+   copy[length] = 0;
+
+   return(copy);
+}
+
+int Fineline_File_Arena::set_file_name(fl_file_record_t *flrec, string file_name)
+{
+   flrec->file_name = intern_string(file_name.c_str(), file_name.size());
+   return(0);
+}
+
+int Fineline_File_Arena::set_comment(fl_file_record_t *flrec, string comment)
+{
+   flrec->comment = copy_string(comment.c_str(), comment.size());
+   return(0);
+}
+
+/*
+   Function: clear
+   Purpose : Frees every record and string in the arena, any record pointers
+             held elsewhere are invalid after this call. Cursors owned by
+             other threads must not be used again until they are zeroed.
+   Input   : None.
+   Output  : None.
+*/
+void Fineline_File_Arena::clear()
+{
+   // same lock order as allocate(), cursor locks before the block list lock
+   lock_guard<mutex> shared_guard(shared_lock);
+   unsigned int i;
+
+   shared_cursor.block_next = NULL;
+   shared_cursor.block_remaining = 0;
+   for (i = 0; i < FL_ARENA_INTERN_SHARDS; i++)
+   {
+      lock_guard<mutex> shard_guard(intern_shards[i].shard_lock);
+      intern_shards[i].cursor.block_next = NULL;
+      intern_shards[i].cursor.block_remaining = 0;
+      memset(intern_shards[i].table, 0, intern_shards[i].capacity * sizeof(const char *));
+      intern_shards[i].count = 0;
+   }
+
+   lock_guard<mutex> guard(arena_lock);
+
+   for (i = 0; i < block_list.size(); i++)
+      free(block_list[i]);
+
+   block_list.clear();
+   memory_used = 0;
+   record_count = 0;
+}
+
+size_t Fineline_File_Arena::get_record_count()
+{
+   return(record_count);
+}
+
+size_t Fineline_File_Arena::get_interned_count()
+{
+   size_t count = 0;
+   int i;
+
+   for (i = 0; i < FL_ARENA_INTERN_SHARDS; i++)
+      count += intern_shards[i].count;
+
+   return(count);
+}
+
+size_t Fineline_File_Arena::get_memory_used()
+{
+   size_t intern_capacity = 0;
+   int i;
+
+   for (i = 0; i < FL_ARENA_INTERN_SHARDS; i++)
+      intern_capacity += intern_shards[i].capacity;
+
+   return(memory_used + intern_capacity * (sizeof(const char *) + sizeof(uint32_t)));
+}
+
+/*
+   Function: get_file_path
+   Purpose : Rebuilds the directory path of a file from its parent directory
+             records, e.g. "Windows/System32/". The path does not include the
+             file system label.
+   Input   : File metadata record.
+   Output  : The directory path with a trailing separator, or empty for files in the root directory.
+*/
+string Fineline_File_Arena::get_file_path(fl_file_record_t *flrec)
+{
+   fl_file_record_t *chain[FL_ARENA_MAX_DEPTH];
+   fl_file_record_t *p = flrec->parent;
+   int depth = 0;
+   string path;
+
+   while ((p != NULL) && (depth < FL_ARENA_MAX_DEPTH))
+   {
+      chain[depth++] = p;
+      p = p->parent;
+   }
+
+   // The top directory record may have been orphaned by the walker, in
+   // which case it carries the rest of its path.
+
+   if ((depth > 0) && (chain[depth - 1]->file_path != NULL))
+      path = chain[depth - 1]->file_path;
+   else if ((depth == 0) && (flrec->file_path != NULL))
+      path = flrec->file_path;
+
+   while (depth > 0)
+   {
+      depth--;
+      path.append(chain[depth]->file_name);
+      path.append("/");
+   }
+
+   return(path);
+}
+
+/*
+   Function: get_full_path
+   Purpose : Rebuilds the full tree path of a file, the file system label,
+             directory path and file name, e.g. "FS1/Windows/notepad.exe".
+   Input   : File metadata record.
+   Output  : The full path.
+*/
+string Fineline_File_Arena::get_full_path(fl_file_record_t *flrec)
+{
+   string full_path = get_file_system_label(flrec->file_system_id);
+
+   full_path.append(get_file_path(flrec));
+   if (flrec->file_name != NULL)
+      full_path.append(flrec->file_name);
+
+   return(full_path);
+}
+
+/*
+   Function: get_file_system_label
+   Purpose : Gets the tree label for a file system, a multi-volume image
+             contains multiple file systems numbered from 1.
+   Input   : File system number.
+   Output  : The label with a trailing separator, e.g. "FS1/", empty if the number is 0.
+*/
+string Fineline_File_Arena::get_file_system_label(int file_system_id)
+{
+   char label[64];
+
+   if (file_system_id <= 0)
+      return(string());
+
+   sprintf(label, "FS%d/", file_system_id);
+
+   return(string(label));
+}
@@ -0,0 +1,121 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_File_Arena.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Block allocator for file metadata records and their strings.
+            Records are fixed size, file names are interned so repeated
+            names (desktop.ini, index.dat etc) are stored once, and file
+            paths are rebuilt on demand from the parent directory records.
+            All records and strings are freed together when the arena is
+            cleared or deleted.
+
+   Notes: Each directory walker thread allocates its records from its own
+          block through an arena cursor, the arena lock is only taken to
+          hand out a new block. The intern table is split into shards with
+          a lock each, so walkers interning different names rarely wait on
+          each other. Records are never moved.
+
+*/
+
+#ifndef FINELINE_FILE_ARENA_H
+#define FINELINE_FILE_ARENA_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fineline-search.h"
+
+#define FL_ARENA_BLOCK_SIZE     1048576   /* bytes per arena block */
+#define FL_ARENA_INTERN_SIZE    4096      /* initial size of each intern table shard, a power of 2 */
+#define FL_ARENA_INTERN_SHARDS  16        /* intern table shards, selected by the high bits of the name hash */
+
+using namespace std;
+
+/* Free space in an arena block owned by one thread, allocations from it do not lock. */
+struct fl_arena_cursor
+{
+   char *block_next;
+   size_t block_remaining;
+};
+typedef struct fl_arena_cursor fl_arena_cursor_t;
+
+/* One shard of the intern table, its strings are allocated from its own block. */
+struct fl_intern_shard
+{
+   mutex shard_lock;
+   fl_arena_cursor_t cursor;
+   const char **table;
+   uint32_t *hashes;
+   size_t capacity;
+   size_t count;
+};
+typedef struct fl_intern_shard fl_intern_shard_t;
+
+class Fineline_File_Arena
+{
+   public:
+      Fineline_File_Arena();
+      virtual ~Fineline_File_Arena();
+
+      fl_file_record_t *new_record();
+      fl_file_record_t *new_record(fl_arena_cursor_t *cursor);
+      fl_file_digests_t *new_digests();
+      const char *intern_string(const char *str, size_t length);
+      const char *copy_string(const char *str, size_t length);
+      int set_file_name(fl_file_record_t *flrec, string file_name);
+      int set_comment(fl_file_record_t *flrec, string comment);
+      void clear();
+
+      size_t get_record_count();
+      size_t get_interned_count();
+      size_t get_memory_used();
+
+      static string get_file_path(fl_file_record_t *flrec);
+      static string get_full_path(fl_file_record_t *flrec);
+      static string get_file_system_label(int file_system_id);
+
+   protected:
+   private:
+
+      void *allocate(fl_arena_cursor_t *cursor, size_t size);
+      int grow_intern_table(fl_intern_shard_t *shard);
+
+      vector< char* > block_list;
+      fl_arena_cursor_t shared_cursor;       /* used with the shared lock held */
+      size_t memory_used;
+      atomic<size_t> record_count;
+
+      fl_intern_shard_t intern_shards[FL_ARENA_INTERN_SHARDS];
+
+      mutex arena_lock;                      /* block list */
+      mutex shared_lock;                     /* shared cursor */
+};
+
+#endif // FINELINE_FILE_ARENA_H
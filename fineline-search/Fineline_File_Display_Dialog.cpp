@@ -33,6 +33,8 @@
 
 #include <FL/fl_ask.H>
 
+#include <stdio.h>
+
 #include "Fineline_File_Display_Dialog.h"
 
 Fineline_File_Display_Dialog::Fineline_File_Display_Dialog(int x, int y, int w, int h) : Fl_Double_Window(x, y, w, h, "Fineline File Display Dialog")
@@ -43,6 +45,7 @@ Fineline_File_Display_Dialog::Fineline_File_Display_Dialog(int x, int y, int w,
    Fl_Group* browser_group = new Fl_Group(10, 10, w - 10, h - 10);
    {
       progress_browser = new Fl_Browser(20, 20, w - 40, h - 100);
+      progress_browser->textfont(FL_COURIER);
       Fl_Button* save_button = new Fl_Button(w - 360, h - 50, 100, 30, "Save");
       save_button->callback((Fl_Callback*)button_callback, (void *)this);
       Fl_Button* clear_button = new Fl_Button(w - 250, h - 50, 100, 30, "Clear");
@@ -62,6 +65,57 @@ Fineline_File_Display_Dialog::~Fineline_File_Display_Dialog()
 }
 
 
+/*
+   Name   : display_file()
+   Purpose: Shows the start of a file as a hex dump. The file is opened by
+            its metadata address with the file system handles of the image.
+   Input  : File metadata record and the file system object.
+   Output : Returns the number of bytes shown, -1 on error.
+*/
+int Fineline_File_Display_Dialog::display_file(fl_file_record_t *flrec, Fineline_File_System *ffs)
+{
+   TskFsFile *file_info;
+   char *buffer;
+   char line[128];
+   ssize_t cnt;
+   int i, j, n;
+
+   progress_browser->clear();
+   if ((flrec == NULL) || (ffs == NULL) || (flrec->file_type != TSK_FS_META_TYPE_REG))
+      return(-1);
+
+   file_info = ffs->open_file(flrec);
+   if (file_info == NULL)
+   {
+      progress_browser->add("Could not open the file in the forensic image.");
+      return(-1);
+   }
+
+   buffer = (char *)malloc(FL_DISPLAY_MAX_BYTES);
+   cnt = Fineline_File_System::read_file(file_info, flrec, 0, buffer, FL_DISPLAY_MAX_BYTES);
+   for (i = 0; i < (int)cnt; i += 16)
+   {
+      n = snprintf(line, sizeof(line), "%08x  ", i);
+      for (j = 0; j < 16; j++)
+      {
+         if (i + j < (int)cnt)
+            n += snprintf(line + n, sizeof(line) - n, "%02x ", (unsigned char)buffer[i + j]);
+         else
+            n += snprintf(line + n, sizeof(line) - n, "   ");
+      }
+      line[n++] = ' ';
+      for (j = 0; (j < 16) && (i + j < (int)cnt); j++)
+         line[n++] = ((buffer[i + j] >= 32) && (buffer[i + j] < 127)) ? buffer[i + j] : '.';
+      line[n] = 0;
+      progress_browser->add(line);
+   }
+
+   free(buffer);
+   delete file_info;
+
+   return((int)cnt);
+}
+
 void Fineline_File_Display_Dialog::button_callback(Fl_Button *b, void *p)
 {
    fl_message("modal window");
@@ -45,6 +45,9 @@
 #include <FL/Fl_Native_File_Chooser.H>
 
 #include "fineline-search.h"
+#include "Fineline_File_System.h"
+
+#define FL_DISPLAY_MAX_BYTES 65536   /* bytes of a file shown in the hex view */
 
 
 class Fineline_File_Display_Dialog : public Fl_Double_Window
@@ -54,6 +57,7 @@ class Fineline_File_Display_Dialog : public Fl_Double_Window
       virtual ~Fineline_File_Display_Dialog();
 
       static void button_callback(Fl_Button *b, void *p);
+      int display_file(fl_file_record_t *flrec, Fineline_File_System *ffs);
 
    protected:
    private:
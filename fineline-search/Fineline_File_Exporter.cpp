@@ -0,0 +1,616 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_File_Exporter.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Parallel batch export of files with sparse output and hashing.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <thread>
+
+#ifdef LINUX_BUILD
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define fle_fseek(f, o, w) fseeko(f, (off_t)(o), w)
+#define fle_ftell(f) ((int64_t)ftello(f))
+#else
+#include <direct.h> // Windows _mkdir()
+#define fle_fseek(f, o, w) _fseeki64(f, (__int64)(o), w)
+#define fle_ftell(f) ((int64_t)_ftelli64(f))
+#endif
+
+#include "Fineline_File_Exporter.h"
+#include "Fineline_File_System.h"
+#include "Fineline_File_Arena.h"
+#include "Fineline_Log.h"
+#include "../common/Fineline_Util.h"
+
+/* Orders export results by file system and metadata address. */
+struct fl_export_address_order
+{
+   bool operator()(const fl_export_result_t &a, const fl_export_result_t &b) const
+   {
+      if (a.record->file_system_id != b.record->file_system_id)
+         return(a.record->file_system_id < b.record->file_system_id);
+      return(a.record->meta_address < b.record->meta_address);
+   }
+};
+
+static int is_zero_block(const char *block, size_t length)
+{
+   return((block[0] == 0) && (memcmp(block, block + 1, length - 1) == 0));
+}
+
+Fineline_File_Exporter::Fineline_File_Exporter(string image, vector<TSK_OFF_T> fs_offsets, string evidence_directory)
+{
+   image_path = image;
+   file_system_offsets = fs_offsets;
+   evidence_path = evidence_directory;
+   next_file = 0;
+   bytes_copied = 0;
+   running = 0;
+}
+
+Fineline_File_Exporter::~Fineline_File_Exporter()
+{
+   //dtor
+}
+
+int Fineline_File_Exporter::add_file(fl_file_record_t *flrec)
+{
+   fl_export_result_t result;
+
+   if ((flrec == NULL) || (flrec->file_type != TSK_FS_META_TYPE_REG))
+      return(-1);
+
+   memset(&result, 0, sizeof(result));
+   result.record = flrec;
+   result.status = FL_EXPORT_NOT_EXPORTED;
+   result_list.push_back(result);
+
+   return(0);
+}
+
+/*
+   Function: add_files
+   Purpose : Adds the regular files in a list of file records, such as the
+             marked files in the file system tree.
+   Input   : File record list.
+   Output  : Returns the number of files to export.
+*/
+int Fineline_File_Exporter::add_files(const vector<fl_file_record_t *> &flist)
+{
+   size_t n;
+
+   for (n = 0; n < flist.size(); n++)
+      add_file(flist[n]);
+
+   return(result_list.size());
+}
+
+/*
+   Function: escape_path_name
+   Purpose : Makes a file or directory name from the image safe to create
+             under the evidence directory. Separators, ':', '%' and control
+             characters are written as %XX, "." and ".." are escaped so a
+             name can never leave its parent directory.
+   Input   : Name from the image.
+   Output  : Escaped name.
+*/
+string Fineline_File_Exporter::escape_path_name(const string &name)
+{
+   string escaped;
+   char hex[8];
+   size_t i;
+   unsigned char c;
+
+   if (name.empty())
+      return(string("_"));
+   if ((name == ".") || (name == ".."))
+      return((name.size() == 1) ? string("%2E") : string("%2E%2E"));
+
+   for (i = 0; i < name.size(); i++)
+   {
+      c = (unsigned char)name[i];
+      if ((c < 0x20) || (c == '/') || (c == '\\') || (c == ':') || (c == '%'))
+      {
+         sprintf(hex, "%%%02X", c);
+         escaped.append(hex);
+      }
+      else
+      {
+         escaped.push_back((char)c);
+      }
+   }
+
+   return(escaped);
+}
+
+/*
+   Function: get_destination_path
+   Purpose : Gets the path of the exported file under the evidence directory,
+             the file system label and the file path in the image with every
+             name escaped, e.g. "evidence/FS1/Windows/notepad.exe".
+   Input   : File record.
+   Output  : Destination file path.
+*/
+string Fineline_File_Exporter::get_destination_path(fl_file_record_t *flrec)
+{
+   // NOTE: do not use PATH_SEPARATOR, libs will automatically convert to
+   // to platform specific path separator on Linux or Windows.
+   string destination_file = evidence_path;
+   string file_path = Fineline_File_Arena::get_file_path(flrec);
+   size_t start = 0, end;
+
+   destination_file.append("/");
+   destination_file.append(Fineline_File_Arena::get_file_system_label(flrec->file_system_id));
+
+   // get_file_path() ends each directory name with a '/'
+   while ((end = file_path.find('/', start)) != string::npos)
+   {
+      if (end > start)
+      {
+         destination_file.append(escape_path_name(file_path.substr(start, end - start)));
+         destination_file.append("/");
+      }
+      start = end + 1;
+   }
+   destination_file.append(escape_path_name((flrec->file_name != NULL) ? flrec->file_name : ""));
+
+   return(destination_file);
+}
+
+/*
+   Function: make_directories
+   Purpose : Creates the directories in a file path. Directories created by
+             earlier exports are remembered so each one is only made once.
+             An existing entry under the evidence directory that is not a
+             directory, e.g. a symbolic link, is an error.
+   Input   : File path.
+   Output  : Returns 0 on success, -1 if a directory could not be created.
+*/
+int Fineline_File_Exporter::make_directories(const string &file_path)
+{
+   lock_guard<mutex> guard(directory_lock);
+   size_t pos = 0;
+   string dir;
+   int ret_val;
+
+   while ((pos = file_path.find_first_of('/', pos)) != string::npos)
+   {
+      dir = file_path.substr(0, pos++);
+      if ((dir.size() == 0) || (directory_list.count(dir) > 0))
+         continue;
+
+#ifdef LINUX_BUILD
+      ret_val = mkdir(dir.c_str(), 0775);  // Linux/Unix permissions: (S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH)
+#else
+      ret_val = _mkdir(dir.c_str());
+#endif
+      if ((ret_val != 0) && (errno != EEXIST))
+         return(-1);
+#ifdef LINUX_BUILD
+      struct stat st;
+
+      // the evidence directory itself may be a link the examiner made
+      if ((ret_val != 0) && (dir.size() > evidence_path.size()) &&
+          ((lstat(dir.c_str(), &st) != 0) || !S_ISDIR(st.st_mode)))
+         return(-1);
+#endif
+      directory_list.insert(dir);
+   }
+
+   return(0);
+}
+
+/*
+   Function: create_export_file
+   Purpose : Creates the exported file, an existing symbolic link at the path
+             is not followed.
+   Input   : File path.
+   Output  : Returns the open file, NULL on error.
+*/
+FILE *Fineline_File_Exporter::create_export_file(const string &file_path)
+{
+#ifdef LINUX_BUILD
+   FILE *out_file;
+   int fd;
+
+   fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, 0664);
+   if (fd < 0)
+      return(NULL);
+   out_file = fdopen(fd, "wb");
+   if (out_file == NULL)
+      close(fd);
+
+   return(out_file);
+#else
+   return(fopen(file_path.c_str(), "wb"));
+#endif
+}
+
+/*
+   Function: write_sparse
+   Purpose : Writes a block of file data, runs of FL_EXPORT_SPARSE_BLOCK zero
+             bytes are skipped with a seek so the file system can leave them
+             as holes. Runs of data and runs of zeros are written or skipped
+             in one call each.
+   Input   : Output file, data block and block length.
+   Output  : Returns the number of bytes skipped, -1 on a write error.
+*/
+int64_t Fineline_File_Exporter::write_sparse(FILE *out_file, const char *buffer, size_t length)
+{
+   size_t pos = 0, run_start, block_length;
+   int64_t skipped = 0;
+   int zero_run;
+
+   while (pos < length)
+   {
+      run_start = pos;
+      block_length = min((size_t)FL_EXPORT_SPARSE_BLOCK, length - pos);
+      zero_run = (block_length == FL_EXPORT_SPARSE_BLOCK) && is_zero_block(buffer + pos, block_length);
+      pos += block_length;
+
+      while (pos < length)
+      {
+         block_length = min((size_t)FL_EXPORT_SPARSE_BLOCK, length - pos);
+         if (zero_run != ((block_length == FL_EXPORT_SPARSE_BLOCK) && is_zero_block(buffer + pos, block_length)))
+            break;
+         pos += block_length;
+      }
+
+      if (zero_run)
+      {
+         if (fle_fseek(out_file, (int64_t)(pos - run_start), SEEK_CUR) != 0)
+            return(-1);
+         skipped += (int64_t)(pos - run_start);
+      }
+      else if (fwrite(buffer + run_start, 1, pos - run_start, out_file) != pos - run_start)
+      {
+         return(-1);
+      }
+   }
+
+   return(skipped);
+}
+
+/*
+   Function: finish_sparse
+   Purpose : Sets the size of a sparse file, a hole at the end of the file is
+             only made part of the file by writing its last byte.
+   Input   : Output file and the file size.
+   Output  : Returns 0 on success, -1 on a write error.
+*/
+int Fineline_File_Exporter::finish_sparse(FILE *out_file, int64_t file_size)
+{
+   if (fle_fseek(out_file, 0, SEEK_END) != 0)
+      return(-1);
+   if ((file_size > 0) && (fle_ftell(out_file) < file_size))
+   {
+      if ((fle_fseek(out_file, file_size - 1, SEEK_SET) != 0) || (fputc(0, out_file) == EOF))
+         return(-1);
+   }
+
+   return(ferror(out_file) ? -1 : 0);
+}
+
+/*
+   Function: copy_file
+   Purpose : Opens a file by metadata address with the worker's own TSK
+             handles, copies it to the evidence directory and hashes the data
+             as it is copied. The file system is opened on first use.
+   Input   : Worker image handle, worker file system handles, the export
+             result of the file and the worker copy buffer.
+   Output  : Sets the result status, returns 0 on success, -1 on error.
+*/
+int Fineline_File_Exporter::copy_file(TskImgInfo *img_info, vector<TskFsInfo *> &fs_list, fl_export_result_t *result, char *buffer)
+{
+   fl_file_record_t *flrec = result->record;
+   TskFsFile *file_info;
+   TSK_OFF_T file_size, offset;
+   Fineline_Hash hash;
+   FILE *out_file;
+   string destination_file;
+   ssize_t cnt = 0;
+   size_t len;
+   int64_t skipped;
+   int fs_id = flrec->file_system_id - 1;
+
+   result->status = FL_EXPORT_OPEN_ERROR;
+   if ((fs_id < 0) || (fs_id >= (int)fs_list.size()))
+      return(-1);
+
+   if (fs_list[fs_id] == NULL)
+   {
+      TskFsInfo *fs_info = new TskFsInfo();
+      if (fs_info->open(img_info, file_system_offsets[fs_id], TSK_FS_TYPE_DETECT))
+      {
+         delete fs_info;
+         return(-1);
+      }
+      fs_list[fs_id] = fs_info;
+   }
+
+   file_info = Fineline_File_System::open_file(fs_list[fs_id], flrec);
+   if (file_info == NULL)
+      return(-1);
+
+   destination_file = get_destination_path(flrec);
+   out_file = (make_directories(destination_file) == 0) ? create_export_file(destination_file) : NULL;
+   if (out_file == NULL)
+   {
+      Fineline_Log::print_log_entry("copy_file() <ERROR> Could not create export file.\n");
+      result->status = FL_EXPORT_WRITE_ERROR;
+      delete file_info;
+      return(-1);
+   }
+
+   result->status = FL_EXPORT_OK;
+   file_size = file_info->getMeta()->getSize();
+   for (offset = 0; offset < file_size; offset += cnt)
+   {
+      if (!running)
+      {
+         result->status = FL_EXPORT_NOT_EXPORTED;
+         break;
+      }
+      len = (file_size - offset < FL_EXPORT_BLOCK_SIZE) ? (size_t)(file_size - offset) : FL_EXPORT_BLOCK_SIZE;
+      cnt = Fineline_File_System::read_file(file_info, flrec, offset, buffer, len);
+      if (cnt <= 0)
+      {
+         // could check tsk_errno here for a recovery error (TSK_ERR_FS_RECOVER)
+         result->status = FL_EXPORT_READ_ERROR;
+         break;
+      }
+      hash.update(buffer, (size_t)cnt);
+      skipped = write_sparse(out_file, buffer, (size_t)cnt);
+      if (skipped < 0)
+      {
+         result->status = FL_EXPORT_WRITE_ERROR;
+         break;
+      }
+      result->sparse_bytes += skipped;
+      result->bytes_copied += (int64_t)cnt;
+      bytes_copied += (uint64_t)cnt;
+   }
+
+   if ((result->status == FL_EXPORT_OK) && (finish_sparse(out_file, (int64_t)file_size) < 0))
+      result->status = FL_EXPORT_WRITE_ERROR;
+   if ((fclose(out_file) != 0) && (result->status == FL_EXPORT_OK))
+      result->status = FL_EXPORT_WRITE_ERROR;
+
+   delete file_info;
+
+   if (result->status != FL_EXPORT_OK)
+      return(-1);
+
+   // Verify the copy against the digests from an earlier hashing run.
+   hash.final(result->md5, result->sha1, result->sha256);
+   if ((flrec->digests != NULL) && (memcmp(flrec->digests->sha256, result->sha256, FL_SHA256_LENGTH) != 0))
+   {
+      result->status = FL_EXPORT_HASH_MISMATCH;
+      return(-1);
+   }
+
+   return(0);
+}
+
+/*
+   Function: export_task
+   Purpose : Worker thread, takes batches of files from the shared result list
+             until it is empty or the export is stopped.
+   Input   : File exporter object.
+   Output  : None.
+*/
+void Fineline_File_Exporter::export_task(Fineline_File_Exporter *ffe)
+{
+   TskImgInfo *img_info = Fineline_File_System::open_image(ffe->image_path);
+   vector<TskFsInfo *> fs_list(ffe->file_system_offsets.size(), (TskFsInfo *)NULL);
+   char *buffer;
+   size_t start, end, n;
+   unsigned int i;
+
+   if (img_info == NULL)
+   {
+      Fineline_Log::print_log_entry("export_task() <ERROR> Could not open image file.\n");
+      return;
+   }
+
+   buffer = (char *)Fineline_Util::xmalloc(FL_EXPORT_BLOCK_SIZE);
+
+   while (ffe->running)
+   {
+      start = ffe->next_file.fetch_add(FL_EXPORT_FILE_BATCH);
+      if (start >= ffe->result_list.size())
+         break;
+      end = min(start + FL_EXPORT_FILE_BATCH, ffe->result_list.size());
+      for (n = start; n < end; n++)
+         ffe->copy_file(img_info, fs_list, &ffe->result_list[n], buffer);
+   }
+
+   for (i = 0; i < fs_list.size(); i++)
+   {
+      if (fs_list[i] != NULL)
+         delete fs_list[i];
+   }
+   Fineline_File_System::close_image(img_info);
+   free(buffer);
+}
+
+/*
+   Function: export_files
+   Purpose : Exports every file added to the exporter in metadata address
+             order and writes the digest manifest.
+   Input   : Number of worker threads, 0 = one per CPU core.
+   Output  : Returns the number of files exported and verified.
+*/
+long Fineline_File_Exporter::export_files(int thread_count)
+{
+   vector<thread> workers;
+   long exported = 0;
+   size_t n;
+   int i;
+
+   next_file = 0;
+   bytes_copied = 0;
+
+   if (result_list.size() == 0)
+      return(0);
+
+   running = 1;
+
+   sort(result_list.begin(), result_list.end(), fl_export_address_order());
+
+   if (thread_count <= 0)
+      thread_count = (int)thread::hardware_concurrency();
+   if ((size_t)thread_count > (result_list.size() + FL_EXPORT_FILE_BATCH - 1) / FL_EXPORT_FILE_BATCH)
+      thread_count = (int)((result_list.size() + FL_EXPORT_FILE_BATCH - 1) / FL_EXPORT_FILE_BATCH);
+   if (thread_count < 1)
+      thread_count = 1;
+
+   for (i = 1; i < thread_count; i++)
+   {
+      workers.push_back(thread(export_task, this));
+   }
+   export_task(this);
+   for (i = 0; i < (int)workers.size(); i++)
+   {
+      workers[i].join();
+   }
+
+   for (n = 0; n < result_list.size(); n++)
+   {
+      if (result_list[n].status == FL_EXPORT_OK)
+         exported++;
+   }
+   write_manifest();
+
+   running = 0;
+
+   return(exported);
+}
+
+/*
+   Function: write_manifest
+   Purpose : Writes the digests, size and destination path of every exported
+             file to FL_EXPORT_MANIFEST in the evidence directory.
+   Input   : None.
+   Output  : Returns 0 on success, -1 on error.
+*/
+int Fineline_File_Exporter::write_manifest()
+{
+   string manifest_file = evidence_path;
+   FILE *fp;
+   size_t n;
+
+   manifest_file.append("/");
+   manifest_file.append(FL_EXPORT_MANIFEST);
+   make_directories(manifest_file);
+
+   fp = fopen(manifest_file.c_str(), "w");
+   if (fp == NULL)
+   {
+      Fineline_Log::print_log_entry("write_manifest() <ERROR> Could not create the export manifest.\n");
+      return(-1);
+   }
+
+   fprintf(fp, "# MD5 SHA-1 SHA-256 size path\n");
+   for (n = 0; n < result_list.size(); n++)
+   {
+      const fl_export_result_t &result = result_list[n];
+      if ((result.status != FL_EXPORT_OK) && (result.status != FL_EXPORT_HASH_MISMATCH))
+         continue;
+      fprintf(fp, "%s %s %s %lld %s\n", Fineline_Hash::to_hex(result.md5, FL_MD5_LENGTH).c_str(),
+              Fineline_Hash::to_hex(result.sha1, FL_SHA1_LENGTH).c_str(), Fineline_Hash::to_hex(result.sha256, FL_SHA256_LENGTH).c_str(),
+              (long long)result.bytes_copied, get_destination_path(result.record).c_str());
+   }
+
+   if (fclose(fp) != 0)
+      return(-1);
+
+   return(0);
+}
+
+void Fineline_File_Exporter::stop_export()
+{
+   running = 0;
+}
+
+int Fineline_File_Exporter::get_running()
+{
+   return(running);
+}
+
+const vector<fl_export_result_t> &Fineline_File_Exporter::get_results()
+{
+   return(result_list);
+}
+
+/*
+   Function: get_status_string
+   Purpose : Describes the export result of a file for the export dialog.
+   Input   : Export result.
+   Output  : Status string.
+*/
+string Fineline_File_Exporter::get_status_string(const fl_export_result_t &result)
+{
+   string status;
+
+   switch (result.status)
+   {
+      case FL_EXPORT_OK:            status = "Exported file: "; break;
+      case FL_EXPORT_NOT_EXPORTED:  status = "Not exported: "; break;
+      case FL_EXPORT_OPEN_ERROR:    status = "Error opening file: "; break;
+      case FL_EXPORT_READ_ERROR:    status = "Error reading file: "; break;
+      case FL_EXPORT_WRITE_ERROR:   status = "Error writing file: "; break;
+      case FL_EXPORT_HASH_MISMATCH: status = "Hash mismatch: "; break;
+   }
+   status.append(Fineline_File_Arena::get_full_path(result.record));
+   if ((result.status == FL_EXPORT_OK) || (result.status == FL_EXPORT_HASH_MISMATCH))
+   {
+      status.append(" SHA-256: ");
+      status.append(Fineline_Hash::to_hex(result.sha256, FL_SHA256_LENGTH));
+   }
+
+   return(status);
+}
+
+size_t Fineline_File_Exporter::get_file_count()
+{
+   return(result_list.size());
+}
+
+uint64_t Fineline_File_Exporter::get_bytes_copied()
+{
+   return(bytes_copied);
+}
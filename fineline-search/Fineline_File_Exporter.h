@@ -0,0 +1,126 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_File_Exporter.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Batch export of files from a forensic image to an evidence
+            directory. The files are shared out to a pool of worker threads,
+            each worker opens its own TSK image and file system handles, opens
+            the files by metadata address and copies them in large blocks.
+            Runs of zero bytes are skipped with a seek so they become holes
+            in the exported file, and the MD5, SHA-1 and SHA-256 of the data
+            are computed during the copy. The digests are checked against the
+            digests from an earlier hashing run and written to a manifest in
+            the evidence directory.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#ifndef FINELINE_FILE_EXPORTER_H
+#define FINELINE_FILE_EXPORTER_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <set>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <tsk/libtsk.h>
+
+#include "fineline-search.h"
+#include "../common/Fineline_Hash.h"
+
+#define FL_EXPORT_BLOCK_SIZE    4194304   /* bytes copied at a time */
+#define FL_EXPORT_SPARSE_BLOCK  4096      /* zero runs of this size are written as holes */
+#define FL_EXPORT_FILE_BATCH    4         /* files taken by a worker at a time */
+#define FL_EXPORT_MANIFEST      "fineline-export-hashes.txt"
+
+#define FL_EXPORT_OK            0
+#define FL_EXPORT_NOT_EXPORTED  1         /* export stopped before the file was copied */
+#define FL_EXPORT_OPEN_ERROR    2
+#define FL_EXPORT_READ_ERROR    3
+#define FL_EXPORT_WRITE_ERROR   4
+#define FL_EXPORT_HASH_MISMATCH 5         /* copied data does not match the earlier digests */
+
+using namespace std;
+
+struct fl_export_result
+{
+   fl_file_record_t *record;
+   int status;                            /* FL_EXPORT_OK or an error */
+   int64_t bytes_copied;
+   int64_t sparse_bytes;                  /* bytes left as holes */
+   unsigned char md5[FL_MD5_LENGTH];
+   unsigned char sha1[FL_SHA1_LENGTH];
+   unsigned char sha256[FL_SHA256_LENGTH];
+};
+typedef struct fl_export_result fl_export_result_t;
+
+class Fineline_File_Exporter
+{
+   public:
+      Fineline_File_Exporter(string image_path, vector<TSK_OFF_T> fs_offsets, string evidence_directory);
+      virtual ~Fineline_File_Exporter();
+
+      int add_file(fl_file_record_t *flrec);
+      int add_files(const vector<fl_file_record_t *> &flist);
+      long export_files(int thread_count);
+      int write_manifest();
+      void stop_export();
+      int get_running();
+
+      const vector<fl_export_result_t> &get_results();
+      string get_destination_path(fl_file_record_t *flrec);
+      string get_status_string(const fl_export_result_t &result);
+      size_t get_file_count();
+      uint64_t get_bytes_copied();
+
+      static int64_t write_sparse(FILE *out_file, const char *buffer, size_t length);
+      static int finish_sparse(FILE *out_file, int64_t file_size);
+      static string escape_path_name(const string &name);
+
+   protected:
+   private:
+
+      static void export_task(Fineline_File_Exporter *ffe);
+      int copy_file(TskImgInfo *img_info, vector<TskFsInfo *> &fs_list, fl_export_result_t *result, char *buffer);
+      int make_directories(const string &file_path);
+      FILE *create_export_file(const string &file_path);
+
+      string image_path;
+      vector<TSK_OFF_T> file_system_offsets;  /* file system id - 1 -> offset in the image */
+      string evidence_path;
+
+      vector<fl_export_result_t> result_list;
+      set<string> directory_list;             /* directories already created */
+      mutex directory_lock;
+      atomic<size_t> next_file;
+      atomic<uint64_t> bytes_copied;
+      atomic<int> running;
+};
+
+#endif // FINELINE_FILE_EXPORTER_H
@@ -0,0 +1,505 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_File_Hasher.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Pipelined file hashing with known file filtering.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+#include "Fineline_File_Hasher.h"
+#include "Fineline_File_System.h"
+#include "Fineline_Log.h"
+#include "../common/Fineline_Util.h"
+
+/* Orders files by file system and metadata address. */
+struct fl_hash_address_order
+{
+   bool operator()(const fl_file_record_t *a, const fl_file_record_t *b) const
+   {
+      if (a->file_system_id != b->file_system_id)
+         return(a->file_system_id < b->file_system_id);
+      return(a->meta_address < b->meta_address);
+   }
+};
+
+/* True for files already hashed by an earlier run. */
+struct fl_hash_is_hashed
+{
+   bool operator()(const fl_file_record_t *flrec) const
+   {
+      return(flrec->digests != NULL);
+   }
+};
+
+static char *wait_free_buffer(fl_hash_pipe_t *pipe)
+{
+   unique_lock<mutex> guard(pipe->pipe_lock);
+   char *buffer;
+
+   while (pipe->free_buffers.empty())
+      pipe->buffer_free.wait(guard);
+   buffer = pipe->free_buffers.back();
+   pipe->free_buffers.pop_back();
+
+   return(buffer);
+}
+
+static void release_buffer(fl_hash_pipe_t *pipe, char *buffer)
+{
+   {
+      lock_guard<mutex> guard(pipe->pipe_lock);
+      pipe->free_buffers.push_back(buffer);
+   }
+   pipe->buffer_free.notify_one();
+}
+
+static void push_block(fl_hash_pipe_t *pipe, fl_file_record_t *flrec, char *data, size_t length, int flags)
+{
+   fl_hash_block_t block;
+
+   block.record = flrec;
+   block.data = data;
+   block.length = length;
+   block.flags = flags;
+   {
+      lock_guard<mutex> guard(pipe->pipe_lock);
+      pipe->full_blocks.push_back(block);
+   }
+   pipe->block_ready.notify_one();
+}
+
+static fl_hash_block_t pop_block(fl_hash_pipe_t *pipe)
+{
+   unique_lock<mutex> guard(pipe->pipe_lock);
+   fl_hash_block_t block;
+
+   while (pipe->full_blocks.empty())
+      pipe->block_ready.wait(guard);
+   block = pipe->full_blocks.front();
+   pipe->full_blocks.pop_front();
+
+   return(block);
+}
+
+/*
+   Function: find_digest
+   Purpose : Looks up the file digest of the type held in a hash set.
+   Input   : Hash set and the file digests.
+   Output  : Returns 1 if the digest is in the set, 0 if not.
+*/
+static int find_digest(const Fineline_Hash_Set *hash_set, const fl_file_digests_t *digests)
+{
+   switch (hash_set->get_digest_length())
+   {
+      case FL_MD5_LENGTH:    return(hash_set->contains(digests->md5, FL_MD5_LENGTH));
+      case FL_SHA1_LENGTH:   return(hash_set->contains(digests->sha1, FL_SHA1_LENGTH));
+      case FL_SHA256_LENGTH: return(hash_set->contains(digests->sha256, FL_SHA256_LENGTH));
+   }
+   return(0);
+}
+
+Fineline_File_Hasher::Fineline_File_Hasher(string image, vector<TSK_OFF_T> fs_offsets, Fineline_File_Arena *arena)
+{
+   image_path = image;
+   file_system_offsets = fs_offsets;
+   file_arena = arena;
+   known_good = NULL;
+   known_bad = NULL;
+   next_file = 0;
+   hashed_count = 0;
+   known_good_count = 0;
+   known_bad_count = 0;
+   bytes_hashed = 0;
+   running = 0;
+}
+
+Fineline_File_Hasher::~Fineline_File_Hasher()
+{
+   //dtor
+}
+
+int Fineline_File_Hasher::add_file(fl_file_record_t *flrec)
+{
+   if ((flrec == NULL) || (flrec->file_type != TSK_FS_META_TYPE_REG) || (flrec->file_size < 0))
+      return(-1);
+
+   file_list.push_back(flrec);
+
+   return(0);
+}
+
+/*
+   Function: add_files
+   Purpose : Adds every regular file in a file index snapshot.
+   Input   : File index snapshot.
+   Output  : Returns the number of files to hash.
+*/
+int Fineline_File_Hasher::add_files(Fineline_File_Map fmap)
+{
+   size_t n;
+
+   if (!fmap)
+      return(file_list.size());
+
+   for (n = 0; n < fmap->size(); n++)
+      add_file(fmap->get_record(n));
+
+   return(file_list.size());
+}
+
+void Fineline_File_Hasher::set_known_good(const Fineline_Hash_Set *hash_set)
+{
+   known_good = hash_set;
+}
+
+void Fineline_File_Hasher::set_known_bad(const Fineline_Hash_Set *hash_set)
+{
+   known_bad = hash_set;
+}
+
+/*
+   Function: store_digests
+   Purpose : Copies the digests of a file into the arena, attaches them to the
+             file record and checks the hash sets.
+   Input   : File record and the MD5, SHA-1 and SHA-256 digests.
+   Output  : Returns the FL_HASH_SET value of the file.
+*/
+int Fineline_File_Hasher::store_digests(fl_file_record_t *flrec, const unsigned char *md5, const unsigned char *sha1, const unsigned char *sha256)
+{
+   fl_file_digests_t *digests = file_arena->new_digests();
+
+   memcpy(digests->md5, md5, FL_MD5_LENGTH);
+   memcpy(digests->sha1, sha1, FL_SHA1_LENGTH);
+   memcpy(digests->sha256, sha256, FL_SHA256_LENGTH);
+   flrec->digests = digests;
+   hashed_count++;
+
+   return(check_hash_sets(flrec));
+}
+
+/*
+   Function: check_hash_sets
+   Purpose : Looks the file digests up in the known bad then the known good
+             hash set. Known good files are hidden, a file found in neither
+             set is shown again.
+   Input   : Hashed file record.
+   Output  : Returns the FL_HASH_SET value of the file.
+*/
+int Fineline_File_Hasher::check_hash_sets(fl_file_record_t *flrec)
+{
+   if (flrec->hash_set == FL_HASH_SET_KNOWN_GOOD)
+      flrec->hidden = 0;
+   flrec->hash_set = FL_HASH_SET_NONE;
+
+   if (flrec->digests == NULL)
+      return(FL_HASH_SET_NONE);
+
+   if ((known_bad != NULL) && find_digest(known_bad, flrec->digests))
+   {
+      flrec->hash_set = FL_HASH_SET_KNOWN_BAD;
+      known_bad_count++;
+   }
+   else if ((known_good != NULL) && find_digest(known_good, flrec->digests))
+   {
+      flrec->hash_set = FL_HASH_SET_KNOWN_GOOD;
+      flrec->hidden = 1;
+      known_good_count++;
+   }
+
+   return(flrec->hash_set);
+}
+
+/*
+   Function: read_file
+   Purpose : Reads a file in blocks with the reader's own TSK handles and
+             passes the blocks to the hasher. The file system is opened on
+             first use.
+   Input   : Reader image handle, reader file system handles, file record
+             and the reader/hasher pipe.
+   Output  : Returns 0 on success, -1 if the file could not be read.
+*/
+int Fineline_File_Hasher::read_file(TskImgInfo *img_info, vector<TskFsInfo *> &fs_list, fl_file_record_t *flrec, fl_hash_pipe_t *pipe)
+{
+   TskFsFile *file_info;
+   TSK_OFF_T file_size, offset;
+   ssize_t cnt;
+   size_t len;
+   char *buffer;
+   int flags = FL_HASH_BLOCK_FIRST;
+   int fs_id = flrec->file_system_id - 1;
+
+   if (flrec->file_size == 0)
+   {
+      push_block(pipe, flrec, NULL, 0, FL_HASH_BLOCK_FIRST | FL_HASH_BLOCK_LAST);
+      return(0);
+   }
+
+   if ((fs_id < 0) || (fs_id >= (int)fs_list.size()))
+   {
+      push_block(pipe, flrec, NULL, 0, FL_HASH_BLOCK_FIRST | FL_HASH_BLOCK_LAST | FL_HASH_BLOCK_ERROR);
+      return(-1);
+   }
+
+   if (fs_list[fs_id] == NULL)
+   {
+      TskFsInfo *fs_info = new TskFsInfo();
+      if (fs_info->open(img_info, file_system_offsets[fs_id], TSK_FS_TYPE_DETECT))
+      {
+         delete fs_info;
+         push_block(pipe, flrec, NULL, 0, FL_HASH_BLOCK_FIRST | FL_HASH_BLOCK_LAST | FL_HASH_BLOCK_ERROR);
+         return(-1);
+      }
+      fs_list[fs_id] = fs_info;
+   }
+
+   file_info = Fineline_File_System::open_file(fs_list[fs_id], flrec);
+   if (file_info == NULL)
+   {
+      push_block(pipe, flrec, NULL, 0, FL_HASH_BLOCK_FIRST | FL_HASH_BLOCK_LAST | FL_HASH_BLOCK_ERROR);
+      return(-1);
+   }
+
+   file_size = file_info->getMeta()->getSize();
+   if (file_size <= 0)
+      push_block(pipe, flrec, NULL, 0, FL_HASH_BLOCK_FIRST | FL_HASH_BLOCK_LAST);
+
+   for (offset = 0; offset < file_size; offset += cnt)
+   {
+      if (!running)
+      {
+         push_block(pipe, flrec, NULL, 0, flags | FL_HASH_BLOCK_LAST | FL_HASH_BLOCK_ERROR);
+         break;
+      }
+      len = (file_size - offset < FL_HASH_BLOCK_SIZE) ? (size_t)(file_size - offset) : FL_HASH_BLOCK_SIZE;
+      buffer = wait_free_buffer(pipe);
+      cnt = Fineline_File_System::read_file(file_info, flrec, offset, buffer, len);
+      if (cnt <= 0)
+      {
+         release_buffer(pipe, buffer);
+         push_block(pipe, flrec, NULL, 0, flags | FL_HASH_BLOCK_LAST | FL_HASH_BLOCK_ERROR);
+         break;
+      }
+      if (offset + cnt >= file_size)
+         flags |= FL_HASH_BLOCK_LAST;
+      push_block(pipe, flrec, buffer, (size_t)cnt, flags);
+      flags = 0;
+   }
+
+   delete file_info;
+
+   return(0);
+}
+
+/*
+   Function: reader_task
+   Purpose : Reader thread, takes batches of files from the shared file list
+             until it is empty or hashing is stopped, then ends its hasher's
+             block stream.
+   Input   : File hasher object and the reader/hasher pipe.
+   Output  : None.
+*/
+void Fineline_File_Hasher::reader_task(Fineline_File_Hasher *ffh, fl_hash_pipe_t *pipe)
+{
+   TskImgInfo *img_info = Fineline_File_System::open_image(ffh->image_path);
+   vector<TskFsInfo *> fs_list(ffh->file_system_offsets.size(), (TskFsInfo *)NULL);
+   size_t start, end, n;
+   unsigned int i;
+
+   if (img_info == NULL)
+   {
+      Fineline_Log::print_log_entry("reader_task() <ERROR> Could not open image file.\n");
+      push_block(pipe, NULL, NULL, 0, 0);
+      return;
+   }
+
+   while (ffh->running)
+   {
+      start = ffh->next_file.fetch_add(FL_HASH_FILE_BATCH);
+      if (start >= ffh->file_list.size())
+         break;
+      end = min(start + FL_HASH_FILE_BATCH, ffh->file_list.size());
+      for (n = start; n < end; n++)
+         ffh->read_file(img_info, fs_list, ffh->file_list[n], pipe);
+   }
+
+   push_block(pipe, NULL, NULL, 0, 0);
+
+   for (i = 0; i < fs_list.size(); i++)
+   {
+      if (fs_list[i] != NULL)
+         delete fs_list[i];
+   }
+   Fineline_File_System::close_image(img_info);
+}
+
+/*
+   Function: hasher_task
+   Purpose : Hasher thread, digests the blocks from its reader and stores the
+             digests when the last block of a file arrives.
+   Input   : File hasher object and the reader/hasher pipe.
+   Output  : None.
+*/
+void Fineline_File_Hasher::hasher_task(Fineline_File_Hasher *ffh, fl_hash_pipe_t *pipe)
+{
+   Fineline_Hash hash;
+   fl_hash_block_t block;
+   unsigned char md5[FL_MD5_LENGTH];
+   unsigned char sha1[FL_SHA1_LENGTH];
+   unsigned char sha256[FL_SHA256_LENGTH];
+
+   for (block = pop_block(pipe); block.record != NULL; block = pop_block(pipe))
+   {
+      if (block.flags & FL_HASH_BLOCK_FIRST)
+         hash.reset();
+      if (block.data != NULL)
+      {
+         hash.update(block.data, block.length);
+         ffh->bytes_hashed += (uint64_t)block.length;
+         release_buffer(pipe, block.data);
+      }
+      if ((block.flags & FL_HASH_BLOCK_LAST) && !(block.flags & FL_HASH_BLOCK_ERROR))
+      {
+         hash.final(md5, sha1, sha256);
+         ffh->store_digests(block.record, md5, sha1, sha256);
+      }
+   }
+}
+
+/*
+   Function: hash_files
+   Purpose : Hashes every file added to the hasher. Files hashed by an earlier
+             run are only checked against the current hash sets.
+   Input   : Number of threads, 0 = one per CPU core. Half of the threads
+             read and half hash.
+   Output  : Returns the number of hashed files.
+*/
+long Fineline_File_Hasher::hash_files(int thread_count)
+{
+   vector<fl_hash_pipe_t *> pipes;
+   vector<thread> workers;
+   vector<fl_file_record_t *>::iterator unhashed;
+   size_t first_unhashed, n;
+   int i, j, pair_count;
+
+   hashed_count = 0;
+   known_good_count = 0;
+   known_bad_count = 0;
+   bytes_hashed = 0;
+
+   if (file_list.size() == 0)
+      return(0);
+
+   running = 1;
+
+   unhashed = stable_partition(file_list.begin(), file_list.end(), fl_hash_is_hashed());
+   first_unhashed = (size_t)(unhashed - file_list.begin());
+   for (n = 0; n < first_unhashed; n++)
+   {
+      check_hash_sets(file_list[n]);
+      hashed_count++;
+   }
+   sort(unhashed, file_list.end(), fl_hash_address_order());
+   next_file = first_unhashed;
+
+   if (thread_count <= 0)
+      thread_count = (int)thread::hardware_concurrency();
+   pair_count = (thread_count + 1) / 2;
+   n = (file_list.size() - first_unhashed + FL_HASH_FILE_BATCH - 1) / FL_HASH_FILE_BATCH;
+   if ((size_t)pair_count > n)
+      pair_count = (int)n;
+
+   for (i = 0; i < pair_count; i++)
+   {
+      pipes.push_back(new fl_hash_pipe_t());
+      for (j = 0; j < FL_HASH_PIPE_BUFFERS; j++)
+         pipes[i]->free_buffers.push_back((char *)Fineline_Util::xmalloc(FL_HASH_BLOCK_SIZE));
+   }
+
+   for (i = 0; i < pair_count; i++)
+   {
+      workers.push_back(thread(hasher_task, this, pipes[i]));
+      if (i > 0)
+         workers.push_back(thread(reader_task, this, pipes[i]));
+   }
+   if (pair_count > 0)
+      reader_task(this, pipes[0]);
+   for (i = 0; i < (int)workers.size(); i++)
+   {
+      workers[i].join();
+   }
+
+   for (i = 0; i < pair_count; i++)
+   {
+      for (j = 0; j < (int)pipes[i]->free_buffers.size(); j++)
+         free(pipes[i]->free_buffers[j]);
+      delete pipes[i];
+   }
+
+   running = 0;
+
+   return((long)hashed_count);
+}
+
+void Fineline_File_Hasher::stop_hashing()
+{
+   running = 0;
+}
+
+int Fineline_File_Hasher::get_running()
+{
+   return(running);
+}
+
+size_t Fineline_File_Hasher::get_file_count()
+{
+   return(file_list.size());
+}
+
+size_t Fineline_File_Hasher::get_hashed_count()
+{
+   return(hashed_count);
+}
+
+size_t Fineline_File_Hasher::get_known_good_count()
+{
+   return(known_good_count);
+}
+
+size_t Fineline_File_Hasher::get_known_bad_count()
+{
+   return(known_bad_count);
+}
+
+uint64_t Fineline_File_Hasher::get_bytes_hashed()
+{
+   return(bytes_hashed);
+}
@@ -0,0 +1,135 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_File_Hasher.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: MD5, SHA-1 and SHA-256 digests of every regular file in a forensic
+            image. The work is split into reader/hasher thread pairs, the
+            reader opens its own TSK image and file system handles and reads
+            the files in large blocks into a small ring of buffers while the
+            hasher digests the blocks already read, so the image I/O and the
+            hashing overlap.
+
+            The digests are stored in the file records and looked up in the
+            known good and known bad hash sets. Known good files are hidden,
+            known bad files are flagged for the GUI to highlight.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#ifndef FINELINE_FILE_HASHER_H
+#define FINELINE_FILE_HASHER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include <stdint.h>
+#include <tsk/libtsk.h>
+
+#include "fineline-search.h"
+#include "Fineline_File_Index.h"
+#include "Fineline_File_Arena.h"
+#include "../common/Fineline_Hash_Set.h"
+
+#define FL_HASH_BLOCK_SIZE    4194304   /* bytes read from a file at a time */
+#define FL_HASH_PIPE_BUFFERS  4         /* read buffers per reader/hasher pair */
+#define FL_HASH_FILE_BATCH    16        /* files taken by a reader at a time */
+
+#define FL_HASH_BLOCK_FIRST   1
+#define FL_HASH_BLOCK_LAST    2
+#define FL_HASH_BLOCK_ERROR   4         /* read failed, the file is not hashed */
+
+using namespace std;
+
+/* A block of file data passed from a reader to its hasher, a NULL record ends the stream. */
+struct fl_hash_block
+{
+   fl_file_record_t *record;
+   char *data;
+   size_t length;
+   int flags;
+};
+typedef struct fl_hash_block fl_hash_block_t;
+
+/* Bounded buffer queue between a reader and a hasher thread. */
+struct fl_hash_pipe
+{
+   mutex pipe_lock;
+   condition_variable block_ready;
+   condition_variable buffer_free;
+   deque<fl_hash_block_t> full_blocks;
+   vector<char *> free_buffers;
+};
+typedef struct fl_hash_pipe fl_hash_pipe_t;
+
+class Fineline_File_Hasher
+{
+   public:
+      Fineline_File_Hasher(string image_path, vector<TSK_OFF_T> fs_offsets, Fineline_File_Arena *arena);
+      virtual ~Fineline_File_Hasher();
+
+      int add_file(fl_file_record_t *flrec);
+      int add_files(Fineline_File_Map fmap);
+      void set_known_good(const Fineline_Hash_Set *hash_set);
+      void set_known_bad(const Fineline_Hash_Set *hash_set);
+      long hash_files(int thread_count);
+      int store_digests(fl_file_record_t *flrec, const unsigned char *md5, const unsigned char *sha1, const unsigned char *sha256);
+      int check_hash_sets(fl_file_record_t *flrec);
+      void stop_hashing();
+      int get_running();
+
+      size_t get_file_count();
+      size_t get_hashed_count();
+      size_t get_known_good_count();
+      size_t get_known_bad_count();
+      uint64_t get_bytes_hashed();
+
+   protected:
+   private:
+
+      static void reader_task(Fineline_File_Hasher *ffh, fl_hash_pipe_t *pipe);
+      static void hasher_task(Fineline_File_Hasher *ffh, fl_hash_pipe_t *pipe);
+      int read_file(TskImgInfo *img_info, vector<TskFsInfo *> &fs_list, fl_file_record_t *flrec, fl_hash_pipe_t *pipe);
+
+      string image_path;
+      vector<TSK_OFF_T> file_system_offsets;  /* file system id - 1 -> offset in the image */
+      Fineline_File_Arena *file_arena;
+      const Fineline_Hash_Set *known_good;
+      const Fineline_Hash_Set *known_bad;
+
+      vector<fl_file_record_t *> file_list;
+      atomic<size_t> next_file;
+      atomic<size_t> hashed_count;
+      atomic<size_t> known_good_count;
+      atomic<size_t> known_bad_count;
+      atomic<uint64_t> bytes_hashed;
+      atomic<int> running;
+};
+
+#endif // FINELINE_FILE_HASHER_H
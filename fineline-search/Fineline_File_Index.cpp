@@ -0,0 +1,303 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_File_Index.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Path index of the file metadata records in the file system tree.
+            Lookups use an open addressing hash table, ordered iteration uses
+            a position array that is sorted when the index is published.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <string.h>
+#include <algorithm>
+
+#include "Fineline_File_Index.h"
+
+/* Orders entry numbers by path, the same order as the std::map the index replaced. */
+struct fl_file_index_order
+{
+   const char *paths;
+   const fl_file_index_entry_t *entries;
+
+   bool operator()(uint32_t a, uint32_t b) const
+   {
+      return(strcmp(paths + entries[a].path_offset, paths + entries[b].path_offset) < 0);
+   }
+};
+
+Fineline_File_Index::Fineline_File_Index()
+{
+   hash_table.assign(FL_INDEX_HASH_SIZE, 0);
+   sorted = 1;
+}
+
+Fineline_File_Index::Fineline_File_Index(const Fineline_File_Index &findex)
+{
+   path_data = findex.path_data;
+   entries = findex.entries;
+   hash_table = findex.hash_table;
+   sorted_entries = findex.sorted_entries;
+   sorted = findex.sorted;
+}
+
+Fineline_File_Index::~Fineline_File_Index()
+{
+   //dtor
+}
+
+uint32_t Fineline_File_Index::hash_path(const char *path, size_t length)
+{
+   uint32_t hash = 2166136261u;
+   size_t i;
+
+   for (i = 0; i < length; i++)
+   {
+      hash ^= (unsigned char)path[i];
+      hash *= 16777619u;
+   }
+
+   return(hash);
+}
+
+/*
+   Function: find_entry
+   Purpose : Looks up a path in the hash table.
+   Input   : Path, path length and path hash.
+   Output  : Returns the hash table slot of the path, or -(slot + 1) of the
+             empty slot where the path would be inserted.
+*/
+long Fineline_File_Index::find_entry(const char *path, size_t length, uint32_t hash) const
+{
+   size_t mask = hash_table.size() - 1;
+   size_t slot = hash & mask;
+   const fl_file_index_entry_t *e;
+
+   while (hash_table[slot] != 0)
+   {
+      e = &entries[hash_table[slot] - 1];
+      if ((e->path_hash == hash) && (e->path_length == length) && (memcmp(&path_data[e->path_offset], path, length) == 0))
+         return((long)slot);
+      slot = (slot + 1) & mask;
+   }
+
+   return(-((long)slot + 1));
+}
+
+void Fineline_File_Index::grow_hash_table()
+{
+   size_t new_size = hash_table.size() * 2;
+   size_t mask = new_size - 1;
+   size_t i, slot;
+
+   hash_table.assign(new_size, 0);
+   for (i = 0; i < entries.size(); i++)
+   {
+      slot = entries[i].path_hash & mask;
+      while (hash_table[slot] != 0)
+         slot = (slot + 1) & mask;
+      hash_table[slot] = (uint32_t)(i + 1);
+   }
+}
+
+/*
+   Function: add_file
+   Purpose : Adds a file record to the index, replaces the record if the
+             path is already in the index.
+   Input   : Full tree path of the file and the file metadata record.
+   Output  : Returns the number of files in the index.
+*/
+int Fineline_File_Index::add_file(const string &file_path, fl_file_record_t *flrec)
+{
+   uint32_t hash = hash_path(file_path.c_str(), file_path.size());
+   long slot = find_entry(file_path.c_str(), file_path.size(), hash);
+   fl_file_index_entry_t e;
+
+   if (slot >= 0)
+   {
+      entries[hash_table[slot] - 1].record = flrec;
+      return(entries.size());
+   }
+
+   e.path_offset = path_data.size();
+   e.path_length = (uint32_t)file_path.size();
+   e.path_hash = hash;
+   e.record = flrec;
+
+   path_data.insert(path_data.end(), file_path.begin(), file_path.end());
+   path_data.push_back(0);
+   entries.push_back(e);
+   hash_table[-(slot + 1)] = (uint32_t)entries.size();
+   sorted = 0;
+
+   if (entries.size() * 2 > hash_table.size())
+      grow_hash_table();
+
+   return(entries.size());
+}
+
+/*
+   Function: sort_index
+   Purpose : Sorts the entry positions by path, must be called before the
+             ordered accessors are used. Does nothing if already sorted.
+   Input   : None.
+   Output  : None.
+*/
+void Fineline_File_Index::sort_index()
+{
+   fl_file_index_order order;
+   size_t i;
+
+   if (sorted)
+      return;
+
+   // Entries added since the last sort are appended and the whole array
+   // is sorted again, std::sort is fast on the mostly ordered result.
+
+   for (i = sorted_entries.size(); i < entries.size(); i++)
+      sorted_entries.push_back((uint32_t)i);
+
+   order.paths = path_data.data();
+   order.entries = entries.data();
+   if (!std::is_sorted(sorted_entries.begin(), sorted_entries.end(), order)) // e.g. loaded in path order
+      sort(sorted_entries.begin(), sorted_entries.end(), order);
+
+   sorted = 1;
+}
+
+/*
+   Function: reserve
+   Purpose : Sizes the index for a known number of files, so loading a saved
+             case does not grow the hash table and arrays step by step.
+   Input   : Number of files and the total bytes of their paths.
+   Output  : None.
+*/
+void Fineline_File_Index::reserve(size_t file_count, size_t path_size)
+{
+   size_t table_size = hash_table.size();
+
+   entries.reserve(file_count);
+   sorted_entries.reserve(file_count);
+   path_data.reserve(path_size + file_count);
+
+   while (file_count * 2 > table_size)
+      table_size *= 2;
+   if (table_size > hash_table.size())
+   {
+      hash_table.assign(table_size / 2, 0);
+      grow_hash_table();
+   }
+}
+
+void Fineline_File_Index::clear()
+{
+   path_data.clear();
+   entries.clear();
+   sorted_entries.clear();
+   hash_table.assign(FL_INDEX_HASH_SIZE, 0);
+   sorted = 1;
+}
+
+size_t Fineline_File_Index::size() const
+{
+   return(entries.size());
+}
+
+int Fineline_File_Index::is_sorted() const
+{
+   return(sorted);
+}
+
+/*
+   Function: find_file
+   Purpose : Looks up the file metadata record for a full tree path.
+   Input   : Full tree path.
+   Output  : Pointer to the file metadata record or NULL.
+*/
+fl_file_record_t *Fineline_File_Index::find_file(const string &file_path) const
+{
+   long slot = find_entry(file_path.c_str(), file_path.size(), hash_path(file_path.c_str(), file_path.size()));
+
+   if (slot < 0)
+      return(NULL);
+
+   return(entries[hash_table[slot] - 1].record);
+}
+
+/*
+   Function: find_prefix
+   Purpose : Finds the first path in sorted order that is not less than the
+             prefix, all paths starting with the prefix follow it.
+   Input   : Path prefix.
+   Output  : Sorted position, size() if every path is less than the prefix.
+*/
+size_t Fineline_File_Index::find_prefix(const string &prefix) const
+{
+   size_t low = 0;
+   size_t high = sorted_entries.size();
+   size_t mid;
+
+   while (low < high)
+   {
+      mid = low + (high - low) / 2;
+      if (strcmp(&path_data[entries[sorted_entries[mid]].path_offset], prefix.c_str()) < 0)
+         low = mid + 1;
+      else
+         high = mid;
+   }
+
+   return(low);
+}
+
+fl_file_record_t *Fineline_File_Index::get_record(size_t position) const
+{
+   if (position >= sorted_entries.size())
+      return(NULL);
+
+   return(entries[sorted_entries[position]].record);
+}
+
+const char *Fineline_File_Index::get_path(size_t position) const
+{
+   if (position >= sorted_entries.size())
+      return(NULL);
+
+   return(&path_data[entries[sorted_entries[position]].path_offset]);
+}
+
+size_t Fineline_File_Index::get_path_length(size_t position) const
+{
+   if (position >= sorted_entries.size())
+      return(0);
+
+   return(entries[sorted_entries[position]].path_length);
+}
+
+size_t Fineline_File_Index::get_memory_used() const
+{
+   return(path_data.capacity() + entries.capacity() * sizeof(fl_file_index_entry_t) +
+          (hash_table.capacity() + sorted_entries.capacity()) * sizeof(uint32_t));
+}
@@ -0,0 +1,103 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_File_Index.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Index of the file metadata records in the file system tree, keyed
+            by the full tree path. The paths are packed into one buffer, a hash
+            table gives path lookups and a sorted position array gives ordered
+            and prefix iteration.
+
+            The index is shared through a reference counted pointer. A sorted
+            index handed out as a Fineline_File_Map is never modified, the file
+            system tree copies the index before changing it if a snapshot is
+            still held, so filters can read a snapshot in another thread.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#ifndef FINELINE_FILE_INDEX_H
+#define FINELINE_FILE_INDEX_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fineline-search.h"
+
+#define FL_INDEX_HASH_SIZE 1024   /* initial hash table size, a power of 2 */
+
+using namespace std;
+
+struct fl_file_index_entry
+{
+   uint64_t path_offset;        /* offset of the NUL terminated path in the path buffer */
+   uint32_t path_length;
+   uint32_t path_hash;
+   fl_file_record_t *record;
+};
+typedef struct fl_file_index_entry fl_file_index_entry_t;
+
+class Fineline_File_Index
+{
+   public:
+      Fineline_File_Index();
+      Fineline_File_Index(const Fineline_File_Index &findex);
+      virtual ~Fineline_File_Index();
+
+      int add_file(const string &file_path, fl_file_record_t *flrec);
+      void sort_index();
+      void reserve(size_t file_count, size_t path_size);
+      void clear();
+
+      size_t size() const;
+      int is_sorted() const;
+      fl_file_record_t *find_file(const string &file_path) const;
+      size_t find_prefix(const string &prefix) const;
+      fl_file_record_t *get_record(size_t position) const;
+      const char *get_path(size_t position) const;
+      size_t get_path_length(size_t position) const;
+      size_t get_memory_used() const;
+
+   protected:
+   private:
+
+      long find_entry(const char *path, size_t length, uint32_t hash) const;
+      void grow_hash_table();
+      static uint32_t hash_path(const char *path, size_t length);
+
+      vector< char > path_data;
+      vector< fl_file_index_entry_t > entries;
+      vector< uint32_t > hash_table;     /* entry number + 1, 0 is an empty slot */
+      vector< uint32_t > sorted_entries; /* entry numbers in path order */
+      int sorted;
+};
+
+typedef shared_ptr< const Fineline_File_Index > Fineline_File_Map;
+
+#endif // FINELINE_FILE_INDEX_H
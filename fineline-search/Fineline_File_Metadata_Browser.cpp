@@ -32,25 +32,65 @@
 */
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <time.h>
+#include <algorithm>
+
+#include <FL/fl_draw.H>
 
 #include "../common/Fineline_Util.h"
 #include "Fineline_Log.h"
 
 #include "Fineline_File_Metadata_Browser.h"
 
-Fineline_File_Metadata_Browser::Fineline_File_Metadata_Browser(int x, int y, int w, int h) : Fl_Browser(x, y, w, h)
+static const char *column_labels[FL_METADATA_COLUMNS] = { "Filename", "Modification Time", "Access Time", "Creation Time", "File Size" };
+
+/* Sort key of a file row and the text rows below it, computed once per sort. */
+struct fl_metadata_sort_key
 {
-   //ctor
-   textfont(FL_HELVETICA);
-   textsize(10);
-   textcolor(FL_DARK_BLUE);
+   int64_t value;
+   const char *name;
+   uint32_t first_row;              /* row_list position of the file row */
+   uint32_t row_count;
+};
+
+struct fl_metadata_key_order
+{
+   int column;
+   int descending;
+
+   bool operator()(const fl_metadata_sort_key &a, const fl_metadata_sort_key &b) const
+   {
+      const fl_metadata_sort_key &x = descending ? b : a;
+      const fl_metadata_sort_key &y = descending ? a : b;
 
-   static int widths[] = { 100, 150, 150, 150, 100, 100, 100, 100, 100, 50, 0 };            // widths for each column
-   column_widths(widths);
-   column_char('\t');                                                       // tabs as column delimiters
-   type(FL_MULTI_BROWSER);
+      if (column == FL_COLUMN_NAME)
+         return(strcmp(x.name, y.name) < 0);
+      return(x.value < y.value);
+   }
+};
+
+Fineline_File_Metadata_Browser::Fineline_File_Metadata_Browser(int x, int y, int w, int h) : Fl_Table_Row(x, y, w, h)
+{
+   //ctor
+   static int widths[] = { 100, 150, 150, 150, 100 };            // widths for each column
+   int i;
+
+   sorted_column = -1;
+   sort_descending = 0;
+
+   type(SELECT_MULTI);
+   selection_color(FL_YELLOW);
+   cols(FL_METADATA_COLUMNS);
+   col_header(1);
+   col_header_height(FL_METADATA_ROW_HEIGHT + 4);
+   col_resize(1);
+   for (i = 0; i < FL_METADATA_COLUMNS; i++)
+      col_width(i, widths[i]);
+   callback(table_callback, (void *)this);
+   when(FL_WHEN_RELEASE);
+   end();
 
    //resizable();
 }
@@ -60,71 +100,104 @@ Fineline_File_Metadata_Browser::~Fineline_File_Metadata_Browser()
    //dtor
 }
 
-
+/*
+   Function: add_file_record
+   Purpose : Adds a file row to the end of the table, the row is formatted
+             when it is drawn.
+   Input   : File metadata record.
+   Output  : Returns 0.
+*/
 int Fineline_File_Metadata_Browser::add_file_record(fl_file_record_t *flec)
 {
-   char file_size_string[256];
-   string meta_line;
+   fl_metadata_row_t row;
 
    if (flec != NULL)
    {
-      get_long_time_strings(flec);
-
       file_list.push_back(flec);
 
-      if (size() == 0)
-      {
-         meta_line = "Filename\tModification Time\tAccess Time\tCreation Time\tOwner\tFile Size";
-         add(meta_line.c_str());
-      }
-
-      meta_line = flec->file_name;
-
-      meta_line.append("\t");
-      meta_line.append(flec->file_modification_time_string);
-
-      meta_line.append("\t");
-      meta_line.append(flec->file_access_time_string);
-
-      meta_line.append("\t");
-      meta_line.append(flec->file_creation_time_string);
-
-      meta_line.append("\t");
-      meta_line.append(flec->file_owner);
-
-      meta_line.append("\t");
-      meta_line.append(Fineline_Util::xitoa(flec->file_size, file_size_string, 256, 10));
-
-      //meta_line.append("\t");
-      //meta_line.append("................................................................");
-
-
-      add(meta_line.c_str());
+      row.record = flec;
+      row.text = 0;
+      row_order.push_back((uint32_t)row_list.size());
+      row_list.push_back(row);
+      sorted_column = -1;
+      redraw();
 
       if (DEBUG)
-         Fineline_Log::print_log_entry(meta_line.c_str());
+         Fineline_Log::print_log_entry(get_row(size()).c_str());
    }
    return(0);
 }
 
-int add_file_record_list(vector< fl_file_record_t* > append_list)
+int Fineline_File_Metadata_Browser::add_file_record_list(vector< fl_file_record_t* > append_list)
 {
-   //TODO: add the records to the vector and call add_file_record() to format into html and display
+   fl_metadata_row_t row;
+   size_t i;
 
-   return(0);
+   row_list.reserve(row_list.size() + append_list.size());
+   row_order.reserve(row_order.size() + append_list.size());
+   row.text = 0;
+   for (i = 0; i < append_list.size(); i++)
+   {
+      if (append_list[i] == NULL)
+         continue;
+      file_list.push_back(append_list[i]);
+      row.record = append_list[i];
+      row_order.push_back((uint32_t)row_list.size());
+      row_list.push_back(row);
+   }
+   sorted_column = -1;
+   redraw();
+
+   return(size());
 }
 
+/*
+   Function: add_row
+   Purpose : Adds a line of text, e.g. the digests of the file row above it.
+   Input   : The text.
+   Output  : Returns the number of rows.
+*/
 int Fineline_File_Metadata_Browser::add_row(string file_metadata)
 {
-   return(0);
-}
+   fl_metadata_row_t row;
 
+   row.record = NULL;
+   row.text = (uint32_t)text_list.size();
+   text_list.push_back(file_metadata);
+   row_order.push_back((uint32_t)row_list.size());
+   row_list.push_back(row);
+   redraw();
+
+   return(size());
+}
 
+/*
+   Function: get_row
+   Purpose : Formats a row as tab separated text.
+   Input   : Row number in display order, starting at 1.
+   Output  : The row text, empty if there is no such row.
+*/
 string Fineline_File_Metadata_Browser::get_row(int record_number)
 {
-   string row = text(record_number);
+   const fl_metadata_row_t *row;
+   string line;
+   int i;
 
-   return(row);
+   if ((record_number < 1) || (record_number > size()))
+      return(line);
+
+   row = &row_list[row_order[record_number - 1]];
+   if (row->record == NULL)
+      return(text_list[row->text]);
+
+   for (i = 0; i < FL_METADATA_COLUMNS; i++)
+   {
+      if (i > 0)
+         line.append("\t");
+      line.append(format_cell(row, i));
+   }
+
+   return(line);
 }
 
 int Fineline_File_Metadata_Browser::delete_row(int record_number)
@@ -137,15 +210,36 @@ int Fineline_File_Metadata_Browser::add_table(string metadata_table)
    return(0);
 }
 
+/*
+   Function: get_table
+   Purpose : Formats the column headings and every row as tab separated lines.
+   Input   : None.
+   Output  : The table text.
+*/
 string Fineline_File_Metadata_Browser::get_table()
 {
    string table;
+   int i;
+
+   for (i = 0; i < FL_METADATA_COLUMNS; i++)
+   {
+      if (i > 0)
+         table.append("\t");
+      table.append(column_labels[i]);
+   }
+   table.append("\n");
+   for (i = 1; i <= size(); i++)
+   {
+      table.append(get_row(i));
+      table.append("\n");
+   }
 
    return(table);
 }
 
 int Fineline_File_Metadata_Browser::delete_table()
 {
+   clear();
    return(0);
 }
 
@@ -168,39 +262,252 @@ int Fineline_File_Metadata_Browser::get_record_count()
    return(file_list.size());
 }
 
-int Fineline_File_Metadata_Browser::get_long_time_strings(fl_file_record_t *flec)
+int Fineline_File_Metadata_Browser::size()
+{
+   return((int)row_order.size());
+}
+
+void Fineline_File_Metadata_Browser::clear()
+{
+   row_list.clear();
+   row_order.clear();
+   text_list.clear();
+   file_list.clear();
+   sorted_column = -1;
+   rows(0);
+   redraw();
+}
+
+/*
+   Function: sort_column
+   Purpose : Sorts the file rows by a column, the text rows stay below the
+             file row they were added after. Text rows added before the
+             first file row stay at the top.
+   Input   : Column number and 1 for descending order.
+   Output  : None.
+*/
+void Fineline_File_Metadata_Browser::sort_column(int column, int descending)
 {
-   // Convert long time to strings
+   vector< fl_metadata_sort_key > keys;
+   fl_metadata_sort_key key;
+   fl_metadata_key_order order;
+   const fl_file_record_t *flec;
+   size_t i, lead;
+   uint32_t j;
+
+   if ((column < 0) || (column >= FL_METADATA_COLUMNS))
+      return;
+
+   for (i = 0; i < row_list.size(); i++)
+   {
+      if ((row_list[i].record == NULL) && (keys.size() > 0))
+      {
+         keys.back().row_count++;
+         continue;
+      }
+      key.first_row = (uint32_t)i;
+      key.row_count = 1;
+      key.name = "";
+      key.value = 0;
+      flec = row_list[i].record;
+      if (flec != NULL)
+      {
+         if (flec->file_name != NULL)
+            key.name = flec->file_name;
+         switch (column)
+         {
+            case FL_COLUMN_MODIFIED: key.value = flec->modification_time; break;
+            case FL_COLUMN_ACCESSED: key.value = flec->access_time; break;
+            case FL_COLUMN_CREATED:  key.value = flec->creation_time; break;
+            case FL_COLUMN_SIZE:     key.value = flec->file_size; break;
+         }
+      }
+      keys.push_back(key);
+   }
+
+   lead = ((keys.size() > 0) && (row_list[keys[0].first_row].record == NULL)) ? 1 : 0;
+   order.column = column;
+   order.descending = descending;
+   stable_sort(keys.begin() + lead, keys.end(), order);
+
+   row_order.clear();
+   for (i = 0; i < keys.size(); i++)
+   {
+      for (j = 0; j < keys[i].row_count; j++)
+         row_order.push_back(keys[i].first_row + j);
+   }
+
+   sorted_column = column;
+   sort_descending = descending;
+   redraw();
+}
+
+/*
+   Function: table_callback
+   Purpose : Sorts the table when a column header is clicked, a second click
+             on the same column reverses the order.
+   Input   : The table widget.
+   Output  : None.
+*/
+void Fineline_File_Metadata_Browser::table_callback(Fl_Widget *w, void *p)
+{
+   Fineline_File_Metadata_Browser *mb = (Fineline_File_Metadata_Browser *)p;
+   int column = mb->callback_col();
+
+   if ((mb->callback_context() == CONTEXT_COL_HEADER) && (Fl::event() == FL_RELEASE))
+      mb->sort_column(column, (column == mb->sorted_column) ? !mb->sort_descending : 0);
+}
+
+void Fineline_File_Metadata_Browser::draw()
+{
+   int old_rows = rows();
+
+   // The row count is only updated here, setting it adds up the row heights.
+   if (old_rows != size())
+   {
+      rows(size());
+      if (old_rows == 0)
+         row_height_all(FL_METADATA_ROW_HEIGHT); // new rows copy the height of the last row
+   }
+
+   Fl_Table_Row::draw();
+}
+
+void Fineline_File_Metadata_Browser::draw_cell(TableContext context, int R, int C, int X, int Y, int W, int H)
+{
+   const fl_metadata_row_t *row;
+   string cell;
+   int offset = 0;
+   int i;
+
+   switch (context)
+   {
+      case CONTEXT_STARTPAGE:
+         fl_font(FL_HELVETICA, 10);
+         return;
+
+      case CONTEXT_COL_HEADER:
+         cell = column_labels[C];
+         if (C == sorted_column)
+            cell.append(sort_descending ? " (desc)" : " (asc)");
+         fl_push_clip(X, Y, W, H);
+         fl_draw_box(FL_THIN_UP_BOX, X, Y, W, H, col_header_color());
+         fl_color(FL_BLACK);
+         fl_draw(cell.c_str(), X + 2, Y, W - 4, H, FL_ALIGN_LEFT, 0, 0);
+         fl_pop_clip();
+         return;
+
+      case CONTEXT_CELL:
+         if (R >= size())
+            return;
+         row = &row_list[row_order[R]];
+         fl_push_clip(X, Y, W, H);
+         fl_color(row_selected(R) ? selection_color() : FL_WHITE);
+         fl_rectf(X, Y, W, H);
+         fl_color(FL_DARK_BLUE);
+         if (row->record == NULL)
+         {
+            // Text rows run across the columns, each cell draws its part of the line.
+            for (i = 0; i < C; i++)
+               offset += col_width(i);
+            fl_draw(text_list[row->text].c_str(), X - offset + 2, Y, offset + W, H, FL_ALIGN_LEFT, 0, 0);
+         }
+         else
+         {
+            cell = format_cell(row, C);
+            fl_draw(cell.c_str(), X + 2, Y, W - 4, H, (C == FL_COLUMN_SIZE) ? FL_ALIGN_RIGHT : FL_ALIGN_LEFT, 0, 0);
+         }
+         fl_pop_clip();
+         return;
+
+      default:
+         return;
+   }
+}
+
+string Fineline_File_Metadata_Browser::format_cell(const fl_metadata_row_t *row, int column)
+{
+   char file_size_string[256];
+
+   switch (column)
+   {
+      case FL_COLUMN_NAME:
+         return(string((row->record->file_name != NULL) ? row->record->file_name : ""));
+      case FL_COLUMN_MODIFIED:
+         return(get_time_string(row->record->modification_time));
+      case FL_COLUMN_ACCESSED:
+         return(get_time_string(row->record->access_time));
+      case FL_COLUMN_CREATED:
+         return(get_time_string(row->record->creation_time));
+      case FL_COLUMN_SIZE:
+         snprintf(file_size_string, sizeof(file_size_string), "%lld", (long long)row->record->file_size);
+         return(string(file_size_string));
+   }
+
+   return(string());
+}
+
+string Fineline_File_Metadata_Browser::get_time_string(int64_t file_time)
+{
+   // Convert the record time to a string for display, the strings
+   // are not kept in the file metadata record.
    time_t filetime;
    struct tm *loctime;
    char *time_str;
 
-   /* Get the access time. */
-   filetime = (time_t)flec->access_time;
-   loctime = localtime (&filetime);
-   time_str = asctime(loctime);
-   Fineline_Util::rtrim(time_str);
-   strncpy(flec->file_access_time_string, time_str, strlen(time_str));
-
-   /* Get the modification time. */
-   filetime = (time_t)flec->modification_time;
-   loctime = localtime (&filetime);
-   time_str = asctime(loctime);
-   Fineline_Util::rtrim(time_str);
-   strncpy(flec->file_modification_time_string, time_str, strlen(time_str));
-
-   /* Get the creation time. */
-   filetime = (time_t)flec->creation_time;
+   filetime = (time_t)file_time;
    loctime = localtime (&filetime);
+   if (loctime == NULL)
+      return(string("NONE"));
    time_str = asctime(loctime);
    Fineline_Util::rtrim(time_str);
-   strncpy(flec->file_creation_time_string, time_str, strlen(time_str));
 
-   return(0);
+   return(string(time_str));
 }
 
+/*
+   Function: save_metadata_list
+   Purpose : Writes the table to a text file as tab separated lines.
+   Input   : Text file name.
+   Output  : Returns 0 on success, -1 on error.
+*/
 int Fineline_File_Metadata_Browser::save_metadata_list(const char *filename)
 {
-   //TODO: open or create a text file and write out the file metadata list
-   return(0);
+   FILE *fp = fopen(filename, "w");
+   string line;
+   int i, result = 0;
+
+   if (fp == NULL)
+   {
+      line = "save_metadata_list() <ERROR>: Could not create file: ";
+      line.append(filename);
+      Fineline_Log::print_log_entry(line.c_str());
+      return(-1);
+   }
+
+   for (i = 0; i < FL_METADATA_COLUMNS; i++)
+   {
+      if (i > 0)
+         fputs("\t", fp);
+      fputs(column_labels[i], fp);
+   }
+   fputs("\n", fp);
+   for (i = 1; (i <= size()) && (result == 0); i++)
+   {
+      line = get_row(i);
+      line.append("\n");
+      if (fputs(line.c_str(), fp) == EOF)
+         result = -1;
+   }
+   if (fclose(fp) != 0)
+      result = -1;
+
+   if (result < 0)
+   {
+      line = "save_metadata_list() <ERROR>: Could not write file: ";
+      line.append(filename);
+      Fineline_Log::print_log_entry(line.c_str());
+   }
+
+   return(result);
 }
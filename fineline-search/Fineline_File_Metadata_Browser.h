@@ -26,7 +26,12 @@
    Author: Derek Chadwick
    Date  : 25/05/2014
 
-   Purpose: FineLine FLTK GUI file metadata browser widget.
+   Purpose: FineLine FLTK GUI file metadata browser widget. A virtual table,
+            the rows only hold the file record pointer or the number of a
+            text line and the cells are formatted when they are drawn, so
+            only the visible rows cost anything to show. Clicking a column
+            header sorts the files by that column, text rows such as the
+            digests of a file stay below their file.
 
    Notes: EXPERIMENTAL
 
@@ -40,14 +45,28 @@
 #include <string>
 #include <vector>
 
+#include <stdint.h>
+
 #include <FL/Fl.H>
-#include <FL/Fl_Browser.H>
+#include <FL/Fl_Table_Row.H>
 
 #include "fineline-search.h"
 
+#define FL_METADATA_COLUMNS    5
+#define FL_METADATA_ROW_HEIGHT 16
+
+enum FL_METADATA_COLUMN { FL_COLUMN_NAME = 0, FL_COLUMN_MODIFIED, FL_COLUMN_ACCESSED, FL_COLUMN_CREATED, FL_COLUMN_SIZE };
+
 using namespace std;
 
-class Fineline_File_Metadata_Browser : public Fl_Browser
+struct fl_metadata_row
+{
+   fl_file_record_t *record;        /* file row, NULL for a text row */
+   uint32_t text;                   /* text row line number */
+};
+typedef struct fl_metadata_row fl_metadata_row_t;
+
+class Fineline_File_Metadata_Browser : public Fl_Table_Row
 {
    public:
       Fineline_File_Metadata_Browser(int x, int y, int w, int h);
@@ -62,17 +81,31 @@ class Fineline_File_Metadata_Browser : public Fl_Browser
       string get_table();
       int delete_table();
       int get_record_count();
+      int size();
+      void clear();
       int save_metadata_list(const char *filename);
+      void sort_column(int column, int descending);
 
       static string format_record_as_html(fl_file_record_t *flec);
       static string format_record_as_xml(fl_file_record_t *flec);
 
    protected:
+
+      void draw();
+      void draw_cell(TableContext context, int R = 0, int C = 0, int X = 0, int Y = 0, int W = 0, int H = 0);
+
    private:
 
-      int get_long_time_strings(fl_file_record_t *flec);
+      static void table_callback(Fl_Widget *w, void *p);
+      string format_cell(const fl_metadata_row_t *row, int column);
+      string get_time_string(int64_t file_time);
 
+      vector< fl_metadata_row_t > row_list;  /* rows in the order they were added */
+      vector< uint32_t > row_order;          /* row_list positions in display order */
+      vector< string > text_list;
       vector< fl_file_record_t* > file_list;
+      int sorted_column;                     /* -1 if the rows are in the order they were added */
+      int sort_descending;
 };
 
 #endif // FINELINE_FILE_METADATA_BROWSER_H
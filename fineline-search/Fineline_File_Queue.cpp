@@ -0,0 +1,161 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_File_Queue.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Lock-free single producer/single consumer ring buffer of file
+            records. The producer owns the tail index and the consumer owns
+            the head index, each publishes its index with release ordering
+            and reads the other with acquire ordering.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include "Fineline_File_Queue.h"
+#include "../common/Fineline_Util.h"
+
+Fineline_File_Queue::Fineline_File_Queue(size_t queue_size)
+{
+   queue_capacity = 2;
+   while (queue_capacity < queue_size)
+      queue_capacity <<= 1;
+   queue_mask = queue_capacity - 1;
+   records = (fl_file_record_t **)Fineline_Util::xcalloc(queue_capacity * sizeof(fl_file_record_t *));
+   head.store(0);
+   tail.store(0);
+   complete.store(0);
+}
+
+Fineline_File_Queue::~Fineline_File_Queue()
+{
+   Fineline_Util::xfree((char *)records, queue_capacity * sizeof(fl_file_record_t *));
+}
+
+/*
+   Function: push
+   Purpose : Adds a file record to the tail of the queue, producer thread only.
+   Input   : File record pointer.
+   Output  : Returns 0 on success, -1 if the queue is full.
+*/
+int Fineline_File_Queue::push(fl_file_record_t *frec)
+{
+   size_t t = tail.load(memory_order_relaxed);
+
+   if (t - head.load(memory_order_acquire) >= queue_capacity)
+      return(-1);
+
+   records[t & queue_mask] = frec;
+   tail.store(t + 1, memory_order_release);
+
+   return(0);
+}
+
+/*
+   Function: push_batch
+   Purpose : Adds as many of the file records as will fit to the tail of the queue,
+             producer thread only. Several walker threads share the queue so they
+             must serialise their calls.
+   Input   : Array of file records and the number of records.
+   Output  : Returns the number of records added, 0 if the queue is full.
+*/
+size_t Fineline_File_Queue::push_batch(fl_file_record_t **batch, size_t count)
+{
+   size_t t = tail.load(memory_order_relaxed);
+   size_t space = queue_capacity - (t - head.load(memory_order_acquire));
+   size_t i;
+
+   if (count > space)
+      count = space;
+
+   for (i = 0; i < count; i++)
+      records[(t + i) & queue_mask] = batch[i];
+   tail.store(t + count, memory_order_release);
+
+   return(count);
+}
+
+/*
+   Function: pop_batch
+   Purpose : Removes up to max_records file records from the head of the queue,
+             consumer thread only.
+   Input   : Destination array and the maximum number of records to remove.
+   Output  : Returns the number of records copied into the batch.
+*/
+size_t Fineline_File_Queue::pop_batch(fl_file_record_t **batch, size_t max_records)
+{
+   size_t h = head.load(memory_order_relaxed);
+   size_t available = tail.load(memory_order_acquire) - h;
+   size_t i;
+
+   if (available > max_records)
+      available = max_records;
+
+   for (i = 0; i < available; i++)
+      batch[i] = records[(h + i) & queue_mask];
+
+   head.store(h + available, memory_order_release);
+
+   return(available);
+}
+
+size_t Fineline_File_Queue::size()
+{
+   return(tail.load(memory_order_acquire) - head.load(memory_order_acquire));
+}
+
+size_t Fineline_File_Queue::capacity()
+{
+   return(queue_capacity);
+}
+
+void Fineline_File_Queue::set_complete()
+{
+   complete.store(1, memory_order_release);
+}
+
+/*
+   Function: is_complete
+   Purpose : Checks if the producer has finished, the consumer must drain the
+             queue again after this returns 1 to collect the last records.
+   Input   : None.
+   Output  : Returns 1 if the producer has finished, 0 otherwise.
+*/
+int Fineline_File_Queue::is_complete()
+{
+   return(complete.load(memory_order_acquire));
+}
+
+/*
+   Function: reset
+   Purpose : Empties the queue for reuse, only call when neither thread is active.
+   Input   : None.
+   Output  : None.
+*/
+void Fineline_File_Queue::reset()
+{
+   head.store(0);
+   tail.store(0);
+   complete.store(0);
+}
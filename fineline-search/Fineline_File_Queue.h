@@ -0,0 +1,77 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_File_Queue.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Lock-free single producer/single consumer queue of file records.
+            The file system walker thread pushes records and the GUI thread
+            pops them in batches from a timer, so the walker never takes the
+            FLTK lock for each file.
+
+   Notes: Only one thread may push and only one thread may pop.
+
+*/
+
+#ifndef FINELINE_FILE_QUEUE_H
+#define FINELINE_FILE_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+#include "fineline-search.h"
+
+#define FL_FILE_QUEUE_SIZE      65536   /* must be a power of 2 */
+#define FL_FILE_QUEUE_BATCH     4096    /* records popped per batch */
+#define FL_FILE_QUEUE_MAX_DRAIN 16384   /* records added to the tree per timer tick */
+#define FL_FILE_QUEUE_INTERVAL  0.05    /* seconds between timer ticks */
+
+using namespace std;
+
+class Fineline_File_Queue
+{
+   public:
+      Fineline_File_Queue(size_t queue_size = FL_FILE_QUEUE_SIZE);
+      virtual ~Fineline_File_Queue();
+
+      int push(fl_file_record_t *frec);
+      size_t push_batch(fl_file_record_t **batch, size_t count);
+      size_t pop_batch(fl_file_record_t **batch, size_t max_records);
+      size_t size();
+      size_t capacity();
+      void set_complete();
+      int is_complete();
+      void reset();
+
+   protected:
+   private:
+
+      fl_file_record_t **records;
+      size_t queue_capacity;
+      size_t queue_mask;
+      atomic<size_t> head;   /* next slot to pop, written by the consumer */
+      atomic<size_t> tail;   /* next slot to push, written by the producer */
+      atomic<int> complete;  /* set by the producer when no more records will be pushed */
+};
+
+#endif // FINELINE_FILE_QUEUE_H
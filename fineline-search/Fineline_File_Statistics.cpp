@@ -0,0 +1,564 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+/*
+   Fineline_File_Statistics.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Summary statistics of the files in a forensic image.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include <thread>
+
+#include <tsk/libtsk.h>
+
+#include "Fineline_File_Statistics.h"
+#include "Fineline_File_Arena.h"
+
+static const char *mac_type_names[FL_STATS_MAC_TYPES] = { "Modified", "Accessed", "Changed", "Born" };
+
+/* Orders file records by size, the record address breaks ties so every thread split keeps the same files. */
+static bool larger_file(const fl_file_record_t *a, const fl_file_record_t *b)
+{
+   if (a->file_size != b->file_size)
+      return(a->file_size > b->file_size);
+
+   return(a < b);
+}
+
+/* Orders the rows of a report table by bytes then count. */
+template< class K > static bool larger_total(const pair< K, fl_stats_total_t > &a, const pair< K, fl_stats_total_t > &b)
+{
+   if (a.second.bytes != b.second.bytes)
+      return(a.second.bytes > b.second.bytes);
+
+   return(a.second.count > b.second.count);
+}
+
+/* Copies the largest rows of a totals table in report order. */
+template< class K > static void top_totals(const unordered_map< K, fl_stats_total_t > &totals, vector< pair< K, fl_stats_total_t > > &rows)
+{
+   size_t n;
+
+   rows.assign(totals.begin(), totals.end());
+   n = (rows.size() < FL_STATS_REPORT_ROWS) ? rows.size() : FL_STATS_REPORT_ROWS;
+   partial_sort(rows.begin(), rows.begin() + n, rows.end(), larger_total< K >);
+   rows.resize(n);
+}
+
+static void add_total(fl_stats_total_t &total, int64_t count, int64_t bytes)
+{
+   total.count += count;
+   total.bytes += bytes;
+}
+
+static void format_row(string &line, const char *name, const fl_stats_total_t &total)
+{
+   char row[FL_MAX_INPUT_STR];
+
+   snprintf(row, FL_MAX_INPUT_STR, "\t%lld\t%lld\t", (long long)total.count, (long long)total.bytes);
+   line.append(row);
+   line.append(name);
+}
+
+Fineline_File_Statistics::Fineline_File_Statistics()
+{
+   clear();
+}
+
+Fineline_File_Statistics::~Fineline_File_Statistics()
+{
+   //dtor
+}
+
+/*
+   Function: add_file
+   Purpose : Adds a file record to the statistics. Directories are only counted,
+             the sizes, extensions and owner and directory totals are for the
+             other files. Times of 0 or less are not set and are not counted.
+   Input   : File metadata record and the owner user id, FL_STATS_NO_OWNER if
+             not known.
+   Output  : None.
+*/
+void Fineline_File_Statistics::add_file(fl_file_record_t *flrec, uint32_t owner)
+{
+   int64_t mac_times[FL_STATS_MAC_TYPES];
+   string extension;
+   int i;
+
+   if (flrec->deleted)
+      deleted_count++;
+
+   mac_times[FL_STATS_MODIFIED] = flrec->modification_time;
+   mac_times[FL_STATS_ACCESSED] = flrec->access_time;
+   mac_times[FL_STATS_CHANGED] = flrec->change_time;
+   mac_times[FL_STATS_BORN] = flrec->creation_time;
+   for (i = 0; i < FL_STATS_MAC_TYPES; i++)
+   {
+      if (mac_times[i] > 0)
+         hour_counts[i][(mac_times[i] % 86400) / 3600]++;
+   }
+
+   if (flrec->file_type == TSK_FS_META_TYPE_DIR)
+   {
+      directory_count++;
+      return;
+   }
+
+   file_count++;
+   total_bytes += flrec->file_size;
+   add_total(size_classes[get_size_class(flrec->file_size)], 1, flrec->file_size);
+   if (get_extension(flrec->file_name, extension))
+      add_total(extension_totals[extension], 1, flrec->file_size);
+   if (owner != FL_STATS_NO_OWNER)
+      add_total(owner_totals[owner], 1, flrec->file_size);
+   add_total(directory_totals[flrec->parent], 1, flrec->file_size);
+   add_largest_file(flrec);
+}
+
+void Fineline_File_Statistics::add_largest_file(fl_file_record_t *flrec)
+{
+   if (largest_files.size() < FL_STATS_LARGEST_FILES)
+   {
+      largest_files.push_back(flrec);
+      push_heap(largest_files.begin(), largest_files.end(), larger_file);
+   }
+   else if (larger_file(flrec, largest_files.front()))
+   {
+      pop_heap(largest_files.begin(), largest_files.end(), larger_file);
+      largest_files.back() = flrec;
+      push_heap(largest_files.begin(), largest_files.end(), larger_file);
+   }
+}
+
+/*
+   Function: merge
+   Purpose : Adds the partial statistics of another thread or image walker.
+   Input   : The partial statistics.
+   Output  : None.
+*/
+void Fineline_File_Statistics::merge(const Fineline_File_Statistics &fstats)
+{
+   unordered_map< string, fl_stats_total_t >::const_iterator e;
+   unordered_map< uint32_t, fl_stats_total_t >::const_iterator o;
+   unordered_map< fl_file_record_t*, fl_stats_total_t >::const_iterator d;
+   size_t i;
+   int j, k;
+
+   file_count += fstats.file_count;
+   directory_count += fstats.directory_count;
+   deleted_count += fstats.deleted_count;
+   total_bytes += fstats.total_bytes;
+   for (j = 0; j < FL_STATS_SIZE_CLASSES; j++)
+      add_total(size_classes[j], fstats.size_classes[j].count, fstats.size_classes[j].bytes);
+   for (j = 0; j < FL_STATS_MAC_TYPES; j++)
+   {
+      for (k = 0; k < 24; k++)
+         hour_counts[j][k] += fstats.hour_counts[j][k];
+   }
+   for (e = fstats.extension_totals.begin(); e != fstats.extension_totals.end(); ++e)
+      add_total(extension_totals[e->first], e->second.count, e->second.bytes);
+   for (o = fstats.owner_totals.begin(); o != fstats.owner_totals.end(); ++o)
+      add_total(owner_totals[o->first], o->second.count, o->second.bytes);
+   for (d = fstats.directory_totals.begin(); d != fstats.directory_totals.end(); ++d)
+      add_total(directory_totals[d->first], d->second.count, d->second.bytes);
+   for (i = 0; i < fstats.largest_files.size(); i++)
+      add_largest_file(fstats.largest_files[i]);
+}
+
+void Fineline_File_Statistics::clear()
+{
+   file_count = 0;
+   directory_count = 0;
+   deleted_count = 0;
+   total_bytes = 0;
+   memset(size_classes, 0, sizeof(size_classes));
+   memset(hour_counts, 0, sizeof(hour_counts));
+   extension_totals.clear();
+   owner_totals.clear();
+   directory_totals.clear();
+   largest_files.clear();
+}
+
+/*
+   Function: compute_task
+   Purpose : Statistics thread, counts one range of the file index into its
+             own partial statistics.
+   Input   : File index snapshot, first and end positions and the partial statistics.
+   Output  : None.
+*/
+void Fineline_File_Statistics::compute_task(Fineline_File_Map fmap, size_t start, size_t end, Fineline_File_Statistics *fstats)
+{
+   fl_file_record_t *flrec;
+   size_t i;
+
+   for (i = start; i < end; i++)
+   {
+      flrec = fmap->get_record(i);
+      if (flrec != NULL)
+         fstats->add_file(flrec, FL_STATS_NO_OWNER);
+   }
+}
+
+/*
+   Function: compute
+   Purpose : Counts every file in a file index snapshot in one pass, the index
+             is split into one range per thread and the partial statistics of
+             the threads are merged at the end. The owners are not in the file
+             records so they are not counted.
+   Input   : File index snapshot, number of threads (0 for one per CPU core)
+             and the statistics to add to.
+   Output  : Returns the number of files counted.
+*/
+int Fineline_File_Statistics::compute(Fineline_File_Map fmap, int thread_count, Fineline_File_Statistics *fstats)
+{
+   vector< Fineline_File_Statistics > partials;
+   vector< thread > workers;
+   size_t file_count;
+   int i;
+
+   if (!fmap)
+      return(0);
+
+   file_count = fmap->size();
+   if (thread_count <= 0)
+      thread_count = (int)thread::hardware_concurrency();
+   if ((size_t)thread_count > file_count / FL_STATS_MIN_RANGE)
+      thread_count = (int)(file_count / FL_STATS_MIN_RANGE);
+   if (thread_count < 1)
+      thread_count = 1;
+
+   partials.resize(thread_count);
+   for (i = 1; i < thread_count; i++)
+   {
+      workers.push_back(thread(compute_task, fmap, (file_count / thread_count) * i,
+                               (i == thread_count - 1) ? file_count : (file_count / thread_count) * (i + 1), &partials[i]));
+   }
+   compute_task(fmap, 0, file_count / thread_count, fstats);
+   for (i = 0; i < (int)workers.size(); i++)
+   {
+      workers[i].join();
+   }
+
+   for (i = 1; i < thread_count; i++)
+   {
+      fstats->merge(partials[i]);
+   }
+
+   return((int)file_count);
+}
+
+/*
+   Function: get_size_class
+   Purpose : Gets the size distribution class of a file size.
+   Input   : File size.
+   Output  : 0 for empty files, n for sizes from 2^(n-1) to 2^n - 1, the last
+             class holds every larger size.
+*/
+int Fineline_File_Statistics::get_size_class(int64_t file_size)
+{
+   int size_class = 0;
+
+   while ((file_size > 0) && (size_class < FL_STATS_SIZE_CLASSES - 1))
+   {
+      file_size >>= 1;
+      size_class++;
+   }
+
+   return(size_class);
+}
+
+/*
+   Function: get_extension
+   Purpose : Gets the lower case extension of a file name. Names that start
+             with the only dot, e.g. ".profile", have no extension.
+   Input   : File name and the extension string to fill in.
+   Output  : Returns 1 if the file has an extension, 0 if not.
+*/
+int Fineline_File_Statistics::get_extension(const char *file_name, string &extension)
+{
+   const char *dot;
+   size_t length;
+   size_t i;
+
+   extension.clear();
+   if (file_name == NULL)
+      return(0);
+
+   dot = strrchr(file_name, '.');
+   if ((dot == NULL) || (dot == file_name))
+      return(0);
+
+   length = strlen(dot + 1);
+   if ((length == 0) || (length > FL_STATS_MAX_EXTENSION))
+      return(0);
+
+   extension.resize(length);
+   for (i = 0; i < length; i++)
+      extension[i] = (char)tolower((unsigned char)dot[i + 1]);
+
+   return(1);
+}
+
+int64_t Fineline_File_Statistics::get_file_count() const
+{
+   return(file_count);
+}
+
+int64_t Fineline_File_Statistics::get_directory_count() const
+{
+   return(directory_count);
+}
+
+int64_t Fineline_File_Statistics::get_deleted_count() const
+{
+   return(deleted_count);
+}
+
+int64_t Fineline_File_Statistics::get_total_bytes() const
+{
+   return(total_bytes);
+}
+
+fl_stats_total_t Fineline_File_Statistics::get_size_class_total(int size_class) const
+{
+   fl_stats_total_t total = { 0, 0 };
+
+   if ((size_class >= 0) && (size_class < FL_STATS_SIZE_CLASSES))
+      total = size_classes[size_class];
+
+   return(total);
+}
+
+int64_t Fineline_File_Statistics::get_hour_count(int mac_type, int hour) const
+{
+   if ((mac_type < 0) || (mac_type >= FL_STATS_MAC_TYPES) || (hour < 0) || (hour > 23))
+      return(0);
+
+   return(hour_counts[mac_type][hour]);
+}
+
+const unordered_map< string, fl_stats_total_t > &Fineline_File_Statistics::get_extension_totals() const
+{
+   return(extension_totals);
+}
+
+const unordered_map< uint32_t, fl_stats_total_t > &Fineline_File_Statistics::get_owner_totals() const
+{
+   return(owner_totals);
+}
+
+const unordered_map< fl_file_record_t*, fl_stats_total_t > &Fineline_File_Statistics::get_directory_totals() const
+{
+   return(directory_totals);
+}
+
+/*
+   Function: get_subtree_totals
+   Purpose : Adds the files of each directory to the directory and all of its
+             parents, from the directory totals rather than the file records.
+   Input   : The totals to fill in, keyed by directory record, NULL for the root.
+   Output  : None.
+*/
+void Fineline_File_Statistics::get_subtree_totals(unordered_map< fl_file_record_t*, fl_stats_total_t > &totals) const
+{
+   unordered_map< fl_file_record_t*, fl_stats_total_t >::const_iterator d;
+   fl_file_record_t *dir;
+
+   totals.clear();
+   for (d = directory_totals.begin(); d != directory_totals.end(); ++d)
+   {
+      for (dir = d->first; dir != NULL; dir = dir->parent)
+         add_total(totals[dir], d->second.count, d->second.bytes);
+      add_total(totals[NULL], d->second.count, d->second.bytes);
+   }
+}
+
+/*
+   Function: get_largest_files
+   Purpose : Gets the largest files, largest first.
+   Input   : The list to fill in.
+   Output  : None.
+*/
+void Fineline_File_Statistics::get_largest_files(vector< fl_file_record_t* > &flist) const
+{
+   flist = largest_files;
+   sort(flist.begin(), flist.end(), larger_file);
+}
+
+/*
+   Function: get_statistics_map
+   Purpose : Gets the totals as named values to save with the project.
+   Input   : None.
+   Output  : The statistic names and values.
+*/
+map< string, int64_t > Fineline_File_Statistics::get_statistics_map() const
+{
+   map< string, int64_t > statistics;
+   unordered_map< string, fl_stats_total_t >::const_iterator e;
+   unordered_map< uint32_t, fl_stats_total_t >::const_iterator o;
+   char name[FL_MAX_INPUT_STR];
+   int i, j;
+
+   statistics["files"] = file_count;
+   statistics["directories"] = directory_count;
+   statistics["deleted"] = deleted_count;
+   statistics["bytes"] = total_bytes;
+   for (i = 0; i < FL_STATS_SIZE_CLASSES; i++)
+   {
+      if (size_classes[i].count == 0)
+         continue;
+      snprintf(name, FL_MAX_INPUT_STR, "size.%02d.files", i);
+      statistics[name] = size_classes[i].count;
+      snprintf(name, FL_MAX_INPUT_STR, "size.%02d.bytes", i);
+      statistics[name] = size_classes[i].bytes;
+   }
+   for (i = 0; i < FL_STATS_MAC_TYPES; i++)
+   {
+      for (j = 0; j < 24; j++)
+      {
+         snprintf(name, FL_MAX_INPUT_STR, "hour.%s.%02d", mac_type_names[i], j);
+         statistics[name] = hour_counts[i][j];
+      }
+   }
+   for (e = extension_totals.begin(); e != extension_totals.end(); ++e)
+   {
+      statistics["extension." + e->first + ".files"] = e->second.count;
+      statistics["extension." + e->first + ".bytes"] = e->second.bytes;
+   }
+   for (o = owner_totals.begin(); o != owner_totals.end(); ++o)
+   {
+      snprintf(name, FL_MAX_INPUT_STR, "owner.%u.files", o->first);
+      statistics[name] = o->second.count;
+      snprintf(name, FL_MAX_INPUT_STR, "owner.%u.bytes", o->first);
+      statistics[name] = o->second.bytes;
+   }
+
+   return(statistics);
+}
+
+/*
+   Function: get_report
+   Purpose : Formats the statistics as tab separated report lines, the table
+             rows are count, bytes and name.
+   Input   : The line list to fill in.
+   Output  : None.
+*/
+void Fineline_File_Statistics::get_report(vector< string > &lines) const
+{
+   vector< pair< string, fl_stats_total_t > > extension_rows;
+   vector< pair< uint32_t, fl_stats_total_t > > owner_rows;
+   vector< pair< fl_file_record_t*, fl_stats_total_t > > directory_rows;
+   unordered_map< fl_file_record_t*, fl_stats_total_t > subtree_totals;
+   vector< fl_file_record_t* > flist;
+   char line[FL_MAX_INPUT_STR];
+   string row;
+   size_t i;
+   int j, k;
+
+   lines.clear();
+   snprintf(line, FL_MAX_INPUT_STR, "Files: %lld  Directories: %lld  Deleted: %lld  Bytes: %lld",
+            (long long)file_count, (long long)directory_count, (long long)deleted_count, (long long)total_bytes);
+   lines.push_back(line);
+
+   lines.push_back("");
+   lines.push_back("File Extensions\tFiles\tBytes\tExtension");
+   top_totals(extension_totals, extension_rows);
+   for (i = 0; i < extension_rows.size(); i++)
+   {
+      row.clear();
+      format_row(row, extension_rows[i].first.c_str(), extension_rows[i].second);
+      lines.push_back(row);
+   }
+
+   lines.push_back("");
+   lines.push_back("File Sizes\tFiles\tBytes\tSize");
+   for (j = 0; j < FL_STATS_SIZE_CLASSES; j++)
+   {
+      if (size_classes[j].count == 0)
+         continue;
+      if (j <= 1)
+         snprintf(line, FL_MAX_INPUT_STR, "%d", j);
+      else if (j == FL_STATS_SIZE_CLASSES - 1)
+         snprintf(line, FL_MAX_INPUT_STR, "%lld and up", 1LL << (j - 1));
+      else
+         snprintf(line, FL_MAX_INPUT_STR, "%lld - %lld", 1LL << (j - 1), (1LL << j) - 1);
+      row.clear();
+      format_row(row, line, size_classes[j]);
+      lines.push_back(row);
+   }
+
+   lines.push_back("");
+   lines.push_back("Hour (UTC)\tModified\tAccessed\tChanged\tBorn");
+   for (k = 0; k < 24; k++)
+   {
+      snprintf(line, FL_MAX_INPUT_STR, "%02d:00\t%lld\t%lld\t%lld\t%lld", k, (long long)hour_counts[FL_STATS_MODIFIED][k],
+               (long long)hour_counts[FL_STATS_ACCESSED][k], (long long)hour_counts[FL_STATS_CHANGED][k], (long long)hour_counts[FL_STATS_BORN][k]);
+      lines.push_back(line);
+   }
+
+   if (owner_totals.size() > 0)
+   {
+      lines.push_back("");
+      lines.push_back("Owners\tFiles\tBytes\tUser ID");
+      top_totals(owner_totals, owner_rows);
+      for (i = 0; i < owner_rows.size(); i++)
+      {
+         snprintf(line, FL_MAX_INPUT_STR, "%u", owner_rows[i].first);
+         row.clear();
+         format_row(row, line, owner_rows[i].second);
+         lines.push_back(row);
+      }
+   }
+
+   lines.push_back("");
+   lines.push_back("Directories\tFiles\tBytes\tDirectory (including subdirectories)");
+   get_subtree_totals(subtree_totals);
+   subtree_totals.erase(NULL); // the root total is the image total
+   top_totals(subtree_totals, directory_rows);
+   for (i = 0; i < directory_rows.size(); i++)
+   {
+      row.clear();
+      format_row(row, Fineline_File_Arena::get_full_path(directory_rows[i].first).c_str(), directory_rows[i].second);
+      lines.push_back(row);
+   }
+
+   lines.push_back("");
+   lines.push_back("Largest Files\tBytes\tFile");
+   get_largest_files(flist);
+   for (i = 0; (i < flist.size()) && (i < FL_STATS_REPORT_ROWS); i++)
+   {
+      snprintf(line, FL_MAX_INPUT_STR, "\t%lld\t", (long long)flist[i]->file_size);
+      row = line;
+      row.append(Fineline_File_Arena::get_full_path(flist[i]));
+      lines.push_back(row);
+   }
+}
@@ -0,0 +1,124 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+/*
+   Fineline_File_Statistics.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Summary statistics of the files in a forensic image, the counts
+            and bytes per file extension, owner and directory, the file size
+            distribution, the hour of day of the MAC times and the largest
+            files. Every directory worker adds its files to its own partial
+            statistics during the image walk and merges them into the image
+            totals as it goes, so the statistics are complete when the walk
+            completes without reading the records again. compute() does the
+            same over a file index snapshot for cases loaded from a snapshot.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#ifndef FINELINE_FILE_STATISTICS_H
+#define FINELINE_FILE_STATISTICS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fineline-search.h"
+#include "Fineline_File_Index.h"
+
+#define FL_STATS_SIZE_CLASSES    41          /* empty files then one class per power of 2, the last holds 512GB and up */
+#define FL_STATS_LARGEST_FILES   100         /* largest files kept */
+#define FL_STATS_MAX_EXTENSION   16          /* longer extensions are not counted as extensions */
+#define FL_STATS_MIN_RANGE       65536       /* smallest block of the file index counted by its own thread */
+#define FL_STATS_NO_OWNER        0xFFFFFFFF  /* owner not known, e.g. records from a $MFT scan */
+#define FL_STATS_REPORT_ROWS     20          /* rows in each table of the report */
+
+#define FL_STATS_MODIFIED        0
+#define FL_STATS_ACCESSED        1
+#define FL_STATS_CHANGED         2
+#define FL_STATS_BORN            3
+#define FL_STATS_MAC_TYPES       4
+
+using namespace std;
+
+struct fl_stats_total
+{
+   int64_t count;
+   int64_t bytes;
+};
+typedef struct fl_stats_total fl_stats_total_t;
+
+class Fineline_File_Statistics
+{
+   public:
+      Fineline_File_Statistics();
+      virtual ~Fineline_File_Statistics();
+
+      void add_file(fl_file_record_t *flrec, uint32_t owner);
+      void merge(const Fineline_File_Statistics &fstats);
+      void clear();
+
+      int64_t get_file_count() const;
+      int64_t get_directory_count() const;
+      int64_t get_deleted_count() const;
+      int64_t get_total_bytes() const;
+      fl_stats_total_t get_size_class_total(int size_class) const;
+      int64_t get_hour_count(int mac_type, int hour) const;
+      const unordered_map< string, fl_stats_total_t > &get_extension_totals() const;
+      const unordered_map< uint32_t, fl_stats_total_t > &get_owner_totals() const;
+      const unordered_map< fl_file_record_t*, fl_stats_total_t > &get_directory_totals() const;
+      void get_subtree_totals(unordered_map< fl_file_record_t*, fl_stats_total_t > &totals) const;
+      void get_largest_files(vector< fl_file_record_t* > &flist) const;
+      map< string, int64_t > get_statistics_map() const;
+      void get_report(vector< string > &lines) const;
+
+      static int compute(Fineline_File_Map fmap, int thread_count, Fineline_File_Statistics *fstats);
+      static int get_size_class(int64_t file_size);
+      static int get_extension(const char *file_name, string &extension);
+
+   protected:
+   private:
+
+      void add_largest_file(fl_file_record_t *flrec);
+      static void compute_task(Fineline_File_Map fmap, size_t start, size_t end, Fineline_File_Statistics *fstats);
+
+      int64_t file_count;                /* everything that is not a directory */
+      int64_t directory_count;
+      int64_t deleted_count;
+      int64_t total_bytes;
+      fl_stats_total_t size_classes[FL_STATS_SIZE_CLASSES];
+      int64_t hour_counts[FL_STATS_MAC_TYPES][24];   /* UTC hour of day of each MAC time */
+      unordered_map< string, fl_stats_total_t > extension_totals;
+      unordered_map< uint32_t, fl_stats_total_t > owner_totals;
+      unordered_map< fl_file_record_t*, fl_stats_total_t > directory_totals;  /* files directly in each directory, NULL for the root */
+      vector< fl_file_record_t* > largest_files;      /* min heap, the smallest of the largest files first */
+};
+
+#endif // FINELINE_FILE_STATISTICS_H
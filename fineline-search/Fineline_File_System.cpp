@@ -30,7 +30,9 @@
             The process consists of:
             open image -> analyse volume system -> analyse file system -> analyse directory -> analyse file
 
-            The process can be run in a thread if the forensic image is very large.
+            The process can be run in a thread if the forensic image is very large,
+            the file systems in a multi-volume image are then walked at the same time
+            on their own threads.
 
    Notes: EXPERIMENTAL
 
@@ -40,6 +42,10 @@
 #include <stdlib.h>
 #include <sys/types.h>
 #include <errno.h>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <mutex>
 
 
 #ifdef LINUX_BUILD
@@ -52,8 +58,13 @@
 
 #include "fineline-search.h"
 #include "Fineline_File_System.h"
+#include "Fineline_File_Queue.h"
+#include "Fineline_File_Arena.h"
+#include "Fineline_File_Exporter.h"
+#include "Fineline_Mft_Scanner.h"
+#include "Fineline_Block_Cache.h"
+#include "Fineline_Case_Snapshot.h"
 #include "../common/Fineline_Util.h"
-#include "../common/threads.h"
 
 #ifdef LINUX_BUILD
 #include <unistd.h>
@@ -71,10 +82,32 @@ TskImgInfo *image_info = NULL;                 // Store the forensic image syste
 vector< TskFsInfo * > file_system_list; // List of file systems in the forensic image
 
 int running = 0;
-long directory_count = 0;
+static atomic<int> cancel_walk(0); // Set by stop_task(), the walker threads stop and their unqueued records are dropped
+long directory_count = 0; // Totals for the image, each walker thread keeps its own counts
 long file_count = 0;
-int file_system_number = 0;
-char file_system_label[256];
+
+static Fineline_File_Queue *file_queue = NULL; // Walker threads -> GUI thread file records, NULL when not threaded
+static mutex file_queue_lock;                  // Serialises the walker threads pushing to the file queue
+static Fineline_File_Arena *file_arena = NULL; // File metadata records and strings for the current image
+static int mft_scan = 1;                       // List NTFS file systems with a sequential $MFT scan
+static string snapshot_file_name;              // Case snapshot written when the walk completes, empty for none
+
+/* Image handle opened with open_image(), the image reads go through the block cache. */
+struct fl_cached_image
+{
+   TSK_IMG_INFO *tsk_image;
+   TskImgInfo *image_handle;
+   ssize_t (*tsk_read)(TSK_IMG_INFO *img, TSK_OFF_T off, char *buf, size_t len); // the image reader's own read function
+   int image_id;                       // handles on the same image file share the cached pages
+   fl_cache_stream_t stream;
+};
+typedef struct fl_cached_image fl_cached_image_t;
+
+static Fineline_Block_Cache block_cache;                 // Image pages shared by every image handle
+static mutex cached_image_lock;
+static vector< fl_cached_image_t* > cached_images;       // Open image handles
+static unordered_map< string, int > cached_image_ids;    // Image file path -> cache image id
+static atomic<unsigned int> cached_image_generation(0);  // Changed when a handle is closed
 
 /* Static C callback functions for the TSK library calls */
 
@@ -116,46 +149,278 @@ static void check_path_separators(TskFsInfo *fs_info, string full_path)
 }
 */
 
+/*
+   Function: find_cached_image
+   Purpose : Finds the open handle for a TSK image, the last handle found by a
+             thread is remembered so the list lock is only taken when the thread
+             changes handle or a handle has been closed.
+   Input   : TSK image.
+   Output  : The cached image handle, NULL if the image was not opened with open_image().
+*/
+static fl_cached_image_t *find_cached_image(TSK_IMG_INFO *img)
+{
+   static thread_local TSK_IMG_INFO *last_image = NULL;
+   static thread_local fl_cached_image_t *last_cached = NULL;
+   static thread_local unsigned int last_generation = 0;
+   unsigned int generation = cached_image_generation.load();
+   size_t i;
+
+   if ((img == last_image) && (generation == last_generation))
+      return(last_cached);
+
+   lock_guard<mutex> guard(cached_image_lock);
+
+   last_image = img;
+   last_cached = NULL;
+   last_generation = generation;
+   for (i = 0; i < cached_images.size(); i++)
+   {
+      if (cached_images[i]->tsk_image == img)
+      {
+         last_cached = cached_images[i];
+         break;
+      }
+   }
+
+   return(last_cached);
+}
+
+/*
+   Function: read_image_data
+   Purpose : Block cache reader, reads from the image with the image reader's own
+             read function. Readahead can ask for data past the end of the image.
+   Input   : Cached image handle, image offset, buffer and length.
+   Output  : Returns the bytes read, 0 at the end of the image, -1 on error.
+*/
+static ssize_t read_image_data(void *context, int64_t offset, char *buffer, size_t length)
+{
+   fl_cached_image_t *cached = (fl_cached_image_t *)context;
+   TSK_OFF_T image_size = cached->tsk_image->size;
+
+   if (offset >= image_size)
+      return(0);
+   if ((TSK_OFF_T)length > image_size - offset)
+      length = (size_t)(image_size - offset);
+
+   return(cached->tsk_read(cached->tsk_image, (TSK_OFF_T)offset, buffer, length));
+}
+
+/*
+   Function: cached_image_read
+   Purpose : Replaces the read function of an image opened with open_image(), TSK
+             calls it for the reads its own small cache cannot serve.
+   Input   : TSK image, image offset, buffer and length.
+   Output  : Returns the bytes read, -1 on error.
+*/
+static ssize_t cached_image_read(TSK_IMG_INFO *img, TSK_OFF_T off, char *buf, size_t len)
+{
+   fl_cached_image_t *cached = find_cached_image(img);
+
+   if (cached == NULL)
+      return(-1);
+
+   return(block_cache.read(cached->image_id, &cached->stream, read_image_data, (void *)cached, (int64_t)off, buf, len));
+}
+
+/*
+   Function: flush_walker_records
+   Purpose : Passes the records a walker thread has collected to the GUI thread
+             through the file queue. If the GUI falls behind then wait for it to
+             drain the queue, unless the walk has been cancelled.
+   Input   : The directory worker.
+   Output  : None.
+*/
+static void flush_walker_records(fl_dir_worker_t *worker)
+{
+   size_t pushed = 0;
+
+   if (worker->pending.size() == 0)
+      return;
+
+   lock_guard<mutex> guard(file_queue_lock);
+
+   while (pushed < worker->pending.size())
+   {
+      pushed += file_queue->push_batch(&worker->pending[pushed], worker->pending.size() - pushed);
+      if (pushed < worker->pending.size())
+      {
+         if (cancel_walk.load() != 0)
+            break;
+         FINELINE_SLEEP(1);
+      }
+   }
+   worker->pending.clear();
+
+   return;
+}
+
+/*
+   Function: flush_walker_statistics
+   Purpose : Merges the statistics a walker thread has collected into the image
+             statistics, so the totals are up to date during the walk and
+             complete when it finishes.
+   Input   : The directory worker.
+   Output  : None.
+*/
+static void flush_walker_statistics(fl_dir_worker_t *worker)
+{
+   worker->walker->file_system->merge_file_statistics(worker->statistics);
+   worker->statistics.clear();
+
+   return;
+}
+
 /*
    Function: process_file
    Purpose : Called from the process_directory_callback for each file in a directory to
              get the file metadata. Then the file metadata record is added to the
              GUI file system tree.
-   Input   : file pointer, file name and file path.
-   Output  : Always returns 0 to ensure all files are processed.
+   Input   : file pointer, file name and the directory worker listing its directory.
+   Output  : Returns the new file record.
 */
-static uint8_t process_file(TskFsFile *fs_file, string filename, string path)
+static fl_file_record_t *process_file(TskFsFile *fs_file, string filename, fl_dir_worker_t *worker)
 {
-   fl_file_record_t *frec = (fl_file_record_t *)Fineline_Util::xcalloc(sizeof(fl_file_record_t));
+   fl_file_record_t *frec = file_arena->new_record(&worker->arena_cursor);
    TskFsMeta *fs_meta = fs_file->getMeta();
 
-   strncpy(frec->file_name, filename.c_str(), filename.size());
-   strncpy(frec->file_path, path.c_str(), path.size());
-   strncpy(frec->full_path, file_system_label, strlen(file_system_label));  // The full path includes the file system label since
-   strncat(frec->full_path, path.c_str(), path.size()); // a multi-volume image will contain multiple file systems.
-   strncat(frec->full_path, filename.c_str(), filename.size());
+   // Only the file name is stored, the path is rebuilt from the parent directory
+   // records. A directory is always listed after its record is created.
+
+   file_arena->set_file_name(frec, filename);
+   frec->parent = worker->current.record;
 
-   frec->id = file_count++;
+   worker->file_count++;
    frec->marked = 0;
    frec->hidden = 0;
-   frec->file_size = (long)fs_meta->getSize();
-   frec->access_time = (long)fs_meta->getATime();
-   frec->creation_time = (long)fs_meta->getCrTime();
-   frec->modification_time = (long)fs_meta->getMTime();
+   frec->meta_address = (uint64_t)fs_meta->getAddr();
+   if (fs_meta->getType() == TSK_FS_META_TYPE_REG)
+   {
+      // Keep the default data attribute so the content is read without
+      // searching the attribute list, e.g. for NTFS files with named streams.
+      const TskFsAttribute *fs_attr = fs_file->getAttrDefault();
+      if (fs_attr != NULL)
+      {
+         frec->attribute_type = (uint16_t)fs_attr->getType();
+         frec->attribute_id = fs_attr->getId();
+         delete fs_attr;
+      }
+   }
+   frec->file_size = (int64_t)fs_meta->getSize();
+   frec->access_time = (int64_t)fs_meta->getATime();
+   frec->creation_time = (int64_t)fs_meta->getCrTime();
+   frec->modification_time = (int64_t)fs_meta->getMTime();
+   frec->change_time = (int64_t)fs_meta->getCTime();
+   frec->deleted = (fs_meta->getFlags() & TSK_FS_META_FLAG_UNALLOC) ? 1 : 0;
    frec->file_type = (int)fs_meta->getType();
-   frec->file_system_id = file_system_number;
+   frec->file_system_id = worker->walker->file_system_id; // a multi-volume image will contain multiple file systems.
+
+   worker->statistics.add_file(frec, (uint32_t)fs_meta->getUid());
+   if (worker->statistics.get_file_count() + worker->statistics.get_directory_count() >= FL_WALK_STATS_BATCH)
+      flush_walker_statistics(worker);
 
    if (DEBUG)
-      printf("Fineline_File_System::process_file() <INFO> file name: %s\n", frec->full_path);
+      printf("Fineline_File_System::process_file() <INFO> file name: %s\n", Fineline_File_Arena::get_full_path(frec).c_str());
 
-   Fl::lock();
+   if (file_queue != NULL)
+   {
+      // Threaded walk, the GUI thread adds the records to the tree in batches.
+      worker->pending.push_back(frec);
+      if (worker->pending.size() >= FL_WALK_PUSH_BATCH)
+         flush_walker_records(worker);
+   }
+   else
+   {
+      Fl::lock();
+      file_system_tree->add_file(Fineline_File_Arena::get_full_path(frec), frec);
+      Fl::unlock();
+   }
 
-   file_system_tree->add_file(frec->full_path, frec);
+   return(frec);
+}
 
-   Fl::awake(); //TODO: is this necessary?
-   Fl::unlock();
 
-   return(0);
+/*
+   Function: save_snapshot_task
+   Purpose : Writes the case snapshot in a background thread, the file index
+             snapshot is not changed while it is held.
+   Input   : Snapshot file name, file index snapshot, image path and the
+             file system offsets.
+   Output  : None.
+*/
+static void save_snapshot_task(string filename, Fineline_File_Map fmap, string image_name, vector<int64_t> offsets)
+{
+   if (Fineline_Case_Snapshot::save_snapshot(filename.c_str(), fmap, image_name, offsets) == 0)
+      Fineline_Log::print_log_entry("save_snapshot_task() <INFO> Saved the case snapshot.\n");
+}
+
+/*
+   Function: drain_file_queue
+   Purpose : FLTK timer callback on the GUI thread. Adds the file records queued by the
+             walker thread to the file system tree in large batches with one progress
+             message per batch. When the walker has finished and the queue is empty the
+             tree is rebuilt and the timer stops, a cancelled walk is not rebuilt.
+   Input   : Pointer to the file system object.
+   Output  : None.
+*/
+static void drain_file_queue(void *p)
+{
+   Fineline_File_System *file_system_image = (Fineline_File_System *)p;
+   Fineline_File_Queue *fq = file_queue;
+   fl_file_record_t *batch[FL_FILE_QUEUE_BATCH];
+   fl_file_record_t *last_directory = NULL;
+   size_t record_count = 0;
+   size_t n, i;
+   int walk_complete = fq->is_complete(); // read before draining so no records are missed
+   string msg;
+
+   while ((record_count < FL_FILE_QUEUE_MAX_DRAIN) && ((n = fq->pop_batch(batch, FL_FILE_QUEUE_BATCH)) > 0))
+   {
+      for (i = 0; i < n; i++)
+      {
+         file_system_tree->add_file(Fineline_File_Arena::get_full_path(batch[i]), batch[i]);
+         if (batch[i]->file_type == TSK_FS_META_TYPE_DIR)
+            last_directory = batch[i];
+      }
+      record_count += n;
+   }
+
+   if (last_directory != NULL)
+   {
+      msg = "Processing directory: ";
+      msg.append(Fineline_File_Arena::get_full_path(last_directory));
+      progress_dialog->add_progress_message(msg);
+   }
+   if (record_count > 0)
+      file_system_tree->redraw();
+
+   if (walk_complete && (fq->size() == 0) && (cancel_walk.load() != 0))
+   {
+      msg = "Cancelled processing the forensic image.";
+      progress_dialog->add_progress_message(msg);
+      running = 0;
+      return;
+   }
+   if (walk_complete && (fq->size() == 0))
+   {
+      file_system_tree->rebuild_tree();
+      file_system_tree->build_search_index();
+      if (snapshot_file_name.size() > 0)
+         file_system_image->start_snapshot_task(snapshot_file_name, file_system_tree->get_file_map());
+
+      msg = "-----------------------------------------------------------------------------------";
+      progress_dialog->add_progress_message(msg);
+      msg = "Completed rebuilding file system tree.";
+      progress_dialog->add_progress_message(msg);
+      msg = "-----------------------------------------------------------------------------------";
+      progress_dialog->add_progress_message(msg);
+
+      running = 0;
+      return;
+   }
+
+   Fl::repeat_timeout(FL_FILE_QUEUE_INTERVAL, drain_file_queue, p);
+
+   return;
 }
 
 
@@ -163,24 +428,28 @@ static uint8_t process_file(TskFsFile *fs_file, string filename, string path)
    Function: process_directory_callback
    Purpose : Called from the directory walker for each file in a directory, updates
              the progress dialog and calls process_file to get the file metadata.
-   Input   : file pointer and file path.
+             Subdirectories are queued on the worker so they can be listed by any
+             directory worker.
+   Input   : file pointer, file path and the directory worker.
    Output  : Always returns TSK_WALK_CONT to ensure all files are processed.
 */
 static TSK_WALK_RET_ENUM process_directory_callback(TskFsFile *fs_file, const char *path, void *ptr)
 {
-
-   /* TODO: Ignore winsxs System backup files */
-   //if ((TSK_FS_TYPE_ISNTFS(fs_file->getFsInfo()->getFsType())) && (strstr(path, "winsxs") != NULL))
-   //{
-   //   return TSK_WALK_CONT;
-   //}
+   fl_dir_worker_t *worker = (fl_dir_worker_t *)ptr;
+   fl_fs_walker_t *walker = worker->walker;
+   fl_file_record_t *frec;
+   fl_dir_task_t task;
+   int queue_directory = 0;
 
    /* If the name has corresponding metadata, then walk it */
    string filename;
-   string fullpath;
    string msg;
    TskFsMeta *fs_meta = fs_file->getMeta();
 
+   if (cancel_walk.load() != 0)
+   {
+      return(TSK_WALK_STOP);
+   }
    if (fs_meta == NULL)
    {
       return(TSK_WALK_CONT);
@@ -194,62 +463,453 @@ static TSK_WALK_RET_ENUM process_directory_callback(TskFsFile *fs_file, const ch
       {
          return(TSK_WALK_CONT);
       }
-      msg.append("Processing directory: ");
-      msg.append(path);
-      msg.append(filename);
-      put_progress_message(msg);
-      directory_count++;
+      worker->directory_count++;
+
+      walker->visited_lock.lock();
+      queue_directory = walker->visited.insert((uint64_t)fs_meta->getAddr()).second;
+      walker->visited_lock.unlock();
+   }
+   frec = process_file(fs_file, filename, worker);
+
+   if (queue_directory)
+   {
+      if (file_queue == NULL) // the queue drain reports progress for threaded walks
+      {
+         msg.append("Processing directory: ");
+         msg.append(Fineline_File_Arena::get_full_path(frec));
+         put_progress_message(msg);
+      }
+      // Count the task before it is visible so the walk cannot end early.
+      task.meta_address = (uint64_t)fs_meta->getAddr();
+      task.record = frec;
+      walker->open_tasks++;
+      worker->task_lock.lock();
+      worker->tasks.push_back(task);
+      worker->task_lock.unlock();
    }
-   fullpath.append(path);
-   process_file(fs_file, filename, fullpath);
 
    return(TSK_WALK_CONT);
 }
 
 
 /*
-   Function: process_file_system
-   Purpose : Called from the volume walker to process each file system. Does a directory
-             walk through the file system and calls process_directory callback for each
-             directory found.
-   Input   : Forensic image info and offset = 0 for this application.
+   Function: get_directory_task
+   Purpose : Takes the next directory for a worker, the most recent directory from
+             its own queue so the walk stays depth first, or failing that the oldest
+             directory from another worker, which is the root of the largest
+             unlisted subtree.
+   Input   : The directory worker and the task to fill in.
+   Output  : Returns 1 if a task was found, 0 if all the queues are empty.
+*/
+static int get_directory_task(fl_dir_worker_t *worker, fl_dir_task_t *task)
+{
+   fl_fs_walker_t *walker = worker->walker;
+   fl_dir_worker_t *victim;
+   size_t i;
+
+   worker->task_lock.lock();
+   if (worker->tasks.size() > 0)
+   {
+      *task = worker->tasks.back();
+      worker->tasks.pop_back();
+      worker->task_lock.unlock();
+      return(1);
+   }
+   worker->task_lock.unlock();
+
+   for (i = 0; i < walker->workers.size(); i++)
+   {
+      victim = walker->workers[i];
+      if (victim == worker)
+         continue;
+
+      victim->task_lock.lock();
+      if (victim->tasks.size() > 0)
+      {
+         *task = victim->tasks.front();
+         victim->tasks.pop_front();
+         victim->task_lock.unlock();
+         return(1);
+      }
+      victim->task_lock.unlock();
+   }
+
+   return(0);
+}
+
+
+/*
+   Function: directory_walk_task
+   Purpose : Directory worker thread, lists one directory at a time until every
+             directory in the file system has been listed or the walk is
+             cancelled. Each worker has its own
+             file system handle on the walker image handle, except the worker that
+             is given the shared file system handle.
+   Input   : The directory worker, the image handle and the shared file system
+             handle or NULL.
+   Output  : None.
+*/
+static void directory_walk_task(fl_dir_worker_t *worker, TskImgInfo *img_info, TskFsInfo *shared_fs)
+{
+   fl_fs_walker_t *walker = worker->walker;
+   TskFsInfo *fs_info = shared_fs;
+   char msg[256];
+
+   if (fs_info == NULL)
+   {
+      fs_info = new TskFsInfo();
+      if (fs_info->open(img_info, walker->offset, TSK_FS_TYPE_DETECT))
+      {
+         flog->print_log_entry("directory_walk_task() <ERROR> Could not open file system.\n");
+         tsk_error_reset();
+         delete fs_info;
+         return;
+      }
+   }
+
+   while ((walker->open_tasks.load() > 0) && (cancel_walk.load() == 0))
+   {
+      if (get_directory_task(worker, &worker->current) == 0)
+      {
+         // The other workers are still listing directories that may contain subdirectories.
+         FINELINE_SLEEP(1);
+         continue;
+      }
+
+      if (fs_info->dirWalk((TSK_INUM_T)worker->current.meta_address, TSK_FS_DIR_WALK_FLAG_NONE, process_directory_callback, (void *)worker))
+      {
+         if (worker->current.record == NULL)
+         {
+            progress_message("<ERROR> Could not walk file system.");
+            walker->status = -1;
+         }
+         else
+         {
+            sprintf(msg, "directory_walk_task() <ERROR> Could not list directory at metadata address %llu\n", (unsigned long long)worker->current.meta_address);
+            flog->print_log_entry(msg);
+         }
+         tsk_error_reset();
+      }
+      walker->open_tasks--;
+   }
+
+   if (file_queue != NULL)
+      flush_walker_records(worker);
+   flush_walker_statistics(worker);
+
+   if (fs_info != shared_fs)
+      delete fs_info;
+
+   return;
+}
+
+
+/*
+   Function: walk_directories
+   Purpose : Walks through one file system with a pool of directory workers. The
+             root directory is queued on the first worker, each directory listed
+             queues its subdirectories on the worker that listed it and idle
+             workers steal the top level subtrees from the others.
+   Input   : The image handle, the file system handle to walk and the file system walker.
+   Output  : None.
+*/
+static void walk_directories(TskImgInfo *img_info, TskFsInfo *fs_info, fl_fs_walker_t *walker)
+{
+   vector< thread > threads;
+   fl_dir_worker_t *worker;
+   fl_dir_task_t root;
+   int i;
+
+   for (i = 0; i < walker->thread_count; i++)
+   {
+      worker = new fl_dir_worker_t();
+      worker->walker = walker;
+      worker->current.meta_address = 0;
+      worker->current.record = NULL;
+      worker->directory_count = 0;
+      worker->file_count = 0;
+      worker->arena_cursor.block_next = NULL;
+      worker->arena_cursor.block_remaining = 0;
+      walker->workers.push_back(worker);
+   }
+
+   root.meta_address = (uint64_t)fs_info->getRootINum();
+   root.record = NULL;
+   walker->visited.insert(root.meta_address);
+   walker->open_tasks = 1;
+   walker->workers[0]->tasks.push_back(root);
+
+   for (i = 1; i < walker->thread_count; i++)
+      threads.push_back(thread(directory_walk_task, walker->workers[i], img_info, (TskFsInfo *)NULL));
+
+   directory_walk_task(walker->workers[0], img_info, fs_info);
+
+   for (i = 0; i < (int)threads.size(); i++)
+      threads[i].join();
+
+   for (i = 0; i < (int)walker->workers.size(); i++)
+   {
+      walker->directory_count += walker->workers[i]->directory_count;
+      walker->file_count += walker->workers[i]->file_count;
+      delete walker->workers[i];
+   }
+   walker->workers.clear();
+   walker->visited.clear();
+
+   return;
+}
+
+
+/*
+   Function: scan_master_file_table
+   Purpose : Lists an NTFS file system by reading the $MFT in order instead of
+             walking the directories, which also finds the deleted files that
+             still have their MFT entry. The $FILE_NAME times are added to the
+             MAC timeline event list.
+   Input   : The NTFS file system handle and the file system walker.
+   Output  : Returns -1 if the $MFT could not be read, 0 if success.
+*/
+static int scan_master_file_table(TskFsInfo *fs_info, fl_fs_walker_t *walker)
+{
+   Fineline_Mft_Scanner mft_scanner(file_arena, walker->file_system_id);
+   fl_dir_worker_t worker;
+   string msg;
+   char number_str[256];
+   size_t i;
+
+   msg = "Scanning the $MFT of file system ";
+   msg.append(Fineline_Util::xitoa(walker->file_system_id, number_str, 256, 10));
+   put_progress_message(msg);
+
+   mft_scanner.set_cancel_flag(&cancel_walk);
+   if (mft_scanner.scan(fs_info) <= 0)
+      return(-1);
+
+   const vector<fl_file_record_t *> &records = mft_scanner.get_records();
+
+   worker.walker = walker;
+   for (i = 0; (i < records.size()) && (cancel_walk.load() == 0); i++)
+   {
+      worker.statistics.add_file(records[i], FL_STATS_NO_OWNER);
+      if (worker.statistics.get_file_count() + worker.statistics.get_directory_count() >= FL_WALK_STATS_BATCH)
+         flush_walker_statistics(&worker);
+      if (file_queue != NULL)
+      {
+         worker.pending.push_back(records[i]);
+         if (worker.pending.size() >= FL_WALK_PUSH_BATCH)
+            flush_walker_records(&worker);
+      }
+      else
+      {
+         Fl::lock();
+         file_system_tree->add_file(Fineline_File_Arena::get_full_path(records[i]), records[i]);
+         Fl::unlock();
+      }
+   }
+   if (file_queue != NULL)
+      flush_walker_records(&worker);
+   flush_walker_statistics(&worker);
+
+   walker->directory_count = mft_scanner.get_directory_count();
+   walker->file_count = mft_scanner.get_file_count();
+
+   walker->file_system->add_mac_events(mft_scanner.get_mac_events());
+
+   msg = "Found ";
+   msg.append(Fineline_Util::xitoa(mft_scanner.get_deleted_count(), number_str, 256, 10));
+   msg.append(" deleted files in the $MFT.");
+   put_progress_message(msg);
+
+   return(0);
+}
+
+
+/*
+   Function: walk_file_system
+   Purpose : Walks through one file system, NTFS file systems are listed with a
+             $MFT scan unless it is turned off or fails, all others with the
+             directory workers. Then reports the walker counts.
+   Input   : The image handle, the file system handle to walk and the file system walker.
    Output  : Returns -1 on error, 0 if success.
 */
-static uint8_t process_file_system(TskImgInfo * img_info, TSK_OFF_T start)
+static int walk_file_system(TskImgInfo *img_info, TskFsInfo *fs_info, fl_fs_walker_t *walker)
 {
-   TskFsInfo *fs_info = new TskFsInfo();
    string msg;
    char number_str[256];
 
-    /* Try it as a file system */
-   if (fs_info->open(img_info, start, TSK_FS_TYPE_DETECT))
+   if ((mft_scan == 0) || (!TSK_FS_TYPE_ISNTFS(fs_info->getFsType())) || (scan_master_file_table(fs_info, walker) == -1))
    {
-      progress_message("<ERROR> Opening file system.");
-      return(-1);
+      if (cancel_walk.load() == 0)
+         walk_directories(img_info, fs_info, walker);
    }
-   else
+
+   msg = "-----------------------------------------------------------------------------------";
+   put_progress_message(msg);
+   msg = "File system ";
+   msg.append(Fineline_Util::xitoa(walker->file_system_id, number_str, 256, 10));
+   msg.append(": processed ");
+   msg.append(Fineline_Util::xitoa(walker->directory_count, number_str, 256, 10));
+   msg.append(" directories and ");
+   msg.append(Fineline_Util::xitoa(walker->file_count, number_str, 256, 10));
+   msg.append(" files.\n");
+   put_progress_message(msg);
+
+   Fl::awake();
+
+   return(walker->status);
+}
+
+
+/*
+   Function: file_system_walk_task
+   Purpose : Walker thread, takes the next file system from the walker list until
+             all of them have been walked or the walk is cancelled. TSK handles are not thread safe so each
+             thread opens its own image and file system handles, except the thread
+             that is given the shared image handle, which walks the shared file
+             system handles.
+   Input   : Image path, walker list, next walker index and the shared image
+             handle or NULL.
+   Output  : None.
+*/
+static void file_system_walk_task(const string *image_path, vector< fl_fs_walker_t* > *walkers, atomic<size_t> *next_walker, TskImgInfo *shared_image)
+{
+   TskImgInfo *img_info = shared_image;
+   TskFsInfo *fs_info;
+   fl_fs_walker_t *walker;
+   size_t i;
+
+   if (img_info == NULL)
    {
-      /* Create the file system label then walk the directory structure, starting at the root directory */
-      memset((void *)file_system_label, 0, 256);
-      memset((void *)number_str, 0, 256);
-      file_system_number++;
-      Fineline_Util::xitoa(file_system_number, number_str, 256, 10);
-      strncpy(file_system_label, "FS", 2);
-      strncat(file_system_label, number_str, strlen(number_str));
-      strncat(file_system_label, "/", 1);
+      img_info = Fineline_File_System::open_image(*image_path);
+      if (img_info == NULL)
+      {
+         flog->print_log_entry("file_system_walk_task() <ERROR> Could not open image file.\n");
+         return;
+      }
+   }
 
+   while ((cancel_walk.load() == 0) && ((i = next_walker->fetch_add(1)) < walkers->size()))
+   {
+      walker = (*walkers)[i];
+      if (img_info == shared_image)
+      {
+         walk_file_system(img_info, walker->fs_info, walker);
+         continue;
+      }
 
-      if (fs_info->dirWalk(fs_info->getRootINum(), (TSK_FS_DIR_WALK_FLAG_ENUM) (TSK_FS_DIR_WALK_FLAG_RECURSE), process_directory_callback, NULL))
+      fs_info = new TskFsInfo();
+      if (fs_info->open(img_info, walker->offset, TSK_FS_TYPE_DETECT))
       {
-         progress_message("<ERROR> Could not walk file system.");
-         return(-1);
+         progress_message("<ERROR> Opening file system.");
+         walker->status = -1;
       }
+      else
+      {
+         walk_file_system(img_info, fs_info, walker);
+      }
+      delete fs_info;
+   }
+
+   if (img_info != shared_image)
+      Fineline_File_System::close_image(img_info);
+
+   return;
+}
+
+
+/*
+   Function: process_file_systems
+   Purpose : Opens the file system at each offset and walks all of them at once,
+             one walker thread per file system up to the number of CPU cores,
+             the rest of the cores are directory workers within each file system.
+             Each walker keeps its own counts and passes its records to the shared
+             file queue, the totals are summed when all the walks have finished.
+   Input   : File system object, forensic image info and the candidate file system offsets.
+   Output  : Returns -1 if no file system could be walked, 0 if success.
+*/
+static int process_file_systems(Fineline_File_System *image, TskImgInfo *img_info, const vector<TSK_OFF_T> &offsets, const string &image_path)
+{
+   vector< fl_fs_walker_t* > walkers;
+   vector< thread > workers;
+   atomic<size_t> next_walker(0);
+   fl_fs_walker_t *walker;
+   TskFsInfo *fs_info;
+   string msg;
+   char number_str[256];
+   size_t thread_count;
+   size_t core_count;
+   size_t i;
+   int ret_val = -1;
 
+   // Detect the file systems first so the file system ids follow the partition order.
+   for (i = 0; i < offsets.size(); i++)
+   {
+      fs_info = new TskFsInfo();
+      if (fs_info->open(img_info, offsets[i], TSK_FS_TYPE_DETECT))
+      {
+         // The error could just be because we looked into an unallocated volume.
+         progress_message("<ERROR> Opening file system.");
+         tsk_error_reset();
+         delete fs_info;
+         continue;
+      }
+
+      // Save the file system info in a vector for later file viewing/extraction by the user.
+      file_system_list.push_back(fs_info);
+
+      walker = new fl_fs_walker_t();
+      walker->file_system = image;
+      walker->file_system_id = (int)file_system_list.size();
+      walker->offset = offsets[i];
+      walker->fs_info = fs_info;
+      walker->thread_count = 1;
+      walker->directory_count = 0;
+      walker->file_count = 0;
+      walker->status = 0;
+      walker->open_tasks = 0;
+      walkers.push_back(walker);
+   }
+
+   if (walkers.size() == 0)
+      return(-1);
+
+   // Records are passed to the GUI tree one at a time without the file queue,
+   // so only use extra walker threads for a threaded image processing task.
+   thread_count = 1;
+   if (file_queue != NULL)
+   {
+      core_count = (size_t)thread::hardware_concurrency();
+      thread_count = core_count;
+      if (thread_count > walkers.size())
+         thread_count = walkers.size();
+      if (thread_count == 0)
+         thread_count = 1;
+
+      // Share the remaining cores out as directory workers within each file system.
+      for (i = 0; i < walkers.size(); i++)
+      {
+         walkers[i]->thread_count = (int)(core_count / thread_count);
+         if (walkers[i]->thread_count < 1)
+            walkers[i]->thread_count = 1;
+      }
    }
 
-   // If the file system walk is ok then save the file system info in a vector
-   // for later file viewing/extraction by the user.
-   file_system_list.push_back(fs_info);
+   for (i = 1; i < thread_count; i++)
+      workers.push_back(thread(file_system_walk_task, &image_path, &walkers, &next_walker, (TskImgInfo *)NULL));
+
+   file_system_walk_task(&image_path, &walkers, &next_walker, img_info);
+
+   for (i = 0; i < workers.size(); i++)
+      workers[i].join();
+
+   for (i = 0; i < walkers.size(); i++)
+   {
+      directory_count += walkers[i]->directory_count;
+      file_count += walkers[i]->file_count;
+      if (walkers[i]->status == 0)
+         ret_val = 0;
+      delete walkers[i];
+   }
 
    msg = "-----------------------------------------------------------------------------------";
    put_progress_message(msg);
@@ -266,67 +926,67 @@ static uint8_t process_file_system(TskImgInfo * img_info, TSK_OFF_T start)
 
    Fl::awake();
 
-   return(0);
+   return(ret_val);
 }
 
 
 /*
    Function: volume_system_callback
-   Purpose : Calls process_file_system from the volume walker.
-   Input   : Volume and partitions information pointers and user data pointer = NULL for this application.
+   Purpose : Collects the partition offsets from the volume walker.
+   Input   : Volume and partitions information pointers and user data pointer to the offset list.
    Output  : Always returns TSK_WALK_CONT to ensure all partitions are processed.
 */
 static TSK_WALK_RET_ENUM volume_system_callback(TskVsInfo * vs_info, const TskVsPartInfo * vs_part, void *ptr)
 {
-    if (process_file_system(const_cast<TskImgInfo *>(vs_info->getImgInfo()), const_cast<TskVsPartInfo *>(vs_part)->getStart() * vs_info->getBlockSize()))
-    {
-        // if we return ERROR here, then the walk will stop.  But, the
-        // error could just be because we looked into an unallocated volume.
-        tsk_error_reset();
-    }
+   vector<TSK_OFF_T> *offsets = (vector<TSK_OFF_T> *)ptr;
 
-    return TSK_WALK_CONT;
+   offsets->push_back(const_cast<TskVsPartInfo *>(vs_part)->getStart() * vs_info->getBlockSize());
+
+   return TSK_WALK_CONT;
 }
 
 
 /*
    Function: process_volume_system
    Purpose : Does a partition walk throught the forensic image and
-             calls process_file_system for any file systems found.
-   Input   : Image information pointer and start offset = 0.
+             calls process_file_systems for any file systems found.
+   Input   : File system object, image information pointer, start offset = 0 and the image path.
    Output  : Retruns 0 if OK, -1 on error.
 */
-static uint8_t process_volume_system(TskImgInfo * img_info, TSK_OFF_T start)
+static uint8_t process_volume_system(Fineline_File_System *image, TskImgInfo * img_info, TSK_OFF_T start, const string &image_path)
 {
    TskVsInfo *vs_info = new TskVsInfo();
+   vector<TSK_OFF_T> offsets;
    int ret_val = 0;
 
    if (vs_info->open(img_info, start, TSK_VS_TYPE_DETECT))
    {
         /* There was no volume system, but there could be a file system */
       tsk_error_reset();
-      if (process_file_system(img_info, start))
-      {
-         ret_val = -1;
-      }
+      offsets.push_back(start);
    }
    else
    {
-        /* Walk the allocated volumes (skip metadata and unallocated volumes) */
-      if (vs_info->vsPartWalk(0, vs_info->getPartCount() - 1, (TSK_VS_PART_FLAG_ENUM) (TSK_VS_PART_FLAG_ALLOC), volume_system_callback, NULL))
+        /* Collect the allocated volumes (skip metadata and unallocated volumes) */
+      if (vs_info->vsPartWalk(0, vs_info->getPartCount() - 1, (TSK_VS_PART_FLAG_ENUM) (TSK_VS_PART_FLAG_ALLOC), volume_system_callback, (void *)&offsets))
       {
          ret_val = -1;
       }
-    }
+   }
 
-    delete vs_info;
+   delete vs_info;
 
-    return(ret_val);
+   if (process_file_systems(image, img_info, offsets, image_path))
+   {
+      ret_val = -1;
+   }
+
+   return(ret_val);
 }
 
 /*
-   Function: thread_task
-   Purpose : Worker function for the posix/win32 thread, must be a C function.
+   Function: fs_thread_task
+   Purpose : Image processing thread started by start_task().
    Input   : Pointer to the file system object.
    Output  : Adds events to the file system tree GUI widget.
 */
@@ -334,7 +994,6 @@ void *fs_thread_task(void *p)
 {
    Fineline_File_System *file_system_image = (Fineline_File_System *)p;
    char msg[256];
-   string pmsg;
 
    sprintf(msg, "fs_thread_task() <INFO> Start forensic image processing thread: %s\n", file_system_image->get_image_name());
    flog->print_log_entry(msg);
@@ -342,23 +1001,17 @@ void *fs_thread_task(void *p)
    if (file_system_image->open_forensic_image() == -1)
    {
       flog->print_log_entry("fs_thread_task() <ERROR> Could not open forensic image.\n");
+      file_queue->set_complete();
+      Fl::awake();
       return(NULL);
    }
 
    file_system_image->process_forensic_image();
 
-   //Completed parsing the image so notify the GUI
-
-   Fl::awake();
+   //Completed parsing the image so notify the GUI, the queue drain timer
+   //adds the remaining records and rebuilds the file system tree.
 
-   file_system_tree->rebuild_tree();
-
-   pmsg = "-----------------------------------------------------------------------------------";
-   put_progress_message(pmsg);
-   pmsg = "Completed rebuilding file system tree.";
-   put_progress_message(pmsg);
-   pmsg = "-----------------------------------------------------------------------------------";
-   put_progress_message(pmsg);
+   file_queue->set_complete();
 
    Fl::awake();
 
@@ -381,12 +1034,27 @@ Fineline_File_System::Fineline_File_System(Fineline_File_System_Tree *ffst, stri
    progress_dialog = fpd;
    file_count = 0;
    directory_count = 0;
-   file_system_number = 0;
+   statistics_version = 0;
+   block_cache.clear();
+   block_cache.reset_statistics();
+   record_arena = new Fineline_File_Arena();
+   file_arena = record_arena;
+   snapshot_file_name.clear();
 }
 
 Fineline_File_System::~Fineline_File_System()
 {
-   //dtor
+   // The walker threads use the file queue and the record arena.
+   wait_task();
+   if (file_queue != NULL)
+   {
+      Fl::remove_timeout(drain_file_queue, (void *)this);
+      delete file_queue;
+      file_queue = NULL;
+   }
+   if (file_arena == record_arena)
+      file_arena = NULL;
+   delete record_arena;
 }
 
 int Fineline_File_System::open_forensic_image()
@@ -394,67 +1062,316 @@ int Fineline_File_System::open_forensic_image()
    string update_msg;
    TSK_IMG_TYPE_ENUM itype;
 
-   image_info = new TskImgInfo();
+   image_info = open_image(fs_image);
+
+   if (image_info == NULL)
+   {
+      flog->print_log_entry("Fineline_File_System::open_forensic_image() <ERROR> Could not open image file.\n");
+      return(-1);
+   }
+
+   update_msg = "Fineline_File_System::open_forensic_image() <INFO> Opened image:";
+   update_msg.append(fs_image);
+
+   flog->print_log_entry(update_msg.c_str());
+
+   itype = image_info->getType();
+   update_msg = "Processing image type: ";
+   update_msg.append(image_info->typeToDesc(itype));
+
+   put_progress_message(update_msg);
+
+   return(0);
+}
+
+int Fineline_File_System::process_forensic_image()
+{
+   string msg;
+
+   if (process_volume_system(this, image_info, 0, fs_image) == 1)
+   {
+      close_image(image_info);
+      image_info = NULL;
+      flog->print_log_entry("Fineline_File_System::process_forensic_image() <ERROR> Could not process image file.\n");
+      return(-1);
+   }
+
+   msg = block_cache.get_statistics_string();
+   put_progress_message(msg);
+   msg.append("\n");
+   flog->print_log_entry(msg.c_str());
+
+   return(0);
+}
+
+int Fineline_File_System::close_forensic_image()
+{
+   if (image_info != NULL)
+      close_image(image_info);
+   image_info = NULL;
+
+   return(0);
+}
+
+/*
+   Function: set_snapshot_file
+   Purpose : Sets the case snapshot file to write when the image walk completes.
+   Input   : Snapshot file name, empty for no snapshot.
+   Output  : None.
+*/
+void Fineline_File_System::set_snapshot_file(string filename)
+{
+   snapshot_file_name = filename;
+}
+
+/*
+   Function: load_case_snapshot
+   Purpose : Restores the file system tree from a case snapshot instead of
+             walking the image. The file systems are opened at the saved
+             offsets so files can still be viewed and exported, if the image
+             cannot be opened the tree can still be browsed.
+   Input   : Open case snapshot, it is closed once the records are loaded.
+   Output  : Returns the number of files, -1 on error.
+*/
+int Fineline_File_System::load_case_snapshot(Fineline_Case_Snapshot *snapshot)
+{
+   Fineline_File_Map fmap = snapshot->load_records(record_arena);
+   vector<int64_t> offsets = snapshot->get_file_system_offsets();
+   TskFsInfo *fs_info;
+   char msg[FL_MAX_INPUT_STR];
+   size_t i;
+
+   // The records are copied into the arena, the snapshot file can be replaced.
+   snapshot->close_snapshot();
+   if (!fmap)
+   {
+      flog->print_log_entry("Fineline_File_System::load_case_snapshot() <ERROR> Could not load the case snapshot.\n");
+      return(-1);
+   }
+
+   // The handles of the previous image are not reused, the file systems are
+   // closed before the image they read from. The file system ids of the
+   // records are positions in the list, so either every file system opens or
+   // none are kept.
+   for (i = 0; i < file_system_list.size(); i++)
+      delete file_system_list[i];
+   file_system_list.clear();
+   close_forensic_image();
+   if (open_forensic_image() == 0)
+   {
+      for (i = 0; i < offsets.size(); i++)
+      {
+         fs_info = new TskFsInfo();
+         if (fs_info->open(image_info, offsets[i], TSK_FS_TYPE_DETECT))
+         {
+            tsk_error_reset();
+            delete fs_info;
+            break;
+         }
+         file_system_list.push_back(fs_info);
+      }
+      if (file_system_list.size() != offsets.size())
+      {
+         flog->print_log_entry("Fineline_File_System::load_case_snapshot() <ERROR> Could not open the file systems, files cannot be viewed or exported.\n");
+         for (i = 0; i < file_system_list.size(); i++)
+            delete file_system_list[i];
+         file_system_list.clear();
+      }
+   }
+
+   file_system_tree->clear_tree();
+   file_system_tree->add_file_map(fmap);
+   file_system_tree->redraw();
+
+   // The owners are not kept in the snapshot records so they are not counted.
+   Fineline_File_Statistics fstats;
+   Fineline_File_Statistics::compute(fmap, 0, &fstats);
+   set_file_statistics(fstats);
+
+   snprintf(msg, FL_MAX_INPUT_STR, "Loaded %lu files from the case snapshot.", (unsigned long)fmap->size());
+   put_progress_message(msg);
+
+   return((int)fmap->size());
+}
+
+/*
+   Function: open_image
+   Purpose : Opens a forensic image with its reads going through the shared
+             block cache. Every thread reading the image opens its own handle,
+             the handles on the same image file share the cached pages.
+   Input   : Image file path.
+   Output  : New image handle to be closed with close_image(), NULL on error.
+*/
+TskImgInfo *Fineline_File_System::open_image(string image_path)
+{
+   TSK_IMG_INFO *img = tsk_img_open_sing(image_path.c_str(), TSK_IMG_TYPE_DETECT, 0);
+   fl_cached_image_t *cached;
+   unordered_map< string, int >::iterator p;
+
+   if (img == NULL)
+      return(NULL);
+
+   cached = new fl_cached_image_t();
+   cached->tsk_image = img;
+   cached->tsk_read = img->read;
+   cached->image_handle = new TskImgInfo(img);
+   cached->stream.next_page = 0;
+   cached->stream.run_length = 0;
 
-   if (image_info->open(fs_image.c_str(), TSK_IMG_TYPE_DETECT, 0) == 1)
+   cached_image_lock.lock();
+   p = cached_image_ids.find(image_path);
+   if (p == cached_image_ids.end())
    {
-      delete image_info;
-      flog->print_log_entry("Fineline_File_System::open_forensic_image() <ERROR> Could not open image file.\n");
-      return(-1);
+      cached->image_id = (int)cached_image_ids.size() + 1;
+      cached_image_ids[image_path] = cached->image_id;
    }
+   else
+   {
+      cached->image_id = p->second;
+   }
+   cached_images.push_back(cached);
+   cached_image_lock.unlock();
 
-   update_msg = "Fineline_File_System::open_forensic_image() <INFO> Opened image:";
-   update_msg.append(fs_image);
-
-   flog->print_log_entry(update_msg.c_str());
-
-   itype = image_info->getType();
-   update_msg = "Processing image type: ";
-   update_msg.append(image_info->typeToDesc(itype));
-
-   put_progress_message(update_msg);
+   img->read = cached_image_read;
 
-   return(0);
+   return(cached->image_handle);
 }
 
-int Fineline_File_System::process_forensic_image()
+/*
+   Function: close_image
+   Purpose : Closes an image handle from open_image().
+   Input   : Image handle.
+   Output  : None.
+*/
+void Fineline_File_System::close_image(TskImgInfo *img_info)
 {
-   if (process_volume_system(image_info, 0) == 1)
+   fl_cached_image_t *cached = NULL;
+   size_t i;
+
+   cached_image_lock.lock();
+   for (i = 0; i < cached_images.size(); i++)
    {
-      delete image_info;
-      flog->print_log_entry("Fineline_File_System::process_forensic_image() <ERROR> Could not process image file.\n");
-      return(-1);
+      if (cached_images[i]->image_handle == img_info)
+      {
+         cached = cached_images[i];
+         cached_images.erase(cached_images.begin() + i);
+         break;
+      }
    }
+   cached_image_generation++;
+   cached_image_lock.unlock();
 
-   return(0);
+   if (cached == NULL) // not opened through the cache
+   {
+      delete img_info;
+      return;
+   }
+
+   delete cached->image_handle;
+   tsk_img_close(cached->tsk_image);
+   delete cached;
+
+   return;
 }
 
-int Fineline_File_System::close_forensic_image()
+/*
+   Function: get_block_cache
+   Purpose : Gets the image block cache to change its size or read its statistics.
+   Input   : None.
+   Output  : The block cache shared by all image handles.
+*/
+Fineline_Block_Cache *Fineline_File_System::get_block_cache()
 {
-   //DEPRECATED: not required
-   if (image_info != NULL)
-      delete image_info;
-
-   return(0);
+   return(&block_cache);
 }
 
 /*
    Function: start_task
-   Purpose : Starts the worker function for the posix/win32 thread.
+   Purpose : Starts the image processing thread.
              Recommended method for processing large forensic images.
+             Must be called from the GUI thread, the file queue drain
+             timer runs on the thread that calls this function.
    Input   : None.
    Output  : None.
 */
 void Fineline_File_System::start_task()
 {
 	running = 1;
-	Fl_Thread thread_id;
-	fl_create_thread(thread_id, fs_thread_task, (void *)this);
+	cancel_walk = 0;
+	if (file_queue == NULL)
+	   file_queue = new Fineline_File_Queue(FL_FILE_QUEUE_SIZE);
+	file_queue->reset();
+	Fl::add_timeout(FL_FILE_QUEUE_INTERVAL, drain_file_queue, (void *)this);
+	walk_thread = thread(fs_thread_task, (void *)this);
 }
 
+/*
+   Function: stop_task
+   Purpose : Asks the walker threads to stop, the task is still running until
+             the queue drain timer has seen the walk complete.
+   Input   : None.
+   Output  : None.
+*/
 void Fineline_File_System::stop_task()
 {
-	running = 0;
+	cancel_walk = 1;
+}
+
+/*
+   Function: wait_task
+   Purpose : Cancels the image processing task and joins its thread, then
+             waits for the case snapshot writer. The GUI keeps running while
+             it waits, the walker threads need the FLTK lock and the queue
+             drain timer to finish. Must be called from the GUI thread.
+   Input   : None.
+   Output  : None.
+*/
+void Fineline_File_System::wait_task()
+{
+   if (walk_thread.joinable())
+   {
+      stop_task();
+      while (running)
+         Fl::wait(0.1);
+      walk_thread.join();
+   }
+   if (snapshot_thread.joinable())
+      snapshot_thread.join();
+}
+
+/*
+   Function: start_snapshot_task
+   Purpose : Starts writing the case snapshot of the processed image in a
+             background thread, so the project can be reopened without
+             walking the image again. A previous write is finished first.
+   Input   : Snapshot file name and file index snapshot.
+   Output  : None.
+*/
+void Fineline_File_System::start_snapshot_task(string filename, Fineline_File_Map fmap)
+{
+   if (snapshot_thread.joinable())
+      snapshot_thread.join();
+
+   snapshot_thread = thread(save_snapshot_task, filename, fmap, fs_image, get_file_system_offsets());
+}
+
+/*
+   Function: write_case_snapshot
+   Purpose : Writes the case snapshot now. Every snapshot write goes through
+             the file system object, so a background write is finished
+             before the snapshot file is written again.
+   Input   : Snapshot file name and file index snapshot.
+   Output  : Returns 0 on success, -1 on error.
+*/
+int Fineline_File_System::write_case_snapshot(string filename, Fineline_File_Map fmap)
+{
+   if (!fmap || (fmap->size() == 0))
+      return(-1);
+
+   if (snapshot_thread.joinable())
+      snapshot_thread.join();
+
+   return(Fineline_Case_Snapshot::save_snapshot(filename.c_str(), fmap, fs_image, get_file_system_offsets()));
 }
 
 
@@ -481,6 +1398,15 @@ int Fineline_File_System::export_file(string file_path, string evidence_director
    sprintf(msg, "Fineline_File_System::export_file() <INFO> exporting file %s <-> %s\n", evidence_directory.c_str(), file_path.c_str());
    flog->print_log_entry(msg);
 
+   // Files in the tree are opened by metadata address, only unknown paths
+   // are looked up in each file system.
+   fl_file_record_t *flrec = file_system_tree->find_file(file_path);
+   if (flrec != NULL)
+   {
+      delete file_info;
+      return(export_file(flrec, evidence_directory));
+   }
+
    for (i = 0; i < file_system_list.size(); i++)
    {
       TskFsInfo *fs_info = file_system_list[i];
@@ -573,133 +1499,100 @@ int Fineline_File_System::export_file(string file_path, string evidence_director
 
 /*
    Function: export_file
-   Purpose : Opens the requested file in the forensic image and copies the file
-             to the specified evidence directory.
+   Purpose : Opens the requested file in the forensic image by metadata address
+             and copies the file to the specified evidence directory.
    Input   : Request file record pointer and destination evidence directory.
    Output  : The exported file content, return 0 on success, -1 on error.
 */
 int Fineline_File_System::export_file(fl_file_record_t *flec, string evidence_directory)
 {
-   TskFsFile *file_info = new TskFsFile();
-   char in_buf[FL_MAX_INPUT_STR];
-   FILE *out_file = NULL;
-   int len = 0;
-   int cnt = 0;
-   TSK_OFF_T file_size  = 0;
-   TSK_OFF_T offset = 0;
-   char msg[256];
-   int fs_id;
-   string progress_msg;
-   string file_path;
-
-   sprintf(msg, "Fineline_File_System::export_file() <INFO> exporting file %s <-> %s\n", evidence_directory.c_str(), flec->full_path);
-   flog->print_log_entry(msg);
-
-   fs_id = flec->file_system_id - 1;
-   if ((fs_id > -1) && (fs_id < (int)file_system_list.size()))
-   {
-      TskFsInfo *fs_info = file_system_list[fs_id];
-      file_path = flec->file_path;
-      file_path.append(flec->file_name);
-      if (file_info->open(fs_info, file_info, file_path.c_str()))
-      {
-         sprintf(msg, "Fineline_File_System::export_file() <INFO> Could not open file in file system %i\n", fs_id);
-         flog->print_log_entry(msg);
-      }
-      else
-      {
-         sprintf(msg, "Fineline_File_System::export_file() <INFO> Exporting file %s\n", file_path.c_str());
-         flog->print_log_entry(msg);
-
-         // destination_file.append(PATH_SEPARATOR);
-         // NOTE: do not use PATH_SEPARATOR, libs will automatically convert to
-         // to platform specific path separator on Linux or Windows.
+   vector< fl_file_record_t* > flist;
 
-         string destination_file = evidence_directory;
-         destination_file.append("/");
-         destination_file.append(file_path);
+   flist.push_back(flec);
+   if (export_files(flist, evidence_directory) != 1)
+      return(-1);
 
-         if (make_path(destination_file, 0775) != 0)  // Linux/Unix permissions: (S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH)
-         {
-            sprintf(msg, "Fineline_File_System::export_file() <INFO> Could not make subdirectory in %s\n", evidence_directory.c_str());
-            flog->print_log_entry(msg);
-            //progress_message(msg);
-            //return(-1); do not return, directory may already exist, errno checking is unreliable.
-         }
+   return(0);
+}
+
+/*
+   Function: export_files
+   Purpose : Exports the requested files from the forensic image to the specified
+             evidence directory on all cores, see Fineline_File_Exporter.
+   Input   : Request file record list and destination evidence directory.
+   Output  : The exported file content, returns the number of files exported.
+*/
+int Fineline_File_System::export_files(vector< fl_file_record_t* > flist, string evidence_directory)
+{
+   Fineline_File_Exporter file_exporter(fs_image, get_file_system_offsets(), evidence_directory);
+   string progress_msg;
+   unsigned int i;
+   long count;
 
-         out_file = fopen(destination_file.c_str(), "wb");
-         if (out_file == NULL)
-         {
-            sprintf(msg, "Fineline_File_System::export_file() <ERROR> Could not open file %s\n", destination_file.c_str());
-            flog->print_log_entry(msg);
-            progress_message(msg);
-            return(-1);
-         }
-         else
-         {
-            // Now read in the content of the selected file and write out to the file in the evidence directory.
+   file_exporter.add_files(flist);
+   count = file_exporter.export_files(0);
 
-            file_size = file_info->getMeta()->getSize();
-            for (offset = 0; offset < file_size; offset += len)
-            {
-               if (file_size - offset < 2048)
-                  len = (size_t) (file_size - offset);
-               else
-                  len = 2048;
+   const vector< fl_export_result_t > &results = file_exporter.get_results();
+   for (i = 0; i < results.size(); i++)
+   {
+      progress_msg = file_exporter.get_status_string(results[i]);
+      put_progress_message(progress_msg);
+   }
 
-               cnt = file_info->read(offset, in_buf, len, TSK_FS_FILE_READ_FLAG_NONE);
-               if (cnt == -1)
-               {
-                  // could check tsk_errno here for a recovery error (TSK_ERR_FS_RECOVER)
-                  if (DEBUG)
-                  {
-                     sprintf(msg, "Fineline_File_System::export_file() <ERROR> Reading file %s\n", file_path.c_str());
-                     flog->print_log_entry(msg);
-                  }
-                  break;
-               }
-               else if (cnt != len)
-               {
-                  if (DEBUG)
-                  {
-                     sprintf(msg, "Fineline_File_System::export_file() <WARNING> Allocation error in %s\n", file_path.c_str());
-                     flog->print_log_entry(msg);
-                  }
-               }
+   return((int)count);
+}
 
-               fwrite(in_buf, 1, cnt, out_file);
+/*
+   Function: open_file
+   Purpose : Opens a file by its metadata address, no path lookup or directory
+             traversal is needed. Used by the worker threads with their own
+             file system handles.
+   Input   : File system handle and the file record.
+   Output  : New TskFsFile the caller must delete, NULL on error.
+*/
+TskFsFile *Fineline_File_System::open_file(TskFsInfo *fs_info, fl_file_record_t *flrec)
+{
+   TskFsFile *file_info = new TskFsFile();
 
-            }
-         }
-      }
+   if (file_info->open(fs_info, file_info, (TSK_INUM_T)flrec->meta_address))
+   {
+      delete file_info;
+      return(NULL);
    }
 
-   if (out_file != NULL)
-      fclose(out_file);
+   return(file_info);
+}
 
-   delete file_info;
+/*
+   Function: open_file
+   Purpose : Opens a file by its metadata address with the file system handles
+             of this image.
+   Input   : File record.
+   Output  : New TskFsFile the caller must delete, NULL on error.
+*/
+TskFsFile *Fineline_File_System::open_file(fl_file_record_t *flrec)
+{
+   int fs_id = flrec->file_system_id - 1;
 
-   progress_msg = "Exported file: ";
-   progress_msg.append(file_path);
-   put_progress_message(progress_msg);
+   if ((fs_id < 0) || (fs_id >= (int)file_system_list.size()))
+      return(NULL);
 
-   return(0);
+   return(open_file(file_system_list[fs_id], flrec));
 }
-
-
 
 /*
-   Function: export_files
-   Purpose : Opens the requested files in the forensic image and copies the file
-             to the specified evidence directory.
-   Input   : Request file path and destination evidence directory.
-   Output  : The exported file content, return 0 on success, -1 on error.
+   Function: read_file
+   Purpose : Reads the content of a file opened with open_file(), from the
+             recorded default data attribute if the file has one.
+   Input   : Open file, file record, file offset, buffer and length.
+   Output  : Returns the number of bytes read, -1 on error.
 */
-int Fineline_File_System::export_files(vector<string> flist, string evidence_directory)
+ssize_t Fineline_File_System::read_file(TskFsFile *file_info, fl_file_record_t *flrec, TSK_OFF_T offset, char *buffer, size_t length)
 {
-   //TODO: iterate over vector and call export_file()
+   if (flrec->attribute_type != 0)
+      return(file_info->read((TSK_FS_ATTR_TYPE_ENUM)flrec->attribute_type, flrec->attribute_id, offset, buffer, length, TSK_FS_FILE_READ_FLAG_NONE));
 
-   return(0);
+   return(file_info->read(offset, buffer, length, TSK_FS_FILE_READ_FLAG_NONE));
 }
 
 int Fineline_File_System::get_running()
@@ -712,6 +1605,154 @@ const char *Fineline_File_System::get_image_name()
    return(fs_image.c_str());
 }
 
+/*
+   Function: get_file_arena
+   Purpose : Gets the arena holding the file metadata records of this image, the
+             records are freed when the file system object is deleted.
+   Input   : None.
+   Output  : Pointer to the file record arena.
+*/
+Fineline_File_Arena *Fineline_File_System::get_file_arena()
+{
+   return(record_arena);
+}
+
+/*
+   Function: get_file_system_offsets
+   Purpose : Gets the image offset of each file system, so other threads can
+             open their own handles. Entry n is for file system id n + 1.
+   Input   : None.
+   Output  : The file system offsets.
+*/
+vector<TSK_OFF_T> Fineline_File_System::get_file_system_offsets()
+{
+   vector<TSK_OFF_T> offsets;
+   unsigned int i;
+
+   for (i = 0; i < file_system_list.size(); i++)
+      offsets.push_back(file_system_list[i]->getOffset());
+
+   return(offsets);
+}
+
+/*
+   Function: set_mft_scan
+   Purpose : Turns the sequential $MFT scan of NTFS file systems on or off, when
+             off NTFS file systems are walked by directory like the others.
+   Input   : 1 = scan the $MFT, 0 = walk the directories.
+   Output  : None.
+*/
+void Fineline_File_System::set_mft_scan(int scan)
+{
+   mft_scan = scan;
+}
+
+int Fineline_File_System::get_mft_scan()
+{
+   return(mft_scan);
+}
+
+/*
+   Function: get_mac_events
+   Purpose : Gets the MAC timeline events for times that are not in the file
+             records, e.g. the NTFS $FILE_NAME times. Only valid once the image
+             has been processed.
+   Input   : None.
+   Output  : A copy of the event list.
+*/
+vector<fl_mac_event_t> Fineline_File_System::get_mac_events()
+{
+   lock_guard<mutex> guard(mac_event_lock);
+
+   return(mac_event_list);
+}
+
+/*
+   Function: set_mac_events
+   Purpose : Replaces the MAC timeline events, used when the file records are
+             restored from a case snapshot and the events from the project.
+   Input   : The event list.
+   Output  : None.
+*/
+void Fineline_File_System::set_mac_events(const vector<fl_mac_event_t> &events)
+{
+   mac_event_lock.lock();
+   mac_event_list = events;
+   mac_event_lock.unlock();
+}
+
+/*
+   Function: add_mac_events
+   Purpose : Appends the MAC timeline events found by a walker thread.
+   Input   : The event list.
+   Output  : None.
+*/
+void Fineline_File_System::add_mac_events(const vector<fl_mac_event_t> &events)
+{
+   mac_event_lock.lock();
+   mac_event_list.insert(mac_event_list.end(), events.begin(), events.end());
+   mac_event_lock.unlock();
+}
+
+
+/*
+   Function: get_file_statistics
+   Purpose : Copies the image statistics, during the walk they include the files
+             merged so far by each walker thread.
+   Input   : The statistics to fill in.
+   Output  : None.
+*/
+void Fineline_File_System::get_file_statistics(Fineline_File_Statistics *fstats)
+{
+   file_statistics_lock.lock();
+   *fstats = file_statistics;
+   file_statistics_lock.unlock();
+}
+
+/*
+   Function: set_file_statistics
+   Purpose : Replaces the image statistics, used when the file records are
+             restored from a case snapshot.
+   Input   : The statistics.
+   Output  : None.
+*/
+void Fineline_File_System::set_file_statistics(const Fineline_File_Statistics &fstats)
+{
+   file_statistics_lock.lock();
+   file_statistics = fstats;
+   statistics_version++;
+   file_statistics_lock.unlock();
+}
+
+/*
+   Function: merge_file_statistics
+   Purpose : Adds the statistics a walker thread has collected to the image
+             statistics.
+   Input   : The partial statistics.
+   Output  : None.
+*/
+void Fineline_File_System::merge_file_statistics(const Fineline_File_Statistics &fstats)
+{
+   file_statistics_lock.lock();
+   file_statistics.merge(fstats);
+   statistics_version++;
+   file_statistics_lock.unlock();
+}
+
+/*
+   Function: get_statistics_version
+   Purpose : Gets the number of times the image statistics have changed, so a
+             display can tell if it needs to copy them again.
+   Input   : None.
+   Output  : The statistics version.
+*/
+long Fineline_File_System::get_statistics_version()
+{
+   lock_guard<mutex> guard(file_statistics_lock);
+
+   return(statistics_version);
+}
+
 
 /*
    Function: make_path
@@ -37,6 +37,11 @@
 #define FINELINE_FILE_SYSTEM_H
 
 #include <vector>
+#include <deque>
+#include <unordered_set>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include <sys/stat.h>
 #include <string>
@@ -48,9 +53,59 @@
 #include "Fineline_Log.h"
 #include "Fineline_File_System_Tree.h"
 #include "Fineline_Progress_Dialog.h"
+#include "Fineline_File_Arena.h"
+#include "Fineline_Block_Cache.h"
+#include "Fineline_Case_Snapshot.h"
+#include "Fineline_File_Statistics.h"
+
+#define FL_WALK_PUSH_BATCH 1024   /* records a walker thread queues for the GUI at a time */
+#define FL_WALK_STATS_BATCH 65536 /* records a walker thread counts before merging them into the image statistics */
 
 using namespace std;
 
+/* A directory still to be listed, the record is NULL for the root directory. */
+struct fl_dir_task
+{
+   uint64_t meta_address;
+   fl_file_record_t *record;
+};
+typedef struct fl_dir_task fl_dir_task_t;
+
+class Fineline_File_System;
+
+/* State for the walk of one file system. */
+struct fl_fs_walker
+{
+   Fineline_File_System *file_system;     /* image the walk's events and statistics are added to */
+   int file_system_id;                    /* 1 based, matches the file_system_list order */
+   TSK_OFF_T offset;                      /* file system offset in the image */
+   TskFsInfo *fs_info;                    /* shared handle kept for file viewing/extraction */
+   int thread_count;                      /* directory worker threads for this file system */
+   long directory_count;
+   long file_count;
+   int status;                            /* 0 if the walk completed, -1 on error */
+   atomic<long> open_tasks;               /* directories queued or being listed */
+   mutex visited_lock;
+   unordered_set<uint64_t> visited;       /* directories already queued, guards against loops */
+   vector< struct fl_dir_worker* > workers;
+};
+typedef struct fl_fs_walker fl_fs_walker_t;
+
+/* A directory worker thread, lists its own directories depth first and steals from the other workers when idle. */
+struct fl_dir_worker
+{
+   fl_fs_walker_t *walker;
+   mutex task_lock;
+   deque<fl_dir_task_t> tasks;            /* the owner pops from the back, thieves take from the front */
+   fl_dir_task_t current;                 /* the directory being listed */
+   long directory_count;
+   long file_count;
+   vector< fl_file_record_t* > pending;   /* records not yet passed to the GUI thread */
+   Fineline_File_Statistics statistics;   /* records not yet merged into the image statistics */
+   fl_arena_cursor_t arena_cursor;        /* the worker's own arena block, records are allocated without the arena lock */
+};
+typedef struct fl_dir_worker fl_dir_worker_t;
+
 
 class Fineline_File_System
 {
@@ -60,14 +115,37 @@ class Fineline_File_System
 
       void start_task();
 	   void stop_task();
+      void wait_task();
 	   int get_running();
       int open_forensic_image();
       int process_forensic_image();
       int close_forensic_image();
       const char *get_image_name();
+      Fineline_File_Arena *get_file_arena();
+      vector<TSK_OFF_T> get_file_system_offsets();
+      void set_mft_scan(int scan);
+      int get_mft_scan();
+      vector<fl_mac_event_t> get_mac_events();
+      void set_mac_events(const vector<fl_mac_event_t> &events);
+      void add_mac_events(const vector<fl_mac_event_t> &events);
+      void get_file_statistics(Fineline_File_Statistics *fstats);
+      void set_file_statistics(const Fineline_File_Statistics &fstats);
+      void merge_file_statistics(const Fineline_File_Statistics &fstats);
+      long get_statistics_version();
+      void set_snapshot_file(string filename);
+      void start_snapshot_task(string filename, Fineline_File_Map fmap);
+      int write_case_snapshot(string filename, Fineline_File_Map fmap);
+      int load_case_snapshot(Fineline_Case_Snapshot *snapshot);
       int export_file(string file_path, string evidence_directory);
       int export_file(fl_file_record_t *flec, string evidence_directory);
-      int export_files(vector<string> flist, string evidence_directory);
+      int export_files(vector< fl_file_record_t* > flist, string evidence_directory);
+      TskFsFile *open_file(fl_file_record_t *flrec);
+
+      static TskImgInfo *open_image(string image_path);
+      static void close_image(TskImgInfo *img_info);
+      static Fineline_Block_Cache *get_block_cache();
+      static TskFsFile *open_file(TskFsInfo *fs_info, fl_file_record_t *flrec);
+      static ssize_t read_file(TskFsFile *file_info, fl_file_record_t *flrec, TSK_OFF_T offset, char *buffer, size_t length);
 
    protected:
    private:
@@ -75,6 +153,14 @@ class Fineline_File_System
       int make_path(string s, mode_t mode);
 
 	   string fs_image;
+      thread walk_thread;                     /* image processing thread from start_task() */
+      thread snapshot_thread;                 /* case snapshot writer, reads the arena records */
+      Fineline_File_Arena *record_arena;
+      vector< fl_mac_event_t > mac_event_list; /* timeline events for times not kept in the file records */
+      mutex mac_event_lock;
+      Fineline_File_Statistics file_statistics; /* image totals, the walker threads merge their partial statistics as they go */
+      mutex file_statistics_lock;
+      long statistics_version;                /* counts the changes so the statistics display only copies them when needed */
 };
 
 #endif // FINELINE_FILE_SYSTEM_H
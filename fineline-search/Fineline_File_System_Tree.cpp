@@ -28,6 +28,9 @@
    Purpose: Displays a file system in a tree widget, the file records are stored
             in a map for fast lookups based on the filename key value. This allows
             easy mapping from the FLTK tree nodes to the corresponding file records.
+            The tree structure is held in a compact model and tree items are only
+            created for the children of open directories, a closed directory has
+            a single placeholder item until it is opened.
 
    Notes: EXPERIMENTAL
 
@@ -36,6 +39,7 @@
 
 #include <stdio.h>
 #include <iostream>
+#include <thread>
 
 #include <tsk/libtsk.h>
 
@@ -44,11 +48,49 @@
 
 #include "Fineline_Log.h"
 #include "Fineline_File_System_Tree.h"
+#include "Fineline_File_Arena.h"
 
 using namespace std;
 
+static const char *L_folder_xpm[] = {
+   "11 11 3 1",
+   ".  c None",
+   "x  c #d8d833",
+   "@  c #808011",
+   "...........",
+   ".....@@@@..",
+   "....@xxxx@.",
+   "@@@@@xxxx@@",
+   "@xxxxxxxxx@",
+   "@xxxxxxxxx@",
+   "@xxxxxxxxx@",
+   "@xxxxxxxxx@",
+   "@xxxxxxxxx@",
+   "@xxxxxxxxx@",
+   "@@@@@@@@@@@"};
+static Fl_Pixmap L_folderpixmap(L_folder_xpm);
+
+static const char *L_document_xpm[] = {
+   "11 11 3 1",
+   ".  c None",
+   "x  c #d8d8f8",
+   "@  c #202060",
+   ".@@@@@@@@@.",
+   ".@xxxxxxx@.",
+   ".@xxxxxxx@.",
+   ".@xxxxxxx@.",
+   ".@xxxxxxx@.",
+   ".@xxxxxxx@.",
+   ".@xxxxxxx@.",
+   ".@xxxxxxx@.",
+   ".@xxxxxxx@.",
+   ".@xxxxxxx@.",
+   ".@@@@@@@@@."};
+static Fl_Pixmap L_documentpixmap(L_document_xpm);
+
 Fineline_File_System_Tree::Fineline_File_System_Tree(int x, int y, int w, int h) : Fl_Tree(x, y, w, h)
 {
+   file_index = make_shared< Fineline_File_Index >();
 
    begin();
    tooltip("File System Browser");
@@ -64,6 +106,7 @@ Fineline_File_System_Tree::Fineline_File_System_Tree(int x, int y, int w, int h)
    when(FL_WHEN_RELEASE);
    end();
 
+   tree_items[FL_TREE_ROOT_NODE] = root();
 }
 
 Fineline_File_System_Tree::~Fineline_File_System_Tree()
@@ -83,102 +126,285 @@ void Fineline_File_System_Tree::file_system_tree_callback(Fl_Tree *flt, void *p)
 
 /*
    Name   : add_file()
-   Purpose: Add a node to the file system tree widget and store the
-            file metadata record in the file map.
+   Purpose: Add a node to the file system tree model and store the
+            file metadata record in the file map. A tree item is only
+            created if the parent directory is open.
    Input  : File path of the node, file metadata record pointer.
    Output : None.
 */
 int Fineline_File_System_Tree::add_file(string filename, fl_file_record_t *flrp)
 {
-   // Only add file leaf nodes to the tree if running on Linux,
-   // Windows has performance issues if there are more than 20000 nodes,
-   // This results in noticable delays when clicking on tree nodes,
-   // so do dynamic leaf node addition when running one Windoze.
-
-#ifdef LINUX_BUILD
-   add(filename.c_str());
-   close(filename.c_str(), 0);
-#else
-   // Windows major culprit is the winsxs directory containing backups of updated system files.
-   // So add the winsxs directory but leave all the subdirectories for addition by user selection.
-   unsigned int pos;
-   pos = filename.find("winsxs");
-   if (pos == string::npos)
+   show_node(tree_model.add_path(filename, flrp));
+
+   copy_index_on_write();
+   return(file_index->add_file(filename, flrp));
+}
+
+/*
+   Name   : copy_index_on_write()
+   Purpose: Makes the file index private to the tree before it is changed.
+            Snapshots returned by get_file_map() are shared with filters and
+            dialogues and must never change, so if one is still held the
+            index is copied first.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_File_System_Tree::copy_index_on_write()
+{
+   if (file_index.use_count() > 1)
    {
-      add(filename.c_str());
-      close(filename.c_str(), 0);
+      file_index = make_shared< Fineline_File_Index >(*file_index);
    }
-   else if ((filename.size() - pos) < 7)
+}
+
+
+/*
+   Name   : get_item_node()
+   Purpose: Gets the tree model node of a tree item, the node number is kept
+            in the item user data.
+   Input  : Tree item.
+   Output : The model node, FL_TREE_NO_NODE for a placeholder item.
+*/
+uint32_t Fineline_File_System_Tree::get_item_node(Fl_Tree_Item *flti)
+{
+   if (flti == NULL)
+      return(FL_TREE_NO_NODE);
+   if (flti == root())
+      return(FL_TREE_ROOT_NODE);
+   if (flti->user_data() == NULL)
+      return(FL_TREE_NO_NODE);
+
+   return((uint32_t)(uintptr_t)flti->user_data());
+}
+
+/*
+   Name   : add_item()
+   Purpose: Creates the tree item of a model node. The item is closed, if the
+            node has children a placeholder child is added so the directory
+            can be opened, the real children are added when it is opened.
+   Input  : Parent item and the model node.
+   Output : The new item.
+*/
+Fl_Tree_Item *Fineline_File_System_Tree::add_item(Fl_Tree_Item *parent_item, uint32_t node)
+{
+   Fl_Tree_Item *flti = add(parent_item, tree_model.get_name(node));
+
+   if (flti == NULL)
+      return(NULL);
+
+   flti->user_data((void *)(uintptr_t)node);
+   flti->close();
+   if (tree_model.has_visible_children(node))
+      add(flti, FL_TREE_PLACEHOLDER)->deactivate();
+   set_item_style(flti, node);
+   tree_items[node] = flti;
+
+   return(flti);
+}
+
+/*
+   Name   : show_node()
+   Purpose: Shows a new model node in the widget. Finds the highest node in
+            its path without a tree item, if the directory above it is open
+            an item is added, otherwise the closed directory gets a
+            placeholder child.
+   Input  : Model node.
+   Output : None.
+*/
+void Fineline_File_System_Tree::show_node(uint32_t node)
+{
+   unordered_map< uint32_t, Fl_Tree_Item* >::iterator p;
+   Fl_Tree_Item *parent_item;
+
+   if ((node == FL_TREE_NO_NODE) || (tree_model.get_flags(node) & FL_TREE_NODE_HIDDEN))
+      return;
+
+   p = tree_items.find(node);
+   if (p != tree_items.end())
    {
-      add(filename.c_str());
-      close(filename.c_str(), 0);
+      set_item_style(p->second, node); // a directory record added after its files
+      return;
    }
-#endif
 
-   file_map[filename] = flrp;
-   return(file_map.size());
-}
+   while (tree_items.count(tree_model.get_parent(node)) == 0)
+      node = tree_model.get_parent(node);
+   parent_item = tree_items[tree_model.get_parent(node)];
 
+   if (parent_item->is_open())
+   {
+      if (tree_items.count(node) == 0)
+         add_item(parent_item, node);
+   }
+   else if (parent_item->children() == 0)
+   {
+      add(parent_item, FL_TREE_PLACEHOLDER)->deactivate();
+      set_item_style(parent_item, get_item_node(parent_item));
+   }
 
+   return;
+}
+
 /*
-   Name   : add_file_nodes()
-   Purpose: Dynamically add file leaf nodes to the tree on Windows
-            systems only. Not required on Linux, needed on Windows due
-            to performance issues displaying large file system trees.
-            Only use for the winsxs directory.
-   Input  : File path of the directory node.
+   Name   : release_children()
+   Purpose: Deletes the child items of a tree item, the model nodes are kept.
+   Input  : Tree item.
    Output : None.
 */
-void Fineline_File_System_Tree::add_file_nodes(string file_path)
+void Fineline_File_System_Tree::release_children(Fl_Tree_Item *flti)
 {
-   char path[FL_PATH_MAX];
-   int path_len = file_path.size();
+   vector< Fl_Tree_Item* > item_stack;
+   Fl_Tree_Item *fltc;
+   uint32_t node;
+   int i;
+
+   for (i = 0; i < flti->children(); i++)
+      item_stack.push_back(flti->child(i));
 
-   if (file_path.find("winsxs") == string::npos)
+   while (!item_stack.empty())
    {
-      return; // Not a winsxs subdirectory
+      fltc = item_stack.back();
+      item_stack.pop_back();
+      node = get_item_node(fltc);
+      if (node != FL_TREE_NO_NODE)
+         tree_items.erase(node);
+      for (i = 0; i < fltc->children(); i++)
+         item_stack.push_back(fltc->child(i));
    }
-   if (file_path.compare(0, 4, "ROOT") == 0)
+
+   // Do not leave the keyboard focus on a deleted item.
+   for (fltc = get_item_focus(); fltc != NULL; fltc = fltc->parent())
    {
-      file_path.erase(0, 5);  // Remove the tree ROOT/ label and path separator
+      if (fltc->parent() == flti)
+      {
+         set_item_focus(flti);
+         break;
+      }
    }
-   strncpy(path, file_path.c_str(), path_len);
-   map< string, fl_file_record_t* >::iterator p = file_map.begin();
 
-   while (p != file_map.end())
+   clear_children(flti);
+}
+
+/*
+   Name   : open_directory()
+   Purpose: Called when a directory is opened, replaces the placeholder with
+            the items of the directory children sorted by name. Directories
+            below it that were open are opened again.
+   Input  : Tree item of the directory.
+   Output : None.
+*/
+void Fineline_File_System_Tree::open_directory(Fl_Tree_Item *flti)
+{
+   vector< uint32_t > open_nodes;
+   unordered_map< uint32_t, Fl_Tree_Item* >::iterator p;
+   uint32_t node = get_item_node(flti);
+   uint32_t c;
+   size_t i;
+   int n;
+
+   if (node == FL_TREE_NO_NODE)
+      return;
+
+   for (n = 0; n < flti->children(); n++)
+   {
+      if (flti->child(n)->is_open() && flti->child(n)->has_children())
+         open_nodes.push_back(get_item_node(flti->child(n)));
+   }
+
+   release_children(flti);
+   tree_model.sort_children(node);
+   for (c = tree_model.get_first_child(node); c != FL_TREE_NO_NODE; c = tree_model.get_next_sibling(c))
    {
-      fl_file_record_t *flec = p->second;
+      if ((tree_model.get_flags(c) & FL_TREE_NODE_HIDDEN) == 0)
+         add_item(flti, c);
+   }
 
-      if (strncmp(flec->file_path, path, path_len) == 0)
+   for (i = 0; i < open_nodes.size(); i++)
+   {
+      p = tree_items.find(open_nodes[i]);
+      if (p != tree_items.end())
       {
-         add(flec->full_path);
+         p->second->open();
+         open_directory(p->second);
       }
-      p++;
    }
+
+   return;
+}
+
+/*
+   Name   : close_directory()
+   Purpose: Called when a directory is closed, deletes the child items and
+            puts back the placeholder.
+   Input  : Tree item of the directory.
+   Output : None.
+*/
+void Fineline_File_System_Tree::close_directory(Fl_Tree_Item *flti)
+{
+   uint32_t node = get_item_node(flti);
+
+   if ((node == FL_TREE_NO_NODE) || (node == FL_TREE_ROOT_NODE))
+      return;
+
+   release_children(flti);
+   if (tree_model.has_visible_children(node))
+      add(flti, FL_TREE_PLACEHOLDER)->deactivate();
+
+   return;
+}
+
+/*
+   Name   : set_item_style()
+   Purpose: Sets the icon, label colour and font of a tree item from its
+            model node and file record.
+   Input  : Tree item and model node.
+   Output : None.
+*/
+void Fineline_File_System_Tree::set_item_style(Fl_Tree_Item *flti, uint32_t node)
+{
+   fl_file_record_t *flrec = tree_model.get_record(node);
+
+   if ((flrec != NULL) && (flrec->marked == 1))
+   {
+      flti->labelcolor(FL_DARK_GREEN);
+      flti->labelfont(FL_COURIER_BOLD);
+   }
+   else
+   {
+      flti->labelcolor((tree_model.get_flags(node) & FL_TREE_NODE_HIGHLIGHT) ? FL_RED : FL_FOREGROUND_COLOR);
+      flti->labelfont(FL_HELVETICA);
+   }
+   flti->usericon(tree_model.is_directory(node) ? &L_folderpixmap : &L_documentpixmap);
+
+   return;
 }
-
 
 /*
    Name   : add_file_map()
    Purpose: Add a file map to the file system tree. Called from the search, filter
-          : and import dialogues to create or restore the file system tree.
-   Input  : File map containing records or every file in the file system.
+          : and import dialogues to create or restore the file system tree. Hidden
+          : files, such as files in the known good hash set, are not added.
+   Input  : File map snapshot containing records of every file in the file system.
    Output : None.
 */
-void Fineline_File_System_Tree::add_file_map(Fineline_File_Map &fmap)
+void Fineline_File_System_Tree::add_file_map(Fineline_File_Map fmap)
 {
-   // First clear the file system tree, copy the import map to our local map,
-   // then iterate over the map and add each node to file system tree.
-   clear();
-   file_map = fmap;
-   map< string, fl_file_record_t* >::iterator p = fmap.begin();
-
-   while (p != fmap.end())
+   size_t i;
+
+   // First clear the file system tree, share the snapshot as our index,
+   // then iterate over the index and add each node to the tree model and
+   // show the top level of the tree.
+   // The snapshot is still held by the caller so any later change to the
+   // tree copies the index and the snapshot is left untouched.
+   release_children(root());
+   tree_model.clear();
+   file_index = const_pointer_cast< Fineline_File_Index >(fmap);
+
+   for (i = 0; i < fmap->size(); i++)
    {
-      fl_file_record_t *flec = p->second;
-      add(flec->full_path);
-      p++;
+      if (fmap->get_record(i)->hidden == 0)
+         tree_model.add_path(string(fmap->get_path(i), fmap->get_path_length(i)), fmap->get_record(i));
    }
+   open_directory(root());
 }
 
 /*
@@ -193,14 +419,14 @@ fl_file_record_t *Fineline_File_System_Tree::find_file(string filename)
    {
       filename.erase(0, 5);  // Remove the tree ROOT/ label and path separator
    }
-   map< string, fl_file_record_t* >::iterator p = file_map.find(filename);
+   fl_file_record_t *flrec = file_index->find_file(filename);
 
-   if(p == file_map.end())
+   if (flrec == NULL)
    {
       cout << "Fineline_File_System_Tree::find_file() <INFO> " << filename << " is not in the tree." << endl;
       return(NULL);
    }
-   return(p->second);
+   return(flrec);
 }
 
 /*
@@ -212,7 +438,7 @@ fl_file_record_t *Fineline_File_System_Tree::find_file(string filename)
 int Fineline_File_System_Tree::remove_file(string filename)
 {
    //TODO:
-   return(file_map.size());
+   return(file_index->size());
 }
 
 /*
@@ -223,10 +449,13 @@ int Fineline_File_System_Tree::remove_file(string filename)
 */
 int Fineline_File_System_Tree::save_tree(Fineline_Progress_Dialog *pd, const char *filename)
 {
-   // Open the output file and iterate through the file map and write out each node.
+   // Open the output file and walk the tree model and write out each node,
+   // the directories that are not open in the widget are saved as well.
    string msg;
-   char file_path[FL_MAX_INPUT_STR];
-   Fl_Tree_Item *tip = first();
+   string file_path;
+   vector< uint32_t > node_stack;
+   vector< uint32_t > children;
+   uint32_t node, c;
    FILE *fp = fopen(filename, "w");
 
    if (fp == NULL)
@@ -240,11 +469,30 @@ int Fineline_File_System_Tree::save_tree(Fineline_Progress_Dialog *pd, const cha
    msg = "Saving file system tree to file: ";
    msg.append(filename);
    pd->add_progress_message(msg);
-   for (tip = first(); tip; tip = next(tip))
+
+   node_stack.push_back(FL_TREE_ROOT_NODE);
+   while (!node_stack.empty())
    {
-      item_pathname(file_path, FL_MAX_INPUT_STR, tip);
-      fprintf(fp, "%s\n", file_path);
+      node = node_stack.back();
+      node_stack.pop_back();
+
+      file_path = root()->label();
+      if (node != FL_TREE_ROOT_NODE)
+      {
+         file_path.append("/");
+         file_path.append(tree_model.get_path(node));
+      }
+      fprintf(fp, "%s\n", file_path.c_str());
       pd->add_progress_message(file_path);
+
+      children.clear();
+      tree_model.sort_children(node);
+      for (c = tree_model.get_first_child(node); c != FL_TREE_NO_NODE; c = tree_model.get_next_sibling(c))
+      {
+         if ((tree_model.get_flags(c) & FL_TREE_NODE_HIDDEN) == 0)
+            children.push_back(c);
+      }
+      node_stack.insert(node_stack.end(), children.rbegin(), children.rend());
    }
 
    fclose(fp);
@@ -269,7 +517,7 @@ int Fineline_File_System_Tree::print_tree()
 */
 int Fineline_File_System_Tree::tree_size()
 {
-   return(file_map.size());
+   return(file_index->size());
 }
 
 /*
@@ -280,68 +528,144 @@ int Fineline_File_System_Tree::tree_size()
 */
 int Fineline_File_System_Tree::clear_tree()
 {
-   clear();
-   file_map.clear();
-   return(file_map.size());
+   release_children(root());
+   tree_model.clear();
+   file_index = make_shared< Fineline_File_Index >();
+   return(file_index->size());
 }
 
+/*
+   Name   : assign_user_icons()
+   Purpose: Sets the icon and label style of every item in the widget.
+   Input  : None.
+   Output : None.
+*/
 void Fineline_File_System_Tree::assign_user_icons()
 {
-  static const char *L_folder_xpm[] = {
-      "11 11 3 1",
-      ".  c None",
-      "x  c #d8d833",
-      "@  c #808011",
-      "...........",
-      ".....@@@@..",
-      "....@xxxx@.",
-      "@@@@@xxxx@@",
-      "@xxxxxxxxx@",
-      "@xxxxxxxxx@",
-      "@xxxxxxxxx@",
-      "@xxxxxxxxx@",
-      "@xxxxxxxxx@",
-      "@xxxxxxxxx@",
-      "@@@@@@@@@@@"};
-  static Fl_Pixmap L_folderpixmap(L_folder_xpm);
-
-   static const char *L_document_xpm[] = {
-      "11 11 3 1",
-      ".  c None",
-      "x  c #d8d8f8",
-      "@  c #202060",
-      ".@@@@@@@@@.",
-      ".@xxxxxxx@.",
-      ".@xxxxxxx@.",
-      ".@xxxxxxx@.",
-      ".@xxxxxxx@.",
-      ".@xxxxxxx@.",
-      ".@xxxxxxx@.",
-      ".@xxxxxxx@.",
-      ".@xxxxxxx@.",
-      ".@xxxxxxx@.",
-      ".@@@@@@@@@."};
-   static Fl_Pixmap L_documentpixmap(L_document_xpm);
-
-  // Assign user icons to tree items
-   for ( Fl_Tree_Item *item = first(); item; item=item->next())
+   uint32_t node;
+
+   for (Fl_Tree_Item *item = first(); item; item = item->next())
    {
-      item->usericon(item->has_children() ? &L_folderpixmap : &L_documentpixmap);
+      node = get_item_node(item);
+      if (node != FL_TREE_NO_NODE)
+         set_item_style(item, node);
    }
-
 }
 
+/*
+   Name   : rebuild_tree()
+   Purpose: Rebuilds the items of the open directories in name order, called
+            when the image walk or a filter has finished adding files.
+   Input  : None.
+   Output : None.
+*/
 void Fineline_File_System_Tree::rebuild_tree()
 {
-   assign_user_icons();
+   open_directory(root());
    redraw();
 }
 
 
+/*
+   Name   : highlight_file()
+   Purpose: Shows a file node in red, used to show the files with content
+            search hits. Does nothing if the node is not in the tree.
+   Input  : Full tree path of the file.
+   Output : None.
+*/
+void Fineline_File_System_Tree::highlight_file(const char *file_path)
+{
+   uint32_t node = tree_model.find_path(file_path);
+   unordered_map< uint32_t, Fl_Tree_Item* >::iterator p;
+
+   if (node == FL_TREE_NO_NODE)
+      return;
+
+   tree_model.set_flags(node, FL_TREE_NODE_HIGHLIGHT);
+   p = tree_items.find(node);
+   if (p != tree_items.end())
+      set_item_style(p->second, node);
+
+   return;
+}
+
+/*
+   Name   : hide_file()
+   Purpose: Removes a file node from the tree but keeps its record in the
+            file map, used to hide the files in the known good hash set.
+   Input  : Full tree path of the file.
+   Output : None.
+*/
+void Fineline_File_System_Tree::hide_file(const char *file_path)
+{
+   uint32_t node = tree_model.find_path(file_path);
+   unordered_map< uint32_t, Fl_Tree_Item* >::iterator p;
+
+   if ((node == FL_TREE_NO_NODE) || (tree_model.get_child_count(node) > 0))
+      return;
+
+   tree_model.set_flags(node, FL_TREE_NODE_HIDDEN);
+   p = tree_items.find(node);
+   if (p != tree_items.end())
+   {
+      remove(p->second);
+      tree_items.erase(p);
+   }
+
+   return;
+}
+
+/*
+   Name   : build_search_index_task()
+   Purpose: Builds the trigram path index in a background thread, the
+            index is published to the tree when it is complete.
+   Input  : File system tree and the file index snapshot to index.
+   Output : None.
+*/
+static void build_search_index_task(Fineline_File_System_Tree *ffst, Fineline_File_Map fmap)
+{
+   shared_ptr< Fineline_Trigram_Index > tindex = make_shared< Fineline_Trigram_Index >();
+
+   if (tindex->build_index(fmap) == 0)
+   {
+      ffst->set_search_index(tindex);
+      Fineline_Log::print_log_entry("build_search_index() <INFO> Finished building the path search index.\n");
+   }
+}
+
+/*
+   Name   : build_search_index()
+   Purpose: Starts building the path search index from the current file
+            index. Called when the image walk finishes, the previous index
+            is used for searches until the new one is ready.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_File_System_Tree::build_search_index()
+{
+   thread(build_search_index_task, this, get_file_map()).detach();
+}
+
+shared_ptr< Fineline_Trigram_Index > Fineline_File_System_Tree::get_search_index()
+{
+   lock_guard<mutex> guard(search_index_lock);
+   return(search_index);
+}
+
+void Fineline_File_System_Tree::set_search_index(shared_ptr< Fineline_Trigram_Index > tindex)
+{
+   lock_guard<mutex> guard(search_index_lock);
+   search_index = tindex;
+}
+
 fl_file_record_t *Fineline_File_System_Tree::get_selected_file_record()
 {
-   //TODO: string selected_file_path = ???
-   return(NULL);
+   uint32_t node = get_item_node(first_selected_item());
+
+   if ((node == FL_TREE_NO_NODE) || (node == FL_TREE_ROOT_NODE))
+      return(NULL);
+
+   return(tree_model.get_record(node));
 }
 
 fl_file_record_t *Fineline_File_System_Tree::get_file_record(const char *file_path)
@@ -448,106 +772,65 @@ void Fineline_File_System_Tree::unmark_file()
    return;
 }
 
+/*
+   Name   : mark_children()
+   Purpose: Marks every file below a directory, including the files in
+            directories that are not open in the widget.
+   Input  : Tree item of the directory.
+   Output : None.
+*/
 void Fineline_File_System_Tree::mark_children(Fl_Tree_Item *flti)
 {
-   Fl_Tree_Item *fltc;
-   fl_file_record_t *flrec = NULL;
-   char file_path[FL_PATH_MAX]; // FL_PATH_MAX 2048 is an FLTK constant, Fineline FL_PATH_MAX_LENGTH 4096
-   string full_path;
-   int ccount, i;
+   uint32_t node = get_item_node(flti);
 
-   if ((ccount = flti->children()) > 0)
-   {
-      for (i = 0; i < ccount; i++)
-      {
-         fltc = flti->child(i);
-         if (fltc != 0)
-         {
-            if (item_pathname(file_path, FL_PATH_MAX, fltc) != 0)
-            {
-               Fineline_Log::print_log_entry("Fineline_File_System_Tree::mark_children() <ERROR> Could not get tree item path.");
-               fl_message(" <ERROR> Could not get tree item. ");
-               return;
-            }
+   if (node == FL_TREE_NO_NODE)
+      return;
 
-            full_path = file_path;
-            flrec = find_file(full_path);
-            if (flrec != NULL)
-            {
-               flrec->marked = 1;
-               fltc->labelcolor(FL_DARK_GREEN);
-               fltc->labelfont(FL_COURIER_BOLD);
-               if (flrec->file_type == TSK_FS_META_TYPE_DIR) //If a directory then mark all the files in the directory.
-               {
-                  mark_children(fltc);
-               }
-               Fl::awake();
-               Fineline_Log::print_log_entry("Fineline_File_System_Tree::mark_children() <INFO> marked file.");
-            }
-         }
-      }
-   }
+   tree_model.set_marked(node, 1);
+   assign_user_icons();
+   Fl::awake();
+   Fineline_Log::print_log_entry("Fineline_File_System_Tree::mark_children() <INFO> marked files.");
 }
 
 
 void Fineline_File_System_Tree::unmark_children(Fl_Tree_Item *flti)
 {
-   Fl_Tree_Item *fltc;
-   fl_file_record_t *flrec = NULL;
-   char file_path[FL_PATH_MAX]; // FL_PATH_MAX 2048 is an FLTK constant, Fineline FL_PATH_MAX_LENGTH 4096
-   string full_path;
-   int ccount, i;
+   uint32_t node = get_item_node(flti);
 
-   if ((ccount = flti->children()) > 0)
-   {
-      for (i = 0; i < ccount; i++)
-      {
-         fltc = flti->child(i);
-         if (fltc != 0)
-         {
-            if (item_pathname(file_path, FL_PATH_MAX, fltc) != 0)
-            {
-               Fineline_Log::print_log_entry("Fineline_File_System_Tree::unmark_children() <ERROR> Could not get tree item path.");
-               fl_message(" <ERROR> Could not get tree item. ");
-               return;
-            }
+   if (node == FL_TREE_NO_NODE)
+      return;
 
-            full_path = file_path;
-            flrec = find_file(full_path);
-            if (flrec != NULL)
-            {
-               flrec->marked = 0;
-               fltc->labelcolor(FL_FOREGROUND_COLOR);
-               fltc->labelfont(FL_HELVETICA);
-               if (flrec->file_type == TSK_FS_META_TYPE_DIR) //If a directory then mark all the files in the directory.
-               {
-                  unmark_children(fltc);
-               }
-               Fl::awake();
-               Fineline_Log::print_log_entry("Fineline_File_System_Tree::unmark_children() <INFO> unmarked file.");
-            }
-         }
-      }
-   }
+   tree_model.set_marked(node, 0);
+   assign_user_icons();
+   Fl::awake();
+   Fineline_Log::print_log_entry("Fineline_File_System_Tree::unmark_children() <INFO> unmarked files.");
 }
 
 vector< fl_file_record_t* > Fineline_File_System_Tree::get_marked_files()
 {
    vector< fl_file_record_t* > flist;
+   size_t i;
 
-   map < string, fl_file_record_t* >::iterator p = file_map.begin();
-
-   while (p != file_map.end())
+   file_index->sort_index();
+   for (i = 0; i < file_index->size(); i++)
    {
-      if (p->second->marked == 1)
-         flist.push_back(p->second);
-      p++;
+      if (file_index->get_record(i)->marked == 1)
+         flist.push_back(file_index->get_record(i));
    }
 
    return(flist);
 }
 
-map< string, fl_file_record_t* > Fineline_File_System_Tree::get_file_map()
+/*
+   Name   : get_file_map()
+   Purpose: Get a read only snapshot of the file index. The snapshot is shared,
+            not copied, and stays valid and unchanged while it is held even if
+            the tree is cleared or modified.
+   Input  : None.
+   Output : The sorted file index snapshot.
+*/
+Fineline_File_Map Fineline_File_System_Tree::get_file_map()
 {
-   return(file_map);
+   file_index->sort_index();
+   return(file_index);
 }
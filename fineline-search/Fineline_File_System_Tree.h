@@ -37,17 +37,22 @@
 
 #include <string>
 #include <vector>
-#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include <FL/Fl.H>
 #include <FL/Fl_Tree.H>
 
 #include "fineline-search.h"
 #include "Fineline_Progress_Dialog.h"
+#include "Fineline_File_Index.h"
+#include "Fineline_Tree_Model.h"
+#include "Fineline_Trigram_Index.h"
+
+#define FL_TREE_PLACEHOLDER "..."   /* label of the item that makes a closed directory openable */
 
 using namespace std;
-
-typedef map< string, fl_file_record_t* > Fineline_File_Map;
 
 class Fineline_File_System_Tree : public Fl_Tree
 {
@@ -58,8 +63,9 @@ class Fineline_File_System_Tree : public Fl_Tree
 
       static void file_system_tree_callback(Fl_Tree *flt, void *p);
       int add_file(string filename, fl_file_record_t *flrp);
-      void add_file_nodes(string file_path);
-      void add_file_map(Fineline_File_Map &fmap);
+      void open_directory(Fl_Tree_Item *flti);
+      void close_directory(Fl_Tree_Item *flti);
+      void add_file_map(Fineline_File_Map fmap);
       fl_file_record_t *find_file(string filename);
       fl_file_record_t *get_file_record(const char *file_path);
       fl_file_record_t *get_selected_file_record();
@@ -77,12 +83,28 @@ class Fineline_File_System_Tree : public Fl_Tree
       int print_tree();
       void assign_user_icons();
       void rebuild_tree();
+      void highlight_file(const char *file_path);
+      void hide_file(const char *file_path);
+      void build_search_index();
+      shared_ptr< Fineline_Trigram_Index > get_search_index();
+      void set_search_index(shared_ptr< Fineline_Trigram_Index > tindex);
 
 
    protected:
    private:
 
-      Fineline_File_Map file_map;
+      void copy_index_on_write();
+      uint32_t get_item_node(Fl_Tree_Item *flti);
+      Fl_Tree_Item *add_item(Fl_Tree_Item *parent_item, uint32_t node);
+      void show_node(uint32_t node);
+      void release_children(Fl_Tree_Item *flti);
+      void set_item_style(Fl_Tree_Item *flti, uint32_t node);
+
+      shared_ptr< Fineline_File_Index > file_index;
+      Fineline_Tree_Model tree_model;
+      unordered_map< uint32_t, Fl_Tree_Item* > tree_items;  /* model node -> item, only the nodes shown in the widget */
+      shared_ptr< Fineline_Trigram_Index > search_index;  /* path search index of the whole image, built in the background */
+      mutex search_index_lock;
 
 };
 
@@ -0,0 +1,714 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Mft_Scanner.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Sequential $MFT scan of an NTFS file system. The FILE records are
+            decoded without TSK, only the $MFT content is read through TSK so
+            a fragmented $MFT is still read in order.
+
+            FILE record layout used here (all values little endian):
+               0x00 "FILE", 0x04 update sequence offset, 0x06 update sequence count,
+               0x10 sequence number, 0x14 first attribute offset, 0x16 flags
+               (1 = in use, 2 = directory), 0x18 bytes used, 0x20 base record.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Fineline_Mft_Scanner.h"
+#include "Fineline_Log.h"
+#include "../common/Fineline_Util.h"
+
+#define FL_MFT_ATTR_STANDARD_INFORMATION 0x10
+#define FL_MFT_ATTR_FILE_NAME            0x30
+#define FL_MFT_ATTR_DATA                 0x80
+#define FL_MFT_ATTR_END                  0xFFFFFFFF
+
+#define FL_MFT_NAMESPACE_DOS             2
+#define FL_MFT_REFERENCE_MASK            0x0000FFFFFFFFFFFFULL
+#define FL_MFT_FILETIME_EPOCH            11644473600LL   /* seconds from 1601 to 1970 */
+
+#define FL_MFT_STATE_NEW                 0
+#define FL_MFT_STATE_OPEN                1   /* on the parent chain being resolved */
+#define FL_MFT_STATE_DONE                2
+
+static inline uint16_t get_16(const unsigned char *p)
+{
+   return((uint16_t)(p[0] | (p[1] << 8)));
+}
+
+static inline uint32_t get_32(const unsigned char *p)
+{
+   return((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+static inline uint64_t get_64(const unsigned char *p)
+{
+   return((uint64_t)get_32(p) | ((uint64_t)get_32(p + 4) << 32));
+}
+
+Fineline_Mft_Scanner::Fineline_Mft_Scanner(Fineline_File_Arena *arena, int fs_id)
+{
+   file_arena = arena;
+   file_system_id = fs_id;
+   file_name_events = 1;
+   cancel_flag = NULL;
+   directory_count = 0;
+   file_count = 0;
+   deleted_count = 0;
+}
+
+Fineline_Mft_Scanner::~Fineline_Mft_Scanner()
+{
+   //dtor, the records belong to the arena
+}
+
+/*
+   Function: apply_fixups
+   Purpose : Checks the update sequence number at the end of each 512 byte
+             stride of a FILE record and puts back the original bytes.
+   Input   : Record buffer and record size.
+   Output  : Returns 0 on success, -1 if the record is torn or corrupt.
+*/
+int Fineline_Mft_Scanner::apply_fixups(unsigned char *data, size_t record_size)
+{
+   size_t usa_offset = get_16(data + 4);
+   size_t usa_count = get_16(data + 6);
+   size_t i;
+   unsigned char *p;
+
+   if ((usa_count < 2) || (usa_offset + (usa_count * 2) > record_size) || ((usa_count - 1) * FL_MFT_FIXUP_STRIDE > record_size))
+      return(-1);
+
+   for (i = 1; i < usa_count; i++)
+   {
+      p = data + (i * FL_MFT_FIXUP_STRIDE) - 2;
+      if ((p[0] != data[usa_offset]) || (p[1] != data[usa_offset + 1]))
+         return(-1);
+      p[0] = data[usa_offset + (i * 2)];
+      p[1] = data[usa_offset + (i * 2) + 1];
+   }
+
+   return(0);
+}
+
+/*
+   Function: filetime_to_unix
+   Purpose : Converts an NTFS time, 100 nanosecond intervals since 1601, to a unix time.
+   Input   : NTFS time.
+   Output  : Seconds since 1970, 0 if the time is not set.
+*/
+int64_t Fineline_Mft_Scanner::filetime_to_unix(uint64_t filetime)
+{
+   if (filetime == 0)
+      return(0);
+
+   return((int64_t)(filetime / 10000000) - FL_MFT_FILETIME_EPOCH);
+}
+
+/*
+   Function: utf16_to_utf8
+   Purpose : Converts an NTFS file name to UTF-8, unpaired surrogates become '?'.
+   Input   : UTF-16LE name and the number of UTF-16 units.
+   Output  : The UTF-8 name.
+*/
+string Fineline_Mft_Scanner::utf16_to_utf8(const unsigned char *name, size_t length)
+{
+   string utf8;
+   uint32_t c, c2;
+   size_t i;
+
+   utf8.reserve(length);
+
+   for (i = 0; i < length; i++)
+   {
+      c = get_16(name + (i * 2));
+      if ((c >= 0xD800) && (c <= 0xDBFF) && (i + 1 < length))
+      {
+         c2 = get_16(name + ((i + 1) * 2));
+         if ((c2 >= 0xDC00) && (c2 <= 0xDFFF))
+         {
+            c = 0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00);
+            i++;
+         }
+      }
+      if ((c >= 0xD800) && (c <= 0xDFFF))
+         c = '?';
+
+      if (c < 0x80)
+      {
+         utf8.push_back((char)c);
+      }
+      else if (c < 0x800)
+      {
+         utf8.push_back((char)(0xC0 | (c >> 6)));
+         utf8.push_back((char)(0x80 | (c & 0x3F)));
+      }
+      else if (c < 0x10000)
+      {
+         utf8.push_back((char)(0xE0 | (c >> 12)));
+         utf8.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+         utf8.push_back((char)(0x80 | (c & 0x3F)));
+      }
+      else
+      {
+         utf8.push_back((char)(0xF0 | (c >> 18)));
+         utf8.push_back((char)(0x80 | ((c >> 12) & 0x3F)));
+         utf8.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+         utf8.push_back((char)(0x80 | (c & 0x3F)));
+      }
+   }
+
+   return(utf8);
+}
+
+/*
+   Function: add_mac_events
+   Purpose : Adds the $FILE_NAME times of a file to the event list, times that
+             are the same are combined into one event.
+   Input   : File record and the modified, accessed, changed and born times.
+   Output  : None.
+*/
+void Fineline_Mft_Scanner::add_mac_events(fl_file_record_t *flrec, const int64_t *times)
+{
+   static const int mac_flags[4] = { FL_MAC_MODIFIED, FL_MAC_ACCESSED, FL_MAC_CHANGED, FL_MAC_BORN };
+   fl_mac_event_t event;
+   int i, j;
+
+   for (i = 0; i < 4; i++)
+   {
+      if (times[i] == 0)
+         continue;
+
+      for (j = 0; j < i; j++)
+      {
+         if (times[j] == times[i])
+            break;
+      }
+      if (j < i) // already added with an earlier flag
+         continue;
+
+      event.event_time = times[i];
+      event.record = flrec;
+      event.flags = FL_MAC_FILE_NAME;
+      for (j = i; j < 4; j++)
+      {
+         if (times[j] == times[i])
+            event.flags |= mac_flags[j];
+      }
+      event_list.push_back(event);
+   }
+
+   return;
+}
+
+/*
+   Function: decode_attributes
+   Purpose : Decodes the attributes of a FILE record. The best file name is
+             taken from the $FILE_NAME attributes, a DOS 8.3 name is only
+             used if there is no other.
+   Input   : Record buffer with the fixups applied, the record size and the
+             attributes to fill in.
+   Output  : None.
+*/
+void Fineline_Mft_Scanner::decode_attributes(const unsigned char *data, size_t record_size, fl_mft_attributes_t *attrs)
+{
+   const unsigned char *attr;
+   const unsigned char *content;
+   size_t offset, used_size, attr_length, content_size;
+   uint32_t attr_type;
+
+   memset(attrs, 0, sizeof(fl_mft_attributes_t));
+   attrs->name_space = -1;
+   attrs->record_flags = get_16(data + 0x16);
+   attrs->sequence = get_16(data + 0x10);
+
+   used_size = get_32(data + 0x18);
+   if (used_size > record_size)
+      used_size = record_size;
+   offset = get_16(data + 0x14);
+
+   while (offset + 16 <= used_size)
+   {
+      attr = data + offset;
+      attr_type = get_32(attr);
+      if (attr_type == FL_MFT_ATTR_END)
+         break;
+      attr_length = get_32(attr + 4);
+      if ((attr_length < 16) || (offset + attr_length > used_size))
+         break;
+
+      if (attr[8] == 0) // resident
+      {
+         content_size = get_32(attr + 0x10);
+         content = attr + get_16(attr + 0x14);
+         if ((size_t)(content - attr) + content_size > attr_length)
+         {
+            offset += attr_length;
+            continue;
+         }
+
+         if ((attr_type == FL_MFT_ATTR_STANDARD_INFORMATION) && (content_size >= 0x20))
+         {
+            attrs->si_times[0] = filetime_to_unix(get_64(content + 0x08));
+            attrs->si_times[1] = filetime_to_unix(get_64(content + 0x18));
+            attrs->si_times[2] = filetime_to_unix(get_64(content + 0x10));
+            attrs->si_times[3] = filetime_to_unix(get_64(content));
+            attrs->have_si = 1;
+         }
+         else if ((attr_type == FL_MFT_ATTR_FILE_NAME) && (content_size >= 0x42) && (0x42 + ((size_t)content[0x40] * 2) <= content_size))
+         {
+            if ((attrs->name == NULL) || ((attrs->name_space == FL_MFT_NAMESPACE_DOS) && (content[0x41] != FL_MFT_NAMESPACE_DOS)))
+            {
+               attrs->name = content + 0x42;
+               attrs->name_length = content[0x40];
+               attrs->name_space = content[0x41];
+               attrs->parent_reference = get_64(content);
+               attrs->fn_times[0] = filetime_to_unix(get_64(content + 0x10));
+               attrs->fn_times[1] = filetime_to_unix(get_64(content + 0x20));
+               attrs->fn_times[2] = filetime_to_unix(get_64(content + 0x18));
+               attrs->fn_times[3] = filetime_to_unix(get_64(content + 0x08));
+               attrs->fn_size = (int64_t)get_64(content + 0x30);
+            }
+         }
+         else if ((attr_type == FL_MFT_ATTR_DATA) && (attr[9] == 0) && (attrs->have_data == 0))
+         {
+            attrs->data_size = (int64_t)content_size;
+            attrs->data_id = get_16(attr + 0x0E);
+            attrs->have_data = 1;
+         }
+      }
+      else if ((attr_type == FL_MFT_ATTR_DATA) && (attr[9] == 0) && (attrs->have_data == 0) && (attr_length >= 0x40))
+      {
+         // Only the first run of a non resident attribute has the sizes.
+         if (get_64(attr + 0x10) == 0)
+         {
+            attrs->data_size = (int64_t)get_64(attr + 0x30);
+            attrs->data_id = get_16(attr + 0x0E);
+            attrs->have_data = 1;
+         }
+      }
+
+      offset += attr_length;
+   }
+
+   return;
+}
+
+/*
+   Function: add_file_record
+   Purpose : Creates the file record of a decoded MFT entry, the root
+             directory only gets an entry for the parent references.
+   Input   : MFT entry number, the decoded attributes and the UTF-8 file name.
+   Output  : Returns 1 if a file record was created, 0 for the root directory.
+*/
+int Fineline_Mft_Scanner::add_file_record(uint64_t entry_number, const fl_mft_attributes_t *attrs, const string &file_name)
+{
+   fl_mft_entry_t entry;
+   fl_file_record_t *flrec;
+
+   if (entry_number >= entry_table.size())
+   {
+      entry.record = NULL;
+      entry.parent_entry = 0;
+      entry.parent_sequence = 0;
+      entry.sequence = 0;
+      entry.flags = 0;
+      entry.state = FL_MFT_STATE_NEW;
+      entry_table.resize(entry_number + 1, entry);
+   }
+
+   entry.record = NULL;
+   entry.parent_entry = attrs->parent_reference & FL_MFT_REFERENCE_MASK;
+   entry.parent_sequence = (uint16_t)(attrs->parent_reference >> 48);
+   entry.sequence = attrs->sequence;
+   entry.flags = FL_MFT_ENTRY_VALID;
+   entry.state = FL_MFT_STATE_NEW;
+   if (attrs->record_flags & 0x01)
+      entry.flags |= FL_MFT_ENTRY_IN_USE;
+   if (attrs->record_flags & 0x02)
+      entry.flags |= FL_MFT_ENTRY_DIRECTORY;
+
+   if (entry_number == FL_MFT_ROOT_ENTRY)
+   {
+      entry_table[entry_number] = entry;
+      return(0);
+   }
+
+   flrec = file_arena->new_record();
+   file_arena->set_file_name(flrec, file_name);
+   flrec->meta_address = entry_number;
+   flrec->file_system_id = file_system_id;
+   flrec->deleted = (attrs->record_flags & 0x01) ? 0 : 1;
+   flrec->file_size = attrs->have_data ? attrs->data_size : attrs->fn_size;
+   if (attrs->have_si)
+   {
+      flrec->modification_time = attrs->si_times[0];
+      flrec->access_time = attrs->si_times[1];
+      flrec->change_time = attrs->si_times[2];
+      flrec->creation_time = attrs->si_times[3];
+   }
+   else
+   {
+      flrec->modification_time = attrs->fn_times[0];
+      flrec->access_time = attrs->fn_times[1];
+      flrec->change_time = attrs->fn_times[2];
+      flrec->creation_time = attrs->fn_times[3];
+   }
+
+   if (attrs->record_flags & 0x02)
+   {
+      flrec->file_type = TSK_FS_META_TYPE_DIR;
+      directory_count++;
+   }
+   else
+   {
+      flrec->file_type = TSK_FS_META_TYPE_REG;
+      if (attrs->have_data)
+      {
+         flrec->attribute_type = (uint16_t)TSK_FS_ATTR_TYPE_NTFS_DATA;
+         flrec->attribute_id = attrs->data_id;
+      }
+   }
+   file_count++;
+   if (flrec->deleted)
+      deleted_count++;
+
+   entry.record = flrec;
+   entry_table[entry_number] = entry;
+   record_list.push_back(flrec);
+
+   if (file_name_events)
+      add_mac_events(flrec, attrs->fn_times);
+
+   return(1);
+}
+
+/*
+   Function: decode_record
+   Purpose : Decodes one FILE record and creates its file record. A base
+             record whose $FILE_NAME is only in an extension record is kept
+             until resolve_parents() so it can be named from the extension,
+             the $FILE_NAME of an extension record is kept for its base
+             record. The root directory is not listed.
+   Input   : Record buffer, the record size and the MFT entry number.
+   Output  : Returns 1 if a file record was created, 0 if the entry is not
+             listed now, -1 if it is not a valid FILE record.
+*/
+int Fineline_Mft_Scanner::decode_record(unsigned char *data, size_t record_size, uint64_t entry_number)
+{
+   fl_mft_attributes_t attrs;
+   fl_mft_extension_name_t *extension;
+   uint64_t base_entry;
+
+   if ((record_size < 64) || (memcmp(data, "FILE", 4) != 0))
+      return(-1);
+   if (apply_fixups(data, record_size) == -1)
+      return(-1);
+
+   decode_attributes(data, record_size, &attrs);
+
+   base_entry = get_64(data + 0x20) & FL_MFT_REFERENCE_MASK;
+   if (base_entry != 0) // extension of another record
+   {
+      if (attrs.name == NULL)
+         return(0);
+      extension = &extension_names[base_entry];
+      if (extension->name.empty() || ((extension->name_space == FL_MFT_NAMESPACE_DOS) && (attrs.name_space != FL_MFT_NAMESPACE_DOS)))
+      {
+         extension->name = utf16_to_utf8(attrs.name, attrs.name_length);
+         extension->name_space = attrs.name_space;
+         extension->parent_reference = attrs.parent_reference;
+         memcpy(extension->fn_times, attrs.fn_times, sizeof(attrs.fn_times));
+         extension->fn_size = attrs.fn_size;
+      }
+      return(0);
+   }
+
+   if (attrs.name == NULL)
+   {
+      // Unused records have no attributes, a base record always has its $STANDARD_INFORMATION.
+      if (attrs.have_si)
+         unnamed_entries[entry_number] = attrs;
+      return(0);
+   }
+
+   return(add_file_record(entry_number, &attrs, utf16_to_utf8(attrs.name, attrs.name_length)));
+}
+
+/*
+   Function: add_extension_names
+   Purpose : Creates the file records of the base records that have no
+             $FILE_NAME of their own from the $FILE_NAME found in one of
+             their extension records.
+   Input   : None.
+   Output  : Returns the number of file records created.
+*/
+long Fineline_Mft_Scanner::add_extension_names()
+{
+   map<uint64_t, fl_mft_attributes_t>::iterator p;
+   unordered_map<uint64_t, fl_mft_extension_name_t>::iterator q;
+   fl_mft_attributes_t *attrs;
+   long added = 0;
+
+   for (p = unnamed_entries.begin(); p != unnamed_entries.end(); ++p)
+   {
+      q = extension_names.find(p->first);
+      if (q == extension_names.end())
+         continue;
+
+      attrs = &p->second;
+      attrs->name_space = q->second.name_space;
+      attrs->parent_reference = q->second.parent_reference;
+      memcpy(attrs->fn_times, q->second.fn_times, sizeof(attrs->fn_times));
+      attrs->fn_size = q->second.fn_size;
+      added += add_file_record(p->first, attrs, q->second.name);
+   }
+   unnamed_entries.clear();
+   extension_names.clear();
+
+   return(added);
+}
+
+/*
+   Function: resolve_parents
+   Purpose : Links every file record to the record of its parent directory,
+             after naming the base records from their extension records.
+             Entries whose parent is missing, is not a directory, has been
+             reused since (sequence number differs) or is part of a loop go
+             under the orphan files directory. NTFS increments the sequence
+             number when a record is freed, so a parent that is not in use
+             also matches the sequence number before it was freed.
+   Input   : None.
+   Output  : Returns the number of orphan records.
+*/
+long Fineline_Mft_Scanner::resolve_parents()
+{
+   vector<uint64_t> chain;
+   const char *orphan_path = file_arena->intern_string(FL_MFT_ORPHAN_PATH, strlen(FL_MFT_ORPHAN_PATH));
+   fl_mft_entry_t *entry;
+   fl_mft_entry_t *parent;
+   uint64_t i, j;
+   long orphan_count = 0;
+   size_t k;
+
+   add_extension_names();
+
+   for (i = 0; i < entry_table.size(); i++)
+   {
+      j = i;
+      chain.clear();
+
+      while ((entry_table[j].record != NULL) && (entry_table[j].state == FL_MFT_STATE_NEW))
+      {
+         entry = &entry_table[j];
+         entry->state = FL_MFT_STATE_OPEN;
+         chain.push_back(j);
+
+         if (entry->parent_entry == FL_MFT_ROOT_ENTRY)
+            break; // files in the root directory have no parent record
+
+         parent = NULL;
+         if ((entry->parent_entry < entry_table.size()) && (entry->parent_entry != j))
+            parent = &entry_table[entry->parent_entry];
+
+         if ((parent == NULL) || ((parent->flags & FL_MFT_ENTRY_DIRECTORY) == 0) || (parent->record == NULL) ||
+             ((parent->sequence != entry->parent_sequence) &&
+              ((parent->flags & FL_MFT_ENTRY_IN_USE) || (parent->sequence != (uint16_t)(entry->parent_sequence + 1)))) ||
+             (parent->state == FL_MFT_STATE_OPEN))
+         {
+            entry->record->file_path = orphan_path;
+            orphan_count++;
+            break;
+         }
+
+         entry->record->parent = parent->record;
+         j = entry->parent_entry;
+      }
+
+      for (k = 0; k < chain.size(); k++)
+         entry_table[chain[k]].state = FL_MFT_STATE_DONE;
+   }
+
+   return(orphan_count);
+}
+
+/*
+   Function: read_boot_sector
+   Purpose : Gets the MFT record size from the NTFS boot sector.
+   Input   : File system handle and the record size to fill in.
+   Output  : Returns 0 on success, -1 if the boot sector is not NTFS.
+*/
+int Fineline_Mft_Scanner::read_boot_sector(TskFsInfo *fs_info, size_t *record_size)
+{
+   unsigned char boot[512];
+   size_t cluster_size;
+   int sectors_per_cluster;
+   int clusters_per_record;
+
+   if (fs_info->read(0, (char *)boot, 512) != 512)
+      return(-1);
+   if (memcmp(boot + 3, "NTFS", 4) != 0)
+      return(-1);
+
+   sectors_per_cluster = boot[0x0D];
+   if (sectors_per_cluster > 0x80) // large clusters are stored as a negative power of 2
+   {
+      if (256 - sectors_per_cluster > 31)
+         return(-1);
+      sectors_per_cluster = 1 << (256 - sectors_per_cluster);
+   }
+   cluster_size = (size_t)get_16(boot + 0x0B) * sectors_per_cluster;
+
+   clusters_per_record = (signed char)boot[0x40];
+   if (clusters_per_record > 0)
+      *record_size = cluster_size * clusters_per_record;
+   else if (-clusters_per_record <= 16)
+      *record_size = (size_t)1 << (-clusters_per_record);
+   else
+      return(-1);
+
+   if ((*record_size < 256) || (*record_size > 65536) || ((*record_size % FL_MFT_FIXUP_STRIDE) != 0))
+      return(-1);
+
+   return(0);
+}
+
+/*
+   Function: scan
+   Purpose : Reads the $MFT from start to end in large blocks, decodes every
+             FILE record and then links the records to their parent directories.
+             The cancel flag is checked before each block is read.
+   Input   : NTFS file system handle.
+   Output  : Returns the number of file records, -1 on error or if cancelled.
+*/
+long Fineline_Mft_Scanner::scan(TskFsInfo *fs_info)
+{
+   TskFsFile *mft_file;
+   unsigned char *buffer;
+   size_t record_size = 0;
+   size_t read_size;
+   size_t i;
+   int64_t mft_size;
+   int64_t offset = 0;
+   ssize_t length;
+   char msg[256];
+
+   if (read_boot_sector(fs_info, &record_size) == -1)
+   {
+      Fineline_Log::print_log_entry("Fineline_Mft_Scanner::scan() <ERROR> Not an NTFS boot sector.\n");
+      return(-1);
+   }
+
+   mft_file = new TskFsFile();
+   if (mft_file->open(fs_info, mft_file, (TSK_INUM_T)0) || (mft_file->getMeta() == NULL))
+   {
+      Fineline_Log::print_log_entry("Fineline_Mft_Scanner::scan() <ERROR> Could not open $MFT.\n");
+      delete mft_file;
+      return(-1);
+   }
+
+   mft_size = (int64_t)mft_file->getMeta()->getSize();
+   entry_table.reserve((size_t)(mft_size / record_size));
+   read_size = FL_MFT_READ_SIZE - (FL_MFT_READ_SIZE % record_size);
+   buffer = (unsigned char *)Fineline_Util::xmalloc(read_size);
+
+   while (offset < mft_size)
+   {
+      if ((cancel_flag != NULL) && (cancel_flag->load() != 0))
+      {
+         offset = 0;
+         break;
+      }
+      length = mft_file->read(offset, (char *)buffer, read_size, TSK_FS_FILE_READ_FLAG_NONE);
+      if (length <= 0)
+      {
+         sprintf(msg, "Fineline_Mft_Scanner::scan() <ERROR> Could not read $MFT at offset %lld\n", (long long)offset);
+         Fineline_Log::print_log_entry(msg);
+         break;
+      }
+
+      for (i = 0; i + record_size <= (size_t)length; i += record_size)
+         decode_record(buffer + i, record_size, (uint64_t)((offset + i) / record_size));
+
+      offset += (length - (length % record_size));
+      if ((size_t)length < record_size)
+         break;
+   }
+
+   Fineline_Util::xfree((char *)buffer, read_size);
+   delete mft_file;
+
+   if (offset == 0)
+      return(-1);
+
+   resolve_parents();
+
+   return((long)record_list.size());
+}
+
+void Fineline_Mft_Scanner::set_file_name_events(int events)
+{
+   file_name_events = events;
+}
+
+/*
+   Function: set_cancel_flag
+   Purpose : Sets the flag another thread sets to stop the scan.
+   Input   : Cancel flag, NULL if the scan cannot be cancelled.
+   Output  : None.
+*/
+void Fineline_Mft_Scanner::set_cancel_flag(const atomic<int> *cancel)
+{
+   cancel_flag = cancel;
+}
+
+const vector<fl_file_record_t *> &Fineline_Mft_Scanner::get_records()
+{
+   return(record_list);
+}
+
+const vector<fl_mac_event_t> &Fineline_Mft_Scanner::get_mac_events()
+{
+   return(event_list);
+}
+
+long Fineline_Mft_Scanner::get_directory_count()
+{
+   return(directory_count);
+}
+
+long Fineline_Mft_Scanner::get_file_count()
+{
+   return(file_count);
+}
+
+long Fineline_Mft_Scanner::get_deleted_count()
+{
+   return(deleted_count);
+}
@@ -0,0 +1,154 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Mft_Scanner.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Fast file listing for NTFS file systems. Instead of walking the
+            directory tree, which reads the MFT in random order, the $MFT file
+            is read from start to end in large blocks and each FILE record is
+            decoded directly. The $STANDARD_INFORMATION times are stored in the
+            file records and the $FILE_NAME times are kept as MAC timeline
+            events. Full paths are rebuilt from the parent references in the
+            $FILE_NAME attributes once every record has been read, deleted
+            records that still hold their attributes are listed as well.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#ifndef FINELINE_MFT_SCANNER_H
+#define FINELINE_MFT_SCANNER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <atomic>
+
+#include <stdint.h>
+#include <tsk/libtsk.h>
+
+#include "fineline-search.h"
+#include "Fineline_File_Arena.h"
+
+#define FL_MFT_READ_SIZE       4194304   /* bytes of the $MFT read at a time */
+#define FL_MFT_ROOT_ENTRY      5         /* MFT entry of the root directory */
+#define FL_MFT_FIXUP_STRIDE    512       /* bytes covered by each update sequence entry */
+#define FL_MFT_ORPHAN_PATH     "$OrphanFiles/"
+
+#define FL_MFT_ENTRY_VALID     1         /* FILE record decoded with a file name */
+#define FL_MFT_ENTRY_IN_USE    2
+#define FL_MFT_ENTRY_DIRECTORY 4
+
+using namespace std;
+
+/* Decoded MFT entry, the parent reference is resolved to a record when the scan completes. */
+struct fl_mft_entry
+{
+   fl_file_record_t *record;
+   uint64_t parent_entry;
+   uint16_t parent_sequence;
+   uint16_t sequence;
+   uint16_t flags;
+   uint16_t state;                  /* used while resolving the parent chains */
+};
+typedef struct fl_mft_entry fl_mft_entry_t;
+
+/* Attributes decoded from one FILE record. */
+struct fl_mft_attributes
+{
+   const unsigned char *name;       /* UTF-16LE $FILE_NAME in the record buffer, NULL if there is none */
+   size_t name_length;
+   int name_space;
+   uint64_t parent_reference;
+   int64_t fn_times[4];             /* modified, accessed, changed, born */
+   int64_t fn_size;
+   int64_t si_times[4];
+   int have_si;
+   int have_data;
+   int64_t data_size;
+   uint16_t data_id;
+   uint16_t record_flags;
+   uint16_t sequence;
+};
+typedef struct fl_mft_attributes fl_mft_attributes_t;
+
+/* $FILE_NAME of a base record found in one of its extension records. */
+struct fl_mft_extension_name
+{
+   string name;
+   int name_space;
+   uint64_t parent_reference;
+   int64_t fn_times[4];
+   int64_t fn_size;
+};
+typedef struct fl_mft_extension_name fl_mft_extension_name_t;
+
+class Fineline_Mft_Scanner
+{
+   public:
+      Fineline_Mft_Scanner(Fineline_File_Arena *arena, int file_system_id);
+      virtual ~Fineline_Mft_Scanner();
+
+      long scan(TskFsInfo *fs_info);
+      int decode_record(unsigned char *data, size_t record_size, uint64_t entry_number);
+      long resolve_parents();
+      void set_file_name_events(int events);
+      void set_cancel_flag(const atomic<int> *cancel);
+
+      const vector<fl_file_record_t *> &get_records();
+      const vector<fl_mac_event_t> &get_mac_events();
+      long get_directory_count();
+      long get_file_count();
+      long get_deleted_count();
+
+      static int apply_fixups(unsigned char *data, size_t record_size);
+      static int64_t filetime_to_unix(uint64_t filetime);
+      static string utf16_to_utf8(const unsigned char *name, size_t length);
+
+   protected:
+   private:
+
+      int read_boot_sector(TskFsInfo *fs_info, size_t *record_size);
+      void decode_attributes(const unsigned char *data, size_t record_size, fl_mft_attributes_t *attrs);
+      int add_file_record(uint64_t entry_number, const fl_mft_attributes_t *attrs, const string &file_name);
+      long add_extension_names();
+      void add_mac_events(fl_file_record_t *flrec, const int64_t *times);
+
+      Fineline_File_Arena *file_arena;
+      int file_system_id;
+      int file_name_events;
+      const atomic<int> *cancel_flag;         /* stops the scan when set, NULL if the scan cannot be cancelled */
+
+      vector<fl_mft_entry_t> entry_table;     /* MFT entry number -> decoded entry */
+      vector<fl_file_record_t *> record_list; /* records in MFT entry order, then the records named from extension records */
+      map<uint64_t, fl_mft_attributes_t> unnamed_entries;                /* base records without a $FILE_NAME, the name is not set */
+      unordered_map<uint64_t, fl_mft_extension_name_t> extension_names;  /* base MFT entry -> $FILE_NAME from an extension record */
+      vector<fl_mac_event_t> event_list;
+      long directory_count;
+      long file_count;
+      long deleted_count;
+};
+
+#endif // FINELINE_MFT_SCANNER_H
@@ -32,20 +32,132 @@
 
 */
 
+#ifdef LINUX_BUILD
+#define _FILE_OFFSET_BITS 64
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <iostream>
+#include <unordered_map>
+
+#ifdef LINUX_BUILD
+#include <sys/types.h>
+#define fle_fseek(f, o, w) fseeko(f, (off_t)(o), w)
+#define fle_ftell(f) ((int64_t)ftello(f))
+#else
+#define fle_fseek(f, o, w) _fseeki64(f, (__int64)(o), w)
+#define fle_ftell(f) ((int64_t)_ftelli64(f))
+#endif
 
 #include <FL/fl_ask.H>
 
 #include "Fineline_Project.h"
 #include "Fineline_Log.h"
 
+/*
+   Function: section_checksum
+   Purpose : FNV-1a checksum of a section, used to find damaged sections and
+             sections that have not changed since they were saved.
+   Input   : Section data.
+   Output  : The checksum.
+*/
+static uint32_t section_checksum(const vector<char> &data)
+{
+   uint32_t hash = 2166136261u;
+   size_t i;
+
+   for (i = 0; i < data.size(); i++)
+   {
+      hash ^= (unsigned char)data[i];
+      hash *= 16777619u;
+   }
+
+   return(hash);
+}
+
+static void put_bytes(vector<char> &data, const void *p, size_t length)
+{
+   data.insert(data.end(), (const char *)p, (const char *)p + length);
+}
+
+static void put_u32(vector<char> &data, uint32_t value)
+{
+   put_bytes(data, &value, sizeof(value));
+}
+
+static void put_i64(vector<char> &data, int64_t value)
+{
+   put_bytes(data, &value, sizeof(value));
+}
+
+static void put_string(vector<char> &data, const char *str, size_t length)
+{
+   put_u32(data, (uint32_t)length);
+   if (length > 0)
+      put_bytes(data, str, length);
+}
+
+/* Reads the values of a section back in order, reading past the end sets failed. */
+struct fl_section_reader
+{
+   const char *next;
+   const char *end;
+   int failed;
+
+   fl_section_reader(const vector<char> &data) : next(data.data()), end(data.data() + data.size()), failed(0) {}
+
+   void get_bytes(void *p, size_t length)
+   {
+      if ((size_t)(end - next) < length)
+      {
+         memset(p, 0, length);
+         next = end;
+         failed = 1;
+         return;
+      }
+      memcpy(p, next, length);
+      next += length;
+   }
+
+   uint32_t get_u32()
+   {
+      uint32_t value;
+      get_bytes(&value, sizeof(value));
+      return(value);
+   }
+
+   int64_t get_i64()
+   {
+      int64_t value;
+      get_bytes(&value, sizeof(value));
+      return(value);
+   }
+
+   string get_string()
+   {
+      uint32_t length = get_u32();
+      string str;
+
+      if ((size_t)(end - next) < length)
+      {
+         next = end;
+         failed = 1;
+         return(str);
+      }
+      str.assign(next, length);
+      next += length;
+      return(str);
+   }
+};
+
 Fineline_Project::Fineline_Project()
 {
    //ctor
    project_file = NULL;
    modified = false;
+   clear_sections();
 
 }
 
@@ -56,29 +168,39 @@ Fineline_Project::~Fineline_Project()
 
 int Fineline_Project::new_project(const char *filename)
 {
-	project_file = fopen(filename, "w");
-
-	if (project_file == NULL)
+   clear_sections();
+	project_file_name = filename;
+   write_project_header();
+
+	if (write_project_file(project_file_name) < 0)
 	{
-	   string msg = "open_project() <ERROR>: Could not open project file: ";
-	   msg.append(filename);
+	   string msg = "new_project() <ERROR>: Could not create project file: ";
+	   msg.append(filename);
 	   Fineline_Log::print_log_entry(msg.c_str());
-	   // move to UI class -> fl_message(msg.c_str());
-      return(-1);
+	   // move to UI class -> fl_message(msg.c_str());
+      return(-1);
 	}
-	project_file_name = filename;
-	modified = false;
 
-   close_project();
-
    return(0);
 
 }
 
+/*
+   Function: open_project()
+
+   Purpose : Reads the section table and the project header. The other
+           : sections are only read when they are asked for. Project files
+           : without a section table only have the header line.
+   Input   : Project file name.
+   Output  : Returns 0 on success, -1 on error.
+*/
 int Fineline_Project::open_project(const char *filename)
 {
+   fl_project_file_header_t hdr;
+   uint64_t size;
+   int i;
 
-	project_file = fopen(filename, "r");
+	project_file = fopen(filename, "rb");
 
 	if (project_file == NULL)
 	{
@@ -90,20 +212,61 @@ int Fineline_Project::open_project(const char *filename)
 	}
 	project_file_name = filename;
 	modified = false;
+   clear_sections();
+
+   fle_fseek(project_file, 0, SEEK_END);
+   size = (uint64_t)fle_ftell(project_file);
+   rewind(project_file);
+
+   if ((fread(&hdr, sizeof(hdr), 1, project_file) == 1) && (memcmp(hdr.magic, FL_PROJECT_MAGIC, 8) == 0))
+   {
+      for (i = 0; i < FL_SECTION_COUNT; i++)
+      {
+         if ((hdr.sections[i].size > 0) && ((hdr.sections[i].offset < sizeof(hdr)) || (hdr.sections[i].offset + hdr.sections[i].size > size)))
+            break;
+      }
+      if ((hdr.version != FL_PROJECT_VERSION) || (hdr.section_count != FL_SECTION_COUNT) || (i < FL_SECTION_COUNT))
+      {
+         string msg = "open_project() <ERROR>: Invalid project file: ";
+         msg.append(filename);
+         Fineline_Log::print_log_entry(msg.c_str());
+         close_project();
+         return(-1);
+      }
+      memcpy(section_table, hdr.sections, sizeof(section_table));
+      sectioned = true;
+      file_end = size;
+   }
+   else
+   {
+      rewind(project_file);
+   }
+
    read_project_header();
-   read_file_metadata_list();  // TODO: pass in the metadata list.
-   read_file_system_tree();    // TODO: pass in the file system tree.
-   read_statistical_records(); // TODO: pass in the statistical data.
-   read_timeline_event_list(); // TODO: pass in the timeline event list.
 
    close_project();
 
    return(0);
 }
 
+/*
+   Function: save_project()
+
+   Purpose : Saves the header and the sections that have changed since the
+           : project was opened or last saved.
+   Input   : None.
+   Output  : Returns 0 on success, -1 on error.
+*/
 int Fineline_Project::save_project()
 {
-   project_file = fopen(project_file_name.c_str(), "r+");
+   int result;
+
+   write_project_header();
+
+   if (!sectioned || needs_compaction())
+      return(write_project_file(project_file_name));
+
+   project_file = fopen(project_file_name.c_str(), "r+b");
 
    if (project_file == NULL)
    {
@@ -113,24 +276,23 @@ int Fineline_Project::save_project()
       return(-1);
    }
 
-   write_project_header();
-   //TODO: write the marked file metadata, file system tree, event timeline and project report.
-   write_file_metadata_list();  // TODO: pass in the metadata list.
-   write_file_system_tree();    // TODO: pass in the file system tree.
-   write_statistical_records(); // TODO: pass in the statistical data.
-   write_timeline_event_list(); // TODO: pass in the timeline event list.
+   result = append_sections();
 
    close_project();
 
-   return(0);
+   return(result);
 }
 
 int Fineline_Project::save_project_as(const char *filename)
 {
+   // The sections that are still only in the old file are copied to the new one.
+   if (load_sections() < 0)
+      return(-1);
+
    project_file_name = filename;
-   project_file = fopen(filename, "w");
+   write_project_header();
 
-   if (project_file == NULL)
+   if (write_project_file(project_file_name) < 0)
    {
 	   string msg = "save_project_as() <ERROR>: Could not create project file: ";
 	   msg.append(project_file_name);
@@ -138,15 +300,6 @@ int Fineline_Project::save_project_as(const char *filename)
       return(-1);
    }
 
-   write_project_header();
-   //TODO: write the marked file metadata, file system tree, event timeline and project report.
-   write_file_metadata_list();  // TODO: pass in the metadata list.
-   write_file_system_tree();    // TODO: pass in the file system tree.
-   write_statistical_records(); // TODO: pass in the statistical data.
-   write_timeline_event_list(); // TODO: pass in the timeline event list.
-
-   close_project();
-
    return(0);
 }
 
@@ -166,21 +319,313 @@ bool Fineline_Project::project_modified()
    return(modified);
 }
 
+bool Fineline_Project::section_modified(int section)
+{
+   return(section_dirty[section]);
+}
+
+void Fineline_Project::clear_sections()
+{
+   int i;
+
+   memset(section_table, 0, sizeof(section_table));
+   for (i = 0; i < FL_SECTION_COUNT; i++)
+   {
+      vector<char>().swap(section_data[i]);
+      section_dirty[i] = false;
+   }
+   sectioned = false;
+   file_end = 0;
+}
+
+/*
+   Function: set_section()
+
+   Purpose : Replaces the data of a section, the section is only marked for
+           : saving if the data differs from the saved section.
+   Input   : Section number, section data (emptied) and the number of items.
+   Output  : Returns 1 if the section changed, 0 if not.
+*/
+int Fineline_Project::set_section(int section, vector<char> &data, uint32_t count)
+{
+   uint32_t checksum = section_checksum(data);
+   fl_project_section_t *s = &section_table[section];
+
+   if (!section_dirty[section] && (s->size == data.size()) && (s->checksum == checksum) && (s->count == count))
+   {
+      data.clear();
+      return(0);
+   }
+
+   section_data[section].swap(data);
+   data.clear();
+   s->size = section_data[section].size();
+   s->checksum = checksum;
+   s->count = count;
+   section_dirty[section] = true;
+   modified = true;
+
+   return(1);
+}
+
+/*
+   Function: read_section()
+
+   Purpose : Gets the data of a section, from memory if it has changed since
+           : the last save, otherwise from the project file.
+   Input   : Section number and the buffer to read into.
+   Output  : Returns 0 on success, -1 if the section is damaged or cannot be read.
+*/
+int Fineline_Project::read_section(int section, vector<char> &data)
+{
+   fl_project_section_t *s = &section_table[section];
+   FILE *fp;
+   int result = 0;
+
+   if (section_dirty[section])
+   {
+      data = section_data[section];
+      return(0);
+   }
+
+   data.clear();
+   if (s->size == 0)
+      return(0);
+
+   fp = fopen(project_file_name.c_str(), "rb");
+   if (fp == NULL)
+   {
+      string msg = "read_section() <ERROR>: Could not open project file: ";
+      msg.append(project_file_name);
+      Fineline_Log::print_log_entry(msg.c_str());
+      return(-1);
+   }
+
+   data.resize(s->size);
+   if ((fle_fseek(fp, s->offset, SEEK_SET) != 0) || (fread(&data[0], s->size, 1, fp) != 1) || (section_checksum(data) != s->checksum))
+      result = -1;
+   fclose(fp);
+
+   if (result < 0)
+   {
+      string msg = "read_section() <ERROR>: Damaged section in project file: ";
+      msg.append(project_file_name);
+      Fineline_Log::print_log_entry(msg.c_str());
+      data.clear();
+   }
+
+   return(result);
+}
+
+/*
+   Function: load_sections()
+
+   Purpose : Reads every saved section that is not in memory, before the
+           : project file is rewritten.
+   Input   : None.
+   Output  : Returns 0 on success, -1 on error.
+*/
+int Fineline_Project::load_sections()
+{
+   int i;
+
+   for (i = 0; i < FL_SECTION_COUNT; i++)
+   {
+      if (!section_dirty[i] && (section_table[i].size > 0))
+      {
+         if (read_section(i, section_data[i]) < 0)
+            return(-1);
+         section_dirty[i] = true;
+      }
+   }
+
+   return(0);
+}
+
+/*
+   Function: write_project_file()
+
+   Purpose : Writes every section to a new project file. The file is written
+           : to a temporary file first so a failed save leaves the old
+           : project file intact.
+   Input   : Project file name.
+   Output  : Returns 0 on success, -1 on error.
+*/
+int Fineline_Project::write_project_file(const string &filename)
+{
+   fl_project_file_header_t hdr;
+   string temp_name = filename;
+   uint64_t offset = sizeof(hdr);
+   FILE *fp;
+   int i, result = 0;
+
+   if (load_sections() < 0)
+      return(-1);
+
+   temp_name.append(".tmp");
+   fp = fopen(temp_name.c_str(), "wb");
+   if (fp == NULL)
+   {
+      string msg = "write_project_file() <ERROR>: Could not create project file: ";
+      msg.append(temp_name);
+      Fineline_Log::print_log_entry(msg.c_str());
+      return(-1);
+   }
+
+   memset(&hdr, 0, sizeof(hdr));
+   memcpy(hdr.magic, FL_PROJECT_MAGIC, 8);
+   hdr.version = FL_PROJECT_VERSION;
+   hdr.section_count = FL_SECTION_COUNT;
+
+   if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+      result = -1;
+   for (i = 0; i < FL_SECTION_COUNT; i++)
+   {
+      hdr.sections[i] = section_table[i];
+      hdr.sections[i].offset = offset;
+      hdr.sections[i].size = section_data[i].size();
+      if ((section_data[i].size() > 0) && (fwrite(section_data[i].data(), section_data[i].size(), 1, fp) != 1))
+         result = -1;
+      offset += section_data[i].size();
+   }
+   rewind(fp);
+   if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+      result = -1;
+   if (fclose(fp) != 0)
+      result = -1;
+
+   if (result == 0)
+   {
+      remove(filename.c_str());
+      if (rename(temp_name.c_str(), filename.c_str()) != 0)
+         result = -1;
+   }
+   if (result < 0)
+   {
+      string msg = "write_project_file() <ERROR>: Could not write project file: ";
+      msg.append(filename);
+      Fineline_Log::print_log_entry(msg.c_str());
+      remove(temp_name.c_str());
+      return(-1);
+   }
+
+   memcpy(section_table, hdr.sections, sizeof(section_table));
+   for (i = 0; i < FL_SECTION_COUNT; i++)
+   {
+      vector<char>().swap(section_data[i]);
+      section_dirty[i] = false;
+   }
+   sectioned = true;
+   file_end = offset;
+   modified = false;
+
+   return(0);
+}
+
+/*
+   Function: append_sections()
+
+   Purpose : Appends the changed sections to the end of the open project file
+           : and then rewrites the section table, so the file still holds
+           : the previous sections if the save does not complete.
+   Input   : None.
+   Output  : Returns 0 on success, -1 on error.
+*/
+int Fineline_Project::append_sections()
+{
+   fl_project_file_header_t hdr;
+   uint64_t offset = file_end;
+   int i, result = 0;
+
+   memset(&hdr, 0, sizeof(hdr));
+   memcpy(hdr.magic, FL_PROJECT_MAGIC, 8);
+   hdr.version = FL_PROJECT_VERSION;
+   hdr.section_count = FL_SECTION_COUNT;
+   memcpy(hdr.sections, section_table, sizeof(section_table));
+
+   if (fle_fseek(project_file, file_end, SEEK_SET) != 0)
+      result = -1;
+   for (i = 0; (i < FL_SECTION_COUNT) && (result == 0); i++)
+   {
+      if (!section_dirty[i])
+         continue;
+      hdr.sections[i].offset = offset;
+      if ((section_data[i].size() > 0) && (fwrite(section_data[i].data(), section_data[i].size(), 1, project_file) != 1))
+         result = -1;
+      offset += section_data[i].size();
+   }
+   if ((result == 0) && (fflush(project_file) != 0))
+      result = -1;
+   if (result == 0)
+   {
+      rewind(project_file);
+      if ((fwrite(&hdr, sizeof(hdr), 1, project_file) != 1) || (fflush(project_file) != 0))
+         result = -1;
+   }
+
+   if (result < 0)
+   {
+      string msg = "append_sections() <ERROR>: Could not write project file: ";
+      msg.append(project_file_name);
+      Fineline_Log::print_log_entry(msg.c_str());
+      return(-1);
+   }
+
+   memcpy(section_table, hdr.sections, sizeof(section_table));
+   for (i = 0; i < FL_SECTION_COUNT; i++)
+   {
+      if (section_dirty[i])
+         vector<char>().swap(section_data[i]);
+      section_dirty[i] = false;
+   }
+   file_end = offset;
+
+   return(0);
+}
+
+/*
+   Function: needs_compaction()
+
+   Purpose : Checks if the replaced sections would take more space than the
+           : live sections after the changed sections are appended.
+   Input   : None.
+   Output  : true if the project file should be rewritten.
+*/
+bool Fineline_Project::needs_compaction()
+{
+   uint64_t clean = sizeof(fl_project_file_header_t);
+   uint64_t changed = 0;
+   uint64_t waste;
+   int i;
+
+   for (i = 0; i < FL_SECTION_COUNT; i++)
+   {
+      if (section_dirty[i])
+         changed += section_data[i].size();
+      else
+         clean += section_table[i].size;
+   }
+   waste = (file_end > clean) ? file_end - clean : 0;
+
+   return((waste > FL_PROJECT_MIN_WASTE) && (waste > clean + changed));
+}
+
 /*
    Function: write_project_header()
 
-   Purpose : Creates a project header string and writes to the project file.
+   Purpose : Creates a project header string and stores it in the header section.
            : Uses the following schema to serialize the project properties:
            : <project><name></name><investigator></investigator><summary></summary><startdate></startdate>
            : <enddate></enddate><description></description></project>
    Input   : Project properties.
-   Output  : Timestamped project header line.
+   Output  : Timestamped project header section.
 */
 int Fineline_Project::write_project_header()
 {
    time_t curtime;
    struct tm *loctime;
    string hdr, tmp_str;
+   vector<char> data;
    char *time_str;
    unsigned int i;
 
@@ -220,59 +665,247 @@ int Fineline_Project::write_project_header()
    hdr.append(Fineline_Util::rtrim(time_str)); //remove the newline at the end of the time string
    hdr.append("</projecttime></project>\n");
 
-   if (fputs (hdr.c_str(), project_file) == EOF)
-   {
-      string msg = "write_project_header() <ERROR>: Could not write project header: ";
-	   msg.append(project_file_name);
-	   Fineline_Log::print_log_entry(msg.c_str());
-      return(-1);
-   }
+   data.assign(hdr.begin(), hdr.end());
+   set_section(FL_SECTION_HEADER, data, 1);
 
    Fineline_Log::print_log_entry("write_project_header() <INFO> Wrote Project Header.\n");
 
    return(0);
 }
 
-int Fineline_Project::write_file_metadata_list()  // TODO: pass in the metadata list.
+/*
+   Function: write_file_metadata_list()
+
+   Purpose : Stores the metadata of the marked files so the project report can
+           : list them without the forensic image. Each file is serialised as
+           : its path, sizes and times, file system fields, comment and the
+           : digests if the file has been hashed.
+   Input   : File index snapshot.
+   Output  : Returns the number of marked files.
+*/
+int Fineline_Project::write_file_metadata_list(Fineline_File_Map fmap)
 {
-   // The file metadata items are serialised using the following schema:
-   // <filemetadatalist><metadata><filepath></filepath><modtime></modtime><acctime></acctime><cretime></cretime>
-   // <owner></owner><filesize></filesize></metadata></filemetadatalist>
-   return(0);
+   vector<char> data;
+   const fl_file_record_t *flrec;
+   uint32_t count = 0;
+   size_t i;
+
+   for (i = 0; fmap && (i < fmap->size()); i++)
+   {
+      flrec = fmap->get_record(i);
+      if (flrec->marked == 0)
+         continue;
+      put_string(data, fmap->get_path(i), fmap->get_path_length(i));
+      put_i64(data, flrec->file_size);
+      put_i64(data, flrec->creation_time);
+      put_i64(data, flrec->access_time);
+      put_i64(data, flrec->modification_time);
+      put_i64(data, flrec->change_time);
+      put_i64(data, (int64_t)flrec->meta_address);
+      put_u32(data, (uint32_t)flrec->file_system_id);
+      put_u32(data, (uint32_t)flrec->file_type);
+      put_u32(data, (uint32_t)flrec->deleted);
+      put_u32(data, (uint32_t)flrec->hash_set);
+      put_string(data, flrec->comment, (flrec->comment != NULL) ? strlen(flrec->comment) : 0);
+      put_u32(data, (flrec->digests != NULL) ? 1 : 0);
+      if (flrec->digests != NULL)
+         put_bytes(data, flrec->digests, sizeof(fl_file_digests_t));
+      count++;
+   }
+
+   set_section(FL_SECTION_METADATA, data, count);
+
+   return((int)count);
 }
 
-int Fineline_Project::write_file_system_tree()    // TODO: pass in the file system tree.
+/*
+   Function: write_file_system_tree()
+
+   Purpose : Stores the state the investigator or the hash sets have given the
+           : files in the tree, the path, marked and hidden flags and the
+           : comment of every file that has any of them set.
+   Input   : File index snapshot.
+   Output  : Returns the number of files stored.
+*/
+int Fineline_Project::write_file_system_tree(Fineline_File_Map fmap)
 {
-   // The file system tree is serialised using the following schema:
-   // <filesystemtree><node><filepath></filepath><marked></marked></node></filesystemtree>
+   vector<char> data;
+   const fl_file_record_t *flrec;
+   uint32_t count = 0;
+   size_t i;
 
-   return(0);
+   for (i = 0; fmap && (i < fmap->size()); i++)
+   {
+      flrec = fmap->get_record(i);
+      if ((flrec->marked == 0) && (flrec->hidden == 0) && (flrec->comment == NULL))
+         continue;
+      put_string(data, fmap->get_path(i), fmap->get_path_length(i));
+      put_u32(data, (uint32_t)flrec->marked);
+      put_u32(data, (uint32_t)flrec->hidden);
+      put_string(data, flrec->comment, (flrec->comment != NULL) ? strlen(flrec->comment) : 0);
+      count++;
+   }
+
+   set_section(FL_SECTION_TREE, data, count);
+
+   return((int)count);
 }
 
-int Fineline_Project::write_statistical_records() // TODO: pass in the statistical data.
+/*
+   Function: write_statistical_records()
+
+   Purpose : Stores the named statistics of the image analysis.
+   Input   : Statistic names and values.
+   Output  : Returns the number of statistics.
+*/
+int Fineline_Project::write_statistical_records(const map<string, int64_t> &statistics)
 {
-   return(0);
+   vector<char> data;
+   map<string, int64_t>::const_iterator p;
+
+   for (p = statistics.begin(); p != statistics.end(); ++p)
+   {
+      put_string(data, p->first.data(), p->first.size());
+      put_i64(data, p->second);
+   }
+
+   set_section(FL_SECTION_STATISTICS, data, (uint32_t)statistics.size());
+
+   return((int)statistics.size());
 }
 
-int Fineline_Project::write_timeline_event_list() // TODO: pass in the timeline event list.
+/*
+   Function: write_timeline_event_list()
+
+   Purpose : Stores the MAC timeline events that are not in the file records.
+           : The path of each file is stored once, followed by the events as
+           : the time, path number and MAC flags.
+   Input   : Timeline events.
+   Output  : Returns the number of events stored.
+*/
+int Fineline_Project::write_timeline_event_list(const vector<fl_mac_event_t> &events)
 {
-   return(0);
+   unordered_map< const fl_file_record_t*, uint32_t > path_numbers;
+   unordered_map< const fl_file_record_t*, uint32_t >::iterator p;
+   vector<char> data, event_data;
+   string file_path;
+   uint32_t path_count;
+   uint32_t count = 0;
+   size_t i;
+
+   put_u32(data, 0); // the path count is filled in once the paths are known
+   event_data.reserve(events.size() * (sizeof(int64_t) + 2 * sizeof(uint32_t)));
+   for (i = 0; i < events.size(); i++)
+   {
+      if (events[i].record == NULL)
+         continue;
+      p = path_numbers.find(events[i].record);
+      if (p == path_numbers.end())
+      {
+         p = path_numbers.insert(make_pair(events[i].record, (uint32_t)path_numbers.size())).first;
+         file_path = Fineline_File_Arena::get_full_path(events[i].record);
+         put_string(data, file_path.data(), file_path.size());
+      }
+      put_i64(event_data, events[i].event_time);
+      put_u32(event_data, p->second);
+      put_u32(event_data, (uint32_t)events[i].flags);
+      count++;
+   }
+
+   path_count = (uint32_t)path_numbers.size();
+   memcpy(&data[0], &path_count, sizeof(path_count));
+   data.insert(data.end(), event_data.begin(), event_data.end());
+
+   set_section(FL_SECTION_TIMELINE, data, count);
+
+   return((int)count);
 }
 
 /*
+   Function: write_search_index()
+
+   Purpose : Saves the path search index with the case so it does not have
+           : to be rebuilt when the project is opened again. The binary index
+           : is kept in its own file beside the project file.
+   Input   : Path search index.
+   Output  : Returns 0 on success, -1 on error.
+*/
+int Fineline_Project::write_search_index(const Fineline_Trigram_Index *tindex)
+{
+   string index_file_name = project_file_name;
+
+   if ((tindex == NULL) || (project_file_name.size() == 0))
+      return(-1);
+
+   index_file_name.append(FL_SEARCH_INDEX_EXT);
+
+   return(tindex->save_index(index_file_name.c_str()));
+}
+
+/*
+   Function: read_search_index()
+
+   Purpose : Loads the saved path search index of the project, the index is
+           : only used if it was built from the same file index.
+   Input   : Path search index and the file index snapshot it must match.
+   Output  : Returns 0 on success, -1 if there is no usable saved index.
+*/
+int Fineline_Project::read_search_index(Fineline_Trigram_Index *tindex, Fineline_File_Map fmap)
+{
+   string index_file_name = project_file_name;
+
+   if ((tindex == NULL) || (project_file_name.size() == 0))
+      return(-1);
+
+   index_file_name.append(FL_SEARCH_INDEX_EXT);
+
+   return(tindex->load_index(index_file_name.c_str(), fmap));
+}
+
+/*
+   Function: read_case_snapshot()
+
+   Purpose : Maps the saved file record snapshot of the project.
+   Input   : Case snapshot to open.
+   Output  : Returns 0 on success, -1 if there is no usable snapshot.
+*/
+int Fineline_Project::read_case_snapshot(Fineline_Case_Snapshot *snapshot)
+{
+   if ((snapshot == NULL) || (project_file_name.size() == 0))
+      return(-1);
+
+   return((snapshot->open_snapshot(get_snapshot_file_name().c_str()) < 0) ? -1 : 0);
+}
+
+string Fineline_Project::get_snapshot_file_name()
+{
+   string snapshot_file_name = project_file_name;
+
+   snapshot_file_name.append(FL_SNAPSHOT_EXT);
+
+   return(snapshot_file_name);
+}
+
+/*
    Function: read_project_header()
 
-   Purpose : Reads in the first line of the project file and parses the
-           : project properties using regexes.
-           : Uses the following schema to deserialize the project properties:
-           : <project><name></name><investigator></investigator><summary></summary><startdate></startdate>
-           : <enddate></enddate><description></description></project>
-   Input   : Project header line from project file.
+   Purpose : Reads in the header section, or the first line of project files
+           : without a section table, and parses the project properties.
+   Input   : Project header section or line from project file.
    Output  : Project properties.
 */
 int Fineline_Project::read_project_header()
 {
    char in_str[FL_MAX_INPUT_STR];
+   vector<char> data;
+
+   if (sectioned)
+   {
+      if (read_section(FL_SECTION_HEADER, data) < 0)
+         return(-1);
+      parse_project_header(string(data.begin(), data.end()));
+      return(0);
+   }
 
    if (fgets(in_str, FL_MAX_INPUT_STR, project_file) == NULL)
    {
@@ -282,6 +915,23 @@ int Fineline_Project::read_project_header()
       return(-1);
    }
 
+   parse_project_header(in_str);
+
+   return(0);
+}
+
+/*
+   Function: parse_project_header()
+
+   Purpose : Parses the project properties using regexes.
+           : Uses the following schema to deserialize the project properties:
+           : <project><name></name><investigator></investigator><summary></summary><startdate></startdate>
+           : <enddate></enddate><description></description></project>
+   Input   : Project header string.
+   Output  : Project properties.
+*/
+void Fineline_Project::parse_project_header(const string &hdr)
+{
    /*
       Implementation Note:
       If compiling with gcc beware the bizarre regex fiasco in gcc versions prior to 4.9,
@@ -298,7 +948,7 @@ int Fineline_Project::read_project_header()
    regex ped_regex("<enddate>(.+)</enddate>");
    regex pd_regex("<description>(.+)</description>");
 
-   string search_line = in_str;
+   string search_line = hdr;
    smatch search_result;
 
    //Fineline_Log::print_log_entry(search_line.c_str());
@@ -347,28 +997,178 @@ int Fineline_Project::read_project_header()
       project_description = search_result[1].str();
       //TODO: replace any <nl> with newlines.
    }
-
-   return(0);
 }
 
-int Fineline_Project::read_file_metadata_list()  // TODO: pass in the metadata list.
+/*
+   Function: read_file_metadata_list()
+
+   Purpose : Reads the saved metadata of the marked files.
+   Input   : List to fill in.
+   Output  : Returns the number of files, -1 if the section is damaged.
+*/
+int Fineline_Project::read_file_metadata_list(vector<fl_project_file_t> &file_list)
 {
-   return(0);
+   vector<char> data;
+   fl_project_file_t pf;
+   uint32_t i;
+
+   file_list.clear();
+   if (read_section(FL_SECTION_METADATA, data) < 0)
+      return(-1);
+
+   fl_section_reader in(data);
+   for (i = 0; (i < section_table[FL_SECTION_METADATA].count) && !in.failed; i++)
+   {
+      pf.file_path = in.get_string();
+      pf.file_size = in.get_i64();
+      pf.creation_time = in.get_i64();
+      pf.access_time = in.get_i64();
+      pf.modification_time = in.get_i64();
+      pf.change_time = in.get_i64();
+      pf.meta_address = (uint64_t)in.get_i64();
+      pf.file_system_id = (int)in.get_u32();
+      pf.file_type = (int)in.get_u32();
+      pf.deleted = (int)in.get_u32();
+      pf.hash_set = (int)in.get_u32();
+      pf.comment = in.get_string();
+      pf.has_digests = (int)in.get_u32();
+      memset(&pf.digests, 0, sizeof(pf.digests));
+      if (pf.has_digests)
+         in.get_bytes(&pf.digests, sizeof(pf.digests));
+      if (!in.failed)
+         file_list.push_back(pf);
+   }
+
+   if (in.failed)
+   {
+      Fineline_Log::print_log_entry("read_file_metadata_list() <ERROR>: Damaged file metadata section.\n");
+      return(-1);
+   }
+
+   return((int)file_list.size());
 }
 
-int Fineline_Project::read_file_system_tree()    // TODO: pass in the file system tree.
+/*
+   Function: read_file_system_tree()
+
+   Purpose : Restores the marked and hidden flags and the comments of the
+           : files in the tree, files that are not in the index are skipped.
+   Input   : File index snapshot and the arena of its records for the comments.
+   Output  : Returns the number of files restored, -1 if the section is damaged.
+*/
+int Fineline_Project::read_file_system_tree(Fineline_File_Map fmap, Fineline_File_Arena *arena)
 {
-   return(0);
+   vector<char> data;
+   fl_file_record_t *flrec;
+   string file_path, comment;
+   int marked, hidden;
+   int count = 0;
+   uint32_t i;
+
+   if (read_section(FL_SECTION_TREE, data) < 0)
+      return(-1);
+
+   fl_section_reader in(data);
+   for (i = 0; (i < section_table[FL_SECTION_TREE].count) && !in.failed; i++)
+   {
+      file_path = in.get_string();
+      marked = (int)in.get_u32();
+      hidden = (int)in.get_u32();
+      comment = in.get_string();
+      flrec = fmap ? fmap->find_file(file_path) : NULL;
+      if (in.failed || (flrec == NULL))
+         continue;
+      flrec->marked = marked;
+      flrec->hidden = hidden;
+      if ((comment.size() > 0) && (arena != NULL))
+         arena->set_comment(flrec, comment);
+      count++;
+   }
+
+   if (in.failed)
+   {
+      Fineline_Log::print_log_entry("read_file_system_tree() <ERROR>: Damaged file system tree section.\n");
+      return(-1);
+   }
+
+   return(count);
 }
 
-int Fineline_Project::read_statistical_records() // TODO: pass in the statistical data.
+int Fineline_Project::read_statistical_records(map<string, int64_t> &statistics)
 {
-   return(0);
+   vector<char> data;
+   string name;
+   uint32_t i;
+
+   statistics.clear();
+   if (read_section(FL_SECTION_STATISTICS, data) < 0)
+      return(-1);
+
+   fl_section_reader in(data);
+   for (i = 0; (i < section_table[FL_SECTION_STATISTICS].count) && !in.failed; i++)
+   {
+      name = in.get_string();
+      statistics[name] = in.get_i64();
+   }
+
+   if (in.failed)
+   {
+      Fineline_Log::print_log_entry("read_statistical_records() <ERROR>: Damaged statistics section.\n");
+      statistics.clear();
+      return(-1);
+   }
+
+   return((int)statistics.size());
 }
 
-int Fineline_Project::read_timeline_event_list() // TODO: pass in the timeline event list.
+/*
+   Function: read_timeline_event_list()
+
+   Purpose : Reads the saved MAC timeline events, the files are looked up in
+           : the file index and events of files that are not in the index
+           : are dropped.
+   Input   : File index snapshot and the list to fill in.
+   Output  : Returns the number of events, -1 if the section is damaged.
+*/
+int Fineline_Project::read_timeline_event_list(Fineline_File_Map fmap, vector<fl_mac_event_t> &events)
 {
-   return(0);
+   vector<char> data;
+   vector<fl_file_record_t *> records;
+   fl_mac_event_t event;
+   uint32_t path_count, path_number;
+   uint32_t i;
+
+   events.clear();
+   if (read_section(FL_SECTION_TIMELINE, data) < 0)
+      return(-1);
+   if (data.size() == 0)
+      return(0);
+
+   fl_section_reader in(data);
+   path_count = in.get_u32();
+   for (i = 0; (i < path_count) && !in.failed; i++)
+      records.push_back(fmap ? fmap->find_file(in.get_string()) : NULL);
+
+   events.reserve(section_table[FL_SECTION_TIMELINE].count);
+   for (i = 0; (i < section_table[FL_SECTION_TIMELINE].count) && !in.failed; i++)
+   {
+      event.event_time = in.get_i64();
+      path_number = in.get_u32();
+      event.flags = (int)in.get_u32();
+      if (in.failed || (path_number >= records.size()) || (records[path_number] == NULL))
+         continue;
+      event.record = records[path_number];
+      events.push_back(event);
+   }
+
+   if (in.failed)
+   {
+      Fineline_Log::print_log_entry("read_timeline_event_list() <ERROR>: Damaged timeline section.\n");
+      events.clear();
+      return(-1);
+   }
+
+   return((int)events.size());
 }
 
 /*
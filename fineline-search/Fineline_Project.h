@@ -32,6 +32,13 @@
                3. Filesystem tree.
                4. Timeline event list.
                5. Statistical analysis records.
+            The file starts with a table of the offset, size and checksum
+            of each section. Opening a project only reads the table and the
+            header, the other sections are read when they are asked for.
+            Saving appends the sections that have changed to the end of the
+            file and then rewrites the table, unchanged sections are not
+            written again. The file is rewritten from scratch when the space
+            taken by replaced sections outgrows the live sections.
 
    Notes: EXPERIMENTAL
 
@@ -43,9 +50,62 @@
 
 
 #include <string>
+#include <vector>
+#include <map>
 #include <regex>
 
 #include "fineline-search.h"
+#include "Fineline_Trigram_Index.h"
+#include "Fineline_Case_Snapshot.h"
+#include "Fineline_File_Arena.h"
+#include "Fineline_File_Index.h"
+
+#define FL_SEARCH_INDEX_EXT ".fti"   /* path search index file saved beside the project file */
+#define FL_SNAPSHOT_EXT     ".fls"   /* file record snapshot saved beside the project file */
+
+#define FL_PROJECT_MAGIC     "FLPRJ001"
+#define FL_PROJECT_VERSION   1
+#define FL_PROJECT_MIN_WASTE 1048576  /* replaced section bytes allowed before the file is compacted */
+
+enum FL_PROJECT_SECTIONS { FL_SECTION_HEADER = 0, FL_SECTION_METADATA, FL_SECTION_TREE, FL_SECTION_TIMELINE, FL_SECTION_STATISTICS, FL_SECTION_COUNT };
+
+struct fl_project_section
+{
+   uint64_t offset;
+   uint64_t size;
+   uint32_t checksum;
+   uint32_t count;                  /* number of items in the section */
+};
+typedef struct fl_project_section fl_project_section_t;
+
+struct fl_project_file_header
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t section_count;
+   fl_project_section_t sections[FL_SECTION_COUNT];
+};
+typedef struct fl_project_file_header fl_project_file_header_t;
+
+/* Saved metadata of a marked file, kept for reports when the image is not available. */
+struct fl_project_file
+{
+   string file_path;
+   string comment;
+   int64_t file_size;
+   int64_t creation_time;
+   int64_t access_time;
+   int64_t modification_time;
+   int64_t change_time;
+   uint64_t meta_address;
+   int file_system_id;
+   int file_type;
+   int deleted;
+   int hash_set;
+   int has_digests;
+   fl_file_digests_t digests;
+};
+typedef struct fl_project_file fl_project_file_t;
 
 using namespace std;
 
@@ -64,16 +124,23 @@ class Fineline_Project
       bool project_modified();
 
       int write_project_header();
-      int write_file_metadata_list();  // TODO: pass in the metadata list.
-      int write_file_system_tree();    // TODO: pass in the file system tree.
-      int write_statistical_records(); // TODO: pass in the statistical data.
-      int write_timeline_event_list(); // TODO: pass in the timeline event list.
+      int write_file_metadata_list(Fineline_File_Map fmap);
+      int write_file_system_tree(Fineline_File_Map fmap);
+      int write_statistical_records(const map<string, int64_t> &statistics);
+      int write_timeline_event_list(const vector<fl_mac_event_t> &events);
 
       int read_project_header();
-      int read_file_metadata_list();  // TODO: pass in the metadata list.
-      int read_file_system_tree();    // TODO: pass in the file system tree.
-      int read_statistical_records(); // TODO: pass in the statistical data.
-      int read_timeline_event_list(); // TODO: pass in the timeline event list.
+      int read_file_metadata_list(vector<fl_project_file_t> &file_list);
+      int read_file_system_tree(Fineline_File_Map fmap, Fineline_File_Arena *arena);
+      int read_statistical_records(map<string, int64_t> &statistics);
+      int read_timeline_event_list(Fineline_File_Map fmap, vector<fl_mac_event_t> &events);
+
+      bool section_modified(int section);
+
+      int write_search_index(const Fineline_Trigram_Index *tindex);
+      int read_search_index(Fineline_Trigram_Index *tindex, Fineline_File_Map fmap);
+      int read_case_snapshot(Fineline_Case_Snapshot *snapshot);
+      string get_snapshot_file_name();
 
       //Getter/Setter methods
       string getProjectName();
@@ -94,6 +161,15 @@ class Fineline_Project
    protected:
    private:
 
+      void clear_sections();
+      int set_section(int section, vector<char> &data, uint32_t count);
+      int read_section(int section, vector<char> &data);
+      int load_sections();
+      int write_project_file(const string &filename);
+      int append_sections();
+      bool needs_compaction();
+      void parse_project_header(const string &hdr);
+
       FILE *project_file;
       string project_file_name;
       string project_name;
@@ -104,6 +180,12 @@ class Fineline_Project
       string project_summary;
       bool modified;
 
+      fl_project_section_t section_table[FL_SECTION_COUNT];
+      vector<char> section_data[FL_SECTION_COUNT]; /* changed sections waiting to be saved */
+      bool section_dirty[FL_SECTION_COUNT];
+      bool sectioned;                              /* the project file on disk uses the section format */
+      uint64_t file_end;
+
 };
 
 #endif // FINELINE_PROJECT_H
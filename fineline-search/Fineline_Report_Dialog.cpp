@@ -37,6 +37,7 @@
 #include <FL/Fl_Menu_Bar.H>
 
 #include "Fineline_Report_Dialog.h"
+#include "Fineline_File_Arena.h"
 #include "Fineline_Log.h"
 
 
@@ -114,15 +115,14 @@ void Fineline_Report_Dialog::add_marked_files(vector< fl_file_record_t* > flist)
 {
    unsigned int i;
    marked_file_list = flist;
-   char full_path[FL_PATH_MAX];
+   string full_path;
 
    for (i = 0; i < marked_file_list.size(); i++)
    {
-      memset((void*)full_path, 0, FL_PATH_MAX);
       fl_file_record_t *flec = marked_file_list[i];
-      strncpy(full_path, flec->file_path, strlen(flec->file_path));
-      strncat(full_path, flec->file_name, strlen(flec->file_name));
-      text_buffer->append(full_path);
+      full_path = Fineline_File_Arena::get_file_path(flec);
+      full_path.append(flec->file_name);
+      text_buffer->append(full_path.c_str());
       //Fineline_Log::print_log_entry("Fineline_Report_Dialog::add_marked_files() <INFO> added marked file.");
    }
    return;
@@ -129,6 +129,34 @@ int Fineline_Socket_BSD::send_event(char *event_string)
    return(k);
 }
 
+/*
+   Function: send_event_block
+   Purpose : sends a block of event records to the GUI, the block is sent
+             in as many writes as the socket needs.
+   Input   : event records and the block length.
+   Return  : 0 = success, -1 = fail.
+*/
+int Fineline_Socket_BSD::send_event_block(const char *event_block, size_t length)
+{
+   ssize_t k;
+
+   while (length > 0)
+   {
+      k = send(sockfd, event_block, length, 0);
+      if (k == -1)
+      {
+         if (errno == EINTR)
+            continue;
+         flog.print_log_entry("send_event_block() <ERROR> Cannot send to server!\n");
+         return(-1);
+      }
+      event_block += k;
+      length -= (size_t)k;
+   }
+
+   return(0);
+}
+
 char *Fineline_Socket_BSD::receive_message()
 {
    return(NULL);
@@ -240,6 +268,34 @@ int Fineline_Socket_BSD::send_event(char *event_string)
 	return(0);
 }
 
+/*
+   Function: send_event_block
+   Purpose : sends a block of event records to the GUI, the block is sent
+             in as many writes as the socket needs.
+   Input   : event records and the block length.
+   Return  : 0 = success, -1 = fail.
+*/
+int Fineline_Socket_BSD::send_event_block(const char *event_block, size_t length)
+{
+   int result;
+
+   while (length > 0)
+   {
+      result = send(connect_socket, event_block, (length > 0x10000000) ? 0x10000000 : (int)length, 0);
+      if (result == SOCKET_ERROR)
+      {
+         flog.print_log_entry("send_event_block() <ERROR> Send failed with error.\n");
+         closesocket(connect_socket);
+         WSACleanup();
+         return(-1);
+      }
+      event_block += result;
+      length -= (size_t)result;
+   }
+
+   return(0);
+}
+
 /* TODO: acknowledge from server */
 char *Fineline_Socket_BSD::receive_message()
 {
@@ -50,6 +50,7 @@ class Fineline_Socket_BSD
       int open_socket();
       int close_socket();
       int send_event(char *event_string);
+      int send_event_block(const char *event_block, size_t length);
       char *receive_message();
 
    protected:
@@ -1,11 +1,191 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+/*
+   Fineline_Statistics_Dialog.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: FineLine FLTK GUI panel to show the file statistics.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FL/Fl_Native_File_Chooser.H>
+#include <FL/fl_ask.H>
+
 #include "Fineline_Statistics_Dialog.h"
+#include "Fineline_File_System.h"
+
+using namespace std;
 
-Fineline_Statistics_Dialog::Fineline_Statistics_Dialog()
+static const int statistics_columns[] = { 200, 120, 160, 120, 120, 0 };
+
+Fineline_Statistics_Dialog::Fineline_Statistics_Dialog(int x, int y, int w, int h) : Fl_Group(x, y, w, h)
 {
-   //ctor
+   begin();
+
+   statistics_browser = new Fl_Browser(x + 10, y + 10, w - 20, h - 65);
+   statistics_browser->column_widths(statistics_columns);
+   statistics_browser->column_char('\t');
+   statistics_browser->format_char(0); // file names are not formatted
+   statistics_browser->tooltip("File counts and bytes of the forensic image, updated as the image is processed.");
+
+   {
+      Fl_Button* o = new Fl_Button(x + w - 230, y + h - 45, 100, 30, "Refresh");
+      o->callback((Fl_Callback*)button_callback, (void *)this);
+      o->tooltip("Show the latest file statistics.");
+   } // Fl_Button* o
+   {
+      Fl_Button* o = new Fl_Button(x + w - 120, y + h - 45, 100, 30, "Save");
+      o->callback((Fl_Callback*)button_callback, (void *)this);
+      o->tooltip("Save the file statistics to a text file.");
+   } // Fl_Button* o
+
+   end();
+   resizable(statistics_browser);
+
+   file_system = NULL;
+   statistics_version = -1;
+   Fl::add_timeout(FL_STATS_REFRESH_INTERVAL, refresh_timer, (void *)this);
 }
 
 Fineline_Statistics_Dialog::~Fineline_Statistics_Dialog()
 {
-   //dtor
+   Fl::remove_timeout(refresh_timer, (void *)this);
+}
+
+/*
+   Name   : set_file_system()
+   Purpose: Sets the image the statistics are copied from, the report is
+            cleared and rebuilt from the new image.
+   Input  : File system object, NULL when there is no image.
+   Output : None.
+*/
+void Fineline_Statistics_Dialog::set_file_system(Fineline_File_System *ffs)
+{
+   file_system = ffs;
+   statistics_version = -1;
+   statistics.clear();
+   report_lines.clear();
+   statistics_browser->clear();
+   statistics_browser->redraw();
+
+   return;
+}
+
+/*
+   Name   : update_statistics()
+   Purpose: Copies the image statistics and rebuilds the report if they have
+            changed since they were last shown.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Statistics_Dialog::update_statistics()
+{
+   long version;
+   size_t i;
+
+   if (file_system == NULL)
+      return;
+
+   version = file_system->get_statistics_version();
+   if (version == statistics_version)
+      return;
+
+   statistics_version = version;
+   file_system->get_file_statistics(&statistics);
+   statistics.get_report(report_lines);
+
+   statistics_browser->clear();
+   for (i = 0; i < report_lines.size(); i++)
+      statistics_browser->add(report_lines[i].c_str());
+   statistics_browser->redraw();
+
+   return;
+}
+
+/*
+   Name   : save_statistics()
+   Purpose: Writes the statistics report to a text file.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Statistics_Dialog::save_statistics()
+{
+   Fl_Native_File_Chooser fc;
+   FILE *fp;
+   size_t i;
+
+   update_statistics();
+
+   fc.title("Save Statistics");
+   fc.type(Fl_Native_File_Chooser::BROWSE_SAVE_FILE);
+   fc.filter("Text File\t*.txt");
+   if (fc.show() != 0)
+      return;
+
+   fp = fopen(fc.filename(), "w");
+   if (fp == NULL)
+   {
+      fl_alert("<ERROR> Could not save the statistics!");
+      return;
+   }
+   for (i = 0; i < report_lines.size(); i++)
+      fprintf(fp, "%s\n", report_lines[i].c_str());
+   fclose(fp);
+
+   return;
+}
+
+/*
+   Name   : refresh_timer()
+   Purpose: FLTK timer callback, refreshes the statistics while the panel is
+            shown so they grow as the image walk progresses.
+   Input  : Pointer to the panel.
+   Output : None.
+*/
+void Fineline_Statistics_Dialog::refresh_timer(void *p)
+{
+   Fineline_Statistics_Dialog *sd = (Fineline_Statistics_Dialog *)p;
+
+   if (sd->visible_r())
+      sd->update_statistics();
+
+   Fl::repeat_timeout(FL_STATS_REFRESH_INTERVAL, refresh_timer, p);
+}
+
+void Fineline_Statistics_Dialog::button_callback(Fl_Button *b, void *p)
+{
+   if (strncmp(b->label(), "Save", 4) == 0)
+   {
+      ((Fineline_Statistics_Dialog *)p)->save_statistics();
+      return;
+   }
+
+   ((Fineline_Statistics_Dialog *)p)->update_statistics();
 }
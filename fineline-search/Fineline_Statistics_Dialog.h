@@ -1,14 +1,79 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+
+/*
+   Fineline_Statistics_Dialog.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: FineLine FLTK GUI panel on the statistics tab, shows the file
+            statistics of the forensic image and refreshes them while the
+            image is being walked.
+
+   Notes: EXPERIMENTAL
+
+*/
+
 #ifndef FINELINE_STATISTICS_DIALOG_H
 #define FINELINE_STATISTICS_DIALOG_H
 
+#include <vector>
+#include <string>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Group.H>
+#include <FL/Fl_Browser.H>
+#include <FL/Fl_Button.H>
+
+#include "fineline-search.h"
+#include "Fineline_File_Statistics.h"
+#include "Fineline_File_System.h"
+
+#define FL_STATS_REFRESH_INTERVAL 1.0   /* seconds between checks for new statistics */
 
-class Fineline_Statistics_Dialog
+using namespace std;
+
+class Fineline_Statistics_Dialog : public Fl_Group
 {
    public:
-      Fineline_Statistics_Dialog();
+      Fineline_Statistics_Dialog(int x, int y, int w, int h);
       virtual ~Fineline_Statistics_Dialog();
+
+      void set_file_system(Fineline_File_System *ffs);
+      void update_statistics();
+      void save_statistics();
+
    protected:
    private:
+
+      Fl_Browser *statistics_browser;
+      Fineline_File_System *file_system; /* image the statistics are copied from, NULL for none */
+      Fineline_File_Statistics statistics;
+      vector< string > report_lines;
+      long statistics_version;           /* version of the statistics shown, -1 for none */
+
+      static void refresh_timer(void *p);
+      static void button_callback(Fl_Button *b, void *p);
 };
 
 #endif // FINELINE_STATISTICS_DIALOG_H
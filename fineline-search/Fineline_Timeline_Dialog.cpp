@@ -33,6 +33,11 @@
 */
 
 #include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+#include <FL/Fl_Native_File_Chooser.H>
+#include <FL/fl_ask.H>
 
 #include "Fineline_Timeline_Dialog.h"
 
@@ -45,12 +50,20 @@ Fineline_Timeline_Dialog::Fineline_Timeline_Dialog(int x, int y, int w, int h) :
    Fl_Group* dialog_group = new Fl_Group(5, 5, w - 5, h - 5);
    dialog_group->tooltip("Click the timeline button to add the file metadata to the timeline graph.");
 
-   file_browser = new Fineline_File_Metadata_Browser(10, 10, w - 10, h - 65);
+   timeline_graph = new Fineline_Timeline_Graph(10, 10, w - 20, 150);
+   timeline_graph->tooltip("Drag to scroll, mouse wheel to zoom, double click to show all events.");
+
+   file_browser = new Fineline_File_Metadata_Browser(10, 170, w - 10, h - 225);
 
+   {
+      Fl_Button* o = new Fl_Button(w - 340, h - 45, 100, 30, "Open");
+      o->callback((Fl_Callback*)button_callback, (void *)this);
+      o->tooltip("Show the MAC time events of a saved FineLine event file in the timeline graph.");
+   } // Fl_Button* o
    {
 	   Fl_Button* o = new Fl_Button(w - 230, h - 45, 100, 30, "Timeline");
       o->callback((Fl_Callback*)button_callback, (void *)this);
-      o->tooltip("Add the events to the timeline graph.");
+      o->tooltip("Save the MAC time events of the files to an event file or body file.");
    } // Fl_Button* o
    {
       Fl_Button* o = new Fl_Button(w - 120, h - 45, 100, 30, "Close");
@@ -74,19 +87,185 @@ Fineline_Timeline_Dialog::~Fineline_Timeline_Dialog()
 
 void Fineline_Timeline_Dialog::add_marked_files(vector< fl_file_record_t* > flist)
 {
-   unsigned int i;
+   file_browser->add_file_record_list(flist);
+   timeline_files.insert(timeline_files.end(), flist.begin(), flist.end());
+   return;
+}
+
+/*
+   Name   : add_mac_events()
+   Purpose: Adds the events for times that are not in the file records, e.g.
+            the NTFS $FILE_NAME times of the listed files.
+   Input  : Event list.
+   Output : None.
+*/
+void Fineline_Timeline_Dialog::add_mac_events(const vector< fl_mac_event_t > &events)
+{
+   timeline_events.insert(timeline_events.end(), events.begin(), events.end());
+   return;
+}
+
+/*
+   Name   : clear_files()
+   Purpose: Removes the files and their events from the dialog, called before
+            the file system that owns the file records is deleted. Events
+            loaded from an event file are kept.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Timeline_Dialog::clear_files()
+{
+   file_browser->clear();
+   timeline_files.clear();
+   timeline_events.clear();
+   update_graph();
+
+   return;
+}
+
+/*
+   Name   : update_graph()
+   Purpose: Sorts the MAC time events of the files in the dialog and shows
+            them in the timeline graph.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Timeline_Dialog::update_graph()
+{
+   size_t i;
+
+   histogram.clear();
+   event_list.clear_list();
+   for (i = 0; i < timeline_files.size(); i++)
+      event_list.add_file_record(timeline_files[i]);
+   event_list.add_mac_events(timeline_events);
+   event_list.add_mac_events(loaded_events);
+   event_list.set_histogram(&histogram);
+
+   if (event_list.sort_records() < 0)
+      fl_alert("<ERROR> Could not sort the timeline events!");
+
+   timeline_graph->set_events(&histogram, &event_list);
+
+   return;
+}
 
-   for (i = 0; i < flist.size(); i++)
+/*
+   Name   : save_timeline()
+   Purpose: Writes the sorted MAC time events of the files in the dialog to
+            a FineLine event file, or a Sleuthkit body file if the file name
+            ends in .body.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Timeline_Dialog::save_timeline()
+{
+   Fl_Native_File_Chooser fc;
+   string filename;
+   int result;
+
+   if (timeline_files.empty())
    {
-      file_browser->add_file_record(flist[i]);
+      fl_alert("<ERROR> Mark the files to add to the timeline!");
+      return;
    }
+
+   fc.title("Save Timeline");
+   fc.type(Fl_Native_File_Chooser::BROWSE_SAVE_FILE);
+   fc.filter("FineLine Event File\t*.fle\nSleuthkit Body File\t*.body");
+   if (fc.show() != 0)
+      return;
+   filename = fc.filename();
+
+   if ((filename.size() > 5) && (filename.compare(filename.size() - 5, 5, ".body") == 0))
+      result = event_list.write_bodyfile(filename.c_str());
+   else
+      result = event_list.write_records(filename.c_str());
+
+   if (result < 0)
+      fl_alert("<ERROR> Could not save the timeline!");
+
+   return;
+}
+
+
+/*
+   Name   : open_timeline()
+   Purpose: Loads the MAC time events of a FineLine event file, e.g. a saved
+            timeline, and shows them in the timeline graph with the events
+            of the files in the dialog. Other event types are skipped, the
+            graph only has rows for the MAC times. The loaded events have
+            no file record so they are not written again when the timeline
+            is saved.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Timeline_Dialog::open_timeline()
+{
+   Fl_Native_File_Chooser fc;
+   Fineline_Event_Loader loader;
+   fl_event_view_t *ev;
+   fl_mac_event_t mac_event;
+   char type_string[16];
+   size_t i;
+
+   fc.title("Open Timeline");
+   fc.type(Fl_Native_File_Chooser::BROWSE_FILE);
+   fc.filter("FineLine Event File\t*.fle");
+   if (fc.show() != 0)
+      return;
+
+   if ((loader.open_event_file(fc.filename()) < 0) || (loader.load_events() < 0))
+   {
+      fl_alert("<ERROR> Could not load the event file!");
+      return;
+   }
+
+   sprintf(type_string, "%d", FL_MACTIME_EVENT);
+   loaded_events.clear();
+   for (i = 0; i < loader.event_count(); i++)
+   {
+      ev = loader.get_event(i);
+      // the summary starts with the mactime style macb flags, see Fineline_Event_List::format_event()
+      if ((ev->event_time == FL_EVENT_INVALID_TIME) || !ev->type.equals(type_string) || (ev->summary.length < 4))
+         continue;
+      mac_event.event_time = ev->event_time;
+      mac_event.record = NULL;
+      mac_event.flags = 0;
+      if (ev->summary.data[0] == 'm')
+         mac_event.flags |= FL_MAC_MODIFIED;
+      if (ev->summary.data[1] == 'a')
+         mac_event.flags |= FL_MAC_ACCESSED;
+      if (ev->summary.data[2] == 'c')
+         mac_event.flags |= FL_MAC_CHANGED;
+      if (ev->summary.data[3] == 'b')
+         mac_event.flags |= FL_MAC_BORN;
+      if (mac_event.flags != 0)
+         loaded_events.push_back(mac_event);
+   }
+   loader.close_event_file();
+
+   if (loaded_events.empty())
+      fl_alert("<ERROR> The event file has no MAC time events!");
+
+   update_graph();
+
    return;
 }
 
 
 void Fineline_Timeline_Dialog::button_callback(Fl_Button *b, void *p)
 {
-   //TODO: get the calling button label and execute the required action
+   if (strncmp(b->label(), "Timeline", 8) == 0)
+   {
+      ((Fineline_Timeline_Dialog *)p)->save_timeline();
+      return;
+   }
+   if (strncmp(b->label(), "Open", 4) == 0)
+   {
+      ((Fineline_Timeline_Dialog *)p)->open_timeline();
+      return;
+   }
 
    ((Fineline_Timeline_Dialog *)p)->hide();
 }
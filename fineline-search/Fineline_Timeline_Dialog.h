@@ -47,6 +47,10 @@
 
 #include "fineline-search.h"
 #include "Fineline_File_Metadata_Browser.h"
+#include "Fineline_Timeline_Graph.h"
+#include "Fineline_Event_Histogram.h"
+#include "Fineline_Event_List.h"
+#include "Fineline_Event_Loader.h"
 
 using namespace std;
 
@@ -59,11 +63,22 @@ class Fineline_Timeline_Dialog : public Fl_Double_Window
       virtual ~Fineline_Timeline_Dialog();
 
       void add_marked_files(vector< fl_file_record_t* > flist);
+      void add_mac_events(const vector< fl_mac_event_t > &events);
+      void update_graph();
+      void save_timeline();
+      void open_timeline();
+      void clear_files();
 
    protected:
    private:
 
       Fineline_File_Metadata_Browser *file_browser;
+      Fineline_Timeline_Graph *timeline_graph;
+      Fineline_Event_List event_list;
+      Fineline_Event_Histogram histogram;
+      vector< fl_file_record_t* > timeline_files;
+      vector< fl_mac_event_t > timeline_events;
+      vector< fl_mac_event_t > loaded_events;
 
       static void button_callback(Fl_Button *b, void *p);
 };
@@ -1,11 +1,290 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Timeline_Graph.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Zoomable MAC time event graph drawn from the event histogram.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include <FL/fl_draw.H>
+
 #include "Fineline_Timeline_Graph.h"
 
-Fineline_Timeline_Graph::Fineline_Timeline_Graph()
+static const Fl_Color fl_graph_colors[FL_HISTOGRAM_ALL] = { FL_RED, FL_DARK_GREEN, FL_BLUE, FL_MAGENTA };
+static const char *fl_level_names[FL_HISTOGRAM_LEVELS] = { "seconds", "minutes", "hours", "days" };
+
+Fineline_Timeline_Graph::Fineline_Timeline_Graph(int x, int y, int w, int h, const char *l) : Fl_Widget(x, y, w, h, l)
 {
-   //ctor
+   histogram = NULL;
+   events = NULL;
+   view_start = 0.0;
+   view_span = 86400.0;
+   drag_x = 0;
+   drag_start = 0.0;
+   box(FL_DOWN_BOX);
+   color(FL_WHITE);
 }
 
 Fineline_Timeline_Graph::~Fineline_Timeline_Graph()
 {
    //dtor
 }
+
+/*
+   Name   : set_events()
+   Purpose: Sets the event counts to graph and the sorted event list used for
+            single events, the histogram can still be filling while the graph
+            is drawn.
+   Input  : Event histogram and sorted event list, the list can be NULL.
+   Output : None.
+*/
+void Fineline_Timeline_Graph::set_events(Fineline_Event_Histogram *event_histogram, Fineline_Event_List *event_list)
+{
+   histogram = event_histogram;
+   events = event_list;
+   show_all();
+}
+
+/*
+   Name   : show_all()
+   Purpose: Zooms out to the first and last events.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Timeline_Graph::show_all()
+{
+   double first, span;
+
+   if ((histogram == NULL) || (histogram->get_event_count() == 0))
+   {
+      redraw();
+      return;
+   }
+
+   first = (double)histogram->get_first_time();
+   span = (double)(histogram->get_last_time() - histogram->get_first_time()) + 1.0;
+   set_view(first - (span * 0.02), span * 1.04);
+}
+
+void Fineline_Timeline_Graph::set_view(double start_time, double span)
+{
+   if (span < FL_GRAPH_MIN_SPAN)
+      span = FL_GRAPH_MIN_SPAN;
+   if (span > FL_GRAPH_MAX_SPAN)
+      span = FL_GRAPH_MAX_SPAN;
+   view_start = start_time;
+   view_span = span;
+   redraw();
+}
+
+double Fineline_Timeline_Graph::get_view_start()
+{
+   return(view_start);
+}
+
+double Fineline_Timeline_Graph::get_view_span()
+{
+   return(view_span);
+}
+
+/*
+   Name   : draw_histogram()
+   Purpose: Draws a stacked bar of the event type counts in each pixel
+            column, scaled to the highest column in the view.
+   Input  : Histogram level, seconds per column and the bar area height.
+   Output : None.
+*/
+void Fineline_Timeline_Graph::draw_histogram(int level, double seconds_per_pixel, int graph_height)
+{
+   uint64_t *counts;
+   uint64_t column_total, max_total = 0;
+   int64_t start_time, end_time;
+   int c, t, bar_height, bar_top;
+
+   column_counts.assign((size_t)w() * FL_HISTOGRAM_TYPES, 0);
+
+   end_time = (int64_t)floor(view_start);
+   for (c = 0; c < w(); c++)
+   {
+      counts = &column_counts[(size_t)c * FL_HISTOGRAM_TYPES];
+      start_time = end_time;
+      end_time = (int64_t)floor(view_start + ((c + 1) * seconds_per_pixel));
+      if (end_time <= start_time)
+         continue;
+      histogram->count_range(level, start_time, end_time, counts);
+      column_total = counts[FL_HISTOGRAM_MODIFIED] + counts[FL_HISTOGRAM_ACCESSED] + counts[FL_HISTOGRAM_CHANGED] + counts[FL_HISTOGRAM_BORN];
+      if (column_total > max_total)
+         max_total = column_total;
+   }
+
+   if (max_total == 0)
+      return;
+
+   for (c = 0; c < w(); c++)
+   {
+      counts = &column_counts[(size_t)c * FL_HISTOGRAM_TYPES];
+      bar_top = y() + graph_height;
+      for (t = 0; t < FL_HISTOGRAM_ALL; t++)
+      {
+         if (counts[t] == 0)
+            continue;
+         bar_height = (int)((counts[t] * (uint64_t)(graph_height - 2)) / max_total);
+         if (bar_height < 1)
+            bar_height = 1;
+         bar_top -= bar_height;
+         fl_color(fl_graph_colors[t]);
+         fl_yxline(x() + c, bar_top, bar_top + bar_height - 1);
+      }
+   }
+}
+
+/*
+   Name   : draw_events()
+   Purpose: Draws each event in the view as a tick in the row of each of its
+            MAC types, modified at the top and born at the bottom.
+   Input  : Seconds per column and the tick area height.
+   Output : None.
+*/
+void Fineline_Timeline_Graph::draw_events(double seconds_per_pixel, int graph_height)
+{
+   int row_height = graph_height / FL_HISTOGRAM_ALL;
+   int flags[FL_HISTOGRAM_ALL] = { FL_MAC_MODIFIED, FL_MAC_ACCESSED, FL_MAC_CHANGED, FL_MAC_BORN };
+   size_t i;
+   int t, column;
+
+   events->get_window_events((int64_t)floor(view_start), (int64_t)ceil(view_start + view_span), window_events, FL_GRAPH_RAW_EVENTS);
+
+   for (i = 0; i < window_events.size(); i++)
+   {
+      column = x() + (int)((window_events[i].event_time - view_start) / seconds_per_pixel);
+      for (t = 0; t < FL_HISTOGRAM_ALL; t++)
+      {
+         if ((window_events[i].flags & flags[t]) == 0)
+            continue;
+         fl_color(fl_graph_colors[t]);
+         fl_yxline(column, y() + (t * row_height) + 2, y() + ((t + 1) * row_height) - 2);
+      }
+   }
+}
+
+/*
+   Name   : draw_axis()
+   Purpose: Labels the start and end of the view and the histogram level.
+   Input  : Histogram level.
+   Output : None.
+*/
+void Fineline_Timeline_Graph::draw_axis(int level)
+{
+   char time_string[64];
+   int text_y = y() + h() - 4;
+
+   fl_font(FL_HELVETICA, 10);
+   fl_color(FL_BLACK);
+
+   Fineline_Event_List::format_event_time((int64_t)floor(view_start), time_string);
+   fl_draw(time_string, x() + 4, text_y);
+   Fineline_Event_List::format_event_time((int64_t)floor(view_start + view_span), time_string);
+   fl_draw(time_string, x() + w() - 4 - (int)fl_width(time_string), text_y);
+   fl_draw(fl_level_names[level], x() + (w() / 2) - ((int)fl_width(fl_level_names[level]) / 2), text_y);
+}
+
+void Fineline_Timeline_Graph::draw()
+{
+   double seconds_per_pixel;
+   int level, graph_height;
+   int64_t start_time, end_time;
+
+   draw_box();
+   if ((histogram == NULL) || (histogram->get_event_count() == 0) || (w() <= 0))
+      return;
+
+   fl_push_clip(x(), y(), w(), h());
+
+   seconds_per_pixel = view_span / w();
+   graph_height = h() - FL_GRAPH_AXIS_HEIGHT;
+   level = histogram->select_level(seconds_per_pixel);
+   start_time = (int64_t)floor(view_start);
+   end_time = (int64_t)ceil(view_start + view_span);
+
+   if ((events != NULL) && (histogram->count_range(level, start_time, end_time, NULL) <= FL_GRAPH_RAW_EVENTS))
+      draw_events(seconds_per_pixel, graph_height);
+   else
+      draw_histogram(level, seconds_per_pixel, graph_height);
+
+   draw_axis(level);
+
+   fl_pop_clip();
+}
+
+/*
+   Name   : handle()
+   Purpose: Pans the view while dragging, zooms around the mouse pointer on
+            the mouse wheel and shows all events on a double click.
+   Input  : FLTK event.
+   Output : 1 if the event was used.
+*/
+int Fineline_Timeline_Graph::handle(int event)
+{
+   double seconds_per_pixel = view_span / ((w() > 0) ? w() : 1);
+   double anchor, span;
+
+   switch (event)
+   {
+      case FL_PUSH:
+         if (Fl::event_clicks() > 0)
+         {
+            show_all();
+            return(1);
+         }
+         drag_x = Fl::event_x();
+         drag_start = view_start;
+         return(1);
+      case FL_DRAG:
+         set_view(drag_start - ((Fl::event_x() - drag_x) * seconds_per_pixel), view_span);
+         return(1);
+      case FL_RELEASE:
+         return(1);
+      case FL_MOUSEWHEEL:
+         if (Fl::event_dy() == 0)
+            return(0);
+         anchor = view_start + ((Fl::event_x() - x()) * seconds_per_pixel);
+         span = (Fl::event_dy() > 0) ? view_span * FL_GRAPH_ZOOM_STEP : view_span / FL_GRAPH_ZOOM_STEP;
+         if (span < FL_GRAPH_MIN_SPAN)
+            span = FL_GRAPH_MIN_SPAN;
+         if (span > FL_GRAPH_MAX_SPAN)
+            span = FL_GRAPH_MAX_SPAN;
+         set_view(anchor - ((Fl::event_x() - x()) * (span / ((w() > 0) ? w() : 1))), span);
+         return(1);
+      default:
+         break;
+   }
+
+   return(Fl_Widget::handle(event));
+}
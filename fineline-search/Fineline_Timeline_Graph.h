@@ -1,14 +1,92 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Timeline_Graph.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: FLTK timeline graph of MAC time events. Each pixel column is a
+            stacked bar of the modified, accessed, changed and born counts
+            read from the event histogram, when the view holds few enough
+            events they are fetched from the event list and drawn one by
+            one. Drag to pan, mouse wheel to zoom, double click to show all.
+
+   Notes: EXPERIMENTAL
+
+*/
+
 #ifndef FINELINE_TIMELINE_GRAPH_H
 #define FINELINE_TIMELINE_GRAPH_H
 
+#include <vector>
 
-class Fineline_Timeline_Graph
+#include <stdint.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Widget.H>
+
+#include "fineline-search.h"
+#include "Fineline_Event_Histogram.h"
+#include "Fineline_Event_List.h"
+
+#define FL_GRAPH_RAW_EVENTS     2000        /* most events drawn one by one */
+#define FL_GRAPH_MIN_SPAN       10.0        /* seconds across the graph when fully zoomed in */
+#define FL_GRAPH_MAX_SPAN       6.3e9       /* about 200 years */
+#define FL_GRAPH_ZOOM_STEP      1.25
+#define FL_GRAPH_AXIS_HEIGHT    16
+
+using namespace std;
+
+class Fineline_Timeline_Graph : public Fl_Widget
 {
    public:
-      Fineline_Timeline_Graph();
+      Fineline_Timeline_Graph(int x, int y, int w, int h, const char *l = 0);
       virtual ~Fineline_Timeline_Graph();
+
+      void set_events(Fineline_Event_Histogram *event_histogram, Fineline_Event_List *event_list);
+      void show_all();
+      void set_view(double start_time, double span);
+      double get_view_start();
+      double get_view_span();
+
    protected:
+
+      void draw();
+      int handle(int event);
+
    private:
+
+      void draw_histogram(int level, double seconds_per_pixel, int graph_height);
+      void draw_events(double seconds_per_pixel, int graph_height);
+      void draw_axis(int level);
+
+      Fineline_Event_Histogram *histogram;
+      Fineline_Event_List *events;
+      vector< uint64_t > column_counts;
+      vector< fl_mac_event_t > window_events;
+      double view_start;
+      double view_span;
+      int drag_x;
+      double drag_start;
 };
 
 #endif // FINELINE_TIMELINE_GRAPH_H
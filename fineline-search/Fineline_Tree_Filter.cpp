@@ -33,6 +33,8 @@
 */
 
 
+#include <thread>
+
 #include "../common/threads.h"
 
 #include "Fineline_Tree_Filter.h"
@@ -50,6 +52,10 @@ Fineline_Tree_Filter::Fineline_Tree_Filter(Fineline_File_System_Tree *ffst, stri
 
    // Now tokenize the keywords into a vector.
    Fineline_Util::split(keyword_list, keywords);
+
+   // and compile them into one matcher for all the filter threads.
+   keyword_matcher.add_keywords(keyword_list);
+   keyword_matcher.compile();
 
    running = 0;
 }
@@ -119,35 +125,28 @@ int Fineline_Tree_Filter::get_running()
 int Fineline_Tree_Filter::process_file_system_tree()
 {
    string pmsg;
-   int i, keyword_list_size = keyword_list.size();
+   vector<size_t> positions;
+   size_t n;
 
    Fineline_Log::print_log_entry("process_file_system_tree() <INFO> Started tree filter processing thread.");
 
-   file_system_tree->clear_tree();
-
-   map< string, fl_file_record_t* >::iterator p = file_map.begin();
+   // Match the file index snapshot on all cores first, then add the
+   // matching files to the tree widget in one locked batch.
+
+   if (file_map)
+      filter_file_map(file_map.get(), &keyword_matcher, 0, positions);
 
-   while (p != file_map.end())
+   Fl::lock();
+   file_system_tree->clear_tree();
+   for (n = 0; n < positions.size(); n++)
    {
-      // Iterate through the file system map and compare each file name with each keyword,
-      // if a match then add to the file system tree and put a progress message on the dialog.
-      fl_file_record_t *flec = p->second;
-      string full_path = flec->full_path;
-      //cout << "Processing file: " << full_path << endl;
-      for (i = 0; i < keyword_list_size; i++)
-      {
-         if (full_path.find(keyword_list[i], 0) != string::npos)
-         {
-            file_system_tree->add_file(full_path, flec);
-         }
-      }
-      p++;
+      file_system_tree->add_file(file_map->get_path(positions[n]), file_map->get_record(positions[n]));
    }
+   file_system_tree->rebuild_tree();
+   Fl::unlock();
 
    Fl::awake();
 
-   file_system_tree->rebuild_tree();
-
    pmsg = "-----------------------------------------------------------------------------------";
    put_progress_message(pmsg);
    pmsg = "Completed rebuilding file system tree.";
@@ -161,3 +160,64 @@ int Fineline_Tree_Filter::process_file_system_tree()
 
    return(0);
 }
+
+void Fineline_Tree_Filter::filter_range_task(const Fineline_File_Index *findex, const Fineline_Keyword_Matcher *matcher, size_t start, size_t end, vector<size_t> *positions)
+{
+   size_t n;
+
+   for (n = start; n < end; n++)
+   {
+      if (matcher->match_any(findex->get_path(n), findex->get_path_length(n)) >= 0)
+         positions->push_back(n);
+   }
+}
+
+/*
+   Method  : filter_file_map
+   Purpose : Matches every path in a sorted file index against the compiled
+           : keywords. The index is split into one range per thread, each file
+           : is reported once however many keywords it matches.
+   Input   : The file index, the compiled keyword matcher, number of threads (0 = one per CPU core).
+   Output  : The matching index positions in path order, returns the number of matches.
+*/
+size_t Fineline_Tree_Filter::filter_file_map(const Fineline_File_Index *findex, const Fineline_Keyword_Matcher *matcher, int thread_count, vector<size_t> &positions)
+{
+   vector< vector<size_t> > range_positions;
+   vector<thread> workers;
+   size_t file_count = findex->size();
+   int i;
+
+   positions.clear();
+
+   if ((file_count == 0) || (matcher->get_keyword_count() == 0) || (!matcher->is_compiled()))
+      return(0);
+
+   if (thread_count <= 0)
+      thread_count = (int)thread::hardware_concurrency();
+   if ((size_t)thread_count > file_count / FL_FILTER_MIN_RANGE)
+      thread_count = (int)(file_count / FL_FILTER_MIN_RANGE);
+   if (thread_count < 1)
+      thread_count = 1;
+
+   range_positions.resize(thread_count);
+   for (i = 1; i < thread_count; i++)
+   {
+      workers.push_back(thread(filter_range_task, findex, matcher, (file_count / thread_count) * i,
+                               (i == thread_count - 1) ? file_count : (file_count / thread_count) * (i + 1), &range_positions[i]));
+   }
+   filter_range_task(findex, matcher, 0, file_count / thread_count, &range_positions[0]);
+   for (i = 0; i < (int)workers.size(); i++)
+   {
+      workers[i].join();
+   }
+
+   // Ranges are in index order so joining them keeps the paths sorted.
+
+   positions.swap(range_positions[0]);
+   for (i = 1; i < thread_count; i++)
+   {
+      positions.insert(positions.end(), range_positions[i].begin(), range_positions[i].end());
+   }
+
+   return(positions.size());
+}
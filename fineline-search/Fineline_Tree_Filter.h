@@ -37,7 +37,6 @@
 #ifndef FINELINE_TREE_FILTER_H
 #define FINELINE_TREE_FILTER_H
 
-#include <map>
 #include <vector>
 
 #include <sys/stat.h>
@@ -48,6 +47,9 @@
 
 #include "Fineline_File_System_Tree.h"
 #include "Fineline_Tree_Filter_Dialog.h"
+#include "../common/Fineline_Keyword_Matcher.h"
+
+#define FL_FILTER_MIN_RANGE 16384   /* do not split file maps smaller than 16384 files per thread */
 
 using namespace std;
 
@@ -62,11 +64,16 @@ class Fineline_Tree_Filter
 	   int get_running();
 	   int process_file_system_tree();
 
+	   static size_t filter_file_map(const Fineline_File_Index *findex, const Fineline_Keyword_Matcher *matcher, int thread_count, vector<size_t> &positions);
+
    protected:
    private:
 
+      static void filter_range_task(const Fineline_File_Index *findex, const Fineline_Keyword_Matcher *matcher, size_t start, size_t end, vector<size_t> *positions);
+
       Fineline_File_System_Tree *file_system_tree;
       vector < string > keyword_list;
+      Fineline_Keyword_Matcher keyword_matcher;
       Fineline_File_Map file_map;
 
       int running;
@@ -137,13 +137,11 @@ void Fineline_Tree_Filter_Dialog::start_filter_thread()
 
 void Fineline_Tree_Filter_Dialog::show_dialog(Fineline_File_System_Tree *ffst)
 {
-   // First make a copy of the file system map so we can revert back to the
+   // First take a snapshot of the file system index so we can revert back to the
    // original file system tree if the user removes the filter using the clear button.
+   // The snapshot is shared with the tree, not copied.
    file_system_tree = ffst;
 
-   if (file_map.size() > 0)
-      file_map.clear();
-
    file_map = file_system_tree->get_file_map();
 
    show();
@@ -155,6 +153,7 @@ void Fineline_Tree_Filter_Dialog::restore_tree()
 {
    // Restore the original file system tree. Called when the user clicks the clear button
    // to remove filter from file system tree.
-   file_system_tree->add_file_map(file_map);
+   if (file_map)
+      file_system_tree->add_file_map(file_map);
    return;
 }
@@ -37,7 +37,6 @@
 #ifndef FINELINE_TREE_FILTER_DIALOG_H
 #define FINELINE_TREE_FILTER_DIALOG_H
 
-#include <map>
 #include <string>
 
 #include <FL/Fl.H>
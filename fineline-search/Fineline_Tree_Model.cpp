@@ -0,0 +1,422 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Tree_Model.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Compact file system tree model, path components are looked up
+            in an open addressing hash table on (parent, name).
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <string.h>
+#include <algorithm>
+
+#include <tsk/libtsk.h>
+
+#include "Fineline_Tree_Model.h"
+
+/* Orders child node numbers by name. */
+struct fl_tree_node_order
+{
+   const char *names;
+   const fl_tree_node_t *nodes;
+
+   bool operator()(uint32_t a, uint32_t b) const
+   {
+      return(strcmp(names + nodes[a].name_offset, names + nodes[b].name_offset) < 0);
+   }
+};
+
+Fineline_Tree_Model::Fineline_Tree_Model()
+{
+   clear();
+}
+
+Fineline_Tree_Model::~Fineline_Tree_Model()
+{
+   //dtor
+}
+
+uint32_t Fineline_Tree_Model::hash_name(uint32_t parent, const char *name, size_t length)
+{
+   uint32_t hash = 2166136261u ^ (parent * 2654435761u);
+   size_t i;
+
+   for (i = 0; i < length; i++)
+   {
+      hash ^= (unsigned char)name[i];
+      hash *= 16777619u;
+   }
+
+   return(hash);
+}
+
+/*
+   Function: find_slot
+   Purpose : Looks up a child name in the hash table.
+   Input   : Parent node, name, name length and hash.
+   Output  : Returns the hash table slot of the child, or -(slot + 1) of the
+             empty slot where the child would be inserted.
+*/
+long Fineline_Tree_Model::find_slot(uint32_t parent, const char *name, size_t length, uint32_t hash) const
+{
+   size_t mask = hash_table.size() - 1;
+   size_t slot = hash & mask;
+   const fl_tree_node_t *n;
+
+   while (hash_table[slot] != 0)
+   {
+      n = &nodes[hash_table[slot] - 1];
+      if ((n->parent == parent) && (n->name_length == length) && (memcmp(&name_data[n->name_offset], name, length) == 0))
+         return((long)slot);
+      slot = (slot + 1) & mask;
+   }
+
+   return(-((long)slot + 1));
+}
+
+void Fineline_Tree_Model::grow_hash_table()
+{
+   size_t new_size = hash_table.size() * 2;
+   size_t mask = new_size - 1;
+   size_t i, slot;
+
+   hash_table.assign(new_size, 0);
+   for (i = 1; i < nodes.size(); i++) // the root is never looked up
+   {
+      slot = hash_name(nodes[i].parent, &name_data[nodes[i].name_offset], nodes[i].name_length) & mask;
+      while (hash_table[slot] != 0)
+         slot = (slot + 1) & mask;
+      hash_table[slot] = (uint32_t)(i + 1);
+   }
+}
+
+/*
+   Function: add_child
+   Purpose : Finds or adds a child node, new children are linked at the front
+             of the parent's child list and the parent is marked unsorted.
+   Input   : Parent node, name and name length.
+   Output  : The child node.
+*/
+uint32_t Fineline_Tree_Model::add_child(uint32_t parent, const char *name, size_t length)
+{
+   uint32_t hash;
+   long slot;
+   fl_tree_node_t n;
+
+   if (length > 0xFFFF)
+      length = 0xFFFF;
+
+   hash = hash_name(parent, name, length);
+   slot = find_slot(parent, name, length, hash);
+   if (slot >= 0)
+      return(hash_table[slot] - 1);
+
+   n.record = NULL;
+   n.name_offset = (uint32_t)name_data.size();
+   n.name_length = (uint16_t)length;
+   n.parent = parent;
+   n.first_child = FL_TREE_NO_NODE;
+   n.next_sibling = nodes[parent].first_child;
+   n.child_count = 0;
+   n.flags = FL_TREE_NODE_SORTED;
+
+   name_data.insert(name_data.end(), name, name + length);
+   name_data.push_back(0);
+   nodes.push_back(n);
+   hash_table[-(slot + 1)] = (uint32_t)nodes.size();
+
+   nodes[parent].first_child = (uint32_t)(nodes.size() - 1);
+   nodes[parent].child_count++;
+   nodes[parent].flags &= ~FL_TREE_NODE_SORTED;
+
+   if (nodes.size() * 2 > hash_table.size())
+      grow_hash_table();
+
+   return((uint32_t)(nodes.size() - 1));
+}
+
+/*
+   Function: add_path
+   Purpose : Adds a file to the model, creating the directory nodes in its
+             path. Empty path components are skipped, so "/etc/passwd" and
+             "etc/passwd" are the same file. The record replaces the record
+             of an existing node.
+   Input   : Full tree path of the file and the file metadata record.
+   Output  : The file node, FL_TREE_NO_NODE if the path is empty.
+*/
+uint32_t Fineline_Tree_Model::add_path(const string &file_path, fl_file_record_t *flrec)
+{
+   uint32_t node = FL_TREE_ROOT_NODE;
+   size_t start = 0;
+   size_t end;
+
+   while (start < file_path.size())
+   {
+      end = file_path.find('/', start);
+      if (end == string::npos)
+         end = file_path.size();
+      if (end > start)
+         node = add_child(node, file_path.data() + start, end - start);
+      start = end + 1;
+   }
+
+   if (node == FL_TREE_ROOT_NODE)
+      return(FL_TREE_NO_NODE);
+
+   nodes[node].record = flrec;
+
+   return(node);
+}
+
+/*
+   Function: find_path
+   Purpose : Looks up the node of a full tree path.
+   Input   : Full tree path.
+   Output  : The node, FL_TREE_NO_NODE if the path is not in the model.
+*/
+uint32_t Fineline_Tree_Model::find_path(const string &file_path) const
+{
+   uint32_t node = FL_TREE_ROOT_NODE;
+   size_t start = 0;
+   size_t end;
+
+   while ((start < file_path.size()) && (node != FL_TREE_NO_NODE))
+   {
+      end = file_path.find('/', start);
+      if (end == string::npos)
+         end = file_path.size();
+      if (end > start)
+         node = find_child(node, file_path.data() + start, end - start);
+      start = end + 1;
+   }
+
+   return((node == FL_TREE_ROOT_NODE) ? FL_TREE_NO_NODE : node);
+}
+
+uint32_t Fineline_Tree_Model::find_child(uint32_t parent, const char *name, size_t length) const
+{
+   long slot;
+
+   if (length > 0xFFFF)
+      length = 0xFFFF;
+
+   slot = find_slot(parent, name, length, hash_name(parent, name, length));
+   if (slot < 0)
+      return(FL_TREE_NO_NODE);
+
+   return(hash_table[slot] - 1);
+}
+
+/*
+   Function: sort_children
+   Purpose : Relinks the children of a node in name order. Does nothing if no
+             child has been added since the last sort.
+   Input   : The node.
+   Output  : None.
+*/
+void Fineline_Tree_Model::sort_children(uint32_t node)
+{
+   vector< uint32_t > children;
+   fl_tree_node_order order;
+   uint32_t c;
+   size_t i;
+
+   if ((nodes[node].flags & FL_TREE_NODE_SORTED) || (nodes[node].child_count == 0))
+      return;
+
+   children.reserve(nodes[node].child_count);
+   for (c = nodes[node].first_child; c != FL_TREE_NO_NODE; c = nodes[c].next_sibling)
+      children.push_back(c);
+
+   order.names = name_data.data();
+   order.nodes = nodes.data();
+   sort(children.begin(), children.end(), order);
+
+   for (i = 0; i + 1 < children.size(); i++)
+      nodes[children[i]].next_sibling = children[i + 1];
+   nodes[children.back()].next_sibling = FL_TREE_NO_NODE;
+   nodes[node].first_child = children.front();
+   nodes[node].flags |= FL_TREE_NODE_SORTED;
+}
+
+/*
+   Function: set_marked
+   Purpose : Sets the marked attribute of the records of a node and every
+             node below it.
+   Input   : The node and the marked value.
+   Output  : Returns the number of records changed.
+*/
+long Fineline_Tree_Model::set_marked(uint32_t node, int marked)
+{
+   vector< uint32_t > stack;
+   uint32_t c;
+   long count = 0;
+
+   stack.push_back(node);
+   while (!stack.empty())
+   {
+      node = stack.back();
+      stack.pop_back();
+      if (nodes[node].record != NULL)
+      {
+         nodes[node].record->marked = marked;
+         count++;
+      }
+      for (c = nodes[node].first_child; c != FL_TREE_NO_NODE; c = nodes[c].next_sibling)
+         stack.push_back(c);
+   }
+
+   return(count);
+}
+
+void Fineline_Tree_Model::clear()
+{
+   fl_tree_node_t root;
+
+   root.record = NULL;
+   root.name_offset = 0;
+   root.name_length = 0;
+   root.parent = FL_TREE_NO_NODE;
+   root.first_child = FL_TREE_NO_NODE;
+   root.next_sibling = FL_TREE_NO_NODE;
+   root.child_count = 0;
+   root.flags = FL_TREE_NODE_SORTED;
+
+   nodes.clear();
+   nodes.push_back(root);
+   name_data.assign(1, 0);
+   hash_table.assign(FL_TREE_HASH_SIZE, 0);
+}
+
+uint32_t Fineline_Tree_Model::get_parent(uint32_t node) const
+{
+   return(nodes[node].parent);
+}
+
+uint32_t Fineline_Tree_Model::get_first_child(uint32_t node) const
+{
+   return(nodes[node].first_child);
+}
+
+uint32_t Fineline_Tree_Model::get_next_sibling(uint32_t node) const
+{
+   return(nodes[node].next_sibling);
+}
+
+uint32_t Fineline_Tree_Model::get_child_count(uint32_t node) const
+{
+   return(nodes[node].child_count);
+}
+
+int Fineline_Tree_Model::has_visible_children(uint32_t node) const
+{
+   uint32_t c;
+
+   for (c = nodes[node].first_child; c != FL_TREE_NO_NODE; c = nodes[c].next_sibling)
+   {
+      if ((nodes[c].flags & FL_TREE_NODE_HIDDEN) == 0)
+         return(1);
+   }
+
+   return(0);
+}
+
+int Fineline_Tree_Model::is_directory(uint32_t node) const
+{
+   if (nodes[node].child_count > 0)
+      return(1);
+   if ((nodes[node].record != NULL) && (nodes[node].record->file_type == TSK_FS_META_TYPE_DIR))
+      return(1);
+
+   return(0);
+}
+
+const char *Fineline_Tree_Model::get_name(uint32_t node) const
+{
+   return(&name_data[nodes[node].name_offset]);
+}
+
+/*
+   Function: get_path
+   Purpose : Rebuilds the full tree path of a node from the parent links.
+   Input   : The node.
+   Output  : The path, e.g. "FS1/Windows/notepad.exe", empty for the root.
+*/
+string Fineline_Tree_Model::get_path(uint32_t node) const
+{
+   vector< uint32_t > chain;
+   string path;
+   size_t i;
+
+   for (; (node != FL_TREE_NO_NODE) && (node != FL_TREE_ROOT_NODE); node = nodes[node].parent)
+      chain.push_back(node);
+
+   for (i = chain.size(); i > 0; i--)
+   {
+      path.append(get_name(chain[i - 1]), nodes[chain[i - 1]].name_length);
+      if (i > 1)
+         path.push_back('/');
+   }
+
+   return(path);
+}
+
+fl_file_record_t *Fineline_Tree_Model::get_record(uint32_t node) const
+{
+   return(nodes[node].record);
+}
+
+int Fineline_Tree_Model::get_flags(uint32_t node) const
+{
+   return(nodes[node].flags);
+}
+
+void Fineline_Tree_Model::set_flags(uint32_t node, int flags)
+{
+   nodes[node].flags |= (uint16_t)flags;
+}
+
+void Fineline_Tree_Model::clear_flags(uint32_t node, int flags)
+{
+   nodes[node].flags &= (uint16_t)~flags;
+}
+
+/*
+   Function: size
+   Purpose : Gets the number of nodes.
+   Input   : None.
+   Output  : Number of files and directories, not counting the root.
+*/
+size_t Fineline_Tree_Model::size() const
+{
+   return(nodes.size() - 1);
+}
+
+size_t Fineline_Tree_Model::get_memory_used() const
+{
+   return((nodes.capacity() * sizeof(fl_tree_node_t)) + name_data.capacity() + (hash_table.capacity() * sizeof(uint32_t)));
+}
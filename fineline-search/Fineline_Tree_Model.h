@@ -0,0 +1,116 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Tree_Model.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Compact model of the file system tree. Every path component is a
+            fixed size node in one array, names are kept in one buffer and
+            children are found through a hash table keyed on the parent node
+            and the name, so adding a file to a directory with a hundred
+            thousand entries costs the same as adding it to an empty one. The
+            children of a directory are linked in the order they were added
+            and sorted by name the first time the directory is displayed.
+            The tree widget only creates items for the directories the user
+            has opened.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#ifndef FINELINE_TREE_MODEL_H
+#define FINELINE_TREE_MODEL_H
+
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fineline-search.h"
+
+#define FL_TREE_HASH_SIZE       1024        /* initial hash table size, a power of 2 */
+#define FL_TREE_ROOT_NODE       0
+#define FL_TREE_NO_NODE         0xFFFFFFFF
+
+#define FL_TREE_NODE_SORTED     1           /* children are linked in name order */
+#define FL_TREE_NODE_HIDDEN     2           /* not shown, e.g. known good hash set files */
+#define FL_TREE_NODE_HIGHLIGHT  4           /* shown in red, e.g. content search hits */
+
+using namespace std;
+
+struct fl_tree_node
+{
+   fl_file_record_t *record;        /* NULL for directories that only appear in paths */
+   uint32_t name_offset;            /* offset of the NUL terminated name in the name buffer */
+   uint32_t parent;
+   uint32_t first_child;
+   uint32_t next_sibling;
+   uint32_t child_count;
+   uint16_t name_length;
+   uint16_t flags;
+};
+typedef struct fl_tree_node fl_tree_node_t;
+
+class Fineline_Tree_Model
+{
+   public:
+      Fineline_Tree_Model();
+      virtual ~Fineline_Tree_Model();
+
+      uint32_t add_path(const string &file_path, fl_file_record_t *flrec);
+      uint32_t find_path(const string &file_path) const;
+      uint32_t find_child(uint32_t parent, const char *name, size_t length) const;
+      void sort_children(uint32_t node);
+      long set_marked(uint32_t node, int marked);
+      void clear();
+
+      uint32_t get_parent(uint32_t node) const;
+      uint32_t get_first_child(uint32_t node) const;
+      uint32_t get_next_sibling(uint32_t node) const;
+      uint32_t get_child_count(uint32_t node) const;
+      int has_visible_children(uint32_t node) const;
+      int is_directory(uint32_t node) const;
+      const char *get_name(uint32_t node) const;
+      string get_path(uint32_t node) const;
+      fl_file_record_t *get_record(uint32_t node) const;
+      int get_flags(uint32_t node) const;
+      void set_flags(uint32_t node, int flags);
+      void clear_flags(uint32_t node, int flags);
+      size_t size() const;
+      size_t get_memory_used() const;
+
+   protected:
+   private:
+
+      uint32_t add_child(uint32_t parent, const char *name, size_t length);
+      long find_slot(uint32_t parent, const char *name, size_t length, uint32_t hash) const;
+      void grow_hash_table();
+      static uint32_t hash_name(uint32_t parent, const char *name, size_t length);
+
+      vector< fl_tree_node_t > nodes;
+      vector< char > name_data;
+      vector< uint32_t > hash_table;     /* node number + 1, 0 is an empty slot */
+};
+
+#endif // FINELINE_TREE_MODEL_H
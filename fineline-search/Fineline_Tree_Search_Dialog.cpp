@@ -32,18 +32,46 @@
 
 */
 
+#include <stdio.h>
+#include <string.h>
+
 #include <FL/fl_ask.H>
 
+#include "../common/threads.h"
+
 #include "Fineline_Tree_Search_Dialog.h"
+#include "Fineline_Trigram_Index.h"
+#include "Fineline_File_Arena.h"
+#include "Fineline_Log.h"
+#include "../common/Fineline_Util.h"
 
 Fineline_Tree_Search_Dialog::Fineline_Tree_Search_Dialog(int x, int y, int w, int h) : Fl_Double_Window(x, y, w, h, "Fineline File Search Dialogue")
 {
    //ctor
+   file_system_tree = NULL;
+   file_system = NULL;
+   content_search = NULL;
+   search_task_running = 0;
+
    begin();
 
    Fl_Group* browser_group = new Fl_Group(10, 10, w - 10, h - 10);
    {
-      progress_browser = new Fl_Browser(20, 20, w - 40, h - 100);
+      search_field = new Fl_Input(100, 20, w - 230, 30, "Search:");
+      search_field->tooltip("Text, glob pattern or regular expression to find in the file paths.");
+      Fl_Button* search_button = new Fl_Button(w - 120, 20, 100, 30, "Search");
+      search_button->tooltip("Search every file path in the forensic image.");
+      search_button->callback((Fl_Callback*)button_callback, (void *)this);
+      search_type_choice = new Fl_Choice(100, 60, 150, 30, "Type:");
+      search_type_choice->add("Substring");
+      search_type_choice->add("Glob");
+      search_type_choice->add("Regex");
+      search_type_choice->add("Content");
+      search_type_choice->tooltip("Search the file paths, or the file content for keywords separated by spaces.");
+      search_type_choice->value(FL_SEARCH_SUBSTRING);
+      ignore_case_button = new Fl_Check_Button(270, 60, 150, 30, "Ignore Case");
+      ignore_case_button->value(1);
+      progress_browser = new Fl_Browser(20, 100, w - 40, h - 180);
       Fl_Button* save_button = new Fl_Button(w - 360, h - 50, 100, 30, "Save");
       save_button->callback((Fl_Callback*)button_callback, (void *)this);
       Fl_Button* clear_button = new Fl_Button(w - 250, h - 50, 100, 30, "Clear");
@@ -63,7 +91,296 @@ Fineline_Tree_Search_Dialog::~Fineline_Tree_Search_Dialog()
 
 void Fineline_Tree_Search_Dialog::button_callback(Fl_Button *b, void *p)
 {
-   fl_message("modal window");
-   ((Fineline_Tree_Search_Dialog *)p)->hide();
+   Fineline_Tree_Search_Dialog *ftsd = (Fineline_Tree_Search_Dialog*)p;
+
+   if (strncmp(b->label(), "Search", 6) == 0)
+   {
+      ftsd->search_paths();
+   }
+   else if (strncmp(b->label(), "Save", 4) == 0)
+   {
+      ftsd->save_results();
+   }
+   else if (strncmp(b->label(), "Clear", 5) == 0)
+   {
+      if (ftsd->content_search != NULL)
+         ftsd->content_search->stop_search();
+      ftsd->search_field->value("");
+      ftsd->progress_browser->clear();
+   }
+   else if (strncmp(b->label(), "Close", 5) == 0)
+   {
+      ftsd->hide();
+   }
+
+   return;
+}
+
+void Fineline_Tree_Search_Dialog::show_dialog(Fineline_File_System_Tree *ffst, Fineline_File_System *ffs)
+{
+   file_system_tree = ffst;
+   file_system = ffs;
+
+   show();
+
+   return;
+}
+
+/*
+   Name   : search_paths()
+   Purpose: Searches every path in the forensic image with the trigram path
+            index and lists the matching paths. The index is built here if
+            the image walk has not built it yet.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Tree_Search_Dialog::search_paths()
+{
+   shared_ptr< Fineline_Trigram_Index > tindex;
+   Fineline_File_Map fmap;
+   vector<size_t> positions;
+   string pattern = search_field->value();
+   char msg[FL_MAX_INPUT_STR];
+   long count;
+   size_t i;
+
+   if ((file_system_tree == NULL) || (pattern.size() == 0))
+      return;
+
+   if (search_type_choice->value() == FL_SEARCH_CONTENT)
+   {
+      start_content_search();
+      return;
+   }
+
+   tindex = file_system_tree->get_search_index();
+   if (!tindex)
+   {
+      tindex = make_shared< Fineline_Trigram_Index >();
+      tindex->build_index(file_system_tree->get_file_map());
+      file_system_tree->set_search_index(tindex);
+   }
+
+   count = tindex->search(pattern, search_type_choice->value(), ignore_case_button->value(), positions, FL_MAX_SEARCH_RESULTS);
+   if (count < 0)
+   {
+      fl_alert("<ERROR> Invalid regular expression!");
+      return;
+   }
+
+   progress_browser->clear();
+   fmap = tindex->get_file_map();
+   for (i = 0; i < positions.size(); i++)
+   {
+      progress_browser->add(fmap->get_path(positions[i]));
+   }
+
+   if (count >= FL_MAX_SEARCH_RESULTS)
+      snprintf(msg, FL_MAX_INPUT_STR, "Search: %s - showing the first %ld matching files.", pattern.c_str(), count);
+   else
+      snprintf(msg, FL_MAX_INPUT_STR, "Search: %s - found %ld matching files.", pattern.c_str(), count);
+   progress_browser->insert(1, msg);
+
+   return;
+}
+
+/*
+   Function: content_search_task
+   Purpose : Worker function for the posix/win32 thread, must be a C function.
+   Input   : Pointer to the search dialog.
+   Output  : Returns NULL.
+*/
+void *content_search_task(void *p)
+{
+   Fineline_Tree_Search_Dialog *ftsd = (Fineline_Tree_Search_Dialog *)p;
+
+   ftsd->run_content_search();
+
+   return(NULL);
+}
+
+/*
+   Name   : start_content_search()
+   Purpose: Starts a thread to search the content of every file in the
+            forensic image for the keywords in the search field.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Tree_Search_Dialog::start_content_search()
+{
+   vector<string> keywords;
+   char msg[FL_MAX_INPUT_STR];
+   Fl_Thread thread_id;
+
+   if (file_system == NULL)
+   {
+      fl_alert("<ERROR> Open a forensic image before searching the file content!");
+      return;
+   }
+   if ((content_search != NULL) && content_search->get_running())
+   {
+      fl_alert("<ERROR> A content search is already running!");
+      return;
+   }
+
+   if (content_search != NULL)
+      delete content_search;
+
+   Fineline_Util::split(keywords, search_field->value());
+   content_search = new Fineline_Content_Search(file_system->get_image_name(), file_system->get_file_system_offsets(), keywords, ignore_case_button->value());
+   content_search->add_files(file_system_tree->get_file_map());
+
+   progress_browser->clear();
+   snprintf(msg, FL_MAX_INPUT_STR, "Searching the content of %lu files for %lu keywords...",
+            (unsigned long)content_search->get_file_count(), (unsigned long)content_search->get_keyword_count());
+   progress_browser->add(msg);
+
+   search_task_running = 1;
+   fl_create_thread(thread_id, content_search_task, (void *)this);
+
+   return;
+}
+
+/*
+   Name   : run_content_search()
+   Purpose: Runs the content search on all cores, called from the search
+            thread. The hits are shown when the search finishes.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Tree_Search_Dialog::run_content_search()
+{
+   Fineline_Log::print_log_entry("run_content_search() <INFO> Started content search thread.");
+
+   content_search->search_files(0);
+
+   Fl::lock();
+   show_content_hits();
+   search_task_running = 0;
+   Fl::unlock();
+
+   Fl::awake();
+
+   Fineline_Log::print_log_entry("run_content_search() <INFO> Finished content search thread.");
+}
+
+/*
+   Name   : show_content_hits()
+   Purpose: Lists the content search hits with their offsets and shows the
+            files with hits in red in the file system tree.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Tree_Search_Dialog::show_content_hits()
+{
+   const vector<fl_content_hit_t> &hits = content_search->get_hits();
+   fl_file_record_t *last_record = NULL;
+   char msg[FL_MAX_INPUT_STR];
+   string full_path;
+   string line;
+   size_t i;
+
+   for (i = 0; (i < hits.size()) && (i < FL_MAX_SEARCH_RESULTS); i++)
+   {
+      if (hits[i].record != last_record)
+      {
+         last_record = hits[i].record;
+         full_path = Fineline_File_Arena::get_full_path(last_record);
+         file_system_tree->highlight_file(full_path.c_str());
+      }
+      line = full_path;
+      line.append("\t");
+      line.append(content_search->get_hit_string(hits[i]));
+      progress_browser->add(line.c_str());
+   }
+   file_system_tree->redraw();
+
+   snprintf(msg, FL_MAX_INPUT_STR, "Found %lu keyword hits in %llu MB of file content.",
+            (unsigned long)hits.size(), (unsigned long long)(content_search->get_bytes_searched() / 1048576));
+   progress_browser->add(msg);
+   progress_browser->bottomline(progress_browser->size());
+
+   return;
+}
+
+/*
+   Name   : get_content_hits()
+   Purpose: Gets the content search hits of a file for the metadata view.
+   Input  : File metadata record.
+   Output : The hit strings, empty if there is no finished content search.
+*/
+vector<string> Fineline_Tree_Search_Dialog::get_content_hits(fl_file_record_t *flrec)
+{
+   vector<fl_content_hit_t> file_hits;
+   vector<string> hit_strings;
+   size_t i;
+
+   if (content_search == NULL)
+      return(hit_strings);
+
+   content_search->get_file_hits(flrec, file_hits);
+   for (i = 0; i < file_hits.size(); i++)
+      hit_strings.push_back(content_search->get_hit_string(file_hits[i]));
+
+   return(hit_strings);
+}
+
+/*
+   Name   : clear_search()
+   Purpose: Stops a running content search and removes the hits, called
+            before the file system that owns the file records is deleted.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Tree_Search_Dialog::clear_search()
+{
+   if (content_search != NULL)
+      content_search->stop_search();
+   // the search thread shows the hits with the FLTK lock held, Fl::wait() releases it
+   while (search_task_running)
+      Fl::wait(0.1);
+   if (content_search != NULL)
+   {
+      delete content_search;
+      content_search = NULL;
+   }
+
+   file_system = NULL;
+   progress_browser->clear();
+
+   return;
+}
+
+/*
+   Name   : save_results()
+   Purpose: Writes the search results to a text file.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_Tree_Search_Dialog::save_results()
+{
+   Fl_Native_File_Chooser fc;
+   FILE *fp;
+   int i;
+
+   fc.title("Save Search Results");
+   fc.type(Fl_Native_File_Chooser::BROWSE_SAVE_FILE);
+   if (fc.show() != 0)
+      return;
+
+   fp = fopen(fc.filename(), "w");
+   if (fp == NULL)
+   {
+      fl_alert("<ERROR> Could not save search results!");
+      return;
+   }
+
+   for (i = 1; i <= progress_browser->size(); i++)
+   {
+      fprintf(fp, "%s\n", progress_browser->text(i));
+   }
+
+   fclose(fp);
+
    return;
 }
@@ -43,9 +43,18 @@
 #include <FL/Fl_Box.H>
 #include <FL/filename.H>
 #include <FL/Fl_Button.H>
+#include <FL/Fl_Input.H>
+#include <FL/Fl_Choice.H>
+#include <FL/Fl_Check_Button.H>
 #include <FL/Fl_Native_File_Chooser.H>
 
 #include "fineline-search.h"
+#include "Fineline_File_System_Tree.h"
+#include "Fineline_File_System.h"
+#include "Fineline_Content_Search.h"
+
+#define FL_MAX_SEARCH_RESULTS 100000   /* most paths listed in the results browser */
+#define FL_SEARCH_CONTENT     3        /* search type choice after the path search types */
 
 
 class Fineline_Tree_Search_Dialog : public Fl_Double_Window
@@ -55,11 +64,28 @@ class Fineline_Tree_Search_Dialog : public Fl_Double_Window
       virtual ~Fineline_Tree_Search_Dialog();
 
       static void button_callback(Fl_Button *b, void *p);
+      void show_dialog(Fineline_File_System_Tree *ffst, Fineline_File_System *ffs);
+      void run_content_search();
+      vector<string> get_content_hits(fl_file_record_t *flrec);
+      void clear_search();
 
    protected:
    private:
 
       Fl_Browser *progress_browser;
+      Fl_Input *search_field;
+      Fl_Choice *search_type_choice;
+      Fl_Check_Button *ignore_case_button;
+
+      Fineline_File_System_Tree *file_system_tree;
+      Fineline_File_System *file_system;
+      Fineline_Content_Search *content_search;
+      int search_task_running;
+
+      void search_paths();
+      void start_content_search();
+      void show_content_hits();
+      void save_results();
 
 };
 
@@ -0,0 +1,720 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Trigram_Index.cpp
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Trigram path index. The posting lists are built in two passes
+            over the snapshot, the first counts the paths containing each
+            trigram and the second fills one flat posting array, so the
+            index is three flat arrays that are written to and read from
+            the case index file as they are.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include <unordered_map>
+#include <regex>
+
+#include "Fineline_Trigram_Index.h"
+#include "Fineline_Log.h"
+
+#define FL_TRIGRAM(a, b, c) ((((uint32_t)(a)) << 16) | (((uint32_t)(b)) << 8) | ((uint32_t)(c)))
+
+/* Gets the sorted distinct lower case trigrams of a string. */
+static void get_trigrams(const char *text, size_t length, vector<uint32_t> &trigrams)
+{
+   size_t i;
+
+   trigrams.clear();
+   if (length < 3)
+      return;
+
+   for (i = 0; i + 2 < length; i++)
+   {
+      trigrams.push_back(FL_TRIGRAM(tolower((unsigned char)text[i]), tolower((unsigned char)text[i + 1]), tolower((unsigned char)text[i + 2])));
+   }
+   sort(trigrams.begin(), trigrams.end());
+   trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+static void fold_string(const char *text, size_t length, string &folded)
+{
+   size_t i;
+
+   folded.resize(length);
+   for (i = 0; i < length; i++)
+      folded[i] = (char)tolower((unsigned char)text[i]);
+}
+
+Fineline_Trigram_Index::Fineline_Trigram_Index()
+{
+   fingerprint = 0;
+   posting_offsets.push_back(0);
+}
+
+Fineline_Trigram_Index::~Fineline_Trigram_Index()
+{
+   //dtor
+}
+
+void Fineline_Trigram_Index::clear()
+{
+   file_map.reset();
+   fingerprint = 0;
+   trigram_keys.clear();
+   posting_offsets.assign(1, 0);
+   postings.clear();
+}
+
+/*
+   Function: get_fingerprint
+   Purpose : Hashes every path in a file index snapshot, a saved trigram
+             index is only used if the snapshot has the same fingerprint.
+   Input   : Sorted file index.
+   Output  : 64 bit FNV-1a hash of the paths in sorted order.
+*/
+uint64_t Fineline_Trigram_Index::get_fingerprint(const Fineline_File_Index *findex)
+{
+   uint64_t hash = 14695981039346656037ull;
+   size_t n, i, length;
+   const char *path;
+
+   for (n = 0; n < findex->size(); n++)
+   {
+      path = findex->get_path(n);
+      length = findex->get_path_length(n);
+      for (i = 0; i <= length; i++) // include the NUL as a separator
+      {
+         hash ^= (unsigned char)path[i];
+         hash *= 1099511628211ull;
+      }
+   }
+
+   return(hash);
+}
+
+/*
+   Function: build_index
+   Purpose : Builds the posting lists for every path in a file index snapshot.
+   Input   : Sorted file index snapshot.
+   Output  : Returns 0 on success, -1 on error.
+*/
+int Fineline_Trigram_Index::build_index(Fineline_File_Map fmap)
+{
+   unordered_map<uint32_t, uint32_t> key_slots;   /* trigram -> slot, then -> sorted key number */
+   vector<uint32_t> slot_keys;
+   vector<uint64_t> slot_counts;
+   vector< pair<uint32_t, uint32_t> > order;      /* trigram, slot */
+   vector<uint64_t> fill;
+   vector<uint32_t> trigrams;
+   size_t n, i;
+
+   clear();
+
+   if (!fmap)
+      return(-1);
+
+   if (fmap->size() > UINT32_MAX)
+   {
+      Fineline_Log::print_log_entry("build_index() <ERROR> Too many paths for the trigram index.\n");
+      return(-1);
+   }
+
+   // First pass counts the paths containing each trigram.
+
+   for (n = 0; n < fmap->size(); n++)
+   {
+      get_trigrams(fmap->get_path(n), fmap->get_path_length(n), trigrams);
+      for (i = 0; i < trigrams.size(); i++)
+      {
+         unordered_map<uint32_t, uint32_t>::iterator it = key_slots.find(trigrams[i]);
+         if (it == key_slots.end())
+         {
+            key_slots[trigrams[i]] = (uint32_t)slot_keys.size();
+            slot_keys.push_back(trigrams[i]);
+            slot_counts.push_back(1);
+         }
+         else
+         {
+            slot_counts[it->second]++;
+         }
+      }
+   }
+
+   // Sort the trigrams and lay out the posting lists in key order.
+
+   for (i = 0; i < slot_keys.size(); i++)
+      order.push_back(make_pair(slot_keys[i], (uint32_t)i));
+   sort(order.begin(), order.end());
+
+   trigram_keys.resize(order.size());
+   posting_offsets.resize(order.size() + 1);
+   for (i = 0; i < order.size(); i++)
+   {
+      trigram_keys[i] = order[i].first;
+      posting_offsets[i + 1] = posting_offsets[i] + slot_counts[order[i].second];
+      key_slots[trigram_keys[i]] = (uint32_t)i;
+   }
+   postings.resize(posting_offsets.back());
+   fill.assign(posting_offsets.begin(), posting_offsets.end() - 1);
+
+   // Second pass fills the posting lists, positions are visited in order
+   // so every list comes out sorted.
+
+   for (n = 0; n < fmap->size(); n++)
+   {
+      get_trigrams(fmap->get_path(n), fmap->get_path_length(n), trigrams);
+      for (i = 0; i < trigrams.size(); i++)
+      {
+         postings[fill[key_slots[trigrams[i]]]++] = (uint32_t)n;
+      }
+   }
+
+   file_map = fmap;
+   fingerprint = get_fingerprint(fmap.get());
+
+   return(0);
+}
+
+const uint32_t *Fineline_Trigram_Index::find_postings(uint32_t trigram, size_t *count) const
+{
+   vector<uint32_t>::const_iterator it = lower_bound(trigram_keys.begin(), trigram_keys.end(), trigram);
+   size_t key;
+
+   *count = 0;
+   if ((it == trigram_keys.end()) || (*it != trigram))
+      return(NULL);
+
+   key = it - trigram_keys.begin();
+   *count = (size_t)(posting_offsets[key + 1] - posting_offsets[key]);
+
+   return(&postings[posting_offsets[key]]);
+}
+
+/*
+   Function: get_candidates
+   Purpose : Intersects the posting lists of every trigram in the literals,
+             shortest list first.
+   Input   : Literal strings every match must contain.
+   Output  : Returns 1 and the sorted candidate positions, or 0 if the
+             literals have no trigrams and every path is a candidate.
+*/
+int Fineline_Trigram_Index::get_candidates(const vector<string> &literals, vector<uint32_t> &candidates) const
+{
+   vector< pair<size_t, const uint32_t *> > lists;
+   vector<uint32_t> trigrams;
+   vector<uint32_t> merged;
+   const uint32_t *list;
+   size_t i, j, count;
+
+   candidates.clear();
+
+   for (i = 0; i < literals.size(); i++)
+   {
+      get_trigrams(literals[i].c_str(), literals[i].size(), trigrams);
+      for (j = 0; j < trigrams.size(); j++)
+      {
+         list = find_postings(trigrams[j], &count);
+         if (list == NULL)
+            return(1); // a required trigram is in no path
+         lists.push_back(make_pair(count, list));
+      }
+   }
+
+   if (lists.size() == 0)
+      return(0);
+
+   sort(lists.begin(), lists.end());
+
+   candidates.assign(lists[0].second, lists[0].second + lists[0].first);
+   for (i = 1; (i < lists.size()) && (candidates.size() > 0); i++)
+   {
+      merged.clear();
+      set_intersection(candidates.begin(), candidates.end(), lists[i].second, lists[i].second + lists[i].first, back_inserter(merged));
+      candidates.swap(merged);
+   }
+
+   return(1);
+}
+
+/*
+   Function: search
+   Purpose : Finds the paths matching a substring, glob or regex pattern.
+             Globs and regexes must match the whole path and any part of
+             the path respectively.
+   Input   : Pattern, search type, case insensitive flag and the maximum
+             number of results (0 = no limit).
+   Output  : Matching snapshot positions in path order, returns the number
+             of matches or -1 if the pattern is not a valid regex.
+*/
+long Fineline_Trigram_Index::search(const string &pattern, int search_type, int ignore_case, vector<size_t> &positions, size_t max_results) const
+{
+   vector<string> literals;
+   vector<uint32_t> candidates;
+   string folded_pattern;
+   string folded_path;
+   regex search_regex;
+   size_t i, n, count;
+   int narrowed, matched;
+   const char *path;
+
+   positions.clear();
+
+   if ((!file_map) || (pattern.size() == 0))
+      return(0);
+
+   if (search_type == FL_SEARCH_REGEX)
+   {
+      try
+      {
+         search_regex.assign(pattern, ignore_case ? (regex::ECMAScript | regex::icase) : regex::ECMAScript);
+      }
+      catch (regex_error &)
+      {
+         Fineline_Log::print_log_entry("search() <ERROR> Invalid regular expression.\n");
+         return(-1);
+      }
+   }
+
+   fold_string(pattern.c_str(), pattern.size(), folded_pattern);
+
+   get_required_literals(pattern, search_type, literals);
+   narrowed = get_candidates(literals, candidates);
+   count = narrowed ? candidates.size() : file_map->size();
+
+   for (i = 0; i < count; i++)
+   {
+      n = narrowed ? candidates[i] : i;
+      path = file_map->get_path(n);
+
+      switch (search_type)
+      {
+         case FL_SEARCH_GLOB:
+            matched = glob_match(pattern.c_str(), path, ignore_case);
+            break;
+         case FL_SEARCH_REGEX:
+            matched = regex_search(path, path + file_map->get_path_length(n), search_regex);
+            break;
+         default:
+            if (ignore_case)
+            {
+               fold_string(path, file_map->get_path_length(n), folded_path);
+               matched = (folded_path.find(folded_pattern) != string::npos);
+            }
+            else
+            {
+               matched = (strstr(path, pattern.c_str()) != NULL);
+            }
+      }
+
+      if (matched)
+      {
+         positions.push_back(n);
+         if ((max_results > 0) && (positions.size() >= max_results))
+            break;
+      }
+   }
+
+   return((long)positions.size());
+}
+
+/*
+   Function: get_required_literals
+   Purpose : Extracts literal strings that every match of the pattern must
+             contain. Anything the extraction does not understand ends the
+             current literal, so the result is always safe to narrow with.
+             Regexes containing alternation give no literals.
+   Input   : Pattern and search type.
+   Output  : The literal strings of 3 or more bytes.
+*/
+void Fineline_Trigram_Index::get_required_literals(const string &pattern, int search_type, vector<string> &literals)
+{
+   string run;
+   size_t i = 0;
+   int depth;
+   char c;
+
+   literals.clear();
+
+   if (search_type == FL_SEARCH_SUBSTRING)
+   {
+      if (pattern.size() >= 3)
+         literals.push_back(pattern);
+      return;
+   }
+
+   if ((search_type == FL_SEARCH_REGEX) && (pattern.find('|') != string::npos))
+      return;
+
+   while (i < pattern.size())
+   {
+      c = pattern[i];
+
+      if (search_type == FL_SEARCH_GLOB)
+      {
+         if ((c == '*') || (c == '?'))
+         {
+            if (run.size() >= 3) literals.push_back(run);
+            run.clear();
+            i++;
+         }
+         else if ((c == '[') && (pattern.find(']', i + 2) != string::npos))
+         {
+            if (run.size() >= 3) literals.push_back(run);
+            run.clear();
+            i = pattern.find(']', i + 2) + 1;
+         }
+         else
+         {
+            run += c;
+            i++;
+         }
+         continue;
+      }
+
+      switch (c)
+      {
+         case '\\':
+            if ((i + 1 < pattern.size()) && (!isalnum((unsigned char)pattern[i + 1])))
+            {
+               run += pattern[i + 1]; // escaped literal such as \. or \/
+               i += 2;
+               break;
+            }
+            // Character classes, \xHH, \uHHHH, \cX and back references end the
+            // literal, the whole escape is skipped so none of it joins the next run.
+            if (run.size() >= 3) literals.push_back(run);
+            run.clear();
+            i++;
+            if (i >= pattern.size())
+               break;
+            c = pattern[i++];
+            if (c == 'x')
+               i += 2;
+            else if (c == 'u')
+               i += 4;
+            else if (c == 'c')
+               i++;
+            else if (isdigit((unsigned char)c))
+            {
+               while ((i < pattern.size()) && isdigit((unsigned char)pattern[i]))
+                  i++;
+            }
+            if (i > pattern.size())
+               i = pattern.size();
+            break;
+         case '*':
+         case '?':
+         case '{':
+            // The preceding character is optional or repeated, drop it.
+            if (run.size() > 0)
+               run.erase(run.size() - 1);
+            if (run.size() >= 3) literals.push_back(run);
+            run.clear();
+            i = (c == '{') ? pattern.find('}', i) : i + 1;
+            if (i == string::npos)
+               i = pattern.size();
+            else if (c == '{')
+               i++;
+            break;
+         case '[':
+            if (run.size() >= 3) literals.push_back(run);
+            run.clear();
+            i++;
+            if ((i < pattern.size()) && (pattern[i] == '^')) i++;
+            if ((i < pattern.size()) && (pattern[i] == ']')) i++;
+            while ((i < pattern.size()) && (pattern[i] != ']'))
+               i += (pattern[i] == '\\') ? 2 : 1;
+            i++;
+            break;
+         case '(':
+            // Groups may be optional, skip the whole group.
+            if (run.size() >= 3) literals.push_back(run);
+            run.clear();
+            for (depth = 0; i < pattern.size(); i++)
+            {
+               if (pattern[i] == '\\') { i++; continue; }
+               if (pattern[i] == '(') depth++;
+               if ((pattern[i] == ')') && (--depth == 0)) break;
+            }
+            i++;
+            break;
+         case '.':
+         case '^':
+         case '$':
+         case '+':
+         case ')':
+            if (run.size() >= 3) literals.push_back(run);
+            run.clear();
+            i++;
+            break;
+         default:
+            run += c;
+            i++;
+      }
+   }
+
+   if (run.size() >= 3)
+      literals.push_back(run);
+}
+
+/* Matches one glob character class starting at the '[', sets the end past the ']'. */
+static int glob_class(const char *p, unsigned char c, int ignore_case, const char **end)
+{
+   const char *q = p + 1;
+   int negate = 0, matched = 0, first = 1;
+   unsigned char lo, hi;
+
+   if ((*q == '!') || (*q == '^'))
+   {
+      negate = 1;
+      q++;
+   }
+
+   while ((*q != 0) && ((*q != ']') || first))
+   {
+      lo = (unsigned char)*q;
+      if ((q[1] == '-') && (q[2] != 0) && (q[2] != ']'))
+      {
+         hi = (unsigned char)q[2];
+         q += 3;
+      }
+      else
+      {
+         hi = lo;
+         q++;
+      }
+      if (((c >= lo) && (c <= hi)) ||
+          (ignore_case && (((tolower(c) >= lo) && (tolower(c) <= hi)) || ((toupper(c) >= lo) && (toupper(c) <= hi)))))
+         matched = 1;
+      first = 0;
+   }
+
+   if (*q != ']')
+   {
+      // No closing bracket, the '[' is an ordinary character.
+      *end = p + 1;
+      return(c == '[');
+   }
+
+   *end = q + 1;
+
+   return(matched != negate);
+}
+
+/*
+   Function: glob_match
+   Purpose : Matches a whole string against a glob pattern with the
+             wildcards *, ? and [...] character classes.
+   Input   : Pattern, text and case insensitive flag.
+   Output  : Returns 1 if the text matches, 0 if not.
+*/
+int Fineline_Trigram_Index::glob_match(const char *pattern, const char *text, int ignore_case)
+{
+   const char *p = pattern;
+   const char *t = text;
+   const char *star_p = NULL;
+   const char *star_t = NULL;
+   const char *next;
+   int matched;
+
+   while (*t != 0)
+   {
+      if (*p == '*')
+      {
+         while (*p == '*')
+            p++;
+         if (*p == 0)
+            return(1);
+         star_p = p;
+         star_t = t;
+         continue;
+      }
+
+      next = p + 1;
+      if (*p == '?')
+         matched = 1;
+      else if (*p == '[')
+         matched = glob_class(p, (unsigned char)*t, ignore_case, &next);
+      else if (*p != 0)
+         matched = ignore_case ? (tolower((unsigned char)*p) == tolower((unsigned char)*t)) : (*p == *t);
+      else
+         matched = 0;
+
+      if (matched)
+      {
+         p = next;
+         t++;
+      }
+      else if (star_p != NULL)
+      {
+         // Let the last star take one more character and try again.
+         p = star_p;
+         t = ++star_t;
+      }
+      else
+      {
+         return(0);
+      }
+   }
+
+   while (*p == '*')
+      p++;
+
+   return(*p == 0);
+}
+
+/*
+   Function: save_index
+   Purpose : Writes the index to a case index file. The arrays are written
+             in host byte order.
+   Input   : File name.
+   Output  : Returns 0 on success, -1 on error.
+*/
+int Fineline_Trigram_Index::save_index(const char *filename) const
+{
+   uint64_t header[4];
+   FILE *fp;
+   int result = 0;
+
+   if (!file_map)
+      return(-1);
+
+   fp = fopen(filename, "wb");
+   if (fp == NULL)
+   {
+      string msg = "save_index() <ERROR> Could not create index file: ";
+      msg.append(filename);
+      Fineline_Log::print_log_entry(msg.c_str());
+      return(-1);
+   }
+
+   header[0] = file_map->size();
+   header[1] = fingerprint;
+   header[2] = trigram_keys.size();
+   header[3] = postings.size();
+
+   if ((fwrite(FL_TRIGRAM_MAGIC, 8, 1, fp) != 1) ||
+       (fwrite(header, sizeof(header), 1, fp) != 1) ||
+       (fwrite(trigram_keys.data(), sizeof(uint32_t), trigram_keys.size(), fp) != trigram_keys.size()) ||
+       (fwrite(posting_offsets.data(), sizeof(uint64_t), posting_offsets.size(), fp) != posting_offsets.size()) ||
+       (fwrite(postings.data(), sizeof(uint32_t), postings.size(), fp) != postings.size()))
+   {
+      Fineline_Log::print_log_entry("save_index() <ERROR> Could not write index file.\n");
+      result = -1;
+   }
+
+   fclose(fp);
+
+   return(result);
+}
+
+/*
+   Function: load_index
+   Purpose : Reads a case index file written by save_index(). The index is
+             only loaded if it was built from the same paths as the snapshot.
+   Input   : File name and the sorted file index snapshot.
+   Output  : Returns 0 on success, -1 if the file is missing, invalid or stale.
+*/
+int Fineline_Trigram_Index::load_index(const char *filename, Fineline_File_Map fmap)
+{
+   char magic[8];
+   uint64_t header[4];
+   FILE *fp;
+   size_t i;
+   int result = -1;
+
+   clear();
+
+   if (!fmap)
+      return(-1);
+
+   fp = fopen(filename, "rb");
+   if (fp == NULL)
+      return(-1);
+
+   if ((fread(magic, 8, 1, fp) == 1) && (memcmp(magic, FL_TRIGRAM_MAGIC, 8) == 0) &&
+       (fread(header, sizeof(header), 1, fp) == 1) &&
+       (header[0] == fmap->size()) && (header[1] == get_fingerprint(fmap.get())))
+   {
+      trigram_keys.resize(header[2]);
+      posting_offsets.resize(header[2] + 1);
+      postings.resize(header[3]);
+
+      if ((fread(trigram_keys.data(), sizeof(uint32_t), trigram_keys.size(), fp) == trigram_keys.size()) &&
+          (fread(posting_offsets.data(), sizeof(uint64_t), posting_offsets.size(), fp) == posting_offsets.size()) &&
+          (fread(postings.data(), sizeof(uint32_t), postings.size(), fp) == postings.size()) &&
+          (posting_offsets.back() == postings.size()))
+      {
+         result = 0;
+         for (i = 0; i < postings.size(); i++)
+         {
+            if (postings[i] >= header[0])
+               result = -1;
+         }
+      }
+   }
+
+   fclose(fp);
+
+   if (result < 0)
+   {
+      string msg = "load_index() <ERROR> Invalid or out of date index file: ";
+      msg.append(filename);
+      Fineline_Log::print_log_entry(msg.c_str());
+      clear();
+      return(-1);
+   }
+
+   file_map = fmap;
+   fingerprint = header[1];
+
+   return(0);
+}
+
+Fineline_File_Map Fineline_Trigram_Index::get_file_map() const
+{
+   return(file_map);
+}
+
+size_t Fineline_Trigram_Index::get_trigram_count() const
+{
+   return(trigram_keys.size());
+}
+
+size_t Fineline_Trigram_Index::get_posting_count() const
+{
+   return(postings.size());
+}
+
+size_t Fineline_Trigram_Index::get_memory_used() const
+{
+   return(trigram_keys.capacity() * sizeof(uint32_t) + posting_offsets.capacity() * sizeof(uint64_t) +
+          postings.capacity() * sizeof(uint32_t));
+}
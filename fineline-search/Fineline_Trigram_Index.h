@@ -0,0 +1,95 @@
+/*  Copyright 2014 Derek Chadwick
+
+    This file is part of the FineLine Computer Forensics Timeline Tools.
+
+    FineLine is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FineLine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FineLine.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+   Fineline_Trigram_Index.h
+
+   Title : FineLine Computer Forensics Image Search GUI
+   Author: Derek Chadwick
+   Date  : 02/03/2014
+
+   Purpose: Trigram index over the paths of a file index snapshot. Every run
+            of three lower case bytes in a path has a sorted posting list of
+            the snapshot positions containing it. Searches take the literal
+            text the pattern requires, intersect the posting lists of its
+            trigrams and only run the real substring, glob or regex matcher
+            on the surviving candidates.
+
+            The index keeps the snapshot it was built from, positions in the
+            search results are positions in that snapshot.
+
+   Notes: EXPERIMENTAL
+
+*/
+
+#ifndef FINELINE_TRIGRAM_INDEX_H
+#define FINELINE_TRIGRAM_INDEX_H
+
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fineline-search.h"
+#include "Fineline_File_Index.h"
+
+#define FL_SEARCH_SUBSTRING 0
+#define FL_SEARCH_GLOB      1
+#define FL_SEARCH_REGEX     2
+
+#define FL_TRIGRAM_MAGIC "FLTRI001"
+
+using namespace std;
+
+class Fineline_Trigram_Index
+{
+   public:
+      Fineline_Trigram_Index();
+      virtual ~Fineline_Trigram_Index();
+
+      int build_index(Fineline_File_Map fmap);
+      long search(const string &pattern, int search_type, int ignore_case, vector<size_t> &positions, size_t max_results = 0) const;
+      int save_index(const char *filename) const;
+      int load_index(const char *filename, Fineline_File_Map fmap);
+      void clear();
+
+      Fineline_File_Map get_file_map() const;
+      size_t get_trigram_count() const;
+      size_t get_posting_count() const;
+      size_t get_memory_used() const;
+
+      static int glob_match(const char *pattern, const char *text, int ignore_case);
+      static void get_required_literals(const string &pattern, int search_type, vector<string> &literals);
+
+   protected:
+   private:
+
+      static uint64_t get_fingerprint(const Fineline_File_Index *findex);
+      const uint32_t *find_postings(uint32_t trigram, size_t *count) const;
+      int get_candidates(const vector<string> &literals, vector<uint32_t> &candidates) const;
+
+      Fineline_File_Map file_map;
+      uint64_t fingerprint;            /* hash of every path in the snapshot, checked when loading */
+      vector< uint32_t > trigram_keys; /* sorted distinct trigrams */
+      vector< uint64_t > posting_offsets; /* postings of trigram_keys[i] are offsets i to i + 1 */
+      vector< uint32_t > postings;     /* snapshot positions */
+};
+
+#endif // FINELINE_TRIGRAM_INDEX_H
@@ -28,7 +28,7 @@
    Purpose: FineLine FLTK GUI. Consists of a main window widget containing:
             Tabbed Panel
                |-> Tab 1 : File System Tree and file metadata browser.
-               |-> Tab 2 : Statistical graph of the file system.
+               |-> Tab 2 : Statistics of the files in the file system.
                |-> Tab 3 : Timeline graph.
                |-> Tab 4 : Keyword search panel.
                |-> Tab 5 : Report panel, contains the results of the file system analysis,
@@ -50,6 +50,7 @@
 #include <FL/Fl_Scroll.H>
 
 #include "Fineline_UI.h"
+#include "../common/threads.h"
 
 
 using namespace std;
@@ -69,6 +70,7 @@ Fineline_Tree_Filter_Dialog *Fineline_UI::tree_filter_dialog;
 Fineline_Tree_Search_Dialog *Fineline_UI::tree_search_dialog;
 Fineline_Report_Dialog *Fineline_UI::report_dialog;
 Fineline_Timeline_Dialog *Fineline_UI::timeline_dialog;
+Fineline_Statistics_Dialog *Fineline_UI::statistics_dialog;
 Fineline_File_Display_Dialog *Fineline_UI::file_display_dialog;
 
 // Data/Controller objects
@@ -77,6 +79,10 @@ Fineline_Project *Fineline_UI::fineline_project;
 Fineline_File_System *Fineline_UI::file_system;
 Fineline_Thread *Fineline_UI::socket_thread;
 Fineline_Log *Fineline_UI::flog;
+Fineline_File_Hasher *Fineline_UI::file_hasher;
+int Fineline_UI::hash_task_running;
+Fineline_Hash_Set *Fineline_UI::known_good_set;
+Fineline_Hash_Set *Fineline_UI::known_bad_set;
 
 // UI Method Implementation
 
@@ -107,6 +113,10 @@ Fineline_UI::Fineline_UI()
    menu->add("&Edit/&Options", "^o", main_menu_callback);
    menu->add("&Edit/&Project", "^r", main_menu_callback);
 
+   menu->add("&Tools/&Known Good Hash Set", 0, tools_menu_callback);
+   menu->add("&Tools/Known &Bad Hash Set",  0, tools_menu_callback, 0, FL_MENU_DIVIDER);
+   menu->add("&Tools/&Hash Files",        "^h", tools_menu_callback);
+
    menu->add("&Help/User Guide",    0, main_menu_callback);
    menu->add("&Help/About",     0, main_menu_callback);
 
@@ -182,17 +192,11 @@ Fineline_UI::Fineline_UI()
    // Tab 2 - Statistical graph panel
    //----------------------------------------------------------------------------------
 
-   Fl_Group* statistical_graph_tab = new Fl_Group(5, 70, win_width - 10, win_height - 75, "Statistics Graph");
-   statistical_graph_tab->tooltip("Summary graph of file system activity.");
+   Fl_Group* statistical_graph_tab = new Fl_Group(5, 70, win_width - 10, win_height - 75, "Statistics");
+   statistical_graph_tab->tooltip("Summary statistics of the files in the forensic image.");
    statistical_graph_tab->hide();
-   {
-	   Fl_Button* o = new Fl_Button(20, 90, 100, 30, "button");
-      o->callback((Fl_Callback*)button_callback);
-   }  // Fl_Button* o
-   {
-      Fl_Button* o = new Fl_Button(20, 200, 100, 30, "button");
-      o->callback((Fl_Callback*)button_callback);
-   } // Fl_Button* o
+   statistics_dialog = new Fineline_Statistics_Dialog(10, 80, win_width - 20, win_height - 85);
+   statistical_graph_tab->resizable(statistics_dialog);
    statistical_graph_tab->end();
    Fl_Group::current()->resizable(statistical_graph_tab);
 
@@ -286,6 +290,8 @@ Fineline_UI::Fineline_UI()
    tree_search_dialog = new Fineline_Tree_Search_Dialog(win_width/2 - 300, win_height/2 - 300, 800, 600);
    file_display_dialog = new Fineline_File_Display_Dialog(win_width/2 - 300, win_height/2 - 300, 800, 600);
    fc = new Fl_Native_File_Chooser();
+   known_good_set = new Fineline_Hash_Set();
+   known_bad_set = new Fineline_Hash_Set();
 
    if (DEBUG)
       cout << "Fineline_UI.ctor() <INFO> Finished making UI...\n" << endl;
@@ -372,6 +378,12 @@ void Fineline_UI::open_menu_callback(Fl_Widget *w, void *x)
          default:		      // Choice
             fc->preset_file(fc->filename());
             fineline_project->open_project(fc->filename());
+            if (open_case_snapshot() > 0)
+            {
+               open_project_sections();
+               if (open_search_index() < 0)
+                  file_system_tree->build_search_index();
+            }
             project_dialog->show_dialog(false);
       }
    }
@@ -421,13 +433,15 @@ void Fineline_UI::save_menu_callback(Fl_Widget *w, void *x)
    char ipath[256];
 
    menu_bar->item_pathname(ipath, sizeof(ipath));	   // Get full pathname of picked item
-   if ( strncmp(item->label(), "&Save", 5) == 0 )
+   if ( strcmp(item->label(), "&Save") == 0 )
    {
 	  // Save the project file
+	  save_project_sections();
 	  fineline_project->save_project();
-	  //TODO: save filesystem tree, file metadata, timeline events, analysis statistics.
+	  fineline_project->write_search_index(file_system_tree->get_search_index().get());
+	  save_case_snapshot();
    }
-   else if ( strncmp(item->label(), "&Save As", 8) == 0 )
+   else if ( strcmp(item->label(), "&Save As") == 0 )
    {
       // Open the save as file dialogue
       fc->title("Save Project File As");
@@ -438,7 +452,10 @@ void Fineline_UI::save_menu_callback(Fl_Widget *w, void *x)
          case  1: break; 	// Cancel
          default:		      // Choice
          fc->preset_file(fc->filename());
+         save_project_sections();
          fineline_project->save_project_as(fc->filename());
+         fineline_project->write_search_index(file_system_tree->get_search_index().get());
+         save_case_snapshot();
       }
    }
    return;
@@ -497,7 +514,7 @@ void Fineline_UI::popup_menu_callback(Fl_Widget *w, void *x)
    else if ( strncmp(item->label(), "Open File", 9) == 0 )
    {
       //Display the file (images/video/text/docs/web pages) in a dialogue or for unknown binary files open a hex editor.
-      //TODO: file_display_dialog->add_file(file_system_tree->get_selected_file());
+      file_display_dialog->display_file(file_system_tree->get_selected_file_record(), file_system);
       file_display_dialog->show();
    }
    else if ( strncmp(item->label(), "Export", 6) == 0 )
@@ -514,7 +531,7 @@ void Fineline_UI::popup_menu_callback(Fl_Widget *w, void *x)
    else if ( strncmp(item->label(), "Timeline", 8) == 0 )
    {
       // open the event dialogue to create fineline event records for the marked files and add to the timeline graph.
-      timeline_dialog->add_marked_files(file_system_tree->get_marked_files());
+      add_timeline_files();
       timeline_dialog->show();
    }
    else if ( strncmp(item->label(), "Report", 6) == 0 )
@@ -554,14 +571,6 @@ void Fineline_UI::file_system_tree_callback(Fl_Tree *flt, void *x)
       if (flrec != NULL)
       {
          update_file_metadata_browser(flrec);
-
-#ifndef LINUX_BUILD
-         if ((flrec->file_type == TSK_FS_META_TYPE_DIR) && (strncmp(flrec->file_name, "winsxs", 6) == 0))
-         {
-            file_system_tree->add_file_nodes(file_path);
-         }
-#endif
-
       }
       else
       {
@@ -569,6 +578,14 @@ void Fineline_UI::file_system_tree_callback(Fl_Tree *flt, void *x)
          fl_message(" <ERROR> Could not get find file record. ");
       }
    }
+   else if (flt->callback_reason() == FL_TREE_REASON_OPENED)
+   {
+      file_system_tree->open_directory(flti);
+   }
+   else if (flt->callback_reason() == FL_TREE_REASON_CLOSED)
+   {
+      file_system_tree->close_directory(flti);
+   }
 
    return;
 }
@@ -678,8 +695,8 @@ void Fineline_UI::tree_button_callback(Fl_Button *b, void *p)
       if (DEBUG)
          cout << "Fineline_UI::tree_button_callback() <INFO> " << b->label() << endl;
 
-      //TODO: pass in the file system tree pointer and open the search dialogue to enter search criteria.
-      tree_search_dialog->show();
+      // Pass in the file system tree pointer and open the search dialogue to enter search criteria.
+      tree_search_dialog->show_dialog(file_system_tree, file_system);
    }
    else if ( strncmp(b->label(), "Report", 6) == 0 )
    {
@@ -689,8 +706,8 @@ void Fineline_UI::tree_button_callback(Fl_Button *b, void *p)
    }
    else if ( strncmp(b->label(), "Timeline", 8) == 0 )
    {
-      // open the search dialogue to enter search criteria.
-      timeline_dialog->add_marked_files(file_system_tree->get_marked_files());
+      // open the timeline dialogue to save the events of the marked files.
+      add_timeline_files();
       timeline_dialog->show();
    }
 
@@ -707,7 +724,32 @@ void Fineline_UI::update_file_metadata_browser(fl_file_record_t *flrec)
 {
    string metadata;
 
+   vector<string> hits = tree_search_dialog->get_content_hits(flrec);
+   unsigned int i;
+
    file_metadata_browser->add_file_record(flrec);
+   if (flrec->digests != NULL)
+   {
+      metadata = "   MD5: ";
+      metadata.append(Fineline_Hash::to_hex(flrec->digests->md5, FL_MD5_LENGTH));
+      file_metadata_browser->add_row(metadata);
+      metadata = "   SHA-1: ";
+      metadata.append(Fineline_Hash::to_hex(flrec->digests->sha1, FL_SHA1_LENGTH));
+      file_metadata_browser->add_row(metadata);
+      metadata = "   SHA-256: ";
+      metadata.append(Fineline_Hash::to_hex(flrec->digests->sha256, FL_SHA256_LENGTH));
+      file_metadata_browser->add_row(metadata);
+      if (flrec->hash_set == FL_HASH_SET_KNOWN_BAD)
+         file_metadata_browser->add_row("   Hash set: KNOWN BAD");
+      else if (flrec->hash_set == FL_HASH_SET_KNOWN_GOOD)
+         file_metadata_browser->add_row("   Hash set: known good");
+   }
+   for (i = 0; i < hits.size(); i++)
+   {
+      metadata = "   Keyword hit: ";
+      metadata.append(hits[i]);
+      file_metadata_browser->add_row(metadata);
+   }
    //file_metadata_browser->(file_metadata_browser->size());
 
    return;
@@ -726,6 +768,7 @@ int Fineline_UI::start_image_process_thread(const char *filename)
 {
    string fns = filename;
 
+   clear_file_records();
    file_system_tree->clear_tree();
 
    if (file_system != NULL)
@@ -738,9 +781,12 @@ int Fineline_UI::start_image_process_thread(const char *filename)
       flog->print_log_entry("Fineline_UI::load_forensic_image() <ERROR> Could not create file system object.\n");
       return(-1);
    }
+   statistics_dialog->set_file_system(file_system);
+   if (fineline_project->getProjectFileName().size() > 0)
+      file_system->set_snapshot_file(fineline_project->get_snapshot_file_name());
    progress_dialog->show();
 
-   file_system->start_task(); //Note: do not delete file system object after starting the thread
+   file_system->start_task(); //Note: call clear_file_records() before deleting the file system object
 
    return(0);
 }
@@ -755,6 +801,13 @@ int Fineline_UI::start_image_process_thread(const char *filename)
 int Fineline_UI::load_forensic_image(const char *filename)
 {
    string fns = filename;
+
+   clear_file_records();
+   file_system_tree->clear_tree();
+
+   if (file_system != NULL)
+      delete file_system;
+
    file_system = new Fineline_File_System(file_system_tree, fns, progress_dialog, flog);
 
    if (file_system == NULL)
@@ -762,6 +815,7 @@ int Fineline_UI::load_forensic_image(const char *filename)
       flog->print_log_entry("Fineline_UI::load_forensic_image() <ERROR> Could not create file system object.\n");
       return(-1);
    }
+   statistics_dialog->set_file_system(file_system);
    if (file_system->open_forensic_image() == -1)
    {
       flog->print_log_entry("Fineline_UI::load_forensic_image() <ERROR> Could not open image file.\n");
@@ -772,10 +826,9 @@ int Fineline_UI::load_forensic_image(const char *filename)
       flog->print_log_entry("Fineline_UI::load_forensic_image() <ERROR> Could process open image file.\n");
       return(-1);
    }
+   // the tree holds the file records, the file system is kept until the next image is opened
    file_system->close_forensic_image();
 
-   delete file_system;
-
    return(0);
 }
 
@@ -796,7 +849,326 @@ int Fineline_UI::save_tree(const char *filename)
    return(0);
 }
 
+/*
+   Name   : open_search_index()
+   Purpose: Loads the path search index saved with the project if it matches
+            the file system tree, otherwise the index is rebuilt when the
+            forensic image is processed or the first search is run.
+   Input  : None.
+   Output : returns 0 on success, -1 if there is no usable saved index.
+
+*/
+int Fineline_UI::open_search_index()
+{
+   shared_ptr< Fineline_Trigram_Index > tindex = make_shared< Fineline_Trigram_Index >();
+
+   if (file_system_tree->tree_size() == 0)
+      return(-1);
+
+   if (fineline_project->read_search_index(tindex.get(), file_system_tree->get_file_map()) < 0)
+      return(-1);
+
+   file_system_tree->set_search_index(tindex);
+
+   return(0);
+}
+
+
+/*
+   Name   : open_case_snapshot()
+   Purpose: Restores the file system tree from the case snapshot saved with
+            the project, so the forensic image does not have to be walked
+            again. The image is reopened for file viewing and export.
+   Input   : None.
+   Output  : returns the number of files, -1 if there is no usable snapshot.
+
+*/
+int Fineline_UI::open_case_snapshot()
+{
+   Fineline_Case_Snapshot *snapshot = new Fineline_Case_Snapshot();
+   int file_total;
+
+   if (fineline_project->read_case_snapshot(snapshot) < 0)
+   {
+      delete snapshot;
+      return(-1);
+   }
+
+   clear_file_records();
+   file_system_tree->clear_tree();
+   if (file_system != NULL)
+      delete file_system;
+
+   file_system = new Fineline_File_System(file_system_tree, snapshot->get_image_name(), progress_dialog, flog);
+   statistics_dialog->set_file_system(file_system);
+   file_total = file_system->load_case_snapshot(snapshot);
+   delete snapshot;
+
+   return(file_total);
+}
+
+/*
+   Name   : open_project_sections()
+   Purpose: Restores the file marks, comments and timeline events saved in the
+            project once the file records have been loaded.
+   Input   : None.
+   Output  : returns the number of files restored, -1 on fail.
+
+*/
+int Fineline_UI::open_project_sections()
+{
+   Fineline_File_Map fmap = file_system_tree->get_file_map();
+   vector<fl_mac_event_t> events;
+   int file_total;
+
+   if ((file_system == NULL) || (file_system_tree->tree_size() == 0))
+      return(-1);
+
+   file_total = fineline_project->read_file_system_tree(fmap, file_system->get_file_arena());
+   if (fineline_project->read_timeline_event_list(fmap, events) > 0)
+      file_system->set_mac_events(events);
+   file_system_tree->redraw();
+
+   return(file_total);
+}
+
+/*
+   Name   : save_project_sections()
+   Purpose: Passes the file marks, marked file metadata and timeline events to
+            the project, only the sections that have changed are saved.
+   Input   : None.
+   Output  : returns 0 on success, -1 if there is nothing to save yet.
+
+*/
+int Fineline_UI::save_project_sections()
+{
+   Fineline_File_Map fmap;
+
+   // The records and events are still being added while the image is processed.
+   if ((file_system == NULL) || file_system->get_running() || (file_system_tree->tree_size() == 0))
+      return(-1);
+
+   fmap = file_system_tree->get_file_map();
+   fineline_project->write_file_metadata_list(fmap);
+   fineline_project->write_file_system_tree(fmap);
+   fineline_project->write_timeline_event_list(file_system->get_mac_events());
+
+   Fineline_File_Statistics fstats;
+   file_system->get_file_statistics(&fstats);
+   fineline_project->write_statistical_records(fstats.get_statistics_map());
+
+   return(0);
+}
+
+/*
+   Name   : save_case_snapshot()
+   Purpose: Saves the file records of the current image with the project,
+            including the file marks, comments and digests.
+   Input   : None.
+   Output  : returns 0 on success, -1 on fail.
+
+*/
+int Fineline_UI::save_case_snapshot()
+{
+   if ((file_system == NULL) || (file_system_tree->tree_size() == 0) || (fineline_project->getProjectFileName().size() == 0))
+      return(-1);
+
+   return(file_system->write_case_snapshot(fineline_project->get_snapshot_file_name(), file_system_tree->get_file_map()));
+}
 
+/*
+   Function: file_hash_task
+   Purpose : Worker function for the posix/win32 thread, must be a C function.
+   Input   : Not used.
+   Output  : Returns NULL.
+*/
+void *file_hash_task(void *p)
+{
+   Fineline_UI::run_file_hasher();
+
+   return(NULL);
+}
+
+/*
+   Name   : tools_menu_callback()
+   Purpose: Called from the main menu to open the known good and known bad
+            hash sets and to hash the files in the forensic image.
+   Input  : FLTK menu bar widget.
+   Output : None.
+*/
+void Fineline_UI::tools_menu_callback(Fl_Widget *w, void *x)
+{
+   Fl_Menu_Bar *menu_bar = (Fl_Menu_Bar*)w;				// Get the menubar widget
+   const Fl_Menu_Item *item = menu_bar->mvalue();		// Get the menu item that was picked
+   Fineline_Hash_Set *hash_set;
+   char msg[FL_MAX_INPUT_STR];
+   Fl_Thread thread_id;
+   long count;
+
+   if ( strstr(item->label(), "Hash Set") != NULL )
+   {
+      hash_set = (strstr(item->label(), "Good") != NULL) ? known_good_set : known_bad_set;
+      if ((file_hasher != NULL) && file_hasher->get_running())
+      {
+         fl_alert("<ERROR> Wait for the file hashing to finish!");
+         return;
+      }
+      fc->title("Open Hash Set");
+      fc->type(Fl_Native_File_Chooser::BROWSE_FILE);		// only picks files that exist
+      switch ( fc->show() )
+      {
+         case -1: break;	// Error
+         case  1: break; 	// Cancel
+         default:		      // Choice
+            count = hash_set->open_hash_set(fc->filename());
+            if (count < 0)
+            {
+               fl_alert("<ERROR> Could not open the hash set file!");
+               break;
+            }
+            snprintf(msg, FL_MAX_INPUT_STR, "Opened hash set %s with %ld digests.", fc->filename(), count);
+            progress_dialog->add_progress_message(msg);
+      }
+   }
+   else if ( strstr(item->label(), "&Hash Files") != NULL )
+   {
+      if (file_system == NULL)
+      {
+         fl_alert("<ERROR> Open a forensic image before hashing the files!");
+         return;
+      }
+      if ((file_hasher != NULL) && file_hasher->get_running())
+      {
+         fl_alert("<ERROR> The files are already being hashed!");
+         return;
+      }
+
+      if (file_hasher != NULL)
+         delete file_hasher;
+
+      file_hasher = new Fineline_File_Hasher(file_system->get_image_name(), file_system->get_file_system_offsets(), file_system->get_file_arena());
+      file_hasher->set_known_good(known_good_set);
+      file_hasher->set_known_bad(known_bad_set);
+      file_hasher->add_files(file_system_tree->get_file_map());
+
+      snprintf(msg, FL_MAX_INPUT_STR, "Hashing %lu files...", (unsigned long)file_hasher->get_file_count());
+      progress_dialog->add_progress_message(msg);
+      progress_dialog->show();
+
+      hash_task_running = 1;
+      fl_create_thread(thread_id, file_hash_task, NULL);
+   }
+   return;
+}
+
+/*
+   Name   : add_timeline_files()
+   Purpose: Adds the marked files and their $FILE_NAME events to the timeline
+            dialog and updates the timeline graph.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_UI::add_timeline_files()
+{
+   vector< fl_mac_event_t > marked_events;
+   size_t i;
+
+   timeline_dialog->add_marked_files(file_system_tree->get_marked_files());
+   if (file_system != NULL)
+   {
+      vector< fl_mac_event_t > mac_events = file_system->get_mac_events();
+      for (i = 0; i < mac_events.size(); i++)
+      {
+         if (mac_events[i].record->marked)
+            marked_events.push_back(mac_events[i]);
+      }
+      timeline_dialog->add_mac_events(marked_events);
+   }
+   timeline_dialog->update_graph();
+
+   return;
+}
+
+/*
+   Name   : run_file_hasher()
+   Purpose: Hashes the files on all cores, called from the hashing thread.
+            When hashing finishes the known good files are removed from the
+            file system tree and the known bad files are shown in red.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_UI::run_file_hasher()
+{
+   Fineline_File_Map fmap = file_system_tree->get_file_map();
+   fl_file_record_t *flrec;
+   char msg[FL_MAX_INPUT_STR];
+   string full_path;
+   size_t i;
+
+   Fineline_Log::print_log_entry("run_file_hasher() <INFO> Started file hashing thread.");
+
+   file_hasher->hash_files(0);
+
+   Fl::lock();
+   for (i = 0; i < fmap->size(); i++)
+   {
+      flrec = fmap->get_record(i);
+      if (flrec->hash_set == FL_HASH_SET_NONE)
+         continue;
+      full_path = Fineline_File_Arena::get_full_path(flrec);
+      if (flrec->hash_set == FL_HASH_SET_KNOWN_BAD)
+         file_system_tree->highlight_file(full_path.c_str());
+      else
+         file_system_tree->hide_file(full_path.c_str());
+   }
+   file_system_tree->redraw();
+
+   snprintf(msg, FL_MAX_INPUT_STR, "Hashed %lu files, %llu MB: %lu known good files hidden, %lu known bad files.",
+            (unsigned long)file_hasher->get_hashed_count(), (unsigned long long)(file_hasher->get_bytes_hashed() / 1048576),
+            (unsigned long)file_hasher->get_known_good_count(), (unsigned long)file_hasher->get_known_bad_count());
+   progress_dialog->add_progress_message(msg);
+   hash_task_running = 0;
+   Fl::unlock();
+
+   Fl::awake();
+
+   Fineline_Log::print_log_entry("run_file_hasher() <INFO> Finished file hashing thread.");
+}
+
+/*
+   Name   : clear_file_records()
+   Purpose: Stops the threads that use the file records, including a running
+            image walk, and removes the records from the metadata browser and
+            the dialogs, called before the file system that owns the record
+            arena is deleted.
+   Input  : None.
+   Output : None.
+*/
+void Fineline_UI::clear_file_records()
+{
+   // the walker adds records to the tree until its thread has been joined
+   if (file_system != NULL)
+      file_system->wait_task();
+   if (file_hasher != NULL)
+      file_hasher->stop_hashing();
+   // the hashing thread updates the tree with the FLTK lock held, Fl::wait() releases it
+   while (hash_task_running)
+      Fl::wait(0.1);
+   if (file_hasher != NULL)
+   {
+      delete file_hasher;
+      file_hasher = NULL;
+   }
+
+   tree_search_dialog->clear_search();
+   export_dialog->clear_files();
+   timeline_dialog->clear_files();
+   statistics_dialog->set_file_system(NULL);
+   file_metadata_browser->clear();
+
+   return;
+}
+
 
 // Unit testing only.
 void Fineline_UI::update_screeninfo(Fl_Widget *b, void *p)
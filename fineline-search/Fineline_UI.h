@@ -55,9 +55,11 @@
 #include "Fineline_Project_Dialog.h"
 #include "Fineline_Report_Dialog.h"
 #include "Fineline_Timeline_Dialog.h"
+#include "Fineline_Statistics_Dialog.h"
 #include "Fineline_Tree_Filter_Dialog.h"
 #include "Fineline_Tree_Search_Dialog.h"
 #include "Fineline_File_Display_Dialog.h"
+#include "Fineline_File_Hasher.h"
 
 class Fineline_UI
 {
@@ -72,6 +74,7 @@ class Fineline_UI
 	   static void save_menu_callback(Fl_Widget *w, void *x);
 	   static void export_menu_callback(Fl_Widget *w, void *x);
 	   static void popup_menu_callback(Fl_Widget *w, void *x);
+	   static void tools_menu_callback(Fl_Widget *w, void *x);
 	   static void file_metadata_callback(Fl_Widget *w, void *x);
       static void filter_button_callback(Fl_Button *b, void *p);
 	   static void button_callback(Fl_Button *b, void *p);
@@ -80,6 +83,14 @@ class Fineline_UI
       static int start_image_process_thread(const char *filename);
 	   static void update_file_metadata_browser(fl_file_record_t *flrec);
 	   static int save_tree(const char *filename);
+	   static int open_search_index();
+	   static int open_case_snapshot();
+	   static int save_case_snapshot();
+	   static int open_project_sections();
+	   static int save_project_sections();
+	   static void run_file_hasher();
+	   static void add_timeline_files();
+	   static void clear_file_records();
 
       int run_unit_tests(int argc, char *argv[]);
 
@@ -118,7 +129,12 @@ class Fineline_UI
       static Fineline_Tree_Search_Dialog *tree_search_dialog;
       static Fineline_Report_Dialog *report_dialog;
       static Fineline_Timeline_Dialog *timeline_dialog;
+      static Fineline_Statistics_Dialog *statistics_dialog;
       static Fineline_File_Display_Dialog *file_display_dialog;
+      static Fineline_File_Hasher *file_hasher;
+      static int hash_task_running;
+      static Fineline_Hash_Set *known_good_set;
+      static Fineline_Hash_Set *known_bad_set;
 
       //DEPRECATED: just use file chooser and progress dialog TODO: static Fineline_Save_Tree_Dialog *save_tree_dialog;
 
@@ -36,6 +36,7 @@
 #include <stdlib.h>
 #include <string>
 #include <vector>
+#include <thread>
 
 #include "gtest/gtest.h"
 
@@ -48,12 +49,30 @@ using namespace std;
 #include "Fineline_Filter_List.h"
 #include "Fineline_Log.h"
 #include "Fineline_Event_List.h"
+#include "Fineline_Event_Histogram.h"
+#include "Fineline_File_Statistics.h"
 #include "Fineline_File_System.h"
 #include "Fineline_File_System_Tree.h"
 #include "Fineline_Util.h"
 #include "Fineline_Progress_Dialog.h"
 #include "Fineline_Tree_Filter.h"
 #include "Fineline_Tree_Filter_Dialog.h"
+#include "Fineline_Event_Loader.h"
+#include "Fineline_File_Queue.h"
+#include "Fineline_File_Arena.h"
+#include "Fineline_File_Index.h"
+#include "Fineline_Keyword_Matcher.h"
+#include "Fineline_Trigram_Index.h"
+#include "Fineline_Content_Search.h"
+#include "Fineline_File_Hasher.h"
+#include "Fineline_File_Exporter.h"
+#include "Fineline_Mft_Scanner.h"
+#include "Fineline_Block_Cache.h"
+#include "Fineline_Tree_Model.h"
+#include "Fineline_Case_Snapshot.h"
+#include "Fineline_Project.h"
+#include "Fineline_Hash.h"
+#include "Fineline_Hash_Set.h"
 
 int x_argc;
 char **x_argv;
@@ -191,7 +210,8 @@ TEST(FineLineSearchFileSystemTreeTests, ValidateMethods)
 {
    Fineline_Util flut;
    Fineline_File_System_Tree *ftree = new Fineline_File_System_Tree(20, 100, 800, 600);
-   fl_file_record_t * flf = (fl_file_record_t *) flut.xmalloc(sizeof(fl_file_record_t));
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   fl_file_record_t *flf = farena->new_record();
    string filename;
    char num[256];
    int i;
@@ -203,48 +223,66 @@ TEST(FineLineSearchFileSystemTreeTests, ValidateMethods)
 
    for (i = 0; i < 1000; i++)
    {
-      flf = (fl_file_record_t *) flut.xmalloc(sizeof(fl_file_record_t));
+      flf = farena->new_record();
       ASSERT_TRUE(NULL != flf);
       filename = "C:\\temp\\file";
       filename.append(flut.xitoa(i, num, 256, 10));
       filename.append(".doc");
-      strncpy(flf->full_path, filename.c_str(), filename.size());
+      farena->set_file_name(flf, filename);
       ftree->add_file(filename, flf);
    }
    for (i = 0; i < 1000; i++)
    {
-      flf = (fl_file_record_t *) flut.xmalloc(sizeof(fl_file_record_t));
+      flf = farena->new_record();
       ASSERT_TRUE(NULL != flf);
       filename = "C:\\Windows\\file";
       filename.append(flut.xitoa(i, num, 256, 10));
       filename.append(".exe");
-      strncpy(flf->full_path, filename.c_str(), filename.size());
+      farena->set_file_name(flf, filename);
       ftree->add_file(filename, flf);
    }
    for (i = 0; i < 1000; i++)
    {
-      flf = (fl_file_record_t *) flut.xmalloc(sizeof(fl_file_record_t));
+      flf = farena->new_record();
       ASSERT_TRUE(NULL != flf);
       filename = "C:\\Users\\admin\\file";
       filename.append(flut.xitoa(i, num, 256, 10));
       filename.append(".txt");
-      strncpy(flf->full_path, filename.c_str(), filename.size());
+      farena->set_file_name(flf, filename);
       ftree->add_file(filename, flf);
    }
    for (i = 0; i < 1000; i++)
    {
-      flf = (fl_file_record_t *) flut.xmalloc(sizeof(fl_file_record_t));
+      flf = farena->new_record();
       ASSERT_TRUE(NULL != flf);
       filename = "/etc/file";
       filename.append(flut.xitoa(i, num, 256, 10));
       filename.append(".bin");
-      strncpy(flf->full_path, filename.c_str(), filename.size());
+      farena->set_file_name(flf, filename);
       ftree->add_file(filename, flf);
    }
    EXPECT_EQ(4000, ftree->tree_size());
+   EXPECT_EQ(4001, (int)farena->get_record_count());
+
+   /* snapshots are shared and not changed by later tree updates */
+   Fineline_File_Map fmap = ftree->get_file_map();
+   EXPECT_EQ(4000, (int)fmap->size());
+   ftree->add_file("/etc/passwd", flf);
+   EXPECT_EQ(4001, ftree->tree_size());
+   EXPECT_EQ(4000, (int)fmap->size());
+   EXPECT_EQ(0, ftree->clear_tree());
+   EXPECT_EQ(4000, (int)fmap->size());
+   ftree->add_file_map(fmap);
+   EXPECT_EQ(4000, ftree->tree_size());
+   ftree->highlight_file("/etc/file2.bin");
+   ftree->hide_file("/etc/file1.bin");
+   ftree->rebuild_tree();
+   EXPECT_EQ(4000, ftree->tree_size());
+   EXPECT_TRUE(NULL == ftree->get_selected_file_record());
    EXPECT_EQ(0, ftree->clear_tree());
 
    delete ftree;
+   delete farena;
 }
 
 // Make sure the thread tests are run last.
@@ -304,7 +342,8 @@ TEST(FineLineTreeFilterTests, ValidateMethods)
    Fineline_File_System_Tree *ftree = new Fineline_File_System_Tree(20, 100, 800, 600);
    Fineline_Tree_Filter_Dialog *ftfd = new Fineline_Tree_Filter_Dialog(20, 100, 800, 600);
    Fineline_Tree_Filter *ffilter;
-   fl_file_record_t *flf = (fl_file_record_t *) flut.xmalloc(sizeof(fl_file_record_t));
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   fl_file_record_t *flf = farena->new_record();
    string filename;
    char num[256];
    int i;
@@ -318,42 +357,42 @@ TEST(FineLineTreeFilterTests, ValidateMethods)
 
    for (i = 0; i < 1000; i++)
    {
-      flf = (fl_file_record_t *) flut.xmalloc(sizeof(fl_file_record_t));
+      flf = farena->new_record();
       ASSERT_TRUE(NULL != flf);
       filename = "C:\\temp\\file";
       filename.append(flut.xitoa(i, num, 256, 10));
       filename.append(".jpg");
-      strncpy(flf->full_path, filename.c_str(), filename.size());
+      farena->set_file_name(flf, filename);
       ftree->add_file(filename, flf);
    }
    for (i = 0; i < 1000; i++)
    {
-      flf = (fl_file_record_t *) flut.xmalloc(sizeof(fl_file_record_t));
+      flf = farena->new_record();
       ASSERT_TRUE(NULL != flf);
       filename = "C:\\Windows\\file";
       filename.append(flut.xitoa(i, num, 256, 10));
       filename.append(".doc");
-      strncpy(flf->full_path, filename.c_str(), filename.size());
+      farena->set_file_name(flf, filename);
       ftree->add_file(filename, flf);
    }
    for (i = 0; i < 1000; i++)
    {
-      flf = (fl_file_record_t *) flut.xmalloc(sizeof(fl_file_record_t));
+      flf = farena->new_record();
       ASSERT_TRUE(NULL != flf);
       filename = "C:\\Users\\admin\\file";
       filename.append(flut.xitoa(i, num, 256, 10));
       filename.append(".pdf");
-      strncpy(flf->full_path, filename.c_str(), filename.size());
+      farena->set_file_name(flf, filename);
       ftree->add_file(filename, flf);
    }
    for (i = 0; i < 1000; i++)
    {
-      flf = (fl_file_record_t *) flut.xmalloc(sizeof(fl_file_record_t));
+      flf = farena->new_record();
       ASSERT_TRUE(NULL != flf);
       filename = "C:\\Users\\admin\\file";
       filename.append(flut.xitoa(i, num, 256, 10));
       filename.append(".txt");
-      strncpy(flf->full_path, filename.c_str(), filename.size());
+      farena->set_file_name(flf, filename);
       ftree->add_file(filename, flf);
    }
    ffilter = new Fineline_Tree_Filter(ftree, test_keywords, ftfd);
@@ -362,6 +401,1395 @@ TEST(FineLineTreeFilterTests, ValidateMethods)
    EXPECT_EQ(3000, ftree->tree_size());
 }
 
+TEST(FineLineKeywordMatcherTests, ValidateMethods)
+{
+   Fineline_Keyword_Matcher kmatcher;
+   Fineline_Keyword_Matcher cmatcher(1);
+   Fineline_File_Index findex;
+   vector<size_t> positions;
+   string text = "C:\\Users\\fred\\ushers.doc";
+   char num[256];
+   int state = FL_MATCHER_START_STATE;
+   int i;
+
+   EXPECT_EQ(-1, kmatcher.match_any(text.c_str(), text.size()));
+   EXPECT_EQ(0, kmatcher.add_keyword("he"));
+   EXPECT_EQ(1, kmatcher.add_keyword("she"));
+   EXPECT_EQ(2, kmatcher.add_keyword("hers"));
+   EXPECT_EQ(1, kmatcher.add_keyword("she"));
+   EXPECT_EQ(-1, kmatcher.add_keyword(""));
+   EXPECT_EQ(3, (int)kmatcher.get_keyword_count());
+   kmatcher.compile();
+   EXPECT_EQ(1, kmatcher.is_compiled());
+
+   EXPECT_EQ(1, kmatcher.match_any("ushers", 6));
+   EXPECT_EQ(-1, kmatcher.match_any("USHERS", 6));
+   EXPECT_EQ(-1, kmatcher.match_any("hs", 2));
+   /* she, he and hers, the last split across two calls */
+   EXPECT_EQ(2, kmatcher.scan("ushe", 4, &state, NULL, NULL));
+   EXPECT_EQ(1, kmatcher.scan("rs", 2, &state, NULL, NULL));
+
+   cmatcher.add_keyword(".DOC");
+   cmatcher.compile();
+   EXPECT_EQ(0, cmatcher.match_any(text.c_str(), text.size()));
+
+   for (i = 0; i < 50000; i++)
+   {
+      string path = "Windows/file";
+      path.append(Fineline_Util::xitoa(i, num, 256, 10));
+      path.append((i % 5) == 0 ? ".exe" : ".dll");
+      findex.add_file(path, NULL);
+   }
+   findex.sort_index();
+   kmatcher.add_keyword(".exe");
+   kmatcher.add_keyword("0.exe");
+   kmatcher.compile();
+
+   /* each file reported once and in path order whatever the thread count */
+   EXPECT_EQ(10000, (int)Fineline_Tree_Filter::filter_file_map(&findex, &kmatcher, 4, positions));
+   for (i = 1; i < (int)positions.size(); i++)
+   {
+      ASSERT_TRUE(positions[i - 1] < positions[i]);
+   }
+   EXPECT_EQ(10000, (int)Fineline_Tree_Filter::filter_file_map(&findex, &kmatcher, 1, positions));
+}
+
+TEST(FineLineTrigramIndexTests, ValidateMethods)
+{
+   shared_ptr< Fineline_File_Index > findex = make_shared< Fineline_File_Index >();
+   Fineline_Trigram_Index *tindex = new Fineline_Trigram_Index();
+   Fineline_Trigram_Index *lindex = new Fineline_Trigram_Index();
+   vector<size_t> positions;
+   vector<string> literals;
+   char num[256];
+   int i;
+
+   for (i = 0; i < 10000; i++)
+   {
+      string path = (i % 2) ? "FS1/Windows/System32/" : "FS1/Users/Fred/Documents/";
+      path.append("file");
+      path.append(Fineline_Util::xitoa(i, num, 256, 10));
+      path.append((i % 10) == 0 ? ".EXE" : ".txt");
+      findex->add_file(path, NULL);
+   }
+   findex->sort_index();
+
+   EXPECT_EQ(0, tindex->build_index(findex));
+   EXPECT_TRUE(tindex->get_trigram_count() > 0);
+
+   EXPECT_EQ(1000, tindex->search(".exe", FL_SEARCH_SUBSTRING, 1, positions));
+   EXPECT_EQ(0, tindex->search(".exe", FL_SEARCH_SUBSTRING, 0, positions));
+   EXPECT_EQ(1, tindex->search("file1234.", FL_SEARCH_SUBSTRING, 0, positions));
+   EXPECT_STREQ("FS1/Users/Fred/Documents/file1234.txt", tindex->get_file_map()->get_path(positions[0]));
+   EXPECT_EQ(0, tindex->search("nothing", FL_SEARCH_SUBSTRING, 1, positions));
+   EXPECT_EQ(10, tindex->search("ex", FL_SEARCH_SUBSTRING, 1, positions, 10));
+
+   EXPECT_EQ(1000, tindex->search("*/file*.EXE", FL_SEARCH_GLOB, 0, positions));
+   EXPECT_EQ(4995, tindex->search("*system32/file?[0-9]*.txt", FL_SEARCH_GLOB, 1, positions));
+   EXPECT_EQ(0, tindex->search("file*.exe", FL_SEARCH_GLOB, 1, positions));
+   EXPECT_EQ(1, Fineline_Trigram_Index::glob_match("a*b?d[!x]", "aXXbcde", 0));
+   EXPECT_EQ(0, Fineline_Trigram_Index::glob_match("a*b?d[!x]", "aXXbcdx", 0));
+
+   EXPECT_EQ(1000, tindex->search("Fred/.*2\\.txt$", FL_SEARCH_REGEX, 0, positions));
+   EXPECT_EQ(999, tindex->search("file\\d+0\\.(exe|txt)$", FL_SEARCH_REGEX, 1, positions));
+   EXPECT_EQ(-1, tindex->search("file(", FL_SEARCH_REGEX, 0, positions));
+   for (i = 1; i < (int)positions.size(); i++)
+   {
+      ASSERT_TRUE(positions[i - 1] < positions[i]);
+   }
+
+   Fineline_Trigram_Index::get_required_literals("Windows/Sys.*32\\.dl?l", FL_SEARCH_REGEX, literals);
+   ASSERT_EQ(2, (int)literals.size());
+   EXPECT_STREQ("Windows/Sys", literals[0].c_str());
+   EXPECT_STREQ("32.d", literals[1].c_str());
+   Fineline_Trigram_Index::get_required_literals("abc|def", FL_SEARCH_REGEX, literals);
+   EXPECT_EQ(0, (int)literals.size());
+   Fineline_Trigram_Index::get_required_literals("foo\\x41bar\\u0042baz\\12qux", FL_SEARCH_REGEX, literals);
+   ASSERT_EQ(4, (int)literals.size());
+   EXPECT_STREQ("foo", literals[0].c_str());
+   EXPECT_STREQ("bar", literals[1].c_str());
+   EXPECT_STREQ("baz", literals[2].c_str());
+   EXPECT_STREQ("qux", literals[3].c_str());
+
+   /* the saved index is only loaded for the same paths */
+   EXPECT_EQ(0, tindex->save_index("fineline-search-test.fti"));
+   EXPECT_EQ(0, lindex->load_index("fineline-search-test.fti", findex));
+   EXPECT_EQ(tindex->get_posting_count(), lindex->get_posting_count());
+   EXPECT_EQ(1000, lindex->search(".exe", FL_SEARCH_SUBSTRING, 1, positions));
+   findex->add_file("FS1/newfile.txt", NULL);
+   findex->sort_index();
+   EXPECT_EQ(-1, lindex->load_index("fineline-search-test.fti", findex));
+   EXPECT_EQ(-1, lindex->load_index("bad_file.fti", findex));
+   remove("fineline-search-test.fti");
+}
+
+TEST(FineLineContentSearchTests, ValidateMethods)
+{
+   vector<string> keywords;
+   vector<fl_content_hit_t> hits;
+   vector<TSK_OFF_T> offsets;
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   fl_file_record_t *flf = farena->new_record();
+   Fineline_Content_Search *fcs;
+   const char block1[] = "xxSECRETyy p\0a";
+   const char block2[] = "\0s\0s\0 secret";
+   int state = FL_MATCHER_START_STATE;
+
+   keywords.push_back("secret");
+   keywords.push_back("pass");
+   keywords.push_back("");
+   fcs = new Fineline_Content_Search("no-image.dd", offsets, keywords, 1);
+   ASSERT_TRUE(NULL != fcs);
+   EXPECT_EQ(2, (int)fcs->get_keyword_count());
+
+   flf->file_type = TSK_FS_META_TYPE_REG;
+   flf->file_size = 0;
+   EXPECT_EQ(-1, fcs->add_file(flf));
+   flf->file_size = 1000;
+   EXPECT_EQ(0, fcs->add_file(flf));
+   EXPECT_EQ(1, (int)fcs->get_file_count());
+
+   /* the UTF-16LE hit spans the two blocks */
+   EXPECT_EQ(1, fcs->scan_buffer(flf, block1, sizeof(block1) - 1, 0, &state, hits));
+   EXPECT_EQ(2, fcs->scan_buffer(flf, block2, sizeof(block2) - 1, sizeof(block1) - 1, &state, hits));
+   ASSERT_EQ(3, (int)hits.size());
+   EXPECT_EQ(2, hits[0].offset);
+   EXPECT_EQ(FL_ENCODING_ASCII, hits[0].encoding);
+   EXPECT_EQ(11, hits[1].offset);
+   EXPECT_EQ(1, hits[1].keyword_id);
+   EXPECT_EQ(FL_ENCODING_UTF16LE, hits[1].encoding);
+   EXPECT_EQ(20, hits[2].offset);
+   EXPECT_STREQ("pass (UTF-16LE) @ 11", fcs->get_hit_string(hits[1]).c_str());
+
+   /* no image to open, the search finds nothing */
+   EXPECT_EQ(0, fcs->search_files(2));
+   EXPECT_EQ(0, fcs->get_running());
+}
+
+TEST(FineLineFileHasherTests, ValidateMethods)
+{
+   Fineline_Hash fhash;
+   Fineline_Hash_Set *good_set = new Fineline_Hash_Set();
+   Fineline_Hash_Set *bad_set = new Fineline_Hash_Set();
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   Fineline_File_Hasher *ffh;
+   vector<TSK_OFF_T> offsets;
+   fl_file_record_t *flf1 = farena->new_record();
+   fl_file_record_t *flf2 = farena->new_record();
+   unsigned char md5[FL_MD5_LENGTH];
+   unsigned char sha1[FL_SHA1_LENGTH];
+   unsigned char sha256[FL_SHA256_LENGTH];
+   string text_set = "fineline-hashset-test.txt";
+   string binary_set = "fineline-hashset-test.hsb";
+   FILE *hfile;
+   int i;
+
+   /* digests of "abc" split over two updates */
+   fhash.update("a", 1);
+   fhash.update("bc", 2);
+   fhash.final(md5, sha1, sha256);
+   EXPECT_STREQ("900150983cd24fb0d6963f7d28e17f72", Fineline_Hash::to_hex(md5, FL_MD5_LENGTH).c_str());
+   EXPECT_STREQ("a9993e364706816aba3e25717850c26c9cd0d89d", Fineline_Hash::to_hex(sha1, FL_SHA1_LENGTH).c_str());
+   EXPECT_STREQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", Fineline_Hash::to_hex(sha256, FL_SHA256_LENGTH).c_str());
+
+   /* NSRL style CSV known good set, the SHA-1 is the first digest field */
+   hfile = fopen(text_set.c_str(), "w");
+   ASSERT_TRUE(NULL != hfile);
+   fprintf(hfile, "\"SHA-1\",\"MD5\",\"CRC32\",\"FileName\"\n");
+   for (i = 0; i < 1000; i++)
+      fprintf(hfile, "\"%040X\",\"%032X\",\"00000000\",\"file%d.dll\"\n", i * 7919, i, i);
+   fprintf(hfile, "\"A9993E364706816ABA3E25717850C26C9CD0D89D\",\"900150983CD24FB0D6963F7D28E17F72\",\"352441C2\",\"abc.txt\"\n");
+   fprintf(hfile, "\"A9993E364706816ABA3E25717850C26C9CD0D89D\",\"900150983CD24FB0D6963F7D28E17F72\",\"352441C2\",\"abc.txt\"\n");
+   fclose(hfile);
+
+   EXPECT_EQ(1001, Fineline_Hash_Set::compile_hash_set(text_set.c_str(), binary_set.c_str()));
+   EXPECT_EQ(1001, good_set->open_hash_set(binary_set.c_str()));
+   EXPECT_EQ(FL_SHA1_LENGTH, (int)good_set->get_digest_length());
+   EXPECT_EQ(1, good_set->contains(sha1, FL_SHA1_LENGTH));
+   EXPECT_EQ(0, good_set->contains(md5, FL_MD5_LENGTH));
+   sha1[0] ^= 1;
+   EXPECT_EQ(0, good_set->contains(sha1, FL_SHA1_LENGTH));
+   sha1[0] ^= 1;
+
+   /* plain text MD5 known bad set */
+   hfile = fopen(text_set.c_str(), "w");
+   ASSERT_TRUE(NULL != hfile);
+   fprintf(hfile, "900150983cd24fb0d6963f7d28e17f72  abc.txt\n");
+   fclose(hfile);
+   EXPECT_EQ(1, bad_set->open_hash_set(text_set.c_str()));
+   EXPECT_EQ(1, bad_set->contains(md5, FL_MD5_LENGTH));
+
+   ffh = new Fineline_File_Hasher("no-image.dd", offsets, farena);
+   ASSERT_TRUE(NULL != ffh);
+   ffh->set_known_good(good_set);
+
+   flf1->file_type = TSK_FS_META_TYPE_REG;
+   flf1->file_size = 3;
+   EXPECT_EQ(0, ffh->add_file(flf1));
+   flf2->file_type = TSK_FS_META_TYPE_DIR;
+   EXPECT_EQ(-1, ffh->add_file(flf2));
+   EXPECT_EQ(1, (int)ffh->get_file_count());
+
+   EXPECT_EQ(FL_HASH_SET_KNOWN_GOOD, ffh->store_digests(flf1, md5, sha1, sha256));
+   ASSERT_TRUE(NULL != flf1->digests);
+   EXPECT_EQ(0, memcmp(flf1->digests->sha256, sha256, FL_SHA256_LENGTH));
+   EXPECT_EQ(1, flf1->hidden);
+
+   /* known bad wins, the file is shown again */
+   ffh->set_known_bad(bad_set);
+   EXPECT_EQ(FL_HASH_SET_KNOWN_BAD, ffh->check_hash_sets(flf1));
+   EXPECT_EQ(0, flf1->hidden);
+
+   /* the file is already hashed so it is only checked against the sets */
+   EXPECT_EQ(1, ffh->hash_files(2));
+   EXPECT_EQ(1, (int)ffh->get_known_bad_count());
+   EXPECT_EQ(0, ffh->get_running());
+
+   EXPECT_EQ(-1, bad_set->open_hash_set("no-such-hash-set.txt"));
+   EXPECT_EQ(0, (int)bad_set->get_digest_count());
+
+   delete ffh;
+   delete good_set;
+   delete bad_set;
+   delete farena;
+   remove(text_set.c_str());
+   remove(binary_set.c_str());
+}
+
+TEST(FineLineFileExporterTests, ValidateMethods)
+{
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   Fineline_File_Exporter *ffe;
+   vector<fl_file_record_t *> flist;
+   vector<TSK_OFF_T> offsets;
+   fl_file_record_t *fldir = farena->new_record();
+   fl_file_record_t *flf = farena->new_record();
+   string sparse_file = "fineline-export-test.bin";
+   string manifest_file = "fineline-export-test/";
+   char *block = (char *)calloc(3 * FL_EXPORT_SPARSE_BLOCK, 1);
+   char *data = (char *)malloc(5 * FL_EXPORT_SPARSE_BLOCK);
+   FILE *out_file;
+   int i;
+
+   /* data, a one block hole, data, then a hole at the end of the file */
+   block[10] = 'x';
+   block[2 * FL_EXPORT_SPARSE_BLOCK + 20] = 'y';
+   out_file = fopen(sparse_file.c_str(), "w+b");
+   ASSERT_TRUE(NULL != out_file);
+   EXPECT_EQ(FL_EXPORT_SPARSE_BLOCK, Fineline_File_Exporter::write_sparse(out_file, block, 3 * FL_EXPORT_SPARSE_BLOCK));
+   memset(block, 0, 3 * FL_EXPORT_SPARSE_BLOCK);
+   EXPECT_EQ(2 * FL_EXPORT_SPARSE_BLOCK, Fineline_File_Exporter::write_sparse(out_file, block, 2 * FL_EXPORT_SPARSE_BLOCK));
+   EXPECT_EQ(0, Fineline_File_Exporter::finish_sparse(out_file, 5 * FL_EXPORT_SPARSE_BLOCK));
+   fseek(out_file, 0, SEEK_SET);
+   EXPECT_EQ(5 * FL_EXPORT_SPARSE_BLOCK, (int)fread(data, 1, 5 * FL_EXPORT_SPARSE_BLOCK, out_file));
+   fclose(out_file);
+   for (i = 0; i < 5 * FL_EXPORT_SPARSE_BLOCK; i++)
+   {
+      if (i == 10)
+         EXPECT_EQ('x', data[i]);
+      else if (i == 2 * FL_EXPORT_SPARSE_BLOCK + 20)
+         EXPECT_EQ('y', data[i]);
+      else if (data[i] != 0)
+         ADD_FAILURE() << "non zero byte at " << i;
+   }
+   remove(sparse_file.c_str());
+
+   fldir->file_type = TSK_FS_META_TYPE_DIR;
+   fldir->file_system_id = 1;
+   farena->set_file_name(fldir, "Windows");
+   flf->file_type = TSK_FS_META_TYPE_REG;
+   flf->file_system_id = 1;
+   flf->file_size = 100;
+   flf->parent = fldir;
+   farena->set_file_name(flf, "notepad.exe");
+   flist.push_back(fldir);
+   flist.push_back(flf);
+
+   ffe = new Fineline_File_Exporter("no-image.dd", offsets, "fineline-export-test");
+   ASSERT_TRUE(NULL != ffe);
+   EXPECT_EQ(1, ffe->add_files(flist));
+   EXPECT_STREQ("fineline-export-test/FS1/Windows/notepad.exe", ffe->get_destination_path(flf).c_str());
+   EXPECT_STREQ("%2E%2E", Fineline_File_Exporter::escape_path_name("..").c_str());
+   EXPECT_STREQ("a%2Fb%5Cc%3A%25", Fineline_File_Exporter::escape_path_name("a/b\\c:%").c_str());
+   EXPECT_STREQ("_", Fineline_File_Exporter::escape_path_name("").c_str());
+
+   /* no image to open, nothing is exported but the manifest is written */
+   EXPECT_EQ(0, ffe->export_files(2));
+   EXPECT_EQ(FL_EXPORT_NOT_EXPORTED, ffe->get_results()[0].status);
+   EXPECT_EQ(0, ffe->get_running());
+   manifest_file.append(FL_EXPORT_MANIFEST);
+   out_file = fopen(manifest_file.c_str(), "r");
+   ASSERT_TRUE(NULL != out_file);
+   fclose(out_file);
+   remove(manifest_file.c_str());
+   remove("fineline-export-test");
+
+   delete ffe;
+   delete farena;
+   free(block);
+   free(data);
+}
+
+static size_t put_mft_name(unsigned char *rec, size_t offset, uint64_t parent, uint16_t parent_seq, const char *name, int name_space, uint64_t filetime)
+{
+   size_t name_length = strlen(name);
+   size_t content_size = 0x42 + (name_length * 2);
+   size_t attr_length = (0x18 + content_size + 7) & ~((size_t)7);
+   unsigned char *content = rec + offset + 0x18;
+   uint64_t reference = parent | ((uint64_t)parent_seq << 48);
+   size_t i;
+
+   rec[offset] = 0x30;
+   memcpy(rec + offset + 4, &attr_length, 4);
+   memcpy(rec + offset + 0x10, &content_size, 4);
+   rec[offset + 0x14] = 0x18;
+   memcpy(content, &reference, 8);
+   for (i = 0; i < 4; i++)
+      memcpy(content + 0x08 + (i * 8), &filetime, 8);
+   content[0x40] = (unsigned char)name_length;
+   content[0x41] = (unsigned char)name_space;
+   for (i = 0; i < name_length; i++)
+      content[0x42 + (i * 2)] = (unsigned char)name[i];
+
+   return(offset + attr_length);
+}
+
+static void build_mft_record(unsigned char *rec, uint16_t flags, uint16_t seq, uint64_t parent, uint16_t parent_seq, const char *name, const char *dos_name, int data_size)
+{
+   uint64_t si_time = (1400000000ULL + 11644473600ULL) * 10000000ULL;
+   uint64_t fn_time = (1300000000ULL + 11644473600ULL) * 10000000ULL;
+   uint32_t end = 0xFFFFFFFF;
+   uint32_t length;
+   size_t offset = 0x38;
+   int i;
+
+   memset(rec, 0, 1024);
+   memcpy(rec, "FILE", 4);
+   rec[0x04] = 0x30;
+   rec[0x06] = 3;
+   memcpy(rec + 0x10, &seq, 2);
+   rec[0x14] = 0x38;
+   memcpy(rec + 0x16, &flags, 2);
+
+   // $STANDARD_INFORMATION
+   rec[offset] = 0x10;
+   rec[offset + 4] = 0x48;
+   rec[offset + 0x10] = 0x30;
+   rec[offset + 0x14] = 0x18;
+   for (i = 0; i < 4; i++)
+      memcpy(rec + offset + 0x18 + (i * 8), &si_time, 8);
+   offset += 0x48;
+
+   if (dos_name != NULL)
+      offset = put_mft_name(rec, offset, parent, parent_seq, dos_name, 2, fn_time);
+   if (name != NULL)
+      offset = put_mft_name(rec, offset, parent, parent_seq, name, 1, fn_time);
+
+   if (data_size >= 0) // resident $DATA
+   {
+      rec[offset] = 0x80;
+      length = (0x18 + data_size + 7) & ~7;
+      memcpy(rec + offset + 4, &length, 4);
+      memcpy(rec + offset + 0x10, &data_size, 4);
+      rec[offset + 0x14] = 0x18;
+      offset += length;
+   }
+
+   memcpy(rec + offset, &end, 4);
+   length = offset + 8;
+   memcpy(rec + 0x18, &length, 4);
+
+   // Update sequence, the last two bytes of each 512 byte stride.
+   rec[0x30] = 0x01;
+   rec[0x32] = rec[510];
+   rec[0x33] = rec[511];
+   rec[0x34] = rec[1022];
+   rec[0x35] = rec[1023];
+   rec[510] = rec[1022] = 0x01;
+   rec[511] = rec[1023] = 0x00;
+}
+
+TEST(FineLineMftScannerTests, ValidateMethods)
+{
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   Fineline_Mft_Scanner *fmft = new Fineline_Mft_Scanner(farena, 1);
+   unsigned char rec[1024];
+   unsigned char name[8] = { 0xE9, 0x00, 0x3D, 0xD8, 0x00, 0xDE, 0x41, 0x00 }; // e acute, U+1F600, A
+
+   ASSERT_TRUE(NULL != fmft);
+
+   EXPECT_EQ(0, (int)Fineline_Mft_Scanner::filetime_to_unix(0));
+   EXPECT_EQ(1355526400, (int64_t)Fineline_Mft_Scanner::filetime_to_unix(130000000000000000ULL));
+   EXPECT_EQ(string("\xC3\xA9\xF0\x9F\x98\x80" "A"), Fineline_Mft_Scanner::utf16_to_utf8(name, 4));
+
+   build_mft_record(rec, 3, 5, 5, 5, ".", NULL, -1);
+   EXPECT_EQ(0, fmft->decode_record(rec, 1024, 5));             // the root is not listed
+   build_mft_record(rec, 3, 1, 5, 5, "Windows", NULL, -1);
+   EXPECT_EQ(1, fmft->decode_record(rec, 1024, 64));
+   build_mft_record(rec, 1, 1, 64, 1, "notepad.exe", "NOTEPA~1.EXE", 10);
+   EXPECT_EQ(1, fmft->decode_record(rec, 1024, 65));
+   build_mft_record(rec, 0, 2, 64, 1, "secret.txt", NULL, 5);
+   EXPECT_EQ(1, fmft->decode_record(rec, 1024, 66));
+   build_mft_record(rec, 0, 2, 64, 7, "old.txt", NULL, 5);      // the directory has been reused
+   EXPECT_EQ(1, fmft->decode_record(rec, 1024, 67));
+   build_mft_record(rec, 1, 1, 64, 1, "torn.txt", NULL, 5);
+   rec[1022] = 0x02;
+   EXPECT_EQ(-1, fmft->decode_record(rec, 1024, 68));
+   memset(rec, 0, 1024);
+   EXPECT_EQ(-1, fmft->decode_record(rec, 1024, 69));
+   build_mft_record(rec, 2, 3, 5, 5, "Temp", NULL, -1);         // freed, its sequence number was 2
+   EXPECT_EQ(1, fmft->decode_record(rec, 1024, 70));
+   build_mft_record(rec, 0, 2, 70, 2, "note.txt", NULL, 5);
+   EXPECT_EQ(1, fmft->decode_record(rec, 1024, 71));
+   build_mft_record(rec, 1, 1, 0, 0, NULL, NULL, 7);            // the $FILE_NAME is in the extension record
+   EXPECT_EQ(0, fmft->decode_record(rec, 1024, 72));
+   build_mft_record(rec, 1, 1, 64, 1, "long.txt", NULL, -1);
+   rec[0x20] = 72;
+   EXPECT_EQ(0, fmft->decode_record(rec, 1024, 73));
+
+   EXPECT_EQ(1, fmft->resolve_parents());
+   ASSERT_EQ(7, (int)fmft->get_records().size());
+   EXPECT_EQ(2, (int)fmft->get_directory_count());
+   EXPECT_EQ(7, (int)fmft->get_file_count());
+   EXPECT_EQ(4, (int)fmft->get_deleted_count());
+
+   fl_file_record_t *dir = fmft->get_records()[0];
+   fl_file_record_t *notepad = fmft->get_records()[1];
+   EXPECT_EQ(string("FS1/Windows"), Fineline_File_Arena::get_full_path(dir));
+   EXPECT_EQ(TSK_FS_META_TYPE_DIR, dir->file_type);
+   EXPECT_EQ(string("FS1/Windows/notepad.exe"), Fineline_File_Arena::get_full_path(notepad));
+   EXPECT_EQ(10, (int)notepad->file_size);
+   EXPECT_EQ(65, (int)notepad->meta_address);
+   EXPECT_EQ(0, notepad->deleted);
+   EXPECT_EQ(TSK_FS_ATTR_TYPE_NTFS_DATA, (int)notepad->attribute_type);
+   EXPECT_EQ(1400000000, (int64_t)notepad->modification_time);
+   EXPECT_EQ(1400000000, (int64_t)notepad->creation_time);
+   EXPECT_EQ(string("FS1/Windows/secret.txt"), Fineline_File_Arena::get_full_path(fmft->get_records()[2]));
+   EXPECT_EQ(1, fmft->get_records()[2]->deleted);
+   EXPECT_EQ(string("FS1/$OrphanFiles/old.txt"), Fineline_File_Arena::get_full_path(fmft->get_records()[3]));
+   EXPECT_EQ(string("FS1/Temp/note.txt"), Fineline_File_Arena::get_full_path(fmft->get_records()[5]));
+   EXPECT_EQ(string("FS1/Windows/long.txt"), Fineline_File_Arena::get_full_path(fmft->get_records()[6]));
+   EXPECT_EQ(72, (int)fmft->get_records()[6]->meta_address);
+   EXPECT_EQ(7, (int)fmft->get_records()[6]->file_size);
+
+   ASSERT_EQ(7, (int)fmft->get_mac_events().size());
+   EXPECT_EQ(1300000000, (int64_t)fmft->get_mac_events()[1].event_time);
+   EXPECT_EQ(FL_MAC_MODIFIED | FL_MAC_ACCESSED | FL_MAC_CHANGED | FL_MAC_BORN | FL_MAC_FILE_NAME, fmft->get_mac_events()[1].flags);
+   EXPECT_TRUE(notepad == fmft->get_mac_events()[1].record);
+
+   delete fmft;
+   delete farena;
+}
+
+static ssize_t read_test_image(void *context, int64_t offset, char *buffer, size_t length)
+{
+   const string *image = (const string *)context;
+
+   if (offset >= (int64_t)image->size())
+      return(0);
+   if (length > image->size() - (size_t)offset)
+      length = image->size() - (size_t)offset;
+   memcpy(buffer, image->data() + offset, length);
+
+   return((ssize_t)length);
+}
+
+TEST(FineLineBlockCacheTests, ValidateMethods)
+{
+   Fineline_Block_Cache *fcache = new Fineline_Block_Cache(FL_CACHE_PAGE_SIZE * FL_CACHE_SHARDS * 4);
+   fl_cache_stream_t stream = { 0, 0 };
+   fl_cache_statistics_t stats;
+   string image;
+   char buffer[8192];
+   size_t i;
+
+   ASSERT_TRUE(NULL != fcache);
+
+   for (i = 0; i < (FL_CACHE_PAGE_SIZE * 40) + 100; i++)
+      image.push_back((char)(i * 7));
+
+   EXPECT_EQ((size_t)(FL_CACHE_PAGE_SIZE * FL_CACHE_SHARDS * 4), fcache->get_cache_size());
+
+   // A read across a page boundary, then the same data again from the cache.
+   EXPECT_EQ(8192, (int)fcache->read(1, &stream, read_test_image, &image, FL_CACHE_PAGE_SIZE - 100, buffer, 8192));
+   EXPECT_EQ(0, memcmp(buffer, image.data() + FL_CACHE_PAGE_SIZE - 100, 8192));
+   EXPECT_EQ(8192, (int)fcache->read(1, &stream, read_test_image, &image, FL_CACHE_PAGE_SIZE - 100, buffer, 8192));
+   EXPECT_EQ(0, memcmp(buffer, image.data() + FL_CACHE_PAGE_SIZE - 100, 8192));
+   stats = fcache->get_statistics();
+   EXPECT_EQ(1, (int)stats.misses);
+   EXPECT_EQ(3, (int)stats.hits);
+   EXPECT_EQ(1, (int)stats.readahead_pages); // a new stream starts at page 0, so the first miss is sequential
+
+   // Reading on through the image reads more pages ahead on each miss.
+   for (i = 2; i < 20; i++)
+   {
+      EXPECT_EQ(4096, (int)fcache->read(1, &stream, read_test_image, &image, i * FL_CACHE_PAGE_SIZE, buffer, 4096));
+      EXPECT_EQ(0, memcmp(buffer, image.data() + (i * FL_CACHE_PAGE_SIZE), 4096));
+   }
+   stats = fcache->get_statistics();
+   EXPECT_LT((int)stats.misses, 8);
+   EXPECT_GT((int)stats.readahead_pages, 10);
+
+   // Short read at the end of the image, different images do not share pages.
+   EXPECT_EQ(100, (int)fcache->read(1, NULL, read_test_image, &image, FL_CACHE_PAGE_SIZE * 40, buffer, 4096));
+   EXPECT_EQ(0, (int)fcache->read(1, NULL, read_test_image, &image, FL_CACHE_PAGE_SIZE * 41, buffer, 4096));
+   stats = fcache->get_statistics();
+   EXPECT_EQ(4096, (int)fcache->read(2, NULL, read_test_image, &image, 0, buffer, 4096));
+   EXPECT_EQ(stats.misses + 1, fcache->get_statistics().misses);
+
+   // Large reads are not cached, shrinking the cache drops pages.
+   char *large_buffer = (char *)malloc(FL_CACHE_BYPASS_SIZE);
+   EXPECT_EQ((int)FL_CACHE_BYPASS_SIZE, (int)fcache->read(1, NULL, read_test_image, &image, 0, large_buffer, FL_CACHE_BYPASS_SIZE));
+   EXPECT_EQ(0, memcmp(large_buffer, image.data(), FL_CACHE_BYPASS_SIZE));
+   EXPECT_EQ(1, (int)fcache->get_statistics().bypass_reads);
+   free(large_buffer);
+   fcache->set_cache_size(FL_CACHE_PAGE_SIZE * FL_CACHE_SHARDS);
+   stats = fcache->get_statistics();
+   EXPECT_LE(stats.page_count, (size_t)FL_CACHE_SHARDS);
+   EXPECT_GT((int)stats.evictions, 0);
+   EXPECT_TRUE(fcache->get_statistics_string().find("hit rate") != string::npos);
+
+   fcache->clear();
+   EXPECT_EQ(0, (int)fcache->get_statistics().page_count);
+   fcache->set_cache_size(0);
+   EXPECT_EQ(4096, (int)fcache->read(1, &stream, read_test_image, &image, 0, buffer, 4096));
+   EXPECT_EQ(0, (int)fcache->get_statistics().page_count);
+
+   delete fcache;
+}
+
+TEST(FineLineTreeModelTests, ValidateMethods)
+{
+   Fineline_Tree_Model *fmodel = new Fineline_Tree_Model();
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   fl_file_record_t *flf;
+   uint32_t node, dir, c;
+   string filename;
+   char num[256];
+   int i;
+
+   ASSERT_TRUE(NULL != fmodel);
+   EXPECT_EQ(0, (int)fmodel->size());
+   EXPECT_EQ(FL_TREE_NO_NODE, fmodel->add_path("/", NULL));
+
+   // A large directory, added in reverse name order.
+   for (i = 9999; i >= 0; i--)
+   {
+      flf = farena->new_record();
+      sprintf(num, "FS1/Windows/winsxs/file%05d.dll", i);
+      filename = num;
+      node = fmodel->add_path(filename, flf);
+      ASSERT_NE(FL_TREE_NO_NODE, node);
+      EXPECT_EQ(flf, fmodel->get_record(node));
+   }
+   flf = farena->new_record();
+   EXPECT_EQ(fmodel->find_path("FS1/Windows/winsxs/file00042.dll"), fmodel->add_path("/FS1//Windows/winsxs/file00042.dll", flf));
+   EXPECT_EQ(10003, (int)fmodel->size());
+
+   dir = fmodel->find_path("FS1/Windows/winsxs");
+   ASSERT_NE(FL_TREE_NO_NODE, dir);
+   EXPECT_EQ(NULL, fmodel->get_record(dir));
+   EXPECT_EQ(1, fmodel->is_directory(dir));
+   EXPECT_EQ(10000, (int)fmodel->get_child_count(dir));
+   EXPECT_STREQ("winsxs", fmodel->get_name(dir));
+   EXPECT_EQ(dir, fmodel->get_parent(fmodel->find_path("FS1/Windows/winsxs/file09999.dll")));
+   EXPECT_EQ(FL_TREE_NO_NODE, fmodel->find_path("FS1/Windows/winsxs/file10000.dll"));
+   EXPECT_EQ(FL_TREE_NO_NODE, fmodel->find_path("FS1/Windows/file00001.dll"));
+
+   // Children are listed in name order once sorted.
+   EXPECT_EQ(0, fmodel->get_flags(dir) & FL_TREE_NODE_SORTED);
+   fmodel->sort_children(dir);
+   EXPECT_NE(0, fmodel->get_flags(dir) & FL_TREE_NODE_SORTED);
+   c = fmodel->get_first_child(dir);
+   EXPECT_STREQ("file00000.dll", fmodel->get_name(c));
+   for (i = 1; c != FL_TREE_NO_NODE; i++)
+   {
+      if (fmodel->get_next_sibling(c) != FL_TREE_NO_NODE)
+      {
+         EXPECT_LT(strcmp(fmodel->get_name(c), fmodel->get_name(fmodel->get_next_sibling(c))), 0);
+      }
+      c = fmodel->get_next_sibling(c);
+   }
+   EXPECT_EQ(10001, i);
+   EXPECT_EQ("FS1/Windows/winsxs/file00042.dll", fmodel->get_path(fmodel->find_path("FS1/Windows/winsxs/file00042.dll")));
+
+   // Marking a directory marks everything below it, hidden files are not visible children.
+   EXPECT_EQ(10000, (int)fmodel->set_marked(fmodel->find_path("FS1/Windows"), 1));
+   EXPECT_EQ(1, fmodel->get_record(fmodel->find_path("FS1/Windows/winsxs/file00042.dll"))->marked);
+   node = fmodel->add_path("FS1/pagefile.sys", farena->new_record());
+   dir = fmodel->find_path("FS1");
+   EXPECT_EQ(0, fmodel->is_directory(node));
+   fmodel->set_flags(node, FL_TREE_NODE_HIDDEN);
+   fmodel->set_flags(fmodel->find_path("FS1/Windows"), FL_TREE_NODE_HIDDEN);
+   EXPECT_EQ(0, fmodel->has_visible_children(dir));
+   fmodel->clear_flags(node, FL_TREE_NODE_HIDDEN);
+   EXPECT_EQ(1, fmodel->has_visible_children(dir));
+   EXPECT_GT(fmodel->get_memory_used(), (size_t)0);
+
+   fmodel->clear();
+   EXPECT_EQ(0, (int)fmodel->size());
+   EXPECT_EQ(FL_TREE_NO_NODE, fmodel->find_path("FS1"));
+
+   delete fmodel;
+   delete farena;
+}
+
+TEST(FineLineEventLoaderTests, ValidateMethods)
+{
+   Fineline_Log *flog = new Fineline_Log();
+   Fineline_Event_Loader *floader = new Fineline_Event_Loader();
+   string event_file = "fineline-loader-test.fle";
+   FILE *efile;
+   int i;
+
+   ASSERT_TRUE(NULL != flog);
+   ASSERT_TRUE(NULL != floader);
+
+   flog->open_log_file();
+
+   efile = fopen(event_file.c_str(), "w");
+   ASSERT_TRUE(NULL != efile);
+   fprintf(efile, "<project><name>Loader Test</name></project>\n");
+   for (i = 0; i < 100000; i++)
+   {
+      fprintf(efile, "<event><id>%d</id><evidencenumber>NONE</evidencenumber><time>01/03/2014 10:%02d:%02d</time><type>1</type>"
+                     "<summary>Test Event</summary><data>C:\\temp\\file%d.doc <b></data><hiddenevent>0</hiddenevent></event>\r\n", i, (i / 60) % 60, i % 60, i);
+   }
+   fclose(efile);
+
+   EXPECT_EQ(-1, floader->open_event_file("bad_file.fle"));
+   EXPECT_EQ(0, floader->open_event_file(event_file));
+   EXPECT_EQ(100000, floader->load_events(4));
+   EXPECT_TRUE(floader->get_project_header().equals("<project><name>Loader Test</name></project>"));
+   EXPECT_TRUE(floader->get_event(0)->id.equals("0"));
+   EXPECT_TRUE(floader->get_event(99999)->id.equals("99999"));
+   EXPECT_TRUE(floader->get_event(99999)->data.equals("C:\\temp\\file99999.doc <b>"));
+   EXPECT_TRUE(floader->get_event(99999)->summary.equals("Test Event"));
+   EXPECT_EQ(floader->get_event(1)->event_time, floader->get_event(0)->event_time + 1);
+   EXPECT_TRUE(NULL == floader->get_event(100000));
+
+   /* the same records with a single thread */
+   EXPECT_EQ(100000, floader->load_events(1));
+   EXPECT_EQ(1393668000, Fineline_Event_Loader::parse_event_time("01/03/2014 10:00:00", 19));
+   EXPECT_EQ(1393840800, Fineline_Event_Loader::parse_event_time("Mon Mar  3 10:00:00 2014", 24));
+   EXPECT_EQ(FL_EVENT_INVALID_TIME, Fineline_Event_Loader::parse_event_time("NONE", 4));
+   EXPECT_EQ(0, floader->close_event_file());
+
+   remove(event_file.c_str());
+   flog->close_log_file();
+   delete floader;
+   delete flog;
+}
+
+TEST(FineLineFileQueueTests, ValidateMethods)
+{
+   Fineline_File_Queue *fqueue = new Fineline_File_Queue(1000);
+   fl_file_record_t *flf = (fl_file_record_t *) Fineline_Util::xcalloc(sizeof(fl_file_record_t));
+   fl_file_record_t *batch[FL_FILE_QUEUE_BATCH];
+   int i;
+
+   ASSERT_TRUE(NULL != fqueue);
+   ASSERT_TRUE(NULL != flf);
+
+   EXPECT_EQ(1024, (int)fqueue->capacity());
+   for (i = 0; i < 1024; i++)
+   {
+      EXPECT_EQ(0, fqueue->push(flf));
+   }
+   EXPECT_EQ(-1, fqueue->push(flf));
+   EXPECT_EQ(1024, (int)fqueue->size());
+   EXPECT_EQ(1000, (int)fqueue->pop_batch(batch, 1000));
+   EXPECT_TRUE(flf == batch[999]);
+   EXPECT_EQ(0, fqueue->push(flf));
+   EXPECT_EQ(25, (int)fqueue->pop_batch(batch, FL_FILE_QUEUE_BATCH));
+   EXPECT_EQ(0, (int)fqueue->pop_batch(batch, FL_FILE_QUEUE_BATCH));
+   EXPECT_EQ(0, fqueue->is_complete());
+   fqueue->set_complete();
+   EXPECT_EQ(1, fqueue->is_complete());
+   fqueue->reset();
+   EXPECT_EQ(0, (int)fqueue->size());
+   EXPECT_EQ(0, fqueue->is_complete());
+   EXPECT_EQ(1000, (int)fqueue->push_batch(batch, 1000));
+   EXPECT_EQ(24, (int)fqueue->push_batch(batch, 1000));
+   EXPECT_EQ(0, (int)fqueue->push_batch(batch, 1000));
+   EXPECT_EQ(1024, (int)fqueue->pop_batch(batch, FL_FILE_QUEUE_BATCH));
+   EXPECT_TRUE(flf == batch[1023]);
+
+   Fineline_Util::xfree((char *) flf, sizeof(fl_file_record_t));
+   delete fqueue;
+}
+
+static void allocate_test_records(Fineline_File_Arena *farena, int count)
+{
+   fl_arena_cursor_t cursor = { NULL, 0 };
+   fl_file_record_t *flf;
+   char filename[64];
+   int i;
+
+   for (i = 0; i < count; i++)
+   {
+      flf = farena->new_record(&cursor);
+      sprintf(filename, "file%d.dat", i % 1000);
+      farena->set_file_name(flf, filename);
+   }
+}
+
+TEST(FineLineFileArenaTests, ValidateMethods)
+{
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   fl_file_record_t *windows_dir;
+   fl_file_record_t *system_dir;
+   fl_file_record_t *flf;
+   string filename;
+   char num[256];
+   int i;
+
+   ASSERT_TRUE(NULL != farena);
+
+   windows_dir = farena->new_record();
+   farena->set_file_name(windows_dir, "Windows");
+   windows_dir->file_system_id = 1;
+   system_dir = farena->new_record();
+   farena->set_file_name(system_dir, "System32");
+   system_dir->file_system_id = 1;
+   system_dir->parent = windows_dir;
+   flf = farena->new_record();
+   farena->set_file_name(flf, "notepad.exe");
+   flf->file_system_id = 1;
+   flf->parent = system_dir;
+
+   EXPECT_EQ(2, flf->id);
+   EXPECT_EQ("Windows/System32/", Fineline_File_Arena::get_file_path(flf));
+   EXPECT_EQ("FS1/Windows/System32/notepad.exe", Fineline_File_Arena::get_full_path(flf));
+   EXPECT_EQ("FS1/Windows", Fineline_File_Arena::get_full_path(windows_dir));
+   EXPECT_TRUE(NULL == flf->comment);
+   EXPECT_EQ(0, farena->set_comment(flf, "suspicious"));
+   EXPECT_STREQ("suspicious", flf->comment);
+
+   /* orphaned records keep their directory path */
+   flf = farena->new_record();
+   farena->set_file_name(flf, "file.txt");
+   flf->file_path = farena->intern_string("orphan/dir/", 11);
+   EXPECT_EQ("orphan/dir/file.txt", Fineline_File_Arena::get_full_path(flf));
+
+   /* repeated names are only stored once */
+   for (i = 0; i < 200000; i++)
+   {
+      flf = farena->new_record();
+      filename = "desktop";
+      filename.append(Fineline_Util::xitoa(i % 1000, num, 256, 10));
+      filename.append(".ini");
+      farena->set_file_name(flf, filename);
+      flf->parent = system_dir;
+   }
+   EXPECT_TRUE(farena->intern_string("desktop999.ini", 14) == flf->file_name);
+   EXPECT_EQ(200004, (int)farena->get_record_count());
+   EXPECT_TRUE(farena->get_memory_used() < 200004 * 256);
+
+   farena->clear();
+   EXPECT_EQ(0, (int)farena->get_record_count());
+   EXPECT_EQ(0, (int)farena->get_interned_count());
+
+   /* walker threads allocate from their own cursors */
+   vector<thread> walkers;
+   for (i = 0; i < 4; i++)
+      walkers.push_back(thread(allocate_test_records, farena, 50000));
+   for (i = 0; i < 4; i++)
+      walkers[i].join();
+   EXPECT_EQ(200000, (int)farena->get_record_count());
+   EXPECT_EQ(1000, (int)farena->get_interned_count());
+
+   delete farena;
+}
+
+TEST(FineLineFileIndexTests, ValidateMethods)
+{
+   Fineline_File_Index *findex = new Fineline_File_Index();
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   fl_file_record_t *flf = NULL;
+   string filename;
+   char num[256];
+   size_t pos;
+   int i;
+
+   ASSERT_TRUE(NULL != findex);
+   ASSERT_TRUE(NULL != farena);
+
+   for (i = 9999; i >= 0; i--)
+   {
+      flf = farena->new_record();
+      filename = "FS1/Users/admin/file";
+      filename.append(Fineline_Util::xitoa(i, num, 256, 10));
+      filename.append(".txt");
+      findex->add_file(filename, flf);
+      findex->add_file("FS1/Windows/" + filename.substr(4), flf);
+   }
+   EXPECT_EQ(20000, (int)findex->size());
+   EXPECT_EQ(20000, findex->add_file("FS1/Users/admin/file0.txt", flf));
+   EXPECT_TRUE(flf == findex->find_file("FS1/Users/admin/file0.txt"));
+   EXPECT_TRUE(NULL == findex->find_file("FS1/Users/admin/file10000.txt"));
+   EXPECT_EQ(0, findex->is_sorted());
+
+   findex->sort_index();
+   EXPECT_EQ(1, findex->is_sorted());
+   EXPECT_STREQ("FS1/Users/admin/file0.txt", findex->get_path(0));
+   EXPECT_STREQ("FS1/Users/admin/file1.txt", findex->get_path(1));
+   EXPECT_STREQ("FS1/Users/admin/file10.txt", findex->get_path(2));
+   for (i = 1; i < 20000; i++)
+   {
+      EXPECT_LT(strcmp(findex->get_path(i - 1), findex->get_path(i)), 0);
+   }
+
+   pos = findex->find_prefix("FS1/Windows/");
+   EXPECT_EQ(10000, (int)pos);
+   EXPECT_STREQ("FS1/Windows/Users/admin/file0.txt", findex->get_path(pos));
+   EXPECT_EQ(20000, (int)findex->find_prefix("FS2/"));
+   EXPECT_TRUE(NULL == findex->get_record(20000));
+
+   findex->clear();
+   EXPECT_EQ(0, (int)findex->size());
+   EXPECT_TRUE(NULL == findex->find_file("FS1/Users/admin/file0.txt"));
+
+   delete findex;
+   delete farena;
+}
+
+TEST(FineLineCaseSnapshotTests, ValidateMethods)
+{
+   shared_ptr< Fineline_File_Index > findex = make_shared< Fineline_File_Index >();
+   Fineline_Case_Snapshot *snapshot = new Fineline_Case_Snapshot();
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   Fineline_File_Arena *larena = new Fineline_File_Arena();
+   fl_file_record_t *dir, *flf;
+   fl_file_digests_t *digests;
+   Fineline_File_Map fmap;
+   vector<int64_t> offsets;
+   string filename;
+   char num[256];
+   FILE *fp;
+   int i;
+
+   // A directory that is only a parent, not in the index, and 1000 files in it.
+   dir = farena->new_record();
+   farena->set_file_name(dir, "Windows");
+   dir->file_type = TSK_FS_META_TYPE_DIR;
+   for (i = 0; i < 1000; i++)
+   {
+      flf = farena->new_record();
+      sprintf(num, "file%d.dll", i);
+      farena->set_file_name(flf, num);
+      flf->parent = dir;
+      flf->file_system_id = 1;
+      flf->meta_address = 100 + i;
+      flf->file_size = i * 10;
+      flf->change_time = 1400000000 + i;
+      flf->marked = (i % 3 == 0);
+      findex->add_file(Fineline_File_Arena::get_full_path(flf), flf);
+   }
+   flf = findex->find_file("FS1/Windows/file7.dll");
+   farena->set_comment(flf, "suspicious");
+   digests = farena->new_digests();
+   digests->md5[0] = 0xAB;
+   flf->digests = digests;
+   findex->sort_index();
+   offsets.push_back(63 * 512);
+
+   EXPECT_EQ(0, Fineline_Case_Snapshot::save_snapshot("fineline-search-test.fls", findex, "no-such-image.dd", offsets));
+   EXPECT_EQ(1001, snapshot->open_snapshot("fineline-search-test.fls"));
+   EXPECT_EQ("no-such-image.dd", snapshot->get_image_name());
+   ASSERT_EQ(1, (int)snapshot->get_file_system_offsets().size());
+   EXPECT_EQ(63 * 512, (int)snapshot->get_file_system_offsets()[0]);
+
+   fmap = snapshot->load_records(larena);
+   ASSERT_TRUE(fmap != NULL);
+   EXPECT_EQ(1000, (int)fmap->size());
+   EXPECT_EQ(1001, (int)larena->get_record_count());
+   for (i = 0; i < 1000; i++)
+   {
+      EXPECT_STREQ(findex->get_path(i), fmap->get_path(i));
+      EXPECT_EQ(string(fmap->get_path(i)), Fineline_File_Arena::get_full_path(fmap->get_record(i)));
+      EXPECT_EQ(findex->get_record(i)->meta_address, fmap->get_record(i)->meta_address);
+      EXPECT_EQ(findex->get_record(i)->marked, fmap->get_record(i)->marked);
+      EXPECT_EQ(findex->get_record(i)->change_time, fmap->get_record(i)->change_time);
+   }
+   // The loaded records do not use the snapshot file once it is closed.
+   snapshot->close_snapshot();
+   EXPECT_TRUE(snapshot->load_records(larena) == NULL);
+   flf = fmap->find_file("FS1/Windows/file7.dll");
+   ASSERT_TRUE(NULL != flf);
+   EXPECT_STREQ("file7.dll", flf->file_name);
+   EXPECT_STREQ("suspicious", flf->comment);
+   ASSERT_TRUE(NULL != flf->digests);
+   EXPECT_EQ(0xAB, flf->digests->md5[0]);
+   EXPECT_EQ(TSK_FS_META_TYPE_DIR, flf->parent->file_type);
+   EXPECT_TRUE(NULL == fmap->find_file("FS1/Windows/file8.dll")->comment);
+   EXPECT_EQ(0, Fineline_Case_Snapshot::save_snapshot("fineline-search-test.fls", fmap, "no-such-image.dd", offsets));
+   EXPECT_EQ(1001, snapshot->open_snapshot("fineline-search-test.fls"));
+   snapshot->close_snapshot();
+
+   // Damaged and missing files are rejected.
+   filename = "fineline-search-test.fls";
+   fp = fopen(filename.c_str(), "wb");
+   ASSERT_TRUE(NULL != fp);
+   fwrite(FL_SNAPSHOT_MAGIC, 8, 1, fp);
+   memset(num, 0, sizeof(num));
+   fwrite(num, sizeof(num), 1, fp);
+   fclose(fp);
+   EXPECT_EQ(-1, snapshot->open_snapshot(filename.c_str()));
+   EXPECT_EQ(-1, snapshot->open_snapshot("bad_file.fls"));
+   remove(filename.c_str());
+
+   delete snapshot;
+   delete larena;
+   delete farena;
+}
+
+TEST(FineLineProjectTests, ValidateMethods)
+{
+   shared_ptr< Fineline_File_Index > findex = make_shared< Fineline_File_Index >();
+   Fineline_Project *project = new Fineline_Project();
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   vector<fl_project_file_t> file_list;
+   vector<fl_mac_event_t> events;
+   map<string, int64_t> statistics;
+   fl_file_record_t *flf;
+   fl_mac_event_t event;
+   struct stat st;
+   off_t file_size;
+   char num[256];
+   FILE *fp;
+   int i;
+
+   for (i = 0; i < 1000; i++)
+   {
+      flf = farena->new_record();
+      sprintf(num, "file%d.dll", i);
+      farena->set_file_name(flf, num);
+      flf->file_system_id = 1;
+      flf->file_size = i * 10;
+      flf->marked = (i % 10 == 0);
+      flf->hidden = (i == 5);
+      findex->add_file(Fineline_File_Arena::get_full_path(flf), flf);
+      event.event_time = 1400000000 + i;
+      event.record = flf;
+      event.flags = FL_MAC_FILE_NAME | FL_MAC_BORN;
+      events.push_back(event);
+   }
+   farena->set_comment(findex->find_file("FS1/file7.dll"), "suspicious");
+   findex->sort_index();
+   statistics["deleted_files"] = 42;
+
+   EXPECT_EQ(0, project->new_project("fineline-search-test.flp"));
+   project->setProjectName("Test Case");
+   project->setProjectInvestigator("Examiner");
+   EXPECT_EQ(100, project->write_file_metadata_list(findex));
+   EXPECT_EQ(102, project->write_file_system_tree(findex));
+   EXPECT_EQ(1000, project->write_timeline_event_list(events));
+   EXPECT_EQ(1, project->write_statistical_records(statistics));
+   EXPECT_TRUE(project->section_modified(FL_SECTION_TIMELINE));
+   EXPECT_EQ(0, project->save_project());
+   EXPECT_FALSE(project->section_modified(FL_SECTION_TIMELINE));
+
+   // Unchanged sections are not saved again, a changed section is appended.
+   EXPECT_EQ(1000, project->write_timeline_event_list(events));
+   EXPECT_FALSE(project->section_modified(FL_SECTION_TIMELINE));
+   ASSERT_EQ(0, stat("fineline-search-test.flp", &st));
+   file_size = st.st_size;
+   findex->find_file("FS1/file1.dll")->marked = 1;
+   EXPECT_EQ(103, project->write_file_system_tree(findex));
+   EXPECT_TRUE(project->section_modified(FL_SECTION_TREE));
+   EXPECT_EQ(0, project->save_project());
+   ASSERT_EQ(0, stat("fineline-search-test.flp", &st));
+   EXPECT_GT(st.st_size, file_size);
+   EXPECT_LT(st.st_size - file_size, 10000);
+   delete project;
+
+   // Reopen and restore the sections into fresh records.
+   for (i = 0; i < 1000; i++)
+   {
+      findex->get_record(i)->marked = 0;
+      findex->get_record(i)->hidden = 0;
+   }
+   project = new Fineline_Project();
+   EXPECT_EQ(0, project->open_project("fineline-search-test.flp"));
+   EXPECT_EQ("Test Case", project->getProjectName());
+   EXPECT_EQ("Examiner", project->getProjectInvestigator());
+   EXPECT_EQ(103, project->read_file_system_tree(findex, farena));
+   EXPECT_EQ(1, findex->find_file("FS1/file1.dll")->marked);
+   EXPECT_EQ(1, findex->find_file("FS1/file5.dll")->hidden);
+   EXPECT_EQ(0, findex->find_file("FS1/file2.dll")->marked);
+   EXPECT_EQ(100, project->read_file_metadata_list(file_list));
+   EXPECT_EQ("FS1/file0.dll", file_list[0].file_path);
+   EXPECT_EQ(1000, project->read_timeline_event_list(findex, events));
+   EXPECT_EQ(1400000007, events[7].event_time);
+   EXPECT_EQ(findex->find_file("FS1/file7.dll"), events[7].record);
+   EXPECT_EQ(FL_MAC_FILE_NAME | FL_MAC_BORN, events[7].flags);
+   EXPECT_EQ(1, project->read_statistical_records(statistics));
+   EXPECT_EQ(42, statistics["deleted_files"]);
+
+   // Save As copies the sections that were never read.
+   EXPECT_EQ(0, project->save_project_as("fineline-search-test2.flp"));
+   delete project;
+   project = new Fineline_Project();
+   EXPECT_EQ(0, project->open_project("fineline-search-test2.flp"));
+   EXPECT_EQ(1000, project->read_timeline_event_list(findex, events));
+   EXPECT_EQ(1, project->read_statistical_records(statistics));
+
+   // Project files with only the header line are still read.
+   fp = fopen("fineline-search-test.flp", "w");
+   ASSERT_TRUE(NULL != fp);
+   fputs("<project><name>Old Case</name><investigator>Examiner</investigator></project>\n", fp);
+   fclose(fp);
+   EXPECT_EQ(0, project->open_project("fineline-search-test.flp"));
+   EXPECT_EQ("Old Case", project->getProjectName());
+   EXPECT_EQ(0, project->read_file_system_tree(findex, farena));
+   EXPECT_EQ(-1, project->open_project("bad_file.flp"));
+
+   remove("fineline-search-test.flp");
+   remove("fineline-search-test2.flp");
+   delete project;
+   delete farena;
+}
+
+TEST(FineLineFileMetadataBrowserTests, ValidateMethods)
+{
+   Fineline_File_Metadata_Browser *mb = new Fineline_File_Metadata_Browser(0, 0, 600, 400);
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   vector< fl_file_record_t* > flist;
+   fl_file_record_t *flf;
+   char num[256];
+   int i;
+
+   for (i = 0; i < 3; i++)
+   {
+      flf = farena->new_record();
+      sprintf(num, "file%d.txt", i);
+      farena->set_file_name(flf, num);
+      flf->file_size = (i == 1) ? 5000000000LL : 100 * i;
+      flf->modification_time = 1400000000 - i;
+      flist.push_back(flf);
+   }
+
+   // A file row followed by its text rows.
+   mb->add_file_record(flist[0]);
+   EXPECT_EQ(2, mb->add_row("   MD5: 00"));
+   EXPECT_EQ(4, mb->add_file_record_list(vector< fl_file_record_t* >(flist.begin() + 1, flist.end())));
+   EXPECT_EQ(3, mb->get_record_count());
+   EXPECT_EQ(0, mb->get_row(1).find("file0.txt\t"));
+   EXPECT_EQ("   MD5: 00", mb->get_row(2));
+   EXPECT_NE(string::npos, mb->get_row(3).find("\t5000000000"));
+   EXPECT_EQ("", mb->get_row(5));
+
+   mb->sort_column(FL_COLUMN_SIZE, 1);
+   EXPECT_EQ(0, mb->get_row(1).find("file1.txt"));
+   EXPECT_EQ(0, mb->get_row(2).find("file2.txt"));
+   EXPECT_EQ(0, mb->get_row(3).find("file0.txt"));
+   EXPECT_EQ("   MD5: 00", mb->get_row(4));
+   mb->sort_column(FL_COLUMN_NAME, 0);
+   EXPECT_EQ(0, mb->get_row(1).find("file0.txt"));
+   EXPECT_EQ("   MD5: 00", mb->get_row(2));
+   mb->sort_column(FL_COLUMN_MODIFIED, 0);
+   EXPECT_EQ(0, mb->get_row(1).find("file2.txt"));
+   EXPECT_EQ(0, mb->get_table().find("Filename\tModification Time"));
+
+   EXPECT_EQ(0, mb->save_metadata_list("fineline-search-test-metadata.txt"));
+   remove("fineline-search-test-metadata.txt");
+
+   // Adding a large list does not format any rows.
+   for (i = 0; i < 1000000; i++)
+      flist.push_back(flist[i % 3]);
+   EXPECT_EQ(1000007, mb->add_file_record_list(flist));
+   mb->sort_column(FL_COLUMN_SIZE, 0);
+   EXPECT_EQ(0, mb->get_row(mb->size()).find("file1.txt"));
+
+   mb->clear();
+   EXPECT_EQ(0, mb->size());
+   EXPECT_EQ(0, mb->get_record_count());
+
+   delete mb;
+   delete farena;
+}
+
+TEST(FineLineEventListTimelineTests, ValidateMethods)
+{
+   Fineline_Event_List *elist = new Fineline_Event_List();
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   vector< fl_mac_event_t > fn_events;
+   fl_mac_event_t ev;
+   fl_file_record_t *flf;
+   string event_string;
+   char num[256];
+   int64_t last_time;
+   long n;
+   int i;
+
+   EXPECT_EQ(19, Fineline_Event_List::format_event_time(1398431159, num));
+   EXPECT_STREQ("25/04/2014 13:05:59", num);
+   Fineline_Event_List::format_event_time(951782400, num);
+   EXPECT_STREQ("29/02/2000 00:00:00", num);
+
+   // Equal times are one event, unset times are skipped.
+   flf = farena->new_record();
+   farena->set_file_name(flf, "notepad.exe");
+   flf->modification_time = 1398431159;
+   flf->change_time = 1398431159;
+   flf->creation_time = 1300000000;
+   elist->add_file_record(flf);
+   ev.event_time = 1200000000;
+   ev.record = flf;
+   ev.flags = FL_MAC_BORN | FL_MAC_FILE_NAME;
+   fn_events.push_back(ev);
+   EXPECT_EQ(1, elist->add_mac_events(fn_events));
+   EXPECT_EQ(3, elist->sort_records());
+   EXPECT_EQ(0, elist->spill_count());
+   elist->start_merge();
+   ASSERT_EQ(1, elist->next_event(&ev));
+   EXPECT_EQ(FL_MAC_BORN | FL_MAC_FILE_NAME, ev.flags);
+   ASSERT_EQ(1, elist->next_event(&ev));
+   EXPECT_EQ(FL_MAC_BORN, ev.flags);
+   ASSERT_EQ(1, elist->next_event(&ev));
+   EXPECT_EQ(FL_MAC_MODIFIED | FL_MAC_CHANGED, ev.flags);
+   EXPECT_EQ(0, elist->next_event(&ev));
+   Fineline_Event_List::format_event(&ev, 3, event_string);
+   EXPECT_EQ(0, event_string.find("<event><id>3</id><evidencenumber>NONE</evidencenumber><time>25/04/2014 13:05:59</time><type>17</type><summary>m.c. notepad.exe</summary><data>notepad.exe</data>"));
+   Fineline_Event_List::format_bodyfile_line(flf, 0, event_string);
+   EXPECT_EQ("0|notepad.exe|0|r/r---------|0|0|0|0|1398431159|1398431159|1300000000\n", event_string);
+
+   EXPECT_EQ(3, elist->write_records("fineline-search-test-timeline.fle"));
+   remove("fineline-search-test-timeline.fle");
+   EXPECT_EQ(2, elist->write_bodyfile("fineline-search-test-timeline.body"));
+   remove("fineline-search-test-timeline.body");
+   EXPECT_EQ(0, elist->clear_list());
+
+   // Small runs force the events to be spilled and merged.
+   for (i = 0; i < 100000; i++)
+   {
+      flf = farena->new_record();
+      sprintf(num, "file%d.txt", i);
+      farena->set_file_name(flf, num);
+      flf->modification_time = 1000000000 + (((int64_t)i * 7919) % 100003);
+      flf->access_time = 1100000000 + (((int64_t)i * 104729) % 100019);
+      flf->change_time = 1200000000 + (((int64_t)i * 1299709) % 100043);
+      flf->creation_time = 900000000 + i;
+      elist->add_file_record(flf);
+   }
+   elist->set_run_size(65536);
+   elist->set_thread_count(4);
+   EXPECT_EQ(400000, elist->sort_records());
+   EXPECT_EQ(6, elist->spill_count());
+
+   elist->start_merge();
+   last_time = 0;
+   n = 0;
+   while (elist->next_event(&ev))
+   {
+      if (ev.event_time < last_time)
+         break;
+      last_time = ev.event_time;
+      n++;
+   }
+   EXPECT_EQ(400000, n);
+   EXPECT_EQ(400000, elist->write_records("fineline-search-test-timeline.fle"));
+   remove("fineline-search-test-timeline.fle");
+
+   // One run in memory sorted in blocks by 4 threads.
+   elist->set_run_size(FL_EVENT_RUN_SIZE);
+   EXPECT_EQ(400000, elist->sort_records());
+   EXPECT_EQ(0, elist->spill_count());
+   elist->start_merge();
+   last_time = 0;
+   n = 0;
+   while (elist->next_event(&ev))
+   {
+      if (ev.event_time < last_time)
+         break;
+      last_time = ev.event_time;
+      n++;
+   }
+   EXPECT_EQ(400000, n);
+
+   delete elist;
+   delete farena;
+}
+
+TEST(FineLineEventHistogramTests, ValidateMethods)
+{
+   Fineline_Event_Histogram *histogram = new Fineline_Event_Histogram();
+   Fineline_Event_List *elist = new Fineline_Event_List();
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   vector< fl_mac_event_t > window;
+   uint64_t counts[FL_HISTOGRAM_TYPES];
+   fl_file_record_t *flf;
+   int i;
+
+   EXPECT_EQ(FL_LEVEL_SECOND, histogram->select_level(0.5));
+   EXPECT_EQ(FL_LEVEL_MINUTE, histogram->select_level(60.0));
+   EXPECT_EQ(FL_LEVEL_HOUR, histogram->select_level(86399.0));
+   EXPECT_EQ(FL_LEVEL_DAY, histogram->select_level(1.0e6));
+
+   // One event a minute for a day, every tenth one also changed.
+   for (i = 0; i < 1440; i++)
+      histogram->add_event(1400000000 + (i * 60), (i % 10 == 0) ? (FL_MAC_MODIFIED | FL_MAC_CHANGED) : FL_MAC_MODIFIED);
+   EXPECT_EQ(1440, histogram->get_event_count());
+   EXPECT_EQ(1400000000, histogram->get_first_time());
+   EXPECT_EQ(1400000000 + (1439 * 60), histogram->get_last_time());
+   EXPECT_EQ(1440, histogram->get_bucket_count(FL_LEVEL_SECOND));
+   EXPECT_EQ(1440, histogram->get_bucket_count(FL_LEVEL_MINUTE));
+   EXPECT_EQ(25, histogram->get_bucket_count(FL_LEVEL_HOUR));
+
+   EXPECT_EQ(1440, histogram->count_range(FL_LEVEL_MINUTE, 1399999980, 1400086380, counts));
+   EXPECT_EQ(1440, counts[FL_HISTOGRAM_MODIFIED]);
+   EXPECT_EQ(144, counts[FL_HISTOGRAM_CHANGED]);
+   EXPECT_EQ(0, counts[FL_HISTOGRAM_BORN]);
+   EXPECT_EQ(10, histogram->count_range(FL_LEVEL_SECOND, 1400000000, 1400000600, NULL));
+   EXPECT_EQ(1440, histogram->count_range(FL_LEVEL_DAY, 0, 2000000000, NULL));
+
+   // Neighbouring columns count each bucket once.
+   EXPECT_EQ(1440, histogram->count_range(FL_LEVEL_HOUR, 0, 1400000000 + 3000, NULL) + histogram->count_range(FL_LEVEL_HOUR, 1400000000 + 3000, 2000000000, NULL));
+   histogram->clear();
+   EXPECT_EQ(0, histogram->get_event_count());
+   EXPECT_EQ(0, histogram->get_bucket_count(FL_LEVEL_DAY));
+
+   // The histogram fills as the event list sorts, events in a window are read from the spilled runs.
+   for (i = 0; i < 50000; i++)
+   {
+      flf = farena->new_record();
+      farena->set_file_name(flf, "file.txt");
+      flf->modification_time = 1000000000 + ((50000 - i) * 10);
+      flf->creation_time = 900000000 + i;
+      elist->add_file_record(flf);
+   }
+   elist->set_histogram(histogram);
+   elist->set_run_size(10000);
+   EXPECT_EQ(100000, elist->sort_records());
+   EXPECT_EQ(10, elist->spill_count());
+   EXPECT_EQ(100000, histogram->get_event_count());
+   EXPECT_EQ(900000000, histogram->get_first_time());
+   EXPECT_EQ(100000, histogram->count_range(FL_LEVEL_DAY, 0, 2000000000, counts));
+   EXPECT_EQ(50000, counts[FL_HISTOGRAM_MODIFIED]);
+   EXPECT_EQ(50000, counts[FL_HISTOGRAM_BORN]);
+
+   EXPECT_EQ(100, elist->get_window_events(1000000010, 1000001010, window, 1000));
+   EXPECT_EQ(1000000010, window.front().event_time);
+   EXPECT_EQ(1000001000, window.back().event_time);
+   EXPECT_EQ(FL_MAC_MODIFIED, window.back().flags);
+   EXPECT_EQ(20, elist->get_window_events(900000000, 1100000000, window, 20));
+   EXPECT_EQ(900000019, window.back().event_time);
+
+   delete elist;
+   delete histogram;
+   delete farena;
+}
+
+TEST(FineLineFileStatisticsTests, ValidateMethods)
+{
+   Fineline_File_Statistics *fstats = new Fineline_File_Statistics();
+   Fineline_File_Statistics *pstats = new Fineline_File_Statistics();
+   Fineline_File_Index *findex = new Fineline_File_Index();
+   Fineline_File_Arena *farena = new Fineline_File_Arena();
+   unordered_map< fl_file_record_t*, fl_stats_total_t > subtree_totals;
+   vector< fl_file_record_t* > flist;
+   vector< fl_file_record_t* > plist;
+   vector< string > report;
+   fl_file_record_t *docs, *sub, *flf;
+   const char *names[4] = { "report.DOC", "image.jpg", ".profile", "archive.tar.gz" };
+   string extension;
+   char num[256];
+   int i;
+
+   EXPECT_EQ(0, Fineline_File_Statistics::get_size_class(0));
+   EXPECT_EQ(1, Fineline_File_Statistics::get_size_class(1));
+   EXPECT_EQ(11, Fineline_File_Statistics::get_size_class(1024));
+   EXPECT_EQ(FL_STATS_SIZE_CLASSES - 1, Fineline_File_Statistics::get_size_class(1LL << 50));
+   EXPECT_EQ(1, Fineline_File_Statistics::get_extension("report.DOC", extension));
+   EXPECT_EQ("doc", extension);
+   EXPECT_EQ(0, Fineline_File_Statistics::get_extension(".profile", extension));
+   EXPECT_EQ(0, Fineline_File_Statistics::get_extension("README", extension));
+
+   docs = farena->new_record();
+   farena->set_file_name(docs, "docs");
+   docs->file_type = TSK_FS_META_TYPE_DIR;
+   sub = farena->new_record();
+   farena->set_file_name(sub, "sub");
+   sub->file_type = TSK_FS_META_TYPE_DIR;
+   sub->parent = docs;
+   findex->add_file("FS1/docs", docs);
+   findex->add_file("FS1/docs/sub", sub);
+
+   // Files in the root, docs and docs/sub directories, one in four is deleted.
+   for (i = 0; i < 200000; i++)
+   {
+      flf = farena->new_record();
+      farena->set_file_name(flf, names[i % 4]);
+      flf->file_type = TSK_FS_META_TYPE_REG;
+      flf->file_size = i;
+      flf->deleted = (i % 4 == 3) ? 1 : 0;
+      flf->parent = (i % 3 == 0) ? NULL : ((i % 3 == 1) ? docs : sub);
+      flf->modification_time = 1400000000 + ((int64_t)i * 60);
+      flf->creation_time = (i % 2 == 0) ? 1400000000 : 0;
+      findex->add_file(string("FS1/file") + Fineline_Util::xitoa(i, num, 256, 10), flf);
+   }
+   findex->sort_index();
+   Fineline_File_Map fmap = make_shared< const Fineline_File_Index >(*findex);
+
+   for (i = 0; i < (int)fmap->size(); i++)
+      fstats->add_file(fmap->get_record(i), (i % 2 == 0) ? 1000 : FL_STATS_NO_OWNER);
+   EXPECT_EQ(200000, fstats->get_file_count());
+   EXPECT_EQ(2, fstats->get_directory_count());
+   EXPECT_EQ(50000, fstats->get_deleted_count());
+   EXPECT_EQ((int64_t)199999 * 100000, fstats->get_total_bytes());
+   EXPECT_EQ(3, (int)fstats->get_extension_totals().size());
+   EXPECT_EQ(50000, fstats->get_extension_totals().at("doc").count);
+   EXPECT_EQ(50000, fstats->get_extension_totals().at("gz").count);
+   EXPECT_EQ(1, fstats->get_size_class_total(0).count);
+   EXPECT_EQ(512, fstats->get_size_class_total(10).count);
+   EXPECT_EQ(100000, fstats->get_owner_totals().at(1000).count);
+   EXPECT_EQ(100000, fstats->get_hour_count(FL_STATS_BORN, (1400000000 % 86400) / 3600));
+   EXPECT_EQ(0, fstats->get_hour_count(FL_STATS_ACCESSED, 0));
+   EXPECT_EQ(66667, fstats->get_directory_totals().at(NULL).count);
+   EXPECT_EQ(66666, fstats->get_directory_totals().at(sub).count);
+
+   fstats->get_subtree_totals(subtree_totals);
+   EXPECT_EQ(133333, subtree_totals[docs].count);
+   EXPECT_EQ(200000, subtree_totals[NULL].count);
+
+   fstats->get_largest_files(flist);
+   EXPECT_EQ(FL_STATS_LARGEST_FILES, (int)flist.size());
+   EXPECT_EQ(199999, flist.front()->file_size);
+   EXPECT_EQ(199900, flist.back()->file_size);
+
+   // The parallel pass over the file index gives the same totals, without the owners.
+   EXPECT_EQ(200002, Fineline_File_Statistics::compute(fmap, 4, pstats));
+   EXPECT_EQ(fstats->get_file_count(), pstats->get_file_count());
+   EXPECT_EQ(fstats->get_total_bytes(), pstats->get_total_bytes());
+   EXPECT_EQ(0, (int)pstats->get_owner_totals().size());
+   for (i = 0; i < FL_STATS_SIZE_CLASSES; i++)
+      EXPECT_EQ(fstats->get_size_class_total(i).bytes, pstats->get_size_class_total(i).bytes);
+   for (i = 0; i < 24; i++)
+      EXPECT_EQ(fstats->get_hour_count(FL_STATS_MODIFIED, i), pstats->get_hour_count(FL_STATS_MODIFIED, i));
+   EXPECT_EQ(fstats->get_extension_totals().at("jpg").bytes, pstats->get_extension_totals().at("jpg").bytes);
+   EXPECT_EQ(fstats->get_directory_totals().at(docs).bytes, pstats->get_directory_totals().at(docs).bytes);
+   pstats->get_largest_files(plist);
+   EXPECT_TRUE(flist == plist);
+
+   EXPECT_EQ(200000, fstats->get_statistics_map()["files"]);
+   EXPECT_EQ(100000, fstats->get_statistics_map()["owner.1000.files"]);
+   fstats->get_report(report);
+   EXPECT_TRUE(report.size() > 24);
+
+   pstats->merge(*fstats);
+   EXPECT_EQ(400000, pstats->get_file_count());
+   EXPECT_EQ(100000, pstats->get_owner_totals().at(1000).count);
+   pstats->clear();
+   EXPECT_EQ(0, pstats->get_file_count());
+   EXPECT_EQ(0, (int)pstats->get_directory_totals().size());
+
+   delete fstats;
+   delete pstats;
+   delete findex;
+   delete farena;
+}
+
 /* NOTE: causes mutex lock errors in TSK lib when opening the target file???
 
 TEST(FineLineSearchFileSystemExportTests, ValidateMethods)
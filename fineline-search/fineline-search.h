@@ -33,6 +33,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <sys/stat.h>
 
 
@@ -42,30 +43,73 @@
 
 enum FL_FILE_TYPES { FL_DIRECTORY = 1, FL_NORMAL_FILE, FL_SYSTEM_FILE };
 
+#define FL_HASH_SET_NONE       0
+#define FL_HASH_SET_KNOWN_GOOD 1
+#define FL_HASH_SET_KNOWN_BAD  2
+
+#define FL_MAC_MODIFIED        1
+#define FL_MAC_ACCESSED        2
+#define FL_MAC_CHANGED         4          /* metadata change */
+#define FL_MAC_BORN            8
+#define FL_MAC_FILE_NAME       16         /* times from the NTFS $FILE_NAME attribute */
+
+/*
+   File content digests, allocated from the arena when the file is hashed.
+*/
+struct fl_file_digests
+{
+   unsigned char md5[16];
+   unsigned char sha1[20];
+   unsigned char sha256[32];
+};
+
+typedef struct fl_file_digests fl_file_digests_t;
+
+/*
+   File metadata record, allocated from a Fineline_File_Arena. The strings
+   belong to the arena, paths are rebuilt from the parent directory records
+   with Fineline_File_Arena::get_file_path() and get_full_path().
+*/
 struct fl_file_record
 {
    int id;
    int marked;
    int hidden;
-   long creation_time;
-   long access_time;
-   long modification_time;
-   long file_size;
-   int  file_type;
-   int  file_system_id;
-   char file_access_time_string[32];
-   char file_creation_time_string[32];
-   char file_modification_time_string[32];
-   char file_owner[256];
-   char file_name[256];
-   char file_path[FL_MAX_INPUT_STR];
-   char full_path[FL_MAX_INPUT_STR];
-   char file_event_string[FL_MAX_INPUT_STR];
-   char comment[FL_MAX_INPUT_STR];
+   int deleted;                      /* 1 if the file metadata is unallocated */
+   int file_type;
+   int file_system_id;
+   int hash_set;                     /* FL_HASH_SET_KNOWN_GOOD/BAD if the digests are in a hash set */
+   uint16_t attribute_type;          /* TSK type of the default data attribute, 0 if none */
+   uint16_t attribute_id;            /* TSK id of the default data attribute */
+   uint64_t meta_address;            /* file system inode/MFT entry number */
+   int64_t file_size;
+   int64_t creation_time;
+   int64_t access_time;
+   int64_t modification_time;
+   int64_t change_time;              /* metadata change time */
+   struct fl_file_record *parent;    /* directory record, NULL for files in the root directory */
+   const char *file_name;            /* interned file name */
+   const char *file_path;            /* directory path, only set when the parent directory has no record */
+   const char *comment;              /* user comment, NULL if none */
+   const fl_file_digests_t *digests; /* content digests, NULL until the file is hashed */
 };
 
 typedef struct fl_file_record fl_file_record_t;
 
+/*
+   MAC timeline event for times that are not kept in the file record, the
+   flags combine the FL_MAC_ values that share the time. The record is NULL
+   for events loaded from an event file, they are only drawn in the graph.
+*/
+struct fl_mac_event
+{
+   int64_t event_time;
+   fl_file_record_t *record;
+   int flags;
+};
+
+typedef struct fl_mac_event fl_mac_event_t;
+
 
 /*
    Function Prototypes
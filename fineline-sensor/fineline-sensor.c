@@ -211,6 +211,27 @@ int parse_command_line_args(int argc, char *argv[], char *capture_device, char *
                return(-1);
 			   }
 		   }
+         else if (strncmp(argv[i], "-F", 2) == 0)
+         {
+            /* Output file format, fle (default) or flb */
+            if ((i+1) < argc)
+            {
+               if (strncmp(argv[i+1], "flb", 3) == 0)
+               {
+                  retval = retval | FL_FILE_OUT | FL_FLB_OUT; /* Create FineLine binary timeline file */
+               }
+               else if (strncmp(argv[i+1], "fle", 3) != 0)
+               {
+                  print_log_entry("parse_command_line_args() <ERROR> Unknown output file format.\n");
+                  return(-1);
+               }
+            }
+            else
+            {
+               print_log_entry("parse_command_line_args() <ERROR> Missing output file format.\n");
+               return(-1);
+            }
+         }
          else if (strncmp(argv[i], "-f", 2) == 0)
          {
             /* Filter file name  */
@@ -229,6 +250,16 @@ int parse_command_line_args(int argc, char *argv[], char *capture_device, char *
       }
    }
 
+   /* binary timeline output replaces the .fle extension of the output file */
+   if (retval & FL_FLB_OUT)
+   {
+      size_t flen = strlen(event_filename);
+      if ((flen > 4) && (strcmp(event_filename + flen - 4, EVENT_FILE_EXT) == 0))
+      {
+         strcpy(event_filename + flen - 4, FLB_FILE_EXT);
+      }
+   }
+
    print_log_entry("parse_command_line_args() <INFO> Finished processing command line arguments.\n");
 
    return(retval);
@@ -244,6 +275,7 @@ int show_sensor_help()
    printf("Output to a fineline event file                   : -w\n");
    printf("Send events to server                             : -s\n");
    printf("Specify fineline output filename                  : -o FILENAME\n");
+   printf("Specify output file format (fle or flb)           : -F FORMAT\n");
    printf("Specify network interface                         : -i INTERFACE\n");
    printf("Specify a server IP address                       : -a 192.168.1.10\n");
    printf("Specify filter file                               : -f FILENAME\n");
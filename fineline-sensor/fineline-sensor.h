@@ -53,6 +53,8 @@
 #include <pcap.h>
 
 #include "uthash.h"
+#include "flsink.h"
+#include "flbfile.h"
 
 /* structs and types */
 
@@ -127,6 +129,7 @@ int follow_tail();
 /* fleventfile.c */
 
 FILE *open_fineline_event_file(char *evt_file_name);
+int open_fineline_flb_file(char *flb_file_name);
 int write_fineline_event_record(char *estr);
 int write_fineline_project_header(char *pstr);
 int close_fineline_event_file();
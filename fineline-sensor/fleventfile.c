@@ -40,6 +40,7 @@
 #include "fineline-sensor.h"
 
 FILE *evt_file;
+fl_sink_list_t evt_sinks; /* block buffered output for the event file */
 
 /*
    Function: open_event_file()
@@ -58,9 +59,36 @@ FILE *open_fineline_event_file(char *evt_file_name)
     }
     printf("open_event_file() <INFO> open_fineline_event_file(): %s\n", evt_file_name);
 
+    init_sink_list(&evt_sinks);
+    if (add_file_sink(&evt_sinks, evt_file, 0) < 0)
+    {
+       print_log_entry("open_fineline_event_file() <ERROR> Could not create event file sink.\n");
+    }
+
    return(evt_file);
 }
 
+/*
+   Function: open_fineline_flb_file()
+
+   Purpose : Opens a FineLine binary timeline (.flb) file as the event sink.
+   Input   : Binary timeline file name.
+   Output  : Returns -1 on fail.
+*/
+int open_fineline_flb_file(char *flb_file_name)
+{
+   evt_file = NULL;
+   init_sink_list(&evt_sinks);
+   if (add_flb_sink(&evt_sinks, flb_file_name, "fineline-sensor") < 0)
+   {
+      printf("open_fineline_flb_file() <ERROR>: could not open binary timeline file: %s\n", flb_file_name);
+      return(-1);
+   }
+   printf("open_fineline_flb_file() <INFO> %s\n", flb_file_name);
+
+   return(0);
+}
+
 
 /*
    Function: write_fineline_event_record()
@@ -90,7 +118,7 @@ int write_fineline_event_record(char *estr)
    strncat(event_string, estr, strlen(estr));
    strcat(event_string, "</data><hiddenevent>0</hiddenevent><hiddentext>0</hiddentext><marked>0</marked><pinned>0</pinned><ypos>0</ypos></event>\n");
 
-   fputs (event_string, evt_file);
+   write_sink_string(&evt_sinks, event_string);
 
    return(0);
 }
@@ -121,7 +149,7 @@ int write_fineline_project_header(char *pstr)
    strcat(hdr, "</name><investigator>NONE</investigator><summary>NONE</summary><startdate>NONE</startdate><enddate>NONE</enddate><description>");
    strncat(hdr, pstr, slen);
    strcat(hdr, "</description></project>\n");
-   fputs (hdr, evt_file);
+   write_sink_string(&evt_sinks, hdr);
 
    print_log_entry("write_fineline_project_header() <INFO> Wrote Project Header.\n");
 
@@ -132,6 +160,9 @@ int write_fineline_project_header(char *pstr)
 
 int close_fineline_event_file()
 {
+   close_sinks(&evt_sinks);
+   if (evt_file == NULL) /* binary timeline output, the sink closed the file */
+      return(0);
    if (fclose(evt_file) < 0)
    {
       print_log_entry("close_fineline_event_file() <ERROR> Close event file error.\n");
@@ -142,7 +173,9 @@ int close_fineline_event_file()
 
 int dump_statistics()
 {
-   write_ip_map(evt_file);
+   flush_sinks(&evt_sinks); /* the ip map is written straight to the event file */
+   if (evt_file != NULL)
+      write_ip_map(evt_file);
 
    return(0);
 }
@@ -187,6 +220,5 @@ int create_event_record(char *event_string, char *data_string)
 */
 int write_event_record(char *event_string)
 {
-   fputs(event_string, evt_file);
-   return(0);
+   return(write_sink_string(&evt_sinks, event_string));
 }
@@ -319,7 +319,15 @@ int start_capture(char *interface, const char *bpf_string, char *event_file, cha
    }
    server_ipv4_port = htons(atoi(GUI_SERVER_PORT_STRING));
 
-   if (options & FL_FILE_OUT)
+   if (options & FL_FLB_OUT)
+   {
+      if (open_fineline_flb_file(event_file) < 0)
+      {
+         print_log_entry("start_capture() <ERROR> Could not open binary timeline file.\n");
+         return(-1);
+      }
+   }
+   else if (options & FL_FILE_OUT)
    {
       if (open_fineline_event_file(event_file) == NULL)
       {
@@ -58,6 +58,8 @@
 
 
 #include "uthash.h"
+#include "flsink.h"
+#include "flbfile.h"
 
 /*
    Constant Definitions
@@ -78,6 +80,7 @@
 #define FL_INDEX_IN  0x04
 #define FL_CACHE_IN  0x08
 #define FL_FILTER_ON 0x10
+#define FL_FLB_OUT   0x80  /* Binary timeline (.flb) output */
 
 #define FL_FILE_ACCESS_TIME   0x01
 #define FL_FILE_CREATION_TIME 0x02
@@ -229,10 +232,8 @@ int match_file_filter(char *file_string);
 
 void add_file_record(uint64_t file_id, struct fl_file_record *flf);
 struct fl_file_record *find_file(uint64_t file_id);
-void write_file_map(FILE *outfile);
-void write_file_map_in_time_sequence(FILE *outfile, int lowest);
-void send_file_map();
-void send_file_map_in_time_sequence(int lowest);
+void output_file_map(fl_sink_list_t *sinks);
+void output_file_map_in_time_sequence(fl_sink_list_t *sinks, int lowest);
 int time_sort(struct fl_file_record *a, struct fl_file_record *b);
 void sort_by_time();
 void sort_by_record_number();
@@ -246,6 +247,7 @@ uint64_t get_first_record_number();
 
 int init_socket(char *gui_ip_address);
 int send_event(char *event_string);
+int send_event_block(char *event_block, int block_len);
 char *get_response();
 int close_socket();
 
@@ -89,32 +89,40 @@ void delete_all()
   }
 }
 
-void write_file_map(FILE *outfile)
+/*
+   Function: output_file_map()
+   Purpose : single pass over the file map, each record is handed to
+             every output sink (file, GUI socket etc).
+   Input   : sink list.
+   Output  : none.
+*/
+void output_file_map(fl_sink_list_t *sinks)
 {
     struct fl_file_record *s;
 
     for(s=file_map; s != NULL; s=(struct fl_file_record *)(s->hh.next))
     {
-        fputs(s->file_event_string, outfile);
+        write_sink_string(sinks, s->file_event_string);
     }
 }
 
-void write_file_map_in_time_sequence(FILE *outfile, int lowest)
+void output_file_map_in_time_sequence(fl_sink_list_t *sinks, int lowest)
 {
     struct fl_file_record *s;
     struct fl_file_record *m;
-    HASH_FIND(hh, file_map, &lowest, sizeof(int), m);  /* get the first rul record then start iterating over the map */
+    HASH_FIND(hh, file_map, &lowest, sizeof(int), m);  /* get the first record then start iterating over the map */
     if (m != NULL)
     {
        for(s=m; s != NULL; s=(struct fl_file_record *)(s->hh.next))
        {
-           fputs(s->file_event_string, outfile);
+           write_sink_string(sinks, s->file_event_string);
        }
     }
     /* now finish of the rest of the event list from the start of the map */
-    for(s=file_map; s != NULL; s=(struct fl_file_record *)(s->hh.next))    {
+    for(s=file_map; s != NULL; s=(struct fl_file_record *)(s->hh.next))
+    {
         if (s->id > lowest)
-           fputs(s->file_event_string, outfile);
+           write_sink_string(sinks, s->file_event_string);
         else
            break;
     }
@@ -131,37 +139,6 @@ uint64_t get_first_record_number()
     return(lowest);
 }
 
-void send_file_map()
-{
-    struct fl_file_record *s;
-
-    for(s=file_map; s != NULL; s=(struct fl_file_record *)(s->hh.next))    {
-        send_event(s->file_event_string);
-    }
-}
-
-void send_file_map_in_time_sequence(int lowest)
-{
-    struct fl_file_record *s;
-    struct fl_file_record *m;
-    HASH_FIND(hh, file_map, &lowest, sizeof(int), m);  /* get the first event record then start iterating over the map */
-    if (m != NULL)
-	 {
-       for(s=m; s != NULL; s=(struct fl_file_record *)(s->hh.next))
-	    {
-           send_event(s->file_event_string);
-       }
-    }
-    /* now finish of the rest of the event list from the start of the map */
-    for(s=file_map; s != NULL; s=(struct fl_file_record *)(s->hh.next))
-	 {
-        if (s->id > lowest)
-           send_event(s->file_event_string);
-        else
-           break;
-    }
-}
-
 void print_file_map()
 {
     struct fl_file_record *s;
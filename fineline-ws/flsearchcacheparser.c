@@ -53,6 +53,30 @@
 
 */
 
+/*
+   Function: close_event_outputs
+   Purpose : Flushes and closes the output sinks, then closes the FineLine event
+             file and the GUI socket. Every exit after the sinks are set up goes
+             through here so partial output is written and nothing is leaked.
+   Input   : sink list, event file or NULL, 1 if the GUI socket is open.
+   Output  : None.
+*/
+static void close_event_outputs(fl_sink_list_t *sinks, FILE *fl_evt_file, int gui_socket)
+{
+   close_sinks(sinks);
+
+   /* close the event output file */
+   if (fl_evt_file != NULL)
+   {
+      fclose(fl_evt_file);
+   }
+   /* close the socket to the GUI */
+   if (gui_socket)
+   {
+      close_socket();
+   }
+}
+
 int parse_winsearch_cache_file(char *winsearchfile, char *fl_event_filename, int mode, char *gui_ip_addr, char *filter_filename)
 {
    libcerror_error_t *error     = NULL;
@@ -63,6 +87,8 @@ int parse_winsearch_cache_file(char *winsearchfile, char *fl_event_filename, int
    int number_of_tables         = 0;
    size_t table_name_size       = 0;
    FILE *fl_evt_file            = NULL;
+   int gui_socket               = 0;
+   fl_sink_list_t sinks;
 
    if(libesedb_file_initialize(&input_file, &error) != 1)
    {
@@ -95,14 +121,28 @@ int parse_winsearch_cache_file(char *winsearchfile, char *fl_event_filename, int
 
    printf("parse_winsearch_cache_file() <INFO> Number of tables: %d.\n", number_of_tables);
 
+   init_sink_list(&sinks);
+
    /* if -w mode then open the fineline event file for output */
-   if (mode & FL_FILE_OUT)
+   if ((mode & FL_FILE_OUT) && !(mode & FL_FLB_OUT))
    {
       fl_evt_file = open_fineline_event_file(fl_event_filename);
 
       if (fl_evt_file == NULL)
       {
          print_log_entry("parse_winsearch_cache_file() <ERROR> Failed to open FineLine event file.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
+         return(-1);
+      }
+      add_file_sink(&sinks, fl_evt_file, 0);
+   }
+   /* if -F flb mode then write a binary timeline file instead */
+   if (mode & FL_FLB_OUT)
+   {
+      if (add_flb_sink(&sinks, fl_event_filename, winsearchfile) < 0)
+      {
+         print_log_entry("parse_winsearch_cache_file() <ERROR> Failed to open FineLine binary timeline file.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
    }
@@ -112,8 +152,11 @@ int parse_winsearch_cache_file(char *winsearchfile, char *fl_event_filename, int
       if (init_socket(gui_ip_addr))
       {
          print_log_entry("parse_winsearch_cache_file() <ERROR> Could not open socket to GUI.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
+      gui_socket = 1;
+      add_socket_sink(&sinks, 0);
       /* TODO: send_fineline_project_header("NEW PROJECT", fl_evt_file); */
    }
    /* if -f mode then open the filter file */
@@ -122,6 +165,7 @@ int parse_winsearch_cache_file(char *winsearchfile, char *fl_event_filename, int
       if (load_file_filters(filter_filename) < 0)
       {
          print_log_entry("parse_winsearch_cache_file() <ERROR> Could not load URL filter file.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
    }
@@ -131,11 +175,13 @@ int parse_winsearch_cache_file(char *winsearchfile, char *fl_event_filename, int
       if(libesedb_file_get_table(input_file, table_index, &table, &error) != 1 )
       {
          print_log_entry("parse_winsearch_cache_file() <ERROR> Could not get table.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
       if(libesedb_table_get_utf8_name_size(table, &table_name_size, &error) != 1)
       {
          print_log_entry("parse_winsearch_cache_file() <ERROR> Could not get table name size.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
       if(table_name_size > 0 )
@@ -144,6 +190,7 @@ int parse_winsearch_cache_file(char *winsearchfile, char *fl_event_filename, int
          if (libesedb_table_get_utf8_name(table, (uint8_t *) table_name, table_name_size, &error) != 1)
          {
             print_log_entry("parse_winsearch_cache_file() <ERROR> Could not get table name.\n");
+            close_event_outputs(&sinks, fl_evt_file, gui_socket);
             return(-1);
          }
       }
@@ -158,20 +205,13 @@ int parse_winsearch_cache_file(char *winsearchfile, char *fl_event_filename, int
          if(process_systemindex_table(table, mode) < 0)
          {
             print_log_entry("parse_winsearch_cache_file() <ERROR> Could not process systemindex table.\n");
+            close_event_outputs(&sinks, fl_evt_file, gui_socket);
             return(-1);
          }
          else
          {
             sort_by_time();
-            if (mode & FL_FILE_OUT)
-            {
-               write_file_map(fl_evt_file);
-            }
-
-            if (mode & FL_GUI_OUT)
-            {
-               send_file_map();
-            }
+            output_file_map(&sinks);
          }
       }
       else if (strncmp(table_name, "SystemIndex_PropertyStore", 25) == 0)
@@ -183,25 +223,19 @@ int parse_winsearch_cache_file(char *winsearchfile, char *fl_event_filename, int
          if(process_systemindex_propertystore_table(table, mode) < 0)
          {
             print_log_entry("parse_winsearch_cache_file() <ERROR> Could not process property store table.\n");
+            close_event_outputs(&sinks, fl_evt_file, gui_socket);
             return(-1);
          }
          else
          {
             sort_by_time();
-            if (mode & FL_FILE_OUT)
-            {
-               write_file_map(fl_evt_file);
-            }
-
-            if (mode & FL_GUI_OUT)
-            {
-               send_file_map();
-            }
+            output_file_map(&sinks);
          }
       }
       if(libesedb_table_free(&table, &error) != 1)
       {
          print_log_entry("parse_winsearch_cache_file() <ERROR> Could not free table.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return( -1 );
       }
       xfree(table_name, table_name_size);
@@ -210,25 +244,19 @@ int parse_winsearch_cache_file(char *winsearchfile, char *fl_event_filename, int
    if(libesedb_file_close(input_file, &error) != 0)
    {
       print_log_entry("parse_winsearch_cache_file() <ERROR> Could not close input file.\n");
+      close_event_outputs(&sinks, fl_evt_file, gui_socket);
       return(-1);
    }
 
    if(libesedb_file_free(&input_file, &error) != 1)
    {
       print_log_entry("parse_winsearch_cache_file() <ERROR> Could not free input file.\n");
+      close_event_outputs(&sinks, fl_evt_file, gui_socket);
       return(-1);
    }
 
-   /* close the event output file */
-   if (mode & FL_FILE_OUT)
-   {
-      fclose(fl_evt_file);
-   }
-   /* close the socket to the GUI */
-   if (mode & FL_GUI_OUT)
-   {
-      close_socket();
-   }
+   close_event_outputs(&sinks, fl_evt_file, gui_socket);
+
    return(0);
 }
 
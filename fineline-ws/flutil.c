@@ -93,6 +93,7 @@ int print_help()
    printf("Output to a fineline event file                   : -w\n");
    printf("Only send events to GUI                           : -s\n");
    printf("Specify fineline output filename                  : -o FILENAME\n");
+   printf("Specify output file format (fle or flb)           : -F FORMAT\n");
    printf("Specify IE cache input file                       : -i FILENAME\n");
    printf("Specify a GUI server IP address                   : -a 192.168.1.10\n");
    printf("Specify filter file                               : -f FILENAME\n");
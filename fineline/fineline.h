@@ -57,6 +57,8 @@
 #include <libevt.h>
 
 #include "uthash.h"
+#include "flsink.h"
+#include "flbfile.h"
 
 /*
    Constant Definitions
@@ -77,6 +79,7 @@
 #define FL_EVTX_IN   0x04
 #define FL_EVT_IN    0x08
 #define FL_FILTER_ON 0x10
+#define FL_FLB_OUT   0x80  /* Binary timeline (.flb) output */
 
 #define DATABASE_FILE_EXT ".txt"
 #define EVENT_FILE_EXT ".fle"
@@ -259,7 +262,7 @@ int read_event_log_header(FILE *event_file, FILE *db_file, FILE *log_file);
 /* flevtx.c */
 int evtx_file_initialise(libevtx_file_t **evtxf);
 int evtx_file_open(libevtx_file_t *evtxf, char* filename);
-int evtx_process_file(libevtx_file_t *evtxf, char *fl_event_filename, int mode, char *gui_addr);
+int evtx_process_file(libevtx_file_t *evtxf, char *evtx_filename, char *fl_event_filename, int mode, char *gui_addr);
 int evtx_file_close(libevtx_file_t *evtxf);
 int evtx_file_free(libevtx_file_t **evtxf);
 int evtx_parse_event_record(libevtx_record_t *record, struct fl_event_record *fler, int mode, char *current_id, char *current_time);
@@ -272,7 +275,7 @@ int evtx_get_message_strings(libevtx_record_t *record, char *mess_string);
 
 int evt_file_initialise(libevt_file_t **evtf);
 int evt_file_open(libevt_file_t *evtf, char* filename);
-int evt_process_file(libevt_file_t *evtf, char *fl_event_filename, int mode, char *gui_addr);
+int evt_process_file(libevt_file_t *evtf, char *evt_filename, char *fl_event_filename, int mode, char *gui_addr);
 int evt_file_close(libevt_file_t *evtf);
 int evt_file_free(libevt_file_t **evtf);
 int evt_parse_event_record(libevt_record_t *record, struct fl_event_record *fler, int mode, char *current_id, char *current_time);
@@ -300,10 +303,8 @@ void add_filter(int event_id, struct fl_event_filter *flef);
 
 void add_event_record(uint64_t event_id, struct fl_event_record *fler);
 struct fl_event_record *find_event(uint64_t event_id);
-void write_event_map(FILE *outfile);
-void write_event_map_in_time_sequence(FILE *outfile, uint64_t lowest);
-void send_event_map();
-void send_event_map_in_time_sequence(uint64_t lowest);
+void output_event_map(fl_sink_list_t *sinks);
+void output_event_map_in_time_sequence(fl_sink_list_t *sinks, uint64_t lowest);
 int time_sort(struct fl_event_record *a, struct fl_event_record *b);
 void sort_by_time();
 void sort_by_record_number();
@@ -317,6 +318,7 @@ uint64_t get_first_record_number();
 
 int init_socket(char *gui_ip_address);
 int send_event(char *event_string);
+int send_event_block(char *event_block, int block_len);
 char *get_response();
 int close_socket();
 
@@ -95,32 +95,40 @@ void delete_all()
   }
 }
 
-void write_event_map(FILE *outfile) 
+/*
+   Function: output_event_map()
+   Purpose : single pass over the event map, each record is serialised
+             once and handed to every output sink (file, GUI socket etc).
+   Input   : sink list.
+   Output  : none.
+*/
+void output_event_map(fl_sink_list_t *sinks)
 {
     struct fl_event_record *s;
 
-    for(s=event_map; s != NULL; s=(struct fl_event_record *)(s->hh.next)) 
+    for(s=event_map; s != NULL; s=(struct fl_event_record *)(s->hh.next))
     {
-        fputs(s->event_record_string, outfile);
+        write_sink_string(sinks, s->event_record_string);
     }
 }
 
-void write_event_map_in_time_sequence(FILE *outfile, uint64_t lowest)
+void output_event_map_in_time_sequence(fl_sink_list_t *sinks, uint64_t lowest)
 {
     struct fl_event_record *s;
-    struct fl_event_record *m;    
+    struct fl_event_record *m;
     HASH_FIND(hh, event_map, &lowest, sizeof(uint64_t), m);  /* get the first event record then start iterating over the map */
-    if (m != NULL) 
+    if (m != NULL)
     {
-       for(s=m; s != NULL; s=(struct fl_event_record *)(s->hh.next)) 
+       for(s=m; s != NULL; s=(struct fl_event_record *)(s->hh.next))
        {
-           fputs(s->event_record_string, outfile);
+           write_sink_string(sinks, s->event_record_string);
        }
     }
     /* now finish of the rest of the event list from the start of the map */
-    for(s=event_map; s != NULL; s=(struct fl_event_record *)(s->hh.next))     {
+    for(s=event_map; s != NULL; s=(struct fl_event_record *)(s->hh.next))
+    {
         if (s->id > lowest)
-           fputs(s->event_record_string, outfile);
+           write_sink_string(sinks, s->event_record_string);
         else
            break;
     }
@@ -137,38 +145,6 @@ uint64_t get_first_record_number()
     return(lowest);
 }
 
-void send_event_map() 
-{
-    struct fl_event_record *s;
-
-    for(s=event_map; s != NULL; s=(struct fl_event_record *)(s->hh.next)) 
-    {
-        send_event(s->event_record_string);
-    }
-}
-
-void send_event_map_in_time_sequence(uint64_t lowest)
-{
-    struct fl_event_record *s;
-    struct fl_event_record *m;    
-    HASH_FIND(hh, event_map, &lowest, sizeof(uint64_t), m);  /* get the first event record then start iterating over the map */
-    if (m != NULL) 
-    {
-       for(s=m; s != NULL; s=(struct fl_event_record *)(s->hh.next)) 
-       {
-           send_event(s->event_record_string);
-       }
-    }
-    /* now finish of the rest of the event list from the start of the map */
-    for(s=event_map; s != NULL; s=(struct fl_event_record *)(s->hh.next)) 
-    {
-        if (s->id > lowest)
-           send_event(s->event_record_string);
-        else
-           break;
-    }
-}
-
 void print_event_map() 
 {
     struct fl_event_record *s;
@@ -67,7 +67,7 @@ int parse_evtx_event_log(char *evtx_file, char *fl_event_file, int mode, char *g
       return(-1);
    }
   
-   if (evtx_process_file(evtxf, fl_event_file, mode, gui_ip_addr) < 0)
+   if (evtx_process_file(evtxf, evtx_file, fl_event_file, mode, gui_ip_addr) < 0)
    {
       print_log_entry("parse_evtx_event_log() <ERROR> Could not process libevtx file.\n");
       return(-1);
@@ -119,7 +119,7 @@ int parse_evt_event_log(char *evt_file, char *fl_event_file, int mode, char *gui
       return(-1);
    }
   
-   if (evt_process_file(evtf, fl_event_file, mode, gui_ip_addr) < 0)
+   if (evt_process_file(evtf, evt_file, fl_event_file, mode, gui_ip_addr) < 0)
    {
       print_log_entry("parse_evt_event_log() <ERROR> Could not process libevt file.\n");
       return(-1);
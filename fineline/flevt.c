@@ -63,7 +63,31 @@ int evt_file_open(libevt_file_t *evtf, char* filename)
    return(0);
 }
 
-int evt_process_file(libevt_file_t *evtf, char *fl_event_filename, int mode, char *gui_addr)
+/*
+   Function: close_event_outputs
+   Purpose : Flushes and closes the output sinks, then closes the FineLine event
+             file and the GUI socket. Every exit after the sinks are set up goes
+             through here so partial output is written and nothing is leaked.
+   Input   : sink list, event file or NULL, 1 if the GUI socket is open.
+   Output  : None.
+*/
+static void close_event_outputs(fl_sink_list_t *sinks, FILE *fl_evt_file, int gui_socket)
+{
+   close_sinks(sinks);
+
+   /* close the event output file */
+   if (fl_evt_file != NULL)
+   {
+      fclose(fl_evt_file);
+   }
+   /* close the socket to the GUI */
+   if (gui_socket)
+   {
+      close_socket();
+   }
+}
+
+int evt_process_file(libevt_file_t *evtf, char *evt_filename, char *fl_event_filename, int mode, char *gui_addr)
 {
    libevt_error_t *error = NULL;
    libevt_record_t *record = NULL;
@@ -75,6 +99,8 @@ int evt_process_file(libevt_file_t *evtf, char *fl_event_filename, int mode, cha
    char record_count_string[256];
    int i, result, filtered_count = 0, non_filtered_count = 0;
    FILE *fl_evt_file = NULL;
+   int gui_socket = 0;
+   fl_sink_list_t sinks;
    uint64_t first_record_number;
    struct fl_event_record * fler;
 
@@ -106,14 +132,28 @@ int evt_process_file(libevt_file_t *evtf, char *fl_event_filename, int mode, cha
 	   return(0);
 	}
 
+   init_sink_list(&sinks);
+
    /* if -d mode then open the fineline event file for output */
-   if (mode & FL_FILE_OUT)
+   if ((mode & FL_FILE_OUT) && !(mode & FL_FLB_OUT))
    {
       fl_evt_file = open_fineline_event_file(fl_event_filename);
 
       if (fl_evt_file == NULL)
       {
          print_log_entry("evt_process_file() <ERROR> Failed to open FineLine event file.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
+         return(-1);
+      }
+      add_file_sink(&sinks, fl_evt_file, 0);
+   }
+   /* if -F flb mode then write a binary timeline file instead */
+   if (mode & FL_FLB_OUT)
+   {
+      if (add_flb_sink(&sinks, fl_event_filename, evt_filename) < 0)
+      {
+         print_log_entry("evt_process_file() <ERROR> Failed to open FineLine binary timeline file.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
    }
@@ -124,8 +164,11 @@ int evt_process_file(libevt_file_t *evtf, char *fl_event_filename, int mode, cha
 		if (result < 0)
 		{
 		   print_log_entry("evt_process_file() <ERROR> Could not open socket to GUI.\n");
+			close_event_outputs(&sinks, fl_evt_file, gui_socket);
 			return(-1);
 		}
+		gui_socket = 1;
+		add_socket_sink(&sinks, 0);
 	}
 
    sprintf(record_count_string, "evt_process_file() <INFO> Processing %d event records\n", number_of_records);
@@ -137,6 +180,7 @@ int evt_process_file(libevt_file_t *evtf, char *fl_event_filename, int mode, cha
 		if( libevt_file_get_record(evtf, i, &record, &error ) != 1 )
 		{
 			print_log_entry("evt_process_file() <ERROR> Could not get evt record.\n");
+			close_event_outputs(&sinks, fl_evt_file, gui_socket);
 			return(-1);
 		}
       fler = (struct fl_event_record *)xcalloc(sizeof(struct fl_event_record));
@@ -149,6 +193,7 @@ int evt_process_file(libevt_file_t *evtf, char *fl_event_filename, int mode, cha
 		if (result < 0)
 		{
           print_log_entry("evt_process_file() <ERROR> Could not parse evt record.\n");
+          close_event_outputs(&sinks, fl_evt_file, gui_socket);
           return(-1);
 		} 
       else if (result == 0) /* filter for this event type was not set in the filter file */
@@ -191,40 +236,22 @@ int evt_process_file(libevt_file_t *evtf, char *fl_event_filename, int mode, cha
    /* now sort the event records into time order */
    first_record_number = get_first_record_number();
 
-   /* write the event to file */
-   if (mode & FL_FILE_OUT)
+   /* write the project header, then a single pass over the event map
+      writes each record to every output sink */
+   if (fl_evt_file != NULL)
    {
       write_fineline_project_header("NEW PROJECT", fl_evt_file, number_of_records);
-
-      sprintf(record_count_string, "evt_process_file() <INFO> Writing %d event records\n", number_of_records);
-      print_log_entry(record_count_string);
-
-      write_event_map_in_time_sequence(fl_evt_file, first_record_number);
-      /* printf("evt_process_file() <INFO> Event Record: %s\n", event_string); */
    }
-   /* send the event to the gui */
-   if (mode & FL_GUI_OUT)
-   {
-      sprintf(record_count_string, "evt_process_file() <INFO> Sending %d event records\n", number_of_records);
-      print_log_entry(record_count_string);
 
-      send_event_map_in_time_sequence(first_record_number);
-   }
+   sprintf(record_count_string, "evt_process_file() <INFO> Writing %d event records\n", number_of_records);
+   print_log_entry(record_count_string);
+
+   output_event_map_in_time_sequence(&sinks, first_record_number);
+   close_event_outputs(&sinks, fl_evt_file, gui_socket);
 
    sprintf(record_count_string, "evt_process_file() <INFO> Processed %d event records <Filtered = %d, Non-Filtered = %d\n", i, filtered_count, non_filtered_count);
    print_log_entry(record_count_string);
 
-   /* close the event output file */
-   if (mode & FL_FILE_OUT)
-   {
-      fclose(fl_evt_file);
-   }
-   /* close the socket to the GUI */
-   if (mode & FL_GUI_OUT)
-   {
-      close_socket();
-   }
-
    return(0);
 }
 
@@ -74,7 +74,31 @@ int evtx_file_open(libevtx_file_t *evtxf, char* filename)
    return(0);
 }
 
-int evtx_process_file(libevtx_file_t *evtxf, char *fl_event_filename, int mode, char *gui_addr)
+/*
+   Function: close_event_outputs
+   Purpose : Flushes and closes the output sinks, then closes the FineLine event
+             file and the GUI socket. Every exit after the sinks are set up goes
+             through here so partial output is written and nothing is leaked.
+   Input   : sink list, event file or NULL, 1 if the GUI socket is open.
+   Output  : None.
+*/
+static void close_event_outputs(fl_sink_list_t *sinks, FILE *fl_evt_file, int gui_socket)
+{
+   close_sinks(sinks);
+
+   /* close the event output file */
+   if (fl_evt_file != NULL)
+   {
+      fclose(fl_evt_file);
+   }
+   /* close the socket to the GUI */
+   if (gui_socket)
+   {
+      close_socket();
+   }
+}
+
+int evtx_process_file(libevtx_file_t *evtxf, char *evtx_filename, char *fl_event_filename, int mode, char *gui_addr)
 {
    libevtx_error_t *error = NULL;
    libevtx_record_t *record = NULL;
@@ -86,6 +110,8 @@ int evtx_process_file(libevtx_file_t *evtxf, char *fl_event_filename, int mode,
    char record_count_string[256];
    int i, result, filtered_count = 0, non_filtered_count = 0;
    FILE *fl_evt_file = NULL;
+   int gui_socket = 0;
+   fl_sink_list_t sinks;
    uint64_t first_record_number;
    struct fl_event_record * fler;
 
@@ -117,14 +143,28 @@ int evtx_process_file(libevtx_file_t *evtxf, char *fl_event_filename, int mode,
       return( 0 );
    }
 
+   init_sink_list(&sinks);
+
    /* if not -g mode then open the fineline event file for output */
-   if (mode & FL_FILE_OUT)
+   if ((mode & FL_FILE_OUT) && !(mode & FL_FLB_OUT))
    {
       fl_evt_file = open_fineline_event_file(fl_event_filename);
 
       if (fl_evt_file == NULL)
       {
          print_log_entry("evtx_process_file() <ERROR> Failed to open FineLine event file.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
+         return(-1);
+      }
+      add_file_sink(&sinks, fl_evt_file, 0);
+   }
+   /* if -F flb mode then write a binary timeline file instead */
+   if (mode & FL_FLB_OUT)
+   {
+      if (add_flb_sink(&sinks, fl_event_filename, evtx_filename) < 0)
+      {
+         print_log_entry("evtx_process_file() <ERROR> Failed to open FineLine binary timeline file.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
    }
@@ -135,8 +175,11 @@ int evtx_process_file(libevtx_file_t *evtxf, char *fl_event_filename, int mode,
       if (result < 0)
       {
          print_log_entry("evtx_process_file() <ERROR> Could not open socket to GUI.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
+      gui_socket = 1;
+      add_socket_sink(&sinks, 0);
       /* TODO: send_fineline_project_header("NEW PROJECT", fl_evt_file); */
    }
 
@@ -149,6 +192,7 @@ int evtx_process_file(libevtx_file_t *evtxf, char *fl_event_filename, int mode,
       if( libevtx_file_get_record(evtxf, i, &record, &error ) != 1 )
       {
          print_log_entry("evtx_process_file() <ERROR> Could not get EVTX record.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       }
       fler = (struct fl_event_record *)xcalloc(sizeof(struct fl_event_record));
@@ -180,6 +224,7 @@ int evtx_process_file(libevtx_file_t *evtxf, char *fl_event_filename, int mode,
       else /*if (result < 0) */
       {
          print_log_entry("evtx_process_file() <ERROR> Could not parse EVTX record.\n");
+         close_event_outputs(&sinks, fl_evt_file, gui_socket);
          return(-1);
       } 
 
@@ -204,40 +249,22 @@ int evtx_process_file(libevtx_file_t *evtxf, char *fl_event_filename, int mode,
    /* now sort the event records into time order */
    first_record_number = get_first_record_number();
 
-   /* write the event to file */
-   if (mode & FL_FILE_OUT)
+   /* write the project header, then a single pass over the event map
+      writes each record to every output sink */
+   if (fl_evt_file != NULL)
    {
       write_fineline_project_header("NEW PROJECT", fl_evt_file, number_of_records);
-
-      sprintf(record_count_string, "evtx_process_file() <INFO> Writing %d event records\n", number_of_records);
-      print_log_entry(record_count_string);
-
-      write_event_map_in_time_sequence(fl_evt_file, first_record_number);
-      /* printf("evtx_process_file() <INFO> Event Record: %s\n", event_string); */
    }
-	/* send the event to the gui */
-   if (mode & FL_GUI_OUT)
-   {
-      sprintf(record_count_string, "evtx_process_file() <INFO> Sending %d event records\n", number_of_records);
-      print_log_entry(record_count_string);
 
-      send_event_map_in_time_sequence(first_record_number);
-   }
+   sprintf(record_count_string, "evtx_process_file() <INFO> Writing %d event records\n", number_of_records);
+   print_log_entry(record_count_string);
+
+   output_event_map_in_time_sequence(&sinks, first_record_number);
+   close_event_outputs(&sinks, fl_evt_file, gui_socket);
 
    sprintf(record_count_string, "evtx_process_file() <INFO> Processed %d event records <Filtered = %d, Non-Filtered = %d\n", i, filtered_count, non_filtered_count);
    print_log_entry(record_count_string);
 
-   /* close the event output file */
-   if (mode & FL_FILE_OUT)
-   {
-      fclose(fl_evt_file);
-   }
-   /* close the socket to the GUI */
-   if (mode & FL_GUI_OUT)
-   {
-      close_socket();
-   }
-
    return(0);
 }
 
@@ -16,6 +16,14 @@ cd ../fineline-ws
 make clean
 make
 
+cd ../fineline-index
+make clean
+make
+
+cd ../fineline-merge
+make clean
+make
+
 cd ../fineline-search
 make clean
 make